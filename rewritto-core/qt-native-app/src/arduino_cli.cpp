@@ -92,6 +92,21 @@ QString findFirstNonSnapArduinoCliFromPath() {
 
   return {};
 }
+
+// Tools whose "<tool>: ..." lines are checked for upload failures.
+bool startsWithUploadTool(const QString& line) {
+  static constexpr QLatin1String kTools[] = {
+      QLatin1String("avrdude"),  QLatin1String("bossac"),
+      QLatin1String("dfu-util"), QLatin1String("esptool"),
+      QLatin1String("picotool"), QLatin1String("openocd"),
+  };
+  for (const QLatin1String tool : kTools) {
+    if (line.startsWith(tool)) {
+      return true;
+    }
+  }
+  return false;
+}
 }  // namespace
 
 ArduinoCli::ArduinoCli(QObject* parent) : QObject(parent) {
@@ -116,7 +131,6 @@ ArduinoCli::ArduinoCli(QObject* parent) : QObject(parent) {
   ldCannotFindLine_ =
       QRegularExpression(R"(^(?:.+\/)?ld:\s*(?:error:\s*)?(cannot find .+)$)");
   exitStatusLine_ = QRegularExpression(R"(^exit status\s+\d+\s*$)");
-  compilationErrorLine_ = QRegularExpression(R"(^Compilation error:.*$)");
 
   connect(process_, &QProcess::readyReadStandardOutput, this, [this] {
     const QString chunk =
@@ -197,6 +211,47 @@ QStringList ArduinoCli::withGlobalFlags(QStringList args) const {
   return args;
 }
 
+QString ArduinoCli::arduinoDataDir() const {
+  const QString dir = configDirectory(QStringLiteral("data"));
+  return dir.isEmpty() ? defaultArduinoDataDir() : dir;
+}
+
+QString ArduinoCli::arduinoUserDir() const {
+  const QString dir = configDirectory(QStringLiteral("user"));
+  return dir.isEmpty() ? defaultArduinoUserDir() : dir;
+}
+
+QString ArduinoCli::configDirectory(const QString& key) const {
+  QFile f(arduinoCliConfigPath_);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return {};
+  }
+  const QString prefix = key + QLatin1Char(':');
+  bool inDirectories = false;
+  while (!f.atEnd()) {
+    const QString raw = QString::fromUtf8(f.readLine());
+    const QString line = raw.trimmed();
+    if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+      continue;
+    }
+    if (!raw.at(0).isSpace()) {
+      inDirectories = line == QStringLiteral("directories:");
+      continue;
+    }
+    if (inDirectories && line.startsWith(prefix)) {
+      QString value = line.mid(prefix.size()).trimmed();
+      if (value.size() >= 2 && (value.startsWith(QLatin1Char('"')) ||
+                                value.startsWith(QLatin1Char('\'')))) {
+        value = value.mid(1, value.size() - 2);
+      }
+      if (!value.isEmpty()) {
+        return value;
+      }
+    }
+  }
+  return {};
+}
+
 bool ArduinoCli::isRunning() const {
   return process_->state() != QProcess::NotRunning;
 }
@@ -210,15 +265,15 @@ void ArduinoCli::stop() {
 
 void ArduinoCli::consumeText(const QString& chunk) {
   lineBuffer_.append(chunk);
-  while (true) {
-    const int idx = lineBuffer_.indexOf('\n');
-    if (idx < 0) {
-      break;
-    }
-    QString line = lineBuffer_.left(idx);
-    lineBuffer_.remove(0, idx + 1);
-    consumeLine(std::move(line));
-  }
+  // One pass over the buffer; the consumed prefix is dropped once at the end
+  // rather than after every line.
+  qsizetype start = 0;
+  for (qsizetype idx = lineBuffer_.indexOf(QLatin1Char('\n')); idx >= 0;
+       idx = lineBuffer_.indexOf(QLatin1Char('\n'), start)) {
+    consumeLine(lineBuffer_.mid(start, idx - start));
+    start = idx + 1;
+  }
+  lineBuffer_.remove(0, start);
 }
 
 void ArduinoCli::consumeLine(QString line) {
@@ -276,7 +331,20 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  auto match = diagnosticWithColumn_.match(trimmed);
+  // Literal checks gate every regex below: in a verbose build nearly every
+  // line is a compiler command that none of them can match, and a failed
+  // contains() is far cheaper than a failed match().
+  auto matchIf = [&trimmed](bool candidate, const QRegularExpression& re) {
+    return candidate ? re.match(trimmed) : QRegularExpressionMatch{};
+  };
+  // "fatal error:" contains "error:".
+  const bool hasSeverity = trimmed.contains(QLatin1String("error:")) ||
+                           trimmed.contains(QLatin1String("warning:")) ||
+                           trimmed.contains(QLatin1String("note:"));
+  const bool hasUndefinedReference =
+      trimmed.contains(QLatin1String("undefined reference to"));
+
+  auto match = matchIf(hasSeverity, diagnosticWithColumn_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = match.captured(1);
@@ -289,7 +357,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  match = diagnosticNoColumn_.match(trimmed);
+  match = matchIf(hasSeverity, diagnosticNoColumn_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = match.captured(1);
@@ -302,7 +370,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  match = toolDiagnostic_.match(trimmed);
+  match = matchIf(hasSeverity, toolDiagnostic_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = match.captured(1);
@@ -315,7 +383,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  {
+  if (trimmed.contains(QLatin1String("platform"), Qt::CaseInsensitive)) {
     static const QRegularExpression platformNotInstalled(
         R"(platform\s+(?:not\s+installed|not\s+found)\s*:\s*([A-Za-z0-9_.+\-]+:[A-Za-z0-9_.+\-]+))",
         QRegularExpression::CaseInsensitiveOption);
@@ -340,7 +408,8 @@ void ArduinoCli::consumeLine(QString line) {
     }
   }
 
-  {
+  if (trimmed.contains(QLatin1String("not found"), Qt::CaseInsensitive) ||
+      trimmed.contains(QLatin1String("no such file"), Qt::CaseInsensitive)) {
     static const QRegularExpression execNotFound(
         R"(exec:\s*\"([^\"]+)\":\s*executable file not found in\s+\$PATH)",
         QRegularExpression::CaseInsensitiveOption);
@@ -377,7 +446,7 @@ void ArduinoCli::consumeLine(QString line) {
     }
   }
 
-  {
+  if (startsWithUploadTool(trimmed)) {
     static const QRegularExpression toolPrefix(
         R"(^(avrdude|bossac|dfu-util|esptool\.py|esptool|picotool|openocd)\s*:\s*(.*)$)");
     const QRegularExpressionMatch tm = toolPrefix.match(trimmed);
@@ -418,11 +487,10 @@ void ArduinoCli::consumeLine(QString line) {
   }
 
   {
-    const QString lower = trimmed.toLower();
-    if (lower.startsWith(QStringLiteral("error during upload")) ||
-        lower.startsWith(QStringLiteral("failed uploading")) ||
-        lower.startsWith(QStringLiteral("uploading error")) ||
-        lower.startsWith(QStringLiteral("failed to upload"))) {
+    if (trimmed.startsWith(QLatin1String("error during upload"), Qt::CaseInsensitive) ||
+        trimmed.startsWith(QLatin1String("failed uploading"), Qt::CaseInsensitive) ||
+        trimmed.startsWith(QLatin1String("uploading error"), Qt::CaseInsensitive) ||
+        trimmed.startsWith(QLatin1String("failed to upload"), Qt::CaseInsensitive)) {
       flushPendingDiagnostic();
       pendingDiagnostic_.filePath = QStringLiteral("Upload");
       pendingDiagnostic_.line = 0;
@@ -435,7 +503,7 @@ void ArduinoCli::consumeLine(QString line) {
     }
   }
 
-  match = collect2Error_.match(trimmed);
+  match = matchIf(trimmed.startsWith(QLatin1String("collect2")), collect2Error_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QStringLiteral("collect2");
@@ -448,7 +516,8 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  if (libraryConflictStart_.match(trimmed).hasMatch()) {
+  if (trimmed.startsWith(QLatin1String("Multiple libraries")) &&
+      libraryConflictStart_.match(trimmed).hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QString{};
     pendingDiagnostic_.line = 0;
@@ -460,7 +529,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  match = undefinedReferenceWithLine_.match(trimmed);
+  match = matchIf(hasUndefinedReference, undefinedReferenceWithLine_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = match.captured(1).trimmed();
@@ -473,7 +542,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  match = undefinedReferenceObjectLine_.match(trimmed);
+  match = matchIf(hasUndefinedReference, undefinedReferenceObjectLine_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = match.captured(1);
@@ -486,7 +555,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  match = ldCannotFindLine_.match(trimmed);
+  match = matchIf(trimmed.contains(QLatin1String("cannot find")), ldCannotFindLine_);
   if (match.hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QStringLiteral("ld");
@@ -499,7 +568,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  if (trimmed.contains(QStringLiteral("undefined reference to"))) {
+  if (hasUndefinedReference) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QStringLiteral("ld");
     pendingDiagnostic_.line = 0;
@@ -511,7 +580,8 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  if (exitStatusLine_.match(trimmed).hasMatch()) {
+  if (trimmed.startsWith(QLatin1String("exit status")) &&
+      exitStatusLine_.match(trimmed).hasMatch()) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QString{};
     pendingDiagnostic_.line = 0;
@@ -523,7 +593,7 @@ void ArduinoCli::consumeLine(QString line) {
     return;
   }
 
-  if (compilationErrorLine_.match(trimmed).hasMatch()) {
+  if (trimmed.startsWith(QLatin1String("Compilation error:"))) {
     flushPendingDiagnostic();
     pendingDiagnostic_.filePath = QString{};
     pendingDiagnostic_.line = 0;
@@ -15,6 +15,12 @@ class ArduinoCli final : public QObject {
   QString arduinoCliPath() const;
   QString arduinoCliConfigPath() const;
   QStringList withGlobalFlags(QStringList args) const;
+  // `directories.data` from the config file (where the package and library
+  // indexes live), or the platform default.
+  QString arduinoDataDir() const;
+  // `directories.user`, the sketchbook (manually installed cores live in
+  // its hardware/ folder), or the platform default.
+  QString arduinoUserDir() const;
 
   bool isRunning() const;
   void stop();
@@ -54,7 +60,6 @@ class ArduinoCli final : public QObject {
   QRegularExpression undefinedReferenceWithLine_;
   QRegularExpression ldCannotFindLine_;
   QRegularExpression exitStatusLine_;
-  QRegularExpression compilationErrorLine_;
 
   bool hasPendingDiagnostic_ = false;
   PendingDiagnostic pendingDiagnostic_;
@@ -63,6 +68,7 @@ class ArduinoCli final : public QObject {
   void consumeText(const QString& chunk);
   void consumeLine(QString line);
   void flushPendingDiagnostic();
+  QString configDirectory(const QString& key) const;
 
   static QString resolveDefaultArduinoCliPath();
   static QString resolveDefaultArduinoCliConfigPath();
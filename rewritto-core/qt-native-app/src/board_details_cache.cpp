@@ -0,0 +1,200 @@
+#include "board_details_cache.h"
+
+#include "arduino_cli.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+constexpr int kCacheFormat = 1;
+
+QString platformIdOf(const QString& baseFqbn) {
+  return baseFqbn.section(QLatin1Char(':'), 0, 1);
+}
+
+}  // namespace
+
+BoardDetailsCache::BoardDetailsCache(ArduinoCli* arduinoCli, QObject* parent)
+    : QObject(parent), arduinoCli_(arduinoCli) {}
+
+BoardDetailsCache::~BoardDetailsCache() {
+  if (!process_) {
+    return;
+  }
+  process_->disconnect(this);
+  if (process_->state() != QProcess::NotRunning) {
+    process_->kill();
+    process_->waitForFinished(250);
+  }
+}
+
+void BoardDetailsCache::setCachePath(QString path) {
+  cachePath_ = std::move(path);
+  loaded_ = false;
+  entries_.clear();
+}
+
+void BoardDetailsCache::setPlatformVersionResolver(
+    std::function<QString(const QString&)> resolver) {
+  versionResolver_ = std::move(resolver);
+}
+
+QString BoardDetailsCache::baseFqbn(const QString& fqbn) {
+  return fqbn.trimmed().section(QLatin1Char(':'), 0, 2);
+}
+
+bool BoardDetailsCache::contains(const QString& fqbn) {
+  ensureLoaded();
+  const QString base = baseFqbn(fqbn);
+  auto it = entries_.constFind(base);
+  if (it == entries_.constEnd()) {
+    return false;
+  }
+  // Unknown on either side (the platform catalog has not loaded, or had
+  // not when the entry was stored) is taken as a match.
+  const QString version = platformVersion(base);
+  return version.isEmpty() || it->platformVersion.isEmpty() ||
+         version == it->platformVersion;
+}
+
+QJsonArray BoardDetailsCache::configOptions(const QString& fqbn) {
+  if (!contains(fqbn)) {
+    return {};
+  }
+  return entries_.value(baseFqbn(fqbn)).options;
+}
+
+void BoardDetailsCache::request(const QString& fqbn) {
+  const QString base = baseFqbn(fqbn);
+  if (base.count(QLatin1Char(':')) != 2 || contains(base) || failed_.contains(base) ||
+      running_ == base) {
+    return;
+  }
+  queue_.removeAll(base);
+  queue_.prepend(base);
+  startNext();
+}
+
+void BoardDetailsCache::prefetch(const QStringList& fqbns) {
+  for (const QString& fqbn : fqbns) {
+    const QString base = baseFqbn(fqbn);
+    if (base.count(QLatin1Char(':')) != 2 || contains(base) || failed_.contains(base) ||
+        isQueuedOrRunning(base)) {
+      continue;
+    }
+    queue_.append(base);
+  }
+  startNext();
+}
+
+void BoardDetailsCache::invalidate() {
+  ensureLoaded();
+  ++generation_;
+  entries_.clear();
+  failed_.clear();
+  save();
+}
+
+void BoardDetailsCache::ensureLoaded() {
+  if (loaded_) {
+    return;
+  }
+  loaded_ = true;
+  if (cachePath_.isEmpty()) {
+    cachePath_ = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+                     .filePath(QStringLiteral("board-details.json"));
+  }
+
+  QFile f(cachePath_);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  const QJsonObject root = QJsonDocument::fromJson(f.readAll()).object();
+  if (root.value("format").toInt() != kCacheFormat) {
+    return;
+  }
+  const QJsonObject boards = root.value("boards").toObject();
+  for (auto it = boards.begin(); it != boards.end(); ++it) {
+    const QJsonObject o = it.value().toObject();
+    entries_.insert(it.key(), {o.value("platform_version").toString(),
+                               o.value("config_options").toArray()});
+  }
+}
+
+void BoardDetailsCache::save() const {
+  QJsonObject boards;
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    boards.insert(it.key(), QJsonObject{{"platform_version", it->platformVersion},
+                                        {"config_options", it->options}});
+  }
+  const QJsonObject root{{"format", kCacheFormat}, {"boards", boards}};
+
+  QDir().mkpath(QFileInfo(cachePath_).absolutePath());
+  QSaveFile f(cachePath_);
+  if (f.open(QIODevice::WriteOnly)) {
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    f.commit();
+  }
+}
+
+QString BoardDetailsCache::platformVersion(const QString& baseFqbn) const {
+  return versionResolver_ ? versionResolver_(platformIdOf(baseFqbn)) : QString{};
+}
+
+bool BoardDetailsCache::isQueuedOrRunning(const QString& baseFqbn) const {
+  return running_ == baseFqbn || queue_.contains(baseFqbn);
+}
+
+void BoardDetailsCache::startNext() {
+  if (process_ || queue_.isEmpty() || !arduinoCli_) {
+    return;
+  }
+  running_ = queue_.takeFirst();
+  runningVersion_ = platformVersion(running_);
+  runningGeneration_ = generation_;
+
+  process_ = new QProcess(this);
+  connect(process_, &QProcess::finished, this, [this](int exitCode, QProcess::ExitStatus) {
+    finishFetch(exitCode == 0, process_->readAllStandardOutput());
+  });
+  connect(process_, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+    if (error == QProcess::FailedToStart) {
+      finishFetch(false, {});
+    }
+  });
+  process_->start(arduinoCli_->arduinoCliPath(),
+                  arduinoCli_->withGlobalFlags({QStringLiteral("board"),
+                                                QStringLiteral("details"),
+                                                QStringLiteral("--fqbn"), running_,
+                                                QStringLiteral("--format"),
+                                                QStringLiteral("json")}));
+}
+
+void BoardDetailsCache::finishFetch(bool ok, const QByteArray& out) {
+  process_->deleteLater();
+  process_ = nullptr;
+  const QString base = running_;
+  running_.clear();
+
+  if (runningGeneration_ != generation_) {
+    // Invalidated while running: the answer may predate the change.
+    queue_.prepend(base);
+  } else {
+    const QJsonDocument doc = QJsonDocument::fromJson(out);
+    if (ok && doc.isObject()) {
+      entries_.insert(base, {runningVersion_, doc.object().value("config_options").toArray()});
+      save();
+      emit detailsReady(base);
+    } else {
+      failed_.insert(base);
+    }
+  }
+  startNext();
+}
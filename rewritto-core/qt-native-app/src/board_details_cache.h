@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonArray>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+class ArduinoCli;
+class QProcess;
+
+// Persistent cache of `arduino-cli board details --format json`, so the
+// board option menus are rebuilt without launching the CLI. Entries are
+// keyed by base FQBN and remember the installed platform version they were
+// read from; an entry whose platform version has since changed counts as
+// missing. Fetches run one at a time in the background.
+class BoardDetailsCache final : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit BoardDetailsCache(ArduinoCli* arduinoCli, QObject* parent = nullptr);
+  ~BoardDetailsCache() override;
+
+  // File the entries persist in; defaults to board-details.json in the
+  // application cache directory. Read on first use.
+  void setCachePath(QString path);
+  // Installed version of a platform ("vendor:arch"), or empty when unknown.
+  void setPlatformVersionResolver(std::function<QString(const QString&)> resolver);
+
+  // vendor:arch:board of an FQBN that may carry options.
+  static QString baseFqbn(const QString& fqbn);
+
+  bool contains(const QString& fqbn);
+  // `config_options` of the board; empty when not cached (or it has none).
+  QJsonArray configOptions(const QString& fqbn);
+
+  // Fetches a board that is not cached, ahead of any queued prefetches.
+  void request(const QString& fqbn);
+  // Queues the boards that are not cached yet.
+  void prefetch(const QStringList& fqbns);
+  // Drops every entry, e.g. after a core was installed or upgraded.
+  void invalidate();
+
+ signals:
+  void detailsReady(QString baseFqbn);
+
+ private:
+  struct Entry final {
+    QString platformVersion;
+    QJsonArray options;
+  };
+
+  ArduinoCli* arduinoCli_ = nullptr;
+  QString cachePath_;
+  std::function<QString(const QString&)> versionResolver_;
+  bool loaded_ = false;
+  QHash<QString, Entry> entries_;  // by base FQBN
+  QStringList queue_;
+  QSet<QString> failed_;  // not retried until invalidate()
+  QProcess* process_ = nullptr;
+  QString running_;
+  QString runningVersion_;
+  quint64 generation_ = 0;
+  quint64 runningGeneration_ = 0;
+
+  void ensureLoaded();
+  void save() const;
+  QString platformVersion(const QString& baseFqbn) const;
+  bool isQueuedOrRunning(const QString& baseFqbn) const;
+  void startNext();
+  void finishFetch(bool ok, const QByteArray& out);
+};
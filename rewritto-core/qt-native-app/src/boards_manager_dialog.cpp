@@ -3,6 +3,7 @@
 #include "arduino_cli.h"
 #include "index_update_policy.h"
 #include "output_widget.h"
+#include "platform_catalog.h"
 #include "platform_filter_proxy_model.h"
 
 #include <QAbstractItemView>
@@ -248,7 +249,34 @@ bool BoardsManagerDialog::isBusy() const {
   return busy_;
 }
 
+void BoardsManagerDialog::setPlatformCatalog(PlatformCatalogService* catalog) {
+  if (platformCatalog_) {
+    disconnect(platformCatalog_, nullptr, this, nullptr);
+  }
+  platformCatalog_ = catalog;
+  if (!platformCatalog_) {
+    return;
+  }
+  connect(platformCatalog_, &PlatformCatalogService::catalogChanged, this, [this] {
+    // Rows from the previous catalog are refreshed against the new one.
+    if (pendingCatalogSearch_ || searchFromCatalog_) {
+      pendingCatalogSearch_ = false;
+      runSearch();
+    }
+  });
+  connect(platformCatalog_, &PlatformCatalogService::loadFailed, this, [this] {
+    // No catalog is coming; a search that waited for it asks the CLI.
+    if (pendingCatalogSearch_) {
+      pendingCatalogSearch_ = false;
+      runSearch();
+    }
+  });
+}
+
 void BoardsManagerDialog::refresh() {
+  if (platformCatalog_) {
+    platformCatalog_->refresh();
+  }
   updateIndexStatusLabel();
   if (shouldAutoUpdateIndexNow()) {
     runUpdateIndex(true);
@@ -736,10 +764,19 @@ void BoardsManagerDialog::wireSignals() {
         if (searchModel_) {
           searchModel_->removeRows(0, searchModel_->rowCount());
         }
+        searchFromCatalog_ = false;
         rebuildSearchFilters();
         applySearchFilters();
         return;
       }
+      // The catalog answers in memory, so there is nothing to debounce.
+      if (catalogReady()) {
+        if (searchDebounceTimer_) {
+          searchDebounceTimer_->stop();
+        }
+        runSearch();
+        return;
+      }
       if (searchDebounceTimer_) {
         searchDebounceTimer_->start();
       }
@@ -1037,12 +1074,31 @@ void BoardsManagerDialog::refreshInstalled() {
 }
 
 void BoardsManagerDialog::runSearch() {
+  const QString q = searchEdit_->text().trimmed();
+  if (catalogReady()) {
+    const std::shared_ptr<const PlatformCatalog> catalog = platformCatalog_->catalog();
+    QJsonArray platforms;
+    for (int id : catalog->search(q)) {
+      platforms.append(catalog->searchJson(id));
+    }
+    showSearchResults(platforms);
+    searchFromCatalog_ = true;
+    return;
+  }
+  if (platformCatalog_ && platformCatalog_->isLoading() &&
+      platformCatalog_->errorString().isEmpty()) {
+    // The catalog is being (re)loaded; search it once it is ready. After
+    // a failed load the retry likely fails the same way, which is not
+    // reported again, so the CLI is asked right away.
+    pendingCatalogSearch_ = true;
+    return;
+  }
+
   if (isBusy()) {
     pendingAutoSearch_ = true;
     return;
   }
 
-  const QString q = searchEdit_->text().trimmed();
   QStringList args = {QStringLiteral("core"), QStringLiteral("search")};
   if (!q.isEmpty()) {
     args << q;
@@ -1054,37 +1110,44 @@ void BoardsManagerDialog::runSearch() {
     if (!doc.isObject()) {
       return;
     }
-    const QJsonArray platforms = doc.object().value("platforms").toArray();
-
-    searchModel_->removeRows(0, searchModel_->rowCount());
-    for (const QJsonValue& v : platforms) {
-      const QJsonObject p = v.toObject();
-      const QString id = p.value("id").toString();
-      const QString installed = p.value("installed_version").toString();
-      const QString latest = p.value("latest_version").toString();
-      const QString name =
-          platformNameFromReleases(p, latest.isEmpty() ? installed : latest);
-      QStringList versions = sortVersions(p.value("releases").toObject().keys());
-
-      QList<QStandardItem*> row;
-      auto* idItem = new QStandardItem(id);
-      idItem->setData(versions, kRoleAvailableVersions);
-      idItem->setData(p, kRolePlatformJson);
-      row << idItem << new QStandardItem(installed)
-          << new QStandardItem(latest) << new QStandardItem(name);
-      searchModel_->appendRow(row);
-    }
+    showSearchResults(doc.object().value("platforms").toArray());
+    searchFromCatalog_ = false;
+  });
+}
 
-    rebuildSearchFilters();
-    applySearchFilters();
+bool BoardsManagerDialog::catalogReady() const {
+  return platformCatalog_ && platformCatalog_->catalog();
+}
 
-    if (searchView_) {
-      searchView_->resizeColumnsToContents();
-      if (searchView_->model() && searchView_->model()->rowCount() > 0) {
-        searchView_->setCurrentIndex(searchView_->model()->index(0, SColId));
-      }
+void BoardsManagerDialog::showSearchResults(const QJsonArray& platforms) {
+  searchModel_->removeRows(0, searchModel_->rowCount());
+  for (const QJsonValue& v : platforms) {
+    const QJsonObject p = v.toObject();
+    const QString id = p.value("id").toString();
+    const QString installed = p.value("installed_version").toString();
+    const QString latest = p.value("latest_version").toString();
+    const QString name =
+        platformNameFromReleases(p, latest.isEmpty() ? installed : latest);
+    QStringList versions = sortVersions(p.value("releases").toObject().keys());
+
+    QList<QStandardItem*> row;
+    auto* idItem = new QStandardItem(id);
+    idItem->setData(versions, kRoleAvailableVersions);
+    idItem->setData(p, kRolePlatformJson);
+    row << idItem << new QStandardItem(installed)
+        << new QStandardItem(latest) << new QStandardItem(name);
+    searchModel_->appendRow(row);
+  }
+
+  rebuildSearchFilters();
+  applySearchFilters();
+
+  if (searchView_) {
+    searchView_->resizeColumnsToContents();
+    if (searchView_->model() && searchView_->model()->rowCount() > 0) {
+      searchView_->setCurrentIndex(searchView_->model()->index(0, SColId));
     }
-  });
+  }
 }
 
 QString BoardsManagerDialog::selectedInstalledPlatformId() const {
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <functional>
+#include <QJsonArray>
 #include <QMap>
 #include <QWidget>
 
 class ArduinoCli;
 class OutputWidget;
+class PlatformCatalogService;
 
 class QLineEdit;
 class QComboBox;
@@ -30,6 +32,9 @@ class BoardsManagerDialog final : public QWidget {
                                QWidget* parent = nullptr);
 
   bool isBusy() const;
+  // Searches are answered from the shared catalog once it has loaded;
+  // `core search` is only used without one.
+  void setPlatformCatalog(PlatformCatalogService* catalog);
 
  public slots:
   void refresh();
@@ -87,6 +92,10 @@ class BoardsManagerDialog final : public QWidget {
   QTimer* searchDebounceTimer_ = nullptr;
   bool pendingAutoSearch_ = false;
 
+  PlatformCatalogService* platformCatalog_ = nullptr;
+  bool pendingCatalogSearch_ = false;
+  bool searchFromCatalog_ = false;  // the search rows came from the catalog
+
   QProcess* process_ = nullptr;
   QByteArray processOutput_;
   bool busy_ = false;
@@ -106,6 +115,8 @@ class BoardsManagerDialog final : public QWidget {
 
   void refreshInstalled();
   void runSearch();
+  bool catalogReady() const;
+  void showSearchResults(const QJsonArray& platforms);
 
   QString selectedInstalledPlatformId() const;
   QString selectedSearchPlatformId() const;
@@ -0,0 +1,395 @@
+#include "build_directory_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace {
+constexpr auto kMetaFileName = "meta.json";
+constexpr auto kBuildSubdirName = "build";
+// An evicted entry is renamed to this prefix first, then deleted.
+constexpr auto kEvictingPrefix = ".evicting-";
+
+// Guards meta.json updates and the in-use counts; eviction runs on a worker
+// thread while compiles start on the GUI thread.
+QMutex& registryMutex() {
+  static QMutex mutex;
+  return mutex;
+}
+
+// Absolute build path -> number of holders.
+QHash<QString, int>& inUseCounts() {
+  static QHash<QString, int> counts;
+  return counts;
+}
+
+QString resolveRoot(const QString& root) {
+  const QString trimmed = root.trimmed();
+  return QDir(trimmed.isEmpty() ? BuildDirectoryManager::defaultRoot() : trimmed)
+      .absolutePath();
+}
+
+QString normalizeSketchFolder(const QString& folder) {
+  if (folder.trimmed().isEmpty()) {
+    return {};
+  }
+  return QDir(folder).absolutePath();
+}
+
+QString sanitizedSketchName(const QString& sketchFolder) {
+  QString name = QFileInfo(sketchFolder).fileName();
+  static const QRegularExpression kUnsafe(QStringLiteral("[^A-Za-z0-9_.-]"));
+  name.replace(kUnsafe, QStringLiteral("_"));
+  if (name.isEmpty()) {
+    name = QStringLiteral("sketch");
+  }
+  return name.left(40);
+}
+
+QString metaPathForEntryDir(const QString& entryDir) {
+  return QDir(entryDir).filePath(QString::fromLatin1(kMetaFileName));
+}
+
+QString entryDirForBuildPath(const QString& buildPath) {
+  return QFileInfo(QDir(buildPath).absolutePath()).absolutePath();
+}
+
+qint64 directorySizeBytes(const QString& path) {
+  qint64 total = 0;
+  QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    total += it.fileInfo().size();
+  }
+  return total;
+}
+
+QJsonObject entryToJson(const BuildDirectoryManager::Entry& e) {
+  QJsonObject o;
+  o.insert(QStringLiteral("version"), BuildDirectoryManager::kMetaVersion);
+  o.insert(QStringLiteral("sketchFolder"), e.sketchFolder);
+  o.insert(QStringLiteral("fqbn"), e.fqbn);
+  o.insert(QStringLiteral("optimizeForDebug"), e.optimizeForDebug);
+  o.insert(QStringLiteral("lastUsedUtc"),
+           e.lastUsedUtc.toUTC().toString(Qt::ISODateWithMs));
+  o.insert(QStringLiteral("sizeBytes"), static_cast<double>(e.sizeBytes));
+  return o;
+}
+
+bool readEntry(const QString& entryDir, BuildDirectoryManager::Entry* out) {
+  QFile f(metaPathForEntryDir(entryDir));
+  if (!f.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  if (!doc.isObject()) {
+    return false;
+  }
+  const QJsonObject o = doc.object();
+  if (o.value(QStringLiteral("version")).toInt() !=
+      BuildDirectoryManager::kMetaVersion) {
+    return false;
+  }
+  out->id = QFileInfo(entryDir).fileName();
+  out->buildPath =
+      QDir(entryDir).filePath(QString::fromLatin1(kBuildSubdirName));
+  out->sketchFolder = o.value(QStringLiteral("sketchFolder")).toString();
+  out->fqbn = o.value(QStringLiteral("fqbn")).toString();
+  out->optimizeForDebug = o.value(QStringLiteral("optimizeForDebug")).toBool();
+  out->lastUsedUtc =
+      QDateTime::fromString(o.value(QStringLiteral("lastUsedUtc")).toString(),
+                            Qt::ISODateWithMs)
+          .toUTC();
+  out->sizeBytes =
+      static_cast<qint64>(o.value(QStringLiteral("sizeBytes")).toDouble());
+  return true;
+}
+
+bool writeEntry(const QString& entryDir,
+                const BuildDirectoryManager::Entry& entry,
+                QString* outError) {
+  QSaveFile f(metaPathForEntryDir(entryDir));
+  if (!f.open(QIODevice::WriteOnly)) {
+    if (outError) {
+      *outError = f.errorString();
+    }
+    return false;
+  }
+  f.write(QJsonDocument(entryToJson(entry)).toJson(QJsonDocument::Indented));
+  if (!f.commit()) {
+    if (outError) {
+      *outError = f.errorString();
+    }
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+QString BuildDirectoryManager::defaultRoot() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+      .filePath(QStringLiteral("builds"));
+}
+
+QString BuildDirectoryManager::normalizedFqbn(const QString& fqbn) {
+  const QStringList parts = fqbn.trimmed().split(':');
+  if (parts.size() <= 3) {
+    return fqbn.trimmed();
+  }
+
+  QStringList options;
+  for (const QString& option : parts.mid(3).join(':').split(',')) {
+    const QString trimmed = option.trimmed();
+    if (!trimmed.isEmpty()) {
+      options << trimmed;
+    }
+  }
+  std::sort(options.begin(), options.end());
+  const QString base = parts.mid(0, 3).join(':');
+  return options.isEmpty() ? base : base + QLatin1Char(':') + options.join(',');
+}
+
+QString BuildDirectoryManager::keyId(const Key& key) {
+  const QString sketch = normalizeSketchFolder(key.sketchFolder);
+  const QString fqbn = normalizedFqbn(key.fqbn);
+  if (sketch.isEmpty() || fqbn.isEmpty()) {
+    return {};
+  }
+  QByteArray material = sketch.toUtf8();
+  material.append('\n');
+  material.append(fqbn.toUtf8());
+  material.append('\n');
+  material.append(key.optimizeForDebug ? '1' : '0');
+  const QString hash = QString::fromLatin1(
+      QCryptographicHash::hash(material, QCryptographicHash::Sha1).toHex());
+  return sanitizedSketchName(sketch) + QLatin1Char('-') + hash.left(16);
+}
+
+QString BuildDirectoryManager::lookupBuildPath(const Key& key,
+                                               const QString& root) {
+  const QString id = keyId(key);
+  if (id.isEmpty()) {
+    return {};
+  }
+  return QDir(QDir(resolveRoot(root)).filePath(id))
+      .filePath(QString::fromLatin1(kBuildSubdirName));
+}
+
+QString BuildDirectoryManager::buildPathFor(const Key& key,
+                                            const QString& root,
+                                            QString* outError) {
+  return preparePath(key, root, false, outError);
+}
+
+QString BuildDirectoryManager::acquireBuildPath(const Key& key,
+                                                const QString& root,
+                                                QString* outError) {
+  return preparePath(key, root, true, outError);
+}
+
+void BuildDirectoryManager::releaseBuild(const QString& buildPath) {
+  const QString path = QDir(buildPath).absolutePath();
+  QMutexLocker lock(&registryMutex());
+  auto it = inUseCounts().find(path);
+  if (it != inUseCounts().end() && --*it <= 0) {
+    inUseCounts().erase(it);
+  }
+}
+
+QString BuildDirectoryManager::preparePath(const Key& key,
+                                           const QString& root,
+                                           bool acquire,
+                                           QString* outError) {
+  const QString id = keyId(key);
+  if (id.isEmpty()) {
+    if (outError) {
+      *outError = QStringLiteral("Missing sketch folder or FQBN.");
+    }
+    return {};
+  }
+
+  const QString entryDir = QDir(resolveRoot(root)).filePath(id);
+  const QString buildPath =
+      QDir(entryDir).filePath(QString::fromLatin1(kBuildSubdirName));
+  QMutexLocker lock(&registryMutex());
+  if (!QDir().mkpath(buildPath)) {
+    if (outError) {
+      *outError = QStringLiteral("Could not create build directory: %1").arg(buildPath);
+    }
+    return {};
+  }
+
+  Entry entry;
+  if (!readEntry(entryDir, &entry)) {
+    entry.sketchFolder = normalizeSketchFolder(key.sketchFolder);
+    entry.fqbn = normalizedFqbn(key.fqbn);
+    entry.optimizeForDebug = key.optimizeForDebug;
+  }
+  entry.lastUsedUtc = QDateTime::currentDateTimeUtc();
+  if (!writeEntry(entryDir, entry, outError)) {
+    return {};
+  }
+  if (acquire) {
+    ++inUseCounts()[QDir(buildPath).absolutePath()];
+  }
+  return buildPath;
+}
+
+void BuildDirectoryManager::recordBuildFinished(const QString& buildPath) {
+  if (buildPath.trimmed().isEmpty()) {
+    return;
+  }
+  const QString entryDir = entryDirForBuildPath(buildPath);
+  // The walk is the slow part; only the meta.json update is locked.
+  const qint64 sizeBytes = directorySizeBytes(QDir(buildPath).absolutePath());
+  QMutexLocker lock(&registryMutex());
+  Entry entry;
+  if (!readEntry(entryDir, &entry)) {
+    return;
+  }
+  entry.lastUsedUtc = QDateTime::currentDateTimeUtc();
+  entry.sizeBytes = sizeBytes;
+  (void)writeEntry(entryDir, entry, nullptr);
+}
+
+QVector<BuildDirectoryManager::Entry> BuildDirectoryManager::listEntries(
+    const QString& root) {
+  QVector<Entry> out;
+  const QDir rootDir(resolveRoot(root));
+  if (!rootDir.exists()) {
+    return out;
+  }
+  const QStringList dirs =
+      rootDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  out.reserve(dirs.size());
+  for (const QString& name : dirs) {
+    if (name.startsWith(QLatin1String(kEvictingPrefix))) {
+      continue;
+    }
+    Entry entry;
+    if (readEntry(rootDir.filePath(name), &entry)) {
+      out.push_back(std::move(entry));
+    }
+  }
+  return out;
+}
+
+qint64 BuildDirectoryManager::totalSizeBytes(const QString& root) {
+  qint64 total = 0;
+  for (const Entry& entry : listEntries(root)) {
+    total += entry.sizeBytes;
+  }
+  return total;
+}
+
+bool BuildDirectoryManager::cleanBuild(const Key& key,
+                                       const QString& root,
+                                       QString* outError) {
+  const QString id = keyId(key);
+  if (id.isEmpty()) {
+    if (outError) {
+      *outError = QStringLiteral("Missing sketch folder or FQBN.");
+    }
+    return false;
+  }
+  QDir entryDir(QDir(resolveRoot(root)).filePath(id));
+  if (!entryDir.exists()) {
+    return true;
+  }
+  if (!entryDir.removeRecursively()) {
+    if (outError) {
+      *outError =
+          QStringLiteral("Could not remove build directory: %1").arg(entryDir.path());
+    }
+    return false;
+  }
+  return true;
+}
+
+bool BuildDirectoryManager::cleanAll(const QString& root, QString* outError) {
+  bool ok = true;
+  for (const Entry& entry : listEntries(root)) {
+    QDir entryDir(entryDirForBuildPath(entry.buildPath));
+    if (!entryDir.removeRecursively()) {
+      ok = false;
+      if (outError) {
+        *outError =
+            QStringLiteral("Could not remove build directory: %1").arg(entryDir.path());
+      }
+    }
+  }
+  return ok;
+}
+
+int BuildDirectoryManager::evictToFit(qint64 maxTotalBytes,
+                                      const QString& root,
+                                      const QStringList& keepBuildPaths) {
+  const QDir rootDir(resolveRoot(root));
+  // Left behind by a pass that was interrupted while deleting.
+  const QStringList leftovers = rootDir.entryList(
+      {QString::fromLatin1(kEvictingPrefix) + QLatin1Char('*')},
+      QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+  for (const QString& name : leftovers) {
+    QDir(rootDir.filePath(name)).removeRecursively();
+  }
+
+  QVector<Entry> entries = listEntries(root);
+  qint64 total = 0;
+  for (const Entry& entry : entries) {
+    total += entry.sizeBytes;
+  }
+  if (total <= maxTotalBytes) {
+    return 0;
+  }
+
+  QSet<QString> keep;
+  for (const QString& path : keepBuildPaths) {
+    if (!path.trimmed().isEmpty()) {
+      keep.insert(QDir(path).absolutePath());
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.lastUsedUtc < b.lastUsedUtc;
+  });
+
+  int evicted = 0;
+  for (const Entry& entry : entries) {
+    if (total <= maxTotalBytes) {
+      break;
+    }
+    const QString buildPath = QDir(entry.buildPath).absolutePath();
+    if (keep.contains(buildPath)) {
+      continue;
+    }
+    // Checked and moved aside in one step, so a compile that acquires the
+    // path afterwards gets a fresh directory instead of a half-deleted one.
+    const QString doomed = rootDir.filePath(QString::fromLatin1(kEvictingPrefix) + entry.id);
+    {
+      QMutexLocker lock(&registryMutex());
+      if (inUseCounts().contains(buildPath) ||
+          !QDir().rename(entryDirForBuildPath(entry.buildPath), doomed)) {
+        continue;
+      }
+    }
+    QDir(doomed).removeRecursively();
+    total -= entry.sizeBytes;
+    ++evicted;
+  }
+  return evicted;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Hands out one stable arduino-cli `--build-path` per (sketch, FQBN, board
+// options, optimize-for-debug) combination so switching between boards or
+// sketches keeps previously compiled core/library objects around. Directories
+// live under a shared cache root and are evicted least-recently-used first
+// once the cache grows past a size cap. Eviction may run on a worker thread
+// while compiles start on the GUI thread; a compile holds its directory with
+// acquireBuildPath() so eviction leaves it alone until releaseBuild().
+class BuildDirectoryManager final {
+ public:
+  static constexpr int kMetaVersion = 1;
+  static constexpr qint64 kDefaultMaxTotalBytes = 4LL * 1024 * 1024 * 1024;
+
+  struct Key final {
+    QString sketchFolder;
+    QString fqbn;  // may carry board options: vendor:arch:board:opt=val,...
+    bool optimizeForDebug = false;
+  };
+
+  struct Entry final {
+    QString id;
+    QString buildPath;
+    QString sketchFolder;
+    QString fqbn;
+    bool optimizeForDebug = false;
+    QDateTime lastUsedUtc;
+    qint64 sizeBytes = 0;
+  };
+
+  static QString defaultRoot();
+
+  // Sorts board options so `a=1,b=2` and `b=2,a=1` map to the same build.
+  static QString normalizedFqbn(const QString& fqbn);
+  static QString keyId(const Key& key);
+
+  // Path the build directory for `key` would use; does not touch the disk.
+  static QString lookupBuildPath(const Key& key, const QString& root = {});
+  // Returns (and creates) the build directory for `key`, marking it as used.
+  static QString buildPathFor(const Key& key,
+                              const QString& root = {},
+                              QString* outError = nullptr);
+  // Like buildPathFor(), and marks the directory in use, in the same step,
+  // until a matching releaseBuild().
+  static QString acquireBuildPath(const Key& key,
+                                  const QString& root = {},
+                                  QString* outError = nullptr);
+  static void releaseBuild(const QString& buildPath);
+  // Refreshes the recorded size/last-used time after a compile finished.
+  static void recordBuildFinished(const QString& buildPath);
+
+  static QVector<Entry> listEntries(const QString& root = {});
+  static qint64 totalSizeBytes(const QString& root = {});
+
+  static bool cleanBuild(const Key& key,
+                         const QString& root = {},
+                         QString* outError = nullptr);
+  static bool cleanAll(const QString& root = {}, QString* outError = nullptr);
+
+  // Removes least-recently-used build directories until the cache fits in
+  // `maxTotalBytes`. Paths in `keepBuildPaths` and acquired ones are never
+  // evicted. Returns the number of evicted directories.
+  static int evictToFit(qint64 maxTotalBytes,
+                        const QString& root = {},
+                        const QStringList& keepBuildPaths = {});
+
+ private:
+  static QString preparePath(const Key& key,
+                             const QString& root,
+                             bool acquire,
+                             QString* outError);
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QTextBlockUserData>
+#include <QVector>
+
+#include "cpp_lexer.h"
+
+// What CodeEditor keeps in each block's user data. The editor lexes a line
+// when it changes, for brace folding; CppHighlighter formats from the same
+// tokens while they are current, so an edit lexes each line once.
+struct CodeBlockData final : public QTextBlockUserData {
+  static constexpr int kMagic = 0x56424C4B;  // 'VBLK'
+  int magic = kMagic;
+  bool folded = false;
+  // CppLexer pass over the line, valid while the block's revision is
+  // still `revision`. Brace balance is outside comments, strings and
+  // directives: the line first closes `closes` unmatched '}', then leaves
+  // `opens` '{' open.
+  bool summarized = false;
+  int revision = -1;
+  int startLexState = 0;  // state the line was lexed from
+  int lexState = 0;       // and the one it ends in
+  int closes = 0;
+  int opens = 0;
+  QVector<CppLexer::Token> tokens;
+  // Leading whitespace, measured when the line changes.
+  bool indentMeasured = false;
+  bool blank = false;  // whitespace only
+  int indentSpaces = 0;
+  int indentTabs = 0;
+};
@@ -4,6 +4,7 @@
 #include <QAbstractTextDocumentLayout>
 #include <QColor>
 #include <QKeyEvent>
+#include <QMap>
 #include <QMouseEvent>
 #include <QPaintEvent>
 #include <QPainter>
@@ -13,7 +14,6 @@
 #include <QTextCharFormat>
 #include <QTextCursor>
 #include <QTextOption>
-#include <QTimer>
 
 namespace {
 constexpr int kBreakpointGutterWidth = 16;
@@ -300,12 +300,6 @@ class CodeEditor::LineNumberArea final : public QWidget {
 
 CodeEditor::CodeEditor(QWidget* parent) : QPlainTextEdit(parent) {
   lineNumberArea_ = new LineNumberArea(this);
-  foldRecomputeTimer_ = new QTimer(this);
-  foldRecomputeTimer_->setSingleShot(true);
-  foldRecomputeTimer_->setInterval(200);
-  connect(foldRecomputeTimer_, &QTimer::timeout, this,
-          [this] { recomputeFoldRegions(); });
-
   connect(this, &QPlainTextEdit::blockCountChanged, this,
           [this](int newBlockCount) { updateLineNumberAreaWidth(newBlockCount); });
   connect(this, &QPlainTextEdit::updateRequest, this,
@@ -316,28 +310,17 @@ CodeEditor::CodeEditor(QWidget* parent) : QPlainTextEdit(parent) {
           [this] { updateCurrentLineHighlight(); });
   connect(this, &QPlainTextEdit::textChanged, this,
           [this] { updateBracketMatch(); });
-  connect(this, &QPlainTextEdit::textChanged, this,
-          [this] {
-            if (!foldingEnabled_) {
-              return;
-            }
-            if (!foldRecomputeTimer_ || !document()) {
-              recomputeFoldRegions();
-              return;
-            }
-            constexpr int kImmediateFoldRecomputeMaxBlocks = 2000;
-            if (document()->blockCount() <= kImmediateFoldRecomputeMaxBlocks) {
-              recomputeFoldRegions();
-              return;
-            }
-            foldRecomputeTimer_->start();
-          });
   if (auto* doc = document()) {
     connect(doc, &QTextDocument::contentsChange, this,
             [this](int pos, int charsRemoved, int charsAdded) {
+              updateBraceSummaries(pos, charsRemoved, charsAdded);
+              updateIndentMetrics(pos, charsAdded);
               updateSnippetRanges(pos, charsRemoved, charsAdded);
+              updateActiveIndentGuide();
             });
   }
+  connect(this, &QPlainTextEdit::cursorPositionChanged, this,
+          [this] { updateActiveIndentGuide(); });
   connect(this, &QPlainTextEdit::cursorPositionChanged, this, [this] {
     if (!snippetActive_ || snippetSettingCursor_ || snippetNav_.isEmpty()) {
       return;
@@ -352,7 +335,7 @@ CodeEditor::CodeEditor(QWidget* parent) : QPlainTextEdit(parent) {
   });
 
   setEditorSettings(tabSize_, insertSpaces_);
-  recomputeFoldRegions();
+  resetBraceSummaries();
   updateLineNumberAreaWidth(blockCount());
   lineNumberArea_->show();
 }
@@ -361,6 +344,7 @@ void CodeEditor::setEditorSettings(int tabSize, bool insertSpaces) {
   tabSize_ = clampTabSize(tabSize);
   insertSpaces_ = insertSpaces;
   setTabStopDistance(tabSize_ * fontMetrics().horizontalAdvance(QLatin1Char(' ')));
+  updateActiveIndentGuide();
 }
 
 int CodeEditor::tabSize() const {
@@ -376,6 +360,7 @@ void CodeEditor::setShowIndentGuides(bool enabled) {
     return;
   }
   showIndentGuides_ = enabled;
+  updateActiveIndentGuide();
   viewport()->update();
 }
 
@@ -383,6 +368,18 @@ bool CodeEditor::showIndentGuides() const {
   return showIndentGuides_;
 }
 
+int CodeEditor::activeIndentGuideLevel() const {
+  return activeIndentGuide_.level;
+}
+
+int CodeEditor::activeIndentGuideFirstLine() const {
+  return activeIndentGuide_.firstBlock + 1;
+}
+
+int CodeEditor::activeIndentGuideLastLine() const {
+  return activeIndentGuide_.lastBlock + 1;
+}
+
 void CodeEditor::setShowWhitespace(bool enabled) {
   if (showWhitespace_ == enabled) {
     return;
@@ -709,7 +706,7 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent* event) {
                            kFoldIndicatorWidth - 3,
                        fontMetrics().height(), Qt::AlignRight, number);
 
-      const int endBlockNumber = foldEndByStartBlock_.value(blockNumber, -1);
+      const int endBlockNumber = foldEndBlock(blockNumber);
       if (endBlockNumber > blockNumber) {
         const bool folded = blockIsFolded(block);
 
@@ -961,12 +958,7 @@ bool CodeEditor::canFold(int line) const {
   if (line < 1 || !document()) {
     return false;
   }
-  const int startBlock = line - 1;
-  const auto it = foldEndByStartBlock_.find(startBlock);
-  if (it == foldEndByStartBlock_.end()) {
-    return false;
-  }
-  return it.value() > startBlock;
+  return foldEndBlock(line - 1) > line - 1;
 }
 
 bool CodeEditor::isFolded(int line) const {
@@ -991,11 +983,7 @@ void CodeEditor::toggleFold(int line) {
     return;
   }
   const int startBlockNumber = line - 1;
-  const auto it = foldEndByStartBlock_.find(startBlockNumber);
-  if (it == foldEndByStartBlock_.end()) {
-    return;
-  }
-  const int endBlockNumber = it.value();
+  const int endBlockNumber = foldEndBlock(startBlockNumber);
   if (endBlockNumber <= startBlockNumber) {
     return;
   }
@@ -1005,7 +993,7 @@ void CodeEditor::toggleFold(int line) {
     return;
   }
 
-  FoldBlockUserData* data = foldUserDataFor(startBlock, true);
+  CodeBlockData* data = foldUserDataFor(startBlock, true);
   const bool willFold = !data->folded;
   data->folded = willFold;
 
@@ -1027,7 +1015,7 @@ void CodeEditor::unfoldAllFolds() {
   }
   QTextBlock block = document()->firstBlock();
   while (block.isValid()) {
-    if (FoldBlockUserData* data = foldUserDataFor(block, false)) {
+    if (CodeBlockData* data = foldUserDataFor(block, false)) {
       data->folded = false;
     }
     block = block.next();
@@ -1040,20 +1028,19 @@ void CodeEditor::setFoldingEnabled(bool enabled) {
     return;
   }
   foldingEnabled_ = enabled;
-  if (foldRecomputeTimer_) {
-    foldRecomputeTimer_->stop();
-  }
 
   if (!foldingEnabled_) {
     unfoldAllFolds();
-    foldEndByStartBlock_.clear();
+    braceTree_.clear();
+    braceTreeSize_ = 1;
+    braceLeafCount_ = 0;
     if (lineNumberArea_) {
       lineNumberArea_->update();
     }
     return;
   }
 
-  recomputeFoldRegions();
+  resetBraceSummaries();
 }
 
 bool CodeEditor::foldingEnabled() const {
@@ -1418,9 +1405,12 @@ void CodeEditor::paintEvent(QPaintEvent* event) {
   color.setAlpha(90);
   QPen pen(color);
   pen.setStyle(Qt::DotLine);
-  painter.setPen(pen);
+  QColor activeColor = palette().text().color();
+  activeColor.setAlpha(110);
+  const QPen activePen(activeColor);
 
   QTextBlock block = firstVisibleBlock();
+  int blockNumber = block.blockNumber();
   int top =
       static_cast<int>(blockBoundingGeometry(block).translated(contentOffset()).top());
   int bottom = top + static_cast<int>(blockBoundingRect(block).height());
@@ -1429,26 +1419,16 @@ void CodeEditor::paintEvent(QPaintEvent* event) {
 
   while (block.isValid() && top <= clip.bottom()) {
     if (block.isVisible() && bottom >= clip.top()) {
-      const QString text = block.text();
-      int columns = 0;
-      for (const QChar ch : text) {
-        if (ch == QLatin1Char('\t')) {
-          columns += tabSize_;
-          continue;
-        }
-        if (ch == QLatin1Char(' ')) {
-          ++columns;
-          continue;
-        }
-        break;
-      }
-
-      const int levels = columns / tabSize_;
+      const int levels = indentColumns(block) / tabSize_;
+      const bool inActiveScope = blockNumber >= activeIndentGuide_.firstBlock &&
+                                 blockNumber <= activeIndentGuide_.lastBlock;
       for (int level = 1; level <= levels; ++level) {
         const int x = static_cast<int>(contentOffset().x() + (level * tabW));
         if (x < clip.left() || x > clip.right()) {
           continue;
         }
+        painter.setPen(inActiveScope && level == activeIndentGuide_.level ? activePen
+                                                                          : pen);
         painter.drawLine(x, top, x, bottom);
       }
     }
@@ -1456,6 +1436,7 @@ void CodeEditor::paintEvent(QPaintEvent* event) {
     block = block.next();
     top = bottom;
     bottom = top + static_cast<int>(blockBoundingRect(block).height());
+    ++blockNumber;
   }
 }
 
@@ -1617,15 +1598,15 @@ void CodeEditor::updateCurrentLineHighlight() {
   setExtraSelections(selections);
 }
 
-CodeEditor::FoldBlockUserData* CodeEditor::foldUserDataFor(const QTextBlock& block,
-                                                          bool create) const {
+CodeBlockData* CodeEditor::foldUserDataFor(const QTextBlock& block,
+                                           bool create) const {
   if (!block.isValid()) {
     return nullptr;
   }
 
   if (auto* raw = block.userData()) {
-    if (auto* d = dynamic_cast<FoldBlockUserData*>(raw)) {
-      if (d->magic == FoldBlockUserData::kMagic) {
+    if (auto* d = dynamic_cast<CodeBlockData*>(raw)) {
+      if (d->magic == CodeBlockData::kMagic) {
         return d;
       }
     }
@@ -1635,18 +1616,64 @@ CodeEditor::FoldBlockUserData* CodeEditor::foldUserDataFor(const QTextBlock& blo
     return nullptr;
   }
 
-  auto* d = new FoldBlockUserData();
+  auto* d = new CodeBlockData();
   const_cast<QTextBlock&>(block).setUserData(d);
   return d;
 }
 
 bool CodeEditor::blockIsFolded(const QTextBlock& block) const {
-  FoldBlockUserData* d = foldUserDataFor(block, false);
+  CodeBlockData* d = foldUserDataFor(block, false);
   return d && d->folded;
 }
 
-void CodeEditor::recomputeFoldRegions() {
-  foldEndByStartBlock_.clear();
+CodeEditor::BraceSummary CodeEditor::combineBraces(const BraceSummary& a,
+                                                  const BraceSummary& b) {
+  const int matched = std::min(a.opens, b.closes);
+  return {a.closes + b.closes - matched, a.opens + b.opens - matched};
+}
+
+void CodeEditor::summarizeBlock(const QTextBlock& block, int previousLexState,
+                                CodeBlockData* data) {
+  const QString text = block.text();
+  QVector<CppLexer::Token>* tokens = &data->tokens;
+  tokens->clear();
+  data->revision = block.revision();
+  data->startLexState = previousLexState;
+  data->lexState = CppLexer::lexLine(text, previousLexState, tokens);
+  data->closes = 0;
+  data->opens = 0;
+  data->summarized = true;
+
+  // Tokens come in source order; a Preprocessor token may be followed by
+  // the comments and strings inside it, so track the furthest exclusion.
+  int excludedUntil = 0;
+  int nextToken = 0;
+  for (int i = 0; i < text.size(); ++i) {
+    while (nextToken < tokens->size() && tokens->at(nextToken).start <= i) {
+      const CppLexer::Token& token = tokens->at(nextToken++);
+      if (token.kind == CppLexer::TokenKind::Comment ||
+          token.kind == CppLexer::TokenKind::String ||
+          token.kind == CppLexer::TokenKind::Preprocessor) {
+        excludedUntil = std::max(excludedUntil, token.start + token.length);
+      }
+    }
+    if (i < excludedUntil) {
+      continue;
+    }
+    const QChar c = text.at(i);
+    if (c == QLatin1Char('{')) {
+      ++data->opens;
+    } else if (c == QLatin1Char('}')) {
+      if (data->opens > 0) {
+        --data->opens;
+      } else {
+        ++data->closes;
+      }
+    }
+  }
+}
+
+void CodeEditor::resetBraceSummaries() {
   if (!document() || !foldingEnabled_) {
     if (lineNumberArea_) {
       lineNumberArea_->update();
@@ -1654,47 +1681,307 @@ void CodeEditor::recomputeFoldRegions() {
     return;
   }
 
-  bool hasAnyFolded = false;
-  QVector<int> stack;
-  stack.reserve(128);
+  // Lexer state lives in the block user data rather than the block state,
+  // which breakpoint markers already use.
+  QVector<BraceSummary> leaves;
+  leaves.reserve(document()->blockCount());
+  int lexState = CppLexer::kStateNormal;
+  foldedCount_ = 0;
+  for (QTextBlock block = document()->firstBlock(); block.isValid();
+       block = block.next()) {
+    CodeBlockData* data = foldUserDataFor(block, true);
+    summarizeBlock(block, lexState, data);
+    lexState = data->lexState;
+    leaves.push_back({data->closes, data->opens});
+    if (data->folded) {
+      ++foldedCount_;
+    }
+  }
+  rebuildBraceTree(leaves);
 
-  QTextBlock block = document()->firstBlock();
-  while (block.isValid()) {
-    if (!hasAnyFolded) {
-      if (FoldBlockUserData* data = foldUserDataFor(block, false)) {
-        hasAnyFolded = data->folded;
-      }
+  if (lineNumberArea_) {
+    lineNumberArea_->update();
+  }
+  if (foldedCount_ > 0) {
+    applyFoldStates();
+  }
+}
+
+void CodeEditor::updateBraceSummaries(int pos, int charsRemoved, int charsAdded) {
+  Q_UNUSED(charsRemoved);
+  QTextDocument* doc = document();
+  if (!doc || !foldingEnabled_) {
+    return;
+  }
+  if (braceLeafCount_ == 0) {
+    resetBraceSummaries();
+    return;
+  }
+
+  QTextBlock block = doc->findBlock(pos);
+  if (!block.isValid()) {
+    block = doc->lastBlock();
+  }
+  const int firstBlockNumber = block.blockNumber();
+  QTextBlock lastEdited = doc->findBlock(pos + charsAdded);
+  if (!lastEdited.isValid()) {
+    lastEdited = doc->lastBlock();
+  }
+  const int lastBlockNumber = lastEdited.blockNumber();
+
+  // Blocks inserted or removed by the change sit right after its first
+  // block; move the leaves that follow along.
+  const int blockDelta = doc->blockCount() - braceLeafCount_;
+  if (blockDelta != 0) {
+    QVector<BraceSummary> leaves =
+        braceTree_.mid(braceTreeSize_, braceLeafCount_);
+    if (blockDelta > 0) {
+      leaves.insert(firstBlockNumber + 1, blockDelta, BraceSummary{});
+    } else {
+      leaves.remove(firstBlockNumber + 1, -blockDelta);
     }
+    rebuildBraceTree(leaves);
+  }
 
-    const int blockNo = block.blockNumber();
-    const QString text = block.text();
-    for (const QChar c : text) {
-      if (c == QLatin1Char('{')) {
-        stack.push_back(blockNo);
-        continue;
-      }
-      if (c == QLatin1Char('}')) {
-        if (stack.isEmpty()) {
-          continue;
-        }
-        const int start = stack.takeLast();
-        if (blockNo > start) {
-          foldEndByStartBlock_[start] = blockNo;
-        }
-      }
+  int lexState = CppLexer::kStateNormal;
+  if (const CodeBlockData* previous =
+          foldUserDataFor(block.previous(), false)) {
+    lexState = previous->lexState;
+  }
+  bool changed = blockDelta != 0;
+  for (int blockNumber = firstBlockNumber; block.isValid();
+       block = block.next(), ++blockNumber) {
+    CodeBlockData* data = foldUserDataFor(block, true);
+    // Past the change, a block lexed from the same state is up to date, and
+    // so is everything after it.
+    if (blockNumber > lastBlockNumber && data->summarized &&
+        data->startLexState == lexState) {
+      break;
+    }
+    const bool wasSummarized = data->summarized;
+    const BraceSummary old{data->closes, data->opens};
+    summarizeBlock(block, lexState, data);
+    lexState = data->lexState;
+    // Leaves of a spliced range may hold another block's summary.
+    if (blockDelta != 0 || !wasSummarized || old.closes != data->closes ||
+        old.opens != data->opens) {
+      setBraceLeaf(blockNumber, {data->closes, data->opens});
+      changed = true;
     }
-    block = block.next();
   }
 
+  if (!changed) {
+    return;
+  }
   if (lineNumberArea_) {
     lineNumberArea_->update();
   }
-
-  if (hasAnyFolded) {
+  if (foldedCount_ > 0) {
     applyFoldStates();
   }
 }
 
+void CodeEditor::rebuildBraceTree(const QVector<BraceSummary>& leaves) {
+  braceLeafCount_ = static_cast<int>(leaves.size());
+  braceTreeSize_ = 1;
+  while (braceTreeSize_ < braceLeafCount_) {
+    braceTreeSize_ <<= 1;
+  }
+  braceTree_.fill(BraceSummary{}, 2 * braceTreeSize_);
+  std::copy(leaves.cbegin(), leaves.cend(), braceTree_.begin() + braceTreeSize_);
+  for (int node = braceTreeSize_ - 1; node > 0; --node) {
+    braceTree_[node] =
+        combineBraces(braceTree_[2 * node], braceTree_[2 * node + 1]);
+  }
+}
+
+void CodeEditor::setBraceLeaf(int blockNumber, const BraceSummary& summary) {
+  if (blockNumber < 0 || blockNumber >= braceLeafCount_) {
+    return;
+  }
+  int node = braceTreeSize_ + blockNumber;
+  braceTree_[node] = summary;
+  for (node /= 2; node > 0; node /= 2) {
+    braceTree_[node] =
+        combineBraces(braceTree_[2 * node], braceTree_[2 * node + 1]);
+  }
+}
+
+int CodeEditor::firstBlockClosing(int fromBlockNumber, int count,
+                                  BraceSummary* sum) const {
+  *sum = BraceSummary{};
+  int node = braceTreeSize_ + fromBlockNumber;
+  do {
+    while (node % 2 == 0) {
+      node /= 2;
+    }
+    const BraceSummary next = combineBraces(*sum, braceTree_[node]);
+    if (next.closes >= count) {
+      while (node < braceTreeSize_) {
+        node *= 2;
+        const BraceSummary left = combineBraces(*sum, braceTree_[node]);
+        if (left.closes < count) {
+          *sum = left;
+          ++node;
+        }
+      }
+      const int block = node - braceTreeSize_;
+      return block < braceLeafCount_ ? block : -1;
+    }
+    *sum = next;
+    ++node;
+  } while ((node & -node) != node);
+  return -1;
+}
+
+int CodeEditor::foldEndBlock(int startBlockNumber) const {
+  if (!foldingEnabled_ || startBlockNumber < 0 ||
+      startBlockNumber + 1 >= braceLeafCount_) {
+    return -1;
+  }
+  const int opens = braceTree_[braceTreeSize_ + startBlockNumber].opens;
+  if (opens == 0) {
+    return -1;
+  }
+
+  // The fold ends where the last of the braces the start line leaves open
+  // is closed.
+  BraceSummary rest;
+  const int end = firstBlockClosing(startBlockNumber + 1, opens, &rest);
+  if (end >= 0 || rest.closes == 0) {
+    return end;
+  }
+  return firstBlockClosing(startBlockNumber + 1, rest.closes, &rest);
+}
+
+void CodeEditor::measureIndent(const QString& text, CodeBlockData* data) {
+  data->indentSpaces = 0;
+  data->indentTabs = 0;
+  data->blank = true;
+  for (const QChar ch : text) {
+    if (ch == QLatin1Char('\t')) {
+      ++data->indentTabs;
+      continue;
+    }
+    if (ch == QLatin1Char(' ')) {
+      ++data->indentSpaces;
+      continue;
+    }
+    data->blank = false;
+    break;
+  }
+  data->indentMeasured = true;
+}
+
+void CodeEditor::updateIndentMetrics(int pos, int charsAdded) {
+  QTextDocument* doc = document();
+  if (!doc) {
+    return;
+  }
+  QTextBlock block = doc->findBlock(pos);
+  const QTextBlock last = doc->findBlock(pos + charsAdded);
+  const int lastBlockNumber = last.isValid() ? last.blockNumber() : doc->blockCount() - 1;
+  for (; block.isValid() && block.blockNumber() <= lastBlockNumber; block = block.next()) {
+    measureIndent(block.text(), foldUserDataFor(block, true));
+  }
+}
+
+int CodeEditor::indentColumns(const QTextBlock& block) const {
+  CodeBlockData* data = foldUserDataFor(block, true);
+  if (!data) {
+    return 0;
+  }
+  if (!data->indentMeasured) {
+    measureIndent(block.text(), data);
+  }
+  return data->indentSpaces + (data->indentTabs * tabSize_);
+}
+
+int CodeEditor::indentLevel(const QTextBlock& block) const {
+  const int columns = indentColumns(block);
+  const CodeBlockData* data = foldUserDataFor(block, false);
+  if (!data || data->blank) {
+    return -1;
+  }
+  return columns / tabSize_;
+}
+
+CodeEditor::IndentGuide CodeEditor::indentGuideAround(const QTextBlock& block) const {
+  // Scopes are only followed this far each way, so a keystroke in a huge
+  // top-level block stays cheap.
+  constexpr int kMaxScopeBlocks = 2000;
+
+  const auto nextNonBlank = [this](QTextBlock b, int* level) {
+    for (int n = 0; b.isValid() && n < kMaxScopeBlocks; b = b.next(), ++n) {
+      *level = indentLevel(b);
+      if (*level >= 0) {
+        return b;
+      }
+    }
+    *level = -1;
+    return QTextBlock();
+  };
+
+  int level = indentLevel(block);
+  QTextBlock start = block;
+  if (level < 0) {
+    start = nextNonBlank(block, &level);
+  }
+  if (!start.isValid()) {
+    return {};
+  }
+
+  // A line that opens a deeper block (e.g. "if (x) {") highlights the
+  // block's guide rather than its own.
+  int nextLevel = -1;
+  const QTextBlock next = nextNonBlank(start.next(), &nextLevel);
+  if (next.isValid() && nextLevel > level) {
+    start = next;
+    level = nextLevel;
+  }
+  if (level <= 0) {
+    return {};
+  }
+
+  IndentGuide guide;
+  guide.level = level;
+  guide.firstBlock = start.blockNumber();
+  guide.lastBlock = guide.firstBlock;
+  QTextBlock b = start.previous();
+  for (int n = 0; b.isValid() && n < kMaxScopeBlocks; b = b.previous(), ++n) {
+    const int l = indentLevel(b);
+    if (l >= 0 && l < level) {
+      break;
+    }
+    if (l >= 0) {
+      guide.firstBlock = b.blockNumber();
+    }
+  }
+  b = start.next();
+  for (int n = 0; b.isValid() && n < kMaxScopeBlocks; b = b.next(), ++n) {
+    const int l = indentLevel(b);
+    if (l >= 0 && l < level) {
+      break;
+    }
+    if (l >= 0) {
+      guide.lastBlock = b.blockNumber();
+    }
+  }
+  return guide;
+}
+
+void CodeEditor::updateActiveIndentGuide() {
+  IndentGuide guide;
+  if (showIndentGuides_ && document()) {
+    guide = indentGuideAround(textCursor().block());
+  }
+  if (guide == activeIndentGuide_) {
+    return;
+  }
+  activeIndentGuide_ = guide;
+  viewport()->update();
+}
+
 void CodeEditor::applyFoldStates() {
   if (!document()) {
     return;
@@ -1715,23 +2002,24 @@ void CodeEditor::applyFoldStates() {
   }
 
   // Then apply folds in document order.
+  foldedCount_ = 0;
   block = document()->firstBlock();
   while (block.isValid()) {
-    FoldBlockUserData* data = foldUserDataFor(block, false);
+    CodeBlockData* data = foldUserDataFor(block, false);
     if (!data || !data->folded) {
       block = block.next();
       continue;
     }
 
     const int startNo = block.blockNumber();
-    const auto it = foldEndByStartBlock_.find(startNo);
-    if (it == foldEndByStartBlock_.end() || it.value() <= startNo) {
+    const int endNo = foldEndBlock(startNo);
+    if (endNo <= startNo) {
       data->folded = false;
       block = block.next();
       continue;
     }
+    ++foldedCount_;
 
-    const int endNo = it.value();
     QTextBlock b = block.next();
     while (b.isValid() && b.blockNumber() <= endNo) {
       b.setVisible(false);
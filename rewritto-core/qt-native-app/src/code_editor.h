@@ -1,13 +1,13 @@
 #pragma once
 
 #include <QPlainTextEdit>
-#include <QMap>
 #include <QTextBlock>
 #include <QTextCursor>
 #include <QTextFormat>
 #include <QVector>
 
-class QTimer;
+#include "code_block_data.h"
+#include "cpp_lexer.h"
 
 class CodeEditor final : public QPlainTextEdit {
   Q_OBJECT
@@ -31,6 +31,11 @@ class CodeEditor final : public QPlainTextEdit {
   bool showIndentGuides() const;
   void setShowWhitespace(bool enabled);
   bool showWhitespace() const;
+  // The guide drawn highlighted for the scope around the cursor: its level
+  // (0 for none) and the lines it runs along.
+  int activeIndentGuideLevel() const;
+  int activeIndentGuideFirstLine() const;  // 1-based
+  int activeIndentGuideLastLine() const;   // 1-based
 
   void setDiagnostics(const QVector<Diagnostic>& diagnostics);
   void clearDiagnostics();
@@ -85,7 +90,6 @@ class CodeEditor final : public QPlainTextEdit {
  private:
   class LineNumberArea;
   LineNumberArea* lineNumberArea_ = nullptr;
-  QTimer* foldRecomputeTimer_ = nullptr;
   int tabSize_ = 2;
   bool insertSpaces_ = true;
   bool showIndentGuides_ = true;
@@ -98,10 +102,19 @@ class CodeEditor final : public QPlainTextEdit {
   static constexpr int kExtraPropertyRole = QTextFormat::UserProperty + 1;
   static constexpr int kFoldIndicatorWidth = 14;
 
-  struct FoldBlockUserData final : public QTextBlockUserData {
-    static constexpr int kMagic = 0x56424C4B;  // 'VBLK'
-    int magic = kMagic;
-    bool folded = false;
+  struct IndentGuide final {
+    int level = 0;
+    int firstBlock = -1;
+    int lastBlock = -1;
+
+    friend bool operator==(const IndentGuide&, const IndentGuide&) = default;
+  };
+  IndentGuide activeIndentGuide_;
+
+  // Combinable brace balance of a run of lines.
+  struct BraceSummary final {
+    int closes = 0;
+    int opens = 0;
   };
 
   struct SnippetPlaceholder final {
@@ -130,14 +143,40 @@ class CodeEditor final : public QPlainTextEdit {
   QVector<CursorInfo> additionalCursors_;
   bool multiCursorEditing_ = false;
 
-  QMap<int, int> foldEndByStartBlock_;
+  // Segment tree over the blocks' brace summaries: leaves at
+  // [braceTreeSize_, braceTreeSize_ + braceLeafCount_), combined upwards.
+  QVector<BraceSummary> braceTree_;
+  int braceTreeSize_ = 1;
+  int braceLeafCount_ = 0;
+  int foldedCount_ = 0;
   QVector<Diagnostic> diagnostics_;
 
   void updateBracketMatch();
   void updateCurrentLineHighlight();
-  void recomputeFoldRegions();
+  static BraceSummary combineBraces(const BraceSummary& a, const BraceSummary& b);
+  static void summarizeBlock(const QTextBlock& block, int previousLexState,
+                             CodeBlockData* data);
+  // Summarizes every block again and rebuilds the tree.
+  void resetBraceSummaries();
+  // Re-lexes the blocks touched by a contents change, then the following
+  // ones while their carried lexer state changed, and updates the tree.
+  void updateBraceSummaries(int pos, int charsRemoved, int charsAdded);
+  void rebuildBraceTree(const QVector<BraceSummary>& leaves);
+  void setBraceLeaf(int blockNumber, const BraceSummary& summary);
+  // First block from `fromBlockNumber` on by which `count` braces opened
+  // before it are closed, or -1 with `sum` covering every block from there.
+  int firstBlockClosing(int fromBlockNumber, int count, BraceSummary* sum) const;
+  // Last block of the fold starting at `startBlockNumber`, or -1.
+  int foldEndBlock(int startBlockNumber) const;
   void applyFoldStates();
-  FoldBlockUserData* foldUserDataFor(const QTextBlock& block, bool create) const;
+  static void measureIndent(const QString& text, CodeBlockData* data);
+  void updateIndentMetrics(int pos, int charsAdded);
+  // Indent level of `block`, or -1 for a blank line.
+  int indentLevel(const QTextBlock& block) const;
+  int indentColumns(const QTextBlock& block) const;
+  IndentGuide indentGuideAround(const QTextBlock& block) const;
+  void updateActiveIndentGuide();
+  CodeBlockData* foldUserDataFor(const QTextBlock& block, bool create) const;
   bool blockIsFolded(const QTextBlock& block) const;
 
   bool advanceSnippet(bool forward);
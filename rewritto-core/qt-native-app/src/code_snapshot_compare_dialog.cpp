@@ -8,7 +8,6 @@
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QDir>
-#include <QFile>
 #include <QFontDatabase>
 #include <QHeaderView>
 #include <QHBoxLayout>
@@ -27,6 +26,8 @@
 #include <QVariant>
 #include <QVBoxLayout>
 
+#include "text_diff.h"
+
 namespace {
 const QString kCurrentSourceId = QStringLiteral("__current__");
 
@@ -83,109 +84,26 @@ QString snapshotDisplayLabel(const CodeSnapshotStore::SnapshotMeta& meta, const
   return owner->tr("%1  (%2)").arg(when, meta.id.left(12));
 }
 
-QString normalizeDiffText(QString text) {
-  text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
-  text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
-  return text;
-}
-
 QVector<int> allLineIndexes(const QString& text) {
-  const QStringList lines = normalizeDiffText(text).split(QLatin1Char('\n'), Qt::KeepEmptyParts);
+  const int count = static_cast<int>(TextDiff::splitLines(text).size());
   QVector<int> indexes;
-  indexes.reserve(lines.size());
-  for (int i = 0; i < lines.size(); ++i) {
+  indexes.reserve(count);
+  for (int i = 0; i < count; ++i) {
     indexes.push_back(i);
   }
   return indexes;
 }
 
-struct LineDiffHighlight final {
-  QVector<int> leftChanged;
-  QVector<int> rightChanged;
-  bool approximated = false;
-};
-
-LineDiffHighlight computeLineDiffHighlight(const QString& leftText, const QString& rightText) {
-  LineDiffHighlight out;
-
-  const QStringList leftLines =
-      normalizeDiffText(leftText).split(QLatin1Char('\n'), Qt::KeepEmptyParts);
-  const QStringList rightLines =
-      normalizeDiffText(rightText).split(QLatin1Char('\n'), Qt::KeepEmptyParts);
-
-  const int leftCount = leftLines.size();
-  const int rightCount = rightLines.size();
-  if (leftCount == 0 && rightCount == 0) {
-    return out;
-  }
-
-  constexpr qint64 kMaxDpCells = 4LL * 1000 * 1000;
-  const qint64 dpCells = static_cast<qint64>(leftCount + 1) *
-                         static_cast<qint64>(rightCount + 1);
-  if (dpCells > kMaxDpCells) {
-    out.leftChanged = allLineIndexes(leftText);
-    out.rightChanged = allLineIndexes(rightText);
-    out.approximated = true;
-    return out;
-  }
-
-  QVector<int> dp((leftCount + 1) * (rightCount + 1), 0);
-  const int rowStride = rightCount + 1;
-  auto at = [&dp, rowStride](int i, int j) -> int& { return dp[i * rowStride + j]; };
-
-  for (int i = 1; i <= leftCount; ++i) {
-    for (int j = 1; j <= rightCount; ++j) {
-      if (leftLines.at(i - 1) == rightLines.at(j - 1)) {
-        at(i, j) = at(i - 1, j - 1) + 1;
-      } else {
-        at(i, j) = std::max(at(i - 1, j), at(i, j - 1));
-      }
-    }
-  }
-
-  QVector<int> leftChangedReversed;
-  QVector<int> rightChangedReversed;
-  leftChangedReversed.reserve(leftCount);
-  rightChangedReversed.reserve(rightCount);
-
-  int i = leftCount;
-  int j = rightCount;
-  while (i > 0 && j > 0) {
-    if (leftLines.at(i - 1) == rightLines.at(j - 1)) {
-      --i;
-      --j;
-      continue;
-    }
-    if (at(i - 1, j) >= at(i, j - 1)) {
-      leftChangedReversed.push_back(i - 1);
-      --i;
-    } else {
-      rightChangedReversed.push_back(j - 1);
-      --j;
-    }
-  }
-  while (i > 0) {
-    leftChangedReversed.push_back(i - 1);
-    --i;
-  }
-  while (j > 0) {
-    rightChangedReversed.push_back(j - 1);
-    --j;
-  }
-
-  out.leftChanged = std::move(leftChangedReversed);
-  out.rightChanged = std::move(rightChangedReversed);
-  std::sort(out.leftChanged.begin(), out.leftChanged.end());
-  std::sort(out.rightChanged.begin(), out.rightChanged.end());
-  return out;
-}
-
-void applyLineHighlights(QPlainTextEdit* editor, const QVector<int>& changedLines, const QColor& color) {
+void applyLineHighlights(QPlainTextEdit* editor,
+                         const QVector<int>& changedLines,
+                         const QColor& color,
+                         const QVector<TextDiff::CharRange>& charRanges = {},
+                         const QColor& charColor = {}) {
   if (!editor) {
     return;
   }
   QVector<QTextEdit::ExtraSelection> selections;
-  selections.reserve(changedLines.size());
+  selections.reserve(changedLines.size() + charRanges.size());
   for (int lineIndex : changedLines) {
     if (lineIndex < 0) {
       continue;
@@ -200,6 +118,19 @@ void applyLineHighlights(QPlainTextEdit* editor, const QVector<int>& changedLine
     selection.format.setBackground(color);
     selections.push_back(std::move(selection));
   }
+  for (const TextDiff::CharRange& range : charRanges) {
+    const QTextBlock block = editor->document()->findBlockByNumber(range.line);
+    if (!block.isValid() || range.start + range.length > block.length() - 1) {
+      continue;
+    }
+    QTextEdit::ExtraSelection selection;
+    selection.cursor = QTextCursor(block);
+    selection.cursor.setPosition(block.position() + range.start);
+    selection.cursor.setPosition(block.position() + range.start + range.length,
+                                 QTextCursor::KeepAnchor);
+    selection.format.setBackground(charColor);
+    selections.push_back(std::move(selection));
+  }
   editor->setExtraSelections(selections);
 }
 }  // namespace
@@ -358,17 +289,6 @@ bool CodeSnapshotCompareDialog::loadSnapshotFiles(const QString& snapshotId,
     return false;
   }
 
-  const QString filesRootPath =
-      QDir(CodeSnapshotStore::snapshotsRootForSketch(sketchFolder_))
-          .filePath(id + QStringLiteral("/files"));
-  QDir filesRoot(filesRootPath);
-  if (!filesRoot.exists()) {
-    if (outError) {
-      *outError = tr("Snapshot files are missing.");
-    }
-    return false;
-  }
-
   QHash<QString, QByteArray> files;
   files.reserve(snapshot->files.size());
   for (const auto& fileMeta : snapshot->files) {
@@ -377,14 +297,16 @@ bool CodeSnapshotCompareDialog::loadSnapshotFiles(const QString& snapshotId,
       continue;
     }
 
-    QFile file(filesRoot.filePath(rel));
-    if (!file.open(QIODevice::ReadOnly)) {
+    QString readErr;
+    QByteArray bytes =
+        CodeSnapshotStore::readSnapshotFile(sketchFolder_, id, fileMeta, &readErr);
+    if (!readErr.isEmpty()) {
       if (outError) {
         *outError = tr("Failed to read snapshot file '%1'.").arg(rel);
       }
       return false;
     }
-    files.insert(rel, file.readAll());
+    files.insert(rel, std::move(bytes));
   }
 
   snapshotFilesById_.insert(id, std::move(files));
@@ -591,7 +513,14 @@ void CodeSnapshotCompareDialog::updatePreview() {
     return;
   }
 
-  const LineDiffHighlight lineDiff = computeLineDiffHighlight(leftText, rightText);
-  applyLineHighlights(leftPreview_, lineDiff.leftChanged, leftColor);
-  applyLineHighlights(rightPreview_, lineDiff.rightChanged, rightColor);
+  QColor leftCharColor = leftColor;
+  leftCharColor.setAlpha(130);
+  QColor rightCharColor = rightColor;
+  rightCharColor.setAlpha(130);
+
+  const TextDiff::Result diff = TextDiff::compute(leftText, rightText);
+  applyLineHighlights(leftPreview_, diff.leftChanged, leftColor, diff.leftCharRanges,
+                      leftCharColor);
+  applyLineHighlights(rightPreview_, diff.rightChanged, rightColor, diff.rightCharRanges,
+                      rightCharColor);
 }
@@ -17,6 +17,15 @@
 #include <QUuid>
 
 namespace {
+constexpr auto kObjectsDirName = "objects";
+constexpr char kObjectMagic[] = {'R', 'W', 'S', 'O'};
+constexpr char kObjectEncodingRaw = 0;
+constexpr char kObjectEncodingDeflate = 1;
+constexpr int kObjectHeaderSize = static_cast<int>(sizeof(kObjectMagic)) + 1;
+// Files modified this close to the previous snapshot may have changed again
+// within the same mtime tick, so they are always re-hashed.
+constexpr qint64 kRacyMtimeWindowMs = 2000;
+
 QString normalizeRelativePath(QString rel) {
   rel = rel.trimmed();
   rel.replace('\\', '/');
@@ -81,6 +90,9 @@ QJsonObject fileToJson(const CodeSnapshotStore::SnapshotFile& f) {
   o.insert(QStringLiteral("sizeBytes"), static_cast<double>(f.sizeBytes));
   o.insert(QStringLiteral("sha1"), f.sha1Hex);
   o.insert(QStringLiteral("permissions"), f.permissions);
+  if (f.modifiedMsecs > 0) {
+    o.insert(QStringLiteral("mtimeMs"), static_cast<double>(f.modifiedMsecs));
+  }
   return o;
 }
 
@@ -97,6 +109,7 @@ std::optional<CodeSnapshotStore::SnapshotFile> fileFromJson(const QJsonObject& o
   f.sizeBytes = static_cast<qint64>(o.value(QStringLiteral("sizeBytes")).toDouble());
   f.sha1Hex = o.value(QStringLiteral("sha1")).toString().trimmed();
   f.permissions = o.value(QStringLiteral("permissions")).toInt();
+  f.modifiedMsecs = static_cast<qint64>(o.value(QStringLiteral("mtimeMs")).toDouble());
   return f;
 }
 
@@ -114,7 +127,7 @@ QJsonObject metaToJson(const CodeSnapshotStore::SnapshotMeta& meta) {
 std::optional<CodeSnapshotStore::SnapshotMeta> metaFromJson(const QJsonObject& o,
                                                             QString* outError) {
   const int version = o.value(QStringLiteral("version")).toInt();
-  if (version != CodeSnapshotStore::kSnapshotVersion) {
+  if (version < 1 || version > CodeSnapshotStore::kSnapshotVersion) {
     if (outError) {
       *outError = QStringLiteral("Unsupported snapshot version.");
     }
@@ -209,12 +222,99 @@ QByteArray readFileBytes(const QString& path, QString* outError) {
   }
   return f.readAll();
 }
+
+bool isSha1Hex(const QString& sha) {
+  if (sha.size() != 40) {
+    return false;
+  }
+  for (const QChar ch : sha) {
+    if (!((ch >= u'0' && ch <= u'9') || (ch >= u'a' && ch <= u'f'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+QString objectPathFor(const QString& objectsRoot, const QString& sha) {
+  return QDir(objectsRoot).filePath(sha.left(2) + QLatin1Char('/') + sha.mid(2));
+}
+
+// Objects are a 4-byte magic, an encoding byte and the (possibly
+// qCompress'ed) payload. Compressed form is only kept when it is smaller.
+bool writeObject(const QString& path,
+                 const QByteArray& bytes,
+                 bool compress,
+                 QString* outError) {
+  QByteArray payload;
+  char encoding = kObjectEncodingRaw;
+  if (compress && bytes.size() >= 64) {
+    QByteArray compressed = qCompress(bytes, 6);
+    if (compressed.size() < bytes.size()) {
+      payload = std::move(compressed);
+      encoding = kObjectEncodingDeflate;
+    }
+  }
+  if (encoding == kObjectEncodingRaw) {
+    payload = bytes;
+  }
+
+  QByteArray data;
+  data.reserve(kObjectHeaderSize + payload.size());
+  data.append(kObjectMagic, sizeof(kObjectMagic));
+  data.append(encoding);
+  data.append(payload);
+  return writeBytesToFile(path, data, 0, outError);
+}
+
+QByteArray readObject(const QString& path, QString* outError) {
+  QString err;
+  const QByteArray data = readFileBytes(path, &err);
+  if (!err.isEmpty() || data.size() < kObjectHeaderSize ||
+      !data.startsWith(QByteArray::fromRawData(kObjectMagic, sizeof(kObjectMagic)))) {
+    if (outError) {
+      *outError = QStringLiteral("Snapshot object is missing or damaged.");
+    }
+    return {};
+  }
+  const char encoding = data.at(sizeof(kObjectMagic));
+  if (encoding == kObjectEncodingRaw) {
+    return data.mid(kObjectHeaderSize);
+  }
+  if (encoding == kObjectEncodingDeflate) {
+    const QByteArray bytes = qUncompress(
+        reinterpret_cast<const uchar*>(data.constData()) + kObjectHeaderSize,
+        data.size() - kObjectHeaderSize);
+    if (!bytes.isEmpty()) {
+      return bytes;
+    }
+  }
+  if (outError) {
+    *outError = QStringLiteral("Snapshot object is missing or damaged.");
+  }
+  return {};
+}
+
+QSet<QString> objectNamesForFiles(const QVector<CodeSnapshotStore::SnapshotFile>& files) {
+  QSet<QString> out;
+  for (const auto& f : files) {
+    const QString sha = f.sha1Hex.trimmed().toLower();
+    if (isSha1Hex(sha)) {
+      out.insert(sha);
+    }
+  }
+  return out;
+}
 }  // namespace
 
 QString CodeSnapshotStore::snapshotsRootForSketch(const QString& sketchFolder) {
   return QDir(sketchFolder).filePath(QStringLiteral(".rewritto/snapshots"));
 }
 
+QString CodeSnapshotStore::objectsRootForSketch(const QString& sketchFolder) {
+  return QDir(snapshotsRootForSketch(sketchFolder))
+      .filePath(QString::fromLatin1(kObjectsDirName));
+}
+
 QVector<CodeSnapshotStore::SnapshotMeta> CodeSnapshotStore::listSnapshots(
     const QString& sketchFolder,
     QString* outError) {
@@ -228,7 +328,8 @@ QVector<CodeSnapshotStore::SnapshotMeta> CodeSnapshotStore::listSnapshots(
   const QStringList snapshotDirs =
       rootDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
   for (const QString& id : snapshotDirs) {
-    if (id.startsWith(QStringLiteral(".tmp-"))) {
+    if (id.startsWith(QStringLiteral(".tmp-")) ||
+        id == QLatin1String(kObjectsDirName)) {
       continue;
     }
     const QString snapshotDir = rootDir.filePath(id);
@@ -315,6 +416,33 @@ std::optional<CodeSnapshotStore::Snapshot> CodeSnapshotStore::readSnapshot(
   return snapshot;
 }
 
+QByteArray CodeSnapshotStore::readSnapshotFile(const QString& sketchFolder,
+                                               const QString& id,
+                                               const SnapshotFile& file,
+                                               QString* outError) {
+  const QString rel = normalizeRelativePath(file.relativePath);
+  if (!isSafeRelativePath(rel)) {
+    if (outError) {
+      *outError = QStringLiteral("Invalid snapshot file path.");
+    }
+    return {};
+  }
+  const QString snapshotDir =
+      QDir(snapshotsRootForSketch(sketchFolder)).filePath(id);
+  const QString legacyPath = QDir(filesRootForSnapshot(snapshotDir)).filePath(rel);
+  if (QFileInfo::exists(legacyPath)) {
+    return readFileBytes(legacyPath, outError);
+  }
+  const QString sha = file.sha1Hex.trimmed().toLower();
+  if (!isSha1Hex(sha)) {
+    if (outError) {
+      *outError = QStringLiteral("Snapshot file has no content hash.");
+    }
+    return {};
+  }
+  return readObject(objectPathFor(objectsRootForSketch(sketchFolder), sha), outError);
+}
+
 bool CodeSnapshotStore::createSnapshot(const CreateOptions& options,
                                        SnapshotMeta* outSnapshot,
                                        QString* outError,
@@ -336,6 +464,17 @@ bool CodeSnapshotStore::createSnapshot(const CreateOptions& options,
   }
 
   QDir rootDir(root);
+  // A leftover .tmp- folder is a snapshot that was interrupted before it
+  // could remove what it wrote, so there are orphaned objects to sweep.
+  const QStringList interrupted = rootDir.entryList(
+      {QStringLiteral(".tmp-*")}, QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+  if (!interrupted.isEmpty()) {
+    for (const QString& name : interrupted) {
+      QDir(rootDir.filePath(name)).removeRecursively();
+    }
+    collectGarbage(sketchFolder);
+  }
+
   const QString id = newSnapshotId();
   const QString tmpName =
       QStringLiteral(".tmp-") + QUuid::createUuid().toString(QUuid::WithoutBraces);
@@ -348,13 +487,42 @@ bool CodeSnapshotStore::createSnapshot(const CreateOptions& options,
     return false;
   }
 
-  if (!QDir().mkpath(filesRootForSnapshot(tmpDirPath))) {
+  const QString objectsRoot = objectsRootForSketch(sketchFolder);
+  if (!QDir().mkpath(tmpDirPath) || !QDir().mkpath(objectsRoot)) {
     if (outError) {
       *outError = QStringLiteral("Failed to create snapshot folder.");
     }
     return false;
   }
 
+  // The newest snapshot tells which files are unchanged by size and mtime.
+  QHash<QString, SnapshotFile> previousFiles;
+  qint64 previousCreatedMsecs = 0;
+  {
+    const QVector<SnapshotMeta> existing = listSnapshots(sketchFolder);
+    if (!existing.isEmpty()) {
+      if (const auto previous = readSnapshot(sketchFolder, existing.first().id)) {
+        previousCreatedMsecs = previous->meta.createdAtUtc.toMSecsSinceEpoch();
+        for (const SnapshotFile& f : previous->files) {
+          previousFiles.insert(f.relativePath, f);
+        }
+      }
+    }
+  }
+
+  // Objects written by this call; removed again if the snapshot fails.
+  QStringList createdObjects;
+  const auto fail = [&](const QString& message) {
+    QDir(tmpDirPath).removeRecursively();
+    for (const QString& path : createdObjects) {
+      QFile::remove(path);
+    }
+    if (outError) {
+      *outError = message;
+    }
+    return false;
+  };
+
   QDir sketchDir(sketchFolder);
   QSet<QString> relPathsSet;
   {
@@ -389,56 +557,63 @@ bool CodeSnapshotStore::createSnapshot(const CreateOptions& options,
   files.reserve(relPaths.size());
   qint64 totalBytes = 0;
 
-  const QString snapshotFilesRoot = filesRootForSnapshot(tmpDirPath);
-
   for (int i = 0; i < relPaths.size(); ++i) {
     const QString rel = relPaths.at(i);
     if (progress && !progress(i, relPaths.size(), rel)) {
-      QDir(tmpDirPath).removeRecursively();
-      if (outError) {
-        *outError = QStringLiteral("Snapshot creation cancelled.");
-      }
-      return false;
+      return fail(QStringLiteral("Snapshot creation cancelled."));
     }
 
     const QString absSourcePath = sketchDir.filePath(rel);
+    const QFileInfo sourceInfo(absSourcePath);
+    const bool isOverride = options.fileOverrides.contains(rel);
+
+    SnapshotFile f;
+    f.relativePath = rel;
+    if (sourceInfo.exists()) {
+      f.permissions = static_cast<int>(sourceInfo.permissions());
+    }
+
+    if (!isOverride && sourceInfo.exists()) {
+      f.sizeBytes = sourceInfo.size();
+      f.modifiedMsecs = sourceInfo.lastModified().toMSecsSinceEpoch();
+      const auto prev = previousFiles.constFind(rel);
+      if (prev != previousFiles.constEnd() && f.modifiedMsecs > 0 &&
+          prev->sizeBytes == f.sizeBytes && prev->modifiedMsecs == f.modifiedMsecs &&
+          f.modifiedMsecs < previousCreatedMsecs - kRacyMtimeWindowMs) {
+        const QString sha = prev->sha1Hex.trimmed().toLower();
+        if (isSha1Hex(sha) && QFileInfo::exists(objectPathFor(objectsRoot, sha))) {
+          f.sha1Hex = sha;
+          totalBytes += f.sizeBytes;
+          files.push_back(std::move(f));
+          continue;
+        }
+      }
+    }
+
     QByteArray bytes;
     QString err;
-    if (options.fileOverrides.contains(rel)) {
+    if (isOverride) {
       bytes = options.fileOverrides.value(rel);
+      f.modifiedMsecs = 0;
     } else {
       bytes = readFileBytes(absSourcePath, &err);
       if (!err.isEmpty() && bytes.isEmpty()) {
-        QDir(tmpDirPath).removeRecursively();
-        if (outError) {
-          *outError = QStringLiteral("Failed to read '%1'.").arg(rel);
-        }
-        return false;
+        return fail(QStringLiteral("Failed to read '%1'.").arg(rel));
       }
     }
 
-    int perms = 0;
-    const QFileInfo sourceInfo(absSourcePath);
-    if (sourceInfo.exists()) {
-      perms = static_cast<int>(sourceInfo.permissions());
-    }
-
-    const QString destPath = QDir(snapshotFilesRoot).filePath(rel);
-    if (!writeBytesToFile(destPath, bytes, perms, &err)) {
-      QDir(tmpDirPath).removeRecursively();
-      if (outError) {
-        *outError = QStringLiteral("Failed to write '%1'.").arg(rel);
+    f.sizeBytes = bytes.size();
+    f.sha1Hex = QString::fromLatin1(sha1Hex(bytes));
+    const QString objectPath = objectPathFor(objectsRoot, f.sha1Hex);
+    if (!QFileInfo::exists(objectPath)) {
+      if (!writeObject(objectPath, bytes, options.compressObjects, &err)) {
+        return fail(QStringLiteral("Failed to write '%1'.").arg(rel));
       }
-      return false;
+      createdObjects.push_back(objectPath);
     }
 
-    SnapshotFile f;
-    f.relativePath = rel;
-    f.sizeBytes = bytes.size();
-    f.sha1Hex = QString::fromUtf8(sha1Hex(bytes));
-    f.permissions = perms;
+    totalBytes += f.sizeBytes;
     files.push_back(std::move(f));
-    totalBytes += bytes.size();
   }
   if (progress) {
     (void)progress(relPaths.size(), relPaths.size(), {});
@@ -460,19 +635,11 @@ bool CodeSnapshotStore::createSnapshot(const CreateOptions& options,
 
   QString metaErr;
   if (!writeJsonFile(metaPathForSnapshot(tmpDirPath), metaObj, &metaErr)) {
-    QDir(tmpDirPath).removeRecursively();
-    if (outError) {
-      *outError = metaErr;
-    }
-    return false;
+    return fail(metaErr);
   }
 
   if (!rootDir.rename(tmpName, id)) {
-    QDir(tmpDirPath).removeRecursively();
-    if (outError) {
-      *outError = QStringLiteral("Failed to finalize snapshot.");
-    }
-    return false;
+    return fail(QStringLiteral("Failed to finalize snapshot."));
   }
 
   if (outSnapshot) {
@@ -523,15 +690,70 @@ bool CodeSnapshotStore::deleteSnapshot(const QString& sketchFolder,
   if (!dir.exists()) {
     return true;
   }
+
+  QSet<QString> candidates;
+  if (const auto snapshot = readSnapshot(sketchFolder, id)) {
+    candidates = objectNamesForFiles(snapshot->files);
+  }
+
   if (!dir.removeRecursively()) {
     if (outError) {
       *outError = QStringLiteral("Failed to delete snapshot.");
     }
     return false;
   }
+
+  if (!candidates.isEmpty()) {
+    const QHash<QString, int> refs = objectReferenceCounts(sketchFolder);
+    const QString objectsRoot = objectsRootForSketch(sketchFolder);
+    for (const QString& sha : std::as_const(candidates)) {
+      if (refs.value(sha) == 0) {
+        QFile::remove(objectPathFor(objectsRoot, sha));
+      }
+    }
+  }
   return true;
 }
 
+QHash<QString, int> CodeSnapshotStore::objectReferenceCounts(const QString& sketchFolder) {
+  QHash<QString, int> refs;
+  for (const SnapshotMeta& meta : listSnapshots(sketchFolder)) {
+    const auto snapshot = readSnapshot(sketchFolder, meta.id);
+    if (!snapshot) {
+      continue;
+    }
+    for (const SnapshotFile& f : snapshot->files) {
+      const QString sha = f.sha1Hex.trimmed().toLower();
+      if (isSha1Hex(sha)) {
+        ++refs[sha];
+      }
+    }
+  }
+  return refs;
+}
+
+int CodeSnapshotStore::collectGarbage(const QString& sketchFolder) {
+  const QString objectsRoot = objectsRootForSketch(sketchFolder);
+  if (!QDir(objectsRoot).exists()) {
+    return 0;
+  }
+  const QHash<QString, int> refs = objectReferenceCounts(sketchFolder);
+  int removed = 0;
+  QDirIterator it(objectsRoot, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    const QFileInfo info(path);
+    const QString sha = info.dir().dirName() + info.fileName();
+    if (isSha1Hex(sha) && refs.value(sha) > 0) {
+      continue;
+    }
+    if (QFile::remove(path)) {
+      ++removed;
+    }
+  }
+  return removed;
+}
+
 bool CodeSnapshotStore::restoreSnapshot(const QString& sketchFolder,
                                         const QString& id,
                                         QStringList* outWrittenFiles,
@@ -546,17 +768,6 @@ bool CodeSnapshotStore::restoreSnapshot(const QString& sketchFolder,
     return false;
   }
 
-  const QString snapshotDir =
-      QDir(snapshotsRootForSketch(sketchFolder)).filePath(id);
-  const QString snapshotFilesRoot = filesRootForSnapshot(snapshotDir);
-  QDir snapshotFilesDir(snapshotFilesRoot);
-  if (!snapshotFilesDir.exists()) {
-    if (outError) {
-      *outError = QStringLiteral("Snapshot files are missing.");
-    }
-    return false;
-  }
-
   QDir sketchDir(QDir(sketchFolder).absolutePath());
   if (!sketchDir.exists()) {
     if (outError) {
@@ -581,10 +792,10 @@ bool CodeSnapshotStore::restoreSnapshot(const QString& sketchFolder,
       return false;
     }
 
-    const QString sourcePath = snapshotFilesDir.filePath(rel);
     const QString destPath = sketchDir.filePath(rel);
 
-    QByteArray bytes = readFileBytes(sourcePath, &err);
+    err.clear();
+    QByteArray bytes = readSnapshotFile(sketchFolder, id, f, &err);
     if (!err.isEmpty() && bytes.isEmpty()) {
       if (outError) {
         *outError = QStringLiteral("Failed to read '%1' from snapshot.").arg(rel);
@@ -9,15 +9,20 @@
 #include <functional>
 #include <optional>
 
+// Snapshots live under <sketch>/.rewritto/snapshots/<id>/meta.json. File
+// contents are stored once per distinct SHA-1 under snapshots/objects/ and
+// shared by every snapshot that references them; version 1 snapshots kept a
+// private copy under <id>/files/ and are still readable.
 class CodeSnapshotStore final {
  public:
-  static constexpr int kSnapshotVersion = 1;
+  static constexpr int kSnapshotVersion = 2;
 
   struct SnapshotFile final {
     QString relativePath;
     qint64 sizeBytes = 0;
     QString sha1Hex;
     int permissions = 0;  // QFileDevice::Permissions serialized as int
+    qint64 modifiedMsecs = 0;  // source mtime; 0 for editor buffers
   };
 
   struct SnapshotMeta final {
@@ -40,15 +45,27 @@ class CodeSnapshotStore final {
     QString sketchFolder;
     QString comment;
     QHash<QString, QByteArray> fileOverrides;  // relative path -> bytes
+    bool compressObjects = true;  // deflate new objects when it saves space
   };
 
   static QString snapshotsRootForSketch(const QString& sketchFolder);
+  static QString objectsRootForSketch(const QString& sketchFolder);
   static QVector<SnapshotMeta> listSnapshots(const QString& sketchFolder,
                                              QString* outError = nullptr);
   static std::optional<Snapshot> readSnapshot(const QString& sketchFolder,
                                               const QString& id,
                                               QString* outError = nullptr);
 
+  // Contents of one file of a snapshot, from the object store or, for
+  // version 1 snapshots, the snapshot's own files/ folder.
+  static QByteArray readSnapshotFile(const QString& sketchFolder,
+                                     const QString& id,
+                                     const SnapshotFile& file,
+                                     QString* outError = nullptr);
+
+  // Unchanged files (same size and mtime as in the newest snapshot) reuse
+  // the existing object without being read again. Objects orphaned by an
+  // interrupted earlier snapshot are collected first.
   static bool createSnapshot(const CreateOptions& options,
                              SnapshotMeta* outSnapshot,
                              QString* outError = nullptr,
@@ -57,9 +74,14 @@ class CodeSnapshotStore final {
                                     const QString& id,
                                     const QString& comment,
                                     QString* outError = nullptr);
+  // Also removes objects no other snapshot references.
   static bool deleteSnapshot(const QString& sketchFolder,
                              const QString& id,
                              QString* outError = nullptr);
+  // SHA-1 -> number of snapshot files referencing it, over all snapshots.
+  static QHash<QString, int> objectReferenceCounts(const QString& sketchFolder);
+  // Removes every unreferenced object; returns how many were removed.
+  static int collectGarbage(const QString& sketchFolder);
   static bool restoreSnapshot(const QString& sketchFolder,
                               const QString& id,
                               QStringList* outWrittenFiles = nullptr,
@@ -3,6 +3,8 @@
 #include <QColor>
 #include <QTextCharFormat>
 
+#include "code_block_data.h"
+
 namespace {
 QTextCharFormat makeFormat(const QColor& color, bool bold = false) {
   QTextCharFormat fmt;
@@ -12,78 +14,19 @@ QTextCharFormat makeFormat(const QColor& color, bool bold = false) {
   }
   return fmt;
 }
+
+constexpr int formatIndex(CppLexer::TokenKind kind) {
+  return static_cast<int>(kind);
+}
 }  // namespace
 
 CppHighlighter::CppHighlighter(QTextDocument* parent)
     : QSyntaxHighlighter(parent) {
-  // Keywords (C/C++)
-  {
-    Rule r;
-    r.pattern = QRegularExpression(
-        R"(\b(auto|break|case|catch|char|class|const|constexpr|continue|default|delete|do|double|else|enum|explicit|extern|false|float|for|friend|goto|if|inline|int|long|mutable|namespace|new|nullptr|operator|private|protected|public|register|reinterpret_cast|return|short|signed|sizeof|static|struct|switch|template|this|throw|true|try|typedef|typename|union|unsigned|using|virtual|void|volatile|while)\b)");
-    r.format = makeFormat(QColor("#569CD6"), true);
-    rules_.push_back(r);
-  }
-
-  // Sketch identifiers
-  {
-    Rule r;
-    r.pattern = QRegularExpression(
-        R"(\b(setup|loop|HIGH|LOW|INPUT|OUTPUT|INPUT_PULLUP|LED_BUILTIN|pinMode|digitalWrite|digitalRead|analogRead|analogWrite|delay|millis|micros|Serial|Serial1|Serial2|Serial3|Wire|SPI)\b)");
-    r.format = makeFormat(QColor("#4EC9B0"), true);
-    rules_.push_back(r);
-  }
-
-  // Preprocessor
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"(^\s*#\s*\w+.*$)");
-    r.format = makeFormat(QColor("#C586C0"), true);
-    rules_.push_back(r);
-  }
-
-  // Single-line comments
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"(//[^\n]*)");
-    r.format = makeFormat(QColor("#6A9955"));
-    rules_.push_back(r);
-  }
-
-  // Strings
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"("([^"\\]|\\.)*")");
-    r.format = makeFormat(QColor("#CE9178"));
-    rules_.push_back(r);
-  }
-
-  // Character literals
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"('([^'\\]|\\.)*')");
-    r.format = makeFormat(QColor("#CE9178"));
-    rules_.push_back(r);
-  }
-
-  // Numbers
-  {
-    Rule r;
-    r.pattern =
-        QRegularExpression(R"(\b(0x[0-9A-Fa-f]+|\d+(\.\d+)?)\b)");
-    r.format = makeFormat(QColor("#B5CEA8"));
-    rules_.push_back(r);
-  }
-
-  // Multiline comments
-  multiLineCommentStart_ = QRegularExpression(R"(/\*)");
-  multiLineCommentEnd_ = QRegularExpression(R"(\*/)");
-  
   setTheme(true); // Default to dark
 }
 
 void CppHighlighter::setTheme(bool isDark) {
-  rules_.clear();
+  using Kind = CppLexer::TokenKind;
 
   const QColor keywordColor = isDark ? QColor("#569CD6") : QColor("#0000FF");
   const QColor sketchIdColor = isDark ? QColor("#4EC9B0") : QColor("#00979C");
@@ -92,100 +35,43 @@ void CppHighlighter::setTheme(bool isDark) {
   const QColor stringColor = isDark ? QColor("#CE9178") : QColor("#005C5F");
   const QColor numberColor = isDark ? QColor("#B5CEA8") : QColor("#000000"); // Usually plain in light
 
-  // Keywords (C/C++)
-  {
-    Rule r;
-    r.pattern = QRegularExpression(
-        R"(\b(auto|break|case|catch|char|class|const|constexpr|continue|default|delete|do|double|else|enum|explicit|extern|false|float|for|friend|goto|if|inline|int|long|mutable|namespace|new|nullptr|operator|private|protected|public|register|reinterpret_cast|return|short|signed|sizeof|static|struct|switch|template|this|throw|true|try|typedef|typename|union|unsigned|using|virtual|void|volatile|while)\b)");
-    r.format = makeFormat(keywordColor, true);
-    rules_.push_back(r);
-  }
-
-  // Sketch identifiers
-  {
-    Rule r;
-    r.pattern = QRegularExpression(
-        R"(\b(setup|loop|HIGH|LOW|INPUT|OUTPUT|INPUT_PULLUP|LED_BUILTIN|pinMode|digitalWrite|digitalRead|analogRead|analogWrite|delay|millis|micros|Serial|Serial1|Serial2|Serial3|Wire|SPI)\b)");
-    r.format = makeFormat(sketchIdColor, true);
-    rules_.push_back(r);
-  }
-
-  // Preprocessor
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"(^\s*#\s*\w+.*$)");
-    r.format = makeFormat(preprocColor, true);
-    rules_.push_back(r);
-  }
-
-  // Single-line comments
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"(//[^\n]*)");
-    r.format = makeFormat(commentColor);
-    rules_.push_back(r);
-  }
-
-  // Strings
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"("([^"\\]|\\.)*")");
-    r.format = makeFormat(stringColor);
-    rules_.push_back(r);
-  }
-
-  // Character literals
-  {
-    Rule r;
-    r.pattern = QRegularExpression(R"('([^'\\]|\\.)*')");
-    r.format = makeFormat(stringColor);
-    rules_.push_back(r);
-  }
-
-  // Numbers
-  {
-    Rule r;
-    r.pattern =
-        QRegularExpression(R"(\b(0x[0-9A-Fa-f]+|\d+(\.\d+)?)\b)");
-    r.format = makeFormat(numberColor);
-    rules_.push_back(r);
-  }
-  
-  multiLineCommentFormat_ = makeFormat(commentColor);
+  formats_[formatIndex(Kind::Keyword)] = makeFormat(keywordColor, true);
+  formats_[formatIndex(Kind::SketchIdentifier)] = makeFormat(sketchIdColor, true);
+  formats_[formatIndex(Kind::Preprocessor)] = makeFormat(preprocColor, true);
+  formats_[formatIndex(Kind::Comment)] = makeFormat(commentColor);
+  formats_[formatIndex(Kind::String)] = makeFormat(stringColor);
+  formats_[formatIndex(Kind::Number)] = makeFormat(numberColor);
   rehighlight();
 }
 
 void CppHighlighter::highlightBlock(const QString& text) {
-  for (const Rule& r : rules_) {
-    auto it = r.pattern.globalMatch(text);
-    while (it.hasNext()) {
-      const auto m = it.next();
-      setFormat(m.capturedStart(), m.capturedLength(), r.format);
-    }
-  }
-
-  setCurrentBlockState(0);
-
-  int startIndex = 0;
-  if (previousBlockState() != 1) {
-    const auto match = multiLineCommentStart_.match(text);
-    startIndex = match.hasMatch() ? match.capturedStart() : -1;
+  // CodeEditor has usually lexed a changed line already, for folding; its
+  // tokens are current while the line and the state it starts in are.
+  int previous = previousBlockState();
+  if (!CppLexer::isLexerState(previous)) {
+    previous = CppLexer::kStateNormal;
+  }
+  const QVector<CppLexer::Token>* tokens = &tokens_;
+  int state = CppLexer::kStateNormal;
+  const auto* data = dynamic_cast<const CodeBlockData*>(currentBlockUserData());
+  if (data && data->magic == CodeBlockData::kMagic && data->summarized &&
+      data->revision == currentBlock().revision() && data->startLexState == previous) {
+    tokens = &data->tokens;
+    state = data->lexState;
   } else {
-    startIndex = 0;
+    tokens_.clear();
+    state = CppLexer::lexLine(text, previous, &tokens_);
+  }
+  for (const CppLexer::Token& token : *tokens) {
+    setFormat(token.start, token.length, formats_[formatIndex(token.kind)]);
   }
 
-  while (startIndex >= 0) {
-    const auto endMatch = multiLineCommentEnd_.match(text, startIndex);
-    int endIndex = endMatch.hasMatch() ? endMatch.capturedStart() : -1;
-    int commentLength = 0;
-    if (endIndex == -1) {
-      setCurrentBlockState(1);
-      commentLength = text.length() - startIndex;
-    } else {
-      commentLength = endIndex - startIndex + endMatch.capturedLength();
-    }
-    setFormat(startIndex, commentLength, multiLineCommentFormat_);
-    const auto nextStart = multiLineCommentStart_.match(text, startIndex + commentLength);
-    startIndex = nextStart.hasMatch() ? nextStart.capturedStart() : -1;
+  // CodeEditor keeps breakpoint markers in the block state. Leave those alone
+  // on lines that carry nothing over; the lexer reads them as a normal state.
+  const int current = currentBlockState();
+  if (state == CppLexer::kStateNormal && current > 0 &&
+      !CppLexer::isLexerState(current)) {
+    return;
   }
+  setCurrentBlockState(state);
 }
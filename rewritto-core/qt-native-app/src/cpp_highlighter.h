@@ -1,8 +1,12 @@
 #pragma once
 
 #include <QSyntaxHighlighter>
-#include <QRegularExpression>
 #include <QTextCharFormat>
+#include <QVector>
+
+#include <array>
+
+#include "cpp_lexer.h"
 
 class CppHighlighter final : public QSyntaxHighlighter {
   Q_OBJECT
@@ -16,14 +20,6 @@ class CppHighlighter final : public QSyntaxHighlighter {
   void highlightBlock(const QString& text) override;
 
  private:
-  struct Rule {
-    QRegularExpression pattern;
-    QTextCharFormat format;
-  };
-
-  QVector<Rule> rules_;
-
-  QRegularExpression multiLineCommentStart_;
-  QRegularExpression multiLineCommentEnd_;
-  QTextCharFormat multiLineCommentFormat_;
+  std::array<QTextCharFormat, CppLexer::kTokenKindCount> formats_;
+  QVector<CppLexer::Token> tokens_;
 };
@@ -0,0 +1,541 @@
+#include "cpp_lexer.h"
+
+#include <array>
+#include <iterator>
+#include <string_view>
+
+namespace {
+using Kind = CppLexer::TokenKind;
+
+struct KeywordEntry final {
+  std::string_view word;
+  Kind kind;
+};
+
+constexpr KeywordEntry kKeywords[] = {
+    {"auto", Kind::Keyword},
+    {"break", Kind::Keyword},
+    {"case", Kind::Keyword},
+    {"catch", Kind::Keyword},
+    {"char", Kind::Keyword},
+    {"class", Kind::Keyword},
+    {"const", Kind::Keyword},
+    {"constexpr", Kind::Keyword},
+    {"continue", Kind::Keyword},
+    {"default", Kind::Keyword},
+    {"delete", Kind::Keyword},
+    {"do", Kind::Keyword},
+    {"double", Kind::Keyword},
+    {"else", Kind::Keyword},
+    {"enum", Kind::Keyword},
+    {"explicit", Kind::Keyword},
+    {"extern", Kind::Keyword},
+    {"false", Kind::Keyword},
+    {"float", Kind::Keyword},
+    {"for", Kind::Keyword},
+    {"friend", Kind::Keyword},
+    {"goto", Kind::Keyword},
+    {"if", Kind::Keyword},
+    {"inline", Kind::Keyword},
+    {"int", Kind::Keyword},
+    {"long", Kind::Keyword},
+    {"mutable", Kind::Keyword},
+    {"namespace", Kind::Keyword},
+    {"new", Kind::Keyword},
+    {"nullptr", Kind::Keyword},
+    {"operator", Kind::Keyword},
+    {"private", Kind::Keyword},
+    {"protected", Kind::Keyword},
+    {"public", Kind::Keyword},
+    {"register", Kind::Keyword},
+    {"reinterpret_cast", Kind::Keyword},
+    {"return", Kind::Keyword},
+    {"short", Kind::Keyword},
+    {"signed", Kind::Keyword},
+    {"sizeof", Kind::Keyword},
+    {"static", Kind::Keyword},
+    {"struct", Kind::Keyword},
+    {"switch", Kind::Keyword},
+    {"template", Kind::Keyword},
+    {"this", Kind::Keyword},
+    {"throw", Kind::Keyword},
+    {"true", Kind::Keyword},
+    {"try", Kind::Keyword},
+    {"typedef", Kind::Keyword},
+    {"typename", Kind::Keyword},
+    {"union", Kind::Keyword},
+    {"unsigned", Kind::Keyword},
+    {"using", Kind::Keyword},
+    {"virtual", Kind::Keyword},
+    {"void", Kind::Keyword},
+    {"volatile", Kind::Keyword},
+    {"while", Kind::Keyword},
+    {"alignas", Kind::Keyword},
+    {"alignof", Kind::Keyword},
+    {"bool", Kind::Keyword},
+    {"char16_t", Kind::Keyword},
+    {"char32_t", Kind::Keyword},
+    {"const_cast", Kind::Keyword},
+    {"decltype", Kind::Keyword},
+    {"dynamic_cast", Kind::Keyword},
+    {"noexcept", Kind::Keyword},
+    {"static_assert", Kind::Keyword},
+    {"static_cast", Kind::Keyword},
+    {"thread_local", Kind::Keyword},
+    {"wchar_t", Kind::Keyword},
+
+    {"setup", Kind::SketchIdentifier},
+    {"loop", Kind::SketchIdentifier},
+    {"HIGH", Kind::SketchIdentifier},
+    {"LOW", Kind::SketchIdentifier},
+    {"INPUT", Kind::SketchIdentifier},
+    {"OUTPUT", Kind::SketchIdentifier},
+    {"INPUT_PULLUP", Kind::SketchIdentifier},
+    {"LED_BUILTIN", Kind::SketchIdentifier},
+    {"pinMode", Kind::SketchIdentifier},
+    {"digitalWrite", Kind::SketchIdentifier},
+    {"digitalRead", Kind::SketchIdentifier},
+    {"analogRead", Kind::SketchIdentifier},
+    {"analogWrite", Kind::SketchIdentifier},
+    {"delay", Kind::SketchIdentifier},
+    {"millis", Kind::SketchIdentifier},
+    {"micros", Kind::SketchIdentifier},
+    {"Serial", Kind::SketchIdentifier},
+    {"Serial1", Kind::SketchIdentifier},
+    {"Serial2", Kind::SketchIdentifier},
+    {"Serial3", Kind::SketchIdentifier},
+    {"Wire", Kind::SketchIdentifier},
+    {"SPI", Kind::SketchIdentifier},
+};
+constexpr int kKeywordCount = static_cast<int>(std::size(kKeywords));
+static_assert(kKeywordCount < 255, "keyword slots are stored as quint8");
+
+constexpr quint32 kKeywordTableSize = 2048;
+// Smallest seed for which keywordSlot() has no collisions over kKeywords;
+// checked below, so editing the keyword list fails the build until the seed
+// is updated.
+constexpr quint32 kKeywordSeed = 24;
+
+template <typename CharAt>
+constexpr quint32 keywordSlot(quint32 seed, int length, CharAt charAt) {
+  quint32 h = 2166136261u ^ (seed * 0x9E3779B9u);
+  for (int i = 0; i < length; ++i) {
+    h ^= static_cast<quint32>(charAt(i));
+    h *= 16777619u;
+  }
+  h ^= h >> 13;
+  return h & (kKeywordTableSize - 1);
+}
+
+constexpr quint32 keywordSlotFor(quint32 seed, std::string_view word) {
+  return keywordSlot(seed, static_cast<int>(word.size()), [word](int i) {
+    return static_cast<unsigned char>(word[static_cast<size_t>(i)]);
+  });
+}
+
+constexpr bool keywordSeedIsPerfect(quint32 seed) {
+  std::array<bool, kKeywordTableSize> used{};
+  for (const KeywordEntry& entry : kKeywords) {
+    const quint32 slot = keywordSlotFor(seed, entry.word);
+    if (used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+static_assert(keywordSeedIsPerfect(kKeywordSeed),
+              "kKeywordSeed no longer hashes kKeywords without collisions");
+
+// Slot -> keyword index + 1; 0 marks an empty slot.
+constexpr std::array<quint8, kKeywordTableSize> buildKeywordTable() {
+  std::array<quint8, kKeywordTableSize> table{};
+  for (int i = 0; i < kKeywordCount; ++i) {
+    table[keywordSlotFor(kKeywordSeed, kKeywords[i].word)] =
+        static_cast<quint8>(i + 1);
+  }
+  return table;
+}
+constexpr std::array<quint8, kKeywordTableSize> kKeywordTable = buildKeywordTable();
+
+constexpr int computeKeywordLengthBound(bool longest) {
+  int out = longest ? 0 : 1 << 20;
+  for (const KeywordEntry& entry : kKeywords) {
+    const int len = static_cast<int>(entry.word.size());
+    out = longest ? (len > out ? len : out) : (len < out ? len : out);
+  }
+  return out;
+}
+constexpr int kMinKeywordLength = computeKeywordLengthBound(false);
+constexpr int kMaxKeywordLength = computeKeywordLengthBound(true);
+
+// Block state layout. Bit 30 marks states produced by the lexer so values
+// written by other block-state users are never misread as lexer state.
+enum Mode : int {
+  kModeNormal = 0,
+  kModeBlockComment = 1,
+  kModeRawString = 2,
+  kModeLineComment = 3,  // `//` comment continued with a trailing backslash
+  kModeString = 4,       // string literal continued with a trailing backslash
+};
+constexpr int kModeMask = 0x7;
+constexpr int kPreprocessorFlag = 0x8;
+constexpr int kRawDelimiterShift = 4;
+constexpr quint32 kRawDelimiterMask = 0xFFFFFF;
+constexpr int kStateMarker = 0x40000000;
+constexpr int kMaxRawDelimiterLength = 16;
+
+int makeState(int mode, bool preprocessor, quint32 rawDelimiterHash) {
+  if (mode == kModeNormal && !preprocessor) {
+    return CppLexer::kStateNormal;
+  }
+  return kStateMarker | mode | (preprocessor ? kPreprocessorFlag : 0) |
+         static_cast<int>((rawDelimiterHash & kRawDelimiterMask)
+                          << kRawDelimiterShift);
+}
+
+quint32 rawDelimiterHash(QStringView delimiter) {
+  quint32 h = 2166136261u;
+  for (const QChar ch : delimiter) {
+    h ^= ch.unicode();
+    h *= 16777619u;
+  }
+  return h & kRawDelimiterMask;
+}
+
+bool isIdentifierStart(QChar ch) {
+  const char16_t c = ch.unicode();
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+    return true;
+  }
+  return c >= 0x80 && ch.isLetter();
+}
+
+bool isIdentifierChar(QChar ch) {
+  const char16_t c = ch.unicode();
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') || c == '_') {
+    return true;
+  }
+  return c >= 0x80 && ch.isLetterOrNumber();
+}
+
+bool isDigit(QChar ch) {
+  return ch.unicode() >= '0' && ch.unicode() <= '9';
+}
+
+bool isAsciiAlnum(QChar ch) {
+  const char16_t c = ch.unicode();
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9');
+}
+
+int findBlockCommentEnd(QStringView text, int from) {
+  const int n = static_cast<int>(text.size());
+  for (int i = from; i + 1 < n; ++i) {
+    if (text[i] == u'*' && text[i + 1] == u'/') {
+      return i + 2;
+    }
+  }
+  return -1;
+}
+
+// Scans a quoted literal body starting after the opening quote. Returns the
+// index past the closing quote, or -1 when the line ends first;
+// `escapedNewline` reports a trailing backslash that continues the literal.
+int scanQuoted(QStringView text, int from, QChar quote, bool* escapedNewline) {
+  const int n = static_cast<int>(text.size());
+  *escapedNewline = false;
+  int i = from;
+  while (i < n) {
+    const QChar ch = text[i];
+    if (ch == u'\\') {
+      if (i + 1 >= n) {
+        *escapedNewline = true;
+        return -1;
+      }
+      i += 2;
+      continue;
+    }
+    if (ch == quote) {
+      return i + 1;
+    }
+    ++i;
+  }
+  return -1;
+}
+
+// Finds `)delimiter"` for a raw string whose delimiter hashes to `hash`.
+int findRawStringEnd(QStringView text, int from, quint32 hash) {
+  const int n = static_cast<int>(text.size());
+  for (int i = from; i < n; ++i) {
+    if (text[i] != u')') {
+      continue;
+    }
+    const int limit = qMin(n, i + 2 + kMaxRawDelimiterLength);
+    for (int j = i + 1; j < limit; ++j) {
+      if (text[j] == u'"') {
+        if (rawDelimiterHash(text.sliced(i + 1, j - i - 1)) == hash) {
+          return j + 1;
+        }
+        break;
+      }
+    }
+  }
+  return -1;
+}
+
+int scanNumber(QStringView text, int from) {
+  const int n = static_cast<int>(text.size());
+  const bool hex = from + 1 < n && text[from] == u'0' &&
+                   (text[from + 1] == u'x' || text[from + 1] == u'X');
+  int i = from;
+  while (i < n) {
+    const QChar ch = text[i];
+    if (isAsciiAlnum(ch) || ch == u'_' || ch == u'.') {
+      ++i;
+      continue;
+    }
+    // C++14 digit separator: 1'000'000.
+    if (ch == u'\'' && i > from && i + 1 < n && isAsciiAlnum(text[i + 1])) {
+      ++i;
+      continue;
+    }
+    if ((ch == u'+' || ch == u'-') && i > from) {
+      const QChar prev = text[i - 1];
+      const bool exponent = hex ? (prev == u'p' || prev == u'P')
+                                : (prev == u'e' || prev == u'E');
+      if (exponent) {
+        ++i;
+        continue;
+      }
+    }
+    break;
+  }
+  return i;
+}
+
+bool isStringPrefix(QStringView word) {
+  return word == u"L" || word == u"u" || word == u"U" || word == u"u8";
+}
+
+bool isRawStringPrefix(QStringView word) {
+  return word == u"R" || word == u"LR" || word == u"uR" || word == u"UR" ||
+         word == u"u8R";
+}
+}  // namespace
+
+bool CppLexer::isLexerState(int state) {
+  return state == kStateNormal || (state & kStateMarker) != 0;
+}
+
+bool CppLexer::isInBlockComment(int state) {
+  return (state & kStateMarker) != 0 && (state & kModeMask) == kModeBlockComment;
+}
+
+bool CppLexer::lookupKeyword(QStringView word, TokenKind* outKind) {
+  const int length = static_cast<int>(word.size());
+  if (length < kMinKeywordLength || length > kMaxKeywordLength) {
+    return false;
+  }
+  const quint32 slot = keywordSlot(kKeywordSeed, length, [word](int i) {
+    return word[i].unicode();
+  });
+  const int index = kKeywordTable[slot];
+  if (index == 0) {
+    return false;
+  }
+  const KeywordEntry& entry = kKeywords[index - 1];
+  if (static_cast<int>(entry.word.size()) != length) {
+    return false;
+  }
+  for (int i = 0; i < length; ++i) {
+    if (word[i].unicode() != static_cast<unsigned char>(entry.word[i])) {
+      return false;
+    }
+  }
+  if (outKind) {
+    *outKind = entry.kind;
+  }
+  return true;
+}
+
+int CppLexer::lexLine(QStringView text, int previousState, QVector<Token>* tokens) {
+  const int n = static_cast<int>(text.size());
+  const auto push = [tokens](int start, int end, TokenKind kind) {
+    if (tokens && end > start) {
+      tokens->push_back(Token{start, end - start, kind});
+    }
+  };
+
+  int mode = kModeNormal;
+  bool inDirective = false;
+  quint32 rawHash = 0;
+  if ((previousState & kStateMarker) != 0) {
+    mode = previousState & kModeMask;
+    inDirective = (previousState & kPreprocessorFlag) != 0;
+    rawHash = (static_cast<quint32>(previousState) >> kRawDelimiterShift) &
+              kRawDelimiterMask;
+  }
+  if (inDirective) {
+    push(0, n, TokenKind::Preprocessor);
+  }
+
+  const bool endsWithBackslash = n > 0 && text[n - 1] == u'\\';
+  const auto finish = [&](int outMode, quint32 outRawHash) {
+    // A directive keeps going while its line is spliced with a backslash or
+    // while a comment/literal that started inside it is still open.
+    const bool directiveContinues =
+        inDirective && (outMode != kModeNormal || endsWithBackslash);
+    return makeState(outMode, directiveContinues, outRawHash);
+  };
+
+  int i = 0;
+  switch (mode) {
+    case kModeBlockComment: {
+      const int end = findBlockCommentEnd(text, 0);
+      if (end < 0) {
+        push(0, n, TokenKind::Comment);
+        return finish(kModeBlockComment, 0);
+      }
+      push(0, end, TokenKind::Comment);
+      i = end;
+      break;
+    }
+    case kModeRawString: {
+      const int end = findRawStringEnd(text, 0, rawHash);
+      if (end < 0) {
+        push(0, n, TokenKind::String);
+        return finish(kModeRawString, rawHash);
+      }
+      push(0, end, TokenKind::String);
+      i = end;
+      break;
+    }
+    case kModeLineComment:
+      push(0, n, TokenKind::Comment);
+      return finish(endsWithBackslash ? kModeLineComment : kModeNormal, 0);
+    case kModeString: {
+      bool escapedNewline = false;
+      const int end = scanQuoted(text, 0, u'"', &escapedNewline);
+      if (end < 0) {
+        push(0, n, TokenKind::String);
+        return finish(escapedNewline ? kModeString : kModeNormal, 0);
+      }
+      push(0, end, TokenKind::String);
+      i = end;
+      break;
+    }
+    default: {
+      int first = 0;
+      while (first < n && text[first].isSpace()) {
+        ++first;
+      }
+      if (first < n && text[first] == u'#') {
+        inDirective = true;
+        push(first, n, TokenKind::Preprocessor);
+        i = first + 1;
+      }
+      break;
+    }
+  }
+
+  while (i < n) {
+    const QChar ch = text[i];
+
+    if (ch == u'/' && i + 1 < n) {
+      const QChar next = text[i + 1];
+      if (next == u'/') {
+        push(i, n, TokenKind::Comment);
+        return finish(endsWithBackslash ? kModeLineComment : kModeNormal, 0);
+      }
+      if (next == u'*') {
+        const int end = findBlockCommentEnd(text, i + 2);
+        if (end < 0) {
+          push(i, n, TokenKind::Comment);
+          return finish(kModeBlockComment, 0);
+        }
+        push(i, end, TokenKind::Comment);
+        i = end;
+        continue;
+      }
+    }
+
+    if (ch == u'"' || ch == u'\'') {
+      bool escapedNewline = false;
+      const int end = scanQuoted(text, i + 1, ch, &escapedNewline);
+      if (end < 0) {
+        push(i, n, TokenKind::String);
+        const bool continues = escapedNewline && ch == u'"';
+        return finish(continues ? kModeString : kModeNormal, 0);
+      }
+      push(i, end, TokenKind::String);
+      i = end;
+      continue;
+    }
+
+    if (isDigit(ch) || (ch == u'.' && i + 1 < n && isDigit(text[i + 1]))) {
+      const int end = scanNumber(text, i);
+      push(i, end, TokenKind::Number);
+      i = end;
+      continue;
+    }
+
+    if (isIdentifierStart(ch)) {
+      int end = i + 1;
+      while (end < n && isIdentifierChar(text[end])) {
+        ++end;
+      }
+      const QStringView word = text.sliced(i, end - i);
+      const bool quoteFollows = end < n && text[end] == u'"';
+
+      if (quoteFollows && isRawStringPrefix(word)) {
+        int open = end + 1;
+        const int limit = qMin(n, open + kMaxRawDelimiterLength + 1);
+        while (open < limit && text[open] != u'(' && text[open] != u')' &&
+               text[open] != u'\\' && !text[open].isSpace() &&
+               text[open] != u'"') {
+          ++open;
+        }
+        if (open < limit && text[open] == u'(') {
+          const quint32 hash = rawDelimiterHash(text.sliced(end + 1, open - end - 1));
+          const int close = findRawStringEnd(text, open + 1, hash);
+          if (close < 0) {
+            push(i, n, TokenKind::String);
+            return finish(kModeRawString, hash);
+          }
+          push(i, close, TokenKind::String);
+          i = close;
+          continue;
+        }
+      }
+
+      if (end < n && (text[end] == u'"' || text[end] == u'\'') &&
+          isStringPrefix(word)) {
+        // Prefixed literal (L"..", u8"..", U'..'): colour the prefix too.
+        bool escapedNewline = false;
+        const QChar quote = text[end];
+        const int close = scanQuoted(text, end + 1, quote, &escapedNewline);
+        if (close < 0) {
+          push(i, n, TokenKind::String);
+          const bool continues = escapedNewline && quote == u'"';
+          return finish(continues ? kModeString : kModeNormal, 0);
+        }
+        push(i, close, TokenKind::String);
+        i = close;
+        continue;
+      }
+
+      TokenKind kind = TokenKind::Keyword;
+      if (!inDirective && lookupKeyword(word, &kind)) {
+        push(i, end, kind);
+      }
+      i = end;
+      continue;
+    }
+
+    ++i;
+  }
+
+  return finish(kModeNormal, 0);
+}
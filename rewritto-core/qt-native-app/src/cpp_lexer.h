@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QStringView>
+#include <QVector>
+
+// Single-pass C/C++ lexer for syntax highlighting. Lines are lexed one at a
+// time; whatever spills over to the next line (block comments, raw strings,
+// backslash-continued preprocessor directives, comments and strings) is
+// packed into an int suitable for QSyntaxHighlighter block state, so an edit
+// only re-lexes lines until the carried state settles again.
+class CppLexer final {
+ public:
+  enum class TokenKind : quint8 {
+    Keyword,
+    SketchIdentifier,
+    Preprocessor,
+    Comment,
+    String,
+    Number,
+  };
+  static constexpr int kTokenKindCount = 6;
+
+  struct Token final {
+    int start = 0;
+    int length = 0;
+    TokenKind kind = TokenKind::Keyword;
+  };
+
+  // State of a line that carries nothing over. Any state not produced by
+  // lexLine() (e.g. -1 for unhighlighted blocks) is treated the same way.
+  static constexpr int kStateNormal = 0;
+
+  // Lexes `text` starting in `previousState` and returns the state for the
+  // next line. Tokens are appended in source order; a Preprocessor token
+  // covers the rest of its line and the comment/string/number tokens that
+  // follow it take precedence.
+  static int lexLine(QStringView text,
+                     int previousState,
+                     QVector<Token>* tokens);
+
+  // True for states returned by lexLine(), including kStateNormal.
+  static bool isLexerState(int state);
+  static bool isInBlockComment(int state);
+
+  // Compile-time perfect hash over C++ keywords and Arduino sketch identifiers.
+  static bool lookupKeyword(QStringView word, TokenKind* outKind);
+};
@@ -0,0 +1,799 @@
+#include "debug_session.h"
+
+#include <QProcess>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+// gdb gets this long to honour -gdb-exit before it is killed.
+constexpr int kExitGraceMs = 1500;
+
+using Key = MiParser::Key;
+using Value = MiParser::Value;
+
+QString field(const Value& tuple, Key key) {
+  return tuple.value(key).toString();
+}
+
+// Tuples in a list, whether written as [{...}] or [frame={...}].
+QVector<Value> tuplesOf(const Value& list) {
+  QVector<Value> out;
+  if (list.kind() == Value::Kind::Tuple) {
+    out.push_back(list);
+    return out;
+  }
+  for (const Value item : list) {
+    if (item.kind() == Value::Kind::Tuple) {
+      out.push_back(item);
+    }
+  }
+  return out;
+}
+
+DebugSession::Frame frameFrom(const Value& tuple) {
+  DebugSession::Frame frame;
+  frame.level = tuple.value(Key::Level).toInt();
+  frame.function = field(tuple, Key::Func);
+  frame.file = field(tuple, Key::File);
+  frame.fullPath = field(tuple, Key::Fullname);
+  frame.line = tuple.value(Key::Line).toInt();
+  frame.address = field(tuple, Key::Addr);
+  return frame;
+}
+
+DebugSession::Variable variableFrom(const Value& tuple, const QString& expression) {
+  DebugSession::Variable var;
+  var.id = field(tuple, Key::Name);
+  var.expression = expression;
+  var.value = field(tuple, Key::Value);
+  var.type = field(tuple, Key::Type);
+  var.childCount = tuple.value(Key::Numchild).toInt();
+  if (field(tuple, Key::Dynamic) == QStringLiteral("1") &&
+      field(tuple, Key::HasMore) == QStringLiteral("1")) {
+    var.childCount = std::max(var.childCount, 1);
+  }
+  return var;
+}
+
+bool isError(const MiParser::Record& r) {
+  return r.type == MiParser::Record::Type::Result && r.klass == QStringLiteral("error");
+}
+
+}  // namespace
+
+// Lives on the session thread and owns everything that talks to gdb.
+// Results go back to the session as queued calls.
+class DebugEngine final : public QObject {
+ public:
+  using Handler = std::function<void(const MiParser::Record&)>;
+
+  explicit DebugEngine(DebugSession* session) : session_(session) {}
+
+  void start(const QString& program, const QStringList& arguments, const QString& workingDir);
+  void requestExit();
+  void killNow();
+  void send(const QString& command, Handler handler = {});
+  void sendForSession(const QString& command, int callbackId);
+  void selectFrame(int level);
+  void setWatches(const QStringList& expressions);
+  void listChildren(const QString& variableId, int callbackId);
+
+ private:
+  using State = DebugSession::State;
+
+  DebugSession* session_ = nullptr;
+  QProcess* process_ = nullptr;
+  MiParser parser_;
+  State state_ = State::NotStarted;
+  int nextToken_ = 1;
+  QHash<int, Handler> pending_;
+  QByteArray outbox_;
+  bool flushQueued_ = false;
+
+  DebugSession::StopInfo stop_;
+  QVector<DebugSession::Frame> frames_;
+  QVector<DebugSession::Thread> threads_;
+  QVector<DebugSession::Variable> locals_;
+  QString localsScope_;  // thread/frame/function the locals belong to
+  int selectedFrame_ = 0;
+  QStringList watchExpressions_;  // survive restarts
+  QVector<DebugSession::Variable> watches_;
+  int refreshPending_ = 0;
+  bool staleLocals_ = false;
+
+  template <typename Fn>
+  void toSession(Fn&& fn) {
+    QMetaObject::invokeMethod(session_, std::forward<Fn>(fn), Qt::QueuedConnection);
+  }
+
+  void setState(State state);
+  void flush();
+  void handleOutput(const QByteArray& data);
+  void handleStopped(const MiParser::Record& r);
+  void refreshStop();
+  // A command whose result is part of the current snapshot. The handler
+  // sees errors too.
+  void sendRefresh(const QString& command, Handler handler);
+  QString threadFrameOptions(int level) const;
+  QString scopeKey(int level, const QString& function, const QString& file) const;
+  void rebindLocals(int level);
+  void createWatches();
+  void applyChangelist(const MiParser::Record& r);
+  void publish();
+};
+
+void DebugEngine::start(const QString& program,
+                        const QStringList& arguments,
+                        const QString& workingDir) {
+  parser_.reset();
+  pending_.clear();
+  outbox_.clear();
+  refreshPending_ = 0;
+  staleLocals_ = false;
+  stop_ = {};
+  frames_.clear();
+  threads_.clear();
+  locals_.clear();
+  localsScope_.clear();
+  selectedFrame_ = 0;
+  watches_.clear();
+  for (const QString& expression : std::as_const(watchExpressions_)) {
+    DebugSession::Variable var;
+    var.expression = expression;
+    watches_.push_back(var);
+  }
+
+  process_ = new QProcess(this);
+  QProcess* process = process_;
+  if (!workingDir.isEmpty()) {
+    process->setWorkingDirectory(workingDir);
+  }
+  connect(process, &QProcess::readyReadStandardOutput, this,
+          [this, process] { handleOutput(process->readAllStandardOutput()); });
+  connect(process, &QProcess::readyReadStandardError, this, [this, process] {
+    const QString text = QString::fromLocal8Bit(process->readAllStandardError());
+    toSession([s = session_, text] { emit s->consoleOutput(text); });
+  });
+  connect(process, &QProcess::finished, this,
+          [this, process](int exitCode, QProcess::ExitStatus status) {
+            handleOutput(process->readAllStandardOutput());
+            pending_.clear();
+            setState(State::Exited);
+            const QString message =
+                status == QProcess::CrashExit
+                    ? QObject::tr("Debugger crashed.")
+                    : QObject::tr("Debugger exited with code %1.").arg(exitCode);
+            toSession([s = session_, message] { emit s->exited(message); });
+          });
+  connect(process, &QProcess::errorOccurred, this,
+          [this, process](QProcess::ProcessError error) {
+            if (error != QProcess::FailedToStart) {
+              return;
+            }
+            setState(State::Exited);
+            const QString message = process->errorString();
+            toSession([s = session_, message] { emit s->exited(message); });
+          });
+
+  setState(State::Starting);
+  process->start(program, arguments);
+  send(QStringLiteral("-gdb-set confirm off"));
+  send(QStringLiteral("-enable-pretty-printing"));
+  send(QStringLiteral("-list-features"), [this](const MiParser::Record&) {
+    if (state_ == State::Starting) {
+      setState(State::Idle);
+    }
+  });
+}
+
+void DebugEngine::requestExit() {
+  if (!process_ || process_->state() == QProcess::NotRunning) {
+    return;
+  }
+  send(QStringLiteral("-gdb-exit"));
+  // Tied to the process: killNow() deleting it cancels the timer.
+  QTimer::singleShot(kExitGraceMs, process_, [process = process_] {
+    if (process->state() != QProcess::NotRunning) {
+      process->kill();
+    }
+  });
+}
+
+void DebugEngine::killNow() {
+  if (!process_) {
+    return;
+  }
+  process_->disconnect(this);
+  if (process_->state() != QProcess::NotRunning) {
+    process_->kill();
+    (void)process_->waitForFinished(1000);
+  }
+  delete process_;
+  process_ = nullptr;
+}
+
+void DebugEngine::send(const QString& command, Handler handler) {
+  const int token = nextToken_++;
+  if (!handler) {
+    handler = [this, command](const MiParser::Record& r) {
+      if (isError(r)) {
+        const QString text =
+            QObject::tr("%1: %2\n").arg(command, field(r.results, Key::Msg));
+        toSession([s = session_, text] { emit s->consoleOutput(text); });
+      }
+    };
+  }
+  pending_.insert(token, std::move(handler));
+  outbox_ += QByteArray::number(token);
+  outbox_ += command.toUtf8();
+  outbox_ += '\n';
+  if (!flushQueued_) {
+    flushQueued_ = true;
+    QMetaObject::invokeMethod(this, [this] { flush(); }, Qt::QueuedConnection);
+  }
+}
+
+void DebugEngine::flush() {
+  flushQueued_ = false;
+  if (process_ && process_->state() != QProcess::NotRunning && !outbox_.isEmpty()) {
+    process_->write(outbox_);
+  }
+  outbox_.clear();
+}
+
+void DebugEngine::sendForSession(const QString& command, int callbackId) {
+  if (callbackId == 0) {
+    send(command);
+    return;
+  }
+  send(command, [this, callbackId](const MiParser::Record& r) {
+    toSession([s = session_, callbackId, r] { s->deliverResult(callbackId, r); });
+  });
+}
+
+void DebugEngine::setState(State state) {
+  if (state_ == state) {
+    return;
+  }
+  state_ = state;
+  toSession([s = session_, state] { s->setState(state); });
+}
+
+void DebugEngine::handleOutput(const QByteArray& data) {
+  if (data.isEmpty()) {
+    return;
+  }
+  QString console;
+  const QList<MiParser::Record> records = parser_.feed(data);
+  for (const MiParser::Record& r : records) {
+    switch (r.type) {
+      case MiParser::Record::Type::Console:
+      case MiParser::Record::Type::Target:
+      case MiParser::Record::Type::Log:
+        console += r.streamText;
+        break;
+      case MiParser::Record::Type::Result: {
+        const Handler handler = pending_.take(r.token);
+        if (handler) {
+          handler(r);
+        }
+        break;
+      }
+      case MiParser::Record::Type::ExecAsync:
+        if (r.klass == QStringLiteral("running")) {
+          setState(State::Running);
+        } else if (r.klass == QStringLiteral("stopped")) {
+          handleStopped(r);
+        }
+        break;
+      case MiParser::Record::Type::Unknown:
+        // Output of the program being debugged shares the pipe.
+        if (!r.raw.isEmpty()) {
+          console += r.rawText() + QLatin1Char('\n');
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  if (!console.isEmpty()) {
+    toSession([s = session_, console] { emit s->consoleOutput(console); });
+  }
+}
+
+void DebugEngine::handleStopped(const MiParser::Record& r) {
+  stop_ = {};
+  stop_.stopNs = DebugSession::steadyNowNs();
+  stop_.reason = field(r.results, Key::Reason);
+  stop_.threadId = field(r.results, Key::ThreadId);
+  stop_.frame = frameFrom(r.results.value(Key::Frame));
+  bool ok = false;
+  const int bkpt = r.results.value(Key::Bkptno).toInt(&ok);
+  stop_.breakpointId = ok ? bkpt : -1;
+
+  if (stop_.reason.startsWith(QStringLiteral("exited"))) {
+    // The program ended; gdb itself stays up, and so do the locals'
+    // var-objects unless they are deleted.
+    for (const auto& var : std::as_const(locals_)) {
+      send(QStringLiteral("-var-delete ") + DebugSession::quoteArgument(var.id));
+    }
+    frames_.clear();
+    threads_.clear();
+    locals_.clear();
+    localsScope_.clear();
+    setState(State::Idle);
+    const QString code = field(r.results, Key::ExitCode);
+    const QString text = code.isEmpty()
+                             ? QObject::tr("Program exited normally.\n")
+                             : QObject::tr("Program exited with code %1.\n").arg(code);
+    toSession([s = session_, text] { emit s->consoleOutput(text); });
+    return;
+  }
+
+  selectedFrame_ = 0;
+  setState(State::Stopped);
+  toSession([s = session_, info = stop_] { emit s->stopped(info); });
+  refreshStop();
+}
+
+void DebugEngine::refreshStop() {
+  for (auto& var : locals_) {
+    var.changed = false;
+  }
+  for (auto& var : watches_) {
+    var.changed = false;
+  }
+
+  // Everything goes out in one write; gdb answers in order.
+  const QString key = scopeKey(0, stop_.frame.function, stop_.frame.fullPath);
+  const bool rebind = key != localsScope_;
+  if (rebind) {
+    for (const auto& var : std::as_const(locals_)) {
+      send(QStringLiteral("-var-delete ") + DebugSession::quoteArgument(var.id));
+    }
+    locals_.clear();
+  }
+  sendRefresh(QStringLiteral("-stack-list-frames") + threadFrameOptions(-1),
+              [this](const MiParser::Record& r) {
+                frames_.clear();
+                if (isError(r)) {
+                  return;
+                }
+                for (const Value& tuple : tuplesOf(r.results.value(Key::Stack))) {
+                  frames_.push_back(frameFrom(tuple));
+                }
+              });
+  sendRefresh(QStringLiteral("-thread-info"), [this](const MiParser::Record& r) {
+    threads_.clear();
+    if (isError(r)) {
+      return;
+    }
+    for (const Value& tuple : tuplesOf(r.results.value(Key::Threads))) {
+      DebugSession::Thread thread;
+      thread.id = field(tuple, Key::Id);
+      thread.targetId = field(tuple, Key::TargetId);
+      thread.details = field(tuple, Key::Details);
+      if (thread.details.isEmpty()) {
+        thread.details = field(tuple, Key::Name);
+      }
+      thread.state = field(tuple, Key::State);
+      thread.frame = frameFrom(tuple.value(Key::Frame));
+      threads_.push_back(thread);
+    }
+  });
+  sendRefresh(QStringLiteral("-var-update --all-values *"),
+              [this](const MiParser::Record& r) { applyChangelist(r); });
+  if (rebind) {
+    localsScope_ = key;
+    rebindLocals(0);
+  }
+  createWatches();
+}
+
+void DebugEngine::sendRefresh(const QString& command, Handler handler) {
+  ++refreshPending_;
+  send(command, [this, handler = std::move(handler)](const MiParser::Record& r) {
+    handler(r);
+    if (--refreshPending_ == 0) {
+      if (staleLocals_) {
+        // A local went out of scope although the function matched: a
+        // different activation (recursion). Bind to the current one.
+        staleLocals_ = false;
+        for (const auto& var : std::as_const(locals_)) {
+          send(QStringLiteral("-var-delete ") + DebugSession::quoteArgument(var.id));
+        }
+        locals_.clear();
+        rebindLocals(selectedFrame_);
+        return;
+      }
+      publish();
+    }
+  });
+}
+
+QString DebugEngine::threadFrameOptions(int level) const {
+  QString out;
+  if (!stop_.threadId.isEmpty()) {
+    out += QStringLiteral(" --thread ") + stop_.threadId;
+  }
+  if (level >= 0) {
+    out += QStringLiteral(" --frame ") + QString::number(level);
+  }
+  return out;
+}
+
+QString DebugEngine::scopeKey(int level, const QString& function, const QString& file) const {
+  return stop_.threadId + QLatin1Char('/') + QString::number(level) + QLatin1Char('/') +
+         function + QLatin1Char('@') + file;
+}
+
+void DebugEngine::rebindLocals(int level) {
+  sendRefresh(QStringLiteral("-stack-list-variables") + threadFrameOptions(level) +
+                  QStringLiteral(" --no-values"),
+              [this, level](const MiParser::Record& r) {
+                for (const Value& tuple : tuplesOf(r.results.value(Key::Variables))) {
+                  const QString name = field(tuple, Key::Name);
+                  if (name.isEmpty()) {
+                    continue;
+                  }
+                  sendRefresh(QStringLiteral("-var-create") + threadFrameOptions(level) +
+                                  QStringLiteral(" - * ") + DebugSession::quoteArgument(name),
+                              [this, name](const MiParser::Record& created) {
+                                if (isError(created)) {
+                                  return;
+                                }
+                                locals_.push_back(variableFrom(created.results, name));
+                              });
+                }
+              });
+}
+
+void DebugEngine::createWatches() {
+  for (qsizetype i = 0; i < watches_.size(); ++i) {
+    if (!watches_.at(i).id.isEmpty()) {
+      continue;
+    }
+    const QString expression = watches_.at(i).expression;
+    // Floating ("@") objects follow whichever frame is selected.
+    sendRefresh(QStringLiteral("-var-create - @ ") + DebugSession::quoteArgument(expression),
+                [this, expression](const MiParser::Record& r) {
+                  for (auto& watch : watches_) {
+                    if (watch.expression != expression || !watch.id.isEmpty()) {
+                      continue;
+                    }
+                    if (isError(r)) {
+                      // Retried on the next stop; the frame may differ then.
+                      watch.value = field(r.results, Key::Msg);
+                      watch.inScope = false;
+                    } else {
+                      watch = variableFrom(r.results, expression);
+                    }
+                    break;
+                  }
+                });
+  }
+}
+
+void DebugEngine::applyChangelist(const MiParser::Record& r) {
+  for (const Value& change : tuplesOf(r.results.value(Key::Changelist))) {
+    const QString id = field(change, Key::Name);
+    const QString inScope = field(change, Key::InScope);
+    auto apply = [&](QVector<DebugSession::Variable>& vars, bool isLocal) {
+      for (auto& var : vars) {
+        if (var.id != id) {
+          continue;
+        }
+        if (inScope == QStringLiteral("invalid")) {
+          // The expression no longer makes sense (e.g. reloaded binary).
+          var.id.clear();
+          var.inScope = false;
+          return true;
+        }
+        var.inScope = inScope != QStringLiteral("false");
+        if (isLocal && !var.inScope) {
+          staleLocals_ = true;
+        }
+        if (change.contains(Key::Value)) {
+          var.value = field(change, Key::Value);
+        }
+        if (field(change, Key::TypeChanged) == QStringLiteral("true")) {
+          var.type = field(change, Key::NewType);
+          var.childCount = change.value(Key::NewNumChildren).toInt();
+        }
+        var.changed = true;
+        return true;
+      }
+      return false;
+    };
+    if (!apply(locals_, true)) {
+      apply(watches_, false);
+    }
+  }
+}
+
+void DebugEngine::publish() {
+  toSession([s = session_, info = stop_, frames = frames_, threads = threads_, locals = locals_,
+             watches = watches_, level = selectedFrame_] {
+    s->deliverSnapshot(info, frames, threads, locals, watches, level);
+  });
+}
+
+void DebugEngine::selectFrame(int level) {
+  if (state_ != State::Stopped || level < 0 || level >= frames_.size() ||
+      level == selectedFrame_) {
+    return;
+  }
+  selectedFrame_ = level;
+  const DebugSession::Frame& frame = frames_.at(level);
+  for (const auto& var : std::as_const(locals_)) {
+    send(QStringLiteral("-var-delete ") + DebugSession::quoteArgument(var.id));
+  }
+  locals_.clear();
+  localsScope_ = scopeKey(level, frame.function, frame.fullPath);
+  send(QStringLiteral("-stack-select-frame") + threadFrameOptions(-1) + QLatin1Char(' ') +
+       QString::number(level));
+  sendRefresh(QStringLiteral("-var-update --all-values *"),
+              [this](const MiParser::Record& r) { applyChangelist(r); });
+  rebindLocals(level);
+}
+
+void DebugEngine::setWatches(const QStringList& expressions) {
+  watchExpressions_ = expressions;
+  QVector<DebugSession::Variable> kept;
+  for (const auto& watch : std::as_const(watches_)) {
+    if (expressions.contains(watch.expression)) {
+      kept.push_back(watch);
+    } else if (!watch.id.isEmpty()) {
+      send(QStringLiteral("-var-delete ") + DebugSession::quoteArgument(watch.id));
+    }
+  }
+  QVector<DebugSession::Variable> ordered;
+  for (const QString& expression : expressions) {
+    auto it = std::find_if(kept.begin(), kept.end(), [&](const DebugSession::Variable& v) {
+      return v.expression == expression;
+    });
+    if (it != kept.end()) {
+      ordered.push_back(*it);
+    } else {
+      DebugSession::Variable var;
+      var.expression = expression;
+      ordered.push_back(var);
+    }
+  }
+  watches_ = ordered;
+  if (state_ == State::Stopped) {
+    // Creating the new ones completes a (small) snapshot of its own.
+    ++refreshPending_;
+    createWatches();
+    send(QStringLiteral("-list-features"), [this](const MiParser::Record&) {
+      if (--refreshPending_ == 0) {
+        publish();
+      }
+    });
+  }
+}
+
+void DebugEngine::listChildren(const QString& variableId, int callbackId) {
+  send(QStringLiteral("-var-list-children --all-values ") +
+           DebugSession::quoteArgument(variableId),
+       [this, callbackId](const MiParser::Record& r) {
+         QVector<DebugSession::Variable> children;
+         for (const Value& tuple : tuplesOf(r.results.value(Key::Children))) {
+           children.push_back(variableFrom(tuple, field(tuple, Key::Exp)));
+         }
+         toSession([s = session_, callbackId, children] {
+           s->deliverChildren(callbackId, children);
+         });
+       });
+}
+
+// --- DebugSession ----------------------------------------------------------
+
+DebugSession::DebugSession(QObject* parent) : QObject(parent) {
+  thread_ = new QThread(this);
+  thread_->setObjectName(QStringLiteral("DebugSession"));
+  engine_ = new DebugEngine(this);
+  engine_->moveToThread(thread_);
+  connect(thread_, &QThread::finished, engine_, &QObject::deleteLater);
+  thread_->start();
+}
+
+DebugSession::~DebugSession() {
+  QMetaObject::invokeMethod(engine_, [e = engine_] { e->killNow(); },
+                            Qt::BlockingQueuedConnection);
+  thread_->quit();
+  thread_->wait();
+}
+
+template <typename Fn>
+void DebugSession::post(Fn&& fn) {
+  QMetaObject::invokeMethod(engine_, std::forward<Fn>(fn), Qt::QueuedConnection);
+}
+
+void DebugSession::start(const QString& program,
+                         const QStringList& arguments,
+                         const QString& workingDirectory) {
+  if (isActive()) {
+    return;
+  }
+  callbacks_.clear();
+  childCallbacks_.clear();
+  lastStop_ = {};
+  frames_.clear();
+  threads_.clear();
+  locals_.clear();
+  watches_.clear();
+  selectedFrame_ = 0;
+  setState(State::Starting);
+  post([e = engine_, program, arguments, workingDirectory] {
+    e->killNow();
+    e->start(program, arguments, workingDirectory);
+  });
+}
+
+void DebugSession::stop() {
+  post([e = engine_] { e->requestExit(); });
+}
+
+DebugSession::State DebugSession::state() const {
+  return state_;
+}
+
+bool DebugSession::isActive() const {
+  return state_ != State::NotStarted && state_ != State::Exited;
+}
+
+void DebugSession::sendCommand(const QString& command, ResultCallback onResult) {
+  int id = 0;
+  if (onResult) {
+    id = nextCallbackId_++;
+    callbacks_.insert(id, std::move(onResult));
+  }
+  post([e = engine_, command, id] { e->sendForSession(command, id); });
+}
+
+void DebugSession::execRun() {
+  sendCommand(QStringLiteral("-exec-run"));
+}
+
+void DebugSession::execContinue() {
+  sendCommand(QStringLiteral("-exec-continue"));
+}
+
+void DebugSession::execNext() {
+  sendCommand(QStringLiteral("-exec-next"));
+}
+
+void DebugSession::execStep() {
+  sendCommand(QStringLiteral("-exec-step"));
+}
+
+void DebugSession::execFinish() {
+  sendCommand(QStringLiteral("-exec-finish"));
+}
+
+void DebugSession::execInterrupt() {
+  sendCommand(QStringLiteral("-exec-interrupt"));
+}
+
+void DebugSession::insertBreakpoint(const QString& file,
+                                    int line,
+                                    const QString& condition,
+                                    ResultCallback onResult) {
+  QString command = QStringLiteral("-break-insert -f");
+  if (!condition.trimmed().isEmpty()) {
+    command += QStringLiteral(" -c ") + quoteArgument(condition.trimmed());
+  }
+  command += QLatin1Char(' ') + quoteArgument(file + QLatin1Char(':') + QString::number(line));
+  sendCommand(command, std::move(onResult));
+}
+
+void DebugSession::deleteBreakpoint(int id) {
+  sendCommand(QStringLiteral("-break-delete ") + QString::number(id));
+}
+
+void DebugSession::selectFrame(int level) {
+  post([e = engine_, level] { e->selectFrame(level); });
+}
+
+void DebugSession::setWatches(const QStringList& expressions) {
+  post([e = engine_, expressions] { e->setWatches(expressions); });
+}
+
+void DebugSession::listChildren(const QString& variableId,
+                                std::function<void(QVector<Variable> children)> onChildren) {
+  const int id = nextCallbackId_++;
+  childCallbacks_.insert(id, std::move(onChildren));
+  post([e = engine_, variableId, id] { e->listChildren(variableId, id); });
+}
+
+const DebugSession::StopInfo& DebugSession::lastStop() const {
+  return lastStop_;
+}
+
+const QVector<DebugSession::Frame>& DebugSession::frames() const {
+  return frames_;
+}
+
+const QVector<DebugSession::Thread>& DebugSession::threads() const {
+  return threads_;
+}
+
+const QVector<DebugSession::Variable>& DebugSession::locals() const {
+  return locals_;
+}
+
+const QVector<DebugSession::Variable>& DebugSession::watches() const {
+  return watches_;
+}
+
+int DebugSession::selectedFrame() const {
+  return selectedFrame_;
+}
+
+QString DebugSession::quoteArgument(const QString& text) {
+  QString out;
+  out.reserve(text.size() + 2);
+  out += QLatin1Char('"');
+  for (const QChar ch : text) {
+    if (ch == QLatin1Char('"') || ch == QLatin1Char('\\')) {
+      out += QLatin1Char('\\');
+    }
+    out += ch;
+  }
+  out += QLatin1Char('"');
+  return out;
+}
+
+qint64 DebugSession::steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void DebugSession::setState(State state) {
+  if (state_ == state) {
+    return;
+  }
+  state_ = state;
+  if (state == State::Running || state == State::Idle || state == State::Exited) {
+    frames_.clear();
+    threads_.clear();
+    locals_.clear();
+  }
+  emit stateChanged(state);
+}
+
+void DebugSession::deliverResult(int callbackId, const MiParser::Record& result) {
+  const ResultCallback callback = callbacks_.take(callbackId);
+  if (callback) {
+    callback(result);
+  }
+}
+
+void DebugSession::deliverChildren(int callbackId, const QVector<Variable>& children) {
+  const auto callback = childCallbacks_.take(callbackId);
+  if (callback) {
+    callback(children);
+  }
+}
+
+void DebugSession::deliverSnapshot(const StopInfo& info,
+                                   const QVector<Frame>& frames,
+                                   const QVector<Thread>& threads,
+                                   const QVector<Variable>& locals,
+                                   const QVector<Variable>& watches,
+                                   int selectedFrame) {
+  lastStop_ = info;
+  frames_ = frames;
+  threads_ = threads;
+  locals_ = locals;
+  watches_ = watches;
+  selectedFrame_ = selectedFrame;
+  emit snapshotReady(info);
+}
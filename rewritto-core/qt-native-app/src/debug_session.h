@@ -0,0 +1,162 @@
+#pragma once
+
+#include "mi_parser.h"
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class DebugEngine;
+class QThread;
+
+// A gdb session over GDB/MI: plain gdb, or `arduino-cli debug --interpreter
+// mi2`, which speaks the same protocol. The process, MI parsing and the
+// bookkeeping below run on a thread of their own; this object only receives
+// finished results.
+//
+// Locals and watches are gdb variable objects. On each stop one batch of
+// commands is written (stack, threads, `-var-update *`), so gdb reports just
+// the values that changed instead of the IDE re-listing every local. Locals
+// are re-created only when the selected frame is a different function
+// activation. snapshotReady() fires once everything for a stop has arrived.
+class DebugSession final : public QObject {
+  Q_OBJECT
+
+ public:
+  enum class State {
+    NotStarted,
+    Starting,
+    Idle,  // gdb is up, the program is not running
+    Running,
+    Stopped,
+    Exited,
+  };
+
+  struct Frame final {
+    int level = 0;
+    QString function;
+    QString file;
+    QString fullPath;
+    int line = 0;
+    QString address;
+  };
+
+  struct Variable final {
+    QString id;          // variable object name; empty if it could not be created
+    QString expression;  // local name or watch expression
+    QString value;       // or the error for a watch that can't be evaluated
+    QString type;
+    int childCount = 0;
+    bool inScope = true;
+    bool changed = false;  // since the previous stop
+  };
+
+  struct Thread final {
+    QString id;
+    QString targetId;
+    QString details;
+    QString state;
+    Frame frame;
+  };
+
+  struct StopInfo final {
+    QString reason;
+    QString threadId;
+    Frame frame;
+    int breakpointId = -1;
+    // Steady-clock time the *stopped record was read, for latency checks.
+    qint64 stopNs = 0;
+  };
+
+  using ResultCallback = std::function<void(const MiParser::Record& result)>;
+
+  explicit DebugSession(QObject* parent = nullptr);
+  ~DebugSession() override;
+
+  void start(const QString& program,
+             const QStringList& arguments,
+             const QString& workingDirectory = {});
+  // Asks gdb to exit, killing it if it does not.
+  void stop();
+  State state() const;
+  bool isActive() const;
+
+  // Sends one MI command; `onResult` gets its ^done/^error/... record on
+  // this object's thread. Commands issued in one event-loop turn reach gdb
+  // in a single write.
+  void sendCommand(const QString& command, ResultCallback onResult = {});
+
+  void execRun();
+  void execContinue();
+  void execNext();
+  void execStep();
+  void execFinish();
+  void execInterrupt();
+  void insertBreakpoint(const QString& file,
+                        int line,
+                        const QString& condition = {},
+                        ResultCallback onResult = {});
+  void deleteBreakpoint(int id);
+
+  // Binds locals to another frame of the stopped thread.
+  void selectFrame(int level);
+  void setWatches(const QStringList& expressions);
+  // One level of children of a local or watch.
+  void listChildren(const QString& variableId,
+                    std::function<void(QVector<Variable> children)> onChildren);
+
+  const StopInfo& lastStop() const;
+  const QVector<Frame>& frames() const;
+  const QVector<Thread>& threads() const;
+  const QVector<Variable>& locals() const;
+  const QVector<Variable>& watches() const;
+  int selectedFrame() const;
+
+  // MI c-string quoting, for file names and expressions in commands.
+  static QString quoteArgument(const QString& text);
+  // The clock StopInfo::stopNs is taken from.
+  static qint64 steadyNowNs();
+
+ signals:
+  void stateChanged(DebugSession::State state);
+  // Console, target and log stream output, and errors of commands that had
+  // no callback.
+  void consoleOutput(QString text);
+  void stopped(DebugSession::StopInfo info);
+  // Stack, threads, locals and watches are current for `info`.
+  void snapshotReady(DebugSession::StopInfo info);
+  void exited(QString message);
+
+ private:
+  friend class DebugEngine;
+
+  QThread* thread_ = nullptr;
+  DebugEngine* engine_ = nullptr;
+  State state_ = State::NotStarted;
+  int nextCallbackId_ = 1;
+  QHash<int, ResultCallback> callbacks_;
+  QHash<int, std::function<void(QVector<Variable>)>> childCallbacks_;
+
+  StopInfo lastStop_;
+  QVector<Frame> frames_;
+  QVector<Thread> threads_;
+  QVector<Variable> locals_;
+  QVector<Variable> watches_;
+  int selectedFrame_ = 0;
+
+  void setState(State state);
+  void deliverResult(int callbackId, const MiParser::Record& result);
+  void deliverChildren(int callbackId, const QVector<Variable>& children);
+  void deliverSnapshot(const StopInfo& info,
+                       const QVector<Frame>& frames,
+                       const QVector<Thread>& threads,
+                       const QVector<Variable>& locals,
+                       const QVector<Variable>& watches,
+                       int selectedFrame);
+  template <typename Fn>
+  void post(Fn&& fn);
+};
@@ -449,9 +449,32 @@ bool EditorWidget::openFile(const QString& filePath) {
   connect(timer, &QTimer::timeout, this, [this, editor] {
     const QString path = filePathFor(editor);
     if (!path.isEmpty()) {
-      emit documentChanged(path, editor->toPlainText());
+      emit documentChanged(path);
     }
   });
+  connect(editor->document(), &QTextDocument::contentsChange, this,
+          [this, editor](int position, int charsRemoved, int charsAdded) {
+            const QString path = filePathFor(editor);
+            if (path.isEmpty()) {
+              return;
+            }
+            // Ranges may include the document's trailing block separator,
+            // which is not part of toPlainText(); drop it from both sides.
+            const int docLength = editor->document()->characterCount() - 1;
+            const int overflow = std::max(0, position + charsAdded - docLength);
+            charsAdded -= overflow;
+            charsRemoved = std::max(0, charsRemoved - overflow);
+
+            QString inserted;
+            if (charsAdded > 0) {
+              QTextCursor cursor(editor->document());
+              cursor.setPosition(position);
+              cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+              inserted = cursor.selectedText();
+              inserted.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+            }
+            emit documentContentsChanged(path, position, charsRemoved, inserted);
+          });
 
   const int index = tabs_->addTab(editor, QFileInfo(absPath).fileName());
   if (largeFileMode) {
@@ -1134,6 +1157,7 @@ bool EditorWidget::saveEditorAs(QPlainTextEdit* editor, const QString& filePath)
   }
 
   watchFilePath(absPath);
+  emit documentSaved(absPath);
   return true;
 }
 
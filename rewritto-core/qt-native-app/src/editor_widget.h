@@ -90,7 +90,15 @@ class EditorWidget final : public QWidget {
 
  signals:
   void documentOpened(QString filePath, QString text);
-  void documentChanged(QString filePath, QString text);
+  void documentChanged(QString filePath);
+  // The document was written to `filePath`.
+  void documentSaved(QString filePath);
+  // Fine-grained edit in UTF-16 offsets of the plain text, for incremental
+  // consumers such as the language server.
+  void documentContentsChanged(QString filePath,
+                               int position,
+                               int charsRemoved,
+                               QString insertedText);
   void documentClosed(QString filePath);
   void currentFileChanged(QString filePath);
   void newTabRequested();
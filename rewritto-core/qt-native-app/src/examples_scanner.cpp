@@ -1,13 +1,29 @@
 #include "examples_scanner.h"
 
 #include <algorithm>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
+#include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
 #include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
 #include <QVersionNumber>
 
 namespace {
+constexpr quint32 kCacheMagic = 0x52574558;  // "RWEX"
+constexpr qint32 kCacheFormat = 2;
+// Directories modified this close to the walk may change again within the
+// same mtime tick, so their listing is recorded and compared as well.
+constexpr qint64 kRacyMtimeWindowMs = 2000;
+
 QString defaultSketchbookDir() {
   QString baseDir = QDir::homePath();
 #if defined(Q_OS_WIN)
@@ -97,24 +113,112 @@ QString bestVersionDir(QStringList versions) {
   return best.name;
 }
 
-void collectExamplesRoot(const QString& examplesRoot,
-                         const QStringList& prefix,
-                         QVector<ExampleSketch>* out) {
-  if (!out) {
-    return;
+// A directory whose examples are listed under `prefix` in the menus.
+struct ExamplesRoot final {
+  QString path;
+  QStringList prefix;
+};
+
+struct DirStamp final {
+  QString path;
+  qint64 modifiedMs = -1;
+  QByteArray listingHash;  // of the entry names, for racy directories only
+};
+
+struct IndexedExample final {
+  QStringList segments;  // menu path below the root's prefix
+  QString folderPath;
+  QString inoPath;
+};
+
+// What one walk of a root found, and the directories it looked at.
+struct IndexedRoot final {
+  QString path;
+  QVector<DirStamp> dirs;
+  QVector<IndexedExample> examples;
+};
+
+qint64 modifiedMs(const QFileInfo& info) {
+  return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+void addRoot(const QString& path, QStringList prefix, QVector<ExamplesRoot>* out) {
+  if (QFileInfo(path).isDir()) {
+    out->push_back({path, std::move(prefix)});
   }
-  const QFileInfo rootInfo(examplesRoot);
-  if (!rootInfo.exists() || !rootInfo.isDir()) {
-    return;
+}
+
+void addLibraryRoots(const QDir& libsDir, const QStringList& prefix, QVector<ExamplesRoot>* out) {
+  const QStringList libs = libsDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  for (const QString& libName : libs) {
+    addRoot(libsDir.absoluteFilePath(libName) + QStringLiteral("/examples"),
+            prefix + QStringList{libName}, out);
+  }
+}
+
+// Lists the examples roots without descending into them; only the package
+// and library directories are read.
+QVector<ExamplesRoot> collectRoots(const ExamplesScanner::Options& options) {
+  QVector<ExamplesRoot> roots;
+  if (!options.builtinDir.isEmpty()) {
+    addRoot(options.builtinDir, {QStringLiteral("Built-in Examples")}, &roots);
+  }
+
+  const QDir packagesDir(QDir(options.dataDir).absoluteFilePath(QStringLiteral("packages")));
+  const QStringList vendors =
+      packagesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  for (const QString& vendor : vendors) {
+    const QDir hardwareDir(packagesDir.absoluteFilePath(vendor) + QStringLiteral("/hardware"));
+    const QStringList archs =
+        hardwareDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString& arch : archs) {
+      const QDir archDir(hardwareDir.absoluteFilePath(arch));
+      const QString best =
+          bestVersionDir(archDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name));
+      if (best.isEmpty()) {
+        continue;
+      }
+      const QString coreId = vendor + QLatin1Char(':') + arch;
+      addLibraryRoots(QDir(archDir.absoluteFilePath(best) + QStringLiteral("/libraries")),
+                      {QStringLiteral("Core Libraries"), coreId}, &roots);
+    }
   }
 
+  const QDir sketchbook(options.sketchbookDir);
+  addLibraryRoots(QDir(sketchbook.absoluteFilePath(QStringLiteral("libraries"))),
+                  {QStringLiteral("Libraries")}, &roots);
+  addRoot(sketchbook.absoluteFilePath(QStringLiteral("examples")), {QStringLiteral("Sketchbook")},
+          &roots);
+  return roots;
+}
+
+constexpr QDir::Filters kWalkFilters = QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot;
+
+QByteArray listingHash(QStringList names) {
+  names.sort();
+  return QCryptographicHash::hash(names.join(QLatin1Char('/')).toUtf8(),
+                                  QCryptographicHash::Sha1);
+}
+
+IndexedRoot walkRoot(const QString& examplesRoot) {
+  const qint64 startedMs = QDateTime::currentMSecsSinceEpoch();
+  IndexedRoot indexed;
+  indexed.path = examplesRoot;
+  indexed.dirs.push_back({examplesRoot, modifiedMs(QFileInfo(examplesRoot)), {}});
+
   QHash<QString, QStringList> folderToInos;
-  QDirIterator it(examplesRoot, QStringList{QStringLiteral("*.ino")}, QDir::Files,
-                  QDirIterator::Subdirectories);
+  // Entry names as the walk saw them, by directory.
+  QHash<QString, QStringList> listings;
+  QDirIterator it(examplesRoot, kWalkFilters, QDirIterator::Subdirectories);
   while (it.hasNext()) {
-    const QString ino = it.next();
-    const QString folder = QFileInfo(ino).absolutePath();
-    folderToInos[folder].push_back(ino);
+    it.next();
+    const QFileInfo info = it.fileInfo();
+    listings[info.absolutePath()].push_back(info.fileName());
+    if (info.isDir()) {
+      indexed.dirs.push_back({info.absoluteFilePath(), modifiedMs(info), {}});
+    } else if (info.fileName().endsWith(QLatin1String(".ino"), Qt::CaseInsensitive)) {
+      folderToInos[info.absolutePath()].push_back(info.absoluteFilePath());
+    }
   }
 
   const QDir rootDir(examplesRoot);
@@ -132,86 +236,98 @@ void collectExamplesRoot(const QString& examplesRoot,
     if (segments.isEmpty()) {
       continue;
     }
-
-    ExampleSketch ex;
-    ex.menuPath = prefix + segments;
-    ex.folderPath = folder;
-    ex.inoPath = mainIno;
-    out->push_back(std::move(ex));
+    indexed.examples.push_back({std::move(segments), folder, mainIno});
   }
-}
 
-void collectBuiltInExamples(const QString& builtinDir, QVector<ExampleSketch>* out) {
-  if (builtinDir.isEmpty()) return;
-  collectExamplesRoot(builtinDir, {QStringLiteral("Built-in Examples")}, out);
+  for (DirStamp& dir : indexed.dirs) {
+    if (dir.modifiedMs >= startedMs - kRacyMtimeWindowMs) {
+      dir.listingHash = listingHash(listings.value(QDir(dir.path).absolutePath()));
+    }
+  }
+  return indexed;
 }
 
-void collectSketchbookExamples(const QString& sketchbookDir, QVector<ExampleSketch>* out) {
-  const QString root = QDir(sketchbookDir).absoluteFilePath(QStringLiteral("examples"));
-  collectExamplesRoot(root, {QStringLiteral("Sketchbook")}, out);
+// A root is unchanged while none of its directories gained, lost or
+// renamed an entry, which is what moves a directory's modification time.
+// A change in the same tick as the walk does not move it, so directories
+// that were that recent are listed again.
+bool isUpToDate(const IndexedRoot& indexed) {
+  for (const DirStamp& dir : indexed.dirs) {
+    if (modifiedMs(QFileInfo(dir.path)) != dir.modifiedMs) {
+      return false;
+    }
+    if (!dir.listingHash.isEmpty() &&
+        listingHash(QDir(dir.path).entryList(kWalkFilters)) != dir.listingHash) {
+      return false;
+    }
+  }
+  return true;
 }
 
-void collectSketchbookLibraryExamples(const QString& sketchbookDir, QVector<ExampleSketch>* out) {
-  const QString libsRoot = QDir(sketchbookDir).absoluteFilePath(QStringLiteral("libraries"));
-  const QDir libsDir(libsRoot);
-  if (!libsDir.exists()) {
-    return;
+QVector<IndexedRoot> readCache(const QString& cachePath) {
+  QFile f(cachePath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  qint32 format = 0;
+  in >> magic >> format;
+  if (magic != kCacheMagic || format != kCacheFormat) {
+    return {};
   }
 
-  const QStringList libs =
-      libsDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-  for (const QString& libName : libs) {
-    const QString libPath = libsDir.absoluteFilePath(libName);
-    const QString examplesRoot = QDir(libPath).absoluteFilePath(QStringLiteral("examples"));
-    collectExamplesRoot(examplesRoot, {QStringLiteral("Libraries"), libName}, out);
+  QVector<IndexedRoot> roots;
+  qint32 rootCount = 0;
+  in >> rootCount;
+  for (qint32 r = 0; r < rootCount && in.status() == QDataStream::Ok; ++r) {
+    IndexedRoot root;
+    in >> root.path;
+    qint32 dirCount = 0;
+    in >> dirCount;
+    for (qint32 d = 0; d < dirCount && in.status() == QDataStream::Ok; ++d) {
+      DirStamp dir;
+      in >> dir.path >> dir.modifiedMs >> dir.listingHash;
+      root.dirs.push_back(std::move(dir));
+    }
+    qint32 exampleCount = 0;
+    in >> exampleCount;
+    for (qint32 e = 0; e < exampleCount && in.status() == QDataStream::Ok; ++e) {
+      IndexedExample example;
+      in >> example.segments >> example.folderPath >> example.inoPath;
+      root.examples.push_back(std::move(example));
+    }
+    roots.push_back(std::move(root));
   }
+  if (in.status() != QDataStream::Ok) {
+    return {};
+  }
+  return roots;
 }
 
-void collectCoreLibraryExamples(const QString& dataDir, QVector<ExampleSketch>* out) {
-  const QString packagesRoot =
-      QDir(dataDir).absoluteFilePath(QStringLiteral("packages"));
-  const QDir packagesDir(packagesRoot);
-  if (!packagesDir.exists()) {
+void writeCache(const QString& cachePath, const QVector<IndexedRoot>& roots) {
+  QDir().mkpath(QFileInfo(cachePath).absolutePath());
+  QSaveFile f(cachePath);
+  if (!f.open(QIODevice::WriteOnly)) {
     return;
   }
-
-  const QStringList vendors =
-      packagesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-  for (const QString& vendor : vendors) {
-    const QDir vendorDir(packagesDir.absoluteFilePath(vendor));
-    const QDir hardwareDir(vendorDir.absoluteFilePath(QStringLiteral("hardware")));
-    if (!hardwareDir.exists()) {
-      continue;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << kCacheMagic << kCacheFormat << qint32(roots.size());
+  for (const IndexedRoot& root : roots) {
+    out << root.path << qint32(root.dirs.size());
+    for (const DirStamp& dir : root.dirs) {
+      out << dir.path << dir.modifiedMs << dir.listingHash;
     }
-
-    const QStringList archs =
-        hardwareDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    for (const QString& arch : archs) {
-      const QDir archDir(hardwareDir.absoluteFilePath(arch));
-      const QStringList versions =
-          archDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-      const QString best = bestVersionDir(versions);
-      if (best.isEmpty()) {
-        continue;
-      }
-
-      const QDir versionDir(archDir.absoluteFilePath(best));
-      const QDir libsDir(versionDir.absoluteFilePath(QStringLiteral("libraries")));
-      if (!libsDir.exists()) {
-        continue;
-      }
-
-      const QString coreId = vendor + QLatin1Char(':') + arch;
-      const QStringList libs =
-          libsDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-      for (const QString& libName : libs) {
-        const QString libPath = libsDir.absoluteFilePath(libName);
-        const QString examplesRoot = QDir(libPath).absoluteFilePath(QStringLiteral("examples"));
-        collectExamplesRoot(examplesRoot,
-                            {QStringLiteral("Core Libraries"), coreId, libName}, out);
-      }
+    out << qint32(root.examples.size());
+    for (const IndexedExample& example : root.examples) {
+      out << example.segments << example.folderPath << example.inoPath;
     }
   }
+  if (out.status() == QDataStream::Ok) {
+    f.commit();
+  }
 }
 }  // namespace
 
@@ -224,52 +340,189 @@ ExamplesScanner::Options ExamplesScanner::defaultOptions() {
   if (!QDir(o.builtinDir).exists()) {
       o.builtinDir = QDir(o.dataDir).absoluteFilePath(QStringLiteral("examples"));
   }
+  o.cachePath = defaultCachePath();
   return o;
 }
 
-QVector<ExampleSketch> ExamplesScanner::scan(const Options& inOptions) {
+QString ExamplesScanner::defaultCachePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+      .filePath(QStringLiteral("examples-index.bin"));
+}
+
+QVector<ExampleSketch> ExamplesScanner::scan(const Options& inOptions, Stats* stats) {
   Options options = inOptions;
   if (options.sketchbookDir.isEmpty()) options.sketchbookDir = defaultSketchbookDir();
   if (options.dataDir.isEmpty()) options.dataDir = defaultDataDir();
 
-  QVector<ExampleSketch> raw;
-  collectBuiltInExamples(options.builtinDir, &raw);
-  collectCoreLibraryExamples(options.dataDir, &raw);
-  collectSketchbookLibraryExamples(options.sketchbookDir, &raw);
-  collectSketchbookExamples(options.sketchbookDir, &raw);
-
-  // Grouping and Prioritization logic
-  QString activePackager;
-  if (!options.currentFqbn.isEmpty()) {
-      activePackager = options.currentFqbn.split(':').first();
-  }
-
-  // Sorting with Priority (IDE 2.x mechanism)
-  std::sort(raw.begin(), raw.end(), [&](const ExampleSketch& a, const ExampleSketch& b) {
-    auto score = [&](const ExampleSketch& s) {
-        QString cat = s.menuPath.first();
-        if (cat == "Built-in Examples") return 1;
-        if (cat == "Core Libraries") {
-            if (!activePackager.isEmpty() && s.menuPath.size() > 1) {
-                const QString coreId = s.menuPath.at(1);
-                if (coreId.startsWith(activePackager + ":")) return 2;
-            }
-            return 5; // Non-selected cores go way down
+  const QVector<ExamplesRoot> roots = collectRoots(options);
+  const QVector<IndexedRoot> cached =
+      options.cachePath.isEmpty() ? QVector<IndexedRoot>{} : readCache(options.cachePath);
+  QHash<QString, const IndexedRoot*> cachedByPath;
+  for (const IndexedRoot& root : cached) {
+    cachedByPath.insert(root.path, &root);
+  }
+
+  // Each root is checked against the cache, and walked if that fails, on
+  // its own pool task.
+  QVector<IndexedRoot> indexed(roots.size());
+  std::vector<char> reused(static_cast<size_t>(roots.size()), 0);
+  {
+    IndexedRoot* results = indexed.data();
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.threadCount > 0 ? options.threadCount
+                                                   : std::max(1, QThread::idealThreadCount()));
+    for (qsizetype i = 0; i < roots.size(); ++i) {
+      pool.start([&, i] {
+        const IndexedRoot* previous = cachedByPath.value(roots.at(i).path);
+        if (previous && isUpToDate(*previous)) {
+          results[i] = *previous;
+          reused[static_cast<size_t>(i)] = 1;
+        } else {
+          results[i] = walkRoot(roots.at(i).path);
         }
-        if (cat == "Libraries") return 3;
-        if (cat == "Sketchbook") return 4;
-        return 6;
-    };
-
-    int scoreA = score(a);
-    int scoreB = score(b);
-    if (scoreA != scoreB) return scoreA < scoreB;
-
-    const QString ap = a.menuPath.join(QLatin1Char('/'));
-    const QString bp = b.menuPath.join(QLatin1Char('/'));
-    if (ap != bp) return ap < bp;
-    return a.folderPath < b.folderPath;
-  });
+      });
+    }
+    pool.waitForDone();
+  }
 
+  const int fromCache = static_cast<int>(std::count(reused.begin(), reused.end(), 1));
+  if (stats) {
+    stats->roots = static_cast<int>(roots.size());
+    stats->fromCache = fromCache;
+    stats->rescanned = stats->roots - fromCache;
+  }
+  if (!options.cachePath.isEmpty() &&
+      (fromCache != roots.size() || cached.size() != roots.size())) {
+    writeCache(options.cachePath, indexed);
+  }
+
+  QVector<ExampleSketch> raw;
+  for (qsizetype i = 0; i < roots.size(); ++i) {
+    for (const IndexedExample& example : indexed.at(i).examples) {
+      raw.push_back({roots.at(i).prefix + example.segments, example.folderPath, example.inoPath});
+    }
+  }
+  sortForBoard(&raw, options.currentFqbn);
   return raw;
 }
+
+void ExamplesScanner::sortForBoard(QVector<ExampleSketch>* examples, const QString& fqbn) {
+  if (!examples) {
+    return;
+  }
+
+  const QString activePackager = fqbn.section(QLatin1Char(':'), 0, 0);
+  auto score = [&activePackager](const ExampleSketch& s) {
+    const QString& cat = s.menuPath.first();
+    if (cat == QLatin1String("Built-in Examples")) return 1;
+    if (cat == QLatin1String("Core Libraries")) {
+      if (!activePackager.isEmpty() && s.menuPath.size() > 1 &&
+          s.menuPath.at(1).startsWith(activePackager + QLatin1Char(':'))) {
+        return 2;
+      }
+      return 5;  // Non-selected cores go way down
+    }
+    if (cat == QLatin1String("Libraries")) return 3;
+    if (cat == QLatin1String("Sketchbook")) return 4;
+    return 6;
+  };
+
+  // Sort keys are computed once rather than on every comparison.
+  struct Keyed final {
+    int score = 0;
+    QString path;
+    ExampleSketch sketch;
+  };
+  std::vector<Keyed> keyed;
+  keyed.reserve(static_cast<size_t>(examples->size()));
+  for (ExampleSketch& s : *examples) {
+    if (s.menuPath.isEmpty()) {
+      continue;
+    }
+    const int sc = score(s);
+    QString path = s.menuPath.join(QLatin1Char('/'));
+    keyed.push_back({sc, std::move(path), std::move(s)});
+  }
+  std::sort(keyed.begin(), keyed.end(), [](const Keyed& a, const Keyed& b) {
+    if (a.score != b.score) return a.score < b.score;
+    if (a.path != b.path) return a.path < b.path;
+    return a.sketch.folderPath < b.sketch.folderPath;
+  });
+
+  examples->clear();
+  examples->reserve(static_cast<qsizetype>(keyed.size()));
+  for (Keyed& k : keyed) {
+    examples->push_back(std::move(k.sketch));
+  }
+}
+
+ExamplesIndex::ExamplesIndex(QObject* parent)
+    : QObject(parent), options_(ExamplesScanner::defaultOptions()) {}
+
+ExamplesIndex::~ExamplesIndex() {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+}
+
+void ExamplesIndex::setOptions(ExamplesScanner::Options options) {
+  options_ = std::move(options);
+  ++generation_;
+}
+
+std::shared_ptr<const QVector<ExampleSketch>> ExamplesIndex::examples() const {
+  return examples_;
+}
+
+quint64 ExamplesIndex::revision() const {
+  return revision_;
+}
+
+bool ExamplesIndex::isScanning() const {
+  return thread_ != nullptr;
+}
+
+void ExamplesIndex::refresh() {
+  if (thread_) {
+    pendingRefresh_ = true;
+    return;
+  }
+
+  ExamplesScanner::Options options = options_;
+  options.currentFqbn.clear();
+  const std::shared_ptr<const QVector<ExampleSketch>> current = examples_;
+  const quint64 generation = generation_;
+  thread_ = QThread::create([this, generation, options, current] {
+    auto scanned = std::make_shared<const QVector<ExampleSketch>>(ExamplesScanner::scan(options));
+    std::shared_ptr<const QVector<ExampleSketch>> result = scanned;
+    if (current && *current == *scanned) {
+      result = current;
+    }
+    QMetaObject::invokeMethod(
+        this, [this, generation, result] { finishScan(generation, result); },
+        Qt::QueuedConnection);
+  });
+  thread_->start();
+}
+
+void ExamplesIndex::finishScan(quint64 generation,
+                               std::shared_ptr<const QVector<ExampleSketch>> examples) {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+
+  if (generation == generation_ && examples != examples_) {
+    examples_ = std::move(examples);
+    ++revision_;
+    emit examplesChanged();
+  }
+
+  if (pendingRefresh_ || generation != generation_) {
+    pendingRefresh_ = false;
+    refresh();
+  }
+}
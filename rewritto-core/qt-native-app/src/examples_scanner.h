@@ -1,15 +1,28 @@
 #pragma once
 
+#include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
+#include <memory>
+
+class QThread;
+
 struct ExampleSketch final {
   QStringList menuPath;
   QString folderPath;
   QString inoPath;
+
+  friend bool operator==(const ExampleSketch&, const ExampleSketch&) = default;
 };
 
+// Finds the example sketches of the built-in set, the installed cores'
+// libraries, the sketchbook libraries and the sketchbook. Each examples
+// root is walked on a thread pool. With a cache path, what a walk found is
+// persisted together with the modification time of every directory it
+// visited; the next scan only re-stats those directories and walks again
+// the roots where one changed, plus roots that appeared since.
 class ExamplesScanner final {
  public:
   struct Options final {
@@ -17,9 +30,57 @@ class ExamplesScanner final {
     QString dataDir;
     QString builtinDir;
     QString currentFqbn;
+    QString cachePath;    // empty: always walk every root
+    int threadCount = 0;  // 0: QThread::idealThreadCount()
+  };
+
+  struct Stats final {
+    int roots = 0;
+    int fromCache = 0;
+    int rescanned = 0;
   };
 
   static Options defaultOptions();
-  static QVector<ExampleSketch> scan(const Options& options);
+  static QString defaultCachePath();
+  static QVector<ExampleSketch> scan(const Options& options, Stats* stats = nullptr);
+
+  // Menu order: built-in examples, the libraries of the core `fqbn`
+  // belongs to, other libraries, the sketchbook, then the other cores.
+  static void sortForBoard(QVector<ExampleSketch>* examples, const QString& fqbn);
 };
 
+// Keeps the examples list of ExamplesScanner::defaultOptions() (or the
+// options set) current, scanning on a worker thread. Call refresh() when
+// libraries or cores may have changed; examplesChanged() is emitted only
+// when the list actually differs.
+class ExamplesIndex final : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit ExamplesIndex(QObject* parent = nullptr);
+  ~ExamplesIndex() override;
+
+  void setOptions(ExamplesScanner::Options options);
+
+  // Sorted for no board; null until the first scan ends.
+  std::shared_ptr<const QVector<ExampleSketch>> examples() const;
+  // Increases every time examples() is replaced.
+  quint64 revision() const;
+  bool isScanning() const;
+
+ public slots:
+  void refresh();
+
+ signals:
+  void examplesChanged();
+
+ private:
+  ExamplesScanner::Options options_;
+  std::shared_ptr<const QVector<ExampleSketch>> examples_;
+  quint64 revision_ = 0;
+  QThread* thread_ = nullptr;
+  quint64 generation_ = 0;
+  bool pendingRefresh_ = false;
+
+  void finishScan(quint64 generation, std::shared_ptr<const QVector<ExampleSketch>> examples);
+};
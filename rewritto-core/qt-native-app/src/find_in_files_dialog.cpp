@@ -3,15 +3,257 @@
 #include <QCheckBox>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QFileInfo>
 #include <QHBoxLayout>
+#include <QHash>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMutex>
 #include <QPushButton>
+#include <QQueue>
+#include <QRegularExpression>
 #include <QThread>
 #include <QTreeWidget>
 #include <QVBoxLayout>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int kMaxMatches = 10000;
+constexpr int kMaxScanThreads = 8;
+constexpr int kBatchMatches = 256;
+constexpr int kBatchIntervalMs = 50;
+
+char asciiLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+char asciiUpper(char c) {
+  return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+struct SearchQuery final {
+  QString text;
+  Qt::CaseSensitivity cs = Qt::CaseSensitive;
+  // Set when the query can be matched on raw UTF-8 bytes: always for a
+  // case-sensitive search, and for a case-insensitive one when the query is
+  // ASCII (non-ASCII UTF-8 bytes never fold onto ASCII letters).
+  bool bytesOnly = false;
+  QByteArray bytes;  // UTF-8, lowercased when folding
+};
+
+// Yields successive occurrences of a byte string. Candidates come from
+// memchr() on the first byte (both cases when folding), which the C library
+// vectorizes; only candidates are compared in full.
+class ByteFinder final {
+ public:
+  ByteFinder(const SearchQuery& query, const char* data, qsizetype size)
+      : needle_(query.bytes),
+        fold_(query.cs == Qt::CaseInsensitive),
+        data_(data),
+        lastStart_(size - query.bytes.size()) {
+    first_ = needle_.at(0);
+    other_ = fold_ ? asciiUpper(first_) : first_;
+  }
+
+  // First occurrence at or after `from`, or -1.
+  qsizetype next(qsizetype from) {
+    while (from <= lastStart_) {
+      const qsizetype a = candidate(first_, nextFirst_, from);
+      const qsizetype b = other_ != first_ ? candidate(other_, nextOther_, from) : -1;
+      const qsizetype at = a < 0 ? b : (b < 0 ? a : std::min(a, b));
+      if (at < 0) {
+        return -1;
+      }
+      if (matchesAt(at)) {
+        return at;
+      }
+      from = at + 1;
+    }
+    return -1;
+  }
+
+ private:
+  static constexpr qsizetype kUnknown = -2;
+
+  QByteArray needle_;
+  bool fold_ = false;
+  const char* data_ = nullptr;
+  qsizetype lastStart_ = 0;
+  char first_ = 0;
+  char other_ = 0;
+  qsizetype nextFirst_ = kUnknown;
+  qsizetype nextOther_ = kUnknown;
+
+  qsizetype candidate(char c, qsizetype& cached, qsizetype from) {
+    if (cached == -1 || cached >= from) {
+      return cached;
+    }
+    const void* hit = std::memchr(data_ + from, static_cast<unsigned char>(c),
+                                  static_cast<size_t>(lastStart_ - from + 1));
+    cached = hit ? static_cast<const char*>(hit) - data_ : -1;
+    return cached;
+  }
+
+  bool matchesAt(qsizetype at) const {
+    const char* p = data_ + at;
+    if (!fold_) {
+      return std::memcmp(p, needle_.constData(), static_cast<size_t>(needle_.size())) == 0;
+    }
+    for (qsizetype i = 1; i < needle_.size(); ++i) {
+      if (asciiLower(p[i]) != needle_.at(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+QString previewLine(const char* begin, const char* end) {
+  if (end > begin && end[-1] == '\r') {
+    --end;
+  }
+  return QString::fromUtf8(begin, end - begin);
+}
+
+// Line and column are only worked out for hits; the bytes in between are
+// skipped with memchr().
+void searchBytes(const QString& filePath,
+                 const SearchQuery& query,
+                 const char* data,
+                 qsizetype size,
+                 QVector<FindInFilesMatch>* out) {
+  ByteFinder finder(query, data, size);
+  const char* const end = data + size;
+  const char* lineStart = data;
+  const char* lineEnd = nullptr;  // end of the line holding the previous hit
+  int lineNo = 1;
+  QString preview;
+
+  for (qsizetype at = finder.next(0); at >= 0; at = finder.next(at + query.bytes.size())) {
+    const char* hit = data + at;
+    if (!lineEnd || hit > lineEnd) {
+      for (const char* p = lineEnd ? lineEnd : lineStart;;) {
+        const void* nl = std::memchr(p, '\n', static_cast<size_t>(hit - p));
+        if (!nl) {
+          break;
+        }
+        p = static_cast<const char*>(nl) + 1;
+        lineStart = p;
+        ++lineNo;
+      }
+      const void* nl = std::memchr(hit, '\n', static_cast<size_t>(end - hit));
+      lineEnd = nl ? static_cast<const char*>(nl) : end;
+      preview = previewLine(lineStart, lineEnd);
+    }
+    bool ascii = true;
+    for (const char* p = lineStart; p < hit && ascii; ++p) {
+      ascii = static_cast<unsigned char>(*p) < 0x80;
+    }
+    const qsizetype column =
+        ascii ? hit - lineStart : QString::fromUtf8(lineStart, hit - lineStart).size();
+    out->push_back({filePath, lineNo, static_cast<int>(column) + 1, preview});
+  }
+}
+
+// Case-insensitive search for a non-ASCII query: Unicode case folding needs
+// decoded text.
+void searchText(const QString& filePath,
+                const SearchQuery& query,
+                const char* data,
+                qsizetype size,
+                QVector<FindInFilesMatch>* out) {
+  const QString text = QString::fromUtf8(data, size);
+  qsizetype lineStart = 0;
+  qsizetype lineEnd = -1;
+  int lineNo = 1;
+  QString preview;
+
+  for (qsizetype at = text.indexOf(query.text, 0, query.cs); at >= 0;
+       at = text.indexOf(query.text, at + query.text.size(), query.cs)) {
+    if (at > lineEnd) {
+      for (qsizetype nl = text.indexOf(QLatin1Char('\n'), std::max(lineStart, lineEnd));
+           nl >= 0 && nl < at; nl = text.indexOf(QLatin1Char('\n'), nl + 1)) {
+        lineStart = nl + 1;
+        ++lineNo;
+      }
+      lineEnd = text.indexOf(QLatin1Char('\n'), at);
+      if (lineEnd < 0) {
+        lineEnd = text.size();
+      }
+      preview = text.mid(lineStart, lineEnd - lineStart);
+      if (preview.endsWith(QLatin1Char('\r'))) {
+        preview.chop(1);
+      }
+    }
+    out->push_back({filePath, lineNo, static_cast<int>(at - lineStart) + 1, preview});
+  }
+}
+
+QVector<FindInFilesMatch> scanFile(const QString& filePath, const SearchQuery& query) {
+  QVector<FindInFilesMatch> matches;
+  QFile f(filePath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return matches;
+  }
+  const qint64 size = f.size();
+  if (size <= 0) {
+    return matches;
+  }
+
+  QByteArray contents;
+  const char* data = reinterpret_cast<const char*>(f.map(0, size));
+  if (!data) {
+    contents = f.readAll();
+    data = contents.constData();
+  }
+  if (query.bytesOnly) {
+    searchBytes(filePath, query, data, contents.isNull() ? size : contents.size(), &matches);
+  } else {
+    searchText(filePath, query, data, contents.isNull() ? size : contents.size(), &matches);
+  }
+  return matches;
+}
+
+// Shared between the enumerating thread and the scanners. Files are numbered
+// in enumeration order so results can be reported in that order.
+struct ScanState final {
+  QMutex mutex;
+  QWaitCondition jobsReady;
+  QWaitCondition resultsReady;
+  QQueue<QPair<qsizetype, QString>> jobs;
+  QHash<qsizetype, QVector<FindInFilesMatch>> results;
+  bool enumerationDone = false;
+  std::atomic_bool stop{false};
+};
+
+void scanLoop(ScanState* state, const SearchQuery* query) {
+  while (true) {
+    QPair<qsizetype, QString> job;
+    {
+      QMutexLocker lock(&state->mutex);
+      while (state->jobs.isEmpty() && !state->enumerationDone && !state->stop.load()) {
+        state->jobsReady.wait(&state->mutex);
+      }
+      if (state->stop.load() || state->jobs.isEmpty()) {
+        return;
+      }
+      job = state->jobs.dequeue();
+    }
+    QVector<FindInFilesMatch> matches = scanFile(job.second, *query);
+    {
+      QMutexLocker lock(&state->mutex);
+      state->results.insert(job.first, std::move(matches));
+    }
+    state->resultsReady.wakeOne();
+  }
+}
+
+}  // namespace
 
 FindInFilesWorker::FindInFilesWorker(QObject* parent) : QObject(parent) {}
 
@@ -63,8 +305,15 @@ void FindInFilesWorker::run(QString rootDir,
   excludePatterns.removeAll(QString{});
   excludePatterns.removeDuplicates();
 
-  const Qt::CaseSensitivity cs =
-      caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+  SearchQuery search;
+  search.text = query;
+  search.cs = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+  search.bytes = query.toUtf8();
+  search.bytesOnly = caseSensitive || std::all_of(query.cbegin(), query.cend(),
+                                                  [](QChar c) { return c.unicode() < 0x80; });
+  if (search.bytesOnly && !caseSensitive) {
+    search.bytes = search.bytes.toLower();
+  }
 
   int matches = 0;
   int filesScanned = 0;
@@ -91,32 +340,108 @@ void FindInFilesWorker::run(QString rootDir,
     return false;
   };
 
+  // Same wildcard semantics as QDir::match(), compiled once per search
+  // instead of once per file.
+  struct FilePattern {
+    QRegularExpression rx;
+    bool matchesPath = false;
+  };
+  auto compilePatterns = [](const QStringList& pats) {
+    QVector<FilePattern> compiled;
+    compiled.reserve(pats.size());
+    for (const QString& p : pats) {
+      const bool matchesPath = p.contains('/') || p.contains('\\');
+      for (const QString& filter : QDir::nameFiltersFromString(p)) {
+        compiled.push_back(
+            {QRegularExpression::fromWildcard(filter, Qt::CaseInsensitive), matchesPath});
+      }
+    }
+    return compiled;
+  };
+  const QVector<FilePattern> includes = compilePatterns(patterns);
+  const QVector<FilePattern> excludes = compilePatterns(excludePatterns);
+
   auto matchesAny = [](const QString& relPath,
                        const QString& fileName,
-                       const QStringList& pats) -> bool {
-    for (QString p : pats) {
-      p = p.trimmed();
-      if (p.isEmpty()) {
-        continue;
-      }
-      if (p.contains('/') || p.contains('\\')) {
-        if (QDir::match(p, relPath)) {
-          return true;
-        }
-        continue;
-      }
-      if (QDir::match(p, fileName)) {
+                       const QVector<FilePattern>& pats) -> bool {
+    for (const FilePattern& p : pats) {
+      if (p.rx.match(p.matchesPath ? relPath : fileName).hasMatch()) {
         return true;
       }
     }
     return false;
   };
 
+  // A line-based search could never match across a line break.
+  const bool searchable = !query.contains(QLatin1Char('\n')) && !query.contains(QLatin1Char('\r'));
+
+  ScanState state;
+  QVector<QThread*> scanners;
+  const int threadCount = std::clamp(QThread::idealThreadCount(), 1, kMaxScanThreads);
+  for (int i = 0; i < threadCount; ++i) {
+    QThread* t = QThread::create(scanLoop, &state, &search);
+    t->start();
+    scanners.push_back(t);
+  }
+  auto stopScanners = [&state, &scanners] {
+    {
+      QMutexLocker lock(&state.mutex);
+      state.stop.store(true);
+    }
+    state.jobsReady.wakeAll();
+    for (QThread* t : scanners) {
+      t->wait();
+      delete t;
+    }
+    scanners.clear();
+  };
+
+  qsizetype queued = 0;
+  qsizetype reported = 0;
+  QVector<FindInFilesMatch> batch;
+  QElapsedTimer sinceBatch;
+  sinceBatch.start();
+  bool cancelled = false;
+  bool capped = false;
+
+  auto flushBatch = [this, &batch, &sinceBatch] {
+    if (!batch.isEmpty()) {
+      emit matchesFound(batch);
+      batch.clear();
+    }
+    sinceBatch.restart();
+  };
+  // Moves finished files into the batch in enumeration order. Returns false
+  // once the match limit is reached.
+  auto collect = [&] {
+    QMutexLocker lock(&state.mutex);
+    for (auto it = state.results.find(reported); it != state.results.end();
+         it = state.results.find(reported)) {
+      const QVector<FindInFilesMatch> fileMatches = std::move(it.value());
+      state.results.erase(it);
+      ++reported;
+      ++filesScanned;
+      for (const FindInFilesMatch& m : fileMatches) {
+        batch.push_back(m);
+        if (++matches >= kMaxMatches) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+  auto flushIfDue = [&] {
+    if (batch.size() >= kBatchMatches ||
+        (!batch.isEmpty() && sinceBatch.elapsed() >= kBatchIntervalMs)) {
+      flushBatch();
+    }
+  };
+
   QDirIterator it(root.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
 
-  while (it.hasNext()) {
+  while (searchable && it.hasNext()) {
     if (cancelled_.load(std::memory_order_relaxed)) {
-      emit message("Search cancelled.");
+      cancelled = true;
       break;
     }
     const QString filePath = it.next();
@@ -125,55 +450,56 @@ void FindInFilesWorker::run(QString rootDir,
     }
 
     const QString relPath = root.relativeFilePath(filePath);
-    const QString fileName = QFileInfo(filePath).fileName();
-    if (!matchesAny(relPath, fileName, patterns)) {
+    const QString fileName = it.fileName();
+    if (!matchesAny(relPath, fileName, includes)) {
       continue;
     }
-    if (matchesAny(relPath, fileName, excludePatterns)) {
+    if (matchesAny(relPath, fileName, excludes)) {
       continue;
     }
-    ++filesScanned;
-
-    QFile f(filePath);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      continue;
+    {
+      QMutexLocker lock(&state.mutex);
+      state.jobs.enqueue({queued++, filePath});
     }
+    state.jobsReady.wakeOne();
 
-    int lineNo = 0;
-    QByteArray lineBytes;
-    while (!f.atEnd()) {
-      if (cancelled_.load(std::memory_order_relaxed)) {
-        break;
-      }
-      lineBytes = f.readLine();
-      ++lineNo;
-
-      QString line = QString::fromUtf8(lineBytes);
-      if (line.endsWith('\n')) {
-        line.chop(1);
-      }
-      if (line.endsWith('\r')) {
-        line.chop(1);
-      }
+    if (!collect()) {
+      capped = true;
+      break;
+    }
+    flushIfDue();
+  }
+  {
+    QMutexLocker lock(&state.mutex);
+    state.enumerationDone = true;
+  }
+  state.jobsReady.wakeAll();
 
-      int from = 0;
-      while (true) {
-        const int idx = line.indexOf(query, from, cs);
-        if (idx < 0) {
-          break;
-        }
-        ++matches;
-        emit matchFound(filePath, lineNo, idx + 1, line);
-        from = idx + qMax(1, query.size());
-        if (matches >= 10000) {
-          emit message("Too many matches; stopping at 10,000.");
-          emit finished(matches, filesScanned);
-          return;
-        }
+  while (!cancelled && !capped && reported < queued) {
+    if (cancelled_.load(std::memory_order_relaxed)) {
+      cancelled = true;
+      break;
+    }
+    {
+      QMutexLocker lock(&state.mutex);
+      if (!state.results.contains(reported)) {
+        state.resultsReady.wait(&state.mutex, kBatchIntervalMs);
       }
     }
+    if (!collect()) {
+      capped = true;
+      break;
+    }
+    flushIfDue();
   }
+  stopScanners();
+  flushBatch();
 
+  if (capped) {
+    emit message("Too many matches; stopping at 10,000.");
+  } else if (cancelled) {
+    emit message("Search cancelled.");
+  }
   emit finished(matches, filesScanned);
 }
 
@@ -257,10 +583,8 @@ FindInFilesDialog::FindInFilesDialog(QString rootDir, QWidget* parent)
   worker_->moveToThread(workerThread_);
   connect(workerThread_, &QThread::finished, worker_, &QObject::deleteLater);
 
-  connect(worker_, &FindInFilesWorker::matchFound, this,
-          [this](const QString& filePath, int line, int column, const QString& preview) {
-            addResult(filePath, line, column, preview);
-          });
+  connect(worker_, &FindInFilesWorker::matchesFound, this,
+          [this](const QVector<FindInFilesMatch>& matches) { addResults(matches); });
   connect(worker_, &FindInFilesWorker::message, this,
           [this](const QString& text) { statusLabel_->setText(text); });
   connect(worker_, &FindInFilesWorker::finished, this,
@@ -352,21 +676,26 @@ QStringList FindInFilesDialog::parseExcludePatterns() const {
   return patterns;
 }
 
-void FindInFilesDialog::addResult(QString filePath, int line, int column, QString preview) {
-  if (!results_) {
+void FindInFilesDialog::addResults(const QVector<FindInFilesMatch>& matches) {
+  if (!results_ || matches.isEmpty()) {
     return;
   }
-  const QString rel =
-      QDir(rootDir_).relativeFilePath(filePath);
-  auto* item = new QTreeWidgetItem();
-  item->setText(0, rel.isEmpty() ? filePath : rel);
-  item->setText(1, QString::number(line));
-  item->setText(2, QString::number(column));
-  item->setText(3, preview);
-  item->setData(0, Qt::UserRole, filePath);
-  item->setData(1, Qt::UserRole, line);
-  item->setData(2, Qt::UserRole, column);
-  results_->addTopLevelItem(item);
+  const QDir root(rootDir_);
+  QList<QTreeWidgetItem*> items;
+  items.reserve(matches.size());
+  for (const FindInFilesMatch& m : matches) {
+    const QString rel = root.relativeFilePath(m.filePath);
+    auto* item = new QTreeWidgetItem();
+    item->setText(0, rel.isEmpty() ? m.filePath : rel);
+    item->setText(1, QString::number(m.line));
+    item->setText(2, QString::number(m.column));
+    item->setText(3, m.preview);
+    item->setData(0, Qt::UserRole, m.filePath);
+    item->setData(1, Qt::UserRole, m.line);
+    item->setData(2, Qt::UserRole, m.column);
+    items.push_back(item);
+  }
+  results_->addTopLevelItems(items);
 }
 
 void FindInFilesDialog::startSearch() {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QVector>
 #include <QWidget>
 
 #include <atomic>
@@ -10,6 +11,17 @@ class QPushButton;
 class QThread;
 class QTreeWidget;
 
+struct FindInFilesMatch final {
+  QString filePath;
+  int line = 0;    // 1-based
+  int column = 0;  // 1-based, in UTF-16 code units
+  QString preview;
+};
+Q_DECLARE_METATYPE(FindInFilesMatch)
+
+// Enumerates the tree on the calling thread while a pool of scanner threads
+// memory-maps and searches the files. Matches are reported in enumeration
+// order, a batch at a time.
 class FindInFilesWorker final : public QObject {
   Q_OBJECT
 
@@ -25,7 +37,7 @@ class FindInFilesWorker final : public QObject {
   void cancel();
 
  signals:
-  void matchFound(QString filePath, int line, int column, QString preview);
+  void matchesFound(QVector<FindInFilesMatch> matches);
   void finished(int matches, int filesScanned);
   void message(QString text);
 
@@ -68,5 +80,5 @@ class FindInFilesDialog final : public QWidget {
   void stopSearch();
   QStringList parsePatterns() const;
   QStringList parseExcludePatterns() const;
-  void addResult(QString filePath, int line, int column, QString preview);
+  void addResults(const QVector<FindInFilesMatch>& matches);
 };
@@ -0,0 +1,282 @@
+#include "fuzzy_matcher.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <numeric>
+
+namespace {
+constexpr int kScoreMatch = 16;
+constexpr int kScoreGapStart = -3;
+constexpr int kScoreGapExtension = -1;
+constexpr int kBonusBoundary = kScoreMatch / 2;
+constexpr int kBonusNonWord = kScoreMatch / 2;
+constexpr int kBonusCamel123 = kBonusBoundary + kScoreGapExtension;
+constexpr int kBonusConsecutive = -(kScoreGapStart + kScoreGapExtension);
+constexpr int kBonusFirstCharMultiplier = 2;
+constexpr int kDetailPenalty = kScoreMatch;
+
+enum class CharClass {
+  NonWord,
+  Lower,
+  Upper,
+  Letter,
+  Number,
+};
+
+CharClass charClass(QChar c) {
+  const char16_t u = c.unicode();
+  if (u < 0x80) {
+    if (u >= 'a' && u <= 'z') return CharClass::Lower;
+    if (u >= 'A' && u <= 'Z') return CharClass::Upper;
+    if (u >= '0' && u <= '9') return CharClass::Number;
+    return CharClass::NonWord;
+  }
+  if (c.isLower()) return CharClass::Lower;
+  if (c.isUpper()) return CharClass::Upper;
+  if (c.isDigit()) return CharClass::Number;
+  if (c.isLetter()) return CharClass::Letter;
+  return CharClass::NonWord;
+}
+
+int bonusFor(CharClass previous, CharClass current) {
+  if (previous == CharClass::NonWord && current != CharClass::NonWord) {
+    return kBonusBoundary;
+  }
+  if ((previous == CharClass::Lower && current == CharClass::Upper) ||
+      (previous != CharClass::Number && current == CharClass::Number)) {
+    return kBonusCamel123;
+  }
+  if (current == CharClass::NonWord) {
+    return kBonusNonWord;
+  }
+  return 0;
+}
+
+QChar lowered(QChar c) {
+  const char16_t u = c.unicode();
+  if (u < 0x80) {
+    return (u >= 'A' && u <= 'Z') ? QChar(char16_t(u + ('a' - 'A'))) : c;
+  }
+  return c.toLower();
+}
+
+// One bit per letter and digit; everything else shares the rest.
+quint64 maskBit(QChar lower) {
+  const char16_t u = lower.unicode();
+  if (u >= 'a' && u <= 'z') return quint64(1) << (u - 'a');
+  if (u >= '0' && u <= '9') return quint64(1) << (26 + u - '0');
+  return quint64(1) << (36 + u % 28);
+}
+
+// LSD radix sort, skipping the bytes every key shares. The keys are
+// unique, so this is std::sort's order in a few linear passes, which is
+// what keeps ranking tens of thousands of matches inside a keystroke.
+void radixSort(QVector<quint64>& keys) {
+  if (keys.size() < 256) {
+    std::sort(keys.begin(), keys.end());
+    return;
+  }
+  QVector<quint64> scratch(keys.size());
+  for (int shift = 0; shift < 64; shift += 8) {
+    std::array<qsizetype, 257> offsets{};
+    for (quint64 k : keys) {
+      ++offsets[((k >> shift) & 0xff) + 1];
+    }
+    if (std::find(offsets.cbegin() + 1, offsets.cend(), keys.size()) != offsets.cend()) {
+      continue;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    for (quint64 k : keys) {
+      scratch[offsets[(k >> shift) & 0xff]++] = k;
+    }
+    keys.swap(scratch);
+  }
+}
+}  // namespace
+
+FuzzyMatcher::Pattern::Pattern(QStringView query) {
+  text_.reserve(query.size());
+  for (QChar c : query) {
+    text_.append(lowered(c));
+  }
+  qsizetype i = 0;
+  while (i < text_.size()) {
+    while (i < text_.size() && text_.at(i).isSpace()) {
+      ++i;
+    }
+    const qsizetype start = i;
+    quint64 mask = 0;
+    while (i < text_.size() && !text_.at(i).isSpace()) {
+      mask |= maskBit(text_.at(i));
+      ++i;
+    }
+    if (start < i) {
+      terms_.push_back(text_.mid(start, i - start));
+      masks_.push_back(mask);
+    }
+  }
+}
+
+bool FuzzyMatcher::Pattern::narrows(const Pattern& previous) const {
+  return !previous.isEmpty() && !isEmpty() && text_.startsWith(previous.text_);
+}
+
+void FuzzyMatcher::clear() {
+  keys_.clear();
+  bonus_.clear();
+  spans_.clear();
+}
+
+void FuzzyMatcher::reserve(int candidates, qsizetype characters) {
+  spans_.reserve(candidates);
+  keys_.reserve(characters);
+  bonus_.reserve(characters);
+}
+
+int FuzzyMatcher::add(QStringView label, QStringView detail) {
+  Span span;
+  span.offset = keys_.size();
+  span.labelLength = static_cast<int>(label.size());
+
+  CharClass previous = CharClass::NonWord;
+  auto append = [&](QStringView text) {
+    for (QChar c : text) {
+      const CharClass current = charClass(c);
+      bonus_.append(static_cast<char>(bonusFor(previous, current)));
+      previous = current;
+      const QChar lower = lowered(c);
+      keys_.append(lower);
+      span.mask |= maskBit(lower);
+    }
+  };
+  append(label);
+  if (!detail.isEmpty()) {
+    append(u" ");
+    append(detail);
+  }
+  span.length = static_cast<int>(keys_.size() - span.offset);
+  spans_.push_back(span);
+  return static_cast<int>(spans_.size() - 1);
+}
+
+int FuzzyMatcher::size() const {
+  return static_cast<int>(spans_.size());
+}
+
+int FuzzyMatcher::scoreTerm(const Span& span, QStringView term, quint64 termMask) const {
+  if ((span.mask & termMask) != termMask || term.size() > span.length) {
+    return kNoMatch;
+  }
+  const QStringView key = QStringView(keys_).sliced(span.offset, span.length);
+  const char* bonus = bonus_.constData() + span.offset;
+
+  // Forward to where the whole term has first matched...
+  qsizetype end = -1;
+  for (QChar c : term) {
+    const QChar* found = std::find(key.begin() + end + 1, key.end(), c);
+    if (found == key.end()) {
+      return kNoMatch;
+    }
+    end = found - key.begin();
+  }
+  // ...then back to the latest start, for the tightest window.
+  qsizetype start = end;
+  for (qsizetype i = end, j = term.size() - 1; i >= 0; --i) {
+    if (key[i] == term[j]) {
+      start = i;
+      if (--j < 0) {
+        break;
+      }
+    }
+  }
+
+  int score = 0;
+  int consecutive = 0;
+  int firstBonus = 0;
+  bool inGap = false;
+  qsizetype t = 0;
+  for (qsizetype i = start; i <= end; ++i) {
+    if (key[i] != term[t]) {
+      score += inGap ? kScoreGapExtension : kScoreGapStart;
+      inGap = true;
+      consecutive = 0;
+      firstBonus = 0;
+      continue;
+    }
+    int b = bonus[i];
+    if (consecutive == 0) {
+      firstBonus = b;
+    } else {
+      // A run keeps the bonus of the boundary it started on.
+      if (b >= kBonusBoundary && b > firstBonus) {
+        firstBonus = b;
+      }
+      b = std::max(std::max(b, firstBonus), kBonusConsecutive);
+    }
+    score += kScoreMatch + (t == 0 ? b * kBonusFirstCharMultiplier : b);
+    inGap = false;
+    ++consecutive;
+    ++t;
+  }
+  if (start >= span.labelLength) {
+    score -= kDetailPenalty;
+  }
+  return std::max(score, 0);
+}
+
+int FuzzyMatcher::score(int id, const Pattern& pattern) const {
+  if (id < 0 || id >= spans_.size()) {
+    return kNoMatch;
+  }
+  const Span& span = spans_.at(id);
+  int total = 0;
+  for (qsizetype i = 0; i < pattern.terms_.size(); ++i) {
+    const int s = scoreTerm(span, pattern.terms_.at(i), pattern.masks_.at(i));
+    if (s == kNoMatch) {
+      return kNoMatch;
+    }
+    total += s;
+  }
+  return total;
+}
+
+QVector<int> FuzzyMatcher::rank(const Pattern& pattern, const QVector<int>* within) const {
+  if (pattern.isEmpty()) {
+    if (within) {
+      return *within;
+    }
+    QVector<int> all(size());
+    std::iota(all.begin(), all.end(), 0);
+    return all;
+  }
+
+  // Score in the high bits (inverted, so ascending order is best first),
+  // id in the low ones: one integer sort ranks and breaks ties.
+  QVector<quint64> ranked;
+  auto consider = [&](int id) {
+    const int s = score(id, pattern);
+    if (s != kNoMatch) {
+      ranked.push_back((quint64(INT_MAX - s) << 32) | quint32(id));
+    }
+  };
+  if (within) {
+    ranked.reserve(within->size());
+    for (int id : *within) {
+      consider(id);
+    }
+  } else {
+    ranked.reserve(spans_.size());
+    for (int id = 0; id < spans_.size(); ++id) {
+      consider(id);
+    }
+  }
+  radixSort(ranked);
+
+  QVector<int> ids;
+  ids.reserve(ranked.size());
+  for (quint64 r : ranked) {
+    ids.push_back(static_cast<int>(r & 0xffffffffu));
+  }
+  return ids;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+// fzf-style fuzzy matching over a fixed list of candidates. Each
+// candidate's key (its label, then its detail) is lowercased once and kept
+// in one flat buffer together with the bonus every position earns for
+// starting a word or a camelCase hump. A per-candidate character mask
+// rejects most non-matches without reading the key.
+//
+// A match is scored over the tightest window holding the term as a
+// subsequence: every matched character scores, gaps cost, and matches at
+// word boundaries, on camelCase humps and right after a previous match get
+// bonuses (the first character's counts double). Matches that only start
+// in the detail rank below label matches.
+class FuzzyMatcher final {
+ public:
+  static constexpr int kNoMatch = -1;
+
+  // Whitespace-separated terms, each of which has to match.
+  class Pattern final {
+   public:
+    Pattern() = default;
+    explicit Pattern(QStringView query);
+
+    bool isEmpty() const { return terms_.isEmpty(); }
+    // True when whatever matches this pattern also matched `previous`
+    // (the query only grew), so only those candidates need scoring.
+    bool narrows(const Pattern& previous) const;
+
+   private:
+    friend class FuzzyMatcher;
+    QString text_;
+    QStringList terms_;
+    QVector<quint64> masks_;
+  };
+
+  void clear();
+  void reserve(int candidates, qsizetype characters);
+  // Returns the id of the candidate: 0, 1, 2... in the order added.
+  int add(QStringView label, QStringView detail = {});
+  int size() const;
+
+  // Higher is better; kNoMatch when a term does not match. An empty
+  // pattern scores 0.
+  int score(int id, const Pattern& pattern) const;
+
+  // Ids of the candidates that match, best first, ties in id order. Only
+  // the ids in `within` are considered when it is given, and an empty
+  // pattern returns them (or every id) unchanged.
+  QVector<int> rank(const Pattern& pattern, const QVector<int>* within = nullptr) const;
+
+ private:
+  struct Span final {
+    qsizetype offset = 0;
+    int length = 0;
+    int labelLength = 0;
+    quint64 mask = 0;
+  };
+
+  QString keys_;
+  QByteArray bonus_;
+  QVector<Span> spans_;
+
+  int scoreTerm(const Span& span, QStringView term, quint64 termMask) const;
+};
@@ -0,0 +1,374 @@
+#include "library_catalog.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QVersionNumber>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kExactNameBonus = 1 << 20;
+constexpr int kNamePrefixBonus = 1 << 16;
+
+// Lowercased words of `text`. Names are also split at camel-case and
+// letter/digit boundaries so "WiFiNINA" is found by "nina" as well as "wifi".
+void appendWords(QStringView text, bool splitName, QStringList* out) {
+  qsizetype i = 0;
+  while (i < text.size()) {
+    while (i < text.size() && !text.at(i).isLetterOrNumber()) {
+      ++i;
+    }
+    const qsizetype start = i;
+    while (i < text.size() && text.at(i).isLetterOrNumber()) {
+      ++i;
+    }
+    if (start == i) {
+      break;
+    }
+    const QStringView word = text.mid(start, i - start);
+    out->push_back(word.toString().toLower());
+    if (!splitName) {
+      continue;
+    }
+
+    qsizetype partStart = 0;
+    for (qsizetype k = 1; k < word.size(); ++k) {
+      const QChar prev = word.at(k - 1);
+      const QChar cur = word.at(k);
+      const bool nextLower = k + 1 < word.size() && word.at(k + 1).isLower();
+      const bool boundary = (prev.isLower() && cur.isUpper()) ||
+                            (prev.isUpper() && cur.isUpper() && nextLower) ||
+                            (prev.isDigit() != cur.isDigit());
+      if (boundary) {
+        out->push_back(word.mid(partStart, k - partStart).toString().toLower());
+        partStart = k;
+      }
+    }
+    if (partStart > 0) {
+      out->push_back(word.mid(partStart).toString().toLower());
+    }
+  }
+}
+
+bool releaseNewer(const LibraryCatalog::Release& a, const LibraryCatalog::Release& b) {
+  const QVersionNumber av = QVersionNumber::fromString(a.version);
+  const QVersionNumber bv = QVersionNumber::fromString(b.version);
+  if (!av.isNull() && !bv.isNull()) {
+    return QVersionNumber::compare(av, bv) > 0;
+  }
+  if (av.isNull() != bv.isNull()) {
+    return !av.isNull();
+  }
+  return a.version > b.version;
+}
+
+QJsonObject releaseJson(const LibraryCatalog::Release& r) {
+  QJsonObject o;
+  o.insert("version", r.version);
+  o.insert("author", r.author);
+  o.insert("maintainer", r.maintainer);
+  o.insert("sentence", r.sentence);
+  o.insert("paragraph", r.paragraph);
+  o.insert("website", r.website);
+  o.insert("category", r.category);
+  o.insert("architectures", QJsonArray::fromStringList(r.architectures));
+  QJsonArray deps;
+  for (const auto& dep : r.dependencies) {
+    QJsonObject d;
+    d.insert("name", dep.first);
+    if (!dep.second.isEmpty()) {
+      d.insert("version_constraint", dep.second);
+    }
+    deps.append(d);
+  }
+  o.insert("dependencies", deps);
+  return o;
+}
+
+}  // namespace
+
+std::shared_ptr<const LibraryCatalog> LibraryCatalog::loadFile(const QString& indexPath,
+                                                               QString* error) {
+  QFile f(indexPath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = f.errorString();
+    }
+    return nullptr;
+  }
+  return fromJson(f.readAll(), error);
+}
+
+std::shared_ptr<const LibraryCatalog> LibraryCatalog::fromJson(const QByteArray& json,
+                                                               QString* error) {
+  QJsonParseError parseError;
+  const QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+  if (!doc.isObject()) {
+    if (error) {
+      *error = parseError.error != QJsonParseError::NoError
+                   ? parseError.errorString()
+                   : QStringLiteral("library index is not a JSON object");
+    }
+    return nullptr;
+  }
+
+  auto catalog = std::make_shared<LibraryCatalog>();
+  QHash<QString, int> idByName;
+  // Most fields repeat across a library's releases; keep one copy of each.
+  QHash<QString, QString> pool;
+  auto intern = [&pool](const QJsonValue& v) {
+    const QString s = v.toString().trimmed();
+    auto it = pool.constFind(s);
+    if (it != pool.constEnd()) {
+      return it.value();
+    }
+    pool.insert(s, s);
+    return s;
+  };
+
+  const QJsonArray entries = doc.object().value("libraries").toArray();
+  for (const QJsonValue& value : entries) {
+    const QJsonObject o = value.toObject();
+    const QString name = o.value("name").toString().trimmed();
+    if (name.isEmpty()) {
+      continue;
+    }
+
+    Release r;
+    r.version = o.value("version").toString().trimmed();
+    r.author = intern(o.value("author"));
+    r.maintainer = intern(o.value("maintainer"));
+    r.sentence = intern(o.value("sentence"));
+    r.paragraph = intern(o.value("paragraph"));
+    r.website = intern(o.value("website"));
+    r.category = intern(o.value("category"));
+    for (const QJsonValue& arch : o.value("architectures").toArray()) {
+      r.architectures << intern(arch);
+    }
+    for (const QJsonValue& dep : o.value("dependencies").toArray()) {
+      const QJsonObject d = dep.toObject();
+      const QString depName = intern(d.value("name"));
+      if (!depName.isEmpty()) {
+        r.dependencies.push_back({depName, intern(d.value("version"))});
+      }
+    }
+
+    auto it = idByName.constFind(name);
+    if (it == idByName.constEnd()) {
+      it = idByName.insert(name, static_cast<int>(catalog->libraries_.size()));
+      catalog->libraries_.push_back({name, {}});
+    }
+    catalog->libraries_[it.value()].releases.push_back(std::move(r));
+  }
+
+  for (Library& lib : catalog->libraries_) {
+    std::stable_sort(lib.releases.begin(), lib.releases.end(), releaseNewer);
+  }
+  catalog->buildIndex();
+  return catalog;
+}
+
+int LibraryCatalog::libraryCount() const {
+  return static_cast<int>(libraries_.size());
+}
+
+const LibraryCatalog::Library& LibraryCatalog::library(int id) const {
+  return libraries_.at(id);
+}
+
+void LibraryCatalog::buildIndex() {
+  const int count = libraryCount();
+  byName_.resize(count);
+  for (int i = 0; i < count; ++i) {
+    byName_[i] = i;
+  }
+  std::sort(byName_.begin(), byName_.end(), [this](int a, int b) {
+    const int c = QString::compare(libraries_.at(a).name, libraries_.at(b).name,
+                                   Qt::CaseInsensitive);
+    return c != 0 ? c < 0 : libraries_.at(a).name < libraries_.at(b).name;
+  });
+  nameRank_.resize(count);
+  for (int rank = 0; rank < count; ++rank) {
+    nameRank_[byName_.at(rank)] = rank;
+  }
+
+  // Libraries are visited in id order, so each token's postings come out
+  // sorted and a repeat of the same library is always the last entry.
+  QHash<QString, QVector<Posting>> index;
+  QStringList words;
+  auto add = [&index, &words](int id, quint8 field) {
+    for (const QString& w : words) {
+      QVector<Posting>& list = index[w];
+      if (!list.isEmpty() && list.last().library == id) {
+        list.last().fields |= field;
+      } else {
+        list.push_back({id, field});
+      }
+    }
+    words.clear();
+  };
+  for (int id = 0; id < count; ++id) {
+    const Library& lib = libraries_.at(id);
+    appendWords(lib.name, true, &words);
+    add(id, FieldName);
+    if (lib.releases.isEmpty()) {
+      continue;
+    }
+    const Release& latest = lib.releases.first();
+    appendWords(latest.author, false, &words);
+    appendWords(latest.maintainer, false, &words);
+    add(id, FieldAuthor);
+    for (const QString& arch : latest.architectures) {
+      appendWords(arch, false, &words);
+    }
+    add(id, FieldArchitecture);
+    appendWords(latest.sentence, false, &words);
+    add(id, FieldSentence);
+  }
+
+  vocabulary_ = index.keys();
+  std::sort(vocabulary_.begin(), vocabulary_.end());
+  postingStarts_.reserve(vocabulary_.size() + 1);
+  for (const QString& word : vocabulary_) {
+    postingStarts_.push_back(static_cast<int>(postings_.size()));
+    postings_ += index.value(word);
+  }
+  postingStarts_.push_back(static_cast<int>(postings_.size()));
+
+  // Words arrive sorted, so the child to extend is always the one added
+  // last; new children are prepended to keep that O(1).
+  trie_.push_back({});
+  trie_[0].end = static_cast<int>(vocabulary_.size());
+  for (int w = 0; w < vocabulary_.size(); ++w) {
+    int node = 0;
+    for (const QChar c : vocabulary_.at(w)) {
+      int child = trie_.at(node).firstChild;
+      if (child < 0 || trie_.at(child).ch != c.unicode()) {
+        TrieNode n;
+        n.ch = c.unicode();
+        n.nextSibling = trie_.at(node).firstChild;
+        n.begin = w;
+        child = static_cast<int>(trie_.size());
+        trie_.push_back(n);
+        trie_[node].firstChild = child;
+      }
+      trie_[child].end = w + 1;
+      node = child;
+    }
+  }
+}
+
+int LibraryCatalog::fieldWeight(quint8 fields) {
+  if (fields & FieldName) {
+    return 8;
+  }
+  if (fields & FieldAuthor) {
+    return 4;
+  }
+  if (fields & FieldArchitecture) {
+    return 2;
+  }
+  return 1;
+}
+
+const LibraryCatalog::TrieNode* LibraryCatalog::findPrefix(QStringView prefix) const {
+  int node = 0;
+  for (const QChar c : prefix) {
+    int child = trie_.at(node).firstChild;
+    while (child >= 0 && trie_.at(child).ch != c.unicode()) {
+      child = trie_.at(child).nextSibling;
+    }
+    if (child < 0) {
+      return nullptr;
+    }
+    node = child;
+  }
+  return &trie_.at(node);
+}
+
+QVector<int> LibraryCatalog::search(const QString& query) const {
+  QStringList terms;
+  appendWords(query, false, &terms);
+  terms.removeDuplicates();
+  if (terms.isEmpty()) {
+    return byName_;
+  }
+
+  const int count = libraryCount();
+  // termsMatched[id] == i means the library matched the first i terms.
+  QVector<int> termsMatched(count, 0);
+  QVector<int> score(count, 0);
+  QVector<int> termScore(count, 0);
+  QVector<int> touched;
+
+  for (int t = 0; t < terms.size(); ++t) {
+    const QString& term = terms.at(t);
+    const TrieNode* node = findPrefix(term);
+    if (!node) {
+      return {};
+    }
+    touched.clear();
+    for (int w = node->begin; w < node->end; ++w) {
+      const int exact = vocabulary_.at(w).size() == term.size() ? 2 : 1;
+      for (int p = postingStarts_.at(w); p < postingStarts_.at(w + 1); ++p) {
+        const Posting& posting = postings_.at(p);
+        const int weight = fieldWeight(posting.fields) * exact;
+        int& matched = termsMatched[posting.library];
+        if (matched == t) {
+          matched = t + 1;
+          termScore[posting.library] = weight;
+          touched.push_back(posting.library);
+        } else if (matched == t + 1) {
+          termScore[posting.library] = std::max(termScore.at(posting.library), weight);
+        }
+      }
+    }
+    for (int id : touched) {
+      score[id] += termScore.at(id);
+    }
+    if (touched.isEmpty()) {
+      return {};
+    }
+  }
+
+  // After the last term, `touched` holds exactly the libraries matching all.
+  QVector<int> results = touched;
+  const QString needle = query.trimmed();
+  for (int id : results) {
+    const QString& name = libraries_.at(id).name;
+    if (name.compare(needle, Qt::CaseInsensitive) == 0) {
+      score[id] += kExactNameBonus;
+    } else if (name.startsWith(needle, Qt::CaseInsensitive)) {
+      score[id] += kNamePrefixBonus;
+    }
+  }
+  std::sort(results.begin(), results.end(), [this, &score](int a, int b) {
+    if (score.at(a) != score.at(b)) {
+      return score.at(a) > score.at(b);
+    }
+    return nameRank_.at(a) < nameRank_.at(b);
+  });
+  return results;
+}
+
+QJsonObject LibraryCatalog::searchJson(int id) const {
+  const Library& lib = libraries_.at(id);
+  QJsonObject o;
+  o.insert("name", lib.name);
+  if (lib.releases.isEmpty()) {
+    return o;
+  }
+  o.insert("latest", releaseJson(lib.releases.first()));
+  QJsonObject releases;
+  QJsonArray versions;
+  for (const Release& r : lib.releases) {
+    releases.insert(r.version, releaseJson(r));
+    versions.append(r.version);
+  }
+  o.insert("releases", releases);
+  o.insert("available_versions", versions);
+  return o;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+// In-memory, read-only view of arduino-cli's library_index.json for the
+// Library Manager search. Tokens from each library's name, sentence,
+// author/maintainer and architectures go into an inverted index; a prefix
+// trie over the vocabulary maps a partially typed word to the range of
+// tokens it starts. Built once (on a worker thread) and then shared.
+class LibraryCatalog final {
+ public:
+  struct Release final {
+    QString version;
+    QString author;
+    QString maintainer;
+    QString sentence;
+    QString paragraph;
+    QString website;
+    QString category;
+    QStringList architectures;
+    QVector<QPair<QString, QString>> dependencies;  // name, version constraint
+  };
+
+  struct Library final {
+    QString name;
+    QVector<Release> releases;  // newest first
+  };
+
+  // Returns nullptr and sets `error` when the file cannot be read or parsed.
+  static std::shared_ptr<const LibraryCatalog> loadFile(const QString& indexPath,
+                                                        QString* error = nullptr);
+  static std::shared_ptr<const LibraryCatalog> fromJson(const QByteArray& json,
+                                                        QString* error = nullptr);
+
+  int libraryCount() const;
+  const Library& library(int id) const;
+
+  // Ids of libraries where every query word prefixes a word of the name,
+  // sentence, author or architectures, best match first. An empty query
+  // returns every library by name.
+  QVector<int> search(const QString& query) const;
+
+  // The library in the shape `arduino-cli lib search --json` reports it.
+  QJsonObject searchJson(int id) const;
+
+ private:
+  enum Field : quint8 {
+    FieldName = 1,
+    FieldAuthor = 2,
+    FieldArchitecture = 4,
+    FieldSentence = 8,
+  };
+
+  struct Posting final {
+    int library = 0;
+    quint8 fields = 0;
+  };
+
+  // First-child / next-sibling trie over the sorted vocabulary. Every node
+  // knows the [begin, end) range of vocabulary entries below it.
+  struct TrieNode final {
+    char16_t ch = 0;
+    int firstChild = -1;
+    int nextSibling = -1;
+    int begin = 0;
+    int end = 0;
+  };
+
+  QVector<Library> libraries_;
+  QVector<int> byName_;    // library ids ordered by name
+  QVector<int> nameRank_;  // inverse of byName_
+  QStringList vocabulary_;  // sorted
+  // Postings of vocabulary_[i] are postings_[postingStarts_[i], postingStarts_[i + 1]).
+  QVector<int> postingStarts_;
+  QVector<Posting> postings_;
+  QVector<TrieNode> trie_;
+
+  static int fieldWeight(quint8 fields);
+
+  void buildIndex();
+  const TrieNode* findPrefix(QStringView prefix) const;
+};
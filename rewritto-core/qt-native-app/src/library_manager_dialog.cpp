@@ -2,6 +2,7 @@
 
 #include "arduino_cli.h"
 #include "index_update_policy.h"
+#include "library_catalog.h"
 #include "output_widget.h"
 
 #include <QAbstractItemView>
@@ -13,6 +14,8 @@
 #include <QColor>
 #include <QDialog>
 #include <QDialogButtonBox>
+#include <QDir>
+#include <QFileInfo>
 #include <QHeaderView>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -31,6 +34,7 @@
 #include <QTabWidget>
 #include <QTableView>
 #include <QTextBrowser>
+#include <QThread>
 #include <QTimer>
 #include <QTreeWidget>
 #include <QVersionNumber>
@@ -48,6 +52,7 @@ enum SearchColumns { SColName = 0, SColLatest, SColCount };
 
 constexpr int kRoleAvailableVersions = Qt::UserRole + 1;
 constexpr int kRoleLibraryJson = Qt::UserRole + 2;
+constexpr int kRoleCatalogId = Qt::UserRole + 3;
 
 constexpr auto kLibraryManagerSettingsGroup = "LibraryManager";
 constexpr auto kLibIndexLastSuccessUtcKey = "libIndexLastSuccessUtc";
@@ -405,6 +410,11 @@ LibraryManagerDialog::LibraryManagerDialog(ArduinoCli* arduinoCli,
 }
 
 LibraryManagerDialog::~LibraryManagerDialog() {
+  if (catalogThread_) {
+    catalogThread_->wait();
+    delete catalogThread_;
+    catalogThread_ = nullptr;
+  }
   if (!process_) {
     return;
   }
@@ -422,8 +432,24 @@ bool LibraryManagerDialog::isBusy() const {
   return busy_;
 }
 
+void LibraryManagerDialog::setLibraryIndexPath(QString path) {
+  libraryIndexPath_ = std::move(path);
+}
+
+QString LibraryManagerDialog::libraryIndexPath() const {
+  if (!libraryIndexPath_.isEmpty()) {
+    return libraryIndexPath_;
+  }
+  const QString dataDir = arduinoCli_ ? arduinoCli_->arduinoDataDir() : QString{};
+  if (dataDir.isEmpty()) {
+    return {};
+  }
+  return QDir(dataDir).absoluteFilePath(QStringLiteral("library_index.json"));
+}
+
 void LibraryManagerDialog::refresh() {
   updateIndexStatusLabel();
+  ensureCatalog();
   if (shouldAutoUpdateIndexNow()) {
     runUpdateIndex(true);
     return;
@@ -707,9 +733,7 @@ void LibraryManagerDialog::wireSignals() {
       searchDetails_->clear();
       return;
     }
-    const QModelIndex nameIdx = searchModel_->index(idx.row(), SColName);
-    const QJsonObject lib =
-        searchModel_->data(nameIdx, kRoleLibraryJson).value<QJsonObject>();
+    const QJsonObject lib = searchLibraryJson(idx.row());
     const QString selectedVersion =
         searchVersionCombo_ ? searchVersionCombo_->currentText().trimmed() : QString{};
     searchDetails_->setHtml(
@@ -739,8 +763,7 @@ void LibraryManagerDialog::wireSignals() {
       return;
     }
     const QModelIndex nameIdx = searchModel_->index(idx.row(), SColName);
-    const QJsonObject lib =
-        searchModel_->data(nameIdx, kRoleLibraryJson).value<QJsonObject>();
+    const QJsonObject lib = searchLibraryJson(idx.row());
     const QStringList versions =
         searchModel_->data(nameIdx, kRoleAvailableVersions).toStringList();
     if (versions.isEmpty()) {
@@ -976,10 +999,6 @@ void LibraryManagerDialog::wireSignals() {
       if (searchEdit_->text().trimmed().size() < 2) {
         return;
       }
-      if (isBusy()) {
-        pendingAutoSearch_ = true;
-        return;
-      }
       runSearch();
     });
   }
@@ -1007,8 +1026,11 @@ void LibraryManagerDialog::wireSignals() {
         if (searchModel_) {
           searchModel_->removeRows(0, searchModel_->rowCount());
         }
+        searchCatalog_.reset();
         return;
       }
+      // Catalog searches are quick, but each one rebuilds the result rows,
+      // so they wait for typing to pause like CLI searches do.
       if (searchDebounceTimer_) {
         searchDebounceTimer_->start();
       }
@@ -1022,10 +1044,6 @@ void LibraryManagerDialog::wireSignals() {
       if (searchEdit_->text().trimmed().size() < 2) {
         return;
       }
-      if (isBusy()) {
-        pendingAutoSearch_ = true;
-        return;
-      }
       searchDebounceTimer_->start();
     });
   }
@@ -1281,12 +1299,22 @@ void LibraryManagerDialog::refreshInstalled() {
 }
 
 void LibraryManagerDialog::runSearch() {
+  const QString q = searchEdit_->text().trimmed();
+  if (ensureCatalog()) {
+    showCatalogResults(q);
+    return;
+  }
+  if (catalogThread_) {
+    // The index is being (re)loaded; search it once it is ready.
+    pendingCatalogSearch_ = true;
+    return;
+  }
+
   if (isBusy()) {
     pendingAutoSearch_ = true;
     return;
   }
 
-  const QString q = searchEdit_->text().trimmed();
   QStringList args = {QStringLiteral("lib"), QStringLiteral("search")};
   if (!q.isEmpty()) {
     args << q;
@@ -1300,6 +1328,7 @@ void LibraryManagerDialog::runSearch() {
     }
     const QJsonArray libs = doc.object().value("libraries").toArray();
 
+    searchCatalog_.reset();
     searchModel_->removeRows(0, searchModel_->rowCount());
     for (const QJsonValue& v : libs) {
       const QJsonObject lib = v.toObject();
@@ -1320,6 +1349,115 @@ void LibraryManagerDialog::runSearch() {
   });
 }
 
+bool LibraryManagerDialog::ensureCatalog() {
+  const QString path = libraryIndexPath();
+  const QFileInfo info(path);
+  if (path.isEmpty() || !info.isFile()) {
+    catalog_.reset();
+    return false;
+  }
+
+  // A file that failed to load is not retried until it changes; searches
+  // then go through the CLI.
+  const QDateTime modified = info.lastModified();
+  const bool attempted = catalogPath_ == path && catalogModified_ == modified;
+  if (!attempted && !catalogThread_) {
+    const quint64 generation = ++catalogGeneration_;
+    catalogThread_ = QThread::create([this, generation, path, modified] {
+      QString error;
+      std::shared_ptr<const LibraryCatalog> catalog = LibraryCatalog::loadFile(path, &error);
+      QMetaObject::invokeMethod(
+          this,
+          [this, generation, catalog, path, modified, error] {
+            finishCatalogLoad(generation, catalog, path, modified, error);
+          },
+          Qt::QueuedConnection);
+    });
+    catalogThread_->start();
+  }
+  // A catalog of the same file that is only out of date still answers
+  // searches until the reload lands.
+  return catalog_ && catalogPath_ == path;
+}
+
+void LibraryManagerDialog::finishCatalogLoad(quint64 generation,
+                                             std::shared_ptr<const LibraryCatalog> catalog,
+                                             QString path,
+                                             QDateTime modified,
+                                             QString error) {
+  if (generation != catalogGeneration_ || !catalogThread_) {
+    return;
+  }
+  catalogThread_->wait();
+  delete catalogThread_;
+  catalogThread_ = nullptr;
+
+  catalogPath_ = path;
+  catalogModified_ = modified;
+  catalog_ = std::move(catalog);
+  if (!catalog_) {
+    if (output_) {
+      output_->appendLine(
+          QStringLiteral("[Library Manager] Could not read %1: %2").arg(path, error));
+    }
+  }
+
+  // Rows from the previous catalog are refreshed against the new one.
+  const bool refreshRows = catalog_ && searchCatalog_ && searchCatalog_ != catalog_;
+  if (pendingCatalogSearch_ || refreshRows) {
+    pendingCatalogSearch_ = false;
+    if (catalog_) {
+      showCatalogResults(searchEdit_ ? searchEdit_->text().trimmed() : QString{});
+    } else {
+      runSearch();
+    }
+  }
+}
+
+void LibraryManagerDialog::showCatalogResults(const QString& query) {
+  if (!searchModel_ || !catalog_) {
+    return;
+  }
+  searchCatalog_ = catalog_;
+  const QVector<int> ids = catalog_->search(query);
+
+  searchModel_->removeRows(0, searchModel_->rowCount());
+  searchModel_->setRowCount(static_cast<int>(ids.size()));
+  for (int row = 0; row < ids.size(); ++row) {
+    const LibraryCatalog::Library& lib = catalog_->library(ids.at(row));
+    QStringList versions;
+    versions.reserve(lib.releases.size());
+    for (const LibraryCatalog::Release& r : lib.releases) {
+      versions << r.version;
+    }
+    auto* nameItem = new QStandardItem(lib.name);
+    nameItem->setData(sortVersions(std::move(versions)), kRoleAvailableVersions);
+    nameItem->setData(ids.at(row), kRoleCatalogId);
+    searchModel_->setItem(row, SColName, nameItem);
+    searchModel_->setItem(
+        row, SColLatest,
+        new QStandardItem(lib.releases.isEmpty() ? QString{} : lib.releases.first().version));
+  }
+  if (searchView_) {
+    searchView_->resizeColumnsToContents();
+    if (searchModel_->rowCount() > 0) {
+      searchView_->setCurrentIndex(searchModel_->index(0, SColName));
+    }
+  }
+}
+
+QJsonObject LibraryManagerDialog::searchLibraryJson(int row) const {
+  if (!searchModel_) {
+    return {};
+  }
+  const QModelIndex nameIdx = searchModel_->index(row, SColName);
+  const QVariant catalogId = searchModel_->data(nameIdx, kRoleCatalogId);
+  if (catalogId.isValid() && searchCatalog_) {
+    return searchCatalog_->searchJson(catalogId.toInt());
+  }
+  return searchModel_->data(nameIdx, kRoleLibraryJson).value<QJsonObject>();
+}
+
 QString LibraryManagerDialog::selectedInstalledLibraryName() const {
   const QModelIndex idx = installedView_->currentIndex();
   if (!idx.isValid()) {
@@ -1423,6 +1561,7 @@ void LibraryManagerDialog::runUpdateIndex(bool automatic) {
                  settings.remove(kLibIndexLastErrorUtcKey);
                  settings.remove(kLibIndexLastErrorMessageKey);
                  settings.endGroup();
+                 ensureCatalog();
                  emit librariesChanged();
                } else {
                  errorText = truncateMessage(QString::fromLocal8Bit(out), 2048);
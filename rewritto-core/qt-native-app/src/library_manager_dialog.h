@@ -1,10 +1,14 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <QDateTime>
+#include <QJsonObject>
 #include <QMap>
 #include <QWidget>
 
 class ArduinoCli;
+class LibraryCatalog;
 class OutputWidget;
 
 class QLineEdit;
@@ -18,6 +22,7 @@ class QTabWidget;
 class QTableView;
 class QLabel;
 class QTextBrowser;
+class QThread;
 class QWidget;
 class QTimer;
 
@@ -32,6 +37,12 @@ class LibraryManagerDialog final : public QWidget {
 
   bool isBusy() const;
 
+  // Searches run against this library_index.json when it exists, and fall
+  // back to `arduino-cli lib search` otherwise. Defaults to the one in the
+  // CLI's data directory.
+  void setLibraryIndexPath(QString path);
+  QString libraryIndexPath() const;
+
  public slots:
   void refresh();
   void cancel();
@@ -89,6 +100,16 @@ class LibraryManagerDialog final : public QWidget {
 
   QMap<QString, QString> pinnedLibraryVersions_;
 
+  QString libraryIndexPath_;
+  std::shared_ptr<const LibraryCatalog> catalog_;
+  QString catalogPath_;
+  QDateTime catalogModified_;
+  QThread* catalogThread_ = nullptr;
+  quint64 catalogGeneration_ = 0;
+  bool pendingCatalogSearch_ = false;
+  // Catalog the search rows were built from; rows refer to it by id.
+  std::shared_ptr<const LibraryCatalog> searchCatalog_;
+
   void buildUi();
   void wireSignals();
 
@@ -102,6 +123,14 @@ class LibraryManagerDialog final : public QWidget {
 
   void refreshInstalled();
   void runSearch();
+  bool ensureCatalog();
+  void finishCatalogLoad(quint64 generation,
+                         std::shared_ptr<const LibraryCatalog> catalog,
+                         QString path,
+                         QDateTime modified,
+                         QString error);
+  void showCatalogResults(const QString& query);
+  QJsonObject searchLibraryJson(int row) const;
 
   QString selectedInstalledLibraryName() const;
   QString selectedSearchLibraryName() const;
@@ -1,8 +1,110 @@
 #include "lsp_client.h"
 
+#include "lsp_message_framer.h"
+
+#include <algorithm>
+
 #include <QJsonDocument>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+// Short enough to feel live to the server, long enough to batch a burst of
+// keystrokes (or a multi-cursor/replace-all edit) into one didChange.
+constexpr int kChangeFlushDelayMs = 60;
+
+QVector<int> computeLineStarts(const QString& text) {
+  QVector<int> starts{0};
+  const QChar* data = text.constData();
+  const int size = text.size();
+  for (int i = 0; i < size; ++i) {
+    if (data[i] == QLatin1Char('\n')) {
+      starts.push_back(i + 1);
+    }
+  }
+  return starts;
+}
+
+void positionForOffset(const QVector<int>& lineStarts,
+                       int offset,
+                       int* line,
+                       int* character) {
+  const auto it = std::upper_bound(lineStarts.cbegin(), lineStarts.cend(), offset);
+  const int index = std::max(0, static_cast<int>(it - lineStarts.cbegin()) - 1);
+  *line = index;
+  *character = offset - lineStarts.at(index);
+}
+
+// Updates line start offsets for replacing [position, position + charsRemoved)
+// with `inserted`, touching only the starts at or after the edit.
+void applyEditToLineStarts(QVector<int>& lineStarts,
+                           int position,
+                           int charsRemoved,
+                           const QString& inserted) {
+  const auto first =
+      std::upper_bound(lineStarts.begin(), lineStarts.end(), position);
+  const auto last =
+      std::upper_bound(first, lineStarts.end(), position + charsRemoved);
+  const int firstIndex = static_cast<int>(first - lineStarts.begin());
+  lineStarts.erase(first, last);
+
+  QVector<int> added;
+  for (int i = 0; i < inserted.size(); ++i) {
+    if (inserted.at(i) == QLatin1Char('\n')) {
+      added.push_back(position + i + 1);
+    }
+  }
+  const int delta = static_cast<int>(inserted.size()) - charsRemoved;
+  for (int i = firstIndex; i < lineStarts.size(); ++i) {
+    lineStarts[i] += delta;
+  }
+  lineStarts.insert(firstIndex, added.size(), 0);
+  std::copy(added.cbegin(), added.cend(), lineStarts.begin() + firstIndex);
+}
+
+QJsonObject lspPosition(int line, int character) {
+  return QJsonObject{{"line", line}, {"character", character}};
+}
+
+LspClient::TextDocumentSyncKind syncKindFromCapabilities(const QJsonObject& caps) {
+  const QJsonValue sync = caps.value("textDocumentSync");
+  int kind = static_cast<int>(LspClient::TextDocumentSyncKind::Full);
+  if (sync.isDouble()) {
+    kind = sync.toInt();
+  } else if (sync.isObject()) {
+    kind = sync.toObject().value("change").toInt(
+        static_cast<int>(LspClient::TextDocumentSyncKind::None));
+  }
+  switch (kind) {
+    case 0:
+      return LspClient::TextDocumentSyncKind::None;
+    case 2:
+      return LspClient::TextDocumentSyncKind::Incremental;
+    default:
+      return LspClient::TextDocumentSyncKind::Full;
+  }
+}
+}  // namespace
+
+LspClient::LspClient(QObject* parent) : QObject(parent) {
+  changeFlushTimer_ = new QTimer(this);
+  changeFlushTimer_->setSingleShot(true);
+  changeFlushTimer_->setInterval(kChangeFlushDelayMs);
+  connect(changeFlushTimer_, &QTimer::timeout, this,
+          [this] { flushPendingChanges(); });
+
+  decoderThread_ = new QThread(this);
+  decoderThread_->setObjectName(QStringLiteral("LspDecoder"));
+  decoderContext_ = new QObject;
+  decoderContext_->moveToThread(decoderThread_);
+  connect(decoderThread_, &QThread::finished, decoderContext_, &QObject::deleteLater);
+  decoderThread_->start();
+}
 
-LspClient::LspClient(QObject* parent) : QObject(parent) {}
+LspClient::~LspClient() {
+  decoderThread_->quit();
+  decoderThread_->wait();
+}
 
 bool LspClient::isRunning() const {
   return process_ && process_->state() != QProcess::NotRunning;
@@ -16,11 +118,13 @@ void LspClient::start(QString program, QStringList args, QString rootUri) {
   stop();
 
   rootUri_ = std::move(rootUri);
-  documentVersions_.clear();
+  documents_.clear();
   pendingRequests_.clear();
-  readBuffer_.clear();
+  ++generation_;
+  framer_ = std::make_shared<LspMessageFramer>();
   nextRequestId_ = 1;
   initializeRequestId_ = -1;
+  syncKind_ = TextDocumentSyncKind::Full;
   setReady(false);
 
   process_ = new QProcess(this);
@@ -28,8 +132,7 @@ void LspClient::start(QString program, QStringList args, QString rootUri) {
   process_->setArguments(std::move(args));
 
   connect(process_, &QProcess::readyReadStandardOutput, this, [this] {
-    readBuffer_.append(process_->readAllStandardOutput());
-    handleIncoming();
+    decodeIncoming(process_->readAllStandardOutput());
   });
   connect(process_, &QProcess::readyReadStandardError, this, [this] {
     const QString msg = QString::fromLocal8Bit(process_->readAllStandardError());
@@ -71,12 +174,14 @@ void LspClient::start(QString program, QStringList args, QString rootUri) {
 
   initializeRequestId_ = sendRequest(
       "initialize", params,
-      [this](const QJsonValue&, const QJsonObject& error) {
+      [this](const QJsonValue& result, const QJsonObject& error) {
         if (!error.isEmpty()) {
           emit logMessage("LSP initialize failed: " + error.value("message").toString());
           stop();
           return;
         }
+        syncKind_ = syncKindFromCapabilities(
+            result.toObject().value("capabilities").toObject());
         sendNotification("initialized", QJsonObject{});
         setReady(true);
       });
@@ -105,8 +210,10 @@ void LspClient::stop() {
   p->deleteLater();
 
   process_ = nullptr;
-  readBuffer_.clear();
-  documentVersions_.clear();
+  ++generation_;
+  framer_.reset();
+  documents_.clear();
+  changeFlushTimer_->stop();
   pendingRequests_.clear();
   initializeRequestId_ = -1;
   setReady(false);
@@ -124,7 +231,11 @@ void LspClient::didOpen(const QString& uri,
   doc.insert("languageId", languageId);
   doc.insert("version", 1);
   doc.insert("text", text);
-  documentVersions_[uri] = 1;
+
+  OpenDocument state;
+  state.text = text;
+  state.lineStarts = computeLineStarts(text);
+  documents_.insert(uri, std::move(state));
   sendNotification("textDocument/didOpen", QJsonObject{{"textDocument", doc}});
 }
 
@@ -132,20 +243,88 @@ void LspClient::didChange(const QString& uri, const QString& text) {
   if (!isReady()) {
     return;
   }
-  int version = documentVersions_.value(uri, 1);
-  version += 1;
-  documentVersions_[uri] = version;
+  OpenDocument& doc = documents_[uri];
+  doc.text = text;
+  doc.lineStarts = computeLineStarts(text);
+  doc.pendingChanges.clear();
+  doc.pendingFullText = true;
+  sendDidChange(uri, doc);
+}
 
-  QJsonObject doc;
-  doc.insert("uri", uri);
-  doc.insert("version", version);
+void LspClient::didChangeContents(const QString& uri,
+                                  int position,
+                                  int charsRemoved,
+                                  const QString& insertedText) {
+  if (!isReady()) {
+    return;
+  }
+  const auto it = documents_.find(uri);
+  if (it == documents_.end()) {
+    return;
+  }
+  OpenDocument& doc = *it;
+  if (position < 0 || charsRemoved < 0 ||
+      position + charsRemoved > doc.text.size()) {
+    emit logMessage(QStringLiteral("LSP document out of sync: %1").arg(uri));
+    emit documentResyncRequested(uri);
+    return;
+  }
 
-  QJsonArray changes;
-  changes.push_back(QJsonObject{{"text", text}});
+  // Qt reports whole blocks for reloads and format-only updates; trim the
+  // unchanged head/tail so only the real edit goes over the wire.
+  const int maxCommon =
+      std::min(charsRemoved, static_cast<int>(insertedText.size()));
+  int prefix = 0;
+  while (prefix < maxCommon &&
+         doc.text.at(position + prefix) == insertedText.at(prefix)) {
+    ++prefix;
+  }
+  int suffix = 0;
+  while (suffix < maxCommon - prefix &&
+         doc.text.at(position + charsRemoved - 1 - suffix) ==
+             insertedText.at(insertedText.size() - 1 - suffix)) {
+    ++suffix;
+  }
+  const int start = position + prefix;
+  const int removed = charsRemoved - prefix - suffix;
+  const QString inserted =
+      insertedText.mid(prefix, insertedText.size() - prefix - suffix);
+  if (removed == 0 && inserted.isEmpty()) {
+    return;
+  }
 
-  sendNotification("textDocument/didChange",
-                   QJsonObject{{"textDocument", doc},
-                               {"contentChanges", changes}});
+  PendingChange change;
+  change.startOffset = start;
+  positionForOffset(doc.lineStarts, start, &change.startLine,
+                    &change.startCharacter);
+  positionForOffset(doc.lineStarts, start + removed, &change.endLine,
+                    &change.endCharacter);
+  change.text = inserted;
+
+  doc.text.replace(start, removed, inserted);
+  applyEditToLineStarts(doc.lineStarts, start, removed, inserted);
+
+  if (syncKind_ != TextDocumentSyncKind::Incremental) {
+    doc.pendingFullText = true;
+  } else if (!doc.pendingFullText) {
+    // Typing and backspacing at the end of the previous edit extend that edit
+    // instead of queueing a new range.
+    PendingChange* last =
+        doc.pendingChanges.isEmpty() ? nullptr : &doc.pendingChanges.last();
+    const int lastEnd = last ? last->startOffset + last->text.size() : -1;
+    if (last && removed == 0 && start == lastEnd) {
+      last->text += inserted;
+    } else if (last && inserted.isEmpty() && start + removed == lastEnd &&
+               start >= last->startOffset) {
+      last->text.chop(removed);
+    } else {
+      doc.pendingChanges.push_back(std::move(change));
+    }
+  }
+
+  if (!changeFlushTimer_->isActive()) {
+    changeFlushTimer_->start();
+  }
 }
 
 void LspClient::didClose(const QString& uri) {
@@ -155,7 +334,56 @@ void LspClient::didClose(const QString& uri) {
   QJsonObject doc;
   doc.insert("uri", uri);
   sendNotification("textDocument/didClose", QJsonObject{{"textDocument", doc}});
-  documentVersions_.remove(uri);
+  documents_.remove(uri);
+}
+
+void LspClient::flushPendingChanges() {
+  changeFlushTimer_->stop();
+  for (auto it = documents_.begin(); it != documents_.end(); ++it) {
+    sendDidChange(it.key(), it.value());
+  }
+}
+
+LspClient::TextDocumentSyncKind LspClient::textDocumentSyncKind() const {
+  return syncKind_;
+}
+
+void LspClient::sendDidChange(const QString& uri, OpenDocument& doc) {
+  if (!doc.pendingFullText && doc.pendingChanges.isEmpty()) {
+    return;
+  }
+  if (syncKind_ == TextDocumentSyncKind::None) {
+    doc.pendingChanges.clear();
+    doc.pendingFullText = false;
+    return;
+  }
+
+  doc.version += 1;
+  QJsonObject textDocument;
+  textDocument.insert("uri", uri);
+  textDocument.insert("version", doc.version);
+
+  QJsonArray changes;
+  if (doc.pendingFullText) {
+    changes.push_back(QJsonObject{{"text", doc.text}});
+  } else {
+    for (const PendingChange& change : doc.pendingChanges) {
+      changes.push_back(QJsonObject{
+          {"range",
+           QJsonObject{
+               {"start", lspPosition(change.startLine, change.startCharacter)},
+               {"end", lspPosition(change.endLine, change.endCharacter)},
+           }},
+          {"text", change.text},
+      });
+    }
+  }
+  doc.pendingChanges.clear();
+  doc.pendingFullText = false;
+
+  sendNotification("textDocument/didChange",
+                   QJsonObject{{"textDocument", textDocument},
+                               {"contentChanges", changes}});
 }
 
 void LspClient::sendMessage(const QJsonObject& obj) {
@@ -217,6 +445,8 @@ int LspClient::request(const QString& method,
     }
     return -1;
   }
+  // The server must see every edit before answering position-based requests.
+  flushPendingChanges();
   return sendRequest(method, params, std::move(handler));
 }
 
@@ -228,42 +458,65 @@ void LspClient::sendNotification(const QString& method, const QJsonValue& params
   sendMessage(obj);
 }
 
-void LspClient::handleIncoming() {
-  while (true) {
-    const int headerEnd = readBuffer_.indexOf("\r\n\r\n");
-    if (headerEnd < 0) {
-      return;
-    }
-    const QByteArray headerBytes = readBuffer_.left(headerEnd);
-    const QList<QByteArray> headerLines = headerBytes.split('\n');
-    int contentLength = -1;
-    for (QByteArray line : headerLines) {
-      line = line.trimmed();
-      if (line.toLower().startsWith("content-length:")) {
-        const QByteArray value = line.mid(strlen("content-length:")).trimmed();
-        contentLength = value.toInt();
-        break;
-      }
-    }
-    if (contentLength < 0) {
-      // Not an LSP message; dump as log and clear.
-      emit logMessage(QString::fromLocal8Bit(readBuffer_));
-      readBuffer_.clear();
-      return;
-    }
-    const int payloadStart = headerEnd + 4;
-    if (readBuffer_.size() < payloadStart + contentLength) {
-      return;
-    }
-    const QByteArray payload =
-        readBuffer_.mid(payloadStart, contentLength);
-    readBuffer_.remove(0, payloadStart + contentLength);
+void LspClient::decodeIncoming(const QByteArray& chunk) {
+  if (chunk.isEmpty() || !framer_) {
+    return;
+  }
+  const std::shared_ptr<LspMessageFramer> framer = framer_;
+  const quint64 generation = generation_;
+  // `this` outlives every decoder job: the destructor joins decoderThread_.
+  QMetaObject::invokeMethod(
+      decoderContext_,
+      [this, framer, chunk, generation] {
+        framer->append(chunk);
+        QVector<QJsonObject> messages;
+        QStringList logLines;
+        QByteArray payload;
+        QByteArray discarded;
+        while (true) {
+          const LspMessageFramer::Status status = framer->next(&payload, &discarded);
+          if (status == LspMessageFramer::Status::NeedMoreData) {
+            break;
+          }
+          if (status == LspMessageFramer::Status::InvalidHeader) {
+            // Not an LSP message; surface it as log output.
+            logLines << QString::fromLocal8Bit(discarded);
+            continue;
+          }
+          const QJsonDocument doc = QJsonDocument::fromJson(payload);
+          if (doc.isObject()) {
+            messages.push_back(doc.object());
+          }
+        }
+        if (messages.isEmpty() && logLines.isEmpty()) {
+          return;
+        }
+        QMetaObject::invokeMethod(
+            this,
+            [this, generation, messages = std::move(messages),
+             logLines = std::move(logLines)] {
+              handleDecoded(generation, messages, logLines);
+            },
+            Qt::QueuedConnection);
+      },
+      Qt::QueuedConnection);
+}
 
-    const QJsonDocument doc = QJsonDocument::fromJson(payload);
-    if (!doc.isObject()) {
-      continue;
+void LspClient::handleDecoded(quint64 generation,
+                              const QVector<QJsonObject>& messages,
+                              const QStringList& logLines) {
+  if (generation != generation_) {
+    return;
+  }
+  for (const QString& line : logLines) {
+    emit logMessage(line);
+  }
+  for (const QJsonObject& msg : messages) {
+    // A handler may stop or restart the client mid-batch.
+    if (generation != generation_) {
+      return;
     }
-    handleMessage(doc.object());
+    handleMessage(msg);
   }
 }
 
@@ -1,18 +1,32 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 
 #include <QHash>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QObject>
 #include <QProcess>
+#include <QVector>
+
+class LspMessageFramer;
+class QThread;
+class QTimer;
 
 class LspClient final : public QObject {
   Q_OBJECT
 
  public:
+  // Mirrors LSP's TextDocumentSyncKind as advertised by the server.
+  enum class TextDocumentSyncKind {
+    None = 0,
+    Full = 1,
+    Incremental = 2,
+  };
+
   explicit LspClient(QObject* parent = nullptr);
+  ~LspClient() override;
 
  bool isRunning() const;
   bool isReady() const;
@@ -21,8 +35,19 @@ class LspClient final : public QObject {
   void stop();
 
   void didOpen(const QString& uri, const QString& languageId, const QString& text);
+  // Replaces the whole document text.
   void didChange(const QString& uri, const QString& text);
+  // Applies a QTextDocument::contentsChange-style edit (UTF-16 offsets).
+  // Edits are queued and sent as one batched notification, either as ranges
+  // or as the full text depending on what the server negotiated.
+  void didChangeContents(const QString& uri,
+                         int position,
+                         int charsRemoved,
+                         const QString& insertedText);
   void didClose(const QString& uri);
+  void flushPendingChanges();
+
+  TextDocumentSyncKind textDocumentSyncKind() const;
 
   using ResponseHandler = std::function<void(const QJsonValue& result,
                                              const QJsonObject& error)>;
@@ -32,17 +57,43 @@ class LspClient final : public QObject {
   void readyChanged(bool ready);
   void logMessage(QString message);
   void publishDiagnostics(QString uri, QJsonArray diagnostics);
+  // Emitted when an incremental edit no longer matches the tracked text; the
+  // owner should answer with didChange(uri, fullText).
+  void documentResyncRequested(QString uri);
 
  private:
   QProcess* process_ = nullptr;
   bool stopping_ = false;
-  QByteArray readBuffer_;
+  // Framing and JSON decoding run on decoderThread_; only decoded messages
+  // come back to this object's thread. Batches from a previous process are
+  // recognized by their generation and dropped.
+  QThread* decoderThread_ = nullptr;
+  QObject* decoderContext_ = nullptr;
+  std::shared_ptr<LspMessageFramer> framer_;
+  quint64 generation_ = 0;
   int nextRequestId_ = 1;
   bool ready_ = false;
   QString rootUri_;
-  QHash<QString, int> documentVersions_;
+  struct PendingChange final {
+    int startOffset = 0;
+    int startLine = 0;
+    int startCharacter = 0;
+    int endLine = 0;
+    int endCharacter = 0;
+    QString text;
+  };
+  struct OpenDocument final {
+    int version = 1;
+    QString text;
+    QVector<int> lineStarts{0};
+    QVector<PendingChange> pendingChanges;
+    bool pendingFullText = false;
+  };
+  QHash<QString, OpenDocument> documents_;
   QHash<int, ResponseHandler> pendingRequests_;
   int initializeRequestId_ = -1;
+  TextDocumentSyncKind syncKind_ = TextDocumentSyncKind::Full;
+  QTimer* changeFlushTimer_ = nullptr;
 
   void sendMessage(const QJsonObject& obj);
   void sendResponse(int id, const QJsonValue& result);
@@ -50,7 +101,11 @@ class LspClient final : public QObject {
   int sendRequest(const QString& method, const QJsonValue& params, ResponseHandler handler);
   void sendNotification(const QString& method, const QJsonValue& params);
 
-  void handleIncoming();
+  void sendDidChange(const QString& uri, OpenDocument& doc);
+  void decodeIncoming(const QByteArray& chunk);
+  void handleDecoded(quint64 generation,
+                     const QVector<QJsonObject>& messages,
+                     const QStringList& logLines);
   void handleMessage(const QJsonObject& msg);
   void setReady(bool ready);
 };
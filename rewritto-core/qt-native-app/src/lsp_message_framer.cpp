@@ -0,0 +1,110 @@
+#include "lsp_message_framer.h"
+
+#include <cstring>
+
+namespace {
+// Compact once this many consumed bytes sit in front of the read cursor and
+// they make up at least half of the buffer.
+constexpr qsizetype kCompactThresholdBytes = 64 * 1024;
+
+qsizetype parseContentLength(const char* begin, const char* end) {
+  static constexpr char kKey[] = "content-length:";
+  static constexpr qsizetype kKeyLen = sizeof(kKey) - 1;
+
+  const char* line = begin;
+  while (line < end) {
+    const char* lineEnd =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (!lineEnd) {
+      lineEnd = end;
+    }
+    if (lineEnd - line > kKeyLen && qstrnicmp(line, kKey, kKeyLen) == 0) {
+      const char* p = line + kKeyLen;
+      while (p < lineEnd && (*p == ' ' || *p == '\t')) {
+        ++p;
+      }
+      qsizetype value = 0;
+      bool any = false;
+      while (p < lineEnd && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        any = true;
+        ++p;
+      }
+      return any ? value : -1;
+    }
+    line = lineEnd + 1;
+  }
+  return -1;
+}
+}  // namespace
+
+void LspMessageFramer::append(const QByteArray& data) {
+  compact();
+  buffer_.append(data);
+}
+
+void LspMessageFramer::clear() {
+  buffer_.clear();
+  readPos_ = 0;
+  pendingPayloadStart_ = -1;
+  pendingContentLength_ = -1;
+}
+
+LspMessageFramer::Status LspMessageFramer::next(QByteArray* payload,
+                                                QByteArray* discarded) {
+  if (pendingPayloadStart_ < 0) {
+    const qsizetype headerEnd = buffer_.indexOf("\r\n\r\n", readPos_);
+    if (headerEnd < 0) {
+      return Status::NeedMoreData;
+    }
+    const char* data = buffer_.constData();
+    const qsizetype contentLength =
+        parseContentLength(data + readPos_, data + headerEnd);
+    if (contentLength < 0) {
+      if (discarded) {
+        *discarded = buffer_.mid(readPos_, headerEnd - readPos_);
+      }
+      readPos_ = headerEnd + 4;
+      return Status::InvalidHeader;
+    }
+    pendingPayloadStart_ = headerEnd + 4;
+    pendingContentLength_ = contentLength;
+  }
+
+  if (buffer_.size() - pendingPayloadStart_ < pendingContentLength_) {
+    return Status::NeedMoreData;
+  }
+
+  if (payload) {
+    *payload = QByteArray::fromRawData(buffer_.constData() + pendingPayloadStart_,
+                                       pendingContentLength_);
+  }
+  readPos_ = pendingPayloadStart_ + pendingContentLength_;
+  pendingPayloadStart_ = -1;
+  pendingContentLength_ = -1;
+  return Status::Message;
+}
+
+qsizetype LspMessageFramer::bufferedBytes() const {
+  return buffer_.size() - readPos_;
+}
+
+void LspMessageFramer::compact() {
+  if (readPos_ == 0) {
+    return;
+  }
+  if (readPos_ >= buffer_.size()) {
+    // Everything consumed: keep the allocation, drop the contents.
+    buffer_.resize(0);
+    readPos_ = 0;
+    return;
+  }
+  if (readPos_ < kCompactThresholdBytes || readPos_ * 2 < buffer_.size()) {
+    return;
+  }
+  buffer_.remove(0, readPos_);
+  if (pendingPayloadStart_ >= 0) {
+    pendingPayloadStart_ -= readPos_;
+  }
+  readPos_ = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+
+// Splits a Content-Length framed JSON-RPC byte stream into message payloads.
+// Headers are scanned in place behind a read cursor; consumed bytes are only
+// dropped from the front of the buffer once enough of them pile up, so a
+// flood of small messages costs O(total bytes) rather than one memmove each.
+class LspMessageFramer final {
+ public:
+  enum class Status {
+    NeedMoreData,
+    Message,
+    InvalidHeader,
+  };
+
+  void append(const QByteArray& data);
+  void clear();
+
+  // On Message, `payload` views the internal buffer without copying and stays
+  // valid until the next append()/next()/clear(). On InvalidHeader, the
+  // skipped header bytes are copied into `discarded`.
+  Status next(QByteArray* payload, QByteArray* discarded = nullptr);
+
+  qsizetype bufferedBytes() const;
+
+ private:
+  QByteArray buffer_;
+  qsizetype readPos_ = 0;
+  // Header of the message currently waiting for its body, if any.
+  qsizetype pendingPayloadStart_ = -1;
+  qsizetype pendingContentLength_ = -1;
+
+  void compact();
+};
@@ -1,8 +1,10 @@
 #include "main_window.h"
 
 #include "arduino_cli.h"
+#include "board_details_cache.h"
 #include "board_selector_dialog.h"
 #include "boards_manager_dialog.h"
+#include "build_directory_manager.h"
 #include "build_output_parser.h"
 #include "code_editor.h"
 #include "code_snapshot_compare_dialog.h"
@@ -13,10 +15,13 @@
 #include "examples_scanner.h"
 #include "find_in_files_dialog.h"
 #include "find_replace_dialog.h"
+#include "fuzzy_matcher.h"
 #include "library_manager_dialog.h"
 #include "lsp_client.h"
 #include "lsp_code_action_utils.h"
 #include "output_widget.h"
+#include "platform_catalog.h"
+#include "port_watcher.h"
 #include "preferences_dialog.h"
 #include "quick_pick_dialog.h"
 #include "replace_in_files_dialog.h"
@@ -25,11 +30,14 @@
 #include "serial_plotter_widget.h"
 #include "serial_port.h"
 #include "sketch_manager.h"
+#include "sketch_signature.h"
 #include "sketch_build_settings_store.h"
 #include "theme_manager.h"
 #include "toast_widget.h"
 #include "interface_scale_manager.h"
 #include "welcome_widget.h"
+#include "workspace_file_index.h"
+#include "zip_archive.h"
 
 #include <QDesktopServices>
 
@@ -38,6 +46,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <utility>
 #include <QAbstractButton>
 #include <QAction>
 #include <QActionGroup>
@@ -65,6 +74,7 @@
 #include <QFontDatabase>
 #include <QGuiApplication>
 #include <QHBoxLayout>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -112,6 +122,7 @@
 #include <QStyle>
 #include <QTabWidget>
 #include <QTemporaryDir>
+#include <QThread>
 #include <QToolBar>
 #include <QToolTip>
 #include <QTreeView>
@@ -134,6 +145,8 @@ static constexpr auto kPinnedSketchesKey = "pinnedSketches";
 static constexpr auto kGeometryKey = "geometry";
 static constexpr auto kStateKey = "state";
 static constexpr auto kFqbnKey = "fqbn";
+static constexpr auto kRecentBoardsKey = "recentBoards";
+static constexpr qsizetype kMaxCliOutputCaptureChars = 512 * 1024;
 static constexpr auto kPortKey = "port";
 static constexpr auto kProgrammerKey = "programmer";
 static constexpr auto kOptimizeForDebugKey = "optimizeForDebug";
@@ -148,7 +161,9 @@ static constexpr auto kStateVersionKey = "stateVersion";
 static constexpr auto kSketchBoardSelectionsKey = "sketchBoardSelections";
 static constexpr auto kBoardSetupWizardCompletedKey = "boardSetupWizardCompleted";
 static constexpr auto kPrefCheckIndexesOnStartupKey = "checkIndexesOnStartup";
+static constexpr auto kPrefBuildCacheMaxMbKey = "buildCacheMaxMb";
 static constexpr int kCurrentStateVersion = 1;
+static constexpr int kMaxRecentBoards = 8;
 
 namespace {
 constexpr int kCompletionRoleInsertText = Qt::UserRole + 100;
@@ -970,79 +985,7 @@ bool copyDirectoryRecursivelyMerged(const QString& sourceDir,
 bool extractZipArchive(const QString& zipPath,
                        const QString& destinationDir,
                        QString* outError) {
-  if (!QFileInfo(zipPath).isFile()) {
-    if (outError) {
-      *outError = QObject::tr("Archive file does not exist.");
-    }
-    return false;
-  }
-  if (!QDir().mkpath(destinationDir)) {
-    if (outError) {
-      *outError = QObject::tr("Could not create extraction folder.");
-    }
-    return false;
-  }
-
-  const QString unzipPath =
-      QStandardPaths::findExecutable(QStringLiteral("unzip"));
-  if (!unzipPath.isEmpty()) {
-    const CommandResult result = runCommandBlocking(
-        unzipPath,
-        {QStringLiteral("-oq"), zipPath, QStringLiteral("-d"), destinationDir},
-        {}, {}, 900000);
-    if (result.started && !result.timedOut &&
-        result.exitStatus == QProcess::NormalExit && result.exitCode == 0) {
-      if (outError) {
-        outError->clear();
-      }
-      return true;
-    }
-    if (outError) {
-      *outError = commandErrorSummary(result);
-    }
-  }
-
-  const QString bsdtarPath =
-      QStandardPaths::findExecutable(QStringLiteral("bsdtar"));
-  if (!bsdtarPath.isEmpty()) {
-    const CommandResult result = runCommandBlocking(
-        bsdtarPath,
-        {QStringLiteral("-xf"), zipPath, QStringLiteral("-C"), destinationDir},
-        {}, {}, 900000);
-    if (result.started && !result.timedOut &&
-        result.exitStatus == QProcess::NormalExit && result.exitCode == 0) {
-      if (outError) {
-        outError->clear();
-      }
-      return true;
-    }
-    if (outError) {
-      *outError = commandErrorSummary(result);
-    }
-  }
-
-  const QString tarPath = QStandardPaths::findExecutable(QStringLiteral("tar"));
-  if (!tarPath.isEmpty()) {
-    const CommandResult result = runCommandBlocking(
-        tarPath,
-        {QStringLiteral("-xf"), zipPath, QStringLiteral("-C"), destinationDir},
-        {}, {}, 900000);
-    if (result.started && !result.timedOut &&
-        result.exitStatus == QProcess::NormalExit && result.exitCode == 0) {
-      if (outError) {
-        outError->clear();
-      }
-      return true;
-    }
-    if (outError) {
-      *outError = commandErrorSummary(result);
-    }
-  }
-
-  if (outError && outError->trimmed().isEmpty()) {
-    *outError = QObject::tr("No archive extractor available (need unzip or tar).");
-  }
-  return false;
+  return ZipArchive::extractToDirectory(zipPath, destinationDir, outError);
 }
 
 QString findBundleRootDirectory(const QString& extractedRoot,
@@ -2587,6 +2530,152 @@ bool lspRangeToDocumentOffsets(QTextDocument* doc,
   return true;
 }
 
+// How a line of CLI output is shown in the output panel.
+struct CliLineStyle final {
+  bool print = false;
+  QColor color;  // invalid: default text color
+  bool bold = false;
+};
+
+constexpr QRgb kCliErrorRgb = 0xd32f2f;
+constexpr QRgb kCliWarningRgb = 0xfbc02d;
+constexpr QRgb kCliSuccessRgb = 0x388e3c;
+
+// Runs for every line of a build, so it only does case-insensitive literal
+// checks on a view of the line: no lowercased copies, no regexes.
+CliLineStyle classifyCliOutputLine(QStringView line, bool verbose) {
+  CliLineStyle style;
+  if (line.trimmed().isEmpty()) {
+    return style;
+  }
+  auto has = [line](QLatin1String needle) {
+    return line.contains(needle, Qt::CaseInsensitive);
+  };
+  auto startsWith = [line](QLatin1String prefix) {
+    return line.startsWith(prefix, Qt::CaseInsensitive);
+  };
+
+  style.print = verbose;
+  if (has(QLatin1String("error:")) || has(QLatin1String("fatal error"))) {
+    style.color = QColor::fromRgb(kCliErrorRgb);
+    style.print = true;
+  } else if (has(QLatin1String("warning:"))) {
+    style.color = QColor::fromRgb(kCliWarningRgb);
+    style.print = true;
+  } else if (startsWith(QLatin1String("sketch uses")) ||
+             startsWith(QLatin1String("global variables"))) {
+    style.color = QColor::fromRgb(kCliSuccessRgb);
+    style.bold = true;
+    style.print = true;
+  } else if (line.contains(QLatin1String("SUCCESS"))) {
+    style.color = QColor::fromRgb(kCliSuccessRgb);
+    style.bold = true;
+    style.print = true;
+  } else if (startsWith(QLatin1String("uploading...")) ||
+             line.contains(QLatin1String("Writing")) ||
+             line.contains(QLatin1String("Reading"))) {
+    style.print = true;
+  }
+
+  if (!style.print) {
+    style.print = startsWith(QLatin1String("uploading")) ||
+                  startsWith(QLatin1String("writing at")) ||
+                  startsWith(QLatin1String("hash of data verified")) ||
+                  startsWith(QLatin1String("hard resetting")) ||
+                  startsWith(QLatin1String("waiting for upload port")) ||
+                  startsWith(QLatin1String("new upload port")) ||
+                  startsWith(QLatin1String("error during upload")) ||
+                  startsWith(QLatin1String("failed uploading")) ||
+                  has(QLatin1String("no device found")) ||
+                  has(QLatin1String("permission denied")) ||
+                  has(QLatin1String("not in sync")) ||
+                  has(QLatin1String("timed out")) ||
+                  has(QLatin1String("timeout")) ||
+                  has(QLatin1String("can not open port")) ||
+                  has(QLatin1String("cannot open port"));
+  }
+  return style;
+}
+
+// Variable-object name of a locals/watches row; children are fetched with it.
+constexpr int kDebugVarIdRole = Qt::UserRole;
+constexpr int kDebugChildrenLoadedRole = Qt::UserRole + 1;
+
+QTreeWidgetItem* makeDebugVariableItem(const DebugSession::Variable& var) {
+  auto* item = new QTreeWidgetItem({var.expression, var.value, var.type});
+  item->setData(0, kDebugVarIdRole, var.id);
+  item->setToolTip(1, var.value);
+  if (var.changed) {
+    QFont font = item->font(1);
+    font.setBold(true);
+    item->setFont(1, font);
+  }
+  if (!var.id.isEmpty() && var.childCount > 0) {
+    item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+  }
+  return item;
+}
+
+// One entry of File > Examples: a submenu when it has children, an action
+// when an example sits at its path (or both).
+struct ExampleMenuNode final {
+  QString title;
+  QString inoPath;
+  std::vector<std::unique_ptr<ExampleMenuNode>> children;
+  QHash<QString, ExampleMenuNode*> childByTitle;
+};
+
+std::shared_ptr<const ExampleMenuNode> buildExampleMenuTree(
+    const QVector<ExampleSketch>& examples) {
+  auto root = std::make_shared<ExampleMenuNode>();
+  for (const ExampleSketch& ex : examples) {
+    ExampleMenuNode* node = root.get();
+    for (const QString& segment : ex.menuPath) {
+      ExampleMenuNode*& child = node->childByTitle[segment];
+      if (!child) {
+        node->children.push_back(std::make_unique<ExampleMenuNode>());
+        child = node->children.back().get();
+        child->title = segment;
+      }
+      node = child;
+    }
+    if (node != root.get() && node->inoPath.isEmpty()) {
+      node->inoPath = ex.inoPath;
+    }
+  }
+  return root;
+}
+
+// Adds the entries below `node` to `menu`. Submenus stay empty until they
+// are first about to show, so only the menus the user opens are built.
+void populateExampleMenu(QMenu* menu,
+                         const ExampleMenuNode* node,
+                         const std::shared_ptr<const ExampleMenuNode>& tree,
+                         const std::function<void(const QString&)>& open,
+                         bool separateEntries) {
+  for (const auto& child : node->children) {
+    if (separateEntries && child != node->children.front()) {
+      menu->addSeparator();
+    }
+    if (!child->children.empty()) {
+      QMenu* sub = menu->addMenu(child->title);
+      const ExampleMenuNode* childNode = child.get();
+      QObject::connect(
+          sub, &QMenu::aboutToShow, sub,
+          [sub, childNode, tree, open] {
+            populateExampleMenu(sub, childNode, tree, open, false);
+          },
+          Qt::SingleShotConnection);
+    }
+    if (!child->inoPath.isEmpty()) {
+      QAction* a = menu->addAction(child->title);
+      const QString inoPath = child->inoPath;
+      QObject::connect(a, &QAction::triggered, menu,
+                       [open, inoPath] { open(QFileInfo(inoPath).absolutePath()); });
+    }
+  }
+}
+
 }  // namespace
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
@@ -2598,6 +2687,15 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
 
   sketchManager_ = new SketchManager(this);
   arduinoCli_ = new ArduinoCli(this);
+  platformCatalog_ = new PlatformCatalogService(arduinoCli_, this);
+  examplesIndex_ = new ExamplesIndex(this);
+  workspaceFiles_ = new WorkspaceFileIndex(this);
+  boardDetailsCache_ = new BoardDetailsCache(arduinoCli_, this);
+  boardDetailsCache_->setPlatformVersionResolver([this](const QString& platformId) {
+    const std::shared_ptr<const PlatformCatalog> catalog = platformCatalog_->catalog();
+    const int id = catalog ? catalog->indexOf(platformId) : -1;
+    return id >= 0 ? catalog->platform(id).installedVersion : QString{};
+  });
   lsp_ = new LspClient(this);
   lspRestartTimer_ = new QTimer(this);
   lspRestartTimer_->setSingleShot(true);
@@ -2725,21 +2823,21 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   }
   updateWelcomePage();
 
-  portsWatchDebounceTimer_ = new QTimer(this);
-  portsWatchDebounceTimer_->setSingleShot(true);
-  portsWatchDebounceTimer_->setInterval(250);
-  connect(portsWatchDebounceTimer_, &QTimer::timeout, this, [this] {
+  // Watch events update the port model directly; while a CLI job runs
+  // the combo is left alone and rebuilt once the job finishes.
+  portWatcher_ = new PortWatcher(arduinoCli_, this);
+  connect(portWatcher_, &PortWatcher::portsChanged, this, [this] {
     if (arduinoCli_ && arduinoCli_->isRunning()) {
       portsRefreshQueued_ = true;
       return;
     }
-    refreshConnectedPorts();
+    rebuildPortCombo();
   });
 
   portsAutoRefreshTimer_ = new QTimer(this);
   portsAutoRefreshTimer_->setInterval(2500);
   connect(portsAutoRefreshTimer_, &QTimer::timeout, this, [this] {
-    if (portsWatchProcess_ && portsWatchProcess_->state() != QProcess::NotRunning) {
+    if (portWatcher_ && portWatcher_->isRunning()) {
       return;
     }
     if (arduinoCli_ && arduinoCli_->isRunning()) {
@@ -2749,7 +2847,7 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   });
   portsAutoRefreshTimer_->start();
 
-  startPortWatcher();
+  portWatcher_->start();
 
   // Initial refresh of boards and ports
   QTimer::singleShot(500, this, [this] {
@@ -2795,11 +2893,16 @@ MainWindow::~MainWindow() {
   }
   clearPendingUploadFlow();
   stopRefreshProcesses();
-  stopPortWatcher();
+  if (portWatcher_) {
+    portWatcher_->stop();
+  }
   stopLanguageServer();
   if (serialPort_) {
     serialPort_->closePort();
   }
+  if (buildCacheThread_) {
+    buildCacheThread_->wait();
+  }
 }
 
 void MainWindow::openPaths(const QStringList& paths) {
@@ -2986,6 +3089,10 @@ void MainWindow::createActions() {
 
   actionExportCompiledBinary_ = new QAction(tr("Export Compiled Binary"), this);
 
+  actionCleanBuild_ = new QAction(tr("Clean Build Folder"), this);
+  actionCleanBuild_->setToolTip(
+      tr("Delete cached build output for the current sketch and board"));
+
   actionOptimizeForDebug_ = new QAction(tr("Optimize for Debugging"), this);
   actionOptimizeForDebug_->setCheckable(true);
   {
@@ -3216,6 +3323,7 @@ void MainWindow::createMenus() {
   sketchMenu->addAction(actionUploadUsingProgrammer_);
   sketchMenu->addAction(actionExportCompiledBinary_);
   sketchMenu->addAction(actionOptimizeForDebug_);
+  sketchMenu->addAction(actionCleanBuild_);
   sketchMenu->addSeparator();
   sketchMenu->addAction(actionShowSketchFolder_);
   sketchMenu->addSeparator();
@@ -3795,6 +3903,10 @@ void MainWindow::createMenus() {
     exportCompiledBinary();
   });
 
+  connect(actionCleanBuild_, &QAction::triggered, this, [this] {
+    cleanCurrentBuild();
+  });
+
   connect(actionOptimizeForDebug_, &QAction::toggled, this, [this](bool enabled) {
     QSettings settings;
     settings.beginGroup(kSettingsGroup);
@@ -4057,11 +4169,13 @@ void MainWindow::createLayout() {
             }
             settings.endGroup();
             storeFqbnForCurrentSketch(fqbn);
+            rememberRecentBoard(fqbn);
 
             updateBoardPortIndicator();
             scheduleRefreshBoardOptions();
             updateUploadActionStates();
             scheduleRestartLanguageServer();
+            updateWorkspaceFileRoots();
           });
 
   // Connect port combo selection changes
@@ -4080,6 +4194,12 @@ void MainWindow::createLayout() {
 
 	    maybeAutoSelectBoardForCurrentPort();
 	    updateBoardPortIndicator();
+	    if (serialMonitor_) {
+	      serialMonitor_->setCurrentPort(port);
+	    }
+	    if (serialPlotter_) {
+	      serialPlotter_->setCurrentPort(port);
+	    }
 	  });
 
   buildToolBar_->addWidget(boardSelectorContainer);
@@ -4355,6 +4475,7 @@ void MainWindow::createLayout() {
   boardsManagerDock_->setObjectName("BoardsManagerDock");
   boardsManagerDock_->setFeatures(QDockWidget::DockWidgetClosable | QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);
   boardsManager_ = new BoardsManagerDialog(arduinoCli_, output_, boardsManagerDock_);
+  boardsManager_->setPlatformCatalog(platformCatalog_);
   boardsManagerDock_->setWidget(boardsManager_);
   addDockWidget(Qt::LeftDockWidgetArea, boardsManagerDock_);
   tabifyDockWidget(fileDock_, boardsManagerDock_);
@@ -4515,15 +4636,57 @@ void MainWindow::createLayout() {
 }
 
 void MainWindow::wireSignals() {
+  // Only a menu still waiting for the first scan is rebuilt while open.
+  connect(examplesIndex_, &ExamplesIndex::examplesChanged, this, [this] {
+    if (examplesMenu_ && examplesMenu_->isVisible() && examplesMenuRevision_ == 0) {
+      rebuildExamplesMenu();
+    }
+  });
+  examplesIndex_->refresh();
+  updateWorkspaceFileRoots();
+
+  if (platformCatalog_) {
+    // Installed versions may have changed, which makes cached board
+    // details for those platforms stale.
+    connect(platformCatalog_, &PlatformCatalogService::catalogChanged, this, [this] {
+      refreshInstalledBoards();
+      scheduleRefreshBoardOptions();
+      prefetchBoardDetails();
+      examplesIndex_->refresh();
+      updateWorkspaceFileRoots();
+      workspaceFiles_->refresh();
+    });
+    connect(platformCatalog_, &PlatformCatalogService::loadFailed, this,
+            [this](const QString& error) {
+              if (output_) {
+                output_->appendLine(tr("[Boards] Platform catalog unavailable: %1").arg(error));
+              }
+              refreshInstalledBoards();
+              prefetchBoardDetails();
+            });
+  }
+  if (boardDetailsCache_) {
+    connect(boardDetailsCache_, &BoardDetailsCache::detailsReady, this,
+            [this](const QString& baseFqbn) {
+              if (BoardDetailsCache::baseFqbn(currentFqbn()) == baseFqbn) {
+                refreshBoardOptions();
+              }
+            });
+  }
   if (boardsManager_) {
-    connect(boardsManager_, &BoardsManagerDialog::platformsChanged, this,
-            [this] { refreshInstalledBoards(); });
+    connect(boardsManager_, &BoardsManagerDialog::platformsChanged, this, [this] {
+      invalidateBoardDetails();
+      refreshInstalledBoards();
+    });
     connect(boardsManager_, &BoardsManagerDialog::busyChanged, this,
             [this](bool) { updateStopActionState(); });
   }
   if (libraryManager_) {
-    connect(libraryManager_, &LibraryManagerDialog::librariesChanged, this,
-            [this] { clearIncludeLibraryMenuActions(); });
+    connect(libraryManager_, &LibraryManagerDialog::librariesChanged, this, [this] {
+      clearIncludeLibraryMenuActions();
+      examplesIndex_->refresh();
+      workspaceFiles_->refresh();
+    });
     connect(libraryManager_, &LibraryManagerDialog::includeLibraryRequested, this,
             &MainWindow::insertLibraryIncludes);
     connect(libraryManager_, &LibraryManagerDialog::openLibraryExamplesRequested, this,
@@ -4651,6 +4814,15 @@ void MainWindow::wireSignals() {
                 problems_->setDiagnostics(QStringLiteral("LSP"), normalized, lspProblems);
               }
             });
+
+    connect(lsp_, &LspClient::documentResyncRequested, this,
+            [this](const QString& uri) {
+              const QString filePath = pathFromUriOrPath(uri);
+              if (!editor_ || filePath.trimmed().isEmpty()) {
+                return;
+              }
+              lsp_->didChange(uri, editor_->textForFile(filePath));
+            });
   }
 
   debugDock_ = new QDockWidget(tr("Debug"), this);
@@ -4779,6 +4951,92 @@ void MainWindow::wireSignals() {
     v->addLayout(cmdRow);
 
     debugDock_->setWidget(page);
+
+    connect(debugStartButton_, &QPushButton::clicked, this, [this] { startDebugging(); });
+    connect(debugStopButton_, &QPushButton::clicked, this, [this] { stopDebugging(); });
+    connect(debugClearButton_, &QPushButton::clicked, debugConsole_, &QPlainTextEdit::clear);
+    connect(debugContinueButton_, &QPushButton::clicked, this, [this] { debugContinue(); });
+    connect(debugInterruptButton_, &QPushButton::clicked, this, [this] {
+      if (debugSession_) {
+        debugSession_->execInterrupt();
+      }
+    });
+    connect(debugNextButton_, &QPushButton::clicked, this, [this] { debugStepOver(); });
+    connect(debugStepButton_, &QPushButton::clicked, this, [this] { debugStepInto(); });
+    connect(debugFinishButton_, &QPushButton::clicked, this, [this] { debugStepOut(); });
+    connect(debugSyncBreakpointsButton_, &QPushButton::clicked, this,
+            [this] { applyDebugBreakpoints(); });
+    connect(debugCallStackTree_, &QTreeWidget::currentItemChanged, this,
+            [this](QTreeWidgetItem* current) {
+              if (current) {
+                selectDebugFrame(current->data(0, Qt::UserRole).toInt(), true);
+              }
+            });
+    connect(debugBreakpointsTree_, &QTreeWidget::itemActivated, this,
+            [this](QTreeWidgetItem* item) {
+              const QString file = item->data(0, Qt::UserRole).toString();
+              if (editor_ && !file.isEmpty()) {
+                editor_->openLocation(file, item->data(1, Qt::UserRole).toInt(), 1);
+              }
+            });
+    connect(debugLocalsTree_, &QTreeWidget::itemExpanded, this,
+            [this](QTreeWidgetItem* item) { onDebugVariableExpanded(item); });
+    connect(debugWatchesTree_, &QTreeWidget::itemExpanded, this,
+            [this](QTreeWidgetItem* item) { onDebugVariableExpanded(item); });
+
+    {
+      QSettings settings;
+      debugWatchExpressions_ = settings.value(kDebugWatchesKey).toStringList();
+    }
+    const auto watchesEdited = [this] {
+      QSettings settings;
+      settings.setValue(kDebugWatchesKey, debugWatchExpressions_);
+      if (debugSession_ && debugSession_->isActive()) {
+        debugSession_->setWatches(debugWatchExpressions_);
+      }
+      rebuildDebugWatchesTree();
+    };
+    const auto addWatch = [this, watchesEdited] {
+      const QString expression = debugWatchEdit_->text().trimmed();
+      if (expression.isEmpty() || debugWatchExpressions_.contains(expression)) {
+        return;
+      }
+      debugWatchExpressions_.append(expression);
+      debugWatchEdit_->clear();
+      watchesEdited();
+    };
+    connect(debugWatchAddButton_, &QPushButton::clicked, this, addWatch);
+    connect(debugWatchEdit_, &QLineEdit::returnPressed, this, addWatch);
+    connect(debugWatchRemoveButton_, &QPushButton::clicked, this, [this, watchesEdited] {
+      QTreeWidgetItem* item = debugWatchesTree_->currentItem();
+      while (item && item->parent()) {
+        item = item->parent();
+      }
+      if (!item) {
+        return;
+      }
+      debugWatchExpressions_.removeAll(item->text(0));
+      watchesEdited();
+    });
+    connect(debugWatchClearButton_, &QPushButton::clicked, this, [this, watchesEdited] {
+      debugWatchExpressions_.clear();
+      watchesEdited();
+    });
+    rebuildDebugWatchesTree();
+
+    const auto sendDebugCommand = [this] {
+      const QString command = debugCommandEdit_->text().trimmed();
+      if (command.isEmpty() || !debugSession_ || !debugSession_->isActive()) {
+        return;
+      }
+      debugConsole_->appendPlainText(QStringLiteral("> ") + command);
+      debugCommandEdit_->clear();
+      debugSession_->sendCommand(command, [this](const MiParser::Record& r) {
+        debugConsole_->appendPlainText(r.rawText());
+      });
+    };
+    connect(debugSendButton_, &QPushButton::clicked, this, sendDebugCommand);
+    connect(debugCommandEdit_, &QLineEdit::returnPressed, this, sendDebugCommand);
   }
   addDockWidget(Qt::BottomDockWidgetArea, debugDock_);
   tabifyDockWidget(outputDock_, debugDock_);
@@ -4803,6 +5061,38 @@ void MainWindow::wireSignals() {
   tabifyDockWidget(outputDock_, serialPlotterDock_);
   serialPlotterDock_->hide();
 
+  // SerialPort reads on its own thread and delivers coalesced chunks here.
+  connect(serialPort_, &SerialPort::dataReceived, serialMonitor_,
+          &SerialMonitorWidget::appendData);
+  connect(serialPort_, &SerialPort::dataReceived, serialPlotter_,
+          &SerialPlotterWidget::appendData);
+  connect(serialPort_, &SerialPort::droppedBytesChanged, serialMonitor_,
+          &SerialMonitorWidget::setDroppedBytes);
+  connect(serialPort_, &SerialPort::openedChanged, this, [this](bool opened) {
+    serialMonitor_->setConnected(opened);
+    serialPlotter_->setConnected(opened);
+    if (opened) {
+      serialMonitor_->setDroppedBytes(0);
+    }
+  });
+  connect(serialPort_, &SerialPort::errorOccurred, this, [this](const QString& message) {
+    serialMonitor_->showError(message);
+    serialPlotter_->showError(message);
+  });
+  auto openSerialPort = [this](const QString& port, int baudRate) {
+    serialPort_->openPort(port, baudRate);
+  };
+  connect(serialMonitor_, &SerialMonitorWidget::connectRequested, this, openSerialPort);
+  connect(serialPlotter_, &SerialPlotterWidget::connectRequested, this, openSerialPort);
+  connect(serialMonitor_, &SerialMonitorWidget::disconnectRequested, serialPort_,
+          &SerialPort::closePort);
+  connect(serialPlotter_, &SerialPlotterWidget::disconnectRequested, serialPort_,
+          &SerialPort::closePort);
+  connect(serialMonitor_, &SerialMonitorWidget::writeRequested, this,
+          [this](const QByteArray& data) { serialPort_->writeBytes(data); });
+  serialMonitor_->setCurrentPort(currentPort());
+  serialPlotter_->setCurrentPort(currentPort());
+
   connect(arduinoCli_, &ArduinoCli::outputReceived, this,
           [this](const QString& text) {
             processOutputChunk(text);
@@ -4810,13 +5100,16 @@ void MainWindow::wireSignals() {
               return;
             }
             cliOutputCapture_.append(text);
-            constexpr int kMaxChars = 512 * 1024;
-            if (cliOutputCapture_.size() > kMaxChars) {
-              cliOutputCapture_.remove(0, cliOutputCapture_.size() - kMaxChars);
+            // Trimmed in large steps so a long build does not move the
+            // whole capture for every chunk; cut to size when read.
+            if (cliOutputCapture_.size() > 2 * kMaxCliOutputCaptureChars) {
+              cliOutputCapture_.remove(
+                  0, cliOutputCapture_.size() - kMaxCliOutputCaptureChars);
             }
           });
   connect(arduinoCli_, &ArduinoCli::started, this, [this] {
     cliCancelRequested_ = false;
+    cliOutputVerboseKnown_ = false;
     capturingCliOutput_ = true;
     cliOutputCapture_.clear();
     beginCliProgress(lastCliJobKind_);
@@ -4888,10 +5181,19 @@ void MainWindow::wireSignals() {
             cliCancelRequested_ = false;
             const bool uploadCancelled = pendingUploadCancelled_;
             pendingUploadCancelled_ = false;
-            const QString output = cliOutputCapture_;
+            const QString output = cliOutputCapture_.right(kMaxCliOutputCaptureChars);
             cliOutputCapture_.clear();
             const CliJobKind job = lastCliJobKind_;
             lastCliJobKind_ = CliJobKind::None;
+            cliOutputVerboseKnown_ = false;
+            if (job == CliJobKind::Compile) {
+              // Recorded and kept by the cache pass this queues, if it
+              // succeeded; uploads hold theirs until the flow is cleared.
+              releaseHeldBuild();
+            }
+            if (output_) {
+              output_->flushPending();
+            }
 
             auto maybeRefreshPorts = [this] {
               if (!portsRefreshQueued_) {
@@ -4901,7 +5203,11 @@ void MainWindow::wireSignals() {
                 return;
               }
               portsRefreshQueued_ = false;
-              refreshConnectedPorts();
+              if (portWatcher_ && portWatcher_->isRunning()) {
+                rebuildPortCombo();
+              } else {
+                refreshConnectedPorts();
+              }
             };
 
 	            if (job == CliJobKind::UploadCompile) {
@@ -4918,7 +5224,8 @@ void MainWindow::wireSignals() {
 	              if (exitCode == 0) {
                   rememberSuccessfulCompileArtifact(
                       pendingUploadFlow_.sketchFolder, pendingUploadFlow_.fqbn,
-                      pendingUploadFlow_.buildPath);
+                      pendingUploadFlow_.buildPath,
+                      pendingUploadFlow_.signatureRevision);
                   finishCliProgress(true, false);
 	                output_->appendHtml(QString("<span style=\"color:#388e3c;\"><b>%1</b></span>")
 	                                        .arg(tr("Compile finished. Uploading\u2026")));
@@ -4972,12 +5279,10 @@ void MainWindow::wireSignals() {
 	            } else {
 		              if (exitCode == 0) {
 			                if (job == CliJobKind::Compile) {
-                      const QString buildPath =
-                          QStandardPaths::writableLocation(
-                              QStandardPaths::TempLocation) +
-                          "/rewritto/build";
                       rememberSuccessfulCompileArtifact(
-                          currentSketchFolderPath(), currentFqbn(), buildPath);
+                          compileBuildFlow_.sketchFolder, compileBuildFlow_.fqbn,
+                          compileBuildFlow_.buildPath,
+                          compileBuildFlow_.signatureRevision);
 			                }
                     finishCliProgress(true, false);
 			                output_->appendHtml(QString("<span style=\"color:#388e3c;\"><b>%1</b></span>")
@@ -5114,13 +5419,39 @@ void MainWindow::wireSignals() {
             }
           });
 
+  // Upload-without-compile compares content signatures; saves from the
+  // editor are applied without waiting for the file watcher.
+  sketchSignature_ = new SketchSignatureTracker(this);
+  connect(sketchSignature_, &SketchSignatureTracker::signatureChanged, this, [this] {
+    // A compile that finished before the first scan gets its signature now,
+    // unless a file changed after the compile started: then it stays empty
+    // and upload recompiles.
+    if (lastSuccessfulCompile_.sketchSignature.isEmpty() &&
+        !lastSuccessfulCompile_.sketchFolder.isEmpty() &&
+        sketchSignature_->revision() ==
+            lastSuccessfulCompile_.signatureRevision) {
+      lastSuccessfulCompile_.sketchSignature =
+          computeSketchSignature(lastSuccessfulCompile_.sketchFolder);
+    }
+    updateUploadActionStates();
+  });
+  connect(editor_, &EditorWidget::documentSaved, this, [this](const QString& path) {
+    sketchSignature_->markChanged(path);
+    updateUploadActionStates();
+  });
+
   connect(editor_, &EditorWidget::documentChanged, this,
-          [this](const QString& path, const QString& text) {
-            markSketchAsChanged(path);
+          [this](const QString& path) {
             updateUploadActionStates();
             scheduleOutlineRefresh();
+          });
+
+  connect(editor_, &EditorWidget::documentContentsChanged, this,
+          [this](const QString& path, int position, int charsRemoved,
+                 const QString& insertedText) {
             if (lsp_ && lsp_->isReady() && !path.trimmed().isEmpty()) {
-              lsp_->didChange(toFileUri(path), text);
+              lsp_->didChangeContents(toFileUri(path), position, charsRemoved,
+                                      insertedText);
             }
           });
 
@@ -5144,9 +5475,26 @@ void MainWindow::wireSignals() {
 
   connect(editor_, &EditorWidget::breakpointsChanged, this,
           [this](const QString& path, const QVector<int>& lines) {
-    Q_UNUSED(path);
-    Q_UNUSED(lines);
-    // Breakpoints changed - sync with debugger if needed
+    const QString file = QFileInfo(path).absoluteFilePath();
+    QMap<int, BreakpointSpec> previous = breakpointsByFile_.take(file);
+    QMap<int, BreakpointSpec> next;
+    for (const int line : lines) {
+      next.insert(line, previous.take(line));
+    }
+    // Whatever is left was removed in the editor.
+    for (const BreakpointSpec& spec : std::as_const(previous)) {
+      if (spec.gdbId >= 0) {
+        breakpointById_.remove(spec.gdbId);
+        if (debugSession_ && debugSession_->isActive()) {
+          debugSession_->deleteBreakpoint(spec.gdbId);
+        }
+      }
+    }
+    if (!next.isEmpty()) {
+      breakpointsByFile_.insert(file, next);
+    }
+    rebuildDebugBreakpointsTree();
+    applyDebugBreakpoints();
   });
 
   scheduleRestartLanguageServer();
@@ -5154,86 +5502,40 @@ void MainWindow::wireSignals() {
 }
 
 void MainWindow::processOutputChunk(const QString& chunk) {
-    cliOutputBuffer_.append(chunk);
-    
+  // The preference is read once per job, not once per chunk.
+  if (!cliOutputVerboseKnown_) {
+    const bool upload = lastCliJobKind_ == CliJobKind::Upload ||
+                        lastCliJobKind_ == CliJobKind::UploadUsingProgrammer ||
+                        lastCliJobKind_ == CliJobKind::BurnBootloader;
     QSettings settings;
     settings.beginGroup("Preferences");
-    bool verbose = false;
-    if (lastCliJobKind_ == CliJobKind::Upload || lastCliJobKind_ == CliJobKind::UploadUsingProgrammer || lastCliJobKind_ == CliJobKind::BurnBootloader) {
-        verbose = settings.value("verboseUpload", false).toBool();
-    } else {
-        verbose = settings.value("verboseCompile", false).toBool();
-    }
+    cliOutputVerbose_ =
+        settings.value(upload ? "verboseUpload" : "verboseCompile", false).toBool();
     settings.endGroup();
+    cliOutputVerboseKnown_ = true;
+  }
 
-    while (true) {
-        int idx = cliOutputBuffer_.indexOf('\n');
-        if (idx < 0) break;
-        
-        QString line = cliOutputBuffer_.left(idx);
-        cliOutputBuffer_.remove(0, idx + 1);
-        
-        if (line.endsWith('\r')) line.chop(1);
-        
-        bool print = verbose;
-        QString color;
-        bool bold = false;
-        const QString trimmed = line.trimmed();
-        const QString lower = line.toLower();
-
-        updateCliProgressFromOutputLine(line);
-
-        if (lower.contains("error:") || lower.contains("fatal error")) {
-            color = "#d32f2f"; // Red
-            print = true;
-        } else if (lower.contains("warning:")) {
-            color = "#fbc02d"; // Orange
-            print = true;
-        } else if (lower.startsWith("sketch uses") || lower.startsWith("global variables")) {
-            color = "#388e3c"; // Green
-            bold = true;
-            print = true;
-        } else if (line.contains("SUCCESS") || lower.startsWith("uploading...") || line.contains("Writing") || line.contains("Reading")) {
-             print = true;
-             if (line.contains("SUCCESS")) {
-                 color = "#388e3c";
-                 bold = true;
-             }
-        }
+  cliOutputBuffer_.append(chunk);
+  // Lines are viewed in place in one pass; the consumed prefix is dropped
+  // once at the end. Styled lines are queued on the output widget, which
+  // appends them in batches.
+  qsizetype start = 0;
+  for (qsizetype idx = cliOutputBuffer_.indexOf(QLatin1Char('\n')); idx >= 0;
+       idx = cliOutputBuffer_.indexOf(QLatin1Char('\n'), start)) {
+    QStringView line = QStringView(cliOutputBuffer_).mid(start, idx - start);
+    start = idx + 1;
+    if (line.endsWith(QLatin1Char('\r'))) {
+      line.chop(1);
+    }
 
-        if (!verbose) {
-            if (!print) {
-                const bool isUsefulStatus =
-                    lower.startsWith("uploading") ||
-                    lower.startsWith("writing at") ||
-                    lower.startsWith("hash of data verified") ||
-                    lower.startsWith("hard resetting") ||
-                    lower.startsWith("waiting for upload port") ||
-                    lower.startsWith("new upload port") ||
-                    lower.startsWith("error during upload") ||
-                    lower.startsWith("failed uploading") ||
-                    lower.contains("no device found") ||
-                    lower.contains("permission denied") ||
-                    lower.contains("not in sync") ||
-                    lower.contains("timed out") ||
-                    lower.contains("timeout") ||
-                    lower.contains("can not open port") ||
-                    lower.contains("cannot open port");
-                print = isUsefulStatus;
-            }
-        }
+    updateCliProgressFromOutputLine(line);
 
-        if (print && !trimmed.isEmpty()) {
-            QString html = line.toHtmlEscaped();
-            if (!color.isEmpty()) {
-                html = QString("<span style=\"color:%1;\">%2</span>").arg(color, html);
-            }
-            if (bold) {
-                html = QString("<b>%1</b>").arg(html);
-            }
-            if (output_) output_->appendHtml(html);
-        }
+    const CliLineStyle style = classifyCliOutputLine(line, cliOutputVerbose_);
+    if (style.print && output_) {
+      output_->appendStyledLine(line.toString(), style.color, style.bold);
     }
+  }
+  cliOutputBuffer_.remove(0, start);
 }
 
 void MainWindow::loadFavorites() {
@@ -5359,50 +5661,47 @@ void MainWindow::rebuildRecentSketchesMenu() {
 }
 
 void MainWindow::rebuildExamplesMenu() {
-  if (!examplesMenu_) return;
-  examplesMenu_->clear();
+  if (!examplesMenu_ || !examplesIndex_) return;
 
-  ExamplesScanner::Options opts = ExamplesScanner::defaultOptions();
-  opts.currentFqbn = currentFqbn();
-  QVector<ExampleSketch> sketches = ExamplesScanner::scan(opts);
+  // Re-checks the index in the background on every open; changes show up
+  // the next time the menu opens (or now, if the first scan is pending).
+  examplesIndex_->refresh();
 
-  if (sketches.isEmpty()) {
-    examplesMenu_->addAction(tr("(No examples found)"))->setEnabled(false);
+  const std::shared_ptr<const QVector<ExampleSketch>> examples = examplesIndex_->examples();
+  const QString fqbn = currentFqbn();
+  if (examples && examplesMenuRevision_ == examplesIndex_->revision() &&
+      examplesMenuFqbn_ == fqbn) {
     return;
   }
 
-  QString lastCategory;
-  QMap<QString, QMenu*> menuCache;
-
-  for (const auto& s : sketches) {
-    if (s.menuPath.isEmpty()) continue;
-
-    QString category = s.menuPath.first();
-    if (category != lastCategory) {
-      if (!lastCategory.isEmpty()) {
-        examplesMenu_->addSeparator();
-      }
-      lastCategory = category;
-    }
-
-    QMenu* parent = examplesMenu_;
-    QString currentPath;
-    for (int i = 0; i < s.menuPath.size() - 1; ++i) {
-      QString segment = s.menuPath.at(i);
-      currentPath += (currentPath.isEmpty() ? "" : ":::") + segment;
-      if (!menuCache.contains(currentPath)) {
-        QMenu* sub = parent->addMenu(segment);
-        menuCache[currentPath] = sub;
-      }
-      parent = menuCache[currentPath];
-    }
-
-    QString title = s.menuPath.last();
-    QAction* a = parent->addAction(title);
-    connect(a, &QAction::triggered, this, [this, s] {
-      (void)openSketchFolderInUi(QFileInfo(s.inoPath).absolutePath());
-    });
+  for (QMenu* sub : examplesMenu_->findChildren<QMenu*>(Qt::FindDirectChildrenOnly)) {
+    sub->deleteLater();
+  }
+  examplesMenu_->clear();
+  examplesMenuRevision_ = 0;
+  if (!examples) {
+    examplesMenu_->addAction(tr("Scanning examples…"))->setEnabled(false);
+    return;
+  }
+  examplesMenuRevision_ = examplesIndex_->revision();
+  examplesMenuFqbn_ = fqbn;
+  if (examples->isEmpty()) {
+    examplesMenu_->addAction(tr("(No examples found)"))->setEnabled(false);
+    return;
   }
+
+  QVector<ExampleSketch> sorted = *examples;
+  ExamplesScanner::sortForBoard(&sorted, fqbn);
+  const std::shared_ptr<const ExampleMenuNode> tree = buildExampleMenuTree(sorted);
+  QPointer<MainWindow> self(this);
+  populateExampleMenu(
+      examplesMenu_, tree.get(), tree,
+      [self](const QString& folder) {
+        if (self) {
+          (void)self->openSketchFolderInUi(folder);
+        }
+      },
+      true);
 }
 
 QStringList MainWindow::recentSketches() const {
@@ -5465,6 +5764,31 @@ void MainWindow::restoreStateFromSettings() {
 void MainWindow::refreshInstalledBoards() {
   if (!arduinoCli_ || arduinoCli_->isRunning() || !boardCombo_) return;
 
+  // The catalog's refresh picks up installs and index updates in the
+  // background and calls back here through catalogChanged when anything
+  // differs. Until its first load lands (or if it cannot load) the CLI is
+  // asked instead.
+  if (platformCatalog_) {
+    const std::shared_ptr<const PlatformCatalog> catalog = platformCatalog_->catalog();
+    const bool failed = !catalog && !platformCatalog_->errorString().isEmpty();
+    platformCatalog_->refresh();
+    if (catalog) {
+      QMap<QString, QString> uniqueBoards;  // name -> fqbn
+      for (int id = 0; id < catalog->platformCount(); ++id) {
+        for (const PlatformCatalog::Board& board : catalog->platform(id).boards) {
+          if (!uniqueBoards.contains(board.name)) {
+            uniqueBoards.insert(board.name, board.fqbn);
+          }
+        }
+      }
+      populateBoardCombo(uniqueBoards);
+      return;
+    }
+    if (!failed) {
+      return;
+    }
+  }
+
   QProcess* p = new QProcess(this);
   connect(p, &QProcess::finished, this, [this, p](int exitCode, QProcess::ExitStatus) {
     if (exitCode == 0) {
@@ -5478,20 +5802,6 @@ void MainWindow::refreshInstalledBoards() {
         arr = doc.array();
       }
 
-      auto* proxy = static_cast<BoardFilterProxyModel*>(boardCombo_->model());
-      auto* sourceModel =
-          proxy ? qobject_cast<QStandardItemModel*>(proxy->sourceModel())
-                : nullptr;
-      if (!sourceModel) {
-        p->deleteLater();
-        return;
-      }
-
-      sourceModel->clear();
-      auto* placeholder = new QStandardItem(tr("Select Board..."));
-      placeholder->setData(QString(), Qt::UserRole);
-      sourceModel->appendRow(placeholder);
-
       QMap<QString, QString> uniqueBoards;  // name -> fqbn
       for (const QJsonValue& v : arr) {
         const QJsonObject obj = v.toObject();
@@ -5501,44 +5811,7 @@ void MainWindow::refreshInstalledBoards() {
           uniqueBoards[name] = fqbn;
         }
       }
-
-      if (uniqueBoards.isEmpty()) {
-        if (output_) {
-          output_->appendLine(
-              tr("Warning: No boards found. Please run Board Setup Wizard or install platforms via Boards Manager."));
-        }
-        maybeRunBoardSetupWizard();
-      }
-
-      for (auto it = uniqueBoards.begin(); it != uniqueBoards.end(); ++it) {
-        auto* item = new QStandardItem(it.key());
-        item->setData(it.value(), Qt::UserRole);
-        item->setData(isFavorite(it.value()), kRoleIsFavorite);
-        sourceModel->appendRow(item);
-      }
-
-      QString savedFqbn = preferredFqbnForSketch(currentSketchFolderPath());
-      if (savedFqbn.isEmpty()) {
-        QSettings settings;
-        settings.beginGroup(kSettingsGroup);
-        savedFqbn = settings.value(kFqbnKey).toString().trimmed();
-        settings.endGroup();
-      }
-
-      if (proxy) {
-        proxy->sort(0, Qt::AscendingOrder);
-      }
-
-      if (!savedFqbn.isEmpty()) {
-        const int index = boardCombo_->findData(savedFqbn);
-        if (index >= 0) {
-          boardCombo_->setCurrentIndex(index);
-        } else if (boardCombo_->count() > 0) {
-          boardCombo_->setCurrentIndex(0);
-        }
-      } else if (boardCombo_->count() > 0) {
-        boardCombo_->setCurrentIndex(0);
-      }
+      populateBoardCombo(uniqueBoards);
     }
     p->deleteLater();
   });
@@ -5548,6 +5821,59 @@ void MainWindow::refreshInstalledBoards() {
   p->start(arduinoCli_->arduinoCliPath(), args);
 }
 
+void MainWindow::populateBoardCombo(const QMap<QString, QString>& uniqueBoards) {
+  auto* proxy = static_cast<BoardFilterProxyModel*>(boardCombo_->model());
+  auto* sourceModel =
+      proxy ? qobject_cast<QStandardItemModel*>(proxy->sourceModel())
+            : nullptr;
+  if (!sourceModel) {
+    return;
+  }
+
+  sourceModel->clear();
+  auto* placeholder = new QStandardItem(tr("Select Board..."));
+  placeholder->setData(QString(), Qt::UserRole);
+  sourceModel->appendRow(placeholder);
+
+  if (uniqueBoards.isEmpty()) {
+    if (output_) {
+      output_->appendLine(
+          tr("Warning: No boards found. Please run Board Setup Wizard or install platforms via Boards Manager."));
+    }
+    maybeRunBoardSetupWizard();
+  }
+
+  for (auto it = uniqueBoards.begin(); it != uniqueBoards.end(); ++it) {
+    auto* item = new QStandardItem(it.key());
+    item->setData(it.value(), Qt::UserRole);
+    item->setData(isFavorite(it.value()), kRoleIsFavorite);
+    sourceModel->appendRow(item);
+  }
+
+  QString savedFqbn = preferredFqbnForSketch(currentSketchFolderPath());
+  if (savedFqbn.isEmpty()) {
+    QSettings settings;
+    settings.beginGroup(kSettingsGroup);
+    savedFqbn = settings.value(kFqbnKey).toString().trimmed();
+    settings.endGroup();
+  }
+
+  if (proxy) {
+    proxy->sort(0, Qt::AscendingOrder);
+  }
+
+  if (!savedFqbn.isEmpty()) {
+    const int index = boardCombo_->findData(savedFqbn);
+    if (index >= 0) {
+      boardCombo_->setCurrentIndex(index);
+    } else if (boardCombo_->count() > 0) {
+      boardCombo_->setCurrentIndex(0);
+    }
+  } else if (boardCombo_->count() > 0) {
+    boardCombo_->setCurrentIndex(0);
+  }
+}
+
 void MainWindow::maybeRunBoardSetupWizard() {
   if (boardSetupWizardShownThisSession_) {
     return;
@@ -5819,6 +6145,7 @@ void MainWindow::runBoardSetupWizard() {
   if (boardsManager_) {
     boardsManager_->refresh();
   }
+  invalidateBoardDetails();
   refreshInstalledBoards();
   refreshConnectedPorts();
 }
@@ -5833,120 +6160,19 @@ void MainWindow::refreshConnectedPorts() {
   QProcess* p = new QProcess(this);
   connect(p, &QProcess::finished, this, [this, p](int exitCode, QProcess::ExitStatus) {
     if (exitCode == 0) {
-      const QByteArray data = p->readAllStandardOutput();
-      const QJsonDocument doc = QJsonDocument::fromJson(data);
-      
-      QJsonArray arr;
-      if (doc.isObject()) {
-          arr = doc.object().value("detected_ports").toArray();
-      } else if (doc.isArray()) {
-          arr = doc.array();
+      bool ok = false;
+      QVector<PortWatcher::Port> ports =
+          PortWatcher::parsePortList(p->readAllStandardOutput(), &ok);
+      // Note: ports can be empty if none were detected, but the output was valid
+      if (ok && portWatcher_) {
+        {
+          const QSignalBlocker blocker(portWatcher_);
+          portWatcher_->setPorts(std::move(ports));
+        }
+        rebuildPortCombo();
       }
-
-      // Note: arr can be empty if no ports detected, but doc was valid
-      if (doc.isObject() || doc.isArray()) {
-        const QString selectedBeforeRefresh = currentPort().trimmed();
-        QSettings settings;
-        settings.beginGroup(kSettingsGroup);
-        const QString savedPort = settings.value(kPortKey).toString().trimmed();
-        settings.endGroup();
-	        const QString preferredPort = !selectedBeforeRefresh.isEmpty()
-	                                           ? selectedBeforeRefresh
-	                                           : savedPort;
-        const QColor portTextColor = palette().color(QPalette::Text);
-        const QColor portDisabledColor =
-            palette().color(QPalette::Disabled, QPalette::Text);
-
-	        const QSignalBlocker blockPortSignals(portCombo_);
-	        portCombo_->clear();
-	        portCombo_->addItem(tr("Select Port..."), QString{});
-        portCombo_->setItemData(0, portDisabledColor, Qt::ForegroundRole);
-	        int preferredIndex = -1;
-        
-		        for (const QJsonValue& v : arr) {
-		          const QJsonObject obj = v.toObject();
-	          const QJsonObject portObj = obj.value("port").toObject();
-	          const QString portAddress = portObj.value("address").toString().trimmed();
-	          const QString protocol = portObj.value("protocol").toString().trimmed();
-	          const QString protocolLabel =
-	              portObj.value("protocol_label").toString().trimmed();
-	          
-	          QString boardName;
-	          QString boardFqbn;
-	          // In 'board list', detected boards are in "boards" array if recognized
-	          const QJsonArray boardsArr = obj.value("boards").toArray();
-	          if (!boardsArr.isEmpty()) {
-	             const QJsonObject boardObj = boardsArr.first().toObject();
-	             boardName = boardObj.value("name").toString().trimmed();
-	             boardFqbn = boardObj.value("fqbn").toString().trimmed();
-	          }
-
-	          if (!portAddress.isEmpty()) {
-	            QString displayText = portAddress;
-	            if (!boardName.isEmpty()) {
-	                displayText += QString(" (%1)").arg(boardName);
-	            } else {
-	              const QString protoDisplay =
-	                  !protocolLabel.isEmpty() ? protocolLabel : protocol;
-	              if (!protoDisplay.isEmpty() &&
-	                  protoDisplay != QStringLiteral("serial")) {
-	                displayText += QString(" (%1)").arg(protoDisplay);
-	              }
-	            }
-		            portCombo_->addItem(displayText, portAddress);
-		            const int addedIndex = portCombo_->count() - 1;
-                portCombo_->setItemData(addedIndex, portTextColor,
-                                        Qt::ForegroundRole);
-		            portCombo_->setItemData(
-		                addedIndex,
-		                protocol.isEmpty() ? QStringLiteral("serial") : protocol,
-		                kPortRoleProtocol);
-	            if (!boardName.isEmpty()) {
-	              portCombo_->setItemData(addedIndex, boardName,
-	                                      kPortRoleDetectedBoardName);
-	            }
-		            if (!boardFqbn.isEmpty()) {
-		              portCombo_->setItemData(addedIndex, boardFqbn,
-		                                      kPortRoleDetectedFqbn);
-		            }
-		            if (!preferredPort.isEmpty() && preferredPort == portAddress) {
-		              preferredIndex = addedIndex;
-		            }
-		          }
-		        }
-
-	        if (preferredIndex < 0 && !preferredPort.isEmpty()) {
-	          const int missingIndex = 1;  // directly under the placeholder
-		          portCombo_->insertItem(missingIndex, tr("%1 (missing)").arg(preferredPort),
-		                                   preferredPort);
-		          portCombo_->setItemData(missingIndex, true, kPortRoleMissing);
-              portCombo_->setItemData(missingIndex, portDisabledColor,
-                                      Qt::ForegroundRole);
-		          if (auto* model = qobject_cast<QStandardItemModel*>(portCombo_->model())) {
-		            if (QStandardItem* item = model->item(missingIndex)) {
-		              item->setEnabled(false);
-		            }
-		          }
-	          preferredIndex = missingIndex;
-	        }
-
-	        portCombo_->setCurrentIndex(preferredIndex >= 0 ? preferredIndex : 0);
-
-          const QString selectedAfterRefresh = currentPort().trimmed();
-          QSettings persistedSettings;
-          persistedSettings.beginGroup(kSettingsGroup);
-          if (selectedAfterRefresh.isEmpty()) {
-            persistedSettings.remove(kPortKey);
-          } else {
-            persistedSettings.setValue(kPortKey, selectedAfterRefresh);
-          }
-          persistedSettings.endGroup();
-
-          maybeAutoSelectBoardForCurrentPort();
-          updateBoardPortIndicator();
-	      }
-	    }
-	    p->deleteLater();
+    }
+    p->deleteLater();
   });
 
   const QStringList args =
@@ -5954,39 +6180,81 @@ void MainWindow::refreshConnectedPorts() {
   p->start(arduinoCli_->arduinoCliPath(), args);
 }
 
-void MainWindow::startPortWatcher() {
-  if (portsWatchProcess_) stopPortWatcher();
-  
-  portsWatchProcess_ = new QProcess(this);
-  connect(portsWatchProcess_, &QProcess::readyReadStandardOutput, this, [this] {
-    if (!portsWatchProcess_) {
-      return;
+void MainWindow::rebuildPortCombo() {
+  if (!portCombo_ || !portWatcher_) {
+    return;
+  }
+  const QString selectedBeforeRefresh = currentPort().trimmed();
+  QSettings settings;
+  settings.beginGroup(kSettingsGroup);
+  const QString savedPort = settings.value(kPortKey).toString().trimmed();
+  settings.endGroup();
+  const QString preferredPort =
+      !selectedBeforeRefresh.isEmpty() ? selectedBeforeRefresh : savedPort;
+  const QColor portTextColor = palette().color(QPalette::Text);
+  const QColor portDisabledColor = palette().color(QPalette::Disabled, QPalette::Text);
+
+  const QSignalBlocker blockPortSignals(portCombo_);
+  portCombo_->clear();
+  portCombo_->addItem(tr("Select Port..."), QString{});
+  portCombo_->setItemData(0, portDisabledColor, Qt::ForegroundRole);
+  int preferredIndex = -1;
+
+  for (const PortWatcher::Port& port : portWatcher_->ports()) {
+    QString displayText = port.address;
+    if (!port.boardName.isEmpty()) {
+      displayText += QString(" (%1)").arg(port.boardName);
+    } else {
+      const QString protoDisplay =
+          !port.protocolLabel.isEmpty() ? port.protocolLabel : port.protocol;
+      if (!protoDisplay.isEmpty() && protoDisplay != QStringLiteral("serial")) {
+        displayText += QString(" (%1)").arg(protoDisplay);
+      }
     }
-    (void)portsWatchProcess_->readAllStandardOutput();
-    if (portsWatchDebounceTimer_) {
-      portsWatchDebounceTimer_->start();
+    portCombo_->addItem(displayText, port.address);
+    const int addedIndex = portCombo_->count() - 1;
+    portCombo_->setItemData(addedIndex, portTextColor, Qt::ForegroundRole);
+    portCombo_->setItemData(addedIndex, port.protocol, kPortRoleProtocol);
+    if (!port.boardName.isEmpty()) {
+      portCombo_->setItemData(addedIndex, port.boardName, kPortRoleDetectedBoardName);
     }
-  });
-  const QStringList args = arduinoCli_
-                               ? arduinoCli_->withGlobalFlags(
-                                     {"board", "list", "--watch", "--format", "json"})
-                               : QStringList{"board", "list", "--watch", "--format", "json"};
-  portsWatchProcess_->start(arduinoCli_ ? arduinoCli_->arduinoCliPath() : QString{}, args);
-}
+    if (!port.boardFqbn.isEmpty()) {
+      portCombo_->setItemData(addedIndex, port.boardFqbn, kPortRoleDetectedFqbn);
+    }
+    if (!preferredPort.isEmpty() && preferredPort == port.address) {
+      preferredIndex = addedIndex;
+    }
+  }
 
-void MainWindow::stopPortWatcher() {
-  if (portsWatchProcess_) {
-    if (portsWatchProcess_->state() != QProcess::NotRunning) {
-      portsWatchProcess_->terminate();
-      if (!portsWatchProcess_->waitForFinished(750)) {
-        portsWatchProcess_->kill();
-        (void)portsWatchProcess_->waitForFinished(750);
+  if (preferredIndex < 0 && !preferredPort.isEmpty()) {
+    const int missingIndex = 1;  // directly under the placeholder
+    portCombo_->insertItem(missingIndex, tr("%1 (missing)").arg(preferredPort), preferredPort);
+    portCombo_->setItemData(missingIndex, true, kPortRoleMissing);
+    portCombo_->setItemData(missingIndex, portDisabledColor, Qt::ForegroundRole);
+    if (auto* model = qobject_cast<QStandardItemModel*>(portCombo_->model())) {
+      if (QStandardItem* item = model->item(missingIndex)) {
+        item->setEnabled(false);
       }
     }
-    portsWatchProcess_->deleteLater();
-    portsWatchProcess_ = nullptr;
+    preferredIndex = missingIndex;
+  }
+
+  portCombo_->setCurrentIndex(preferredIndex >= 0 ? preferredIndex : 0);
+
+  const QString selectedAfterRefresh = currentPort().trimmed();
+  QSettings persistedSettings;
+  persistedSettings.beginGroup(kSettingsGroup);
+  if (selectedAfterRefresh.isEmpty()) {
+    persistedSettings.remove(kPortKey);
+  } else {
+    persistedSettings.setValue(kPortKey, selectedAfterRefresh);
   }
+  persistedSettings.endGroup();
+
+  maybeAutoSelectBoardForCurrentPort();
+  updateBoardPortIndicator();
 }
+
 void MainWindow::rebuildBoardMenu() {
   if (!boardMenu_) {
     return;
@@ -6240,120 +6508,144 @@ void MainWindow::scheduleRefreshBoardOptions() {
 
 void MainWindow::refreshBoardOptions() {
   clearBoardOptionMenus();
-  
+
   const QString fqbn = currentFqbn();
-  if (fqbn.isEmpty() || !arduinoCli_) return;
-  
-  // Extract base FQBN (without options)
-  QString baseFqbn = fqbn;
-  if (baseFqbn.contains(':')) {
-      QStringList parts = baseFqbn.split(':');
-      if (parts.size() > 3) {
-          baseFqbn = parts.mid(0, 3).join(':');
-      }
+  if (fqbn.isEmpty() || !boardDetailsCache_) return;
+
+  // Menus are built straight from the cache. A board that is not cached
+  // yet is fetched in the background and lands here again via detailsReady.
+  const QString baseFqbn = BoardDetailsCache::baseFqbn(fqbn);
+  if (!boardDetailsCache_->contains(baseFqbn)) {
+    boardDetailsCache_->request(baseFqbn);
+    return;
+  }
+  const QJsonArray options = boardDetailsCache_->configOptions(baseFqbn);
+  if (options.isEmpty()) {
+    return;
   }
 
-  QProcess* p = new QProcess(this);
-  connect(p, &QProcess::finished, this, [this, p, baseFqbn](int exitCode, QProcess::ExitStatus) {
-    if (exitCode == 0) {
-      const QByteArray data = p->readAllStandardOutput();
-      const QJsonDocument doc = QJsonDocument::fromJson(data);
-      const QJsonObject root = doc.object();
-      const QJsonArray options = root.value("config_options").toArray();
-
-      if (!options.isEmpty()) {
-          QSettings settings;
-          settings.beginGroup("BoardOptions");
-          settings.beginGroup(baseFqbn);
-          bool settingsChanged = false;
-
-          for (const QJsonValue& optVal : options) {
-              const QJsonObject opt = optVal.toObject();
-              const QString optId = opt.value("option").toString();
-              const QString optLabel = opt.value("option_label").toString();
-              const QJsonArray values = opt.value("values").toArray();
-
-              if (optId.trimmed().isEmpty() || values.isEmpty()) continue;
-
-              QMenu* subMenu = new QMenu(optLabel, toolsMenu_);
-              QAction* subMenuAction = toolsMenu_->insertMenu(programmerMenuAction_, subMenu);
-              boardOptionMenuActions_.append(subMenuAction);
-              auto* valueGroup = new QActionGroup(subMenu);
-              valueGroup->setExclusive(true);
-
-              const QString currentSelectedValue = settings.value(optId).toString();
-              bool foundSelected = false;
-              QString defaultValueId;
-              QString firstValueId;
-
-              for (const QJsonValue& valVal : values) {
-                  const QJsonObject val = valVal.toObject();
-                  const QString valId = val.value("value").toString();
-                  const QString valLabel = val.value("value_label").toString();
-                  const bool isDefault = val.value("selected").toBool();
-                  if (valId.trimmed().isEmpty()) {
-                      continue;
-                  }
-                  if (firstValueId.isEmpty()) {
-                      firstValueId = valId;
-                  }
-                  if (isDefault && defaultValueId.isEmpty()) {
-                      defaultValueId = valId;
-                  }
+  QSettings settings;
+  settings.beginGroup("BoardOptions");
+  settings.beginGroup(baseFqbn);
+  bool settingsChanged = false;
+
+  for (const QJsonValue& optVal : options) {
+    const QJsonObject opt = optVal.toObject();
+    const QString optId = opt.value("option").toString();
+    const QString optLabel = opt.value("option_label").toString();
+    const QJsonArray values = opt.value("values").toArray();
+
+    if (optId.trimmed().isEmpty() || values.isEmpty()) continue;
+
+    QMenu* subMenu = new QMenu(optLabel, toolsMenu_);
+    QAction* subMenuAction = toolsMenu_->insertMenu(programmerMenuAction_, subMenu);
+    boardOptionMenuActions_.append(subMenuAction);
+    auto* valueGroup = new QActionGroup(subMenu);
+    valueGroup->setExclusive(true);
+
+    const QString currentSelectedValue = settings.value(optId).toString();
+    bool foundSelected = false;
+    QString defaultValueId;
+    QString firstValueId;
+
+    for (const QJsonValue& valVal : values) {
+      const QJsonObject val = valVal.toObject();
+      const QString valId = val.value("value").toString();
+      const QString valLabel = val.value("value_label").toString();
+      const bool isDefault = val.value("selected").toBool();
+      if (valId.trimmed().isEmpty()) {
+        continue;
+      }
+      if (firstValueId.isEmpty()) {
+        firstValueId = valId;
+      }
+      if (isDefault && defaultValueId.isEmpty()) {
+        defaultValueId = valId;
+      }
 
-                  QAction* act = subMenu->addAction(valLabel);
-                  act->setCheckable(true);
-                  act->setData(valId);
-                  valueGroup->addAction(act);
-                  
-                  bool isChecked = false;
-                  if (!currentSelectedValue.isEmpty()) {
-                      isChecked = (valId == currentSelectedValue);
-                  } else {
-                      isChecked = isDefault;
-                  }
-                  act->setChecked(isChecked);
-                  if (isChecked) foundSelected = true;
+      QAction* act = subMenu->addAction(valLabel);
+      act->setCheckable(true);
+      act->setData(valId);
+      valueGroup->addAction(act);
 
-                  connect(act, &QAction::triggered, this, [this, optId, valId] {
-                      setBoardOption(optId, valId);
-                  });
-              }
-              
-              // If nothing was checked by settings or defaults, check first
-              if (!foundSelected) {
-                  QString fallbackValue = defaultValueId;
-                  if (fallbackValue.isEmpty()) {
-                      fallbackValue = firstValueId;
-                  }
-                  if (!fallbackValue.isEmpty()) {
-                      settings.setValue(optId, fallbackValue);
-                      settingsChanged = true;
-                      const QList<QAction*> actions = subMenu->actions();
-                      for (QAction* action : actions) {
-                          if (!action) continue;
-                          if (action->isChecked()) {
-                              action->setChecked(false);
-                          }
-                          if (action->data().toString() == fallbackValue) {
-                              action->setChecked(true);
-                          }
-                      }
-                  }
-              }
+      bool isChecked = false;
+      if (!currentSelectedValue.isEmpty()) {
+        isChecked = (valId == currentSelectedValue);
+      } else {
+        isChecked = isDefault;
+      }
+      act->setChecked(isChecked);
+      if (isChecked) foundSelected = true;
+
+      connect(act, &QAction::triggered, this, [this, optId, valId] {
+        setBoardOption(optId, valId);
+      });
+    }
+
+    // If nothing was checked by settings or defaults, check first
+    if (!foundSelected) {
+      QString fallbackValue = defaultValueId;
+      if (fallbackValue.isEmpty()) {
+        fallbackValue = firstValueId;
+      }
+      if (!fallbackValue.isEmpty()) {
+        settings.setValue(optId, fallbackValue);
+        settingsChanged = true;
+        const QList<QAction*> actions = subMenu->actions();
+        for (QAction* action : actions) {
+          if (!action) continue;
+          if (action->isChecked()) {
+            action->setChecked(false);
           }
-          settings.endGroup();
-          settings.endGroup();
-          if (settingsChanged) {
-              updateBoardPortIndicator();
+          if (action->data().toString() == fallbackValue) {
+            action->setChecked(true);
           }
+        }
       }
     }
-    p->deleteLater();
-  });
-  const QStringList args = arduinoCli_->withGlobalFlags(
-      {"board", "details", "--fqbn", baseFqbn, "--format", "json"});
-  p->start(arduinoCli_->arduinoCliPath(), args);
+  }
+  settings.endGroup();
+  settings.endGroup();
+  if (settingsChanged) {
+    updateBoardPortIndicator();
+  }
+}
+
+void MainWindow::prefetchBoardDetails() {
+  if (!boardDetailsCache_) {
+    return;
+  }
+  QSettings settings;
+  settings.beginGroup(kSettingsGroup);
+  QStringList fqbns = settings.value(kRecentBoardsKey).toStringList();
+  settings.endGroup();
+  fqbns += QStringList(favoriteFqbns_.begin(), favoriteFqbns_.end());
+  boardDetailsCache_->prefetch(fqbns);
+}
+
+void MainWindow::invalidateBoardDetails() {
+  if (!boardDetailsCache_) {
+    return;
+  }
+  boardDetailsCache_->invalidate();
+  scheduleRefreshBoardOptions();
+}
+
+void MainWindow::rememberRecentBoard(const QString& fqbn) {
+  const QString base = BoardDetailsCache::baseFqbn(fqbn);
+  if (base.isEmpty()) {
+    return;
+  }
+  QSettings settings;
+  settings.beginGroup(kSettingsGroup);
+  QStringList recent = settings.value(kRecentBoardsKey).toStringList();
+  recent.removeAll(base);
+  recent.prepend(base);
+  while (recent.size() > kMaxRecentBoards) {
+    recent.removeLast();
+  }
+  settings.setValue(kRecentBoardsKey, recent);
+  settings.endGroup();
 }
 
 void MainWindow::setBoardOption(const QString& optionId, const QString& valueId) {
@@ -6721,6 +7013,10 @@ void MainWindow::insertLibraryIncludes(const QString& libraryName,
 }
 
 void MainWindow::clearPendingUploadFlow() {
+  if (!pendingUploadFlow_.buildPath.isEmpty() &&
+      pendingUploadFlow_.buildPath == heldBuildPath_) {
+    releaseHeldBuild();
+  }
   pendingUploadFlow_ = PendingUploadFlow{};
   if (uploadBuildDir_) {
     uploadBuildDir_->remove();
@@ -6797,7 +7093,8 @@ void MainWindow::updateUploadActionStates() {
 
 void MainWindow::rememberSuccessfulCompileArtifact(const QString& sketchFolder,
                                                    const QString& fqbn,
-                                                   const QString& buildPath) {
+                                                   const QString& buildPath,
+                                                   quint64 signatureRevision) {
   const QString normalizedSketch = normalizeSketchFolderPath(sketchFolder);
   const QString normalizedFqbn = fqbn.trimmed();
   const QString normalizedBuildPath = buildPath.trimmed();
@@ -6809,72 +7106,154 @@ void MainWindow::rememberSuccessfulCompileArtifact(const QString& sketchFolder,
   lastSuccessfulCompile_.sketchFolder = normalizedSketch;
   lastSuccessfulCompile_.fqbn = normalizedFqbn;
   lastSuccessfulCompile_.buildPath = QDir(normalizedBuildPath).absolutePath();
-  lastSuccessfulCompile_.sketchSignature =
-      computeSketchSignature(normalizedSketch);
-  lastSuccessfulCompile_.sketchChangedSinceCompile =
-      lastSuccessfulCompile_.sketchSignature.isEmpty();
+  // Empty while the sketch is still being scanned (filled in on
+  // signatureChanged), and when a file changed during the compile.
+  lastSuccessfulCompile_.signatureRevision = signatureRevision;
+  lastSuccessfulCompile_.sketchSignature.clear();
+  if (sketchSignature_ && sketchSignature_->revision() == signatureRevision) {
+    lastSuccessfulCompile_.sketchSignature =
+        computeSketchSignature(normalizedSketch);
+  }
+
+  updateBuildCache(lastSuccessfulCompile_.buildPath);
 }
 
-void MainWindow::markSketchAsChanged(const QString& filePath) {
-  if (lastSuccessfulCompile_.sketchFolder.trimmed().isEmpty()) {
-    return;
+QString MainWindow::buildPathForSketch(const QString& sketchFolder,
+                                       const QString& fqbn) {
+  BuildDirectoryManager::Key key;
+  key.sketchFolder = normalizeSketchFolderPath(sketchFolder);
+  key.fqbn = fqbn.trimmed();
+  key.optimizeForDebug =
+      actionOptimizeForDebug_ && actionOptimizeForDebug_->isChecked();
+
+  QString error;
+  const QString buildPath = BuildDirectoryManager::acquireBuildPath(key, {}, &error);
+  if (!buildPath.isEmpty()) {
+    // Acquired before releasing, in case it is the same directory.
+    releaseHeldBuild();
+    heldBuildPath_ = buildPath;
+    return buildPath;
   }
-  const QString changed = QFileInfo(filePath).absoluteFilePath().trimmed();
-  if (changed.isEmpty()) {
-    lastSuccessfulCompile_.sketchChangedSinceCompile = true;
-    return;
+
+  // Fall back to the shared scratch directory if the cache root is unusable.
+  if (output_ && !error.isEmpty()) {
+    output_->appendLine(tr("Build cache unavailable: %1").arg(error));
   }
-  const QString sketchRoot =
-      QDir(lastSuccessfulCompile_.sketchFolder).absolutePath();
-  const QString sketchPrefix = sketchRoot + QDir::separator();
-  if (changed == sketchRoot || changed.startsWith(sketchPrefix)) {
-    lastSuccessfulCompile_.sketchChangedSinceCompile = true;
+  QDir buildDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation) +
+                "/rewritto/build");
+  buildDir.mkpath(buildDir.absolutePath());
+  return buildDir.absolutePath();
+}
+
+void MainWindow::releaseHeldBuild() {
+  if (!heldBuildPath_.isEmpty()) {
+    BuildDirectoryManager::releaseBuild(std::exchange(heldBuildPath_, {}));
   }
 }
 
-QString MainWindow::computeSketchSignature(const QString& sketchFolder) const {
-  const QString normalizedSketch = normalizeSketchFolderPath(sketchFolder);
-  if (normalizedSketch.isEmpty()) {
-    return {};
+void MainWindow::updateBuildCache(const QString& finishedBuildPath) {
+  if (!pendingFinishedBuildPaths_.contains(finishedBuildPath)) {
+    pendingFinishedBuildPaths_ << finishedBuildPath;
+  }
+  if (buildCacheThread_) {
+    return;  // Picked up when the running pass finishes.
   }
 
-  QDir root(normalizedSketch);
-  if (!root.exists()) {
-    return {};
+  QSettings settings;
+  settings.beginGroup("Preferences");
+  const qint64 maxMb =
+      settings
+          .value(kPrefBuildCacheMaxMbKey,
+                 BuildDirectoryManager::kDefaultMaxTotalBytes / (1024 * 1024))
+          .toLongLong();
+  settings.endGroup();
+
+  const QStringList finished = std::exchange(pendingFinishedBuildPaths_, {});
+  // Compiles that start while the pass runs are skipped through the
+  // manager's in-use registry (see buildPathForSketch()).
+  QStringList keep = finished;
+  for (const QString& active :
+       {pendingUploadFlow_.buildPath, compileBuildFlow_.buildPath, heldBuildPath_}) {
+    if (!active.trimmed().isEmpty()) {
+      keep << active;
+    }
   }
 
-  QStringList relativePaths;
-  QDirIterator it(normalizedSketch, QDir::Files, QDirIterator::Subdirectories);
-  while (it.hasNext()) {
-    const QString absolute = it.next();
-    const QFileInfo info(absolute);
-    if (!info.exists() || !info.isFile()) {
-      continue;
+  QPointer<MainWindow> self(this);
+  buildCacheThread_ = QThread::create([self, finished, keep, maxMb] {
+    for (const QString& buildPath : finished) {
+      BuildDirectoryManager::recordBuildFinished(buildPath);
     }
-    const QString relative = root.relativeFilePath(absolute);
-    if (relative.startsWith(QStringLiteral("."))) {
-      continue;
+    if (maxMb <= 0) {
+      return;
+    }
+    const int evicted = BuildDirectoryManager::evictToFit(maxMb * 1024 * 1024, {}, keep);
+    if (evicted <= 0 || !self) {
+      return;
+    }
+    QMetaObject::invokeMethod(
+        self.data(), [self, evicted] {
+          if (self && self->output_) {
+            self->output_->appendLine(
+                tr("Removed %n least recently used cached build(s).", nullptr, evicted));
+          }
+        }, Qt::QueuedConnection);
+  });
+  connect(buildCacheThread_, &QThread::finished, this, [this] {
+    buildCacheThread_->deleteLater();
+    buildCacheThread_ = nullptr;
+    if (!pendingFinishedBuildPaths_.isEmpty()) {
+      updateBuildCache(pendingFinishedBuildPaths_.constLast());
     }
-    relativePaths.append(relative);
+  });
+  buildCacheThread_->start();
+}
+
+void MainWindow::cleanCurrentBuild() {
+  const QString sketchFolder = currentSketchFolderPath();
+  const QString fqbn = currentFqbn().trimmed();
+  if (sketchFolder.isEmpty() || fqbn.isEmpty()) {
+    showToast(tr("Open a sketch and select a board first."));
+    return;
+  }
+  if ((arduinoCli_ && arduinoCli_->isRunning()) || buildCacheThread_) {
+    showToast(tr("Wait for the current operation to finish."));
+    return;
   }
 
-  std::sort(relativePaths.begin(), relativePaths.end());
-  QCryptographicHash hasher(QCryptographicHash::Sha256);
-  for (const QString& relative : relativePaths) {
-    const QFileInfo info(root.filePath(relative));
-    if (!info.exists() || !info.isFile()) {
-      continue;
-    }
-    QByteArray data = relative.toUtf8();
-    data.append('\n');
-    data.append(QByteArray::number(info.size()));
-    data.append('\n');
-    data.append(
-        QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
-    data.append('\n');
-    hasher.addData(data);
+  BuildDirectoryManager::Key key;
+  key.sketchFolder = normalizeSketchFolderPath(sketchFolder);
+  key.fqbn = fqbn;
+  key.optimizeForDebug =
+      actionOptimizeForDebug_ && actionOptimizeForDebug_->isChecked();
+  const QString buildPath = BuildDirectoryManager::lookupBuildPath(key);
+
+  QString error;
+  if (!BuildDirectoryManager::cleanBuild(key, {}, &error)) {
+    QMessageBox::warning(this, tr("Clean Build Folder"), error);
+    return;
+  }
+
+  if (!buildPath.isEmpty() &&
+      QDir(lastSuccessfulCompile_.buildPath).absolutePath() ==
+          QDir(buildPath).absolutePath()) {
+    lastSuccessfulCompile_ = {};
+  }
+  updateUploadActionStates();
+  showToast(tr("Build folder cleaned. The next compile will be a full rebuild."));
+}
+
+QString MainWindow::computeSketchSignature(const QString& sketchFolder) const {
+  const QString normalizedSketch = normalizeSketchFolderPath(sketchFolder);
+  if (normalizedSketch.isEmpty() || !sketchSignature_) {
+    return {};
+  }
+  // Never hashes here: empty until the tracker's scan of this sketch is done.
+  if (sketchSignature_->sketchFolder() != QDir::cleanPath(normalizedSketch) ||
+      !sketchSignature_->isReady()) {
+    return {};
   }
-  return QString::fromLatin1(hasher.result().toHex());
+  return sketchSignature_->signature();
 }
 
 bool MainWindow::canUploadWithoutCompile(QString* reason) const {
@@ -6910,10 +7289,16 @@ bool MainWindow::canUploadWithoutCompile(QString* reason) const {
   if (editor_ && editor_->hasUnsavedChanges()) {
     return fail(tr("Unsaved changes detected. Save and verify again."));
   }
-  if (lastSuccessfulCompile_.sketchChangedSinceCompile) {
+  if (!sketchSignature_ ||
+      sketchSignature_->sketchFolder() !=
+          QDir::cleanPath(normalizeSketchFolderPath(sketchFolder))) {
+    // Only the compile path picks a folder to track; never scan here.
     return fail(tr("Sketch changed since last successful verify."));
   }
-  const QString currentSignature = computeSketchSignature(sketchFolder);
+  if (!sketchSignature_->isReady()) {
+    return fail(tr("Checking sketch files..."));
+  }
+  const QString currentSignature = sketchSignature_->signature();
   if (currentSignature.isEmpty() ||
       currentSignature != lastSuccessfulCompile_.sketchSignature) {
     return fail(tr("Sketch files changed since last successful verify."));
@@ -6938,8 +7323,9 @@ void MainWindow::beginCliProgress(CliJobKind job) {
   cliBusy_->show();
 }
 
-void MainWindow::updateCliProgressFromOutputLine(const QString& line) {
-  if (!cliBusy_ || !cliBusyLabel_ || line.trimmed().isEmpty()) {
+void MainWindow::updateCliProgressFromOutputLine(QStringView line) {
+  line = line.trimmed();
+  if (!cliBusy_ || !cliBusyLabel_ || line.isEmpty()) {
     return;
   }
 
@@ -6950,23 +7336,28 @@ void MainWindow::updateCliProgressFromOutputLine(const QString& line) {
 
   const QString base =
       currentCliPhaseText_.isEmpty() ? cliJobLabel(job) : currentCliPhaseText_;
-  const QString lower = line.trimmed().toLower();
+  auto has = [line](QLatin1String needle) {
+    return line.contains(needle, Qt::CaseInsensitive);
+  };
+  auto startsWith = [line](QLatin1String prefix) {
+    return line.startsWith(prefix, Qt::CaseInsensitive);
+  };
   auto setPhase = [this, &base](int value, const QString& phase) {
     setCliProgressValue(value, tr("%1 · %2").arg(base, phase));
   };
 
   if (job == CliJobKind::Compile || job == CliJobKind::UploadCompile) {
-    if (lower.contains("compiling sketch")) {
+    if (has(QLatin1String("compiling sketch"))) {
       setPhase(18, tr("compiling sketch"));
-    } else if (lower.startsWith("compiling ") ||
-               lower.contains("compiling libraries")) {
+    } else if (startsWith(QLatin1String("compiling ")) ||
+               has(QLatin1String("compiling libraries"))) {
       setPhase(38, tr("compiling libraries"));
-    } else if (lower.contains("archiving")) {
+    } else if (has(QLatin1String("archiving"))) {
       setPhase(58, tr("archiving"));
-    } else if (lower.contains("linking")) {
+    } else if (has(QLatin1String("linking"))) {
       setPhase(76, tr("linking"));
-    } else if (lower.startsWith("sketch uses") ||
-               lower.startsWith("global variables")) {
+    } else if (startsWith(QLatin1String("sketch uses")) ||
+               startsWith(QLatin1String("global variables"))) {
       setPhase(92, tr("finalizing"));
     }
     return;
@@ -6974,30 +7365,34 @@ void MainWindow::updateCliProgressFromOutputLine(const QString& line) {
 
   if (job == CliJobKind::Upload || job == CliJobKind::UploadUsingProgrammer ||
       job == CliJobKind::BurnBootloader) {
-    if (lower.startsWith("waiting for upload port")) {
+    if (startsWith(QLatin1String("waiting for upload port"))) {
       setPhase(28, tr("waiting for port"));
       return;
     }
-    if (lower.startsWith("uploading")) {
+    if (startsWith(QLatin1String("uploading"))) {
       setPhase(45, tr("uploading"));
       return;
     }
-    static const QRegularExpression percentPattern(
-        QStringLiteral("(\\d{1,3})%"));
-    const QRegularExpressionMatch match = percentPattern.match(lower);
-    if (match.hasMatch()) {
-      const int rawPercent =
-          qBound(0, match.captured(1).toInt(), 100);
-      const int mapped = 45 + static_cast<int>(rawPercent * 0.5);
-      setPhase(mapped, tr("flashing"));
-      return;
+    // The first "<1-3 digits>%" in the line.
+    for (qsizetype pct = line.indexOf(QLatin1Char('%')); pct >= 0;
+         pct = line.indexOf(QLatin1Char('%'), pct + 1)) {
+      qsizetype from = pct;
+      while (from > 0 && pct - from < 3 && line.at(from - 1).isDigit()) {
+        --from;
+      }
+      if (from < pct) {
+        const int rawPercent = qBound(0, line.mid(from, pct - from).toInt(), 100);
+        const int mapped = 45 + static_cast<int>(rawPercent * 0.5);
+        setPhase(mapped, tr("flashing"));
+        return;
+      }
     }
-    if (lower.contains("hash of data verified") ||
-        lower.contains("verifying")) {
+    if (has(QLatin1String("hash of data verified")) ||
+        has(QLatin1String("verifying"))) {
       setPhase(96, tr("verifying"));
       return;
     }
-    if (lower.contains("hard resetting") || lower.contains("success")) {
+    if (has(QLatin1String("hard resetting")) || has(QLatin1String("success"))) {
       setPhase(100, tr("finalizing"));
     }
   }
@@ -7317,6 +7712,9 @@ bool MainWindow::openSketchFolderInUi(const QString& folder) {
   if (sketchManager_) {
     sketchManager_->openSketchFolder(sketchFolder);
   }
+  if (sketchSignature_) {
+    sketchSignature_->setSketchFolder(sketchFolder);
+  }
 
   if (fileModel_ && fileTree_) {
     fileModel_->setRootPath(sketchFolder);
@@ -7395,6 +7793,7 @@ bool MainWindow::openSketchFolderInUi(const QString& folder) {
   scheduleOutlineRefresh();
   updateUploadActionStates();
   updateWelcomeVisibility();
+  updateWorkspaceFileRoots();
   return true;
 }
 
@@ -7804,105 +8203,125 @@ void MainWindow::showSelectBoardDialog() {
   dialog->setWindowTitle(tr("Select Board"));
   dialog->setMinimumSize(700, 500);
 
-  // Fetch all available boards
-  QProcess* p = new QProcess(this);
-  connect(p, &QProcess::finished, this, [this, dialog, p](int exitCode, QProcess::ExitStatus) {
-    if (!boardSelectorDialogOpen_) {
-      return;
-    }
-
-    if (exitCode == 0) {
-      const QByteArray data = p->readAllStandardOutput();
-      const QJsonDocument doc = QJsonDocument::fromJson(data);
-
-      QVector<BoardSelectorDialog::BoardEntry> boards;
-      QJsonArray arr;
-      if (doc.isObject()) {
-          arr = doc.object().value("boards").toArray();
-      } else if (doc.isArray()) {
-          arr = doc.array();
-      }
-
-      if (!arr.isEmpty()) {
-        // Parse the board list
-        QMap<QString, BoardSelectorDialog::BoardEntry> uniqueBoards;
-
-        for (const QJsonValue& v : arr) {
-          const QJsonObject obj = v.toObject();
-          const QString name = obj.value("name").toString();
-          const QString fqbn = obj.value("fqbn").toString();
+  auto runDialog = [this, dialog](const QVector<BoardSelectorDialog::BoardEntry>& boards) {
+    dialog->setBoards(boards);
+    connect(dialog, &BoardSelectorDialog::favoriteToggled, this, &MainWindow::toggleFavorite);
 
-          // Get the platform name if available
-          QString platform;
-          const QJsonObject platformObj = obj.value("platform").toObject();
-          if (!platformObj.isEmpty()) {
-              platform = platformObj.value("name").toString();
-          }
+    // Set current board if one is selected
+    const QString currentFqbn = this->currentFqbn();
+    if (!currentFqbn.isEmpty()) {
+      dialog->setCurrentFqbn(currentFqbn);
+    }
 
-          if (!name.isEmpty() && !fqbn.isEmpty()) {
-            QString displayName = name;
-            if (!platform.isEmpty()) {
-              displayName = QString("%1 (%2)").arg(name, platform);
+    if (dialog->exec() == QDialog::Accepted) {
+      // If a board was selected, update the combo box and settings
+      const QString selectedFqbn = dialog->selectedFqbn();
+      if (!selectedFqbn.isEmpty() && selectedFqbn != currentFqbn) {
+        // Find the board in the combo and select it
+        const int index = boardCombo_->findData(selectedFqbn);
+        if (index >= 0) {
+          boardCombo_->setCurrentIndex(index);
+        } else {
+          // Add the board to the combo if not present
+          // Need to find the name from the selected FQBN
+          for (const auto& entry : boards) {
+            if (entry.fqbn == selectedFqbn) {
+              boardCombo_->addItem(entry.name, entry.fqbn);
+              boardCombo_->setCurrentIndex(boardCombo_->count() - 1);
+              break;
             }
-            BoardSelectorDialog::BoardEntry entry;
-            entry.name = displayName;
-            entry.fqbn = fqbn;
-            entry.isFavorite = isFavorite(fqbn);
-            uniqueBoards[displayName] = entry;
           }
         }
 
-        boards = uniqueBoards.values();
-      }
-
-      dialog->setBoards(boards);
-      connect(dialog, &BoardSelectorDialog::favoriteToggled, this, &MainWindow::toggleFavorite);
+        // Save to settings
+        QSettings settings;
+        settings.beginGroup(kSettingsGroup);
+        settings.setValue(kFqbnKey, selectedFqbn);
+        settings.endGroup();
+        storeFqbnForCurrentSketch(selectedFqbn);
 
-      // Set current board if one is selected
-      const QString currentFqbn = this->currentFqbn();
-      if (!currentFqbn.isEmpty()) {
-        dialog->setCurrentFqbn(currentFqbn);
+        updateBoardPortIndicator();
+        showToast(tr("Board selected: %1").arg(selectedFqbn));
       }
+    }
 
-      if (dialog->exec() == QDialog::Accepted) {
-        // If a board was selected, update the combo box and settings
-        const QString selectedFqbn = dialog->selectedFqbn();
-        if (!selectedFqbn.isEmpty() && selectedFqbn != currentFqbn) {
-          // Find the board in the combo and select it
-          const int index = boardCombo_->findData(selectedFqbn);
-          if (index >= 0) {
-            boardCombo_->setCurrentIndex(index);
-          } else {
-            // Add the board to the combo if not present
-            // Need to find the name from the selected FQBN
-            for (const auto& entry : boards) {
-              if (entry.fqbn == selectedFqbn) {
-                boardCombo_->addItem(entry.name, entry.fqbn);
-                boardCombo_->setCurrentIndex(boardCombo_->count() - 1);
-                break;
-              }
-            }
-          }
-
-          // Save to settings
-	          QSettings settings;
-	          settings.beginGroup(kSettingsGroup);
-	          settings.setValue(kFqbnKey, selectedFqbn);
-	          settings.endGroup();
-              storeFqbnForCurrentSketch(selectedFqbn);
+    dialog->deleteLater();
+    boardSelectorDialogOpen_ = false;
+  };
 
-	          updateBoardPortIndicator();
-	          showToast(tr("Board selected: %1").arg(selectedFqbn));
+  // Installed boards straight from the shared catalog when it is loaded.
+  if (platformCatalog_) {
+    if (const std::shared_ptr<const PlatformCatalog> catalog = platformCatalog_->catalog()) {
+      QMap<QString, BoardSelectorDialog::BoardEntry> uniqueBoards;
+      for (int id = 0; id < catalog->platformCount(); ++id) {
+        const QString platform = catalog->platformName(id);
+        for (const PlatformCatalog::Board& board : catalog->platform(id).boards) {
+          BoardSelectorDialog::BoardEntry entry;
+          entry.name = QString("%1 (%2)").arg(board.name, platform);
+          entry.fqbn = board.fqbn;
+          entry.isFavorite = isFavorite(board.fqbn);
+          uniqueBoards[entry.name] = entry;
         }
       }
-    } else {
+      runDialog(uniqueBoards.values());
+      return;
+    }
+  }
+
+  // Fetch all available boards
+  QProcess* p = new QProcess(this);
+  connect(p, &QProcess::finished, this,
+          [this, dialog, p, runDialog](int exitCode, QProcess::ExitStatus) {
+    if (!boardSelectorDialogOpen_) {
+      return;
+    }
+
+    p->deleteLater();
+    if (exitCode != 0) {
       QMessageBox::warning(this, tr("Failed to Load Boards"),
                            tr("Could not retrieve board list from Arduino CLI."));
+      dialog->deleteLater();
+      boardSelectorDialogOpen_ = false;
+      return;
     }
 
-    dialog->deleteLater();
-    p->deleteLater();
-    boardSelectorDialogOpen_ = false;
+    const QByteArray data = p->readAllStandardOutput();
+    const QJsonDocument doc = QJsonDocument::fromJson(data);
+
+    QJsonArray arr;
+    if (doc.isObject()) {
+      arr = doc.object().value("boards").toArray();
+    } else if (doc.isArray()) {
+      arr = doc.array();
+    }
+
+    // Parse the board list
+    QMap<QString, BoardSelectorDialog::BoardEntry> uniqueBoards;
+    for (const QJsonValue& v : arr) {
+      const QJsonObject obj = v.toObject();
+      const QString name = obj.value("name").toString();
+      const QString fqbn = obj.value("fqbn").toString();
+
+      // Get the platform name if available
+      QString platform;
+      const QJsonObject platformObj = obj.value("platform").toObject();
+      if (!platformObj.isEmpty()) {
+        platform = platformObj.value("name").toString();
+      }
+
+      if (!name.isEmpty() && !fqbn.isEmpty()) {
+        QString displayName = name;
+        if (!platform.isEmpty()) {
+          displayName = QString("%1 (%2)").arg(name, platform);
+        }
+        BoardSelectorDialog::BoardEntry entry;
+        entry.name = displayName;
+        entry.fqbn = fqbn;
+        entry.isFavorite = isFavorite(fqbn);
+        uniqueBoards[displayName] = entry;
+      }
+    }
+    runDialog(uniqueBoards.values());
   });
 
   connect(p, &QProcess::errorOccurred, this, [this, dialog, p](QProcess::ProcessError) {
@@ -8042,6 +8461,37 @@ void MainWindow::exportProjectZip() {
     return;
   }
 
+  if (sketchSignature_ &&
+      sketchSignature_->sketchFolder() ==
+          QDir::cleanPath(normalizeSketchFolderPath(sketchFolder)) &&
+      !sketchSignature_->isReady()) {
+    // The scan runs on a worker thread; waiting for it beats recompiling.
+    // The export goes on from the first of scan done or timeout.
+    constexpr int kSignatureWaitMs = 30000;
+    statusBar()->showMessage(tr("Checking sketch files..."));
+    auto started = std::make_shared<bool>(false);
+    auto resume = [this, started, sketchFolder, zipPath] {
+      if (*started) {
+        return;
+      }
+      *started = true;
+      statusBar()->clearMessage();
+      writeProjectZip(sketchFolder, zipPath);
+    };
+    connect(sketchSignature_, &SketchSignatureTracker::signatureChanged, this,
+            resume, Qt::SingleShotConnection);
+    QTimer::singleShot(kSignatureWaitMs, this, resume);
+    return;
+  }
+  writeProjectZip(sketchFolder, zipPath);
+}
+
+void MainWindow::writeProjectZip(const QString& sketchFolder,
+                                 const QString& zipPath) {
+  const QString sketchName = QFileInfo(sketchFolder).fileName().trimmed().isEmpty()
+                                 ? QStringLiteral("sketch")
+                                 : QFileInfo(sketchFolder).fileName().trimmed();
+
   QProgressDialog progress(tr("Exporting project bundle..."), QString(), 0, 100,
                            this);
   progress.setWindowModality(Qt::ApplicationModal);
@@ -8427,7 +8877,6 @@ void MainWindow::exportProjectZip() {
       QDir(lastSuccessfulCompile_.sketchFolder).absolutePath() ==
           QDir(sketchFolder).absolutePath() &&
       lastSuccessfulCompile_.fqbn.trimmed() == fqbn &&
-      !lastSuccessfulCompile_.sketchChangedSinceCompile &&
       !currentSignature.isEmpty() &&
       currentSignature == lastSuccessfulCompile_.sketchSignature) {
     buildArtifactsSourceDir = lastSuccessfulCompile_.buildPath;
@@ -8667,7 +9116,7 @@ void MainWindow::exportProjectZip() {
     QMessageBox::warning(this, tr("Export Project ZIP"),
                          tr("Could not create archive.\n\n%1")
                              .arg(archiveError.trimmed().isEmpty()
-                                      ? tr("No compatible archive tool found.")
+                                      ? tr("Unknown error.")
                                       : archiveError.trimmed()));
     return;
   }
@@ -8922,6 +9371,7 @@ void MainWindow::importProjectZip() {
   if (libraryManager_) {
     libraryManager_->refresh();
   }
+  invalidateBoardDetails();
   refreshInstalledBoards();
   refreshConnectedPorts();
 
@@ -8950,38 +9400,80 @@ void MainWindow::importProjectZip() {
 void MainWindow::showQuickOpen() {
   if (!editor_) return;
 
-  QStringList recent = recentSketches();
-  if (recent.isEmpty()) {
+  updateWorkspaceFileRoots();
+  const QStringList recent = recentSketches();
+  if (recent.isEmpty() && workspaceFiles_->roots().isEmpty()) {
     QMessageBox::information(this, tr("No Recent Sketches"),
                              tr("No recent sketches available. Open a sketch first."));
     return;
   }
 
   auto* dialog = new QuickPickDialog(this);
-  dialog->setPlaceholderText(tr("Search recent sketches..."));
+  dialog->setPlaceholderText(tr("Search files and recent sketches..."));
 
-  QVector<QuickPickDialog::Item> items;
+  // Recent sketches are few; they are ranked here and listed after the
+  // files, which the index ranks.
+  auto sketches = std::make_shared<QVector<QuickPickDialog::Item>>();
+  auto sketchMatcher = std::make_shared<FuzzyMatcher>();
   for (const QString& sketchPath : recent) {
-    const QString name = QFileInfo(sketchPath).completeBaseName();
     QuickPickDialog::Item item;
-    item.label = name;
+    item.label = QFileInfo(sketchPath).completeBaseName();
     item.detail = sketchPath;
     item.data = sketchPath;
-    items.append(item);
+    sketchMatcher->add(item.label, item.detail);
+    sketches->append(item);
   }
 
-  dialog->setItems(items);
+  const QPointer<WorkspaceFileIndex> index = workspaceFiles_;
+  auto provider = [index, sketches, sketchMatcher](const QString& query) {
+    QVector<QuickPickDialog::Item> items;
+    if (index) {
+      const QVector<WorkspaceFileIndex::Match> matches = index->find(query);
+      items.reserve(matches.size() + sketches->size());
+      for (const WorkspaceFileIndex::Match& match : matches) {
+        QuickPickDialog::Item item;
+        item.label = QFileInfo(match.relativePath).fileName();
+        item.detail = QStringLiteral("%1: %2").arg(match.rootLabel, match.relativePath);
+        item.data = match.filePath;
+        items.append(item);
+      }
+    }
+    for (int id : sketchMatcher->rank(FuzzyMatcher::Pattern(query))) {
+      items.append(sketches->at(id));
+    }
+    return items;
+  };
+  dialog->setItemProvider(provider);
+  // Results from the cache or a still running scan are updated in place.
+  connect(workspaceFiles_, &WorkspaceFileIndex::filesChanged, dialog,
+          [dialog] { dialog->refreshItems(); });
 
   if (dialog->exec() == QDialog::Accepted) {
-    const QVariant data = dialog->selectedData();
-    const QString folder = data.toString().trimmed();
-    if (!folder.isEmpty()) {
-      (void)openSketchFolderInUi(folder);
+    const QString path = dialog->selectedData().toString().trimmed();
+    if (QFileInfo(path).isDir()) {
+      (void)openSketchFolderInUi(path);
+    } else if (!path.isEmpty()) {
+      (void)editor_->openFile(path);
     }
   }
   dialog->deleteLater();
 }
 
+void MainWindow::updateWorkspaceFileRoots() {
+  if (!workspaceFiles_) {
+    return;
+  }
+  QSettings settings;
+  settings.beginGroup("Preferences");
+  QString sketchbookDir = settings.value("sketchbookDir").toString();
+  settings.endGroup();
+  if (sketchbookDir.trimmed().isEmpty()) {
+    sketchbookDir = defaultSketchbookDir();
+  }
+  workspaceFiles_->setRoots(WorkspaceFileIndex::defaultRoots(
+      currentSketchFolderPath(), sketchbookDir, defaultArduinoDataDirPath(), currentFqbn()));
+}
+
 void MainWindow::showCommandPalette() {
   auto* dialog = new QuickPickDialog(this);
   dialog->setPlaceholderText(tr("Type a command..."));
@@ -10377,11 +10869,19 @@ void MainWindow::verifySketch() {
     args << "--optimize-for-debug";
   }
 
-  QDir buildDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/rewritto/build");
-  buildDir.mkpath(buildDir.absolutePath());
-  args << "--build-path" << buildDir.absolutePath();
+  const QString fqbn = currentFqbn();
+  const QString buildPath = buildPathForSketch(sketchFolder, fqbn);
+  args << "--build-path" << buildPath;
   args << sketchFolder;
 
+  compileBuildFlow_.sketchFolder = sketchFolder;
+  if (sketchSignature_) {
+    sketchSignature_->setSketchFolder(sketchFolder);
+    compileBuildFlow_.signatureRevision = sketchSignature_->revision();
+  }
+  compileBuildFlow_.fqbn = fqbn;
+  compileBuildFlow_.buildPath = buildPath;
+
   arduinoCli_->run(args);
 }
 
@@ -10524,14 +11024,17 @@ void MainWindow::uploadSketch() {
     args << "--optimize-for-debug";
   }
 
-  QDir buildDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/rewritto/upload");
-  buildDir.mkpath(buildDir.absolutePath());
-  args << "--build-path" << buildDir.absolutePath();
+  const QString buildPath = buildPathForSketch(sketchFolder, fqbn);
+  args << "--build-path" << buildPath;
   args << sketchFolder;
 
 	  // Store pending upload info
 	  pendingUploadFlow_.sketchFolder = sketchFolder;
-	  pendingUploadFlow_.buildPath = buildDir.absolutePath();
+	  if (sketchSignature_) {
+	    sketchSignature_->setSketchFolder(sketchFolder);
+	    pendingUploadFlow_.signatureRevision = sketchSignature_->revision();
+	  }
+	  pendingUploadFlow_.buildPath = buildPath;
 	  pendingUploadFlow_.fqbn = fqbn;
 	  pendingUploadFlow_.port = selectedPort;
 	  pendingUploadFlow_.protocol =
@@ -10620,14 +11123,16 @@ void MainWindow::uploadUsingProgrammer() {
     args << "--optimize-for-debug";
   }
 
-  QDir buildDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation) +
-                "/rewritto/upload-programmer");
-  buildDir.mkpath(buildDir.absolutePath());
-  args << "--build-path" << buildDir.absolutePath();
+  const QString buildPath = buildPathForSketch(sketchFolder, fqbn);
+  args << "--build-path" << buildPath;
   args << sketchFolder;
 
   pendingUploadFlow_.sketchFolder = sketchFolder;
-  pendingUploadFlow_.buildPath = buildDir.absolutePath();
+  if (sketchSignature_) {
+    sketchSignature_->setSketchFolder(sketchFolder);
+    pendingUploadFlow_.signatureRevision = sketchSignature_->revision();
+  }
+  pendingUploadFlow_.buildPath = buildPath;
   pendingUploadFlow_.fqbn = fqbn;
   pendingUploadFlow_.port = portOk ? port : QString{};
   pendingUploadFlow_.protocol = portOk ? currentPortProtocol() : QString{};
@@ -10658,8 +11163,7 @@ void MainWindow::exportCompiledBinary() {
   connect(arduinoCli_, &ArduinoCli::finished, this,
           [this, sketchFolder](int exitCode, QProcess::ExitStatus) {
     if (exitCode == 0) {
-      const QString buildPath = QStandardPaths::writableLocation(QStandardPaths::TempLocation)
-                                + "/rewritto/build";
+      const QString buildPath = compileBuildFlow_.buildPath;
       const QString sketchName = QFileInfo(sketchFolder).fileName();
 
       QDir dir(buildPath);
@@ -11267,6 +11771,7 @@ void MainWindow::importSetupProfile() {
   if (libraryManager_) {
     libraryManager_->refresh();
   }
+  invalidateBoardDetails();
   refreshInstalledBoards();
   refreshConnectedPorts();
 
@@ -11625,6 +12130,7 @@ void MainWindow::bootstrapProjectLockfile() {
   if (libraryManager_) {
     libraryManager_->refresh();
   }
+  invalidateBoardDetails();
   refreshInstalledBoards();
   refreshConnectedPorts();
 
@@ -11853,6 +12359,7 @@ void MainWindow::runEnvironmentDoctor() {
   if (libraryManager_) {
     libraryManager_->refresh();
   }
+  invalidateBoardDetails();
   refreshInstalledBoards();
   refreshConnectedPorts();
   updateSketchbookView();
@@ -12580,7 +13087,7 @@ void MainWindow::archiveSketch() {
       QMessageBox::warning(this, tr("Archive Failed"),
                            tr("Could not create zip archive.\n\n%1")
                                .arg(archiveError.trimmed().isEmpty()
-                                        ? tr("No compatible archive tool found.")
+                                        ? tr("Unknown error.")
                                         : archiveError.trimmed()));
     } else {
       QMessageBox::information(this, tr("Archive Complete"),
@@ -12708,190 +13215,405 @@ void MainWindow::startDebugging() {
     return;
   }
 
-  showToast(tr("Debugging will be implemented in a future version."));
+  if (debugSession_ && debugSession_->isActive()) {
+    if (debugSession_->state() == DebugSession::State::Stopped) {
+      debugContinue();
+    }
+    return;
+  }
+
+  const QString sketchFolder = currentSketchFolderPath();
+  if (!arduinoCli_ || sketchFolder.isEmpty()) {
+    return;
+  }
+
+  if (!debugSession_) {
+    debugSession_ = new DebugSession(this);
+    connect(debugSession_, &DebugSession::consoleOutput, this, [this](const QString& text) {
+      if (debugConsole_) {
+        debugConsole_->moveCursor(QTextCursor::End);
+        debugConsole_->insertPlainText(text);
+        debugConsole_->moveCursor(QTextCursor::End);
+      }
+    });
+    connect(debugSession_, &DebugSession::stateChanged, this,
+            [this](DebugSession::State state) {
+              switch (state) {
+                case DebugSession::State::Idle:
+                  // Idle straight after Starting means gdb is ready: arm the
+                  // breakpoints and resume. arduino-cli has gdb attached to
+                  // a halted remote (OpenOCD) target, where -exec-run does
+                  // not work; reset it so setup() runs under the
+                  // breakpoints. Later, Idle means the program ended.
+                  if (debugInferiorState_ == DebugInferiorState::Unknown) {
+                    applyDebugBreakpoints();
+                    debugSession_->sendCommand(
+                        QStringLiteral("-interpreter-exec console \"monitor reset halt\""));
+                    debugSession_->execContinue();
+                  }
+                  setDebugInferiorState(DebugInferiorState::Unknown);
+                  clearDebugSessionState();
+                  break;
+                case DebugSession::State::Running:
+                  setDebugInferiorState(DebugInferiorState::Running);
+                  break;
+                case DebugSession::State::Stopped:
+                  setDebugInferiorState(DebugInferiorState::Stopped);
+                  break;
+                case DebugSession::State::NotStarted:
+                case DebugSession::State::Starting:
+                case DebugSession::State::Exited:
+                  setDebugInferiorState(DebugInferiorState::Unknown);
+                  break;
+              }
+              const bool active = debugSession_->isActive();
+              if (debugStartButton_) {
+                debugStartButton_->setEnabled(!active);
+              }
+              if (debugStopButton_) {
+                debugStopButton_->setEnabled(active);
+              }
+              if (actionStopDebugging_) {
+                actionStopDebugging_->setEnabled(active);
+              }
+            });
+    connect(debugSession_, &DebugSession::stopped, this,
+            [this](const DebugSession::StopInfo& info) {
+              debugSelectedThreadId_ = info.threadId;
+              debugSelectedFrameLevel_ = 0;
+              const QString file = info.frame.fullPath.isEmpty() ? info.frame.file
+                                                                 : info.frame.fullPath;
+              if (editor_ && !file.isEmpty() && info.frame.line > 0 && QFileInfo::exists(file)) {
+                editor_->openLocation(file, info.frame.line, 1);
+              }
+            });
+    connect(debugSession_, &DebugSession::snapshotReady, this,
+            [this](const DebugSession::StopInfo&) {
+              debugSelectedFrameLevel_ = debugSession_->selectedFrame();
+              refreshDebugThreads();
+              refreshDebugCallStack();
+              refreshDebugLocals();
+              refreshDebugWatches();
+            });
+    connect(debugSession_, &DebugSession::exited, this, [this](const QString& message) {
+      if (debugConsole_) {
+        debugConsole_->appendPlainText(message);
+      }
+      clearDebugSessionState();
+    });
+  }
+
+  QStringList args = {QStringLiteral("debug"), QStringLiteral("--interpreter"),
+                      QStringLiteral("mi2"), QStringLiteral("-b"), currentFqbn()};
+  const QString port = currentPort();
+  if (!port.isEmpty()) {
+    args << QStringLiteral("-p") << port;
+  }
+  QString programmer = debugProgrammerEdit_ ? debugProgrammerEdit_->text().trimmed() : QString{};
+  if (programmer.isEmpty()) {
+    programmer = currentProgrammer();
+  }
+  if (!programmer.isEmpty()) {
+    args << QStringLiteral("-P") << programmer;
+  }
+  args << sketchFolder;
+
+  if (debugDock_) {
+    debugDock_->show();
+    debugDock_->raise();
+  }
+  if (debugConsole_) {
+    debugConsole_->clear();
+  }
+  clearDebugSessionState();
+  debugInferiorState_ = DebugInferiorState::Unknown;
+  for (auto& specs : breakpointsByFile_) {
+    for (auto& spec : specs) {
+      spec.gdbId = -1;
+      spec.insertSerial = 0;
+    }
+  }
+  breakpointById_.clear();
+  debugSession_->start(arduinoCli_->arduinoCliPath(), arduinoCli_->withGlobalFlags(args),
+                       sketchFolder);
+  debugSession_->setWatches(debugWatchExpressions_);
 }
 
 void MainWindow::debugStepOver() {
-  showToast(tr("Debugging not yet available."));
+  if (debugSession_ && debugInferiorState_ == DebugInferiorState::Stopped) {
+    debugSession_->execNext();
+  }
 }
 
 void MainWindow::debugStepInto() {
-  showToast(tr("Debugging not yet available."));
+  if (debugSession_ && debugInferiorState_ == DebugInferiorState::Stopped) {
+    debugSession_->execStep();
+  }
 }
 
 void MainWindow::debugStepOut() {
-  showToast(tr("Debugging not yet available."));
+  if (debugSession_ && debugInferiorState_ == DebugInferiorState::Stopped) {
+    debugSession_->execFinish();
+  }
 }
 
 void MainWindow::debugContinue() {
-  showToast(tr("Debugging not yet available."));
+  if (debugSession_ && debugInferiorState_ == DebugInferiorState::Stopped) {
+    debugSession_->execContinue();
+  }
 }
 
 void MainWindow::stopDebugging() {
-  showToast(tr("Debugging not yet available."));
+  stopDebugProcess();
 }
 
-// === Helper Functions ===
-bool MainWindow::createZipArchive(const QString& sourceDir,
-                                  const QString& zipPath,
-                                  QString* outError,
-                                  std::function<void(const QString& status)>
-                                      progressCallback) {
-  const QFileInfo sourceInfo(sourceDir);
-  if (!sourceInfo.exists() || !sourceInfo.isDir()) {
-    if (outError) {
-      *outError = tr("Source folder does not exist.");
+void MainWindow::stopDebugProcess() {
+  if (debugSession_ && debugSession_->isActive()) {
+    debugSession_->stop();
+  }
+}
+
+void MainWindow::clearDebugSessionState() {
+  for (QTreeWidget* tree : {debugThreadsTree_, debugCallStackTree_, debugLocalsTree_}) {
+    if (tree) {
+      tree->clear();
     }
-    return false;
   }
-  const QFileInfo targetInfo(zipPath);
-  if (targetInfo.absolutePath().trimmed().isEmpty()) {
-    if (outError) {
-      *outError = tr("Destination path is invalid.");
+  rebuildDebugWatchesTree();
+}
+
+void MainWindow::setDebugInferiorState(DebugInferiorState state) {
+  debugInferiorState_ = state;
+  const bool stopped = state == DebugInferiorState::Stopped;
+  const bool running = state == DebugInferiorState::Running;
+  for (QPushButton* button :
+       {debugContinueButton_, debugNextButton_, debugStepButton_, debugFinishButton_}) {
+    if (button) {
+      button->setEnabled(stopped);
     }
-    return false;
   }
-  if (!QDir().mkpath(targetInfo.absolutePath())) {
-    if (outError) {
-      *outError = tr("Could not create destination folder.");
+  if (debugInterruptButton_) {
+    debugInterruptButton_->setEnabled(running);
+  }
+  for (QAction* action : {actionContinue_, actionStepOver_, actionStepInto_, actionStepOut_}) {
+    if (action) {
+      action->setEnabled(stopped);
     }
-    return false;
   }
-  (void)QFile::remove(zipPath);
+}
 
-  const QString workingDir = sourceInfo.absoluteDir().absolutePath();
-  const QString sourceName = sourceInfo.fileName();
-  const int timeoutMs = 3600000;  // allow large project bundles
+void MainWindow::applyDebugBreakpoints() {
+  if (!debugSession_ || !debugSession_->isActive()) {
+    return;
+  }
+  for (auto fileIt = breakpointsByFile_.begin(); fileIt != breakpointsByFile_.end(); ++fileIt) {
+    const QString file = fileIt.key();
+    for (auto it = fileIt->begin(); it != fileIt->end(); ++it) {
+      // Inserts still waiting for their reply are not sent again.
+      if (it->gdbId >= 0 || it->insertSerial != 0 || !it->enabled) {
+        continue;
+      }
+      const int line = it.key();
+      const int serial = nextBreakpointInsertSerial_++;
+      it->insertSerial = serial;
+      debugSession_->insertBreakpoint(
+          file, line, it->condition, [this, file, line, serial](const MiParser::Record& r) {
+            const bool done = r.klass == QStringLiteral("done");
+            const int id =
+                r.results.value(MiParser::Key::Bkpt).value(MiParser::Key::Number).toInt();
+            auto specs = breakpointsByFile_.find(file);
+            if (specs == breakpointsByFile_.end() || !specs->contains(line) ||
+                (*specs)[line].insertSerial != serial) {
+              // Removed (or removed and set again) while the insert was in
+              // flight: nothing refers to this breakpoint, so drop it.
+              if (done && debugSession_ && debugSession_->isActive()) {
+                debugSession_->deleteBreakpoint(id);
+              }
+              return;
+            }
+            (*specs)[line].insertSerial = 0;
+            if (!done) {
+              if (debugConsole_) {
+                debugConsole_->appendPlainText(
+                    tr("Breakpoint %1:%2 not set: %3")
+                        .arg(QFileInfo(file).fileName())
+                        .arg(line)
+                        .arg(r.results.value(MiParser::Key::Msg).toString()));
+              }
+              return;
+            }
+            (*specs)[line].gdbId = id;
+            breakpointById_.insert(id, qMakePair(file, line));
+          });
+    }
+  }
+}
 
-  struct Attempt final {
-    QString program;
-    QStringList args;
-    QString label;
-  };
-  QVector<Attempt> attempts;
-
-  const QString zipExe = QStandardPaths::findExecutable(QStringLiteral("zip"));
-  if (!zipExe.isEmpty()) {
-    attempts.push_back(
-        {zipExe, {QStringLiteral("-rq"), zipPath, sourceName}, QStringLiteral("zip")});
-  }
-
-  const QString bsdtarExe =
-      QStandardPaths::findExecutable(QStringLiteral("bsdtar"));
-  if (!bsdtarExe.isEmpty()) {
-    attempts.push_back({bsdtarExe,
-                        {QStringLiteral("-a"), QStringLiteral("-cf"), zipPath, sourceName},
-                        QStringLiteral("bsdtar")});
-  }
-
-  const QString sevenZipExe = QStandardPaths::findExecutable(QStringLiteral("7z"));
-  if (!sevenZipExe.isEmpty()) {
-    attempts.push_back({sevenZipExe,
-                        {QStringLiteral("a"), QStringLiteral("-tzip"),
-                         QStringLiteral("-mx=9"), QStringLiteral("-y"), zipPath,
-                         sourceName},
-                        QStringLiteral("7z")});
-  }
-
-  const QString pythonExe =
-      QStandardPaths::findExecutable(QStringLiteral("python3"));
-  if (!pythonExe.isEmpty()) {
-    const QString script = QStringLiteral(
-        "import os,sys,zipfile\n"
-        "out_path=sys.argv[1]\n"
-        "src_dir=os.path.abspath(sys.argv[2])\n"
-        "base=os.path.dirname(src_dir)\n"
-        "with zipfile.ZipFile(out_path,'w',compression=zipfile.ZIP_DEFLATED,allowZip64=True) as zf:\n"
-        "  for root,dirs,files in os.walk(src_dir):\n"
-        "    for name in files:\n"
-        "      p=os.path.join(root,name)\n"
-        "      arc=os.path.relpath(p,base)\n"
-        "      zf.write(p,arc)\n");
-    attempts.push_back({pythonExe,
-                        {QStringLiteral("-c"), script, zipPath, sourceName},
-                        QStringLiteral("python3")});
-  }
-
-  QStringList errors;
-  for (const Attempt& attempt : attempts) {
-    CommandResult result;
-    QProcess process(this);
-    process.setWorkingDirectory(workingDir);
-    process.start(attempt.program, attempt.args);
-
-    if (!process.waitForStarted(5000)) {
-      result.stderrText = tr("Failed to start archiver tool.");
-      errors << QStringLiteral("%1: %2")
-                    .arg(attempt.label, commandErrorSummary(result));
-      (void)QFile::remove(zipPath);
+void MainWindow::rebuildDebugBreakpointsTree() {
+  if (!debugBreakpointsTree_) {
+    return;
+  }
+  debugBreakpointsTree_->clear();
+  QStringList files = breakpointsByFile_.keys();
+  files.sort();
+  for (const QString& file : std::as_const(files)) {
+    const auto& specs = breakpointsByFile_.value(file);
+    if (specs.isEmpty()) {
       continue;
     }
-    result.started = true;
+    auto* fileItem = new QTreeWidgetItem(debugBreakpointsTree_, {QFileInfo(file).fileName()});
+    fileItem->setToolTip(0, file);
+    for (auto it = specs.cbegin(); it != specs.cend(); ++it) {
+      auto* item =
+          new QTreeWidgetItem(fileItem, {QString{}, QString::number(it.key()), it->condition});
+      item->setData(0, Qt::UserRole, file);
+      item->setData(1, Qt::UserRole, it.key());
+      if (!it->enabled) {
+        item->setForeground(1, palette().brush(QPalette::Disabled, QPalette::Text));
+      }
+    }
+    fileItem->setExpanded(true);
+  }
+}
 
-    if (progressCallback) {
-      progressCallback(tr("Creating ZIP with %1...").arg(attempt.label));
+void MainWindow::refreshDebugThreads() {
+  if (!debugThreadsTree_ || !debugSession_) {
+    return;
+  }
+  debugThreadsTree_->clear();
+  for (const auto& thread : debugSession_->threads()) {
+    auto* item = new QTreeWidgetItem(debugThreadsTree_,
+                                     {thread.id, thread.targetId, thread.details});
+    if (thread.id == debugSelectedThreadId_) {
+      debugThreadsTree_->setCurrentItem(item);
     }
+  }
+}
 
-    QElapsedTimer elapsed;
-    elapsed.start();
-    QByteArray stdoutData;
-    QByteArray stderrData;
-    while (process.state() != QProcess::NotRunning) {
-      (void)process.waitForFinished(250);
-      stdoutData.append(process.readAllStandardOutput());
-      stderrData.append(process.readAllStandardError());
+void MainWindow::refreshDebugCallStack() {
+  if (!debugCallStackTree_ || !debugSession_) {
+    return;
+  }
+  const QSignalBlocker blocker(debugCallStackTree_);
+  debugCallStackTree_->clear();
+  for (const auto& frame : debugSession_->frames()) {
+    auto* item = new QTreeWidgetItem(
+        debugCallStackTree_,
+        {QString::number(frame.level), frame.function, frame.file,
+         frame.line > 0 ? QString::number(frame.line) : QString{}});
+    item->setData(0, Qt::UserRole, frame.level);
+    item->setToolTip(2, frame.fullPath);
+    if (frame.level == debugSelectedFrameLevel_) {
+      debugCallStackTree_->setCurrentItem(item);
+    }
+  }
+}
 
-      if (elapsed.elapsed() > timeoutMs) {
-        result.timedOut = true;
-        process.kill();
-        process.waitForFinished(1500);
-        break;
-      }
+void MainWindow::refreshDebugLocals() {
+  if (!debugLocalsTree_ || !debugSession_) {
+    return;
+  }
+  ++debugVariablesGeneration_;
+  debugLocalsTree_->setUpdatesEnabled(false);
+  debugLocalsTree_->clear();
+  for (const auto& var : debugSession_->locals()) {
+    debugLocalsTree_->addTopLevelItem(makeDebugVariableItem(var));
+  }
+  debugLocalsTree_->setUpdatesEnabled(true);
+}
 
-      if (progressCallback) {
-        const qint64 archiveSize = QFileInfo(zipPath).isFile()
-                                       ? QFileInfo(zipPath).size()
-                                       : 0;
-        progressCallback(
-            tr("Creating ZIP with %1... %2 written (%3 elapsed)")
-                .arg(attempt.label,
-                     formatByteSize(archiveSize),
-                     formatElapsedTimeMs(elapsed.elapsed())));
-      }
+void MainWindow::refreshDebugWatches() {
+  rebuildDebugWatchesTree();
+}
+
+void MainWindow::rebuildDebugWatchesTree() {
+  if (!debugWatchesTree_) {
+    return;
+  }
+  ++debugVariablesGeneration_;
+  debugWatchesTree_->clear();
+  const bool live = debugSession_ && debugSession_->state() == DebugSession::State::Stopped;
+  if (live) {
+    for (const auto& var : debugSession_->watches()) {
+      debugWatchesTree_->addTopLevelItem(makeDebugVariableItem(var));
     }
+    return;
+  }
+  for (const QString& expression : std::as_const(debugWatchExpressions_)) {
+    debugWatchesTree_->addTopLevelItem(new QTreeWidgetItem({expression}));
+  }
+}
+
+void MainWindow::selectDebugFrame(int level, bool openLocation) {
+  if (!debugSession_ || debugInferiorState_ != DebugInferiorState::Stopped) {
+    return;
+  }
+  const auto& frames = debugSession_->frames();
+  if (level < 0 || level >= frames.size()) {
+    return;
+  }
+  debugSelectedFrameLevel_ = level;
+  debugSession_->selectFrame(level);
+  const DebugSession::Frame& frame = frames.at(level);
+  const QString file = frame.fullPath.isEmpty() ? frame.file : frame.fullPath;
+  if (openLocation && editor_ && !file.isEmpty() && frame.line > 0 &&
+      QFileInfo::exists(file)) {
+    editor_->openLocation(file, frame.line, 1);
+  }
+}
 
-    stdoutData.append(process.readAllStandardOutput());
-    stderrData.append(process.readAllStandardError());
-    result.exitStatus = process.exitStatus();
-    result.exitCode = process.exitCode();
-    result.stdoutText = QString::fromUtf8(stdoutData);
-    result.stderrText = QString::fromUtf8(stderrData);
+void MainWindow::onDebugVariableExpanded(QTreeWidgetItem* item) {
+  if (!item || item->data(0, kDebugChildrenLoadedRole).toBool()) {
+    return;
+  }
+  const QString id = item->data(0, kDebugVarIdRole).toString();
+  if (!id.isEmpty()) {
+    requestVariableChildren(item, id);
+  }
+}
 
-    if (commandSucceeded(result) && QFileInfo::exists(zipPath)) {
-      if (progressCallback) {
-        progressCallback(
-            tr("ZIP created using %1 (%2).")
-                .arg(attempt.label, formatByteSize(QFileInfo(zipPath).size())));
-      }
-      if (outError) {
-        outError->clear();
-      }
-      return true;
-    }
-    errors << QStringLiteral("%1: %2")
-                  .arg(attempt.label, commandErrorSummary(result));
-    (void)QFile::remove(zipPath);
+void MainWindow::requestVariableChildren(QTreeWidgetItem* item, const QString& varPath) {
+  if (!debugSession_ || !item) {
+    return;
   }
+  item->setData(0, kDebugChildrenLoadedRole, true);
+  // Both trees are rebuilt on every snapshot; only fill the item if it is
+  // still from the current one.
+  const quint64 generation = debugVariablesGeneration_;
+  debugSession_->listChildren(
+      varPath, [this, item, generation](const QVector<DebugSession::Variable>& children) {
+        if (generation != debugVariablesGeneration_) {
+          return;
+        }
+        for (const auto& child : children) {
+          item->addChild(makeDebugVariableItem(child));
+        }
+      });
+}
 
-  if (outError) {
-    if (errors.isEmpty()) {
-      *outError = tr("No compatible archive tool found. Install `zip`, `bsdtar`, `7z`, or `python3`.");
-    } else {
-      *outError = tr("Archive creation failed.\n%1")
-                      .arg(errors.join(QStringLiteral("\n")));
-    }
+// === Helper Functions ===
+bool MainWindow::createZipArchive(const QString& sourceDir,
+                                  const QString& zipPath,
+                                  QString* outError,
+                                  std::function<void(const QString& status)>
+                                      progressCallback) {
+  QElapsedTimer elapsed;
+  elapsed.start();
+  ZipArchive::ProgressCallback progress;
+  if (progressCallback) {
+    progress = [this, &progressCallback, &elapsed](qint64 doneBytes, qint64 totalBytes) {
+      progressCallback(tr("Creating ZIP... %1 of %2 compressed (%3 elapsed)")
+                           .arg(formatByteSize(doneBytes), formatByteSize(totalBytes),
+                                formatElapsedTimeMs(elapsed.elapsed())));
+    };
   }
-  return false;
+  if (!ZipArchive::createFromDirectory(sourceDir, zipPath, outError, progress)) {
+    return false;
+  }
+  if (progressCallback) {
+    progressCallback(tr("ZIP created (%1).").arg(formatByteSize(QFileInfo(zipPath).size())));
+  }
+  return true;
 }
 
 void MainWindow::showToast(const QString& message, int timeoutMs) {
@@ -14072,12 +14794,10 @@ void MainWindow::restoreCodeSnapshot(const QString& snapshotId) {
     }
   }
 
-  if (!lastSuccessfulCompile_.sketchFolder.trimmed().isEmpty() &&
-      QDir(lastSuccessfulCompile_.sketchFolder).absolutePath() == QDir(sketchFolder).absolutePath()) {
-    const QString currentSignature = computeSketchSignature(sketchFolder);
-    lastSuccessfulCompile_.sketchChangedSinceCompile =
-        currentSignature.isEmpty() ||
-        currentSignature != lastSuccessfulCompile_.sketchSignature;
+  if (sketchSignature_) {
+    for (const QString& p : std::as_const(writtenFiles)) {
+      sketchSignature_->markChanged(p);
+    }
   }
   updateUploadActionStates();
 
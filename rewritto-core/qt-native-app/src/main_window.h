@@ -14,7 +14,7 @@
 #include <functional>
 
 #include "code_editor.h"
-#include "mi_parser.h"
+#include "debug_session.h"
 
 class QAction;
 class QActionGroup;
@@ -37,12 +37,18 @@ class QPushButton;
 class QTreeWidget;
 class QStackedWidget;
 class QTemporaryDir;
+class QThread;
 
 class ArduinoCli;
+class BoardDetailsCache;
 class EditorWidget;
+class ExamplesIndex;
 class WelcomeWidget;
 class LspClient;
 class OutputWidget;
+class PlatformCatalogService;
+class PortWatcher;
+class SketchSignatureTracker;
 class ProblemsWidget;
 class SerialMonitorWidget;
 class SerialPlotterWidget;
@@ -55,6 +61,7 @@ class FindInFilesDialog;
 class BoardsManagerDialog;
 class LibraryManagerDialog;
 class ReplaceInFilesDialog;
+class WorkspaceFileIndex;
 
 class MainWindow final : public QMainWindow {
   Q_OBJECT
@@ -97,6 +104,10 @@ class MainWindow final : public QMainWindow {
 
   SketchManager* sketchManager_ = nullptr;
   ArduinoCli* arduinoCli_ = nullptr;
+  PlatformCatalogService* platformCatalog_ = nullptr;
+  ExamplesIndex* examplesIndex_ = nullptr;
+  WorkspaceFileIndex* workspaceFiles_ = nullptr;
+  BoardDetailsCache* boardDetailsCache_ = nullptr;
 
   QFileSystemModel* fileModel_ = nullptr;
   QTreeView* fileTree_ = nullptr;
@@ -174,11 +185,9 @@ class MainWindow final : public QMainWindow {
   QProcess* boardsRefreshProcess_ = nullptr;
   QProcess* portsRefreshProcess_ = nullptr;
   bool portsRefreshQueued_ = false;
-  QProcess* portsWatchProcess_ = nullptr;
-  QByteArray portsWatchBuffer_;
-  QTimer* portsWatchDebounceTimer_ = nullptr;
+  PortWatcher* portWatcher_ = nullptr;
+  SketchSignatureTracker* sketchSignature_ = nullptr;
   QTimer* portsAutoRefreshTimer_ = nullptr;
-  bool portsWatchHadError_ = false;
   QProgressBar* cliBusy_ = nullptr;
   QLabel* cliBusyLabel_ = nullptr;
   QLabel* boardPortLabel_ = nullptr;
@@ -249,6 +258,7 @@ class MainWindow final : public QMainWindow {
   QAction* actionUploadUsingProgrammer_ = nullptr;
   QAction* actionExportCompiledBinary_ = nullptr;
   QAction* actionOptimizeForDebug_ = nullptr;
+  QAction* actionCleanBuild_ = nullptr;
   QAction* actionShowSketchFolder_ = nullptr;
   QAction* actionRenameSketch_ = nullptr;
   QAction* actionAddFileToSketch_ = nullptr;
@@ -288,6 +298,8 @@ class MainWindow final : public QMainWindow {
 
   QMenu* recentSketchesMenu_ = nullptr;
   QMenu* examplesMenu_ = nullptr;
+  quint64 examplesMenuRevision_ = 0;  // index revision the menu shows; 0 if none
+  QString examplesMenuFqbn_;
   QMenu* viewMenu_ = nullptr;
   QMenu* toolsMenu_ = nullptr;
   QMenu* toolbarsMenu_ = nullptr;
@@ -343,17 +355,19 @@ class MainWindow final : public QMainWindow {
   QPlainTextEdit* debugConsole_ = nullptr;
   QLineEdit* debugCommandEdit_ = nullptr;
   QPushButton* debugSendButton_ = nullptr;
-  QProcess* debugProcess_ = nullptr;
+  DebugSession* debugSession_ = nullptr;
   struct BreakpointSpec final {
     bool enabled = true;
     QString condition;
     int hitCount = 0;  // break on Nth hit; 0 disables hit-count
     int gdbId = -1;    // GDB breakpoint ID for precise management
+    int insertSerial = 0;  // nonzero while -break-insert awaits its reply
     QString logMessage;  // If non-empty, this is a logpoint (print without stopping)
     bool isLogpoint = false;  // true if this breakpoint is a logpoint
   };
   QHash<QString, QMap<int, BreakpointSpec>> breakpointsByFile_;  // abs file -> (line -> spec)
   QHash<int, QPair<QString, int>> breakpointById_;  // gdb id -> (file, line) reverse mapping
+  int nextBreakpointInsertSerial_ = 1;
   QStringList debugWatchExpressions_;
   QString debugSelectedThreadId_;
 
@@ -364,10 +378,7 @@ class MainWindow final : public QMainWindow {
   };
   DebugInferiorState debugInferiorState_ = DebugInferiorState::Unknown;
   int debugSelectedFrameLevel_ = 0;
-
-  MiParser debugMiParser_;
-  int debugMiNextToken_ = 1;
-  QHash<int, std::function<void(const MiParser::Record&)>> debugMiPending_;
+  quint64 debugVariablesGeneration_ = 0;
 
   void createActions();
   void createMenus();
@@ -424,16 +435,19 @@ class MainWindow final : public QMainWindow {
   void setSketchPinned(const QString& folder, bool pinned);
   bool isSketchPinned(const QString& folder) const;
   void refreshInstalledBoards();
+  void populateBoardCombo(const QMap<QString, QString>& uniqueBoards);  // name -> fqbn
   void refreshConnectedPorts();
+  void rebuildPortCombo();
   void scheduleBoardListRefresh();
-  void startPortWatcher();
-  void stopPortWatcher();
   void rebuildBoardMenu();
   void rebuildPortMenu();
   void maybeAutoSelectBoardForCurrentPort();
   void updateSketchbookView();
   void scheduleRefreshBoardOptions();
   void refreshBoardOptions();
+  void prefetchBoardDetails();
+  void invalidateBoardDetails();
+  void rememberRecentBoard(const QString& fqbn);
   void clearBoardOptionMenus();
   void stopRefreshProcesses();
   QString currentFqbn() const;
@@ -457,14 +471,23 @@ class MainWindow final : public QMainWindow {
   void clearPendingUploadFlow();
   bool startUploadFromPendingFlow();
   void updateUploadActionStates();
+  // `signatureRevision` is the sketch tracker's revision when the compile
+  // started.
   void rememberSuccessfulCompileArtifact(const QString& sketchFolder,
                                          const QString& fqbn,
-                                         const QString& buildPath);
-  void markSketchAsChanged(const QString& filePath);
+                                         const QString& buildPath,
+                                         quint64 signatureRevision);
+  // Acquires the build directory for a compile about to start; it stays
+  // held against eviction until releaseHeldBuild().
+  QString buildPathForSketch(const QString& sketchFolder,
+                             const QString& fqbn);
+  void releaseHeldBuild();
+  void updateBuildCache(const QString& finishedBuildPath);
+  void cleanCurrentBuild();
   QString computeSketchSignature(const QString& sketchFolder) const;
   bool canUploadWithoutCompile(QString* reason = nullptr) const;
   void beginCliProgress(CliJobKind job);
-  void updateCliProgressFromOutputLine(const QString& line);
+  void updateCliProgressFromOutputLine(QStringView line);
   void finishCliProgress(bool success, bool cancelled);
   void setCliProgressValue(int value, const QString& phaseText = {});
   QString cliJobLabel(CliJobKind job) const;
@@ -480,6 +503,7 @@ class MainWindow final : public QMainWindow {
   void focusLibraryManagerSearch(const QString& query);
   void updateStopActionState();
   void showQuickOpen();
+  void updateWorkspaceFileRoots();
   void showCommandPalette();
   void showGoToSymbol();
   void showFindReplaceDialog();
@@ -508,6 +532,9 @@ class MainWindow final : public QMainWindow {
   void openSketch();
   void openSketchFolder();
   void exportProjectZip();
+  // The bundle itself, once exportProjectZip() has a path and the sketch
+  // signature is settled.
+  void writeProjectZip(const QString& sketchFolder, const QString& zipPath);
   void importProjectZip();
 
   // Sketch menu actions
@@ -567,9 +594,6 @@ class MainWindow final : public QMainWindow {
   void requestVariableChildren(QTreeWidgetItem* item, const QString& varPath);
   QString formatDebugValue(const QString& value, const QString& type);
   bool isExpandableType(const QString& type) const;
-  void handleMiRecord(const MiParser::Record& r);
-  void sendMiRequest(const QString& cmd,
-                     std::function<void(const MiParser::Record&)> onResult);
   void setDebugInferiorState(DebugInferiorState state);
   static QString toFileUri(const QString& filePath);
   static QString findExecutable(const QString& name);
@@ -616,6 +640,8 @@ class MainWindow final : public QMainWindow {
   bool capturingCliOutput_ = false;
   QString cliOutputCapture_;
   QString cliOutputBuffer_;
+  bool cliOutputVerbose_ = false;
+  bool cliOutputVerboseKnown_ = false;
 
   void processOutputChunk(const QString& chunk);
 
@@ -633,6 +659,7 @@ class MainWindow final : public QMainWindow {
     bool allowMissingPort = false;
     bool uf2FallbackAttempted = false;
     CliJobKind finalJobKind = CliJobKind::Upload;
+    quint64 signatureRevision = 0;
   };
   PendingUploadFlow pendingUploadFlow_;
   QTemporaryDir* uploadBuildDir_ = nullptr;
@@ -641,9 +668,25 @@ class MainWindow final : public QMainWindow {
     QString fqbn;
     QString buildPath;
     QString sketchSignature;
-    bool sketchChangedSinceCompile = true;
+    // Tracker revision at compile start; a signature taken after it moved
+    // may cover edits the binary does not have.
+    quint64 signatureRevision = 0;
   };
   LastSuccessfulCompile lastSuccessfulCompile_;
+  // Sizes finished builds and evicts over the cap; walks whole build trees,
+  // so it runs off the GUI thread, one pass at a time.
+  QThread* buildCacheThread_ = nullptr;
+  QStringList pendingFinishedBuildPaths_;
+  // Acquired from BuildDirectoryManager for the compile (and any upload
+  // from it) in progress; at most one at a time.
+  QString heldBuildPath_;
+  struct CompileBuildFlow final {
+    QString sketchFolder;
+    QString fqbn;
+    QString buildPath;
+    quint64 signatureRevision = 0;
+  };
+  CompileBuildFlow compileBuildFlow_;
   QString currentCliPhaseText_;
 
   QTimer* serialReconnectTimer_ = nullptr;
@@ -1,266 +1,571 @@
 #include "mi_parser.h"
 
-#include <QChar>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+struct MiParser::Node final {
+  qint32 nameBegin = 0;
+  qint32 nameSize = 0;
+  qint32 textBegin = 0;  // const text without quotes, or the container's span
+  qint32 textSize = 0;
+  qint32 end = 0;  // index past this node's subtree
+  qint32 childCount = 0;
+  Value::Kind kind = Value::Kind::Const;
+  Key key = Key::Other;
+  bool escaped = false;  // text contains backslash escapes
+};
+
+struct MiParser::Storage final {
+  QByteArray bytes;  // the chunk the records were read from
+  QVector<Node> nodes;
+};
 
 namespace {
 
-static bool isRecordPrefix(const QChar ch) {
+constexpr std::string_view kKeyNames[] = {
+    "",
+    "addr",
+    "args",
+    "begin",
+    "bkpt",
+    "bkptno",
+    "changelist",
+    "children",
+    "cond",
+    "contents",
+    "core",
+    "current-thread-id",
+    "data",
+    "details",
+    "disp",
+    "displayhint",
+    "dynamic",
+    "enabled",
+    "end",
+    "exit-code",
+    "exp",
+    "file",
+    "frame",
+    "fullname",
+    "func",
+    "has_more",
+    "id",
+    "in_scope",
+    "level",
+    "line",
+    "locals",
+    "memory",
+    "msg",
+    "name",
+    "new_num_children",
+    "new_type",
+    "number",
+    "numchild",
+    "offset",
+    "original-location",
+    "reason",
+    "signal-name",
+    "stack",
+    "state",
+    "stopped-threads",
+    "target-id",
+    "thread-id",
+    "threads",
+    "times",
+    "type",
+    "type_changed",
+    "value",
+    "variables",
+    "what",
+};
+static_assert(std::size(kKeyNames) == size_t(MiParser::Key::What) + 1);
+static_assert(std::is_sorted(std::begin(kKeyNames) + 1, std::end(kKeyNames)));
+
+// Record classes handed out as shared strings instead of fresh allocations.
+constexpr std::string_view kClassNames[] = {
+    "breakpoint-created",
+    "breakpoint-deleted",
+    "breakpoint-modified",
+    "cmd-param-changed",
+    "connected",
+    "done",
+    "download",
+    "error",
+    "exit",
+    "library-loaded",
+    "library-unloaded",
+    "memory-changed",
+    "running",
+    "stopped",
+    "thread-created",
+    "thread-exited",
+    "thread-group-added",
+    "thread-group-exited",
+    "thread-group-started",
+    "thread-selected",
+};
+static_assert(std::is_sorted(std::begin(kClassNames), std::end(kClassNames)));
+
+std::string_view toStd(QByteArrayView view) {
+  return std::string_view(view.data(), size_t(view.size()));
+}
+
+QString internClass(QByteArrayView text) {
+  static const QVector<QString> strings = [] {
+    QVector<QString> out;
+    for (const std::string_view name : kClassNames) {
+      out.push_back(QString::fromLatin1(name.data(), qsizetype(name.size())));
+    }
+    return out;
+  }();
+  const std::string_view needle = toStd(text);
+  const auto it = std::lower_bound(std::begin(kClassNames), std::end(kClassNames), needle);
+  if (it != std::end(kClassNames) && *it == needle) {
+    return strings.at(it - std::begin(kClassNames));
+  }
+  return QString::fromLatin1(text.data(), text.size());
+}
+
+bool isRecordPrefix(char ch) {
   return ch == '^' || ch == '*' || ch == '+' || ch == '=' || ch == '~' || ch == '@' ||
          ch == '&';
 }
 
-class Cursor final {
+bool isNameChar(char ch) {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+         ch == '_' || ch == '-' || ch == '.' || static_cast<unsigned char>(ch) >= 0x80;
+}
+
+bool isOctal(char ch) {
+  return ch >= '0' && ch <= '7';
+}
+
+// Undoes C-string escaping. gdb writes non-ASCII bytes as octal escapes, so
+// the text is decoded only after all bytes are back.
+QString decodeCString(QByteArrayView text, bool escaped) {
+  if (!escaped) {
+    return QString::fromLocal8Bit(text);
+  }
+  QByteArray out;
+  out.reserve(text.size());
+  const qsizetype n = text.size();
+  for (qsizetype i = 0; i < n; ++i) {
+    const char ch = text[i];
+    if (ch != '\\') {
+      out += ch;
+      continue;
+    }
+    if (++i >= n) {
+      break;
+    }
+    const char esc = text[i];
+    switch (esc) {
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'e':
+        out += '\x1b';
+        break;
+      default:
+        if (isOctal(esc)) {
+          int value = esc - '0';
+          for (int digits = 1; digits < 3 && i + 1 < n && isOctal(text[i + 1]); ++digits) {
+            value = value * 8 + (text[++i] - '0');
+          }
+          out += char(value);
+        } else {
+          out += esc;  // \\ and \" included
+        }
+        break;
+    }
+  }
+  return QString::fromLocal8Bit(out);
+}
+
+}  // namespace
+
+// Builds nodes for one line, reading the bytes where they are.
+class MiParser::Tokenizer final {
  public:
-  explicit Cursor(QStringView s) : s_(s) {}
+  Tokenizer(const QByteArray& bytes, qsizetype pos, qsizetype end, QVector<Node>* nodes)
+      : data_(bytes.constData()), pos_(pos), end_(end), nodes_(nodes) {}
 
-  bool atEnd() const { return i_ >= s_.size(); }
-  QChar peek() const { return atEnd() ? QChar{} : s_.at(i_); }
-  QChar peekNext() const { return (i_ + 1) >= s_.size() ? QChar{} : s_.at(i_ + 1); }
+  bool atEnd() const { return pos_ >= end_; }
+  char peek() const { return atEnd() ? '\0' : data_[pos_]; }
   void advance() {
     if (!atEnd()) {
-      ++i_;
+      ++pos_;
     }
   }
-  bool consume(QChar ch) {
+  bool consume(char ch) {
     if (peek() == ch) {
-      ++i_;
+      ++pos_;
       return true;
     }
     return false;
   }
-  int pos() const { return i_; }
-  void setPos(int p) { i_ = p; }
-  QStringView viewFrom(int start) const { return s_.mid(start, i_ - start); }
+  qsizetype pos() const { return pos_; }
+  void setPos(qsizetype pos) { pos_ = pos; }
+  const QString& error() const { return error_; }
+
+  qint32 push(Value::Kind kind, qsizetype nameBegin, qsizetype nameSize) {
+    Node node;
+    node.kind = kind;
+    node.nameBegin = qint32(nameBegin);
+    node.nameSize = qint32(nameSize);
+    if (nameSize > 0) {
+      node.key = internKey(QByteArrayView(data_ + nameBegin, nameSize));
+    }
+    nodes_->push_back(node);
+    return qint32(nodes_->size() - 1);
+  }
 
- private:
-  QStringView s_;
-  int i_ = 0;
-};
+  void finish(qint32 index, qsizetype textBegin) {
+    Node& node = (*nodes_)[index];
+    node.textBegin = qint32(textBegin);
+    node.textSize = qint32(pos_ - textBegin);
+    node.end = qint32(nodes_->size());
+  }
 
-static QString parseCString(Cursor& c, QString* err) {
-  if (!c.consume('"')) {
-    if (err) {
-      *err = QStringLiteral("expected '\"'");
+  // Name characters at the cursor; returns how many.
+  qsizetype scanName() {
+    const qsizetype start = pos_;
+    while (pos_ < end_ && isNameChar(data_[pos_])) {
+      ++pos_;
     }
-    return {};
+    return pos_ - start;
+  }
+
+  // The cursor is on the opening quote. Finds the closing one with memchr,
+  // only stepping over escapes where a backslash actually occurs.
+  void cstring(qsizetype* textBegin, qsizetype* textSize, bool* escaped) {
+    advance();
+    const qsizetype start = pos_;
+    *escaped = false;
+    // The next quote is searched for again only once an escape has moved the
+    // cursor past it, so strings full of escapes stay linear.
+    const char* quote = nullptr;
+    bool quoteSearched = false;
+    while (pos_ < end_) {
+      const char* from = data_ + pos_;
+      if (!quoteSearched || (quote && quote < from)) {
+        quote = static_cast<const char*>(std::memchr(from, '"', size_t(end_ - pos_)));
+        quoteSearched = true;
+      }
+      const char* limit = quote ? quote : data_ + end_;
+      const char* slash =
+          static_cast<const char*>(std::memchr(from, '\\', size_t(limit - from)));
+      if (slash) {
+        *escaped = true;
+        pos_ = std::min<qsizetype>(slash - data_ + 2, end_);
+        continue;
+      }
+      if (!quote) {
+        break;
+      }
+      *textBegin = start;
+      *textSize = quote - (data_ + start);
+      pos_ = quote - data_ + 1;
+      return;
+    }
+    pos_ = end_;
+    *textBegin = start;
+    *textSize = end_ - start;
+    setError(QStringLiteral("unterminated string"));
   }
 
-  QString out;
-  while (!c.atEnd()) {
-    const QChar ch = c.peek();
+  void value(qsizetype nameBegin, qsizetype nameSize) {
+    const char ch = peek();
+    if (ch == '{') {
+      tuple(nameBegin, nameSize);
+      return;
+    }
+    if (ch == '[') {
+      list(nameBegin, nameSize);
+      return;
+    }
+    const qint32 index = push(Value::Kind::Const, nameBegin, nameSize);
+    qsizetype textBegin = pos_;
+    qsizetype textSize = 0;
+    bool escaped = false;
     if (ch == '"') {
-      c.advance();
-      return out;
+      cstring(&textBegin, &textSize, &escaped);
+    } else {
+      while (pos_ < end_ && data_[pos_] != ',' && data_[pos_] != '}' && data_[pos_] != ']') {
+        ++pos_;
+      }
+      textSize = pos_ - textBegin;
     }
-    if (ch == '\\') {
-      c.advance();
-      if (c.atEnd()) {
+    Node& node = (*nodes_)[index];
+    node.textBegin = qint32(textBegin);
+    node.textSize = qint32(textSize);
+    node.escaped = escaped;
+    node.end = index + 1;
+  }
+
+  // name=value pairs up to '}' or the end of the line.
+  void results(qint32 index) {
+    qint32 count = 0;
+    while (!atEnd()) {
+      const qsizetype nameBegin = pos_;
+      const qsizetype nameSize = scanName();
+      if (nameSize == 0) {
+        setError(QStringLiteral("expected name"));
         break;
       }
-      const QChar esc = c.peek();
-      c.advance();
-      switch (esc.unicode()) {
-        case 'n':
-          out += QChar('\n');
-          break;
-        case 'r':
-          out += QChar('\r');
-          break;
-        case 't':
-          out += QChar('\t');
-          break;
-        case 'b':
-          out += QChar('\b');
-          break;
-        case 'f':
-          out += QChar('\f');
-          break;
-        case '\\':
-          out += QChar('\\');
-          break;
-        case '"':
-          out += QChar('"');
-          break;
-        default:
-          out += esc;
-          break;
+      if (!consume('=')) {
+        setError(QStringLiteral("expected '='"));
+        break;
+      }
+      value(nameBegin, nameSize);
+      ++count;
+      if (!consume(',')) {
+        break;
+      }
+      if (peek() == '}' || peek() == ']') {
+        break;
       }
-      continue;
     }
-    out += ch;
-    c.advance();
+    (*nodes_)[index].childCount = count;
   }
 
-  if (err) {
-    *err = QStringLiteral("unterminated string");
+  void tuple(qsizetype nameBegin, qsizetype nameSize) {
+    const qsizetype start = pos_;
+    const qint32 index = push(Value::Kind::Tuple, nameBegin, nameSize);
+    advance();  // '{'
+    if (!consume('}')) {
+      results(index);
+      if (!consume('}')) {
+        setError(QStringLiteral("expected '}'"));
+      }
+    }
+    finish(index, start);
   }
-  return out;
-}
 
-static QString parseName(Cursor& c) {
-  const int start = c.pos();
-  while (!c.atEnd()) {
-    const QChar ch = c.peek();
-    if (ch.isLetterOrNumber() || ch == '_' || ch == '-' || ch == '.') {
-      c.advance();
-      continue;
+  void list(qsizetype nameBegin, qsizetype nameSize) {
+    const qsizetype start = pos_;
+    const qint32 index = push(Value::Kind::List, nameBegin, nameSize);
+    advance();  // '['
+    qint32 count = 0;
+    if (!consume(']')) {
+      while (!atEnd()) {
+        const char ch = peek();
+        if (ch == '"' || ch == '{' || ch == '[') {
+          value(0, 0);
+        } else {
+          const qsizetype save = pos_;
+          const qsizetype size = scanName();
+          if (size > 0 && peek() == '=') {
+            advance();  // '='
+            value(save, size);
+          } else {
+            pos_ = save;
+            value(0, 0);
+          }
+        }
+        ++count;
+        if (consume(']')) {
+          break;
+        }
+        if (!consume(',')) {
+          // Some MI outputs omit commas in unexpected places; stop parsing.
+          break;
+        }
+        if (consume(']')) {
+          break;
+        }
+      }
     }
-    break;
+    (*nodes_)[index].childCount = count;
+    finish(index, start);
   }
-  return c.viewFrom(start).toString();
-}
 
-static QString parseConst(Cursor& c) {
-  const int start = c.pos();
-  while (!c.atEnd()) {
-    const QChar ch = c.peek();
-    if (ch == ',' || ch == '}' || ch == ']' ) {
-      break;
+ private:
+  const char* data_ = nullptr;
+  qsizetype pos_ = 0;
+  qsizetype end_ = 0;
+  QVector<Node>* nodes_ = nullptr;
+  QString error_;
+
+  void setError(const QString& error) {
+    if (error_.isEmpty()) {
+      error_ = error;
     }
-    c.advance();
   }
-  return c.viewFrom(start).toString();
-}
+};
 
-static MiParser::Value parseValue(Cursor& c, QString* err);
+// --- Value -----------------------------------------------------------------
 
-static QMap<QString, MiParser::Value> parseResults(Cursor& c, QString* err);
+const MiParser::Node& MiParser::Value::node() const {
+  return storage_->nodes.at(index_);
+}
 
-static MiParser::Value parseTuple(Cursor& c, QString* err) {
-  if (!c.consume('{')) {
-    if (err) {
-      *err = QStringLiteral("expected '{'");
-    }
-    return MiParser::Value::makeTuple({});
+MiParser::Value::Kind MiParser::Value::kind() const {
+  return isValid() ? node().kind : Kind::Const;
+}
+
+QByteArrayView MiParser::Value::name() const {
+  if (!isValid()) {
+    return {};
   }
+  const Node& n = node();
+  return QByteArrayView(storage_->bytes.constData() + n.nameBegin, n.nameSize);
+}
 
-  QMap<QString, MiParser::Value> out;
-  if (c.consume('}')) {
-    return MiParser::Value::makeTuple(std::move(out));
+MiParser::Key MiParser::Value::key() const {
+  return isValid() ? node().key : Key::Other;
+}
+
+QByteArrayView MiParser::Value::bytes() const {
+  if (!isValid()) {
+    return {};
   }
+  const Node& n = node();
+  return QByteArrayView(storage_->bytes.constData() + n.textBegin, n.textSize);
+}
 
-  out = parseResults(c, err);
-  if (!c.consume('}')) {
-    if (err && err->isEmpty()) {
-      *err = QStringLiteral("expected '}'");
-    }
+QString MiParser::Value::toString() const {
+  if (!isValid()) {
+    return {};
   }
-  return MiParser::Value::makeTuple(std::move(out));
+  return decodeCString(bytes(), node().escaped);
 }
 
-static MiParser::Value parseList(Cursor& c, QString* err) {
-  if (!c.consume('[')) {
-    if (err) {
-      *err = QStringLiteral("expected '['");
+int MiParser::Value::toInt(bool* ok) const {
+  const QByteArrayView text = bytes();
+  if (text.isEmpty()) {
+    if (ok) {
+      *ok = false;
     }
-    return MiParser::Value::makeList({});
+    return 0;
   }
+  return QByteArray::fromRawData(text.data(), text.size()).toInt(ok);
+}
 
-  QVector<QPair<QString, MiParser::Value>> items;
-  if (c.consume(']')) {
-    return MiParser::Value::makeList(std::move(items));
-  }
+qsizetype MiParser::Value::size() const {
+  return isValid() ? node().childCount : 0;
+}
 
-  while (!c.atEnd()) {
-    if (c.peek() == '"') {
-      items.push_back(qMakePair(QString{}, MiParser::Value::makeConst(parseCString(c, err))));
-    } else if (c.peek() == '{') {
-      items.push_back(qMakePair(QString{}, parseTuple(c, err)));
-    } else if (c.peek() == '[') {
-      items.push_back(qMakePair(QString{}, parseList(c, err)));
-    } else {
-      const int save = c.pos();
-      const QString name = parseName(c);
-      if (!name.isEmpty() && c.peek() == '=') {
-        c.advance();  // '='
-        items.push_back(qMakePair(name, parseValue(c, err)));
-      } else {
-        c.setPos(save);
-        items.push_back(qMakePair(QString{}, MiParser::Value::makeConst(parseConst(c))));
-      }
-    }
+MiParser::Value::Iterator& MiParser::Value::Iterator::operator++() {
+  index_ = storage_->nodes.at(index_).end;
+  return *this;
+}
 
-    if (c.consume(']')) {
-      break;
-    }
-    if (!c.consume(',')) {
-      // Some MI outputs omit commas in unexpected places; stop parsing.
-      break;
-    }
-    if (c.consume(']')) {
-      break;
-    }
+MiParser::Value::Iterator MiParser::Value::begin() const {
+  if (!isValid()) {
+    return {};
   }
-
-  return MiParser::Value::makeList(std::move(items));
+  return Iterator(storage_, node().childCount > 0 ? index_ + 1 : node().end);
 }
 
-static MiParser::Value parseValue(Cursor& c, QString* err) {
-  const QChar ch = c.peek();
-  if (ch == '"') {
-    return MiParser::Value::makeConst(parseCString(c, err));
+MiParser::Value::Iterator MiParser::Value::end() const {
+  if (!isValid()) {
+    return {};
   }
-  if (ch == '{') {
-    return parseTuple(c, err);
+  return Iterator(storage_, node().end);
+}
+
+MiParser::Value MiParser::Value::at(qsizetype index) const {
+  if (index < 0 || index >= size()) {
+    return {};
   }
-  if (ch == '[') {
-    return parseList(c, err);
+  Iterator it = begin();
+  for (qsizetype i = 0; i < index; ++i) {
+    ++it;
   }
-  return MiParser::Value::makeConst(parseConst(c));
+  return *it;
 }
 
-static QMap<QString, MiParser::Value> parseResults(Cursor& c, QString* err) {
-  QMap<QString, MiParser::Value> out;
-
-  while (!c.atEnd()) {
-    const QString name = parseName(c);
-    if (name.isEmpty()) {
-      if (err && err->isEmpty()) {
-        *err = QStringLiteral("expected name");
-      }
-      break;
-    }
-    if (!c.consume('=')) {
-      if (err && err->isEmpty()) {
-        *err = QStringLiteral("expected '='");
-      }
-      break;
+MiParser::Value MiParser::Value::value(Key key) const {
+  if (key == Key::Other) {
+    return {};
+  }
+  for (const Value child : *this) {
+    if (child.node().key == key) {
+      return child;
     }
-    out.insert(name, parseValue(c, err));
+  }
+  return {};
+}
 
-    if (!c.consume(',')) {
-      break;
-    }
-    if (c.peek() == '}' || c.peek() == ']') {
-      break;
+MiParser::Value MiParser::Value::value(QByteArrayView name) const {
+  for (const Value child : *this) {
+    if (toStd(child.name()) == toStd(name)) {
+      return child;
     }
   }
+  return {};
+}
 
-  return out;
+// --- MiParser --------------------------------------------------------------
+
+QByteArrayView MiParser::keyName(Key key) {
+  const std::string_view name = kKeyNames[size_t(key)];
+  return QByteArrayView(name.data(), qsizetype(name.size()));
 }
 
-}  // namespace
+MiParser::Key MiParser::internKey(QByteArrayView name) {
+  const std::string_view needle = toStd(name);
+  const auto first = std::begin(kKeyNames) + 1;
+  const auto it = std::lower_bound(first, std::end(kKeyNames), needle);
+  if (it != std::end(kKeyNames) && *it == needle) {
+    return Key(it - std::begin(kKeyNames));
+  }
+  return Key::Other;
+}
 
 QList<MiParser::Record> MiParser::feed(const QByteArray& chunk) {
-  buffer_.append(chunk);
+  // Only the new bytes are searched, so a record arriving in many chunks is
+  // not rescanned on every read.
+  const qsizetype chunkNewline = chunk.lastIndexOf('\n');
+  if (buffer_.isEmpty()) {
+    buffer_ = chunk;
+  } else {
+    buffer_.append(chunk);
+  }
+  if (chunkNewline < 0) {
+    return {};
+  }
+  const qsizetype lastNewline = buffer_.size() - chunk.size() + chunkNewline;
+
+  // Complete lines stay in this block, which records share. When the
+  // buffer was empty it is `chunk` itself and nothing is copied.
+  auto storage = std::make_shared<Storage>();
+  storage->bytes = buffer_;
+  buffer_ = lastNewline + 1 < storage->bytes.size() ? storage->bytes.mid(lastNewline + 1)
+                                                     : QByteArray{};
 
   QList<Record> out;
-  while (true) {
-    const int nl = buffer_.indexOf('\n');
-    if (nl < 0) {
-      break;
-    }
-    QByteArray lineBytes = buffer_.left(nl);
-    buffer_.remove(0, nl + 1);
-    if (!lineBytes.isEmpty() && lineBytes.endsWith('\r')) {
-      lineBytes.chop(1);
+  const char* data = storage->bytes.constData();
+  qsizetype begin = 0;
+  while (begin <= lastNewline) {
+    const char* newline = static_cast<const char*>(
+        std::memchr(data + begin, '\n', size_t(lastNewline + 1 - begin)));
+    qsizetype end = newline - data;
+    const qsizetype next = end + 1;
+    if (end > begin && data[end - 1] == '\r') {
+      --end;
     }
-
-    const QString line = QString::fromLocal8Bit(lineBytes);
-    if (line.isEmpty()) {
-      continue;
+    if (end > begin) {
+      Record record;
+      parseInto(storage, begin, end, &record, nullptr);
+      out.push_back(std::move(record));
     }
-    out.push_back(parseLine(line));
+    begin = next;
   }
   return out;
 }
@@ -269,48 +574,70 @@ void MiParser::reset() {
   buffer_.clear();
 }
 
+MiParser::Record MiParser::parseLine(QByteArrayView line, QString* errorOut) {
+  auto storage = std::make_shared<Storage>();
+  storage->bytes = line.toByteArray();
+  Record record;
+  parseInto(storage, 0, storage->bytes.size(), &record, errorOut);
+  return record;
+}
+
 MiParser::Record MiParser::parseLine(QStringView line, QString* errorOut) {
-  Record r;
-  r.raw = line.toString();
+  auto storage = std::make_shared<Storage>();
+  storage->bytes = line.toLocal8Bit();
+  Record record;
+  parseInto(storage, 0, storage->bytes.size(), &record, errorOut);
+  return record;
+}
 
-  if (line == QStringLiteral("(gdb)")) {
+void MiParser::parseInto(const std::shared_ptr<Storage>& storage,
+                         qsizetype begin,
+                         qsizetype end,
+                         Record* record,
+                         QString* errorOut) {
+  Record& r = *record;
+  r.storage_ = storage;
+  const char* data = storage->bytes.constData();
+  r.raw = QByteArrayView(data + begin, end - begin);
+
+  if (toStd(r.raw) == "(gdb)") {
     r.type = Record::Type::Prompt;
-    return r;
+    return;
   }
 
-  Cursor c(line);
+  Tokenizer c(storage->bytes, begin, end, &storage->nodes);
 
   // Optional token prefix.
   int token = 0;
   bool haveToken = false;
-  while (!c.atEnd() && c.peek().isDigit()) {
+  while (!c.atEnd() && c.peek() >= '0' && c.peek() <= '9') {
     haveToken = true;
-    token = token * 10 + (c.peek().unicode() - '0');
+    token = token * 10 + (c.peek() - '0');
     c.advance();
   }
-
   if (haveToken && !isRecordPrefix(c.peek())) {
-    c.setPos(0);
+    c.setPos(begin);
     haveToken = false;
-    token = 0;
   }
   if (haveToken) {
     r.token = token;
   }
 
-  const QChar prefix = c.peek();
+  const char prefix = c.peek();
   if (!isRecordPrefix(prefix)) {
     r.type = Record::Type::Unknown;
-    return r;
+    return;
   }
   c.advance();
 
   if (prefix == '~' || prefix == '@' || prefix == '&') {
-    QString err;
-    r.streamText = parseCString(c, &err);
-    if (!err.isEmpty() && errorOut) {
-      *errorOut = err;
+    qsizetype textBegin = c.pos();
+    qsizetype textSize = 0;
+    bool escaped = false;
+    if (c.peek() == '"') {
+      c.cstring(&textBegin, &textSize, &escaped);
     }
+    r.streamText = decodeCString(QByteArrayView(data + textBegin, textSize), escaped);
     if (prefix == '~') {
       r.type = Record::Type::Console;
     } else if (prefix == '@') {
@@ -318,14 +645,18 @@ MiParser::Record MiParser::parseLine(QStringView line, QString* errorOut) {
     } else {
       r.type = Record::Type::Log;
     }
-    return r;
+    if (errorOut && !c.error().isEmpty()) {
+      *errorOut = c.error();
+    }
+    return;
   }
 
-  const int klassStart = c.pos();
-  while (!c.atEnd() && c.peek() != ',') {
-    c.advance();
-  }
-  r.klass = line.mid(klassStart, c.pos() - klassStart).toString();
+  const qsizetype klassBegin = c.pos();
+  const char* comma =
+      static_cast<const char*>(std::memchr(data + klassBegin, ',', size_t(end - klassBegin)));
+  const qsizetype klassEnd = comma ? comma - data : end;
+  r.klass = internClass(QByteArrayView(data + klassBegin, klassEnd - klassBegin));
+  c.setPos(klassEnd);
 
   if (prefix == '^') {
     r.type = Record::Type::Result;
@@ -333,18 +664,18 @@ MiParser::Record MiParser::parseLine(QStringView line, QString* errorOut) {
     r.type = Record::Type::ExecAsync;
   } else if (prefix == '+') {
     r.type = Record::Type::StatusAsync;
-  } else if (prefix == '=') {
+  } else {
     r.type = Record::Type::NotifyAsync;
   }
 
+  const qsizetype resultsBegin = c.pos();
+  const qint32 root = c.push(Value::Kind::Tuple, 0, 0);
   if (c.consume(',')) {
-    QString err;
-    r.results = parseResults(c, &err);
-    if (!err.isEmpty() && errorOut) {
-      *errorOut = err;
-    }
+    c.results(root);
+  }
+  c.finish(root, resultsBegin);
+  r.results = Value(storage.get(), root);
+  if (errorOut && !c.error().isEmpty()) {
+    *errorOut = c.error();
   }
-
-  return r;
 }
-
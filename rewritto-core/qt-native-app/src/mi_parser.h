@@ -1,52 +1,157 @@
 #pragma once
 
 #include <QByteArray>
+#include <QByteArrayView>
 #include <QList>
-#include <QMap>
 #include <QString>
 #include <QStringView>
-#include <QPair>
 #include <QVector>
-#include <utility>
 
+#include <iterator>
+#include <memory>
+
+// GDB/MI output parser.
+//
+// Lines are tokenized where they lie: a record keeps a reference to the
+// chunk it was read from, and its values are views into those bytes. C
+// strings are unescaped and decoded only when asked for. Tuples and lists
+// are stored flat, as one node array shared by every record of a chunk, and
+// the result names gdb uses most are interned so lookups compare integers.
 class MiParser final {
+  struct Node;
+  struct Storage;
+  class Tokenizer;
+
  public:
-  struct Value;
-  struct Record;
+  // Interned result names, in byte order of their text.
+  enum class Key : quint8 {
+    Other,  // not interned; look these up by name
+    Addr,
+    Args,
+    Begin,
+    Bkpt,
+    Bkptno,
+    Changelist,
+    Children,
+    Cond,
+    Contents,
+    Core,
+    CurrentThreadId,
+    Data,
+    Details,
+    Disp,
+    Displayhint,
+    Dynamic,
+    Enabled,
+    End,
+    ExitCode,
+    Exp,
+    File,
+    Frame,
+    Fullname,
+    Func,
+    HasMore,
+    Id,
+    InScope,
+    Level,
+    Line,
+    Locals,
+    Memory,
+    Msg,
+    Name,
+    NewNumChildren,
+    NewType,
+    Number,
+    Numchild,
+    Offset,
+    OriginalLocation,
+    Reason,
+    SignalName,
+    Stack,
+    State,
+    StoppedThreads,
+    TargetId,
+    ThreadId,
+    Threads,
+    Times,
+    Type,
+    TypeChanged,
+    Value,
+    Variables,
+    What,
+  };
 
-  struct Value {
-    enum class Kind {
+  // A handle to one value of a record. Cheap to copy; valid as long as the
+  // record it came from (or a copy of it) is alive.
+  class Value final {
+   public:
+    enum class Kind : quint8 {
       Const,
       Tuple,
       List,
     };
 
-    Kind kind = Kind::Const;
-    QString constValue;
-    QMap<QString, Value> tuple;
-    QVector<QPair<QString, Value>> list;  // empty key => value, non-empty => name=value
-
-    static Value makeConst(QString v) {
-      Value out;
-      out.kind = Kind::Const;
-      out.constValue = std::move(v);
-      return out;
-    }
-    static Value makeTuple(QMap<QString, Value> m) {
-      Value out;
-      out.kind = Kind::Tuple;
-      out.tuple = std::move(m);
-      return out;
-    }
-    static Value makeList(QVector<QPair<QString, Value>> v) {
-      Value out;
-      out.kind = Kind::List;
-      out.list = std::move(v);
-      return out;
-    }
+    class Iterator final {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Value;
+      using difference_type = qptrdiff;
+      using pointer = void;
+      using reference = Value;
+
+      Iterator() = default;
+      Value operator*() const { return Value(storage_, index_); }
+      Iterator& operator++();
+      Iterator operator++(int) {
+        Iterator old = *this;
+        ++*this;
+        return old;
+      }
+      bool operator==(const Iterator& other) const { return index_ == other.index_; }
+      bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+
+     private:
+      friend class Value;
+      Iterator(const Storage* storage, qint32 index) : storage_(storage), index_(index) {}
+      const Storage* storage_ = nullptr;
+      qint32 index_ = -1;
+    };
+
+    Value() = default;
+
+    bool isValid() const { return storage_ != nullptr; }
+    Kind kind() const;
+    // The name this value has in its tuple or list; empty for bare items.
+    QByteArrayView name() const;
+    Key key() const;
+
+    // Const values: the text as written (escapes included), decoded text,
+    // or a number. Invalid values read as empty.
+    QByteArrayView bytes() const;
+    QString toString() const;
+    int toInt(bool* ok = nullptr) const;
+
+    // Tuples and lists. Children are visited in order by range-for; at()
+    // walks from the first child.
+    qsizetype size() const;
+    bool isEmpty() const { return size() == 0; }
+    Value at(qsizetype index) const;
+    Value value(Key key) const;
+    Value value(QByteArrayView name) const;
+    bool contains(Key key) const { return value(key).isValid(); }
+    Iterator begin() const;
+    Iterator end() const;
+
+   private:
+    friend class MiParser;
+    Value(const Storage* storage, qint32 index) : storage_(storage), index_(index) {}
+    const Node& node() const;
+
+    const Storage* storage_ = nullptr;
+    qint32 index_ = -1;
   };
 
-  struct Record {
+  struct Record final {
     enum class Type {
       Unknown,
       Prompt,
@@ -61,17 +166,32 @@ class MiParser final {
 
     Type type = Type::Unknown;
     int token = -1;
-    QString klass;
-    QMap<QString, Value> results;
-    QString streamText;
-    QString raw;
+    QString klass;       // shared, not allocated, for the usual classes
+    Value results;       // a tuple for result and async records
+    QString streamText;  // decoded payload of stream records
+    QByteArrayView raw;  // the whole line
+
+    QString rawText() const { return QString::fromLocal8Bit(raw); }
+
+   private:
+    friend class MiParser;
+    std::shared_ptr<const Storage> storage_;
   };
 
   QList<Record> feed(const QByteArray& chunk);
   void reset();
 
+  static Record parseLine(QByteArrayView line, QString* errorOut = nullptr);
   static Record parseLine(QStringView line, QString* errorOut = nullptr);
+  static QByteArrayView keyName(Key key);
+  static Key internKey(QByteArrayView name);
 
  private:
   QByteArray buffer_;
+
+  static void parseInto(const std::shared_ptr<Storage>& storage,
+                        qsizetype begin,
+                        qsizetype end,
+                        Record* record,
+                        QString* errorOut);
 };
@@ -11,10 +11,20 @@
 #include <QPlainTextEdit>
 #include <QStandardPaths>
 #include <QStyle>
+#include <QTextBlockFormat>
+#include <QTextCharFormat>
 #include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
 
+namespace {
+
+constexpr int kFlushIntervalMs = 50;
+
+}  // namespace
+
 OutputWidget::OutputWidget(QWidget* parent) : QWidget(parent) {
   auto iconFor = [this](const QString& themeName, QStyle::StandardPixmap fallback) {
     QIcon icon = QIcon::fromTheme(themeName);
@@ -42,9 +52,17 @@ OutputWidget::OutputWidget(QWidget* parent) : QWidget(parent) {
   // Prevent the output view from growing without bound (large builds can produce
   // tens of thousands of lines and freeze the UI).
   output_->setMaximumBlockCount(20000);
+  // Nothing in a read-only log is undone; keeping history only costs memory.
+  output_->setUndoRedoEnabled(false);
+
+  flushTimer_ = new QTimer(this);
+  flushTimer_->setSingleShot(true);
+  flushTimer_->setInterval(kFlushIntervalMs);
+  connect(flushTimer_, &QTimer::timeout, this, [this] { flushPending(); });
 
   connect(clearAction, &QAction::triggered, this, [this] { clear(); });
   connect(copyAction, &QAction::triggered, this, [this] {
+    flushPending();
     if (auto* cb = QGuiApplication::clipboard()) {
       cb->setText(output_ ? output_->toPlainText() : QString{});
     }
@@ -66,6 +84,7 @@ OutputWidget::OutputWidget(QWidget* parent) : QWidget(parent) {
       QMessageBox::warning(this, tr("Save Failed"), tr("Could not write file."));
       return;
     }
+    flushPending();
     const QString text = output_ ? output_->toPlainText() : QString{};
     const QByteArray bytes = text.toUtf8();
     if (f.write(bytes) != bytes.size()) {
@@ -81,21 +100,66 @@ OutputWidget::OutputWidget(QWidget* parent) : QWidget(parent) {
 }
 
 void OutputWidget::appendText(const QString& text) {
+  flushPending();
   output_->moveCursor(QTextCursor::End);
   output_->insertPlainText(text);
   output_->moveCursor(QTextCursor::End);
 }
 
 void OutputWidget::appendHtml(const QString& html) {
+  flushPending();
   output_->moveCursor(QTextCursor::End);
   output_->appendHtml(html);
   output_->moveCursor(QTextCursor::End);
 }
 
 void OutputWidget::appendLine(const QString& line) {
+  flushPending();
   output_->appendPlainText(line);
 }
 
+void OutputWidget::appendStyledLine(const QString& line, const QColor& color, bool bold) {
+  // Lines the block limit would trim right away are never inserted.
+  const int maxBlocks = output_->maximumBlockCount();
+  if (maxBlocks > 0 && pending_.size() >= maxBlocks) {
+    pending_.removeFirst();
+  }
+  pending_.append({line, color, bold});
+  if (!flushTimer_->isActive()) {
+    flushTimer_->start();
+  }
+}
+
+void OutputWidget::flushPending() {
+  flushTimer_->stop();
+  if (pending_.isEmpty()) {
+    return;
+  }
+
+  QTextDocument* doc = output_->document();
+  QTextCursor cursor(doc);
+  cursor.beginEditBlock();
+  cursor.movePosition(QTextCursor::End);
+  for (const PendingLine& line : std::as_const(pending_)) {
+    QTextCharFormat format;
+    if (line.color.isValid()) {
+      format.setForeground(line.color);
+    }
+    if (line.bold) {
+      format.setFontWeight(QFont::Bold);
+    }
+    if (!doc->isEmpty()) {
+      cursor.insertBlock(QTextBlockFormat(), format);
+    }
+    cursor.insertText(line.text, format);
+  }
+  cursor.endEditBlock();
+  pending_.clear();
+  output_->moveCursor(QTextCursor::End);
+}
+
 void OutputWidget::clear() {
+  pending_.clear();
+  flushTimer_->stop();
   output_->clear();
 }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <QColor>
+#include <QList>
 #include <QWidget>
 
 class QPlainTextEdit;
+class QTimer;
 
 class OutputWidget final : public QWidget {
   Q_OBJECT
@@ -13,8 +16,22 @@ class OutputWidget final : public QWidget {
   void appendText(const QString& text);
   void appendHtml(const QString& html);
   void appendLine(const QString& line);
+  // Queues a line in the given color (invalid: default) for the next batch.
+  // Batches are appended as plain text in one edit, a few times a second,
+  // so a build that prints thousands of lines per second does not lay the
+  // view out for each one. The other appends flush the queue first.
+  void appendStyledLine(const QString& line, const QColor& color = {}, bool bold = false);
+  void flushPending();
   void clear();
 
  private:
+  struct PendingLine final {
+    QString text;
+    QColor color;
+    bool bold = false;
+  };
+
   QPlainTextEdit* output_ = nullptr;
+  QList<PendingLine> pending_;
+  QTimer* flushTimer_ = nullptr;
 };
@@ -0,0 +1,688 @@
+#include "platform_catalog.h"
+
+#include "arduino_cli.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVersionNumber>
+
+#include <algorithm>
+
+namespace {
+
+constexpr quint32 kCacheMagic = 0x52575043;  // "RWPC"
+constexpr qint32 kCacheFormat = 1;
+
+constexpr int kWeightName = 8;
+constexpr int kWeightMaintainer = 4;
+constexpr int kWeightBoard = 2;
+
+// An installed core: <data>/packages/<vendor>/hardware/<arch>/<version> or
+// <sketchbook>/hardware/<vendor>/<arch>.
+struct InstalledCore final {
+  QString id;
+  QString version;  // empty for sketchbook cores; platform.txt has it
+  QString dir;
+};
+
+struct Inputs final {
+  QStringList indexFiles;
+  QVector<InstalledCore> cores;
+};
+
+bool versionNewer(const QString& a, const QString& b) {
+  const QVersionNumber av = QVersionNumber::fromString(a);
+  const QVersionNumber bv = QVersionNumber::fromString(b);
+  if (!av.isNull() && !bv.isNull()) {
+    return QVersionNumber::compare(av, bv) > 0;
+  }
+  if (av.isNull() != bv.isNull()) {
+    return !av.isNull();
+  }
+  return a > b;
+}
+
+QStringList subdirectories(const QString& path) {
+  return QDir(path).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+}
+
+Inputs collectInputs(const QString& dataDir, const QString& userDir) {
+  Inputs inputs;
+  const QDir data(dataDir);
+  for (const QFileInfo& fi :
+       data.entryInfoList({QStringLiteral("package_index.json"),
+                           QStringLiteral("package_index_*.json")},
+                          QDir::Files, QDir::Name)) {
+    inputs.indexFiles << fi.absoluteFilePath();
+  }
+
+  // arduino-cli keeps one version per core; if a stale one is left behind
+  // the newest wins, as it does for the CLI.
+  const QString packages = data.filePath(QStringLiteral("packages"));
+  for (const QString& vendor : subdirectories(packages)) {
+    const QString hardware = packages + QLatin1Char('/') + vendor + QStringLiteral("/hardware");
+    for (const QString& arch : subdirectories(hardware)) {
+      const QString archDir = hardware + QLatin1Char('/') + arch;
+      QString best;
+      for (const QString& version : subdirectories(archDir)) {
+        if (QFileInfo::exists(archDir + QLatin1Char('/') + version + QStringLiteral("/boards.txt")) &&
+            (best.isEmpty() || versionNewer(version, best))) {
+          best = version;
+        }
+      }
+      if (!best.isEmpty()) {
+        inputs.cores.push_back({vendor + QLatin1Char(':') + arch, best,
+                                archDir + QLatin1Char('/') + best});
+      }
+    }
+  }
+
+  if (!userDir.isEmpty()) {
+    const QString hardware = QDir(userDir).filePath(QStringLiteral("hardware"));
+    for (const QString& vendor : subdirectories(hardware)) {
+      const QString vendorDir = hardware + QLatin1Char('/') + vendor;
+      for (const QString& arch : subdirectories(vendorDir)) {
+        const QString archDir = vendorDir + QLatin1Char('/') + arch;
+        if (QFileInfo::exists(archDir + QStringLiteral("/boards.txt"))) {
+          inputs.cores.push_back({vendor + QLatin1Char(':') + arch, QString{}, archDir});
+        }
+      }
+    }
+  }
+  return inputs;
+}
+
+const QStringList& coreFiles() {
+  static const QStringList files = {QStringLiteral("boards.txt"),
+                                    QStringLiteral("boards.local.txt"),
+                                    QStringLiteral("platform.txt")};
+  return files;
+}
+
+void hashFile(QCryptographicHash* hash, const QString& path) {
+  hash->addData(path.toUtf8());
+  QFile f(path);
+  if (f.open(QIODevice::ReadOnly)) {
+    hash->addData(&f);
+  }
+  hash->addData(QByteArray(1, '\0'));
+}
+
+// key=value lines of a boards.txt / platform.txt, in file order.
+QVector<QPair<QString, QString>> readProperties(const QString& path) {
+  QVector<QPair<QString, QString>> out;
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return out;
+  }
+  while (!f.atEnd()) {
+    const QString line = QString::fromUtf8(f.readLine()).trimmed();
+    if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+      continue;
+    }
+    const qsizetype eq = line.indexOf(QLatin1Char('='));
+    if (eq > 0) {
+      out.push_back({line.left(eq).trimmed(), line.mid(eq + 1).trimmed()});
+    }
+  }
+  return out;
+}
+
+QVector<PlatformCatalog::Board> readBoards(const QString& coreDir, const QString& id) {
+  QStringList order;
+  QHash<QString, QString> names;
+  QHash<QString, bool> hidden;
+  for (const QString& file : {QStringLiteral("boards.txt"), QStringLiteral("boards.local.txt")}) {
+    for (const auto& [key, value] : readProperties(coreDir + QLatin1Char('/') + file)) {
+      const qsizetype dot = key.indexOf(QLatin1Char('.'));
+      if (dot <= 0) {
+        continue;
+      }
+      const QString property = key.mid(dot + 1);
+      const QString board = key.left(dot);
+      if (property == QStringLiteral("name")) {
+        if (!names.contains(board)) {
+          order << board;
+        }
+        names.insert(board, value);
+      } else if (property == QStringLiteral("hide")) {
+        hidden.insert(board, true);
+      }
+    }
+  }
+
+  QVector<PlatformCatalog::Board> boards;
+  for (const QString& board : order) {
+    if (!hidden.value(board) && !names.value(board).isEmpty()) {
+      boards.push_back({names.value(board), id + QLatin1Char(':') + board});
+    }
+  }
+  return boards;
+}
+
+void appendWords(QStringView text, int weight, QVector<QPair<QString, int>>* out) {
+  qsizetype i = 0;
+  while (i < text.size()) {
+    while (i < text.size() && !text.at(i).isLetterOrNumber()) {
+      ++i;
+    }
+    const qsizetype start = i;
+    while (i < text.size() && text.at(i).isLetterOrNumber()) {
+      ++i;
+    }
+    if (start < i) {
+      out->push_back({text.mid(start, i - start).toString().toLower(), weight});
+    }
+  }
+}
+
+void writeStrings(QDataStream& out, const QStringList& list) {
+  out << qint32(list.size());
+  for (const QString& s : list) {
+    out << s;
+  }
+}
+
+void readStrings(QDataStream& in, QStringList* list) {
+  qint32 n = 0;
+  in >> n;
+  for (qint32 i = 0; i < n && in.status() == QDataStream::Ok; ++i) {
+    QString s;
+    in >> s;
+    list->push_back(s);
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<const PlatformCatalog> PlatformCatalog::load(
+    const QString& dataDir,
+    const QString& userDir,
+    const QString& cachePath,
+    QString* error,
+    const std::shared_ptr<const PlatformCatalog>& current) {
+  if (dataDir.isEmpty() || !QFileInfo(dataDir).isDir()) {
+    if (error) {
+      *error = QStringLiteral("Arduino data directory not found: %1").arg(dataDir);
+    }
+    return nullptr;
+  }
+
+  const QByteArray key = inputKey(dataDir, userDir);
+  if (current && current->key_ == key) {
+    return current;
+  }
+  if (!cachePath.isEmpty()) {
+    if (std::shared_ptr<PlatformCatalog> cached = readCache(cachePath, key)) {
+      cached->buildIndex();
+      return cached;
+    }
+  }
+
+  std::shared_ptr<PlatformCatalog> catalog = parse(dataDir, userDir, error);
+  if (!catalog) {
+    return nullptr;
+  }
+  catalog->key_ = key;
+  if (!cachePath.isEmpty()) {
+    catalog->writeCache(cachePath);
+  }
+  catalog->buildIndex();
+  return catalog;
+}
+
+QString PlatformCatalog::defaultCachePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+      .filePath(QStringLiteral("platform-catalog.bin"));
+}
+
+QByteArray PlatformCatalog::inputKey(const QString& dataDir, const QString& userDir) {
+  const Inputs inputs = collectInputs(dataDir, userDir);
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray::number(kCacheFormat));
+  for (const QString& path : inputs.indexFiles) {
+    hashFile(&hash, path);
+  }
+  for (const InstalledCore& core : inputs.cores) {
+    for (const QString& file : coreFiles()) {
+      hashFile(&hash, core.dir + QLatin1Char('/') + file);
+    }
+  }
+  return hash.result();
+}
+
+std::shared_ptr<PlatformCatalog> PlatformCatalog::readCache(const QString& cachePath,
+                                                            const QByteArray& key) {
+  QFile f(cachePath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return nullptr;
+  }
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  qint32 format = 0;
+  QByteArray cachedKey;
+  in >> magic >> format >> cachedKey;
+  if (magic != kCacheMagic || format != kCacheFormat || cachedKey != key) {
+    return nullptr;
+  }
+
+  auto catalog = std::make_shared<PlatformCatalog>();
+  qint32 platformCount = 0;
+  in >> platformCount;
+  for (qint32 p = 0; p < platformCount && in.status() == QDataStream::Ok; ++p) {
+    Platform platform;
+    in >> platform.id >> platform.maintainer >> platform.website >> platform.email >>
+        platform.installedVersion >> platform.installedName;
+    qint32 releaseCount = 0;
+    in >> releaseCount;
+    for (qint32 r = 0; r < releaseCount && in.status() == QDataStream::Ok; ++r) {
+      Release release;
+      in >> release.version >> release.name >> release.category;
+      readStrings(in, &release.boards);
+      platform.releases.push_back(std::move(release));
+    }
+    qint32 boardCount = 0;
+    in >> boardCount;
+    for (qint32 b = 0; b < boardCount && in.status() == QDataStream::Ok; ++b) {
+      Board board;
+      in >> board.name >> board.fqbn;
+      platform.boards.push_back(std::move(board));
+    }
+    catalog->platforms_.push_back(std::move(platform));
+  }
+  if (in.status() != QDataStream::Ok) {
+    return nullptr;
+  }
+  catalog->key_ = key;
+  catalog->fromCache_ = true;
+  return catalog;
+}
+
+void PlatformCatalog::writeCache(const QString& cachePath) const {
+  QDir().mkpath(QFileInfo(cachePath).absolutePath());
+  QSaveFile f(cachePath);
+  if (!f.open(QIODevice::WriteOnly)) {
+    return;
+  }
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << kCacheMagic << kCacheFormat << key_;
+  out << qint32(platforms_.size());
+  for (const Platform& platform : platforms_) {
+    out << platform.id << platform.maintainer << platform.website << platform.email
+        << platform.installedVersion << platform.installedName;
+    out << qint32(platform.releases.size());
+    for (const Release& release : platform.releases) {
+      out << release.version << release.name << release.category;
+      writeStrings(out, release.boards);
+    }
+    out << qint32(platform.boards.size());
+    for (const Board& board : platform.boards) {
+      out << board.name << board.fqbn;
+    }
+  }
+  if (out.status() == QDataStream::Ok) {
+    f.commit();
+  }
+}
+
+std::shared_ptr<PlatformCatalog> PlatformCatalog::parse(const QString& dataDir,
+                                                        const QString& userDir,
+                                                        QString* error) {
+  const Inputs inputs = collectInputs(dataDir, userDir);
+  auto catalog = std::make_shared<PlatformCatalog>();
+  QHash<QString, int> idToIndex;
+  auto platformFor = [&catalog, &idToIndex](const QString& id) -> Platform& {
+    auto it = idToIndex.constFind(id);
+    if (it == idToIndex.constEnd()) {
+      it = idToIndex.insert(id, static_cast<int>(catalog->platforms_.size()));
+      Platform platform;
+      platform.id = id;
+      catalog->platforms_.push_back(std::move(platform));
+    }
+    return catalog->platforms_[it.value()];
+  };
+
+  for (const QString& path : inputs.indexFiles) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+      if (error) {
+        *error = QStringLiteral("%1: %2").arg(path, f.errorString());
+      }
+      return nullptr;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &parseError);
+    if (!doc.isObject()) {
+      if (error) {
+        *error = QStringLiteral("%1: %2").arg(
+            path, parseError.error != QJsonParseError::NoError
+                      ? parseError.errorString()
+                      : QStringLiteral("package index is not a JSON object"));
+      }
+      return nullptr;
+    }
+
+    for (const QJsonValue& packageValue : doc.object().value("packages").toArray()) {
+      const QJsonObject package = packageValue.toObject();
+      const QString vendor = package.value("name").toString().trimmed();
+      if (vendor.isEmpty()) {
+        continue;
+      }
+      for (const QJsonValue& platformValue : package.value("platforms").toArray()) {
+        const QJsonObject o = platformValue.toObject();
+        const QString arch = o.value("architecture").toString().trimmed();
+        const QString version = o.value("version").toString().trimmed();
+        if (arch.isEmpty() || version.isEmpty()) {
+          continue;
+        }
+        Platform& platform = platformFor(vendor + QLatin1Char(':') + arch);
+        if (platform.maintainer.isEmpty()) {
+          platform.maintainer = package.value("maintainer").toString().trimmed();
+          platform.website = package.value("websiteURL").toString().trimmed();
+          platform.email = package.value("email").toString().trimmed();
+        }
+        // The same release listed by two indexes: the first one wins.
+        const bool known = std::any_of(platform.releases.cbegin(), platform.releases.cend(),
+                                       [&version](const Release& r) { return r.version == version; });
+        if (known) {
+          continue;
+        }
+        Release release;
+        release.version = version;
+        release.name = o.value("name").toString().trimmed();
+        release.category = o.value("category").toString().trimmed();
+        for (const QJsonValue& board : o.value("boards").toArray()) {
+          const QString name = board.toObject().value("name").toString().trimmed();
+          if (!name.isEmpty()) {
+            release.boards << name;
+          }
+        }
+        platform.releases.push_back(std::move(release));
+      }
+    }
+  }
+
+  for (const InstalledCore& core : inputs.cores) {
+    Platform& platform = platformFor(core.id);
+    QString version = core.version;
+    for (const auto& [key, value] : readProperties(core.dir + QStringLiteral("/platform.txt"))) {
+      if (key == QStringLiteral("name")) {
+        platform.installedName = value;
+      } else if (key == QStringLiteral("version") && version.isEmpty()) {
+        version = value;
+      }
+    }
+    platform.installedVersion = version;
+    platform.boards = readBoards(core.dir, core.id);
+  }
+
+  for (Platform& platform : catalog->platforms_) {
+    std::stable_sort(platform.releases.begin(), platform.releases.end(),
+                     [](const Release& a, const Release& b) {
+                       return versionNewer(a.version, b.version);
+                     });
+  }
+  std::sort(catalog->platforms_.begin(), catalog->platforms_.end(),
+            [](const Platform& a, const Platform& b) { return a.id < b.id; });
+  return catalog;
+}
+
+void PlatformCatalog::buildIndex() {
+  tokens_.clear();
+  tokens_.reserve(platforms_.size());
+  QVector<QPair<QString, int>> words;
+  for (int id = 0; id < platforms_.size(); ++id) {
+    const Platform& platform = platforms_.at(id);
+    words.clear();
+    appendWords(platform.id, kWeightName, &words);
+    appendWords(platformName(id), kWeightName, &words);
+    appendWords(platform.maintainer, kWeightMaintainer, &words);
+    if (!platform.releases.isEmpty()) {
+      for (const QString& board : platform.releases.first().boards) {
+        appendWords(board, kWeightBoard, &words);
+      }
+    }
+    for (const Board& board : platform.boards) {
+      appendWords(board.name, kWeightBoard, &words);
+    }
+
+    std::sort(words.begin(), words.end(), [](const auto& a, const auto& b) {
+      return a.first != b.first ? a.first < b.first : a.second > b.second;
+    });
+    QVector<Token> tokens;
+    for (const auto& [word, weight] : words) {
+      if (tokens.isEmpty() || tokens.last().word != word) {
+        tokens.push_back({word, weight});
+      }
+    }
+    tokens_.push_back(std::move(tokens));
+  }
+}
+
+bool PlatformCatalog::loadedFromCache() const {
+  return fromCache_;
+}
+
+int PlatformCatalog::platformCount() const {
+  return static_cast<int>(platforms_.size());
+}
+
+const PlatformCatalog::Platform& PlatformCatalog::platform(int id) const {
+  return platforms_.at(id);
+}
+
+int PlatformCatalog::indexOf(const QString& platformId) const {
+  auto it = std::lower_bound(platforms_.cbegin(), platforms_.cend(), platformId,
+                             [](const Platform& p, const QString& id) { return p.id < id; });
+  if (it == platforms_.cend() || it->id != platformId) {
+    return -1;
+  }
+  return static_cast<int>(it - platforms_.cbegin());
+}
+
+QString PlatformCatalog::platformName(int id) const {
+  const Platform& platform = platforms_.at(id);
+  for (const Release& r : platform.releases) {
+    if (r.version == platform.installedVersion && !r.name.isEmpty()) {
+      return r.name;
+    }
+  }
+  if (!platform.installedName.isEmpty()) {
+    return platform.installedName;
+  }
+  if (!platform.releases.isEmpty() && !platform.releases.first().name.isEmpty()) {
+    return platform.releases.first().name;
+  }
+  return platform.id;
+}
+
+QVector<int> PlatformCatalog::search(const QString& query) const {
+  QVector<QPair<QString, int>> terms;
+  appendWords(query, 0, &terms);
+
+  QVector<QPair<int, int>> scored;  // score, id
+  for (int id = 0; id < platforms_.size(); ++id) {
+    const QVector<Token>& tokens = tokens_.at(id);
+    int score = 0;
+    bool all = true;
+    for (const auto& term : terms) {
+      const QString& t = term.first;
+      int best = 0;
+      auto it = std::lower_bound(tokens.cbegin(), tokens.cend(), t,
+                                 [](const Token& token, const QString& w) {
+                                   return token.word < w;
+                                 });
+      for (; it != tokens.cend() && it->word.startsWith(t); ++it) {
+        best = std::max(best, it->weight * (it->word.size() == t.size() ? 2 : 1));
+      }
+      if (best == 0) {
+        all = false;
+        break;
+      }
+      score += best;
+    }
+    if (all) {
+      scored.push_back({score, id});
+    }
+  }
+
+  std::stable_sort(scored.begin(), scored.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+  QVector<int> ids;
+  ids.reserve(scored.size());
+  for (const auto& s : scored) {
+    ids.push_back(s.second);
+  }
+  return ids;
+}
+
+QJsonObject PlatformCatalog::searchJson(int id) const {
+  const Platform& platform = platforms_.at(id);
+  QJsonObject o;
+  o.insert("id", platform.id);
+  o.insert("maintainer", platform.maintainer);
+  o.insert("website", platform.website);
+  o.insert("email", platform.email);
+  o.insert("indexed", !platform.releases.isEmpty());
+  if (!platform.installedVersion.isEmpty()) {
+    o.insert("installed_version", platform.installedVersion);
+  }
+  o.insert("latest_version", platform.releases.isEmpty() ? platform.installedVersion
+                                                          : platform.releases.first().version);
+
+  QJsonObject releases;
+  for (const Release& r : platform.releases) {
+    QJsonObject rel;
+    rel.insert("name", r.name);
+    rel.insert("version", r.version);
+    if (!r.category.isEmpty()) {
+      rel.insert("types", QJsonArray{r.category});
+    }
+    QJsonArray boards;
+    for (const QString& board : r.boards) {
+      boards.append(QJsonObject{{"name", board}});
+    }
+    rel.insert("boards", boards);
+    if (r.version == platform.installedVersion) {
+      rel.insert("installed", true);
+    }
+    releases.insert(r.version, rel);
+  }
+  if (!platform.installedVersion.isEmpty() && !releases.contains(platform.installedVersion)) {
+    QJsonArray boards;
+    for (const Board& board : platform.boards) {
+      boards.append(QJsonObject{{"name", board.name}, {"fqbn", board.fqbn}});
+    }
+    releases.insert(platform.installedVersion,
+                    QJsonObject{{"name", platformName(id)},
+                                {"version", platform.installedVersion},
+                                {"boards", boards},
+                                {"installed", true}});
+  }
+  o.insert("releases", releases);
+  return o;
+}
+
+PlatformCatalogService::PlatformCatalogService(ArduinoCli* arduinoCli, QObject* parent)
+    : QObject(parent), arduinoCli_(arduinoCli) {}
+
+PlatformCatalogService::~PlatformCatalogService() {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+}
+
+void PlatformCatalogService::setDirectories(QString dataDir, QString userDir) {
+  dataDir_ = std::move(dataDir);
+  userDir_ = std::move(userDir);
+  ++generation_;
+  catalog_.reset();
+}
+
+void PlatformCatalogService::setCachePath(QString path) {
+  cachePath_ = std::move(path);
+  ++generation_;
+  catalog_.reset();
+}
+
+std::shared_ptr<const PlatformCatalog> PlatformCatalogService::catalog() const {
+  return catalog_;
+}
+
+bool PlatformCatalogService::isLoading() const {
+  return thread_ != nullptr;
+}
+
+QString PlatformCatalogService::errorString() const {
+  return lastError_;
+}
+
+void PlatformCatalogService::refresh() {
+  if (thread_) {
+    pendingRefresh_ = true;
+    return;
+  }
+
+  const QString dataDir =
+      dataDir_.isEmpty() && arduinoCli_ ? arduinoCli_->arduinoDataDir() : dataDir_;
+  const QString userDir =
+      dataDir_.isEmpty() && arduinoCli_ ? arduinoCli_->arduinoUserDir() : userDir_;
+  const QString cachePath =
+      cachePath_.isEmpty() ? PlatformCatalog::defaultCachePath() : cachePath_;
+  const std::shared_ptr<const PlatformCatalog> current = catalog_;
+  const quint64 generation = generation_;
+  thread_ = QThread::create([this, generation, dataDir, userDir, cachePath, current] {
+    QString error;
+    std::shared_ptr<const PlatformCatalog> catalog =
+        PlatformCatalog::load(dataDir, userDir, cachePath, &error, current);
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, catalog, error] { finishLoad(generation, catalog, error); },
+        Qt::QueuedConnection);
+  });
+  thread_->start();
+}
+
+void PlatformCatalogService::finishLoad(quint64 generation,
+                                        std::shared_ptr<const PlatformCatalog> catalog,
+                                        QString error) {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+
+  if (generation == generation_) {
+    // State first: handlers ask errorString() and catalog().
+    const bool newError = !catalog && error != lastError_;
+    lastError_ = catalog ? QString{} : error;
+    const bool replaced = catalog != catalog_;
+    if (replaced) {
+      catalog_ = std::move(catalog);
+    }
+    if (newError) {
+      emit loadFailed(lastError_);
+    }
+    if (replaced) {
+      emit catalogChanged();
+    }
+  }
+
+  if (pendingRefresh_ || generation != generation_) {
+    pendingRefresh_ = false;
+    refresh();
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+class ArduinoCli;
+class QThread;
+
+// In-memory, read-only view of the platforms arduino-cli knows about: every
+// package_index*.json in the data directory plus the installed cores (their
+// boards.txt) under <data>/packages and <sketchbook>/hardware. Replaces
+// `core search` and `board listall` for the Boards Manager and the board
+// pickers. The parsed catalog is cached in a binary file keyed by a hash of
+// all those inputs, so a restart with unchanged indexes skips the JSON.
+class PlatformCatalog final {
+ public:
+  struct Board final {
+    QString name;
+    QString fqbn;
+  };
+
+  struct Release final {
+    QString version;
+    QString name;
+    QString category;  // reported as the release's "types"
+    QStringList boards;  // as listed by the index
+  };
+
+  struct Platform final {
+    QString id;  // vendor:architecture
+    QString maintainer;
+    QString website;
+    QString email;
+    QString installedVersion;
+    QString installedName;  // platform.txt name of the installed core
+    QVector<Release> releases;  // newest first; empty for unindexed cores
+    QVector<Board> boards;      // visible boards of the installed core
+  };
+
+  // Returns `current` itself when the inputs still hash to its key,
+  // otherwise the cached or freshly parsed catalog (rewriting the cache).
+  // Returns nullptr and sets `error` when the data directory is missing or
+  // an index cannot be parsed; callers then fall back to the CLI.
+  static std::shared_ptr<const PlatformCatalog> load(
+      const QString& dataDir,
+      const QString& userDir,
+      const QString& cachePath,
+      QString* error = nullptr,
+      const std::shared_ptr<const PlatformCatalog>& current = nullptr);
+  static QString defaultCachePath();
+
+  bool loadedFromCache() const;
+  int platformCount() const;
+  const Platform& platform(int id) const;
+  // Id of the platform "vendor:arch", or -1.
+  int indexOf(const QString& platformId) const;
+  // Installed release name, falling back to the latest indexed one.
+  QString platformName(int id) const;
+
+  // Ids of platforms where every query word prefixes a word of the id,
+  // name, maintainer or board names, best match first. An empty query
+  // returns every platform by id.
+  QVector<int> search(const QString& query) const;
+
+  // The platform in the shape `arduino-cli core search --json` reports it.
+  QJsonObject searchJson(int id) const;
+
+ private:
+  struct Token final {
+    QString word;
+    int weight = 0;
+  };
+
+  QByteArray key_;
+  bool fromCache_ = false;
+  QVector<Platform> platforms_;  // sorted by id
+  QVector<QVector<Token>> tokens_;  // per platform, sorted by word
+
+  static QByteArray inputKey(const QString& dataDir, const QString& userDir);
+  static std::shared_ptr<PlatformCatalog> readCache(const QString& cachePath,
+                                                    const QByteArray& key);
+  static std::shared_ptr<PlatformCatalog> parse(const QString& dataDir,
+                                                const QString& userDir,
+                                                QString* error);
+  void writeCache(const QString& cachePath) const;
+  void buildIndex();
+};
+
+// Owns the shared catalog and reloads it on a worker thread. Consumers use
+// catalog() when it is set and listen for catalogChanged().
+class PlatformCatalogService final : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit PlatformCatalogService(ArduinoCli* arduinoCli, QObject* parent = nullptr);
+  ~PlatformCatalogService() override;
+
+  // Overrides the directories read from arduino-cli's config, and the cache
+  // file location. Used by tests.
+  void setDirectories(QString dataDir, QString userDir);
+  void setCachePath(QString path);
+
+  std::shared_ptr<const PlatformCatalog> catalog() const;
+  bool isLoading() const;
+  // Why the last load failed; empty once one succeeds.
+  QString errorString() const;
+
+ public slots:
+  // Re-checks the inputs in the background; emits catalogChanged() when the
+  // catalog was replaced (or dropped because it could not be loaded).
+  void refresh();
+
+ signals:
+  void catalogChanged();
+  // Reported once per distinct error, not on every refresh.
+  void loadFailed(QString error);
+
+ private:
+  ArduinoCli* arduinoCli_ = nullptr;
+  QString dataDir_;
+  QString userDir_;
+  QString cachePath_;
+  std::shared_ptr<const PlatformCatalog> catalog_;
+  QString lastError_;
+  QThread* thread_ = nullptr;
+  quint64 generation_ = 0;
+  bool pendingRefresh_ = false;
+
+  void finishLoad(quint64 generation,
+                  std::shared_ptr<const PlatformCatalog> catalog,
+                  QString error);
+};
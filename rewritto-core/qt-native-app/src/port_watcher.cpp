@@ -0,0 +1,381 @@
+#include "port_watcher.h"
+
+#include "arduino_cli.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QTimer>
+
+namespace {
+
+// udev creates the node first and settles permissions shortly after; one
+// rescan per burst of /dev changes is enough.
+constexpr int kRescanDelayMs = 50;
+// The sysfs device link points at the interface; the USB device with the
+// ids is a few levels up.
+constexpr int kMaxUsbParentLevels = 4;
+
+QString readSysfsValue(const QString& path) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  return QString::fromLatin1(f.readAll()).trimmed();
+}
+
+bool isNativeAddress(const PortWatcher::Port& port) {
+  return port.protocol == QStringLiteral("serial") &&
+         port.address.startsWith(QStringLiteral("/dev/"));
+}
+
+}  // namespace
+
+PortWatcher::PortWatcher(ArduinoCli* arduinoCli, QObject* parent)
+    : QObject(parent), arduinoCli_(arduinoCli) {
+  rescanTimer_ = new QTimer(this);
+  rescanTimer_->setSingleShot(true);
+  rescanTimer_->setInterval(kRescanDelayMs);
+  connect(rescanTimer_, &QTimer::timeout, this, [this] {
+    if (applyNativeScan()) {
+      emit portsChanged();
+    }
+  });
+#ifdef Q_OS_LINUX
+  nativeEnabled_ = QFileInfo::exists(QStringLiteral("/sys/class/tty"));
+#endif
+}
+
+PortWatcher::~PortWatcher() {
+  stop();
+}
+
+void PortWatcher::setNativeSerialEnumeration(bool enabled) {
+#ifndef Q_OS_LINUX
+  enabled = false;
+#endif
+  if (nativeEnabled_ == enabled) {
+    return;
+  }
+  nativeEnabled_ = enabled;
+  updateDevWatcher();
+}
+
+bool PortWatcher::nativeSerialEnumeration() const {
+  return nativeEnabled_;
+}
+
+void PortWatcher::start() {
+  stop();
+  buffer_.clear();
+  scanPos_ = 0;
+  objectStart_ = -1;
+  depth_ = 0;
+  inString_ = false;
+  escaped_ = false;
+  lastError_.clear();
+
+  updateDevWatcher();
+  if (nativeEnabled_ && applyNativeScan()) {
+    emit portsChanged();
+  }
+  if (!arduinoCli_) {
+    return;
+  }
+
+  process_ = new QProcess(this);
+  QProcess* process = process_;
+  connect(process, &QProcess::readyReadStandardOutput, this,
+          [this, process] { consume(process->readAllStandardOutput()); });
+  connect(process, &QProcess::readyReadStandardError, this, [this, process] {
+    const QString err = QString::fromUtf8(process->readAllStandardError()).trimmed();
+    if (!err.isEmpty()) {
+      lastError_ = err;
+    }
+  });
+  connect(process, &QProcess::finished, this, [this, process](int, QProcess::ExitStatus) {
+    consume(process->readAllStandardOutput());
+    if (process_ != process) {
+      return;
+    }
+    process_ = nullptr;
+    process->deleteLater();
+    emit watchStopped(lastError_);
+  });
+  connect(process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error) {
+    if (error != QProcess::FailedToStart || process_ != process) {
+      return;
+    }
+    process_ = nullptr;
+    process->deleteLater();
+    emit watchStopped(process->errorString());
+  });
+  process->start(arduinoCli_->arduinoCliPath(),
+                 arduinoCli_->withGlobalFlags(
+                     {"board", "list", "--watch", "--format", "json"}));
+}
+
+void PortWatcher::stop() {
+  if (!process_) {
+    return;
+  }
+  QProcess* process = process_;
+  process_ = nullptr;
+  process->disconnect(this);
+  if (process->state() != QProcess::NotRunning) {
+    process->terminate();
+    if (!process->waitForFinished(750)) {
+      process->kill();
+      (void)process->waitForFinished(750);
+    }
+  }
+  process->deleteLater();
+}
+
+bool PortWatcher::isRunning() const {
+  return process_ && process_->state() != QProcess::NotRunning;
+}
+
+const QVector<PortWatcher::Port>& PortWatcher::ports() const {
+  return ports_;
+}
+
+void PortWatcher::setPorts(QVector<Port> ports) {
+  if (ports == ports_) {
+    return;
+  }
+  ports_ = std::move(ports);
+  emit portsChanged();
+}
+
+void PortWatcher::consume(const QByteArray& data) {
+  if (data.isEmpty()) {
+    return;
+  }
+  buffer_.append(data);
+
+  // The CLI prints one (possibly pretty-printed) JSON object per event.
+  // Top-level objects are cut out by brace depth, skipping string contents;
+  // anything between them (commas, an enclosing array) is ignored.
+  bool changed = false;
+  const char* bytes = buffer_.constData();
+  const qsizetype size = buffer_.size();
+  for (qsizetype i = scanPos_; i < size; ++i) {
+    const char c = bytes[i];
+    if (inString_) {
+      if (escaped_) {
+        escaped_ = false;
+      } else if (c == '\\') {
+        escaped_ = true;
+      } else if (c == '"') {
+        inString_ = false;
+      }
+      continue;
+    }
+    if (depth_ == 0) {
+      if (c == '{') {
+        objectStart_ = i;
+        depth_ = 1;
+      }
+      continue;
+    }
+    if (c == '"') {
+      inString_ = true;
+    } else if (c == '{' || c == '[') {
+      ++depth_;
+    } else if ((c == '}' || c == ']') && --depth_ == 0) {
+      const QJsonDocument doc = QJsonDocument::fromJson(
+          QByteArray::fromRawData(bytes + objectStart_, i + 1 - objectStart_));
+      if (doc.isObject()) {
+        changed = applyEvent(doc.object()) || changed;
+      }
+      objectStart_ = -1;
+    }
+  }
+
+  // Only a partial event is kept, so the buffer stays about one event long.
+  if (objectStart_ < 0) {
+    buffer_.clear();
+    scanPos_ = 0;
+  } else {
+    buffer_.remove(0, objectStart_);
+    scanPos_ = buffer_.size();
+    objectStart_ = 0;
+  }
+
+  if (changed) {
+    emit portsChanged();
+  }
+}
+
+QVector<PortWatcher::Port> PortWatcher::parsePortList(const QByteArray& json, bool* ok) {
+  const QJsonDocument doc = QJsonDocument::fromJson(json);
+  if (ok) {
+    *ok = doc.isObject() || doc.isArray();
+  }
+  // 1.x wraps the list in {"detected_ports": [...]}; 0.x printed the array.
+  const QJsonArray arr =
+      doc.isObject() ? doc.object().value("detected_ports").toArray() : doc.array();
+  QVector<Port> out;
+  out.reserve(arr.size());
+  for (const QJsonValue& v : arr) {
+    Port port = portFromJson(v.toObject());
+    if (!port.address.isEmpty()) {
+      out.push_back(std::move(port));
+    }
+  }
+  return out;
+}
+
+PortWatcher::Port PortWatcher::portFromJson(const QJsonObject& detectedPort) {
+  // {"port": {...}, "matching_boards": [...]}, or the port fields inline
+  // with "boards" on older CLIs.
+  const QJsonObject portObj = detectedPort.value("port").isObject()
+                                  ? detectedPort.value("port").toObject()
+                                  : detectedPort;
+  Port port;
+  port.address = portObj.value("address").toString().trimmed();
+  port.protocol = portObj.value("protocol").toString().trimmed();
+  if (port.protocol.isEmpty()) {
+    port.protocol = QStringLiteral("serial");
+  }
+  port.protocolLabel = portObj.value("protocol_label").toString().trimmed();
+  const QJsonObject properties = portObj.value("properties").toObject();
+  port.vid = properties.value("vid").toString().trimmed();
+  port.pid = properties.value("pid").toString().trimmed();
+
+  QJsonArray boards = detectedPort.value("matching_boards").toArray();
+  if (boards.isEmpty()) {
+    boards = detectedPort.value("boards").toArray();
+  }
+  if (!boards.isEmpty()) {
+    const QJsonObject board = boards.first().toObject();
+    port.boardName = board.value("name").toString().trimmed();
+    port.boardFqbn = board.value("fqbn").toString().trimmed();
+  }
+  return port;
+}
+
+QVector<PortWatcher::Port> PortWatcher::enumerateSerialPorts(const QString& sysRoot) {
+  QVector<Port> out;
+#ifdef Q_OS_LINUX
+  const QDir ttyDir(QDir(sysRoot).filePath(QStringLiteral("class/tty")));
+  const QStringList names = ttyDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  for (const QString& name : names) {
+    // Only ttys backed by a USB device: the legacy ttyS placeholders and
+    // on-board UARTs never come and go, and the CLI reports them anyway.
+    const QString device =
+        QFileInfo(ttyDir.filePath(name + QStringLiteral("/device"))).canonicalFilePath();
+    if (device.isEmpty()) {
+      continue;
+    }
+    QDir dir(device);
+    for (int level = 0; level < kMaxUsbParentLevels; ++level) {
+      if (QFileInfo::exists(dir.filePath(QStringLiteral("idVendor")))) {
+        Port port;
+        port.address = QStringLiteral("/dev/") + name;
+        port.protocol = QStringLiteral("serial");
+        port.protocolLabel = QStringLiteral("Serial Port (USB)");
+        port.vid = QStringLiteral("0x") + readSysfsValue(dir.filePath(QStringLiteral("idVendor")));
+        port.pid = QStringLiteral("0x") + readSysfsValue(dir.filePath(QStringLiteral("idProduct")));
+        out.push_back(std::move(port));
+        break;
+      }
+      if (!dir.cdUp()) {
+        break;
+      }
+    }
+  }
+#else
+  Q_UNUSED(sysRoot);
+#endif
+  return out;
+}
+
+int PortWatcher::indexOf(const QString& protocol, const QString& address) const {
+  for (int i = 0; i < ports_.size(); ++i) {
+    if (ports_.at(i).address == address && ports_.at(i).protocol == protocol) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool PortWatcher::applyEvent(const QJsonObject& event) {
+  // "eventType" on 1.x, "event_type" or "type" before that.
+  QString type = event.value("eventType").toString();
+  if (type.isEmpty()) {
+    type = event.value("event_type").toString();
+  }
+  if (type.isEmpty()) {
+    type = event.value("type").toString();
+  }
+
+  if (type == QStringLiteral("quit")) {
+    const QString error = event.value("error").toString().trimmed();
+    if (!error.isEmpty()) {
+      lastError_ = error;
+    }
+    return false;
+  }
+
+  const Port port = portFromJson(event.value("port").toObject());
+  if (port.address.isEmpty()) {
+    return false;
+  }
+  const int index = indexOf(port.protocol, port.address);
+  if (type == QStringLiteral("add")) {
+    if (index < 0) {
+      ports_.push_back(port);
+      return true;
+    }
+    if (ports_.at(index) == port) {
+      return false;
+    }
+    ports_[index] = port;
+    return true;
+  }
+  if (type == QStringLiteral("remove") && index >= 0) {
+    ports_.removeAt(index);
+    return true;
+  }
+  return false;
+}
+
+bool PortWatcher::applyNativeScan() {
+  bool changed = false;
+  // A node that is gone is gone, whoever reported it.
+  for (qsizetype i = ports_.size() - 1; i >= 0; --i) {
+    if (isNativeAddress(ports_.at(i)) && !QFileInfo::exists(ports_.at(i).address)) {
+      ports_.removeAt(i);
+      changed = true;
+    }
+  }
+  // New USB ports are listed right away; the CLI's add event fills in the
+  // matched board when it arrives.
+  for (const Port& port : enumerateSerialPorts()) {
+    if (indexOf(port.protocol, port.address) < 0) {
+      ports_.push_back(port);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void PortWatcher::updateDevWatcher() {
+  if (!nativeEnabled_) {
+    delete devWatcher_;
+    devWatcher_ = nullptr;
+    return;
+  }
+  if (devWatcher_) {
+    return;
+  }
+  devWatcher_ = new QFileSystemWatcher({QStringLiteral("/dev")}, this);
+  connect(devWatcher_, &QFileSystemWatcher::directoryChanged, rescanTimer_,
+          qOverload<>(&QTimer::start));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class ArduinoCli;
+class QFileSystemWatcher;
+class QProcess;
+class QTimer;
+
+// Live model of the ports arduino-cli can see. `board list --watch` streams
+// one JSON event per port that appears or disappears, and each event is
+// applied to the model as it arrives instead of re-running `board list`.
+// On Linux the /dev directory is watched as well and USB serial ports are
+// enumerated through sysfs, so a plugged or unplugged board shows up before
+// the CLI's discovery reports it (without a matched board until it does).
+class PortWatcher final : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Port final {
+    QString address;
+    QString protocol;  // "serial", "network", ...
+    QString protocolLabel;
+    QString boardName;  // first matching board, if any
+    QString boardFqbn;
+    QString vid;
+    QString pid;
+
+    bool operator==(const Port&) const = default;
+  };
+
+  explicit PortWatcher(ArduinoCli* arduinoCli, QObject* parent = nullptr);
+  ~PortWatcher() override;
+
+  // The sysfs fast path; on by default where it is available.
+  void setNativeSerialEnumeration(bool enabled);
+  bool nativeSerialEnumeration() const;
+
+  void start();
+  void stop();
+  // Whether the CLI watch process is running.
+  bool isRunning() const;
+
+  const QVector<Port>& ports() const;
+  // Replaces the model with a full `board list` snapshot.
+  void setPorts(QVector<Port> ports);
+  // Applies raw watch output. Events may be split across calls; a partial
+  // one is kept until the rest arrives. Emits portsChanged at most once.
+  void consume(const QByteArray& data);
+
+  // Ports of `board list --format json` output (any CLI version).
+  static QVector<Port> parsePortList(const QByteArray& json, bool* ok = nullptr);
+  static Port portFromJson(const QJsonObject& detectedPort);
+  // USB serial ports under <sysRoot>/class/tty; empty off Linux.
+  static QVector<Port> enumerateSerialPorts(const QString& sysRoot = QStringLiteral("/sys"));
+
+ signals:
+  void portsChanged();
+  // The watch process exited; `error` is what it reported, if anything.
+  void watchStopped(QString error);
+
+ private:
+  ArduinoCli* arduinoCli_ = nullptr;
+  QVector<Port> ports_;
+  QProcess* process_ = nullptr;
+  QString lastError_;
+
+  // Stream splitting state; scanning resumes where the last chunk ended.
+  QByteArray buffer_;
+  qsizetype scanPos_ = 0;
+  qsizetype objectStart_ = -1;
+  int depth_ = 0;
+  bool inString_ = false;
+  bool escaped_ = false;
+
+  bool nativeEnabled_ = false;
+  QFileSystemWatcher* devWatcher_ = nullptr;
+  QTimer* rescanTimer_ = nullptr;
+
+  int indexOf(const QString& protocol, const QString& address) const;
+  bool applyEvent(const QJsonObject& event);
+  bool applyNativeScan();
+  void updateDevWatcher();
+};
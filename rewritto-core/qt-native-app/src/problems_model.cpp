@@ -0,0 +1,261 @@
+#include "problems_model.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+int severityIndex(ProblemsModel::Severity severity) {
+  return static_cast<int>(severity);
+}
+
+// Entries are ordered by (source, file).
+bool groupLess(const QPair<QString, QString>& a, const QPair<QString, QString>& b) {
+  const int bySource = QString::compare(a.first, b.first);
+  return bySource < 0 || (bySource == 0 && a.second < b.second);
+}
+}  // namespace
+
+ProblemsModel::ProblemsModel(QObject* parent) : QAbstractListModel(parent) {}
+
+ProblemsModel::Severity ProblemsModel::severityFor(const QString& severity) {
+  const QString s = severity.trimmed().toLower();
+  if (s == QStringLiteral("error") || s == QStringLiteral("fatal") ||
+      s == QStringLiteral("fatal error")) {
+    return Severity::Error;
+  }
+  if (s == QStringLiteral("warning")) {
+    return Severity::Warning;
+  }
+  if (s == QStringLiteral("hint")) {
+    return Severity::Hint;
+  }
+  // Treat everything else ("info", "note", etc.) as Info.
+  return Severity::Info;
+}
+
+ProblemsModel::Entry ProblemsModel::makeEntry(const QString& source,
+                                              const QString& file,
+                                              const Diagnostic& diag) {
+  Entry e;
+  e.source = source;
+  e.file = file;
+  e.diag = diag;
+  e.severity = severityFor(diag.severity);
+
+  QString msg = diag.message;
+  msg.replace('\r', ' ');
+  msg.replace('\n', ' ');
+  msg = msg.simplified();
+
+  if (file.isEmpty()) {
+    e.text = QString("[%1] %2: %3").arg(source, diag.severity, msg);
+  } else if (diag.line <= 0) {
+    e.text = QString("[%1] %2: %3: %4").arg(source, file, diag.severity, msg);
+  } else {
+    const QString loc =
+        diag.column > 0 ? QString("%1:%2:%3").arg(file).arg(diag.line).arg(diag.column)
+                        : QString("%1:%2").arg(file).arg(diag.line);
+    e.text = QString("[%1] %2: %3: %4").arg(source, loc, diag.severity, msg);
+  }
+  return e;
+}
+
+qsizetype ProblemsModel::groupBegin(const QString& source, const QString& file) const {
+  const auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), qMakePair(source, file),
+      [](const Entry& e, const QPair<QString, QString>& key) {
+        return groupLess(qMakePair(e.source, e.file), key);
+      });
+  return std::distance(entries_.begin(), it);
+}
+
+qsizetype ProblemsModel::groupEnd(const QString& source, const QString& file) const {
+  const auto it = std::upper_bound(
+      entries_.begin(), entries_.end(), qMakePair(source, file),
+      [](const QPair<QString, QString>& key, const Entry& e) {
+        return groupLess(key, qMakePair(e.source, e.file));
+      });
+  return std::distance(entries_.begin(), it);
+}
+
+void ProblemsModel::insertEntries(qsizetype row, std::vector<Entry> entries) {
+  if (entries.empty()) {
+    return;
+  }
+  beginInsertRows(QModelIndex(), static_cast<int>(row),
+                  static_cast<int>(row + static_cast<qsizetype>(entries.size()) - 1));
+  for (const Entry& e : entries) {
+    ++counts_[severityIndex(e.severity)];
+  }
+  entries_.insert(entries_.begin() + row, std::make_move_iterator(entries.begin()),
+                  std::make_move_iterator(entries.end()));
+  endInsertRows();
+}
+
+void ProblemsModel::removeEntries(qsizetype begin, qsizetype end) {
+  if (begin >= end) {
+    return;
+  }
+  beginRemoveRows(QModelIndex(), static_cast<int>(begin), static_cast<int>(end - 1));
+  for (qsizetype i = begin; i < end; ++i) {
+    --counts_[severityIndex(entries_[static_cast<size_t>(i)].severity)];
+  }
+  entries_.erase(entries_.begin() + begin, entries_.begin() + end);
+  endRemoveRows();
+}
+
+void ProblemsModel::clear() {
+  pending_.clear();
+  if (entries_.empty()) {
+    return;
+  }
+  beginResetModel();
+  entries_.clear();
+  counts_.fill(0);
+  endResetModel();
+  emit countsChanged();
+}
+
+void ProblemsModel::clearSource(const QString& source) {
+  flush();
+  const auto first = std::find_if(entries_.begin(), entries_.end(),
+                                   [&source](const Entry& e) { return e.source == source; });
+  const auto last = std::find_if(first, entries_.end(),
+                                 [&source](const Entry& e) { return e.source != source; });
+  if (first == last) {
+    return;
+  }
+  removeEntries(std::distance(entries_.begin(), first), std::distance(entries_.begin(), last));
+  emit countsChanged();
+}
+
+void ProblemsModel::addDiagnostic(const QString& source, const Diagnostic& diag) {
+  pending_.push_back({source, diag});
+  if (flushScheduled_) {
+    return;
+  }
+  flushScheduled_ = true;
+  QTimer::singleShot(0, this, [this] { flush(); });
+}
+
+void ProblemsModel::setDiagnostics(const QString& source,
+                                   const QString& filePath,
+                                   const QVector<Diagnostic>& diags) {
+  flush();
+  const qsizetype begin = groupBegin(source, filePath);
+  removeEntries(begin, groupEnd(source, filePath));
+
+  std::vector<Entry> entries;
+  entries.reserve(static_cast<size_t>(diags.size()));
+  for (const Diagnostic& d : diags) {
+    entries.push_back(makeEntry(source, filePath, d));
+  }
+  insertEntries(begin, std::move(entries));
+  emit countsChanged();
+}
+
+void ProblemsModel::flush() {
+  flushScheduled_ = false;
+  if (pending_.isEmpty()) {
+    return;
+  }
+
+  // One row-range insert per (source, file) run of the batch.
+  QVector<QPair<QString, Diagnostic>> batch;
+  batch.swap(pending_);
+  std::stable_sort(batch.begin(), batch.end(), [](const auto& a, const auto& b) {
+    return groupLess(qMakePair(a.first, a.second.filePath),
+                     qMakePair(b.first, b.second.filePath));
+  });
+  for (qsizetype i = 0; i < batch.size();) {
+    const QString& source = batch.at(i).first;
+    const QString& file = batch.at(i).second.filePath;
+    std::vector<Entry> run;
+    qsizetype j = i;
+    for (; j < batch.size() && batch.at(j).first == source &&
+           batch.at(j).second.filePath == file;
+         ++j) {
+      run.push_back(makeEntry(source, file, batch.at(j).second));
+    }
+    insertEntries(groupEnd(source, file), std::move(run));
+    i = j;
+  }
+  emit countsChanged();
+}
+
+bool ProblemsModel::hasPending() const {
+  return !pending_.isEmpty();
+}
+
+int ProblemsModel::count(Severity severity) const {
+  return counts_[severityIndex(severity)];
+}
+
+void ProblemsModel::setSeverityIcons(std::array<QIcon, kSeverityCount> icons) {
+  icons_ = std::move(icons);
+  if (!entries_.empty()) {
+    emit dataChanged(index(0), index(rowCount() - 1), {Qt::DecorationRole});
+  }
+}
+
+int ProblemsModel::rowCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : static_cast<int>(entries_.size());
+}
+
+QVariant ProblemsModel::data(const QModelIndex& index, int role) const {
+  if (!index.isValid() || index.row() < 0 || index.row() >= rowCount()) {
+    return {};
+  }
+  const Entry& e = entries_[static_cast<size_t>(index.row())];
+  switch (role) {
+    case Qt::DisplayRole:
+      return e.text;
+    case Qt::DecorationRole:
+      return QVariant::fromValue(icons_[severityIndex(e.severity)]);
+    case Qt::ToolTipRole:
+    case MessageRole:
+      return e.diag.message;
+    case FilePathRole:
+      return e.diag.filePath;
+    case LineRole:
+      return e.diag.line;
+    case ColumnRole:
+      return e.diag.column;
+    case SeverityRole:
+      return severityIndex(e.severity);
+    default:
+      return {};
+  }
+}
+
+ProblemsFilterProxyModel::ProblemsFilterProxyModel(QObject* parent)
+    : QSortFilterProxyModel(parent) {}
+
+void ProblemsFilterProxyModel::setSeverityVisible(ProblemsModel::Severity severity,
+                                                  bool visible) {
+  bool& current = visible_[severityIndex(severity)];
+  if (current == visible) {
+    return;
+  }
+#if QT_VERSION >= QT_VERSION_CHECK(6, 10, 0)
+  beginFilterChange();
+  current = visible;
+  endFilterChange();
+#else
+  current = visible;
+  invalidateRowsFilter();
+#endif
+}
+
+bool ProblemsFilterProxyModel::isSeverityVisible(ProblemsModel::Severity severity) const {
+  return visible_[severityIndex(severity)];
+}
+
+bool ProblemsFilterProxyModel::filterAcceptsRow(int sourceRow,
+                                                const QModelIndex& sourceParent) const {
+  const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+  const int severity = index.data(ProblemsModel::SeverityRole).toInt();
+  return severity < 0 || severity >= ProblemsModel::kSeverityCount || visible_[severity];
+}
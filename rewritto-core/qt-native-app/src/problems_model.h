@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QIcon>
+#include <QSortFilterProxyModel>
+#include <QString>
+#include <QVector>
+
+#include <array>
+#include <vector>
+
+// Diagnostics of the Problems panel, one row each, ordered by source and
+// file (in arrival order within a file). Changes are applied as row-range
+// inserts and removals, and severity counts are kept as rows come and go.
+// addDiagnostic() only queues: everything queued during one pass of the
+// event loop is inserted together.
+class ProblemsModel final : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  enum class Severity {
+    Error,
+    Warning,
+    Info,
+    Hint,
+  };
+  static constexpr int kSeverityCount = 4;
+
+  enum Role {
+    FilePathRole = Qt::UserRole + 1,
+    LineRole,
+    ColumnRole,
+    SeverityRole,  // Severity as int
+    MessageRole,
+  };
+
+  struct Diagnostic {
+    QString filePath;
+    int line = 0;    // 1-based
+    int column = 0;  // 1-based
+    QString severity;
+    QString message;
+  };
+
+  explicit ProblemsModel(QObject* parent = nullptr);
+
+  void clear();
+  void clearSource(const QString& source);
+  void addDiagnostic(const QString& source, const Diagnostic& diag);
+  void setDiagnostics(const QString& source,
+                      const QString& filePath,
+                      const QVector<Diagnostic>& diags);
+  // Inserts the queued addDiagnostic() rows now.
+  void flush();
+  bool hasPending() const;
+
+  int count(Severity severity) const;
+  void setSeverityIcons(std::array<QIcon, kSeverityCount> icons);
+
+  static Severity severityFor(const QString& severity);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+ signals:
+  void countsChanged();
+
+ private:
+  struct Entry final {
+    QString source;
+    QString file;  // the group the diagnostic was reported under
+    Diagnostic diag;
+    Severity severity = Severity::Info;
+    QString text;
+  };
+
+  std::vector<Entry> entries_;
+  QVector<QPair<QString, Diagnostic>> pending_;
+  bool flushScheduled_ = false;
+  std::array<int, kSeverityCount> counts_{};
+  std::array<QIcon, kSeverityCount> icons_;
+
+  static Entry makeEntry(const QString& source, const QString& file, const Diagnostic& diag);
+  qsizetype groupBegin(const QString& source, const QString& file) const;
+  qsizetype groupEnd(const QString& source, const QString& file) const;
+  void insertEntries(qsizetype row, std::vector<Entry> entries);
+  void removeEntries(qsizetype begin, qsizetype end);
+};
+
+// Hides the severities switched off in the Problems toolbar.
+class ProblemsFilterProxyModel final : public QSortFilterProxyModel {
+ public:
+  explicit ProblemsFilterProxyModel(QObject* parent = nullptr);
+
+  void setSeverityVisible(ProblemsModel::Severity severity, bool visible);
+  bool isSeverityVisible(ProblemsModel::Severity severity) const;
+
+ protected:
+  bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+ private:
+  std::array<bool, ProblemsModel::kSeverityCount> visible_{true, true, true, true};
+};
@@ -1,12 +1,12 @@
 #include "problems_widget.h"
 
-#include <algorithm>
 #include <QAction>
 #include <QClipboard>
 #include <QFileInfo>
 #include <QBoxLayout>
 #include <QGuiApplication>
 #include <QLabel>
+#include <QListView>
 #include <QMenu>
 #include <QPoint>
 #include <QRegularExpression>
@@ -14,10 +14,6 @@
 #include <QToolBar>
 
 namespace {
-constexpr int kRoleFilePath = Qt::UserRole + 1;
-constexpr int kRoleLine = Qt::UserRole + 2;
-constexpr int kRoleColumn = Qt::UserRole + 3;
-
 QString missingHeaderSearchQuery(const QString& message) {
   const QString text = message.trimmed();
   if (text.isEmpty()) {
@@ -104,22 +100,6 @@ QString missingToolSearchQuery(const QString& message) {
 }
 }  // namespace
 
-ProblemsWidget::SeverityKind ProblemsWidget::kindForSeverityString(const QString& severity) {
-  const QString s = severity.trimmed().toLower();
-  if (s == QStringLiteral("error") || s == QStringLiteral("fatal") ||
-      s == QStringLiteral("fatal error")) {
-    return SeverityKind::Error;
-  }
-  if (s == QStringLiteral("warning")) {
-    return SeverityKind::Warning;
-  }
-  if (s == QStringLiteral("hint")) {
-    return SeverityKind::Hint;
-  }
-  // Treat everything else ("info", "note", etc.) as Info.
-  return SeverityKind::Info;
-}
-
 ProblemsWidget::ProblemsWidget(QWidget* parent) : QWidget(parent) {
   auto iconFor = [this](const QString& themeName, QStyle::StandardPixmap fallback) {
     QIcon icon = QIcon::fromTheme(themeName);
@@ -171,7 +151,17 @@ ProblemsWidget::ProblemsWidget(QWidget* parent) : QWidget(parent) {
   summaryLabel_->setText(QStringLiteral("E 0  W 0  I 0  H 0"));
   toolBar_->addWidget(summaryLabel_);
 
-  list_ = new QListWidget(this);
+  model_ = new ProblemsModel(this);
+  model_->setSeverityIcons({style()->standardIcon(QStyle::SP_MessageBoxCritical),
+                            style()->standardIcon(QStyle::SP_MessageBoxWarning),
+                            style()->standardIcon(QStyle::SP_MessageBoxInformation),
+                            style()->standardIcon(QStyle::SP_DialogHelpButton)});
+  proxy_ = new ProblemsFilterProxyModel(this);
+  proxy_->setSourceModel(model_);
+
+  list_ = new QListView(this);
+  list_->setObjectName("ProblemsList");
+  list_->setModel(proxy_);
   list_->setUniformItemSizes(true);
   list_->setSelectionMode(QAbstractItemView::SingleSelection);
   list_->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -184,51 +174,57 @@ ProblemsWidget::ProblemsWidget(QWidget* parent) : QWidget(parent) {
   connect(clearAction_, &QAction::triggered, this, [this] { clearAll(); });
   connect(copyAction_, &QAction::triggered, this, [this] {
     QStringList lines;
-    lines.reserve(list_ ? list_->count() : 0);
-    if (list_) {
-      for (int i = 0; i < list_->count(); ++i) {
-        if (auto* item = list_->item(i)) {
-          lines << item->text();
-        }
-      }
+    lines.reserve(proxy_->rowCount());
+    for (int i = 0; i < proxy_->rowCount(); ++i) {
+      lines << proxy_->index(i, 0).data().toString();
     }
     if (auto* cb = QGuiApplication::clipboard()) {
       cb->setText(lines.join(QLatin1Char('\n')));
     }
   });
 
-  auto onFilterChanged = [this](bool) { rebuild(); };
-  connect(showErrorsAction_, &QAction::toggled, this, onFilterChanged);
-  connect(showWarningsAction_, &QAction::toggled, this, onFilterChanged);
-  connect(showInfoAction_, &QAction::toggled, this, onFilterChanged);
-  connect(showHintsAction_, &QAction::toggled, this, onFilterChanged);
-
-  connect(list_, &QListWidget::itemActivated, this, [this](QListWidgetItem* item) {
-    if (!item) {
+  auto filterToggle = [this](ProblemsModel::Severity severity) {
+    return [this, severity](bool checked) {
+      proxy_->setSeverityVisible(severity, checked);
+      updateSummary();
+    };
+  };
+  connect(showErrorsAction_, &QAction::toggled, this,
+          filterToggle(ProblemsModel::Severity::Error));
+  connect(showWarningsAction_, &QAction::toggled, this,
+          filterToggle(ProblemsModel::Severity::Warning));
+  connect(showInfoAction_, &QAction::toggled, this,
+          filterToggle(ProblemsModel::Severity::Info));
+  connect(showHintsAction_, &QAction::toggled, this,
+          filterToggle(ProblemsModel::Severity::Hint));
+  connect(model_, &ProblemsModel::countsChanged, this, [this] { updateSummary(); });
+
+  connect(list_, &QListView::activated, this, [this](const QModelIndex& index) {
+    if (!index.isValid()) {
       return;
     }
-    const QString filePath = item->data(kRoleFilePath).toString();
-    const int line = item->data(kRoleLine).toInt();
-    const int column = item->data(kRoleColumn).toInt();
+    const QString filePath = index.data(ProblemsModel::FilePathRole).toString();
+    const int line = index.data(ProblemsModel::LineRole).toInt();
+    const int column = index.data(ProblemsModel::ColumnRole).toInt();
     if (!filePath.isEmpty() && line > 0) {
       emit openLocationRequested(filePath, line, column);
     }
   });
 
-  connect(list_, &QListWidget::customContextMenuRequested, this,
+  connect(list_, &QListView::customContextMenuRequested, this,
           [this](const QPoint& pos) {
             if (!list_) {
               return;
             }
-            QListWidgetItem* item = list_->itemAt(pos);
-            if (!item) {
+            const QModelIndex index = list_->indexAt(pos);
+            if (!index.isValid()) {
               return;
             }
 
-            const QString filePath = item->data(kRoleFilePath).toString();
-            const int line = item->data(kRoleLine).toInt();
-            const int column = item->data(kRoleColumn).toInt();
-            const QString message = item->toolTip().trimmed();
+            const QString filePath = index.data(ProblemsModel::FilePathRole).toString();
+            const int line = index.data(ProblemsModel::LineRole).toInt();
+            const int column = index.data(ProblemsModel::ColumnRole).toInt();
+            const QString message = index.data(ProblemsModel::MessageRole).toString().trimmed();
 
             QMenu menu(this);
 
@@ -368,149 +364,43 @@ ProblemsWidget::ProblemsWidget(QWidget* parent) : QWidget(parent) {
 }
 
 void ProblemsWidget::clearAll() {
-  diagsBySourceAndFile_.clear();
-  rebuild();
+  model_->clear();
 }
 
 void ProblemsWidget::clearSource(const QString& source) {
-  diagsBySourceAndFile_.remove(source);
-  rebuild();
+  model_->clearSource(source);
 }
 
 void ProblemsWidget::addDiagnostic(const QString& source, const Diagnostic& diag) {
-  diagsBySourceAndFile_[source][diag.filePath].push_back(diag);
-  rebuild();
+  model_->addDiagnostic(source, diag);
 }
 
 void ProblemsWidget::setDiagnostics(const QString& source,
                                    const QString& filePath,
                                    const QVector<Diagnostic>& diags) {
-  diagsBySourceAndFile_[source][filePath] = diags;
-  rebuild();
+  model_->setDiagnostics(source, filePath, diags);
 }
 
-void ProblemsWidget::rebuild() {
-  list_->clear();
-
-  struct Counts final {
-    int errors = 0;
-    int warnings = 0;
-    int infos = 0;
-    int hints = 0;
-  };
-
-  auto addToCounts = [](Counts* c, SeverityKind kind) {
-    if (!c) {
-      return;
-    }
-    switch (kind) {
-      case SeverityKind::Error:
-        ++c->errors;
-        break;
-      case SeverityKind::Warning:
-        ++c->warnings;
-        break;
-      case SeverityKind::Info:
-        ++c->infos;
-        break;
-      case SeverityKind::Hint:
-        ++c->hints;
-        break;
-    }
-  };
-
-  const bool showErrors = !showErrorsAction_ || showErrorsAction_->isChecked();
-  const bool showWarnings = !showWarningsAction_ || showWarningsAction_->isChecked();
-  const bool showInfos = !showInfoAction_ || showInfoAction_->isChecked();
-  const bool showHints = !showHintsAction_ || showHintsAction_->isChecked();
-  auto visible = [&](SeverityKind kind) {
-    switch (kind) {
-      case SeverityKind::Error:
-        return showErrors;
-      case SeverityKind::Warning:
-        return showWarnings;
-      case SeverityKind::Info:
-        return showInfos;
-      case SeverityKind::Hint:
-        return showHints;
-    }
-    return true;
-  };
-
-  auto iconForKind = [this](SeverityKind kind) {
-    switch (kind) {
-      case SeverityKind::Error:
-        return style()->standardIcon(QStyle::SP_MessageBoxCritical);
-      case SeverityKind::Warning:
-        return style()->standardIcon(QStyle::SP_MessageBoxWarning);
-      case SeverityKind::Info:
-        return style()->standardIcon(QStyle::SP_MessageBoxInformation);
-      case SeverityKind::Hint:
-        return style()->standardIcon(QStyle::SP_DialogHelpButton);
-    }
-    return QIcon{};
-  };
-
-  Counts all;
-  Counts shown;
-
-  auto sources = diagsBySourceAndFile_.keys();
-  std::sort(sources.begin(), sources.end());
-  for (const QString& source : sources) {
-    auto files = diagsBySourceAndFile_.value(source).keys();
-    std::sort(files.begin(), files.end());
-    for (const QString& file : files) {
-      const auto diags = diagsBySourceAndFile_.value(source).value(file);
-      for (const Diagnostic& d : diags) {
-        const SeverityKind kind = kindForSeverityString(d.severity);
-        addToCounts(&all, kind);
-        if (!visible(kind)) {
-          continue;
-        }
-        addToCounts(&shown, kind);
-
-        QString msg = d.message;
-        msg.replace('\r', ' ');
-        msg.replace('\n', ' ');
-        msg = msg.simplified();
-
-        QString text;
-        if (file.isEmpty()) {
-          text = QString("[%1] %2: %3").arg(source, d.severity, msg);
-        } else if (d.line <= 0) {
-          text = QString("[%1] %2: %3: %4").arg(source, file, d.severity, msg);
-        } else {
-          const QString loc =
-              d.column > 0 ? QString("%1:%2:%3").arg(file).arg(d.line).arg(d.column)
-                           : QString("%1:%2").arg(file).arg(d.line);
-          text = QString("[%1] %2: %3: %4").arg(source, loc, d.severity, msg);
-        }
-
-        auto* item = new QListWidgetItem(text, list_);
-        item->setIcon(iconForKind(kind));
-        item->setData(kRoleFilePath, d.filePath);
-        item->setData(kRoleLine, d.line);
-        item->setData(kRoleColumn, d.column);
-        item->setToolTip(d.message);
-        list_->addItem(item);
-      }
-    }
-  }
+ProblemsModel* ProblemsWidget::model() const {
+  return model_;
+}
 
-  if (summaryLabel_) {
-    const QString text =
-        QStringLiteral("E %1  W %2  I %3  H %4")
-            .arg(all.errors)
-            .arg(all.warnings)
-            .arg(all.infos)
-            .arg(all.hints);
-    const QString shownText =
-        QStringLiteral("Showing: E %1  W %2  I %3  H %4")
-            .arg(shown.errors)
-            .arg(shown.warnings)
-            .arg(shown.infos)
-            .arg(shown.hints);
-    summaryLabel_->setText(text);
-    summaryLabel_->setToolTip(shownText);
+void ProblemsWidget::updateSummary() {
+  if (!summaryLabel_) {
+    return;
   }
+  using Severity = ProblemsModel::Severity;
+  auto shown = [this](Severity severity) {
+    return proxy_->isSeverityVisible(severity) ? model_->count(severity) : 0;
+  };
+  summaryLabel_->setText(QStringLiteral("E %1  W %2  I %3  H %4")
+                             .arg(model_->count(Severity::Error))
+                             .arg(model_->count(Severity::Warning))
+                             .arg(model_->count(Severity::Info))
+                             .arg(model_->count(Severity::Hint)));
+  summaryLabel_->setToolTip(QStringLiteral("Showing: E %1  W %2  I %3  H %4")
+                                .arg(shown(Severity::Error))
+                                .arg(shown(Severity::Warning))
+                                .arg(shown(Severity::Info))
+                                .arg(shown(Severity::Hint)));
 }
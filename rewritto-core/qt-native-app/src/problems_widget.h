@@ -1,24 +1,19 @@
 #pragma once
 
-#include <QHash>
-#include <QListWidget>
 #include <QWidget>
 
+#include "problems_model.h"
+
 class QAction;
 class QLabel;
+class QListView;
 class QToolBar;
 
 class ProblemsWidget final : public QWidget {
   Q_OBJECT
 
  public:
-  struct Diagnostic {
-    QString filePath;
-    int line = 0;    // 1-based
-    int column = 0;  // 1-based
-    QString severity;
-    QString message;
-  };
+  using Diagnostic = ProblemsModel::Diagnostic;
 
   explicit ProblemsWidget(QWidget* parent = nullptr);
 
@@ -29,6 +24,8 @@ class ProblemsWidget final : public QWidget {
                       const QString& filePath,
                       const QVector<Diagnostic>& diags);
 
+  ProblemsModel* model() const;
+
  signals:
   void openLocationRequested(QString filePath, int line, int column);
   void searchLibrariesRequested(QString query);
@@ -37,15 +34,6 @@ class ProblemsWidget final : public QWidget {
   void showDocsRequested(QString message);
 
  private:
-  enum class SeverityKind {
-    Error,
-    Warning,
-    Info,
-    Hint,
-  };
-
-  static SeverityKind kindForSeverityString(const QString& severity);
-
   QToolBar* toolBar_ = nullptr;
   QAction* clearAction_ = nullptr;
   QAction* copyAction_ = nullptr;
@@ -55,8 +43,9 @@ class ProblemsWidget final : public QWidget {
   QAction* showHintsAction_ = nullptr;
   QLabel* summaryLabel_ = nullptr;
 
-  QListWidget* list_ = nullptr;
-  QHash<QString, QHash<QString, QVector<Diagnostic>>> diagsBySourceAndFile_;
+  QListView* list_ = nullptr;
+  ProblemsModel* model_ = nullptr;
+  ProblemsFilterProxyModel* proxy_ = nullptr;
 
-  void rebuild();
+  void updateSummary();
 };
@@ -1,17 +1,19 @@
 #include "quick_pick_dialog.h"
 
+#include "fuzzy_matcher.h"
+
 #include <QAbstractItemView>
+#include <QAbstractTableModel>
 #include <QBoxLayout>
 #include <QDialogButtonBox>
 #include <QHeaderView>
 #include <QItemSelectionModel>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QRegularExpression>
-#include <QSortFilterProxyModel>
-#include <QStandardItemModel>
 #include <QTableView>
-#include <QtGlobal>
+
+#include <algorithm>
+#include <numeric>
 
 namespace {
 constexpr int kColLabel = 0;
@@ -19,81 +21,123 @@ constexpr int kColDetail = 1;
 constexpr int kColCount = 2;
 constexpr int kRoleData = Qt::UserRole + 1;
 
-class QuickPickFilterProxyModel final : public QSortFilterProxyModel {
+QString stripMnemonics(QString text) {
+  text.remove(QLatin1Char('&'));
+  return text.trimmed();
+}
+}  // namespace
+
+// The items in the header's sort order, of which the rows show the ones
+// matching the query, best match first. While the query only grows, each
+// keystroke re-scores just the rows already shown.
+class QuickPickModel final : public QAbstractTableModel {
  public:
-  using QSortFilterProxyModel::QSortFilterProxyModel;
+  using QAbstractTableModel::QAbstractTableModel;
 
-  void setQuery(QString query) {
-    if (query_ == query) {
-      return;
-    }
-    query_ = std::move(query);
-    refreshFilter();
+  void setItems(QVector<QuickPickDialog::Item> items) {
+    items_ = std::move(items);
+    reorder();
+  }
+
+  // Items ranked elsewhere, shown as they are.
+  void setRankedItems(QVector<QuickPickDialog::Item> items) {
+    beginResetModel();
+    items_ = std::move(items);
+    matcher_.clear();
+    pattern_ = {};
+    rows_.resize(items_.size());
+    std::iota(rows_.begin(), rows_.end(), 0);
+    endResetModel();
+  }
+
+  void setQuery(const QString& query) {
+    FuzzyMatcher::Pattern pattern(query);
+    const bool narrowed = pattern.narrows(pattern_);
+    pattern_ = std::move(pattern);
+    beginResetModel();
+    rows_ = matcher_.rank(pattern_, narrowed ? &rows_ : nullptr);
+    endResetModel();
+  }
+
+  QVariant dataAt(int row) const {
+    return row >= 0 && row < rows_.size() ? items_.at(rows_.at(row)).data : QVariant{};
+  }
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override {
+    return parent.isValid() ? 0 : static_cast<int>(rows_.size());
+  }
+
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override {
+    return parent.isValid() ? 0 : kColCount;
   }
 
- protected:
-  bool filterAcceptsRow(int sourceRow,
-                        const QModelIndex& sourceParent) const override {
-    if (query_.trimmed().isEmpty()) {
-      return true;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override {
+    if (!index.isValid() || index.row() >= rows_.size()) {
+      return {};
     }
-    const QModelIndex labelIdx =
-        sourceModel()->index(sourceRow, kColLabel, sourceParent);
-    const QModelIndex detailIdx =
-        sourceModel()->index(sourceRow, kColDetail, sourceParent);
-    const QString label =
-        sourceModel()->data(labelIdx, Qt::DisplayRole).toString();
-    const QString detail =
-        sourceModel()->data(detailIdx, Qt::DisplayRole).toString();
-
-    const QString hay =
-        (label + QStringLiteral(" ") + detail).toLower();
-
-    const QStringList parts =
-        query_.toLower().split(QRegularExpression(R"(\s+)"), Qt::SkipEmptyParts);
-    if (parts.isEmpty()) {
-      return true;
+    const QuickPickDialog::Item& item = items_.at(rows_.at(index.row()));
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole) {
+      return index.column() == kColLabel ? item.label : item.detail;
     }
-
-    auto fuzzyContains = [](const QString& needle, const QString& s) -> bool {
-      if (needle.isEmpty()) {
-        return true;
+    if (index.column() == kColLabel) {
+      if (role == Qt::DecorationRole && !item.icon.isNull()) {
+        return item.icon;
       }
-      int j = 0;
-      for (int i = 0; i < s.size() && j < needle.size(); ++i) {
-        if (s.at(i) == needle.at(j)) {
-          ++j;
-        }
+      if (role == kRoleData) {
+        return item.data;
       }
-      return j == needle.size();
-    };
+    }
+    return {};
+  }
 
-    for (const QString& needle : parts) {
-      if (!fuzzyContains(needle, hay)) {
-        return false;
-      }
+  QVariant headerData(int section, Qt::Orientation orientation, int role) const override {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+      return QAbstractTableModel::headerData(section, orientation, role);
     }
-    return true;
+    return section == kColLabel ? QuickPickDialog::tr("Name") : QuickPickDialog::tr("Detail");
   }
 
- private:
-  void refreshFilter() {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 10, 0)
-    beginFilterChange();
-    endFilterChange();
-#else
-    invalidateFilter();
-#endif
+  // Orders the items for an empty query, and ties between equal scores.
+  void sort(int column, Qt::SortOrder order) override {
+    sortColumn_ = column == kColDetail ? kColDetail : kColLabel;
+    sortOrder_ = order;
+    reorder();
   }
 
-  QString query_;
-};
+ private:
+  QVector<QuickPickDialog::Item> items_;
+  FuzzyMatcher matcher_;
+  FuzzyMatcher::Pattern pattern_;
+  QVector<int> rows_;  // indexes into items_
+  int sortColumn_ = kColLabel;
+  Qt::SortOrder sortOrder_ = Qt::AscendingOrder;
 
-QString stripMnemonics(QString text) {
-  text.remove(QLatin1Char('&'));
-  return text.trimmed();
-}
-}  // namespace
+  void reorder() {
+    const bool byDetail = sortColumn_ == kColDetail;
+    const bool descending = sortOrder_ == Qt::DescendingOrder;
+    std::stable_sort(items_.begin(), items_.end(),
+                     [byDetail, descending](const QuickPickDialog::Item& a,
+                                            const QuickPickDialog::Item& b) {
+                       const int c = byDetail ? a.detail.compare(b.detail, Qt::CaseInsensitive)
+                                              : a.label.compare(b.label, Qt::CaseInsensitive);
+                       return descending ? c > 0 : c < 0;
+                     });
+
+    qsizetype characters = 0;
+    for (const QuickPickDialog::Item& item : items_) {
+      characters += item.label.size() + item.detail.size() + 1;
+    }
+    matcher_.clear();
+    matcher_.reserve(static_cast<int>(items_.size()), characters);
+    for (const QuickPickDialog::Item& item : items_) {
+      matcher_.add(item.label, item.detail);
+    }
+
+    beginResetModel();
+    rows_ = matcher_.rank(pattern_);
+    endResetModel();
+  }
+};
 
 QuickPickDialog::QuickPickDialog(QWidget* parent) : QDialog(parent) {
   setWindowTitle(tr("Select"));
@@ -102,16 +146,10 @@ QuickPickDialog::QuickPickDialog(QWidget* parent) : QDialog(parent) {
   filterEdit_ = new QLineEdit(this);
   filterEdit_->setPlaceholderText(tr("Type to filter\u2026"));
 
-  model_ = new QStandardItemModel(0, kColCount, this);
-  model_->setHorizontalHeaderLabels({tr("Name"), tr("Detail")});
-
-  proxy_ = new QuickPickFilterProxyModel(this);
-  proxy_->setSourceModel(model_);
-  proxy_->setFilterCaseSensitivity(Qt::CaseInsensitive);
-  proxy_->setSortCaseSensitivity(Qt::CaseInsensitive);
+  model_ = new QuickPickModel(this);
 
   table_ = new QTableView(this);
-  table_->setModel(proxy_);
+  table_->setModel(model_);
   table_->setSelectionBehavior(QAbstractItemView::SelectRows);
   table_->setSelectionMode(QAbstractItemView::SingleSelection);
   table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -132,14 +170,15 @@ QuickPickDialog::QuickPickDialog(QWidget* parent) : QDialog(parent) {
   layout->addWidget(buttons);
 
   connect(filterEdit_, &QLineEdit::textChanged, this, [this](const QString& text) {
-    if (!proxy_) {
+    if (!model_) {
       return;
     }
-    static_cast<QuickPickFilterProxyModel*>(proxy_)->setQuery(text);
-    if (proxy_->rowCount() > 0) {
-      table_->setCurrentIndex(proxy_->index(0, 0));
-      table_->scrollTo(proxy_->index(0, 0));
+    if (provider_) {
+      model_->setRankedItems(provider_(text));
+    } else {
+      model_->setQuery(text);
     }
+    selectFirstRow();
   });
 
   auto updateOkEnabled = [this, buttons] {
@@ -169,46 +208,63 @@ void QuickPickDialog::setItems(QVector<Item> items) {
     return;
   }
 
-  model_->removeRows(0, model_->rowCount());
-  model_->setRowCount(0);
-
-  for (const Item& item : items) {
-    const QString label = stripMnemonics(item.label);
-    if (label.isEmpty()) {
+  QVector<Item> kept;
+  kept.reserve(items.size());
+  for (Item& item : items) {
+    item.label = stripMnemonics(item.label);
+    if (item.label.isEmpty()) {
       continue;
     }
-    auto* labelItem = new QStandardItem(label);
-    labelItem->setData(item.data, kRoleData);
-    if (!item.icon.isNull()) {
-      labelItem->setIcon(item.icon);
-    }
-    auto* detailItem = new QStandardItem(stripMnemonics(item.detail));
-    model_->appendRow({labelItem, detailItem});
+    item.detail = stripMnemonics(item.detail);
+    kept.push_back(std::move(item));
   }
+  model_->setItems(std::move(kept));
 
   table_->resizeColumnsToContents();
-  if (proxy_ && proxy_->rowCount() > 0) {
-    table_->setCurrentIndex(proxy_->index(0, 0));
-    table_->scrollTo(proxy_->index(0, 0));
+  selectFirstRow();
+  if (filterEdit_) {
+    filterEdit_->selectAll();
+    filterEdit_->setFocus();
   }
+}
+
+void QuickPickDialog::setItemProvider(
+    std::function<QVector<Item>(const QString& query)> provider) {
+  if (!model_) {
+    return;
+  }
+  provider_ = std::move(provider);
+  table_->setSortingEnabled(!provider_);
+  refreshItems();
+  table_->resizeColumnsToContents();
   if (filterEdit_) {
     filterEdit_->selectAll();
     filterEdit_->setFocus();
   }
 }
 
+void QuickPickDialog::refreshItems() {
+  if (!model_ || !provider_) {
+    return;
+  }
+  model_->setRankedItems(provider_(filterEdit_ ? filterEdit_->text() : QString{}));
+  selectFirstRow();
+}
+
+void QuickPickDialog::selectFirstRow() {
+  if (model_->rowCount() > 0) {
+    table_->setCurrentIndex(model_->index(0, 0));
+    table_->scrollTo(model_->index(0, 0));
+  }
+}
+
 QVariant QuickPickDialog::selectedData() const {
-  if (!table_ || !proxy_ || !model_) {
+  if (!table_ || !model_) {
     return {};
   }
   const QModelIndex current = table_->currentIndex();
   if (!current.isValid()) {
     return {};
   }
-  const QModelIndex src = proxy_->mapToSource(current);
-  if (!src.isValid()) {
-    return {};
-  }
-  const QModelIndex labelIdx = model_->index(src.row(), kColLabel);
-  return model_->data(labelIdx, kRoleData);
+  return model_->dataAt(current.row());
 }
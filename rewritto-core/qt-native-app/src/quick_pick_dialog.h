@@ -5,10 +5,11 @@
 #include <QVariant>
 #include <QVector>
 
+#include <functional>
+
 class QLineEdit;
-class QStandardItemModel;
-class QSortFilterProxyModel;
 class QTableView;
+class QuickPickModel;
 
 class QuickPickDialog final : public QDialog {
   Q_OBJECT
@@ -25,11 +26,19 @@ class QuickPickDialog final : public QDialog {
 
   void setPlaceholderText(QString placeholderText);
   void setItems(QVector<Item> items);
+  // Asks `provider` for the items of every query instead, shown in the
+  // order given, for lists too large to hand over and rank here.
+  void setItemProvider(std::function<QVector<Item>(const QString& query)> provider);
+  // Asks the provider again for the current query, e.g. after its data
+  // changed.
+  void refreshItems();
   QVariant selectedData() const;
 
  private:
   QLineEdit* filterEdit_ = nullptr;
   QTableView* table_ = nullptr;
-  QStandardItemModel* model_ = nullptr;
-  QSortFilterProxyModel* proxy_ = nullptr;
+  QuickPickModel* model_ = nullptr;
+  std::function<QVector<Item>(const QString& query)> provider_;
+
+  void selectFirstRow();
 };
@@ -0,0 +1,66 @@
+#include "serial_byte_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+SerialByteRing::SerialByteRing(qsizetype capacity) {
+  quint64 rounded = 1;
+  while (rounded < static_cast<quint64>(std::max<qsizetype>(capacity, 1))) {
+    rounded <<= 1;
+  }
+  storage_.resize(static_cast<qsizetype>(rounded));
+  bytes_ = storage_.data();
+  mask_ = rounded - 1;
+}
+
+qsizetype SerialByteRing::capacity() const {
+  return static_cast<qsizetype>(mask_ + 1);
+}
+
+qsizetype SerialByteRing::size() const {
+  const quint64 tail = tail_.load(std::memory_order_acquire);
+  const quint64 head = head_.load(std::memory_order_acquire);
+  return static_cast<qsizetype>(head - tail);
+}
+
+qsizetype SerialByteRing::write(const char* data, qsizetype size) {
+  if (!data || size <= 0) {
+    return 0;
+  }
+  const quint64 head = head_.load(std::memory_order_relaxed);
+  const quint64 tail = tail_.load(std::memory_order_acquire);
+  const quint64 freeBytes = (mask_ + 1) - (head - tail);
+  const quint64 n = std::min<quint64>(static_cast<quint64>(size), freeBytes);
+  if (n == 0) {
+    return 0;
+  }
+  const quint64 offset = head & mask_;
+  const quint64 first = std::min<quint64>(n, (mask_ + 1) - offset);
+  std::memcpy(bytes_ + offset, data, first);
+  std::memcpy(bytes_, data + first, n - first);
+  // Sequentially consistent so a consumer that clears its "delivery pending"
+  // flag and then reads the head cannot miss bytes published just before the
+  // producer checks that flag.
+  head_.store(head + n, std::memory_order_seq_cst);
+  return static_cast<qsizetype>(n);
+}
+
+QByteArray SerialByteRing::readAll() {
+  const quint64 tail = tail_.load(std::memory_order_relaxed);
+  const quint64 head = head_.load(std::memory_order_seq_cst);
+  const quint64 n = head - tail;
+  if (n == 0) {
+    return {};
+  }
+  QByteArray out(static_cast<qsizetype>(n), Qt::Uninitialized);
+  const quint64 offset = tail & mask_;
+  const quint64 first = std::min<quint64>(n, (mask_ + 1) - offset);
+  std::memcpy(out.data(), bytes_ + offset, first);
+  std::memcpy(out.data() + first, bytes_, n - first);
+  tail_.store(head, std::memory_order_release);
+  return out;
+}
+
+void SerialByteRing::clear() {
+  tail_.store(head_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
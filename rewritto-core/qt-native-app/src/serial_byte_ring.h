@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QByteArray>
+
+#include <atomic>
+
+// Single-producer/single-consumer byte ring between the serial reader thread
+// and the GUI thread. Neither side blocks: the producer stores what fits and
+// reports the rest as not stored, the consumer takes whatever is buffered.
+class SerialByteRing final {
+ public:
+  // Rounded up to a power of two.
+  explicit SerialByteRing(qsizetype capacity);
+
+  SerialByteRing(const SerialByteRing&) = delete;
+  SerialByteRing& operator=(const SerialByteRing&) = delete;
+
+  qsizetype capacity() const;
+  qsizetype size() const;
+
+  // Producer side. Returns the number of bytes stored.
+  qsizetype write(const char* data, qsizetype size);
+  // Consumer side. Moves everything buffered so far into one array.
+  QByteArray readAll();
+  // Only while no producer is running.
+  void clear();
+
+ private:
+  QByteArray storage_;
+  char* bytes_ = nullptr;
+  quint64 mask_ = 0;
+  // Head/tail are monotonic byte counters; keep them on separate cache lines
+  // so the two threads don't bounce one line between cores.
+  alignas(64) std::atomic<quint64> head_{0};
+  alignas(64) std::atomic<quint64> tail_{0};
+};
@@ -0,0 +1,212 @@
+#include "serial_log_buffer.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+int SerialLogBuffer::Chunk::lineCount() const {
+  return static_cast<int>(lineEnds.size());
+}
+
+QStringView SerialLogBuffer::Chunk::line(int index) const {
+  const int start = index == 0 ? 0 : lineEnds.at(index - 1);
+  return QStringView(text).mid(start, lineEnds.at(index) - start);
+}
+
+SerialLogBuffer::SerialLogBuffer() {
+  open_.text.reserve(kChunkChars);
+}
+
+qint64 SerialLogBuffer::beginLine() const {
+  return sealed_.isEmpty() ? open_.firstLine : sealed_.first()->firstLine;
+}
+
+qint64 SerialLogBuffer::endLine() const {
+  return open_.firstLine + open_.lineCount();
+}
+
+qint64 SerialLogBuffer::lineCount() const {
+  return endLine() - beginLine();
+}
+
+qint64 SerialLogBuffer::charCount() const {
+  return sealedChars_ + open_.text.size();
+}
+
+QStringView SerialLogBuffer::line(qint64 number) const {
+  if (number >= open_.firstLine) {
+    return open_.line(static_cast<int>(number - open_.firstLine));
+  }
+  auto it = std::upper_bound(
+      sealed_.cbegin(), sealed_.cend(), number,
+      [](qint64 n, const std::shared_ptr<const Chunk>& c) { return n < c->firstLine; });
+  const Chunk& chunk = **(it - 1);
+  return chunk.line(static_cast<int>(number - chunk.firstLine));
+}
+
+void SerialLogBuffer::appendLine(QStringView text) {
+  if (!open_.lineEnds.isEmpty() && open_.text.size() + text.size() > kChunkChars) {
+    sealOpenChunk();
+  }
+  open_.text.append(text);
+  open_.lineEnds.push_back(static_cast<int>(open_.text.size()));
+  if (open_.text.size() >= kChunkChars || open_.lineCount() >= kChunkLines) {
+    sealOpenChunk();
+  }
+  evict();
+}
+
+void SerialLogBuffer::clear() {
+  const qint64 next = endLine();
+  sealed_.clear();
+  sealedChars_ = 0;
+  open_ = Chunk{};
+  open_.firstLine = next;
+  open_.text.reserve(kChunkChars);
+}
+
+qint64 SerialLogBuffer::maxChars() const {
+  return maxChars_;
+}
+
+void SerialLogBuffer::setMaxChars(qint64 maxChars) {
+  maxChars_ = std::max<qint64>(kChunkChars, maxChars);
+  evict();
+}
+
+SerialLogBuffer::ChunkList SerialLogBuffer::sealedChunks() const {
+  return sealed_;
+}
+
+qint64 SerialLogBuffer::sealedEndLine() const {
+  return open_.firstLine;
+}
+
+void SerialLogBuffer::sealOpenChunk() {
+  if (open_.lineEnds.isEmpty()) {
+    return;
+  }
+  open_.text.squeeze();
+  open_.lineEnds.squeeze();
+  auto sealed = std::make_shared<Chunk>(std::move(open_));
+  sealedChars_ += sealed->text.size();
+  open_ = Chunk{};
+  open_.firstLine = sealed->firstLine + sealed->lineCount();
+  open_.text.reserve(kChunkChars);
+  sealed_.push_back(std::move(sealed));
+}
+
+void SerialLogBuffer::evict() {
+  while (!sealed_.isEmpty() && charCount() > maxChars_) {
+    sealedChars_ -= sealed_.first()->text.size();
+    sealed_.removeFirst();
+  }
+}
+
+void SerialLineBitmap::reset(qint64 baseLine) {
+  base_ = baseLine;
+  size_ = 0;
+  count_ = 0;
+  words_.clear();
+  blockRanks_.clear();
+}
+
+qint64 SerialLineBitmap::baseLine() const {
+  return base_;
+}
+
+qint64 SerialLineBitmap::endLine() const {
+  return base_ + size_;
+}
+
+void SerialLineBitmap::append(bool set) {
+  if (size_ % kLinesPerBlock == 0) {
+    blockRanks_.push_back(count_);
+  }
+  if (size_ % 64 == 0) {
+    words_.push_back(0);
+  }
+  if (set) {
+    words_.last() |= quint64(1) << (size_ % 64);
+    ++count_;
+  }
+  ++size_;
+}
+
+void SerialLineBitmap::appendBitmap(const SerialLineBitmap& other) {
+  for (qint64 i = 0; i < other.size_; ++i) {
+    append((other.words_.at(i / 64) >> (i % 64)) & 1);
+  }
+}
+
+bool SerialLineBitmap::contains(qint64 line) const {
+  const qint64 idx = line - base_;
+  if (idx < 0 || idx >= size_) {
+    return false;
+  }
+  return (words_.at(idx / 64) >> (idx % 64)) & 1;
+}
+
+qint64 SerialLineBitmap::rank(qint64 line) const {
+  const qint64 idx = std::min(line - base_, size_);
+  if (idx <= 0) {
+    return 0;
+  }
+  const qint64 block = idx / kLinesPerBlock;
+  if (block >= blockRanks_.size()) {
+    return count_;
+  }
+  qint64 r = blockRanks_.at(block);
+  const qint64 lastWord = idx / 64;
+  for (qint64 w = block * kWordsPerBlock; w < lastWord; ++w) {
+    r += qPopulationCount(words_.at(w));
+  }
+  const int rem = static_cast<int>(idx % 64);
+  if (rem != 0) {
+    r += qPopulationCount(words_.at(lastWord) & ((quint64(1) << rem) - 1));
+  }
+  return r;
+}
+
+qint64 SerialLineBitmap::select(qint64 n) const {
+  if (n < 0 || n >= count_) {
+    return -1;
+  }
+  const auto blockIt = std::upper_bound(blockRanks_.cbegin(), blockRanks_.cend(), n);
+  const qint64 block = (blockIt - blockRanks_.cbegin()) - 1;
+  qint64 r = blockRanks_.at(block);
+  qint64 w = block * kWordsPerBlock;
+  while (true) {
+    const qint64 c = qPopulationCount(words_.at(w));
+    if (r + c > n) {
+      break;
+    }
+    r += c;
+    ++w;
+  }
+  quint64 word = words_.at(w);
+  for (qint64 k = n - r; k > 0; --k) {
+    word &= word - 1;
+  }
+  return base_ + w * 64 + qCountTrailingZeroBits(word);
+}
+
+void SerialLineBitmap::dropBefore(qint64 line) {
+  if (line >= endLine()) {
+    reset(line);
+    return;
+  }
+  const qint64 blocks = (line - base_) / kLinesPerBlock;
+  if (blocks <= 0) {
+    return;
+  }
+  const qint64 removed = blockRanks_.at(blocks);
+  words_.remove(0, blocks * kWordsPerBlock);
+  blockRanks_.remove(0, blocks);
+  for (qint64& r : blockRanks_) {
+    r -= removed;
+  }
+  count_ -= removed;
+  base_ += blocks * kLinesPerBlock;
+  size_ -= blocks * kLinesPerBlock;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <memory>
+
+// Append-only line store for the serial monitor. Text is packed into chunks
+// of about kChunkChars (at most kChunkLines lines); a full chunk is sealed
+// and never modified again, so a worker thread can scan a snapshot of sealed
+// chunks while new lines keep arriving. Lines have absolute numbers that keep
+// counting up when the oldest chunks are evicted to stay under maxChars().
+class SerialLogBuffer final {
+ public:
+  static constexpr int kChunkChars = 64 * 1024;
+  static constexpr int kChunkLines = 8192;
+  static constexpr qint64 kDefaultMaxChars = 64LL * 1024 * 1024;
+
+  struct Chunk final {
+    qint64 firstLine = 0;
+    QString text;
+    QVector<int> lineEnds;  // line i is text[lineEnds[i - 1] (or 0), lineEnds[i])
+
+    int lineCount() const;
+    QStringView line(int index) const;
+  };
+  using ChunkList = QVector<std::shared_ptr<const Chunk>>;
+
+  SerialLogBuffer();
+
+  qint64 beginLine() const;  // oldest retained line
+  qint64 endLine() const;    // one past the newest line
+  qint64 lineCount() const;
+  qint64 charCount() const;
+
+  // `number` must be in [beginLine(), endLine()).
+  QStringView line(qint64 number) const;
+
+  void appendLine(QStringView text);
+  // Drops every line; numbering continues from endLine().
+  void clear();
+
+  qint64 maxChars() const;
+  void setMaxChars(qint64 maxChars);
+
+  // Sealed chunks, oldest first. Lines from sealedEndLine() on live in the
+  // open chunk and are not part of the snapshot.
+  ChunkList sealedChunks() const;
+  qint64 sealedEndLine() const;
+
+ private:
+  ChunkList sealed_;
+  Chunk open_;
+  qint64 sealedChars_ = 0;
+  qint64 maxChars_ = kDefaultMaxChars;
+
+  void sealOpenChunk();
+  void evict();
+};
+
+// Set of line numbers, filled strictly in line order. Keeps a running count
+// per 512-line block so row <-> line mapping in a filtered view is a binary
+// search plus a few popcounts instead of a list of matches.
+class SerialLineBitmap final {
+ public:
+  void reset(qint64 baseLine);
+
+  qint64 baseLine() const;
+  qint64 endLine() const;  // lines [baseLine(), endLine()) have been appended
+
+  void append(bool set);
+  // Appends every line `other` covers; other.baseLine() must equal endLine().
+  void appendBitmap(const SerialLineBitmap& other);
+
+  bool contains(qint64 line) const;
+  // Number of set lines in [baseLine(), line).
+  qint64 rank(qint64 line) const;
+  // Line of the n-th (0-based) set line, or -1.
+  qint64 select(qint64 n) const;
+
+  // Forgets whole blocks before `line` to bound memory after eviction.
+  void dropBefore(qint64 line);
+
+ private:
+  static constexpr int kWordsPerBlock = 8;
+  static constexpr int kLinesPerBlock = kWordsPerBlock * 64;
+
+  qint64 base_ = 0;
+  qint64 size_ = 0;
+  qint64 count_ = 0;
+  QVector<quint64> words_;
+  QVector<qint64> blockRanks_;  // set lines before each block
+};
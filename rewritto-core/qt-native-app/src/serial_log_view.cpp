@@ -0,0 +1,439 @@
+#include "serial_log_view.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QThread>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr int kTextMargin = 4;
+}  // namespace
+
+SerialLogView::SerialLogView(QWidget* parent) : QAbstractScrollArea(parent) {
+  setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  setFocusPolicy(Qt::StrongFocus);
+  viewport()->setCursor(Qt::IBeamCursor);
+  verticalScrollBar()->setSingleStep(1);
+  updateScrollBars();
+}
+
+SerialLogView::~SerialLogView() {
+  cancelFilterWorker();
+}
+
+SerialLogBuffer* SerialLogView::log() {
+  return &log_;
+}
+
+const SerialLogBuffer* SerialLogView::log() const {
+  return &log_;
+}
+
+void SerialLogView::linesAppended(const QString& pendingLine) {
+  pendingLine_ = pendingLine;
+
+  for (qint64 line = std::max(measuredEndLine_, log_.beginLine()); line < log_.endLine();
+       ++line) {
+    longestLineChars_ = std::max(longestLineChars_, log_.line(line).size());
+  }
+  measuredEndLine_ = log_.endLine();
+  longestLineChars_ = std::max(longestLineChars_, pendingLine_.size());
+
+  if (isFiltered()) {
+    matches_.dropBefore(log_.beginLine());
+    matchLines(log_.endLine());
+  }
+  clampSelection();
+  updateScrollBars();
+  viewport()->update();
+}
+
+void SerialLogView::logCleared() {
+  const bool wasPending = isFilterPending();
+  cancelFilterWorker();
+  pendingLine_.clear();
+  measuredEndLine_ = log_.endLine();
+  longestLineChars_ = 0;
+  matches_.reset(log_.endLine());
+  clearSelection();
+  updateScrollBars();
+  viewport()->update();
+  if (wasPending) {
+    emit filterFinished();
+  }
+}
+
+QString SerialLogView::filterText() const {
+  return filter_;
+}
+
+void SerialLogView::setFilterText(const QString& text) {
+  if (text == filter_) {
+    return;
+  }
+  cancelFilterWorker();
+  filter_ = text;
+  clearSelection();
+
+  if (isFiltered()) {
+    if (log_.lineCount() <= kSynchronousFilterLines || log_.sealedChunks().isEmpty()) {
+      matches_.reset(log_.beginLine());
+      matchLines(log_.endLine());
+    } else {
+      startFilterWorker();
+    }
+  }
+  updateScrollBars();
+  viewport()->update();
+  if (!filterThread_) {
+    emit filterFinished();
+  }
+}
+
+bool SerialLogView::isFilterPending() const {
+  return filterThread_ != nullptr;
+}
+
+qint64 SerialLogView::rowCount() const {
+  return committedRowCount() + (pendingRowVisible() ? 1 : 0);
+}
+
+QString SerialLogView::rowText(qint64 row) const {
+  const qint64 committed = committedRowCount();
+  if (row >= 0 && row < committed) {
+    return log_.line(lineForRow(row)).toString();
+  }
+  if (row == committed && pendingRowVisible()) {
+    return pendingLine_;
+  }
+  return {};
+}
+
+QString SerialLogView::toPlainText() const {
+  const qint64 rows = rowCount();
+  QStringList lines;
+  lines.reserve(rows);
+  for (qint64 row = 0; row < rows; ++row) {
+    lines << rowText(row);
+  }
+  return lines.join(QLatin1Char('\n'));
+}
+
+QString SerialLogView::selectedText() const {
+  if (selectionAnchor_ < 0 || selectionEnd_ < 0) {
+    return {};
+  }
+  const qint64 first = rowsBeforeLine(std::min(selectionAnchor_, selectionEnd_));
+  const qint64 end = rowsBeforeLine(std::max(selectionAnchor_, selectionEnd_) + 1);
+  QStringList lines;
+  for (qint64 row = first; row < end; ++row) {
+    lines << rowText(row);
+  }
+  return lines.join(QLatin1Char('\n'));
+}
+
+void SerialLogView::scrollToBottom() {
+  verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
+
+void SerialLogView::paintEvent(QPaintEvent*) {
+  QPainter p(viewport());
+  p.fillRect(viewport()->rect(), palette().base());
+
+  const QFontMetrics fm(font());
+  const int lh = lineHeight();
+  const qint64 rows = rowCount();
+  const qint64 firstRow = verticalScrollBar()->value();
+  const int x = kTextMargin - horizontalScrollBar()->value();
+  const qint64 selectionLow = std::min(selectionAnchor_, selectionEnd_);
+  const qint64 selectionHigh = std::max(selectionAnchor_, selectionEnd_);
+
+  for (int i = 0; i * lh < viewport()->height(); ++i) {
+    const qint64 row = firstRow + i;
+    if (row >= rows) {
+      break;
+    }
+    const int y = i * lh;
+    const qint64 line = lineAtRow(row);
+    const bool selected = selectionLow >= 0 && line >= selectionLow && line <= selectionHigh;
+    if (selected) {
+      p.fillRect(QRect(0, y, viewport()->width(), lh), palette().highlight());
+      p.setPen(palette().highlightedText().color());
+    } else {
+      p.setPen(palette().text().color());
+    }
+    p.drawText(x, y + fm.ascent(), rowText(row));
+  }
+}
+
+void SerialLogView::resizeEvent(QResizeEvent* event) {
+  QAbstractScrollArea::resizeEvent(event);
+  updateScrollBars();
+}
+
+void SerialLogView::changeEvent(QEvent* event) {
+  QAbstractScrollArea::changeEvent(event);
+  if (event->type() == QEvent::FontChange) {
+    updateScrollBars();
+  }
+}
+
+void SerialLogView::keyPressEvent(QKeyEvent* event) {
+  if (event->matches(QKeySequence::Copy)) {
+    const QString text = selectedText();
+    if (!text.isEmpty()) {
+      QApplication::clipboard()->setText(text);
+    }
+    event->accept();
+    return;
+  }
+  if (event->matches(QKeySequence::SelectAll)) {
+    selectAll();
+    event->accept();
+    return;
+  }
+  if (event->matches(QKeySequence::MoveToStartOfDocument)) {
+    verticalScrollBar()->setValue(0);
+    event->accept();
+    return;
+  }
+  if (event->matches(QKeySequence::MoveToEndOfDocument)) {
+    scrollToBottom();
+    event->accept();
+    return;
+  }
+  QAbstractScrollArea::keyPressEvent(event);
+}
+
+void SerialLogView::mousePressEvent(QMouseEvent* event) {
+  if (event->button() != Qt::LeftButton) {
+    QAbstractScrollArea::mousePressEvent(event);
+    return;
+  }
+  const qint64 line = lineAtRow(rowAt(event->position().toPoint()));
+  if ((event->modifiers() & Qt::ShiftModifier) && selectionAnchor_ >= 0 && line >= 0) {
+    selectionEnd_ = line;
+  } else {
+    selectionAnchor_ = line;
+    selectionEnd_ = line;
+  }
+  viewport()->update();
+}
+
+void SerialLogView::mouseMoveEvent(QMouseEvent* event) {
+  if (!(event->buttons() & Qt::LeftButton) || selectionAnchor_ < 0) {
+    QAbstractScrollArea::mouseMoveEvent(event);
+    return;
+  }
+  const QPoint pos = event->position().toPoint();
+  if (pos.y() < 0) {
+    verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
+  } else if (pos.y() >= viewport()->height()) {
+    verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+  }
+  const qint64 line = lineAtRow(rowAt(pos));
+  if (line >= 0) {
+    selectionEnd_ = line;
+  }
+  viewport()->update();
+}
+
+void SerialLogView::contextMenuEvent(QContextMenuEvent* event) {
+  QMenu menu(this);
+  QAction* copy = menu.addAction(tr("Copy"));
+  copy->setEnabled(selectionAnchor_ >= 0);
+  connect(copy, &QAction::triggered, this, [this] {
+    QApplication::clipboard()->setText(selectedText());
+  });
+  QAction* selectAllAction = menu.addAction(tr("Select All"));
+  connect(selectAllAction, &QAction::triggered, this, [this] { selectAll(); });
+  menu.exec(event->globalPos());
+}
+
+bool SerialLogView::isFiltered() const {
+  return !filter_.isEmpty();
+}
+
+bool SerialLogView::pendingRowVisible() const {
+  if (!isFiltered()) {
+    return true;
+  }
+  return !pendingLine_.isEmpty() && pendingLine_.contains(filter_, Qt::CaseInsensitive);
+}
+
+qint64 SerialLogView::committedRowCount() const {
+  if (!isFiltered()) {
+    return log_.lineCount();
+  }
+  return matches_.rank(matches_.endLine()) - matches_.rank(log_.beginLine());
+}
+
+qint64 SerialLogView::lineForRow(qint64 row) const {
+  if (!isFiltered()) {
+    return log_.beginLine() + row;
+  }
+  return matches_.select(matches_.rank(log_.beginLine()) + row);
+}
+
+qint64 SerialLogView::lineAtRow(qint64 row) const {
+  if (row < 0 || row >= rowCount()) {
+    return -1;
+  }
+  return row < committedRowCount() ? lineForRow(row) : log_.endLine();
+}
+
+qint64 SerialLogView::rowsBeforeLine(qint64 line) const {
+  const qint64 begin = log_.beginLine();
+  qint64 rows = 0;
+  if (line > begin) {
+    rows = isFiltered() ? matches_.rank(line) - matches_.rank(begin)
+                        : std::min(line, log_.endLine()) - begin;
+  }
+  if (line > log_.endLine() && pendingRowVisible()) {
+    ++rows;
+  }
+  return rows;
+}
+
+void SerialLogView::matchLines(qint64 endLine) {
+  for (qint64 line = matches_.endLine(); line < endLine; ++line) {
+    matches_.append(log_.line(line).contains(filter_, Qt::CaseInsensitive));
+  }
+}
+
+void SerialLogView::startFilterWorker() {
+  const qint64 from = log_.beginLine();
+  const SerialLogBuffer::ChunkList chunks = log_.sealedChunks();
+
+  // Lines in the open chunk (and any that arrive while the worker runs) are
+  // matched here; the worker covers the sealed snapshot.
+  matches_.reset(log_.sealedEndLine());
+  matchLines(log_.endLine());
+
+  auto cancel = std::make_shared<std::atomic_bool>(false);
+  filterCancel_ = cancel;
+  const quint64 generation = ++filterGeneration_;
+  const QString needle = filter_;
+  filterThread_ = QThread::create([this, chunks, from, needle, cancel, generation] {
+    SerialLineBitmap result;
+    result.reset(from);
+    for (const auto& chunk : chunks) {
+      for (int i = 0; i < chunk->lineCount(); ++i) {
+        result.append(chunk->line(i).contains(needle, Qt::CaseInsensitive));
+      }
+      if (cancel->load()) {
+        return;
+      }
+    }
+    QMetaObject::invokeMethod(
+        this, [this, generation, result] { finishFilterWorker(generation, result); },
+        Qt::QueuedConnection);
+  });
+  filterThread_->start();
+}
+
+void SerialLogView::finishFilterWorker(quint64 generation, const SerialLineBitmap& result) {
+  if (generation != filterGeneration_ || !filterThread_) {
+    return;
+  }
+  filterThread_->wait();
+  delete filterThread_;
+  filterThread_ = nullptr;
+  filterCancel_.reset();
+
+  // If eviction moved past the snapshot meanwhile, its lines are gone and
+  // matches_ already starts later; there is nothing to prepend.
+  if (result.endLine() == matches_.baseLine()) {
+    SerialLineBitmap merged = result;
+    merged.appendBitmap(matches_);
+    merged.dropBefore(log_.beginLine());
+    matches_ = std::move(merged);
+  }
+  updateScrollBars();
+  viewport()->update();
+  emit filterFinished();
+}
+
+void SerialLogView::cancelFilterWorker() {
+  if (!filterThread_) {
+    return;
+  }
+  filterCancel_->store(true);
+  filterThread_->wait();
+  delete filterThread_;
+  filterThread_ = nullptr;
+  filterCancel_.reset();
+  ++filterGeneration_;
+}
+
+void SerialLogView::clearSelection() {
+  selectionAnchor_ = -1;
+  selectionEnd_ = -1;
+}
+
+void SerialLogView::selectAll() {
+  selectionAnchor_ = log_.beginLine();
+  selectionEnd_ = log_.endLine();
+  viewport()->update();
+}
+
+// Evicted lines drop out of the selection; a selection of only evicted
+// lines is cleared.
+void SerialLogView::clampSelection() {
+  if (selectionAnchor_ < 0) {
+    return;
+  }
+  const qint64 begin = log_.beginLine();
+  if (std::max(selectionAnchor_, selectionEnd_) < begin) {
+    clearSelection();
+    return;
+  }
+  selectionAnchor_ = std::max(selectionAnchor_, begin);
+  selectionEnd_ = std::max(selectionEnd_, begin);
+}
+
+int SerialLogView::lineHeight() const {
+  return std::max(1, QFontMetrics(font()).lineSpacing());
+}
+
+int SerialLogView::visibleRowCount() const {
+  return std::max(1, viewport()->height() / lineHeight());
+}
+
+qint64 SerialLogView::rowAt(const QPoint& viewportPos) const {
+  const qint64 rows = rowCount();
+  if (rows == 0) {
+    return -1;
+  }
+  const qint64 row =
+      verticalScrollBar()->value() + std::max(0, viewportPos.y()) / lineHeight();
+  return std::min(row, rows - 1);
+}
+
+void SerialLogView::updateScrollBars() {
+  const int page = visibleRowCount();
+  const qint64 maxFirstRow = std::max<qint64>(0, rowCount() - page);
+  verticalScrollBar()->setPageStep(page);
+  verticalScrollBar()->setRange(
+      0, static_cast<int>(std::min<qint64>(maxFirstRow, std::numeric_limits<int>::max())));
+
+  const QFontMetrics fm(font());
+  const qint64 contentWidth =
+      longestLineChars_ * fm.horizontalAdvance(QLatin1Char('M')) + 2 * kTextMargin;
+  const int viewportWidth = viewport()->width();
+  horizontalScrollBar()->setPageStep(viewportWidth);
+  horizontalScrollBar()->setSingleStep(fm.horizontalAdvance(QLatin1Char('M')) * 4);
+  horizontalScrollBar()->setRange(
+      0, static_cast<int>(std::clamp<qint64>(contentWidth - viewportWidth, 0,
+                                             std::numeric_limits<int>::max())));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+
+#include <atomic>
+#include <memory>
+
+#include "serial_log_buffer.h"
+
+class QThread;
+
+// Read-only view over a SerialLogBuffer that paints only the rows in the
+// viewport. Rows are the committed log lines followed by the pending
+// (unterminated) line. With a filter set, rows are the matching lines: new
+// lines are matched as they arrive, and changing the filter on a large log
+// rescans the sealed chunks on a worker thread.
+class SerialLogView final : public QAbstractScrollArea {
+  Q_OBJECT
+
+ public:
+  // Logs up to this many lines are re-filtered synchronously.
+  static constexpr qint64 kSynchronousFilterLines = 20000;
+
+  explicit SerialLogView(QWidget* parent = nullptr);
+  ~SerialLogView() override;
+
+  SerialLogBuffer* log();
+  const SerialLogBuffer* log() const;
+
+  // Call after appending to log(); `pendingLine` is the line still being
+  // received.
+  void linesAppended(const QString& pendingLine);
+  // Call after log()->clear().
+  void logCleared();
+
+  QString filterText() const;
+  void setFilterText(const QString& text);
+  bool isFilterPending() const;
+
+  qint64 rowCount() const;
+  QString rowText(qint64 row) const;
+  // Visible rows joined with '\n'.
+  QString toPlainText() const;
+  QString selectedText() const;
+
+  void scrollToBottom();
+
+ signals:
+  void filterFinished();
+
+ protected:
+  void paintEvent(QPaintEvent* event) override;
+  void resizeEvent(QResizeEvent* event) override;
+  void changeEvent(QEvent* event) override;
+  void keyPressEvent(QKeyEvent* event) override;
+  void mousePressEvent(QMouseEvent* event) override;
+  void mouseMoveEvent(QMouseEvent* event) override;
+  void contextMenuEvent(QContextMenuEvent* event) override;
+
+ private:
+  SerialLogBuffer log_;
+  QString pendingLine_;
+  qint64 measuredEndLine_ = 0;  // lines before this count towards longestLineChars_
+  qsizetype longestLineChars_ = 0;
+
+  QString filter_;
+  // Matches for lines [matches_.baseLine(), matches_.endLine()). While a
+  // worker is scanning, it covers only the lines from the worker's snapshot
+  // end onwards and the worker's result is prepended when it arrives.
+  SerialLineBitmap matches_;
+  QThread* filterThread_ = nullptr;
+  std::shared_ptr<std::atomic_bool> filterCancel_;
+  quint64 filterGeneration_ = 0;
+
+  // Selected lines as absolute line numbers, so the selection stays on the
+  // same text while rows shift; the pending row is line log_.endLine().
+  qint64 selectionAnchor_ = -1;
+  qint64 selectionEnd_ = -1;
+
+  bool isFiltered() const;
+  bool pendingRowVisible() const;
+  qint64 committedRowCount() const;
+  qint64 lineForRow(qint64 row) const;
+  // Line shown in `row`, including the pending row, or -1.
+  qint64 lineAtRow(qint64 row) const;
+  // Number of rows showing lines before `line`.
+  qint64 rowsBeforeLine(qint64 line) const;
+  void matchLines(qint64 endLine);
+  void startFilterWorker();
+  void finishFilterWorker(quint64 generation, const SerialLineBitmap& result);
+  void cancelFilterWorker();
+  void clearSelection();
+  void selectAll();
+  void clampSelection();
+  int lineHeight() const;
+  int visibleRowCount() const;
+  qint64 rowAt(const QPoint& viewportPos) const;
+  void updateScrollBars();
+};
@@ -1,5 +1,7 @@
 #include "serial_monitor_widget.h"
 
+#include "serial_log_view.h"
+
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDateTime>
@@ -12,16 +14,14 @@
 #include <QKeyEvent>
 #include <QLabel>
 #include <QLineEdit>
-#include <QPlainTextEdit>
+#include <QLocale>
 #include <QPushButton>
-#include <QScrollBar>
 #include <QSettings>
-#include <QTextBlock>
-#include <QTextCursor>
-#include <QTextDocument>
 #include <QTime>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
 namespace {
 QString normalizedNewlines(QString text) {
   text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
@@ -80,13 +80,15 @@ SerialMonitorWidget::SerialMonitorWidget(QWidget* parent) : QWidget(parent) {
 
   statusLabel_ = new QLabel(tr("Disconnected"), this);
 
-  output_ = new QPlainTextEdit(this);
+  droppedLabel_ = new QLabel(this);
+  droppedLabel_->setObjectName("serialMonitorDropped");
+  droppedLabel_->setStyleSheet("QLabel { color: red; }");
+  droppedLabel_->setToolTip(
+      tr("Received bytes discarded because the monitor could not keep up"));
+  droppedLabel_->hide();
+
+  output_ = new SerialLogView(this);
   output_->setObjectName("serialMonitorOutput");
-  output_->setReadOnly(true);
-  rawOutputDocument_ = new QTextDocument(output_);
-  rawOutputDocument_->setMaximumBlockCount(5000);
-  filteredOutputDocument_ = new QTextDocument(output_);
-  output_->setDocument(rawOutputDocument_);
 
   input_ = new QLineEdit(this);
   input_->setObjectName("serialMonitorInput");
@@ -122,7 +124,12 @@ SerialMonitorWidget::SerialMonitorWidget(QWidget* parent) : QWidget(parent) {
   auto* layout = new QVBoxLayout(this);
   layout->setContentsMargins(6, 6, 6, 6);
   layout->addLayout(topRow);
-  layout->addWidget(statusLabel_);
+  {
+    auto* statusRow = new QHBoxLayout();
+    statusRow->addWidget(statusLabel_, 1);
+    statusRow->addWidget(droppedLabel_);
+    layout->addLayout(statusRow);
+  }
   layout->addLayout(filterRow);
   layout->addWidget(output_, 1);
   layout->addLayout(bottomRow);
@@ -176,13 +183,8 @@ SerialMonitorWidget::SerialMonitorWidget(QWidget* parent) : QWidget(parent) {
     lineText_.clear();
     lineCursor_ = 0;
     lineContentStart_ = 0;
-    if (rawOutputDocument_) {
-      rawOutputDocument_->clear();
-    }
-    if (filteredOutputDocument_) {
-      filteredOutputDocument_->clear();
-    }
-    applyOutputFilter();
+    output_->log()->clear();
+    output_->logCleared();
   });
   connect(saveButton_, &QPushButton::clicked, this, [this] {
     const QString stamp =
@@ -201,19 +203,25 @@ SerialMonitorWidget::SerialMonitorWidget(QWidget* parent) : QWidget(parent) {
       showError(tr("Could not write log file."));
       return;
     }
-    const QString logText =
-        rawOutputDocument_ ? rawOutputDocument_->toPlainText()
-                           : output_->toPlainText();
-    f.write(logText.toUtf8());
+    // The whole capture, regardless of the filter, streamed line by line.
+    const SerialLogBuffer* log = output_->log();
+    for (qint64 line = log->beginLine(); line < log->endLine(); ++line) {
+      f.write(log->line(line).toUtf8());
+      f.write("\n");
+    }
+    f.write(lineText_.toUtf8());
     f.close();
     statusLabel_->setText(tr("Saved log to %1").arg(QFileInfo(filePath).fileName()));
   });
-  connect(filterInput_, &QLineEdit::textChanged, this, [this](const QString&) {
-    applyOutputFilter();
+  connect(filterInput_, &QLineEdit::textChanged, this, [this](const QString& text) {
+    output_->setFilterText(text);
     if (autoScrollCheck_ && autoScrollCheck_->isChecked()) {
-      if (auto* sb = output_->verticalScrollBar()) {
-        sb->setValue(sb->maximum());
-      }
+      output_->scrollToBottom();
+    }
+  });
+  connect(output_, &SerialLogView::filterFinished, this, [this] {
+    if (autoScrollCheck_ && autoScrollCheck_->isChecked()) {
+      output_->scrollToBottom();
     }
   });
   connect(sendButton_, &QPushButton::clicked, this, [this] { emitSend(); });
@@ -283,143 +291,96 @@ void SerialMonitorWidget::setConnected(bool connected) {
 }
 
 void SerialMonitorWidget::appendData(QByteArray data) {
-  if (data.isEmpty()) {
+  if (data.isEmpty() || !output_) {
     return;
   }
 
-  if (!output_ || !rawOutputDocument_) {
-    return;
-  }
-
-  QString text = QString::fromUtf8(data.constData(), data.size());
+  const QString text = QString::fromUtf8(data.constData(), data.size());
   if (text.isEmpty()) {
     return;
   }
 
-  QTextDocument* doc = rawOutputDocument_;
-  bool dirtyLine = false;
-
-  auto commitLineText = [this, doc] {
-    if (!doc) {
-      return;
-    }
-    const QTextBlock block = doc->lastBlock();
-    const int start = block.position();
-    const int end = start + block.text().size();
-    QTextCursor c(doc);
-    c.setPosition(start);
-    c.setPosition(end, QTextCursor::KeepAnchor);
-    c.insertText(lineText_);
-  };
-
-  auto ensureTimestampPrefix = [this, &dirtyLine] {
-    if (!timestampsCheck_ || !timestampsCheck_->isChecked()) {
-      return;
-    }
-    if (!atLineStart_) {
+  SerialLogBuffer* log = output_->log();
+  const bool timestamps = timestampsCheck_ && timestampsCheck_->isChecked();
+  auto ensureTimestampPrefix = [this, timestamps] {
+    if (!timestamps || !atLineStart_) {
       return;
     }
     lineText_ += timestampPrefix();
     lineContentStart_ = lineText_.size();
     lineCursor_ = lineText_.size();
     atLineStart_ = false;
-    dirtyLine = true;
   };
 
-  for (int i = 0; i < text.size(); ++i) {
-    const QChar ch = text.at(i);
+  const QChar* chars = text.constData();
+  const qsizetype size = text.size();
+  qsizetype i = 0;
+  while (i < size) {
+    const QChar ch = chars[i];
     if (ch == QLatin1Char('\r')) {
       if (!atLineStart_) {
         lineCursor_ = lineContentStart_;
       }
+      ++i;
       continue;
     }
 
     if (ch == QLatin1Char('\n')) {
       ensureTimestampPrefix();
-      if (dirtyLine) {
-        commitLineText();
-        dirtyLine = false;
-      }
-
-      QTextCursor c(doc);
-      c.movePosition(QTextCursor::End);
-      c.insertText(QStringLiteral("\n"));
-
+      log->appendLine(lineText_);
       atLineStart_ = true;
       lineText_.clear();
       lineCursor_ = 0;
       lineContentStart_ = 0;
+      ++i;
       continue;
     }
 
     ensureTimestampPrefix();
-    if (atLineStart_) {
-      atLineStart_ = false;
-    }
+    atLineStart_ = false;
 
-    if (lineCursor_ < 0) {
-      lineCursor_ = 0;
+    // Copy the run up to the next control character in one go; only a
+    // preceding '\r' makes it overwrite existing text.
+    qsizetype runEnd = i;
+    while (runEnd < size && chars[runEnd] != QLatin1Char('\r') &&
+           chars[runEnd] != QLatin1Char('\n')) {
+      ++runEnd;
     }
-    if (lineCursor_ > lineText_.size()) {
-      lineCursor_ = lineText_.size();
-    }
-
-    if (lineCursor_ < lineText_.size()) {
-      lineText_[lineCursor_] = ch;
-    } else {
-      lineText_.append(ch);
+    const QStringView run(chars + i, runEnd - i);
+    lineCursor_ = std::clamp(lineCursor_, 0, static_cast<int>(lineText_.size()));
+    const qsizetype overwrite =
+        std::min<qsizetype>(run.size(), lineText_.size() - lineCursor_);
+    if (overwrite > 0) {
+      lineText_.replace(lineCursor_, overwrite, run.first(overwrite).toString());
     }
-    ++lineCursor_;
-    dirtyLine = true;
+    lineText_.append(run.mid(overwrite));
+    lineCursor_ += static_cast<int>(run.size());
+    i = runEnd;
   }
 
-  if (dirtyLine) {
-    commitLineText();
-  }
-
-  applyOutputFilter();
+  output_->linesAppended(lineText_);
 
   if (autoScrollCheck_->isChecked()) {
-    if (auto* sb = output_->verticalScrollBar()) {
-      sb->setValue(sb->maximum());
-    }
+    output_->scrollToBottom();
   }
 }
 
-void SerialMonitorWidget::showError(QString message) {
-  if (message.trimmed().isEmpty()) {
+void SerialMonitorWidget::setDroppedBytes(qint64 droppedBytes) {
+  if (droppedBytes <= 0) {
+    droppedLabel_->clear();
+    droppedLabel_->hide();
     return;
   }
-  statusLabel_->setText(tr("Error: %1").arg(message));
+  droppedLabel_->setText(
+      tr("Dropped: %1").arg(QLocale().formattedDataSize(droppedBytes)));
+  droppedLabel_->show();
 }
 
-void SerialMonitorWidget::applyOutputFilter() {
-  if (!output_ || !rawOutputDocument_ || !filteredOutputDocument_) {
-    return;
-  }
-
-  const QString filterText = filterInput_ ? filterInput_->text() : QString{};
-  if (filterText.isEmpty()) {
-    if (output_->document() != rawOutputDocument_) {
-      output_->setDocument(rawOutputDocument_);
-    }
+void SerialMonitorWidget::showError(QString message) {
+  if (message.trimmed().isEmpty()) {
     return;
   }
-
-  QStringList filteredLines;
-  for (QTextBlock block = rawOutputDocument_->begin(); block.isValid();
-       block = block.next()) {
-    const QString line = block.text();
-    if (line.contains(filterText, Qt::CaseInsensitive)) {
-      filteredLines.push_back(line);
-    }
-  }
-
-  filteredOutputDocument_->setPlainText(filteredLines.join(QLatin1Char('\n')));
-  if (output_->document() != filteredOutputDocument_) {
-    output_->setDocument(filteredOutputDocument_);
-  }
+  statusLabel_->setText(tr("Error: %1").arg(message));
 }
 
 bool SerialMonitorWidget::eventFilter(QObject* watched, QEvent* event) {
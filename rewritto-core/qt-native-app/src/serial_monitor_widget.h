@@ -7,9 +7,8 @@ class QCheckBox;
 class QComboBox;
 class QLabel;
 class QLineEdit;
-class QPlainTextEdit;
 class QPushButton;
-class QTextDocument;
+class SerialLogView;
 
 class SerialMonitorWidget final : public QWidget {
   Q_OBJECT
@@ -24,6 +23,8 @@ class SerialMonitorWidget final : public QWidget {
  public slots:
   void setConnected(bool connected);
   void appendData(QByteArray data);
+  // Shows the serial port's overflow counter; hidden while it is zero.
+  void setDroppedBytes(qint64 droppedBytes);
   void showError(QString message);
 
  signals:
@@ -51,17 +52,15 @@ class SerialMonitorWidget final : public QWidget {
   QPushButton* saveButton_ = nullptr;
   QPushButton* clearButton_ = nullptr;
   QLineEdit* filterInput_ = nullptr;
-  QPlainTextEdit* output_ = nullptr;
-  QTextDocument* rawOutputDocument_ = nullptr;
-  QTextDocument* filteredOutputDocument_ = nullptr;
+  SerialLogView* output_ = nullptr;
   QLineEdit* input_ = nullptr;
   QPushButton* sendButton_ = nullptr;
   QLabel* statusLabel_ = nullptr;
+  QLabel* droppedLabel_ = nullptr;
 
   bool eventFilter(QObject* watched, QEvent* event) override;
 
   void emitSend();
   QByteArray currentLineEndingBytes() const;
   void appendToSendHistory(QString entry);
-  void applyOutputFilter();
 };
@@ -0,0 +1,120 @@
+#include "serial_plot_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr double kEmptyMin = std::numeric_limits<double>::infinity();
+constexpr double kEmptyMax = -std::numeric_limits<double>::infinity();
+
+void merge(SerialPlotSeriesBuffer::MinMax* out, double min, double max) {
+  if (!(min <= max)) {
+    return;
+  }
+  if (!out->hasValue) {
+    out->hasValue = true;
+    out->min = min;
+    out->max = max;
+    return;
+  }
+  out->min = std::min(out->min, min);
+  out->max = std::max(out->max, max);
+}
+}  // namespace
+
+SerialPlotSeriesBuffer::SerialPlotSeriesBuffer(int capacity, qint64 startIndex)
+    : capacity_(std::max(1, capacity)),
+      start_(std::max<qint64>(0, startIndex)),
+      end_(start_) {
+  ring_.resize(capacity_);
+  for (qint64 blockSize = kFanOut; blockSize <= capacity_; blockSize *= kFanOut) {
+    Level level;
+    level.blockSize = blockSize;
+    // Enough slots for every block that overlaps the retained window.
+    const int blocks = static_cast<int>(capacity_ / blockSize) + 2;
+    level.mins.fill(kEmptyMin, blocks);
+    level.maxs.fill(kEmptyMax, blocks);
+    levels_.push_back(std::move(level));
+  }
+}
+
+int SerialPlotSeriesBuffer::capacity() const {
+  return capacity_;
+}
+
+qint64 SerialPlotSeriesBuffer::beginIndex() const {
+  return std::max(start_, end_ - capacity_);
+}
+
+qint64 SerialPlotSeriesBuffer::endIndex() const {
+  return end_;
+}
+
+int SerialPlotSeriesBuffer::size() const {
+  return static_cast<int>(end_ - beginIndex());
+}
+
+void SerialPlotSeriesBuffer::push(double value) {
+  const qint64 index = end_++;
+  ring_[static_cast<int>(index % capacity_)] = value;
+
+  const bool gap = std::isnan(value);
+  for (Level& level : levels_) {
+    const qint64 block = index / level.blockSize;
+    const int slot = static_cast<int>(block % level.mins.size());
+    if (index % level.blockSize == 0 || index == start_) {
+      level.mins[slot] = kEmptyMin;
+      level.maxs[slot] = kEmptyMax;
+    }
+    if (!gap) {
+      level.mins[slot] = std::min(level.mins[slot], value);
+      level.maxs[slot] = std::max(level.maxs[slot], value);
+    }
+  }
+}
+
+double SerialPlotSeriesBuffer::valueAt(qint64 index) const {
+  if (index < beginIndex() || index >= end_) {
+    return std::nan("");
+  }
+  return ring_[static_cast<int>(index % capacity_)];
+}
+
+SerialPlotSeriesBuffer::MinMax SerialPlotSeriesBuffer::minMax(qint64 begin,
+                                                              qint64 end) const {
+  MinMax out;
+  qint64 a = std::max(begin, beginIndex());
+  const qint64 b = std::min(end, end_);
+  // Greedy left-to-right cover: the largest aligned block that fits, else a
+  // single sample. At most 2 * (kFanOut - 1) steps per level.
+  while (a < b) {
+    bool usedBlock = false;
+    for (int l = static_cast<int>(levels_.size()) - 1; l >= 0; --l) {
+      const Level& level = levels_.at(l);
+      if (a % level.blockSize != 0 || a + level.blockSize > b) {
+        continue;
+      }
+      const int slot = static_cast<int>((a / level.blockSize) % level.mins.size());
+      merge(&out, level.mins.at(slot), level.maxs.at(slot));
+      a += level.blockSize;
+      usedBlock = true;
+      break;
+    }
+    if (!usedBlock) {
+      const double v = ring_.at(static_cast<int>(a % capacity_));
+      merge(&out, v, v);
+      ++a;
+    }
+  }
+  return out;
+}
+
+SerialPlotSeriesBuffer SerialPlotSeriesBuffer::withCapacity(int capacity) const {
+  const qint64 keepFrom = std::max(beginIndex(), end_ - std::max(1, capacity));
+  SerialPlotSeriesBuffer out(capacity, std::max(start_, keepFrom));
+  for (qint64 i = keepFrom; i < end_; ++i) {
+    out.push(ring_.at(static_cast<int>(i % capacity_)));
+  }
+  return out;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QVector>
+
+// Fixed-capacity sample ring for one plotted series. Samples are addressed by
+// an ever-growing absolute index; once the ring is full the oldest sample
+// falls out on every push. A min/max pyramid over aligned blocks of 16, 256,
+// 4096, ... samples answers range queries in time independent of the range
+// length, which keeps autoscale and per-column decimation cheap for windows
+// of millions of samples.
+class SerialPlotSeriesBuffer final {
+ public:
+  static constexpr int kFanOut = 16;
+
+  struct MinMax final {
+    bool hasValue = false;
+    double min = 0.0;
+    double max = 0.0;
+  };
+
+  // `startIndex` is the absolute index of the first pushed sample, so series
+  // that appear mid-stream stay aligned with older ones.
+  explicit SerialPlotSeriesBuffer(int capacity = 250, qint64 startIndex = 0);
+
+  int capacity() const;
+  qint64 beginIndex() const;  // oldest retained sample
+  qint64 endIndex() const;    // one past the newest sample
+  int size() const;
+
+  void push(double value);  // NaN marks a gap
+  double valueAt(qint64 index) const;  // NaN outside [beginIndex, endIndex)
+  // Min/max of the non-NaN samples in [begin, end) clipped to the buffer.
+  MinMax minMax(qint64 begin, qint64 end) const;
+
+  // Copy that keeps the newest `capacity` samples.
+  SerialPlotSeriesBuffer withCapacity(int capacity) const;
+
+ private:
+  struct Level final {
+    qint64 blockSize = 0;
+    QVector<double> mins;
+    QVector<double> maxs;
+  };
+
+  int capacity_ = 0;
+  qint64 start_ = 0;
+  qint64 end_ = 0;
+  QVector<double> ring_;
+  QVector<Level> levels_;
+};
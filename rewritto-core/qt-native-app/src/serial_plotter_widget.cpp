@@ -1,8 +1,10 @@
 #include "serial_plotter_widget.h"
 
+#include "serial_plot_buffer.h"
 #include "serial_plot_parser.h"
 #include "serial_plot_range.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QComboBox>
@@ -36,8 +38,7 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
   }
 
   void setFreezeRangeEnabled(bool enabled) {
-    const SerialPlotYRange autoRange = serialPlotComputeAutoRange(series_);
-    rangeController_.updateAutoRange(autoRange);
+    rangeController_.updateAutoRange(computeAutoRange());
     rangeController_.setFreezeEnabled(enabled);
     update();
   }
@@ -56,6 +57,22 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
     update();
   }
 
+  int retentionSamples() const {
+    return retentionSamples_;
+  }
+
+  void setRetentionSamples(int samples) {
+    samples = std::max(2, samples);
+    if (samples == retentionSamples_) {
+      return;
+    }
+    retentionSamples_ = samples;
+    for (auto& s : series_) {
+      s = s.withCapacity(retentionSamples_);
+    }
+    update();
+  }
+
   QStringList seriesLabels() const {
     return seriesLabels_;
   }
@@ -88,10 +105,8 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       return {};
     }
 
-    int sampleCount = 0;
-    for (const auto& s : series_) {
-      sampleCount = std::max(sampleCount, static_cast<int>(s.size()));
-    }
+    const qint64 first = windowBegin();
+    const int sampleCount = static_cast<int>(sampleCount_ - first);
     if (sampleCount <= 0) {
       return {};
     }
@@ -118,11 +133,9 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       out += QString::number(row);
       for (int i = 0; i < seriesCount; ++i) {
         out += QLatin1Char(',');
-        if (row < series_[i].size()) {
-          const double v = series_[i][row];
-          if (!std::isnan(v)) {
-            out += c.toString(v, 'g', 12);
-          }
+        const double v = series_[i].valueAt(first + row);
+        if (!std::isnan(v)) {
+          out += c.toString(v, 'g', 12);
         }
       }
       out += QLatin1Char('\n');
@@ -157,36 +170,25 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       labelToIndex_.insert(key, idx);
       seriesLabels_.push_back(key);
       seriesVisible_.push_back(true);
-      QVector<double> vec(sampleCount_, std::nan(""));
-      series_.push_back(vec);
-    }
-
-    for (auto& s : series_) {
-      s.push_back(std::nan(""));
+      series_.push_back(SerialPlotSeriesBuffer(retentionSamples_, sampleCount_));
     }
-    ++sampleCount_;
 
+    rowValues_.fill(std::nan(""), series_.size());
     for (int i = 0; i < effectiveLabels.size(); ++i) {
       const QString key = effectiveLabels.at(i).trimmed();
       if (key.isEmpty()) {
         continue;
       }
       const int idx = labelToIndex_.value(key, -1);
-      if (idx < 0 || idx >= series_.size() || series_[idx].isEmpty()) {
+      if (idx < 0 || idx >= series_.size()) {
         continue;
       }
-      series_[idx].last() = values.at(i);
+      rowValues_[idx] = values.at(i);
     }
-
-    if (sampleCount_ > maxSamples_) {
-      const int removeCount = sampleCount_ - maxSamples_;
-      for (auto& s : series_) {
-        if (removeCount > 0 && removeCount <= s.size()) {
-          s.remove(0, removeCount);
-        }
-      }
-      sampleCount_ = maxSamples_;
+    for (int i = 0; i < series_.size(); ++i) {
+      series_[i].push(rowValues_.at(i));
     }
+    ++sampleCount_;
     update();
     return series_.size() != oldSeriesCount;
   }
@@ -205,7 +207,7 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       return;
     }
 
-    const SerialPlotYRange autoRange = serialPlotComputeAutoRange(series_);
+    const SerialPlotYRange autoRange = computeAutoRange();
     if (!autoRange.hasValue) {
       p.setPen(palette().text().color());
       p.drawText(plotRect, Qt::AlignCenter, tr("(no data)"));
@@ -231,7 +233,8 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
     p.drawText(QRect(plotRect.left() - 34, plotRect.bottom() - 14, 32, 14),
                Qt::AlignRight | Qt::AlignVCenter, QString::number(minY, 'g', 4));
 
-    const int sampleCount = series_.isEmpty() ? 0 : series_.first().size();
+    const qint64 first = windowBegin();
+    const qint64 sampleCount = sampleCount_ - first;
     if (sampleCount < 2) {
       return;
     }
@@ -240,10 +243,14 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       const double t = (v - minY) / (maxY - minY);
       return plotRect.bottom() - static_cast<int>(t * plotRect.height());
     };
-    auto mapX = [&](int idx) {
+    auto mapX = [&](qint64 idx) {
       const double t = static_cast<double>(idx) / static_cast<double>(sampleCount - 1);
       return plotRect.left() + static_cast<int>(t * plotRect.width());
     };
+    // More than two samples per pixel column: draw each column's min/max
+    // instead of every sample, so frame cost depends on width, not history.
+    const int columns = plotRect.width();
+    const bool decimate = sampleCount > static_cast<qint64>(columns) * 2;
 
     // Series
     for (int si = 0; si < series_.size(); ++si) {
@@ -254,20 +261,41 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
       QPen pen(c, 2);
       p.setPen(pen);
 
+      const SerialPlotSeriesBuffer& buffer = series_.at(si);
       QPainterPath path;
       bool started = false;
-      for (int i = 0; i < series_[si].size(); ++i) {
-        const double v = series_[si][i];
-        if (std::isnan(v)) {
-          started = false;
-          continue;
+      if (decimate) {
+        for (int col = 0; col < columns; ++col) {
+          const qint64 begin = first + sampleCount * col / columns;
+          const qint64 end = first + sampleCount * (col + 1) / columns;
+          const SerialPlotSeriesBuffer::MinMax mm = buffer.minMax(begin, end);
+          if (!mm.hasValue) {
+            started = false;
+            continue;
+          }
+          const int x = plotRect.left() + col;
+          if (!started) {
+            path.moveTo(x, mapY(mm.max));
+            started = true;
+          } else {
+            path.lineTo(x, mapY(mm.max));
+          }
+          path.lineTo(x, mapY(mm.min));
         }
-        const QPoint pt(mapX(i), mapY(v));
-        if (!started) {
-          path.moveTo(pt);
-          started = true;
-        } else {
-          path.lineTo(pt);
+      } else {
+        for (qint64 i = 0; i < sampleCount; ++i) {
+          const double v = buffer.valueAt(first + i);
+          if (std::isnan(v)) {
+            started = false;
+            continue;
+          }
+          const QPoint pt(mapX(i), mapY(v));
+          if (!started) {
+            path.moveTo(pt);
+            started = true;
+          } else {
+            path.lineTo(pt);
+          }
         }
       }
       p.drawPath(path);
@@ -275,12 +303,37 @@ class SerialPlotterWidget::PlotWidget final : public QWidget {
   }
 
  private:
-  QVector<QVector<double>> series_;
+  qint64 windowBegin() const {
+    return std::max<qint64>(0, sampleCount_ - retentionSamples_);
+  }
+
+  SerialPlotYRange computeAutoRange() const {
+    SerialPlotYRange out;
+    const qint64 first = windowBegin();
+    for (const auto& s : series_) {
+      const SerialPlotSeriesBuffer::MinMax mm = s.minMax(first, sampleCount_);
+      if (!mm.hasValue) {
+        continue;
+      }
+      if (!out.hasValue) {
+        out.hasValue = true;
+        out.minY = mm.min;
+        out.maxY = mm.max;
+      } else {
+        out.minY = std::min(out.minY, mm.min);
+        out.maxY = std::max(out.maxY, mm.max);
+      }
+    }
+    return out;
+  }
+
+  QVector<SerialPlotSeriesBuffer> series_;
   QVector<bool> seriesVisible_;
   QStringList seriesLabels_;
   QHash<QString, int> labelToIndex_;
-  int sampleCount_ = 0;
-  int maxSamples_ = 250;
+  QVector<double> rowValues_;
+  qint64 sampleCount_ = 0;  // absolute index of the next sample
+  int retentionSamples_ = SerialPlotterWidget::kDefaultRetentionSamples;
   SerialPlotRangeController rangeController_;
 };
 
@@ -327,6 +380,14 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
   maxYSpin_->setKeyboardTracking(false);
   maxYSpin_->setValue(1.0);
 
+  retentionCombo_ = new QComboBox(this);
+  retentionCombo_->setObjectName("serialPlotterRetention");
+  retentionCombo_->setToolTip(tr("Samples kept per series"));
+  const QLocale locale;
+  for (int n : {250, 1000, 10000, 100000, 1000000}) {
+    retentionCombo_->addItem(locale.toString(n), n);
+  }
+
   pauseButton_ = new QPushButton(tr("Pause"), this);
   pauseButton_->setCheckable(true);
 
@@ -372,6 +433,9 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
   topRow->addWidget(new QLabel(tr("to"), this));
   topRow->addWidget(maxYSpin_);
   topRow->addSpacing(12);
+  topRow->addWidget(new QLabel(tr("History:"), this));
+  topRow->addWidget(retentionCombo_);
+  topRow->addSpacing(12);
   topRow->addWidget(pauseButton_);
   topRow->addWidget(saveButton_);
   topRow->addWidget(clearButton_);
@@ -397,6 +461,8 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
     const bool freezeRange = settings.value("freezeRange", false).toBool();
     const double yMin = settings.value("yMin", 0.0).toDouble();
     const double yMax = settings.value("yMax", 1.0).toDouble();
+    const int retention =
+        settings.value("retentionSamples", kDefaultRetentionSamples).toInt();
     settings.endGroup();
 
     const int baudIdx = baudCombo_->findData(baud);
@@ -404,6 +470,7 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
       baudCombo_->setCurrentIndex(baudIdx);
     }
     autoReconnectCheck_->setChecked(autoReconnect);
+    setRetentionSamples(retention);
     setPaused(paused);
     if (autoScaleCheck_) {
       autoScaleCheck_->setChecked(autoscale);
@@ -442,6 +509,7 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
     if (maxYSpin_) {
       settings.setValue("yMax", maxYSpin_->value());
     }
+    settings.setValue("retentionSamples", retentionSamples());
     settings.endGroup();
   };
 
@@ -449,6 +517,11 @@ SerialPlotterWidget::SerialPlotterWidget(QWidget* parent) : QWidget(parent) {
           [persistSettings](int) { persistSettings(); });
   connect(autoReconnectCheck_, &QCheckBox::toggled, this,
           [persistSettings](bool) { persistSettings(); });
+  connect(retentionCombo_, &QComboBox::currentIndexChanged, this,
+          [this, persistSettings](int) {
+            plot_->setRetentionSamples(retentionCombo_->currentData().toInt());
+            persistSettings();
+          });
   auto updateRangeUi = [this] {
     const bool autoscale = autoScaleCheck_ && autoScaleCheck_->isChecked();
     if (freezeRangeCheck_) {
@@ -594,15 +667,19 @@ void SerialPlotterWidget::appendData(QByteArray data) {
   }
   lineBuffer_.append(data);
 
+  // Consume every complete line first and drop them from the buffer once;
+  // removing each line as it is parsed made large chunks quadratic.
   SerialPlotParser parser;
+  qsizetype pos = 0;
+  bool legendChanged = false;
   while (true) {
-    const int idx = lineBuffer_.indexOf('\n');
+    const qsizetype idx = lineBuffer_.indexOf('\n', pos);
     if (idx < 0) {
-      return;
+      break;
     }
-    QByteArray line = lineBuffer_.left(idx);
-    lineBuffer_.remove(0, idx + 1);
-    if (!line.isEmpty() && line.endsWith('\r')) {
+    QByteArrayView line(lineBuffer_.constData() + pos, idx - pos);
+    pos = idx + 1;
+    if (line.endsWith('\r')) {
       line.chop(1);
     }
     const QString text = QString::fromUtf8(line).trimmed();
@@ -611,11 +688,33 @@ void SerialPlotterWidget::appendData(QByteArray data) {
     }
     const SerialPlotSample sample = parser.parseSample(text);
     if (!sample.values.isEmpty()) {
-      if (plot_->addSample(sample.labels, sample.values)) {
-        rebuildLegend();
+      legendChanged |= plot_->addSample(sample.labels, sample.values);
+    }
+  }
+  lineBuffer_.remove(0, pos);
+  if (legendChanged) {
+    rebuildLegend();
+  }
+}
+
+void SerialPlotterWidget::setRetentionSamples(int samples) {
+  int idx = retentionCombo_->findData(samples);
+  if (idx < 0) {
+    // Snap unknown (e.g. hand-edited) values to the nearest larger preset.
+    idx = retentionCombo_->count() - 1;
+    for (int i = 0; i < retentionCombo_->count(); ++i) {
+      if (retentionCombo_->itemData(i).toInt() >= samples) {
+        idx = i;
+        break;
       }
     }
   }
+  retentionCombo_->setCurrentIndex(idx);
+  plot_->setRetentionSamples(retentionCombo_->itemData(idx).toInt());
+}
+
+int SerialPlotterWidget::retentionSamples() const {
+  return plot_->retentionSamples();
 }
 
 void SerialPlotterWidget::showError(QString message) {
@@ -13,12 +13,19 @@ class SerialPlotterWidget final : public QWidget {
   Q_OBJECT
 
  public:
+  // Samples kept per series until the user picks a longer history.
+  static constexpr int kDefaultRetentionSamples = 250;
+
   explicit SerialPlotterWidget(QWidget* parent = nullptr);
 
   void setCurrentPort(QString port);
   QString currentPort() const;
   bool autoReconnectEnabled() const;
 
+  // Rounded up to the nearest history preset offered in the toolbar.
+  void setRetentionSamples(int samples);
+  int retentionSamples() const;
+
  public slots:
   void setConnected(bool connected);
   void appendData(QByteArray data);
@@ -43,6 +50,7 @@ class SerialPlotterWidget final : public QWidget {
   QCheckBox* freezeRangeCheck_ = nullptr;
   QDoubleSpinBox* minYSpin_ = nullptr;
   QDoubleSpinBox* maxYSpin_ = nullptr;
+  QComboBox* retentionCombo_ = nullptr;
   QPushButton* pauseButton_ = nullptr;
   QPushButton* saveButton_ = nullptr;
   QPushButton* clearButton_ = nullptr;
@@ -1,19 +1,23 @@
 #include "serial_port.h"
 
-#if defined(Q_OS_UNIX)
-#include <QSocketNotifier>
+#include "serial_byte_ring.h"
+
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
 
+#if defined(Q_OS_UNIX)
 #include <cerrno>
 #include <cstring>
 
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #elif defined(Q_OS_WIN)
 #include <QRegularExpression>
-#include <QTimer>
 
-#include <algorithm>
 #include <limits>
 
 #ifndef NOMINMAX
@@ -169,7 +173,27 @@ static bool isValidNativeHandle(qintptr nativeHandle) {
 }
 #endif
 
-SerialPort::SerialPort(QObject* parent) : QObject(parent) {}
+namespace {
+constexpr qsizetype kReadChunkBytes = 16 * 1024;
+#if defined(Q_OS_WIN)
+// Upper bound on how long a blocking ReadFile keeps the reader thread from
+// noticing a stop request.
+constexpr DWORD kReaderPollMs = 50;
+#endif
+}  // namespace
+
+SerialPort::SerialPort(QObject* parent) : QObject(parent) {
+  deliveryTimer_ = new QTimer(this);
+  deliveryTimer_->setSingleShot(true);
+  deliveryTimer_->setTimerType(Qt::PreciseTimer);
+  connect(deliveryTimer_, &QTimer::timeout, this, &SerialPort::deliverReceived);
+}
+
+SerialPort::~SerialPort() {
+  // Receivers may already be half torn down; just release the port.
+  blockSignals(true);
+  closePort();
+}
 
 bool SerialPort::openPort(const QString& portPath, int baudRate) {
 #if !defined(Q_OS_UNIX) && !defined(Q_OS_WIN)
@@ -225,14 +249,25 @@ bool SerialPort::openPort(const QString& portPath, int baudRate) {
     return false;
   }
 
+  // Lets closePort() wake the reader thread out of poll().
+  int wakePipe[2] = {-1, -1};
+  if (::pipe(wakePipe) != 0) {
+    ::close(fd);
+    emit errorOccurred(QString("pipe failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+    return false;
+  }
+  for (int end : wakePipe) {
+    ::fcntl(end, F_SETFD, FD_CLOEXEC);
+    ::fcntl(end, F_SETFL, ::fcntl(end, F_GETFL) | O_NONBLOCK);
+  }
+
   fd_ = fd;
+  wakePipe_[0] = wakePipe[0];
+  wakePipe_[1] = wakePipe[1];
   portPath_ = portPath;
   baudRate_ = baudRate;
 
-  readNotifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
-  connect(readNotifier_, &QSocketNotifier::activated, this,
-          [this](QSocketDescriptor, QSocketNotifier::Type) { handleReadable(); });
-
+  startReader();
   setOpen(true);
   return true;
 #else
@@ -282,10 +317,12 @@ bool SerialPort::openPort(const QString& portPath, int baudRate) {
     return false;
   }
 
+  // ReadFile returns as soon as anything is buffered, otherwise waits up to
+  // kReaderPollMs for the first byte.
   COMMTIMEOUTS timeouts {};
   timeouts.ReadIntervalTimeout = MAXDWORD;
-  timeouts.ReadTotalTimeoutMultiplier = 0;
-  timeouts.ReadTotalTimeoutConstant = 0;
+  timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+  timeouts.ReadTotalTimeoutConstant = kReaderPollMs;
   timeouts.WriteTotalTimeoutMultiplier = 0;
   timeouts.WriteTotalTimeoutConstant = 1000;
   if (!SetCommTimeouts(handle, &timeouts)) {
@@ -295,45 +332,40 @@ bool SerialPort::openPort(const QString& portPath, int baudRate) {
     return false;
   }
 
-  SetupComm(handle, 4096, 4096);
+  SetupComm(handle, 64 * 1024, 4096);
   PurgeComm(handle, PURGE_RXABORT | PURGE_TXABORT | PURGE_RXCLEAR | PURGE_TXCLEAR);
 
   nativeHandle_ = reinterpret_cast<qintptr>(handle);
   portPath_ = trimmedPortPath;
   baudRate_ = baudRate;
 
-  readTimer_ = new QTimer(this);
-  readTimer_->setInterval(15);
-  connect(readTimer_, &QTimer::timeout, this, &SerialPort::handleReadable);
-  readTimer_->start();
-
+  startReader();
   setOpen(true);
   return true;
 #endif
 }
 
 void SerialPort::closePort() {
+  stopReader();
+  // Hand over whatever the reader stored before it stopped.
+  deliverReceived();
 #if defined(Q_OS_UNIX)
-  if (readNotifier_) {
-    readNotifier_->setEnabled(false);
-    readNotifier_->deleteLater();
-    readNotifier_ = nullptr;
-  }
   if (fd_ >= 0) {
     ::close(fd_);
     fd_ = -1;
   }
+  for (int& end : wakePipe_) {
+    if (end >= 0) {
+      ::close(end);
+      end = -1;
+    }
+  }
   if (!portPath_.isEmpty() || baudRate_ != 0) {
     portPath_.clear();
     baudRate_ = 0;
     setOpen(false);
   }
 #elif defined(Q_OS_WIN)
-  if (readTimer_) {
-    readTimer_->stop();
-    readTimer_->deleteLater();
-    readTimer_ = nullptr;
-  }
   if (isValidNativeHandle(nativeHandle_)) {
     CloseHandle(handleFromNative(nativeHandle_));
   }
@@ -370,6 +402,10 @@ int SerialPort::baudRate() const {
   return baudRate_;
 }
 
+qint64 SerialPort::droppedBytes() const {
+  return droppedBytes_.load(std::memory_order_relaxed);
+}
+
 bool SerialPort::writeBytes(const QByteArray& data) {
 #if !defined(Q_OS_UNIX) && !defined(Q_OS_WIN)
   Q_UNUSED(data);
@@ -437,69 +473,153 @@ void SerialPort::setOpen(bool open) {
   emit openedChanged(open);
 }
 
-void SerialPort::handleReadable() {
-#if !defined(Q_OS_UNIX) && !defined(Q_OS_WIN)
-  return;
-#elif defined(Q_OS_UNIX)
-  if (fd_ < 0) {
+void SerialPort::startReader() {
+  if (!readBuffer_) {
+    readBuffer_ = std::make_unique<SerialByteRing>(kReadBufferBytes);
+  }
+  readBuffer_->clear();
+  stopReader_.store(false);
+  deliveryPending_.store(false);
+  droppedBytes_.store(0);
+  reportedDroppedBytes_ = 0;
+  lastDelivery_.invalidate();
+
+  const quint64 generation = ++readerGeneration_;
+  readerThread_ = QThread::create([this, generation] { readLoop(generation); });
+  readerThread_->setObjectName(QStringLiteral("SerialPortReader"));
+  readerThread_->start();
+}
+
+void SerialPort::stopReader() {
+  deliveryTimer_->stop();
+  if (!readerThread_) {
     return;
   }
+  stopReader_.store(true);
+#if defined(Q_OS_UNIX)
+  if (wakePipe_[1] >= 0) {
+    const char wake = 0;
+    (void)!::write(wakePipe_[1], &wake, 1);
+  }
+#endif
+  readerThread_->wait();
+  delete readerThread_;
+  readerThread_ = nullptr;
+}
 
-  QByteArray data;
-  data.resize(4096);
-
-  while (true) {
-    const ssize_t n = ::read(fd_, data.data(), static_cast<size_t>(data.size()));
-    if (n > 0) {
-      emit dataReceived(data.left(static_cast<int>(n)));
-      continue;
-    }
-    if (n == 0) {
-      emit errorOccurred("Serial port closed.");
-      closePort();
-      return;
+// Runs on readerThread_. The handle members are set before the thread starts
+// and reset only after it has been joined, so reading them here is safe.
+void SerialPort::readLoop(quint64 generation) {
+  QByteArray chunk(kReadChunkBytes, Qt::Uninitialized);
+  QString failure;
+#if defined(Q_OS_UNIX)
+  pollfd fds[2] = {{fd_, POLLIN, 0}, {wakePipe_[0], POLLIN, 0}};
+  while (failure.isEmpty() && !stopReader_.load()) {
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      failure = QString("poll failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+      break;
     }
-    if (errno == EINTR) {
-      continue;
+    if (fds[1].revents != 0) {
+      break;
     }
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      return;
+    // A hung-up device that has nothing left to read would otherwise keep
+    // poll() returning immediately.
+    const bool hungUp = (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0;
+    while (true) {
+      const ssize_t n = ::read(fd_, chunk.data(), static_cast<size_t>(chunk.size()));
+      if (n > 0) {
+        storeReceived(chunk.constData(), static_cast<qsizetype>(n));
+        continue;
+      }
+      if (n == 0) {
+        // With VMIN = VTIME = 0 the tty layer reports "no data" as 0 rather
+        // than EAGAIN; only a hang-up means the device went away.
+        if (hungUp) {
+          failure = QStringLiteral("Serial port closed.");
+        }
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        failure = QString("Read failed: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+      } else if (hungUp) {
+        failure = QStringLiteral("Serial port closed.");
+      }
+      break;
     }
-    emit errorOccurred(QString("Read failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
-    closePort();
-    return;
   }
 #elif defined(Q_OS_WIN)
-  if (!isOpen()) {
-    return;
-  }
-
   HANDLE handle = handleFromNative(nativeHandle_);
-  for (int i = 0; i < 16; ++i) {
-    DWORD errors = 0;
-    COMSTAT stat {};
-    if (!ClearCommError(handle, &errors, &stat)) {
-      emit errorOccurred(windowsErrorString("ClearCommError failed"));
-      closePort();
-      return;
-    }
-    if (stat.cbInQue == 0) {
-      return;
-    }
-
-    const DWORD bytesToRead = std::min<DWORD>(stat.cbInQue, 4096);
-    QByteArray data;
-    data.resize(static_cast<int>(bytesToRead));
+  while (!stopReader_.load()) {
     DWORD bytesRead = 0;
-    if (!ReadFile(handle, data.data(), bytesToRead, &bytesRead, nullptr)) {
-      emit errorOccurred(windowsErrorString("Read failed"));
-      closePort();
-      return;
+    if (!ReadFile(handle, chunk.data(), static_cast<DWORD>(chunk.size()), &bytesRead, nullptr)) {
+      failure = windowsErrorString("Read failed");
+      break;
     }
-    if (bytesRead == 0) {
-      return;
+    if (bytesRead > 0) {
+      storeReceived(chunk.constData(), static_cast<qsizetype>(bytesRead));
     }
-    emit dataReceived(data.left(static_cast<int>(bytesRead)));
   }
 #endif
+  if (!failure.isEmpty() && !stopReader_.load()) {
+    QMetaObject::invokeMethod(
+        this, [this, generation, failure] { handleReaderFailure(generation, failure); },
+        Qt::QueuedConnection);
+  }
+}
+
+// Runs on readerThread_.
+void SerialPort::storeReceived(const char* data, qsizetype size) {
+  const qsizetype stored = readBuffer_->write(data, size);
+  if (stored < size) {
+    droppedBytes_.fetch_add(size - stored, std::memory_order_relaxed);
+  }
+  // One queued wake-up per delivery, however many chunks arrive meanwhile.
+  if (!deliveryPending_.exchange(true)) {
+    QMetaObject::invokeMethod(this, &SerialPort::scheduleDelivery, Qt::QueuedConnection);
+  }
+}
+
+void SerialPort::scheduleDelivery() {
+  if (deliveryTimer_->isActive()) {
+    return;
+  }
+  const qint64 sinceLast =
+      lastDelivery_.isValid() ? lastDelivery_.elapsed() : kDeliveryIntervalMs;
+  deliveryTimer_->start(
+      static_cast<int>(std::max<qint64>(0, kDeliveryIntervalMs - sinceLast)));
+}
+
+void SerialPort::deliverReceived() {
+  if (!readBuffer_) {
+    return;
+  }
+  // Clear the flag before draining: bytes stored after this point either make
+  // it into this chunk or schedule the next delivery.
+  deliveryPending_.store(false);
+  lastDelivery_.start();
+  const QByteArray data = readBuffer_->readAll();
+
+  const qint64 dropped = droppedBytes_.load(std::memory_order_relaxed);
+  if (dropped != reportedDroppedBytes_) {
+    reportedDroppedBytes_ = dropped;
+    emit droppedBytesChanged(dropped);
+  }
+  if (!data.isEmpty()) {
+    emit dataReceived(data);
+  }
+}
+
+void SerialPort::handleReaderFailure(quint64 generation, const QString& message) {
+  if (generation != readerGeneration_ || !readerThread_) {
+    return;
+  }
+  deliverReceived();
+  emit errorOccurred(message);
+  closePort();
 }
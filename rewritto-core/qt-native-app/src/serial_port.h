@@ -1,15 +1,27 @@
 #pragma once
 
+#include <QElapsedTimer>
 #include <QObject>
 
-class QSocketNotifier;
+#include <atomic>
+#include <memory>
+
+class QThread;
 class QTimer;
+class SerialByteRing;
 
 class SerialPort final : public QObject {
   Q_OBJECT
 
  public:
+  // Received bytes are handed to the GUI thread at most this often.
+  static constexpr int kDeliveryIntervalMs = 16;
+  // Bytes buffered between the reader thread and the GUI thread; roughly
+  // 20 s of 2 Mbaud traffic before anything is dropped.
+  static constexpr qsizetype kReadBufferBytes = 4 * 1024 * 1024;
+
   explicit SerialPort(QObject* parent = nullptr);
+  ~SerialPort() override;
 
   bool openPort(const QString& portPath, int baudRate);
   void closePort();
@@ -20,22 +32,45 @@ class SerialPort final : public QObject {
 
   bool writeBytes(const QByteArray& data);
 
+  // Bytes read from the port but discarded because the GUI thread fell more
+  // than kReadBufferBytes behind. Reset when a port is opened.
+  qint64 droppedBytes() const;
+
  signals:
   void openedChanged(bool opened);
+  // Emitted on the GUI thread, coalesced to one chunk per delivery interval.
   void dataReceived(QByteArray data);
+  void droppedBytesChanged(qint64 totalDropped);
   void errorOccurred(QString message);
 
  private:
 #if defined(Q_OS_UNIX)
   int fd_ = -1;
-  QSocketNotifier* readNotifier_ = nullptr;
+  int wakePipe_[2] = {-1, -1};
 #elif defined(Q_OS_WIN)
   qintptr nativeHandle_ = -1;
-  QTimer* readTimer_ = nullptr;
 #endif
   QString portPath_;
   int baudRate_ = 0;
 
+  // The reader thread only produces into readBuffer_; everything else,
+  // including signal emission, stays on the thread that owns the port.
+  QThread* readerThread_ = nullptr;
+  std::unique_ptr<SerialByteRing> readBuffer_;
+  std::atomic_bool stopReader_{false};
+  std::atomic_bool deliveryPending_{false};
+  std::atomic<qint64> droppedBytes_{0};
+  qint64 reportedDroppedBytes_ = 0;
+  quint64 readerGeneration_ = 0;
+  QTimer* deliveryTimer_ = nullptr;
+  QElapsedTimer lastDelivery_;
+
   void setOpen(bool open);
-  void handleReadable();
+  void startReader();
+  void stopReader();
+  void readLoop(quint64 generation);
+  void storeReceived(const char* data, qsizetype size);
+  void scheduleDelivery();
+  void deliverReceived();
+  void handleReaderFailure(quint64 generation, const QString& message);
 };
@@ -0,0 +1,440 @@
+#include "sketch_signature.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <QTimer>
+
+#include <utility>
+
+namespace {
+
+constexpr int kDigestSize = 32;  // SHA-256
+// Editors and copies touch a file several times; one update per burst.
+constexpr int kSettleDelayMs = 100;
+
+QString childPath(const QString& relativeDir, const QString& name) {
+  return relativeDir.isEmpty() ? name : relativeDir + QLatin1Char('/') + name;
+}
+
+}  // namespace
+
+SketchSignatureTracker::SketchSignatureTracker(QObject* parent)
+    : QObject(parent), combined_(emptyCombined()) {
+  settleTimer_ = new QTimer(this);
+  settleTimer_->setSingleShot(true);
+  settleTimer_->setInterval(kSettleDelayMs);
+  connect(settleTimer_, &QTimer::timeout, this, [this] {
+    if (applyChanges()) {
+      emit signatureChanged();
+    }
+  });
+}
+
+SketchSignatureTracker::~SketchSignatureTracker() {
+  if (scanThread_) {
+    scanThread_->wait();
+    delete scanThread_;
+    scanThread_ = nullptr;
+  }
+}
+
+void SketchSignatureTracker::setSketchFolder(const QString& folder) {
+  const QString normalized =
+      folder.trimmed().isEmpty() ? QString{} : QDir::cleanPath(QFileInfo(folder).absoluteFilePath());
+  if (normalized == folder_) {
+    return;
+  }
+
+  folder_ = normalized;
+  ready_ = false;
+  entries_.clear();
+  combined_ = emptyCombined();
+  watchedDirs_.clear();
+  unwatched_.clear();
+  dirtyFiles_.clear();
+  dirtyDirs_.clear();
+  settleTimer_->stop();
+  ++generation_;
+  ++revision_;
+
+  // A fresh watcher drops every old path at once.
+  delete watcher_;
+  watcher_ = nullptr;
+  if (folder_.isEmpty()) {
+    return;
+  }
+  watcher_ = new QFileSystemWatcher(this);
+  connect(watcher_, &QFileSystemWatcher::fileChanged, this, [this](const QString& path) {
+    QString relative;
+    if (relativePath(path, &relative)) {
+      dirtyFiles_.insert(relative);
+      settleTimer_->start();
+    }
+  });
+  connect(watcher_, &QFileSystemWatcher::directoryChanged, this, [this](const QString& path) {
+    QString relative;
+    if (relativePath(path, &relative)) {
+      dirtyDirs_.insert(relative);
+      settleTimer_->start();
+    }
+  });
+  startScan();
+}
+
+QString SketchSignatureTracker::sketchFolder() const {
+  return folder_;
+}
+
+bool SketchSignatureTracker::isReady() const {
+  return ready_;
+}
+
+QString SketchSignatureTracker::signature() {
+  if (!ready_ || !QFileInfo(folder_).isDir()) {
+    return {};
+  }
+  applyChanges();
+  return finalize(combined_, entries_.size());
+}
+
+void SketchSignatureTracker::markChanged(const QString& path) {
+  QString relative;
+  if (folder_.isEmpty() || !relativePath(path, &relative)) {
+    return;
+  }
+  ++revision_;
+  const QFileInfo info(path);
+  if (info.isDir() || (!info.exists() && !entries_.contains(relative))) {
+    dirtyDirs_.insert(relative);
+  } else {
+    dirtyFiles_.insert(relative);
+  }
+}
+
+quint64 SketchSignatureTracker::revision() {
+  applyChanges();
+  return revision_;
+}
+
+QString SketchSignatureTracker::computeSignature(const QString& folder) {
+  if (folder.trimmed().isEmpty() || !QFileInfo(folder).isDir()) {
+    return {};
+  }
+  const ScanResult result = scan(QDir::cleanPath(QFileInfo(folder).absoluteFilePath()));
+  QByteArray combined = emptyCombined();
+  for (const Entry& entry : result.entries) {
+    xorInto(&combined, entry.digest);
+  }
+  return finalize(combined, result.entries.size());
+}
+
+SketchSignatureTracker::ScanResult SketchSignatureTracker::scan(const QString& folder) {
+  ScanResult result;
+  scanDir(folder, QString{}, true, &result);
+  return result;
+}
+
+void SketchSignatureTracker::scanDir(const QString& folder, const QString& relativeDir,
+                                     bool recursive, ScanResult* result) {
+  // Hidden entries are skipped and directory links are not followed, as
+  // QDirIterator does by default.
+  QStringList pending{relativeDir};
+  while (!pending.isEmpty()) {
+    const QString dirPath = pending.takeLast();
+    result->dirs.append(dirPath);
+    const QDir dir(dirPath.isEmpty() ? folder : folder + QLatin1Char('/') + dirPath);
+    const QFileInfoList infos =
+        dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QFileInfo& info : infos) {
+      const QString relative = childPath(dirPath, info.fileName());
+      if (info.isDir()) {
+        if (recursive && !info.isSymLink()) {
+          pending.append(relative);
+        }
+        continue;
+      }
+      Entry entry;
+      if (hashEntry(folder, relative, &entry)) {
+        result->entries.insert(relative, entry);
+      }
+    }
+  }
+}
+
+bool SketchSignatureTracker::hashEntry(const QString& folder, const QString& relative,
+                                       Entry* entry) {
+  const QString path = folder + QLatin1Char('/') + relative;
+  const QFileInfo info(path);
+  if (!info.isFile()) {
+    return false;
+  }
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QCryptographicHash content(QCryptographicHash::Sha256);
+  if (!content.addData(&file)) {
+    return false;
+  }
+
+  QCryptographicHash digest(QCryptographicHash::Sha256);
+  digest.addData(relative.toUtf8());
+  digest.addData(QByteArray(1, '\0'));
+  digest.addData(content.result());
+  entry->size = info.size();
+  entry->mtimeMs = info.lastModified().toMSecsSinceEpoch();
+  entry->digest = digest.result();
+  return true;
+}
+
+QByteArray SketchSignatureTracker::emptyCombined() {
+  return QByteArray(kDigestSize, '\0');
+}
+
+void SketchSignatureTracker::xorInto(QByteArray* combined, const QByteArray& digest) {
+  char* out = combined->data();
+  const char* in = digest.constData();
+  for (int i = 0; i < kDigestSize && i < digest.size(); ++i) {
+    out[i] = static_cast<char>(out[i] ^ in[i]);
+  }
+}
+
+QString SketchSignatureTracker::finalize(const QByteArray& combined, qsizetype count) {
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  hash.addData(combined);
+  hash.addData(QByteArray::number(static_cast<qint64>(count)));
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+void SketchSignatureTracker::startScan() {
+  if (scanThread_) {
+    // finishScan() sees the generation moved on and starts over.
+    return;
+  }
+  const quint64 generation = generation_;
+  const QString folder = folder_;
+  scanThread_ = QThread::create([this, generation, folder] {
+    const ScanResult result = scan(folder);
+    QMetaObject::invokeMethod(
+        this, [this, generation, result] { finishScan(generation, result); },
+        Qt::QueuedConnection);
+  });
+  scanThread_->start();
+}
+
+void SketchSignatureTracker::finishScan(quint64 generation, ScanResult result) {
+  if (scanThread_) {
+    scanThread_->wait();
+    delete scanThread_;
+    scanThread_ = nullptr;
+  }
+  if (generation != generation_) {
+    if (!folder_.isEmpty()) {
+      startScan();
+    }
+    return;
+  }
+
+  entries_ = std::move(result.entries);
+  combined_ = emptyCombined();
+  QStringList files;
+  files.reserve(entries_.size());
+  for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+    xorInto(&combined_, it->digest);
+    files.append(absolutePath(it.key()));
+  }
+  QStringList dirs;
+  dirs.reserve(result.dirs.size());
+  for (const QString& dir : std::as_const(result.dirs)) {
+    watchedDirs_.insert(dir);
+    dirs.append(absolutePath(dir));
+  }
+  if (!dirs.isEmpty()) {
+    watcher_->addPaths(dirs);
+  }
+  if (!files.isEmpty()) {
+    // Past the system's watch limit, files fall back to stat checks.
+    const QStringList failed = watcher_->addPaths(files);
+    for (const QString& path : failed) {
+      QString relative;
+      if (relativePath(path, &relative)) {
+        unwatched_.insert(relative);
+      }
+    }
+  }
+
+  // Anything written while the scan ran, before the watches existed.
+  for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+    const QFileInfo info(absolutePath(it.key()));
+    if (info.size() != it->size ||
+        info.lastModified().toMSecsSinceEpoch() != it->mtimeMs) {
+      dirtyFiles_.insert(it.key());
+    }
+  }
+
+  ready_ = true;
+  applyChanges();
+  emit signatureChanged();
+}
+
+bool SketchSignatureTracker::relativePath(const QString& path, QString* relative) const {
+  if (folder_.isEmpty()) {
+    return false;
+  }
+  const QString absolute = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+  if (absolute == folder_) {
+    relative->clear();
+    return true;
+  }
+  if (!absolute.startsWith(folder_ + QLatin1Char('/'))) {
+    return false;
+  }
+  *relative = absolute.mid(folder_.size() + 1);
+  for (const QStringView part : QStringView(*relative).split(QLatin1Char('/'))) {
+    if (part.startsWith(QLatin1Char('.'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+QString SketchSignatureTracker::absolutePath(const QString& relative) const {
+  return relative.isEmpty() ? folder_ : folder_ + QLatin1Char('/') + relative;
+}
+
+void SketchSignatureTracker::watchFile(const QString& relative) {
+  const QString path = absolutePath(relative);
+  // addPath() also fails for a path that is already watched.
+  if (watcher_->addPath(path) || watcher_->files().contains(path)) {
+    unwatched_.remove(relative);
+  } else {
+    unwatched_.insert(relative);
+  }
+}
+
+void SketchSignatureTracker::watchDir(const QString& relative) {
+  if (watchedDirs_.contains(relative)) {
+    return;
+  }
+  watchedDirs_.insert(relative);
+  watcher_->addPath(absolutePath(relative));
+}
+
+void SketchSignatureTracker::setEntry(const QString& relative, const Entry& entry) {
+  auto it = entries_.find(relative);
+  if (it != entries_.end()) {
+    xorInto(&combined_, it->digest);
+    *it = entry;
+  } else {
+    entries_.insert(relative, entry);
+  }
+  xorInto(&combined_, entry.digest);
+}
+
+void SketchSignatureTracker::removeEntry(const QString& relative) {
+  auto it = entries_.find(relative);
+  if (it == entries_.end()) {
+    return;
+  }
+  xorInto(&combined_, it->digest);
+  entries_.erase(it);
+  unwatched_.remove(relative);
+}
+
+bool SketchSignatureTracker::applyChanges() {
+  if (!ready_ || !watcher_) {
+    return false;
+  }
+  const QByteArray before = combined_;
+  const qsizetype countBefore = entries_.size();
+
+  // Directories: pick up files and subdirectories that appeared. Removed
+  // files are reported on their own; a removed directory drops its subtree.
+  const QSet<QString> dirtyDirs = std::exchange(dirtyDirs_, {});
+  for (const QString& dir : dirtyDirs) {
+    if (!QFileInfo(absolutePath(dir)).isDir()) {
+      const QString prefix = dir + QLatin1Char('/');
+      QStringList gone;
+      for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+        if (it.key() == dir || it.key().startsWith(prefix)) {
+          gone.append(it.key());
+        }
+      }
+      for (const QString& relative : gone) {
+        removeEntry(relative);
+      }
+      for (auto it = watchedDirs_.begin(); it != watchedDirs_.end();) {
+        if (*it == dir || it->startsWith(prefix)) {
+          it = watchedDirs_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      continue;
+    }
+    ScanResult added;
+    const QDir qdir(absolutePath(dir));
+    const QFileInfoList infos =
+        qdir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QFileInfo& info : infos) {
+      const QString relative = childPath(dir, info.fileName());
+      if (info.isDir()) {
+        if (!info.isSymLink() && !watchedDirs_.contains(relative)) {
+          scanDir(folder_, relative, true, &added);
+        }
+      } else if (!entries_.contains(relative)) {
+        Entry entry;
+        if (hashEntry(folder_, relative, &entry)) {
+          added.entries.insert(relative, entry);
+        }
+      }
+    }
+    for (const QString& d : std::as_const(added.dirs)) {
+      watchDir(d);
+    }
+    for (auto it = added.entries.cbegin(); it != added.entries.cend(); ++it) {
+      setEntry(it.key(), it.value());
+      watchFile(it.key());
+    }
+  }
+
+  // Files: always re-hashed; size and mtime are not trusted here.
+  const QSet<QString> dirtyFiles = std::exchange(dirtyFiles_, {});
+  for (const QString& relative : dirtyFiles) {
+    Entry entry;
+    if (hashEntry(folder_, relative, &entry)) {
+      setEntry(relative, entry);
+      watchFile(relative);
+    } else {
+      removeEntry(relative);
+    }
+  }
+
+  // Files the watcher could not take are compared by stat.
+  const QSet<QString> unwatched = unwatched_;
+  for (const QString& relative : unwatched) {
+    const auto it = entries_.constFind(relative);
+    const QFileInfo info(absolutePath(relative));
+    if (it != entries_.cend() && info.isFile() && info.size() == it->size &&
+        info.lastModified().toMSecsSinceEpoch() == it->mtimeMs) {
+      continue;
+    }
+    Entry entry;
+    if (hashEntry(folder_, relative, &entry)) {
+      setEntry(relative, entry);
+    } else {
+      removeEntry(relative);
+    }
+  }
+
+  if (combined_ == before && entries_.size() == countBefore) {
+    return false;
+  }
+  ++revision_;
+  return true;
+}
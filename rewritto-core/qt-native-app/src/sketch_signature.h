@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QThread;
+class QTimer;
+
+// Content signature of a sketch folder, kept up to date incrementally so the
+// "upload without recompiling" check neither walks the folder nor trusts
+// mtimes. Every visible file has a (size, mtime, SHA-256) entry, and the
+// signature folds per-file digests of (relative path, content hash) together
+// with XOR, so one changed file costs one hash and an O(1) update. Files
+// reported by the watcher or markChanged() are always re-hashed, which
+// catches copies that preserve size and mtime. The first scan of a folder
+// runs on a worker thread; signature() is empty until it finishes.
+class SketchSignatureTracker final : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SketchSignatureTracker(QObject* parent = nullptr);
+  ~SketchSignatureTracker() override;
+
+  // Starts tracking `folder` (no-op if it already is); empty stops.
+  void setSketchFolder(const QString& folder);
+  QString sketchFolder() const;
+  bool isReady() const;
+
+  // Hex signature of the folder contents, after applying pending changes.
+  // Empty while the first scan runs or when no folder is tracked.
+  QString signature();
+  // A file or directory inside the folder was written, added or removed.
+  // Takes effect on the next signature() call.
+  void markChanged(const QString& path);
+  // Moves on with every markChanged(), folder switch and change to the
+  // signature, after applying pending changes. A signature taken later
+  // than some reader of the files (a compile) matches what it read only
+  // if the revision did not move in between.
+  quint64 revision();
+
+  // Full scan with the same definition as signature().
+  static QString computeSignature(const QString& folder);
+
+ signals:
+  // The first scan finished, or watched files changed the signature.
+  void signatureChanged();
+
+ private:
+  struct Entry final {
+    qint64 size = 0;
+    qint64 mtimeMs = 0;
+    QByteArray digest;  // of relative path + content hash
+  };
+  struct ScanResult final {
+    QHash<QString, Entry> entries;  // by relative path
+    QStringList dirs;               // relative, "" for the root
+  };
+
+  QString folder_;
+  bool ready_ = false;
+  QHash<QString, Entry> entries_;
+  QByteArray combined_;  // XOR of every entry digest
+  QSet<QString> watchedDirs_;
+  QSet<QString> unwatched_;  // over the watch limit; checked by stat
+  QSet<QString> dirtyFiles_;
+  QSet<QString> dirtyDirs_;
+  QFileSystemWatcher* watcher_ = nullptr;
+  QTimer* settleTimer_ = nullptr;
+  QThread* scanThread_ = nullptr;
+  quint64 generation_ = 0;
+  quint64 revision_ = 0;
+
+  static ScanResult scan(const QString& folder);
+  // Lists `relativeDir` (and below, when `recursive`) into `result`.
+  static void scanDir(const QString& folder, const QString& relativeDir, bool recursive,
+                      ScanResult* result);
+  static bool hashEntry(const QString& folder, const QString& relative, Entry* entry);
+  static QByteArray emptyCombined();
+  static void xorInto(QByteArray* combined, const QByteArray& digest);
+  static QString finalize(const QByteArray& combined, qsizetype count);
+
+  void finishScan(quint64 generation, ScanResult result);
+  // Path relative to the folder; false when outside it or hidden.
+  bool relativePath(const QString& path, QString* relative) const;
+  QString absolutePath(const QString& relative) const;
+  void startScan();
+  void watchFile(const QString& relative);
+  void watchDir(const QString& relative);
+  void setEntry(const QString& relative, const Entry& entry);
+  void removeEntry(const QString& relative);
+  // Applies the pending changes; true when the signature changed.
+  bool applyChanges();
+};
@@ -0,0 +1,442 @@
+#include "text_diff.h"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include <QHash>
+
+namespace {
+// Linear-space Myers diff (middle-snake bisection) over interned ints. Marks
+// every element that is not part of the common subsequence it finds. With a
+// `workBudget`, each diagonal visited and each element matched along a snake
+// spends one unit, and run() gives up (returning false, with the marks
+// incomplete) once it is spent.
+class MyersDiff final {
+ public:
+  MyersDiff(const QVector<int>& a,
+            const QVector<int>& b,
+            quint8* changedA,
+            quint8* changedB,
+            qint64* workBudget = nullptr)
+      : a_(a.constData()),
+        b_(b.constData()),
+        n_(static_cast<int>(a.size())),
+        m_(static_cast<int>(b.size())),
+        changedA_(changedA),
+        changedB_(changedB),
+        workBudget_(workBudget) {
+    const size_t diagonals = static_cast<size_t>(n_) + static_cast<size_t>(m_) + 3;
+    forward_.assign(diagonals, 0);
+    backward_.assign(diagonals, 0);
+    offset_ = m_ + 1;
+
+    // Same budget as GNU diff: roughly sqrt(diagonals), but at least 4096.
+    costLimit_ = 1;
+    for (size_t d = diagonals; d != 0; d >>= 2) {
+      costLimit_ <<= 1;
+    }
+    costLimit_ = std::max(4096, costLimit_);
+  }
+
+  bool run() {
+    // Explicit work stack: heuristic splits can be lopsided, so recursion
+    // depth is not bounded by log(n).
+    std::vector<Range> pending;
+    pending.push_back(Range{0, n_, 0, m_});
+    while (!pending.empty()) {
+      if (workBudget_ && *workBudget_ < 0) {
+        return false;
+      }
+      Range r = pending.back();
+      pending.pop_back();
+
+      while (r.xoff < r.xlim && r.yoff < r.ylim && a_[r.xoff] == b_[r.yoff]) {
+        ++r.xoff;
+        ++r.yoff;
+      }
+      while (r.xlim > r.xoff && r.ylim > r.yoff && a_[r.xlim - 1] == b_[r.ylim - 1]) {
+        --r.xlim;
+        --r.ylim;
+      }
+
+      if (r.xoff == r.xlim) {
+        std::fill(changedB_ + r.yoff, changedB_ + r.ylim, quint8(1));
+        continue;
+      }
+      if (r.yoff == r.ylim) {
+        std::fill(changedA_ + r.xoff, changedA_ + r.xlim, quint8(1));
+        continue;
+      }
+
+      const Split split = findSplit(r);
+      pending.push_back(Range{r.xoff, split.x, r.yoff, split.y});
+      pending.push_back(Range{split.x, r.xlim, split.y, r.ylim});
+    }
+    return !workBudget_ || *workBudget_ >= 0;
+  }
+
+ private:
+  struct Range final {
+    int xoff;
+    int xlim;
+    int yoff;
+    int ylim;
+  };
+  struct Split final {
+    int x;
+    int y;
+  };
+
+  int& fd(int diagonal) { return forward_[static_cast<size_t>(diagonal + offset_)]; }
+  int& bd(int diagonal) { return backward_[static_cast<size_t>(diagonal + offset_)]; }
+
+  // Finds a point on an optimal (or, past the cost limit, a good) edit path
+  // through `r`, searching from both ends at once. Diagonals are x - y.
+  Split findSplit(const Range& r) {
+    const int dmin = r.xoff - r.ylim;
+    const int dmax = r.xlim - r.yoff;
+    const int fmid = r.xoff - r.yoff;
+    const int bmid = r.xlim - r.ylim;
+    const bool odd = ((fmid - bmid) & 1) != 0;
+    int fmin = fmid;
+    int fmax = fmid;
+    int bmin = bmid;
+    int bmax = bmid;
+    fd(fmid) = r.xoff;
+    bd(bmid) = r.xlim;
+
+    for (int cost = 1;; ++cost) {
+      if (fmin > dmin) {
+        fd(--fmin - 1) = -1;
+      } else {
+        ++fmin;
+      }
+      if (fmax < dmax) {
+        fd(++fmax + 1) = -1;
+      } else {
+        --fmax;
+      }
+      qint64 work = 0;
+      for (int d = fmax; d >= fmin; d -= 2) {
+        const int lo = fd(d - 1);
+        const int hi = fd(d + 1);
+        int x = lo >= hi ? lo + 1 : hi;
+        int y = x - d;
+        const int snakeStart = x;
+        while (x < r.xlim && y < r.ylim && a_[x] == b_[y]) {
+          ++x;
+          ++y;
+        }
+        work += 1 + (x - snakeStart);
+        fd(d) = x;
+        if (odd && bmin <= d && d <= bmax && bd(d) <= x) {
+          return Split{x, y};
+        }
+      }
+
+      if (bmin > dmin) {
+        bd(--bmin - 1) = INT_MAX;
+      } else {
+        ++bmin;
+      }
+      if (bmax < dmax) {
+        bd(++bmax + 1) = INT_MAX;
+      } else {
+        --bmax;
+      }
+      for (int d = bmax; d >= bmin; d -= 2) {
+        const int lo = bd(d - 1);
+        const int hi = bd(d + 1);
+        int x = lo < hi ? lo : hi - 1;
+        int y = x - d;
+        const int snakeStart = x;
+        while (x > r.xoff && y > r.yoff && a_[x - 1] == b_[y - 1]) {
+          --x;
+          --y;
+        }
+        work += 1 + (snakeStart - x);
+        bd(d) = x;
+        if (!odd && fmin <= d && d <= fmax && x <= fd(d)) {
+          return Split{x, y};
+        }
+      }
+
+      if (workBudget_ && (*workBudget_ -= work) < 0) {
+        // run() stops at the next range; any split will do.
+        return bestEffortSplit(r, fmin, fmax, bmin, bmax);
+      }
+      if (cost >= costLimit_) {
+        return bestEffortSplit(r, fmin, fmax, bmin, bmax);
+      }
+    }
+  }
+
+  // Too expensive to finish: split at whichever frontier got furthest.
+  Split bestEffortSplit(const Range& r, int fmin, int fmax, int bmin, int bmax) {
+    int forwardBest = -1;
+    int forwardX = r.xoff;
+    for (int d = fmax; d >= fmin; d -= 2) {
+      int x = std::min(fd(d), r.xlim);
+      int y = x - d;
+      if (r.ylim < y) {
+        x = r.ylim + d;
+        y = r.ylim;
+      }
+      if (forwardBest < x + y) {
+        forwardBest = x + y;
+        forwardX = x;
+      }
+    }
+    int backwardBest = INT_MAX;
+    int backwardX = r.xlim;
+    for (int d = bmax; d >= bmin; d -= 2) {
+      int x = std::max(r.xoff, bd(d));
+      int y = x - d;
+      if (y < r.yoff) {
+        x = r.yoff + d;
+        y = r.yoff;
+      }
+      if (x + y < backwardBest) {
+        backwardBest = x + y;
+        backwardX = x;
+      }
+    }
+    if ((r.xlim + r.ylim) - backwardBest < forwardBest - (r.xoff + r.yoff)) {
+      return Split{forwardX, forwardBest - forwardX};
+    }
+    return Split{backwardX, backwardBest - backwardX};
+  }
+
+  const int* a_;
+  const int* b_;
+  int n_;
+  int m_;
+  quint8* changedA_;
+  quint8* changedB_;
+  qint64* workBudget_ = nullptr;
+  std::vector<int> forward_;
+  std::vector<int> backward_;
+  int offset_ = 0;
+  int costLimit_ = 0;
+};
+
+// Interns lines, drops lines that have no counterpart on the other side
+// (they are changed no matter what) and runs Myers on the remainder.
+void diffLineFlags(const QStringList& left,
+                   const QStringList& right,
+                   QVector<quint8>* outLeftChanged,
+                   QVector<quint8>* outRightChanged) {
+  QHash<QString, int> ids;
+  ids.reserve(left.size() + right.size());
+  QVector<int> leftIds;
+  QVector<int> rightIds;
+  leftIds.reserve(left.size());
+  rightIds.reserve(right.size());
+  QVector<int> leftCounts;
+  QVector<int> rightCounts;
+
+  const auto intern = [&ids, &leftCounts, &rightCounts](const QString& line) {
+    auto it = ids.constFind(line);
+    if (it != ids.constEnd()) {
+      return it.value();
+    }
+    const int id = static_cast<int>(ids.size());
+    ids.insert(line, id);
+    leftCounts.push_back(0);
+    rightCounts.push_back(0);
+    return id;
+  };
+  for (const QString& line : left) {
+    const int id = intern(line);
+    leftIds.push_back(id);
+    ++leftCounts[id];
+  }
+  for (const QString& line : right) {
+    const int id = intern(line);
+    rightIds.push_back(id);
+    ++rightCounts[id];
+  }
+
+  outLeftChanged->fill(0, leftIds.size());
+  outRightChanged->fill(0, rightIds.size());
+
+  QVector<int> leftKept;
+  QVector<int> leftMap;
+  leftKept.reserve(leftIds.size());
+  leftMap.reserve(leftIds.size());
+  for (int i = 0; i < leftIds.size(); ++i) {
+    if (rightCounts.at(leftIds.at(i)) == 0) {
+      (*outLeftChanged)[i] = 1;
+    } else {
+      leftKept.push_back(leftIds.at(i));
+      leftMap.push_back(i);
+    }
+  }
+  QVector<int> rightKept;
+  QVector<int> rightMap;
+  rightKept.reserve(rightIds.size());
+  rightMap.reserve(rightIds.size());
+  for (int j = 0; j < rightIds.size(); ++j) {
+    if (leftCounts.at(rightIds.at(j)) == 0) {
+      (*outRightChanged)[j] = 1;
+    } else {
+      rightKept.push_back(rightIds.at(j));
+      rightMap.push_back(j);
+    }
+  }
+
+  QVector<quint8> keptLeftChanged(leftKept.size(), 0);
+  QVector<quint8> keptRightChanged(rightKept.size(), 0);
+  MyersDiff(leftKept, rightKept, keptLeftChanged.data(), keptRightChanged.data()).run();
+  for (int i = 0; i < keptLeftChanged.size(); ++i) {
+    if (keptLeftChanged.at(i)) {
+      (*outLeftChanged)[leftMap.at(i)] = 1;
+    }
+  }
+  for (int j = 0; j < keptRightChanged.size(); ++j) {
+    if (keptRightChanged.at(j)) {
+      (*outRightChanged)[rightMap.at(j)] = 1;
+    }
+  }
+}
+
+// Unchanged lines pair up in order on both sides, so walking the two flag
+// arrays together yields the hunks.
+QVector<TextDiff::Hunk> hunksFromFlags(const QVector<quint8>& leftChanged,
+                                       const QVector<quint8>& rightChanged) {
+  QVector<TextDiff::Hunk> hunks;
+  const int n = static_cast<int>(leftChanged.size());
+  const int m = static_cast<int>(rightChanged.size());
+  int i = 0;
+  int j = 0;
+  while (i < n || j < m) {
+    if (i < n && j < m && !leftChanged.at(i) && !rightChanged.at(j)) {
+      ++i;
+      ++j;
+      continue;
+    }
+    TextDiff::Hunk hunk{i, 0, j, 0};
+    while (i < n && leftChanged.at(i)) {
+      ++i;
+      ++hunk.leftCount;
+    }
+    while (j < m && rightChanged.at(j)) {
+      ++j;
+      ++hunk.rightCount;
+    }
+    if (hunk.leftCount == 0 && hunk.rightCount == 0) {
+      break;
+    }
+    hunks.push_back(hunk);
+  }
+  return hunks;
+}
+
+void appendChangedRuns(int line,
+                       const QVector<quint8>& changed,
+                       QVector<TextDiff::CharRange>* out) {
+  const int n = static_cast<int>(changed.size());
+  int i = 0;
+  while (i < n) {
+    if (!changed.at(i)) {
+      ++i;
+      continue;
+    }
+    const int start = i;
+    while (i < n && changed.at(i)) {
+      ++i;
+    }
+    out->push_back(TextDiff::CharRange{line, start, i - start});
+  }
+}
+
+// `workBudget` is shared by the lines of one hunk. A pair that runs it out
+// gets no ranges, i.e. stays highlighted as a whole line, and so does every
+// later pair in the hunk.
+void diffLineChars(int leftLine,
+                   const QString& leftText,
+                   int rightLine,
+                   const QString& rightText,
+                   qint64* workBudget,
+                   TextDiff::Result* out) {
+  if (*workBudget < 0 || leftText.size() > TextDiff::kMaxIntraLineChars ||
+      rightText.size() > TextDiff::kMaxIntraLineChars) {
+    return;
+  }
+  QVector<int> a;
+  QVector<int> b;
+  a.reserve(leftText.size());
+  b.reserve(rightText.size());
+  for (const QChar ch : leftText) {
+    a.push_back(ch.unicode());
+  }
+  for (const QChar ch : rightText) {
+    b.push_back(ch.unicode());
+  }
+  QVector<quint8> leftChanged(a.size(), 0);
+  QVector<quint8> rightChanged(b.size(), 0);
+  if (!MyersDiff(a, b, leftChanged.data(), rightChanged.data(), workBudget).run()) {
+    return;
+  }
+
+  // Lines with nothing in common are already fully highlighted.
+  const qsizetype leftKept = std::count(leftChanged.cbegin(), leftChanged.cend(), quint8(0));
+  if (leftKept == 0) {
+    return;
+  }
+  appendChangedRuns(leftLine, leftChanged, &out->leftCharRanges);
+  appendChangedRuns(rightLine, rightChanged, &out->rightCharRanges);
+}
+}  // namespace
+
+QStringList TextDiff::splitLines(const QString& text) {
+  QString normalized = text;
+  normalized.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+  normalized.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+  return normalized.split(QLatin1Char('\n'), Qt::KeepEmptyParts);
+}
+
+QVector<TextDiff::Hunk> TextDiff::diffLines(const QStringList& left,
+                                            const QStringList& right) {
+  QVector<quint8> leftChanged;
+  QVector<quint8> rightChanged;
+  diffLineFlags(left, right, &leftChanged, &rightChanged);
+  return hunksFromFlags(leftChanged, rightChanged);
+}
+
+TextDiff::Result TextDiff::compute(const QString& leftText, const QString& rightText) {
+  Result out;
+  const QStringList leftLines = splitLines(leftText);
+  const QStringList rightLines = splitLines(rightText);
+
+  QVector<quint8> leftChanged;
+  QVector<quint8> rightChanged;
+  diffLineFlags(leftLines, rightLines, &leftChanged, &rightChanged);
+  out.hunks = hunksFromFlags(leftChanged, rightChanged);
+
+  for (int i = 0; i < leftChanged.size(); ++i) {
+    if (leftChanged.at(i)) {
+      out.leftChanged.push_back(i);
+    }
+  }
+  for (int j = 0; j < rightChanged.size(); ++j) {
+    if (rightChanged.at(j)) {
+      out.rightChanged.push_back(j);
+    }
+  }
+
+  // Modified lines pair up positionally inside a hunk; extra lines on either
+  // side are pure insertions/deletions.
+  for (const Hunk& hunk : out.hunks) {
+    const int paired = std::min(hunk.leftCount, hunk.rightCount);
+    qint64 workBudget = kMaxIntraLineWorkPerHunk;
+    for (int k = 0; k < paired; ++k) {
+      const int leftLine = hunk.leftStart + k;
+      const int rightLine = hunk.rightStart + k;
+      diffLineChars(leftLine, leftLines.at(leftLine), rightLine,
+                    rightLines.at(rightLine), &workBudget, &out);
+    }
+  }
+  return out;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Line diff for snapshot comparison: lines are interned to ints, lines that
+// only exist on one side are discarded up front, and the rest goes through a
+// linear-space Myers diff (with a cost cap so pathological inputs degrade to
+// a valid but non-minimal script instead of quadratic time). Paired changed
+// lines additionally get character-level ranges.
+class TextDiff final {
+ public:
+  // Lines longer than this are not diffed character by character.
+  static constexpr int kMaxIntraLineChars = 2000;
+  // Character diffs of one hunk's line pairs share this much Myers work
+  // (diagonals visited plus characters matched); pairs past it are shown
+  // as whole changed lines. About 2 ms; a 2000-character line with a
+  // hundred scattered edits costs some 30k.
+  static constexpr qint64 kMaxIntraLineWorkPerHunk = 500'000;
+
+  struct Hunk final {
+    int leftStart = 0;
+    int leftCount = 0;
+    int rightStart = 0;
+    int rightCount = 0;
+  };
+
+  struct CharRange final {
+    int line = 0;
+    int start = 0;
+    int length = 0;
+  };
+
+  struct Result final {
+    QVector<Hunk> hunks;
+    QVector<int> leftChanged;
+    QVector<int> rightChanged;
+    QVector<CharRange> leftCharRanges;
+    QVector<CharRange> rightCharRanges;
+  };
+
+  // Splits on '\n' after folding "\r\n" and "\r", keeping empty lines, so
+  // indexes match QTextDocument block numbers.
+  static QStringList splitLines(const QString& text);
+
+  static QVector<Hunk> diffLines(const QStringList& left, const QStringList& right);
+  static Result compute(const QString& leftText, const QString& rightText);
+};
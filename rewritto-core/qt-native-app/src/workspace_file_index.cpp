@@ -0,0 +1,526 @@
+#include "workspace_file_index.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+#include <QVersionNumber>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr quint32 kCacheMagic = 0x52574649;  // "RWFI"
+constexpr qint32 kCacheFormat = 1;
+// inotify watches are a per-user resource shared with every other program.
+constexpr int kMaxWatchedDirs = 4096;
+// Saving a file or unpacking a library touches directories in bursts.
+constexpr int kSettleDelayMs = 300;
+
+qint64 modifiedMs(const QFileInfo& info) {
+  return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+QString newestVersionDir(const QString& archDir) {
+  QString best;
+  QVersionNumber bestVersion;
+  const QStringList versions =
+      QDir(archDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  for (const QString& v : versions) {
+    const QVersionNumber version = QVersionNumber::fromString(v);
+    if (best.isEmpty() || QVersionNumber::compare(version, bestVersion) > 0) {
+      best = v;
+      bestVersion = version;
+    }
+  }
+  return best.isEmpty() ? QString{} : QDir(archDir).absoluteFilePath(best);
+}
+
+// "<board>.build.core" and "<board>.build.variant" of a boards.txt.
+void readBoardBuildDirs(const QString& boardsTxt, const QString& board, QString* core,
+                        QString* variant) {
+  QFile f(boardsTxt);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return;
+  }
+  const QByteArray corePrefix = board.toUtf8() + ".build.core=";
+  const QByteArray variantPrefix = board.toUtf8() + ".build.variant=";
+  while (!f.atEnd()) {
+    const QByteArray line = f.readLine().trimmed();
+    if (line.startsWith(corePrefix)) {
+      *core = QString::fromUtf8(line.mid(corePrefix.size())).trimmed();
+    } else if (line.startsWith(variantPrefix)) {
+      *variant = QString::fromUtf8(line.mid(variantPrefix.size())).trimmed();
+    }
+  }
+}
+
+// A "vendor:name" reference points into another vendor's platform of the
+// same architecture.
+QString referencedDir(const QString& dataDir, const QString& platformDir, const QString& arch,
+                      const QString& kind, const QString& reference) {
+  if (reference.isEmpty()) {
+    return {};
+  }
+  const qsizetype colon = reference.indexOf(QLatin1Char(':'));
+  if (colon < 0) {
+    return platformDir + QLatin1Char('/') + kind + QLatin1Char('/') + reference;
+  }
+  const QString vendorDir = newestVersionDir(
+      QDir(dataDir).absoluteFilePath(QStringLiteral("packages/%1/hardware/%2")
+                                         .arg(reference.left(colon), arch)));
+  return vendorDir.isEmpty()
+             ? QString{}
+             : vendorDir + QLatin1Char('/') + kind + QLatin1Char('/') + reference.mid(colon + 1);
+}
+}  // namespace
+
+WorkspaceFileIndex::WorkspaceFileIndex(QObject* parent)
+    : QObject(parent), cachePath_(defaultCachePath()) {
+  settleTimer_ = new QTimer(this);
+  settleTimer_->setSingleShot(true);
+  settleTimer_->setInterval(kSettleDelayMs);
+  connect(settleTimer_, &QTimer::timeout, this, &WorkspaceFileIndex::refresh);
+}
+
+WorkspaceFileIndex::~WorkspaceFileIndex() {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+}
+
+void WorkspaceFileIndex::setCachePath(QString path) {
+  cachePath_ = std::move(path);
+  cacheRead_ = false;
+}
+
+QString WorkspaceFileIndex::defaultCachePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+      .filePath(QStringLiteral("workspace-files.bin"));
+}
+
+void WorkspaceFileIndex::setRoots(QVector<Root> roots) {
+  for (Root& root : roots) {
+    root.path = QDir::cleanPath(QFileInfo(root.path).absoluteFilePath());
+  }
+  if (roots == roots_) {
+    return;
+  }
+  roots_ = std::move(roots);
+  ++generation_;
+  refresh();
+}
+
+QVector<WorkspaceFileIndex::Root> WorkspaceFileIndex::roots() const {
+  return roots_;
+}
+
+QVector<WorkspaceFileIndex::Root> WorkspaceFileIndex::defaultRoots(const QString& sketchFolder,
+                                                                   const QString& sketchbookDir,
+                                                                   const QString& dataDir,
+                                                                   const QString& fqbn) {
+  QVector<Root> roots;
+  auto add = [&roots](const QString& path, const QString& label, bool watched) {
+    if (!path.isEmpty() && QFileInfo(path).isDir()) {
+      roots.push_back({QDir::cleanPath(path), label, watched});
+    }
+  };
+
+  if (!sketchFolder.trimmed().isEmpty()) {
+    add(sketchFolder, QFileInfo(sketchFolder).fileName(), true);
+  }
+  if (!sketchbookDir.trimmed().isEmpty()) {
+    add(QDir(sketchbookDir).absoluteFilePath(QStringLiteral("libraries")),
+        QStringLiteral("Libraries"), true);
+  }
+
+  // Installed cores only change through the boards manager, which
+  // refreshes; they are not watched.
+  const QStringList parts = fqbn.split(QLatin1Char(':'));
+  if (parts.size() < 3 || dataDir.trimmed().isEmpty()) {
+    return roots;
+  }
+  const QString& vendor = parts.at(0);
+  const QString& arch = parts.at(1);
+  const QString& board = parts.at(2);
+  const QString platformDir = newestVersionDir(
+      QDir(dataDir).absoluteFilePath(QStringLiteral("packages/%1/hardware/%2").arg(vendor, arch)));
+  if (platformDir.isEmpty()) {
+    return roots;
+  }
+  QString core;
+  QString variant;
+  readBoardBuildDirs(platformDir + QStringLiteral("/boards.txt"), board, &core, &variant);
+  const QString platformId = vendor + QLatin1Char(':') + arch;
+  add(referencedDir(dataDir, platformDir, arch, QStringLiteral("cores"), core),
+      QStringLiteral("%1 core").arg(platformId), false);
+  add(referencedDir(dataDir, platformDir, arch, QStringLiteral("variants"), variant),
+      QStringLiteral("%1 variant").arg(platformId), false);
+  return roots;
+}
+
+bool WorkspaceFileIndex::isReady() const {
+  return snapshot_ != nullptr;
+}
+
+bool WorkspaceFileIndex::isScanning() const {
+  return thread_ != nullptr;
+}
+
+int WorkspaceFileIndex::fileCount() const {
+  return snapshot_ ? static_cast<int>(snapshot_->files.size()) : 0;
+}
+
+quint64 WorkspaceFileIndex::revision() const {
+  return revision_;
+}
+
+QVector<WorkspaceFileIndex::Match> WorkspaceFileIndex::find(const QString& query, int limit) {
+  QVector<Match> out;
+  if (!snapshot_ || limit <= 0) {
+    return out;
+  }
+
+  FuzzyMatcher::Pattern pattern(query);
+  QVector<int> ids;
+  if (pattern.isEmpty()) {
+    const int n = std::min(limit, static_cast<int>(snapshot_->files.size()));
+    ids.reserve(n);
+    for (int id = 0; id < n; ++id) {
+      ids.push_back(id);
+    }
+  } else {
+    const bool narrowed = lastRevision_ == revision_ && pattern.narrows(lastPattern_);
+    lastIds_ = snapshot_->matcher.rank(pattern, narrowed ? &lastIds_ : nullptr);
+    lastRevision_ = revision_;
+    ids = lastIds_.mid(0, limit);
+  }
+  lastPattern_ = std::move(pattern);
+
+  out.reserve(ids.size());
+  for (int id : ids) {
+    const FileRef& file = snapshot_->files.at(id);
+    const Root& root = snapshot_->roots.at(file.root);
+    out.push_back({childPath(root.path, file.relativePath), file.relativePath, root.label});
+  }
+  return out;
+}
+
+void WorkspaceFileIndex::refresh() {
+  if (thread_) {
+    pendingRefresh_ = true;
+    return;
+  }
+  settleTimer_->stop();
+
+  const QVector<Root> roots = roots_;
+  QHash<QString, RootListing> listings;
+  for (const Root& root : roots) {
+    const auto it = listings_.constFind(root.path);
+    if (it != listings_.constEnd()) {
+      listings.insert(root.path, *it);
+    }
+  }
+  const QString cachePath = cachePath_;
+  const bool readCacheFirst = !cacheRead_ && !cachePath.isEmpty();
+  cacheRead_ = true;
+  const bool haveSnapshot = snapshot_ && snapshot_->roots == roots;
+  const quint64 generation = generation_;
+
+  thread_ = QThread::create([this, generation, roots, listings, cachePath, readCacheFirst,
+                             haveSnapshot]() mutable {
+    // Roots seen in an earlier session are served from the cache first,
+    // then checked like any other.
+    bool cacheComplete = !cachePath.isEmpty();
+    bool fromCache = false;
+    if (readCacheFirst) {
+      const QHash<QString, RootListing> cached = readCache(cachePath);
+      for (const Root& root : roots) {
+        const auto it = cached.constFind(root.path);
+        if (listings.contains(root.path)) {
+          continue;
+        }
+        if (it == cached.constEnd()) {
+          cacheComplete = false;
+        } else {
+          listings.insert(root.path, *it);
+          fromCache = true;
+        }
+      }
+      if (fromCache) {
+        std::shared_ptr<const Snapshot> snapshot = buildSnapshot(roots, listings);
+        QMetaObject::invokeMethod(
+            this,
+            [this, generation, snapshot] {
+              if (generation == generation_) {
+                setSnapshot(snapshot);
+              }
+            },
+            Qt::QueuedConnection);
+      }
+    }
+
+    bool changed = false;
+    for (const Root& root : roots) {
+      if (!listings.contains(root.path)) {
+        cacheComplete = false;
+      }
+      changed = updateListing(root.path, &listings[root.path]) || changed;
+    }
+
+    std::shared_ptr<const Snapshot> snapshot;
+    if (changed || (!haveSnapshot && !fromCache)) {
+      snapshot = buildSnapshot(roots, listings);
+    }
+    if (!cachePath.isEmpty() && (changed || !cacheComplete)) {
+      writeCache(cachePath, roots, listings);
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, generation, listings = std::move(listings), snapshot]() mutable {
+          finishScan(generation, std::move(listings), snapshot);
+        },
+        Qt::QueuedConnection);
+  });
+  thread_->start();
+}
+
+void WorkspaceFileIndex::setSnapshot(std::shared_ptr<const Snapshot> snapshot) {
+  snapshot_ = std::move(snapshot);
+  ++revision_;
+  lastIds_.clear();
+  emit filesChanged();
+}
+
+void WorkspaceFileIndex::finishScan(quint64 generation,
+                                    QHash<QString, RootListing> listings,
+                                    std::shared_ptr<const Snapshot> snapshot) {
+  if (thread_) {
+    thread_->wait();
+    delete thread_;
+    thread_ = nullptr;
+  }
+
+  if (generation == generation_) {
+    listings_ = std::move(listings);
+    // No snapshot: nothing changed since the current one.
+    if (snapshot) {
+      setSnapshot(std::move(snapshot));
+    }
+    updateWatchedDirs();
+  }
+
+  if (pendingRefresh_ || generation != generation_) {
+    pendingRefresh_ = false;
+    refresh();
+  }
+}
+
+void WorkspaceFileIndex::updateWatchedDirs() {
+  QStringList wanted;
+  for (const Root& root : roots_) {
+    if (!root.watched) {
+      continue;
+    }
+    const RootListing listing = listings_.value(root.path);
+    QStringList relative = listing.keys();
+    std::sort(relative.begin(), relative.end());
+    for (const QString& dir : relative) {
+      if (wanted.size() >= kMaxWatchedDirs) {
+        break;
+      }
+      wanted.push_back(childPath(root.path, dir));
+    }
+  }
+
+  if (wanted.isEmpty()) {
+    delete watcher_;
+    watcher_ = nullptr;
+    return;
+  }
+  if (!watcher_) {
+    watcher_ = new QFileSystemWatcher(this);
+    connect(watcher_, &QFileSystemWatcher::directoryChanged, settleTimer_,
+            qOverload<>(&QTimer::start));
+  }
+  const QSet<QString> wantedSet(wanted.cbegin(), wanted.cend());
+  const QStringList current = watcher_->directories();
+  QStringList stale;
+  for (const QString& dir : current) {
+    if (!wantedSet.contains(dir)) {
+      stale.push_back(dir);
+    }
+  }
+  if (!stale.isEmpty()) {
+    watcher_->removePaths(stale);
+  }
+  const QSet<QString> currentSet(current.cbegin(), current.cend());
+  QStringList added;
+  for (const QString& dir : wanted) {
+    if (!currentSet.contains(dir)) {
+      added.push_back(dir);
+    }
+  }
+  if (!added.isEmpty()) {
+    watcher_->addPaths(added);
+  }
+}
+
+QString WorkspaceFileIndex::childPath(const QString& dir, const QString& name) {
+  if (name.isEmpty()) {
+    return dir;
+  }
+  return dir.isEmpty() ? name : dir + QLatin1Char('/') + name;
+}
+
+WorkspaceFileIndex::DirListing WorkspaceFileIndex::listDir(const QString& path,
+                                                           qint64 modifiedMs) {
+  DirListing dir;
+  dir.modifiedMs = modifiedMs;
+  // Hidden entries (.git, editor swap files) are left out, and symlinked
+  // directories are not followed, which could loop.
+  QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo info = it.fileInfo();
+    if (info.isDir()) {
+      if (!info.isSymLink()) {
+        dir.subdirs.push_back(info.fileName());
+      }
+    } else {
+      dir.files.push_back(info.fileName());
+    }
+  }
+  std::sort(dir.files.begin(), dir.files.end());
+  std::sort(dir.subdirs.begin(), dir.subdirs.end());
+  return dir;
+}
+
+bool WorkspaceFileIndex::updateListing(const QString& rootPath, RootListing* listing) {
+  RootListing next;
+  next.reserve(listing->size());
+  bool changed = false;
+  QStringList pending{QString()};
+  while (!pending.isEmpty()) {
+    const QString relative = pending.takeLast();
+    const QFileInfo info(childPath(rootPath, relative));
+    if (!info.isDir()) {
+      changed = true;
+      continue;
+    }
+    const qint64 modified = modifiedMs(info);
+    DirListing dir;
+    const auto it = listing->constFind(relative);
+    if (it != listing->constEnd() && it->modifiedMs == modified) {
+      dir = *it;
+    } else {
+      dir = listDir(info.filePath(), modified);
+      changed = true;
+    }
+    for (const QString& subdir : dir.subdirs) {
+      pending.push_back(childPath(relative, subdir));
+    }
+    next.insert(relative, std::move(dir));
+  }
+  changed = changed || next.size() != listing->size();
+  *listing = std::move(next);
+  return changed;
+}
+
+std::shared_ptr<const WorkspaceFileIndex::Snapshot> WorkspaceFileIndex::buildSnapshot(
+    const QVector<Root>& roots, const QHash<QString, RootListing>& listings) {
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->roots = roots;
+
+  for (int r = 0; r < roots.size(); ++r) {
+    const RootListing listing = listings.value(roots.at(r).path);
+    QStringList dirs = listing.keys();
+    std::sort(dirs.begin(), dirs.end());
+    for (const QString& dir : dirs) {
+      for (const QString& name : listing.value(dir).files) {
+        snapshot->files.push_back({r, childPath(dir, name)});
+      }
+    }
+  }
+
+  qsizetype characters = 0;
+  for (const FileRef& file : snapshot->files) {
+    characters += file.relativePath.size() + roots.at(file.root).label.size() + 1;
+  }
+  snapshot->matcher.reserve(static_cast<int>(snapshot->files.size()), characters);
+  for (const FileRef& file : snapshot->files) {
+    snapshot->matcher.add(file.relativePath, roots.at(file.root).label);
+  }
+  return snapshot;
+}
+
+QHash<QString, WorkspaceFileIndex::RootListing> WorkspaceFileIndex::readCache(
+    const QString& cachePath) {
+  QFile f(cachePath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  qint32 format = 0;
+  in >> magic >> format;
+  if (magic != kCacheMagic || format != kCacheFormat) {
+    return {};
+  }
+
+  QHash<QString, RootListing> listings;
+  qint32 rootCount = 0;
+  in >> rootCount;
+  for (qint32 r = 0; r < rootCount && in.status() == QDataStream::Ok; ++r) {
+    QString rootPath;
+    in >> rootPath;
+    RootListing listing;
+    qint32 dirCount = 0;
+    in >> dirCount;
+    for (qint32 d = 0; d < dirCount && in.status() == QDataStream::Ok; ++d) {
+      QString relative;
+      DirListing dir;
+      in >> relative >> dir.modifiedMs >> dir.files >> dir.subdirs;
+      listing.insert(relative, std::move(dir));
+    }
+    listings.insert(rootPath, std::move(listing));
+  }
+  if (in.status() != QDataStream::Ok) {
+    return {};
+  }
+  return listings;
+}
+
+void WorkspaceFileIndex::writeCache(const QString& cachePath,
+                                    const QVector<Root>& roots,
+                                    const QHash<QString, RootListing>& listings) {
+  QDir().mkpath(QFileInfo(cachePath).absolutePath());
+  QSaveFile f(cachePath);
+  if (!f.open(QIODevice::WriteOnly)) {
+    return;
+  }
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << kCacheMagic << kCacheFormat << qint32(roots.size());
+  for (const Root& root : roots) {
+    const RootListing listing = listings.value(root.path);
+    out << root.path << qint32(listing.size());
+    for (auto it = listing.constBegin(); it != listing.constEnd(); ++it) {
+      out << it.key() << it->modifiedMs << it->files << it->subdirs;
+    }
+  }
+  if (out.status() == QDataStream::Ok) {
+    f.commit();
+  }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+#include "fuzzy_matcher.h"
+
+class QFileSystemWatcher;
+class QThread;
+class QTimer;
+
+// The files below a set of roots (the sketch, the sketchbook libraries and
+// the active platform's core and variant), for Quick Open. Roots are walked
+// on a worker thread; each directory's listing is kept with its
+// modification time, so a refresh only re-stats directories and lists
+// again the ones that gained, lost or renamed an entry. Listings persist in
+// a cache file, which gives results right after startup while the roots
+// are checked. Directories of watched roots are followed with
+// QFileSystemWatcher (up to a limit) and refresh on their own.
+class WorkspaceFileIndex final : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Root final {
+    QString path;
+    QString label;         // shown with the root's files
+    bool watched = true;   // false: only picked up by refresh()
+
+    friend bool operator==(const Root&, const Root&) = default;
+  };
+
+  struct Match final {
+    QString filePath;      // absolute
+    QString relativePath;  // to the root, '/'-separated
+    QString rootLabel;
+  };
+
+  explicit WorkspaceFileIndex(QObject* parent = nullptr);
+  ~WorkspaceFileIndex() override;
+
+  // Defaults to workspace-files.bin in the application cache directory;
+  // empty: nothing persists.
+  void setCachePath(QString path);
+  static QString defaultCachePath();
+
+  // Files of earlier roots rank first among equal matches. Setting the
+  // same roots again does nothing.
+  void setRoots(QVector<Root> roots);
+  QVector<Root> roots() const;
+
+  // The sketch folder, sketchbook/libraries, and the cores/ and variants/
+  // folders that `fqbn` builds with, out of the newest installed version
+  // of its platform under `dataDir`. Missing folders are left out.
+  static QVector<Root> defaultRoots(const QString& sketchFolder,
+                                    const QString& sketchbookDir,
+                                    const QString& dataDir,
+                                    const QString& fqbn);
+
+  // False until the cache is read or the first walk ends.
+  bool isReady() const;
+  bool isScanning() const;
+  int fileCount() const;
+  // Increases every time the file list is replaced.
+  quint64 revision() const;
+
+  // Up to `limit` files, best fuzzy path match first; for an empty query,
+  // the first files in root order. While consecutive queries only grow,
+  // only the previous matches are scored again.
+  QVector<Match> find(const QString& query, int limit = 200);
+
+ public slots:
+  void refresh();
+
+ signals:
+  void filesChanged();
+
+ private:
+  struct DirListing final {
+    qint64 modifiedMs = -1;
+    QStringList files;    // names
+    QStringList subdirs;  // names
+  };
+  // Directories by path relative to the root, "" for the root itself.
+  using RootListing = QHash<QString, DirListing>;
+
+  struct FileRef final {
+    int root = 0;
+    QString relativePath;
+  };
+  struct Snapshot final {
+    QVector<Root> roots;
+    QVector<FileRef> files;
+    FuzzyMatcher matcher;
+  };
+
+  QString cachePath_;
+  QVector<Root> roots_;
+  QHash<QString, RootListing> listings_;  // by root path
+  std::shared_ptr<const Snapshot> snapshot_;
+  quint64 revision_ = 0;
+  bool cacheRead_ = false;
+
+  QThread* thread_ = nullptr;
+  quint64 generation_ = 0;
+  bool pendingRefresh_ = false;
+  QFileSystemWatcher* watcher_ = nullptr;
+  QTimer* settleTimer_ = nullptr;
+
+  // The previous find(), for narrowing.
+  quint64 lastRevision_ = 0;
+  FuzzyMatcher::Pattern lastPattern_;
+  QVector<int> lastIds_;
+
+  static QString childPath(const QString& dir, const QString& name);
+  static DirListing listDir(const QString& path, qint64 modifiedMs);
+  // Re-stats every directory of `listing`, listing again the ones that
+  // changed and walking new ones; true when anything differs.
+  static bool updateListing(const QString& rootPath, RootListing* listing);
+  static std::shared_ptr<const Snapshot> buildSnapshot(
+      const QVector<Root>& roots, const QHash<QString, RootListing>& listings);
+  static QHash<QString, RootListing> readCache(const QString& cachePath);
+  static void writeCache(const QString& cachePath, const QVector<Root>& roots,
+                         const QHash<QString, RootListing>& listings);
+
+  void setSnapshot(std::shared_ptr<const Snapshot> snapshot);
+  void finishScan(quint64 generation, QHash<QString, RootListing> listings,
+                  std::shared_ptr<const Snapshot> snapshot);
+  void updateWatchedDirs();
+};
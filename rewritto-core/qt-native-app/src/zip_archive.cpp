@@ -0,0 +1,917 @@
+#include "zip_archive.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+constexpr quint32 kLocalHeaderSig = 0x04034b50;
+constexpr quint32 kCentralHeaderSig = 0x02014b50;
+constexpr quint32 kEndSig = 0x06054b50;
+constexpr quint32 kZip64EndSig = 0x06064b50;
+constexpr quint32 kZip64LocatorSig = 0x07064b50;
+constexpr quint16 kZip64ExtraId = 0x0001;
+constexpr quint16 kMethodStored = 0;
+constexpr quint16 kMethodDeflated = 8;
+constexpr quint16 kFlagEncrypted = 0x0001;
+constexpr quint16 kFlagUtf8 = 0x0800;
+constexpr quint16 kVersionDefault = 20;
+constexpr quint16 kVersionZip64 = 45;
+constexpr quint16 kHostUnix = 3;
+constexpr quint32 kMax32 = 0xFFFFFFFFu;
+constexpr quint16 kMax16 = 0xFFFF;
+constexpr int kLocalHeaderSize = 30;
+constexpr int kCentralHeaderSize = 46;
+constexpr int kEndSize = 22;
+constexpr int kZip64LocatorSize = 20;
+constexpr int kZip64EndSize = 56;
+constexpr int kMaxCommentSize = 0xFFFF;
+// Files up to this size are read and deflated whole on the thread pool;
+// larger ones are streamed through the writer in chunks.
+constexpr qint64 kParallelMaxBytes = 4 * 1024 * 1024;
+constexpr qint64 kChunkSize = 256 * 1024;
+constexpr int kCompressionLevel = 6;
+constexpr int kProgressIntervalMs = 100;
+
+void put16(QByteArray* out, quint16 v) {
+  char b[2];
+  qToLittleEndian(v, b);
+  out->append(b, 2);
+}
+
+void put32(QByteArray* out, quint32 v) {
+  char b[4];
+  qToLittleEndian(v, b);
+  out->append(b, 4);
+}
+
+void put64(QByteArray* out, quint64 v) {
+  char b[8];
+  qToLittleEndian(v, b);
+  out->append(b, 8);
+}
+
+quint16 get16(const char* p) {
+  return qFromLittleEndian<quint16>(p);
+}
+
+quint32 get32(const char* p) {
+  return qFromLittleEndian<quint32>(p);
+}
+
+quint64 get64(const char* p) {
+  return qFromLittleEndian<quint64>(p);
+}
+
+struct DosStamp final {
+  quint16 time = 0;
+  quint16 date = (1 << 5) | 1;  // 1980-01-01
+};
+
+DosStamp toDosStamp(const QDateTime& when) {
+  const QDateTime local = when.toLocalTime();
+  const QDate d = local.date();
+  const QTime t = local.time();
+  DosStamp stamp;
+  if (!local.isValid() || d.year() < 1980) {
+    return stamp;
+  }
+  stamp.time = static_cast<quint16>((t.hour() << 11) | (t.minute() << 5) | (t.second() / 2));
+  stamp.date = static_cast<quint16>(((std::min(d.year(), 2107) - 1980) << 9) |
+                                    (d.month() << 5) | d.day());
+  return stamp;
+}
+
+QDateTime fromDosStamp(quint16 time, quint16 date) {
+  const QDate d(1980 + (date >> 9), (date >> 5) & 0x0F, date & 0x1F);
+  const QTime t((time >> 11) & 0x1F, (time >> 5) & 0x3F, (time & 0x1F) * 2);
+  return QDateTime(d, t);
+}
+
+quint32 unixMode(const QFileInfo& info) {
+  const QFileDevice::Permissions p = info.permissions();
+  quint32 mode = info.isDir() ? 0040000 : 0100000;
+  mode |= p.testFlag(QFileDevice::ReadOwner) ? 0400 : 0;
+  mode |= p.testFlag(QFileDevice::WriteOwner) ? 0200 : 0;
+  mode |= p.testFlag(QFileDevice::ExeOwner) ? 0100 : 0;
+  mode |= p.testFlag(QFileDevice::ReadGroup) ? 0040 : 0;
+  mode |= p.testFlag(QFileDevice::WriteGroup) ? 0020 : 0;
+  mode |= p.testFlag(QFileDevice::ExeGroup) ? 0010 : 0;
+  mode |= p.testFlag(QFileDevice::ReadOther) ? 0004 : 0;
+  mode |= p.testFlag(QFileDevice::WriteOther) ? 0002 : 0;
+  mode |= p.testFlag(QFileDevice::ExeOther) ? 0001 : 0;
+  return mode;
+}
+
+bool fail(QString* outError, const QString& message) {
+  if (outError) {
+    *outError = message;
+  }
+  return false;
+}
+
+bool writeAll(QFile* out, const char* data, qint64 size) {
+  return out->write(data, size) == size;
+}
+
+bool writeAll(QFile* out, const QByteArray& data) {
+  return writeAll(out, data.constData(), data.size());
+}
+
+// --- Writing ---------------------------------------------------------------
+
+struct SourceEntry final {
+  QString path;
+  QByteArray name;  // UTF-8, '/'-separated; directories end with '/'
+  bool isDir = false;
+  qint64 size = 0;
+  quint32 mode = 0;
+  DosStamp stamp;
+};
+
+struct WrittenEntry final {
+  QByteArray name;
+  quint16 method = kMethodStored;
+  quint32 crc = 0;
+  quint64 compressedSize = 0;
+  quint64 size = 0;
+  quint64 offset = 0;
+  quint32 mode = 0;
+  bool isDir = false;
+  DosStamp stamp;
+};
+
+struct CompressedFile final {
+  QByteArray data;  // deflated, or the file itself when that is smaller
+  quint16 method = kMethodStored;
+  quint32 crc = 0;
+  qint64 size = 0;
+  QString error;
+  bool done = false;
+};
+
+CompressedFile compressFile(const SourceEntry& entry) {
+  CompressedFile result;
+  QFile file(entry.path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    result.error = QObject::tr("Could not read %1: %2").arg(entry.path, file.errorString());
+    return result;
+  }
+  const QByteArray raw = file.readAll();
+  if (file.error() != QFileDevice::NoError) {
+    result.error = QObject::tr("Could not read %1: %2").arg(entry.path, file.errorString());
+    return result;
+  }
+  result.size = raw.size();
+  result.crc = static_cast<quint32>(
+      crc32(0, reinterpret_cast<const Bytef*>(raw.constData()), static_cast<uInt>(raw.size())));
+
+  if (!raw.isEmpty()) {
+    z_stream zs{};
+    if (deflateInit2(&zs, kCompressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) ==
+        Z_OK) {
+      QByteArray deflated(static_cast<qsizetype>(deflateBound(&zs, static_cast<uLong>(raw.size()))),
+                          Qt::Uninitialized);
+      zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.constData()));
+      zs.avail_in = static_cast<uInt>(raw.size());
+      zs.next_out = reinterpret_cast<Bytef*>(deflated.data());
+      zs.avail_out = static_cast<uInt>(deflated.size());
+      const int rc = deflate(&zs, Z_FINISH);
+      const qsizetype deflatedSize = static_cast<qsizetype>(zs.total_out);
+      deflateEnd(&zs);
+      if (rc == Z_STREAM_END && deflatedSize < raw.size()) {
+        deflated.truncate(deflatedSize);
+        result.data = std::move(deflated);
+        result.method = kMethodDeflated;
+        return result;
+      }
+    }
+  }
+  result.data = raw;
+  result.method = kMethodStored;
+  return result;
+}
+
+QByteArray localHeader(const WrittenEntry& e) {
+  QByteArray h;
+  h.reserve(kLocalHeaderSize + e.name.size());
+  put32(&h, kLocalHeaderSig);
+  put16(&h, kVersionDefault);
+  put16(&h, kFlagUtf8);
+  put16(&h, e.method);
+  put16(&h, e.stamp.time);
+  put16(&h, e.stamp.date);
+  put32(&h, e.crc);
+  put32(&h, static_cast<quint32>(e.compressedSize));
+  put32(&h, static_cast<quint32>(e.size));
+  put16(&h, static_cast<quint16>(e.name.size()));
+  put16(&h, 0);
+  h.append(e.name);
+  return h;
+}
+
+QByteArray centralHeader(const WrittenEntry& e) {
+  const bool zip64Offset = e.offset >= kMax32;
+  QByteArray h;
+  h.reserve(kCentralHeaderSize + e.name.size() + 12);
+  put32(&h, kCentralHeaderSig);
+  put16(&h, static_cast<quint16>((kHostUnix << 8) | kVersionZip64));
+  put16(&h, zip64Offset ? kVersionZip64 : kVersionDefault);
+  put16(&h, kFlagUtf8);
+  put16(&h, e.method);
+  put16(&h, e.stamp.time);
+  put16(&h, e.stamp.date);
+  put32(&h, e.crc);
+  put32(&h, static_cast<quint32>(e.compressedSize));
+  put32(&h, static_cast<quint32>(e.size));
+  put16(&h, static_cast<quint16>(e.name.size()));
+  put16(&h, zip64Offset ? 12 : 0);
+  put16(&h, 0);  // comment
+  put16(&h, 0);  // disk
+  put16(&h, 0);  // internal attributes
+  put32(&h, (e.mode << 16) | (e.isDir ? 0x10 : 0));
+  put32(&h, zip64Offset ? kMax32 : static_cast<quint32>(e.offset));
+  h.append(e.name);
+  if (zip64Offset) {
+    put16(&h, kZip64ExtraId);
+    put16(&h, 8);
+    put64(&h, e.offset);
+  }
+  return h;
+}
+
+bool collectEntries(const QString& sourceDir, QVector<SourceEntry>* out, QString* outError) {
+  const QFileInfo rootInfo(sourceDir);
+  const QString root = rootInfo.absoluteFilePath();
+  const QByteArray prefix = rootInfo.fileName().toUtf8() + '/';
+
+  SourceEntry rootEntry;
+  rootEntry.path = root;
+  rootEntry.name = prefix;
+  rootEntry.isDir = true;
+  rootEntry.mode = unixMode(rootInfo);
+  rootEntry.stamp = toDosStamp(rootInfo.lastModified());
+  out->push_back(rootEntry);
+
+  const QDir rootDir(root);
+  QDirIterator it(root, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    const QFileInfo info(path);
+    SourceEntry entry;
+    entry.path = path;
+    entry.isDir = info.isDir();
+    entry.name = prefix + rootDir.relativeFilePath(path).toUtf8();
+    if (entry.isDir) {
+      entry.name.append('/');
+    } else if (!info.isFile()) {
+      continue;  // dangling links, sockets, ...
+    } else {
+      entry.size = info.size();
+      if (static_cast<quint64>(entry.size) >= kMax32) {
+        return fail(outError, QObject::tr("%1 is too large for a ZIP entry (4 GiB limit).")
+                                  .arg(QDir::toNativeSeparators(path)));
+      }
+    }
+    if (entry.name.size() > kMax16) {
+      return fail(outError, QObject::tr("Path is too long for a ZIP entry: %1")
+                                .arg(QDir::toNativeSeparators(path)));
+    }
+    entry.mode = unixMode(info);
+    entry.stamp = toDosStamp(info.lastModified());
+    out->push_back(std::move(entry));
+  }
+  // Deterministic archives regardless of directory listing order.
+  std::sort(out->begin() + 1, out->end(),
+            [](const SourceEntry& a, const SourceEntry& b) { return a.name < b.name; });
+  return true;
+}
+
+// Deflates a large file into `out` in chunks, then patches the sizes and
+// CRC into the local header that was written ahead of the data.
+bool streamLargeFile(const SourceEntry& entry, QFile* out, WrittenEntry* written,
+                     const std::function<void(qint64)>& advanced, QString* outError) {
+  QFile file(entry.path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return fail(outError,
+                QObject::tr("Could not read %1: %2").arg(entry.path, file.errorString()));
+  }
+  written->method = kMethodDeflated;
+  written->offset = static_cast<quint64>(out->pos());
+  if (!writeAll(out, localHeader(*written))) {
+    return fail(outError, out->errorString());
+  }
+
+  z_stream zs{};
+  if (deflateInit2(&zs, kCompressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return fail(outError, QObject::tr("Could not initialize compression."));
+  }
+  QByteArray input(kChunkSize, Qt::Uninitialized);
+  QByteArray output(kChunkSize, Qt::Uninitialized);
+  uLong crc = crc32(0, nullptr, 0);
+  bool ok = true;
+  int flush = Z_NO_FLUSH;
+  while (ok && flush != Z_FINISH) {
+    const qint64 n = file.read(input.data(), kChunkSize);
+    if (n < 0) {
+      ok = fail(outError, QObject::tr("Could not read %1: %2").arg(entry.path, file.errorString()));
+      break;
+    }
+    flush = file.atEnd() || n == 0 ? Z_FINISH : Z_NO_FLUSH;
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(input.constData()), static_cast<uInt>(n));
+    written->size += static_cast<quint64>(n);
+    zs.next_in = reinterpret_cast<Bytef*>(input.data());
+    zs.avail_in = static_cast<uInt>(n);
+    do {
+      zs.next_out = reinterpret_cast<Bytef*>(output.data());
+      zs.avail_out = static_cast<uInt>(output.size());
+      if (deflate(&zs, flush) == Z_STREAM_ERROR) {
+        ok = fail(outError, QObject::tr("Compression failed for %1.").arg(entry.path));
+        break;
+      }
+      const qint64 produced = output.size() - zs.avail_out;
+      if (!writeAll(out, output.constData(), produced)) {
+        ok = fail(outError, out->errorString());
+        break;
+      }
+      written->compressedSize += static_cast<quint64>(produced);
+    } while (zs.avail_out == 0);
+    if (advanced) {
+      advanced(n);
+    }
+  }
+  deflateEnd(&zs);
+  if (!ok) {
+    return false;
+  }
+  if (written->size >= kMax32 || written->compressedSize >= kMax32) {
+    return fail(outError, QObject::tr("%1 is too large for a ZIP entry (4 GiB limit).")
+                              .arg(QDir::toNativeSeparators(entry.path)));
+  }
+
+  written->crc = static_cast<quint32>(crc);
+  QByteArray patch;
+  put32(&patch, written->crc);
+  put32(&patch, static_cast<quint32>(written->compressedSize));
+  put32(&patch, static_cast<quint32>(written->size));
+  const qint64 end = out->pos();
+  if (!out->seek(static_cast<qint64>(written->offset) + 14) || !writeAll(out, patch) ||
+      !out->seek(end)) {
+    return fail(outError, out->errorString());
+  }
+  return true;
+}
+
+bool writeCentralDirectory(QFile* out, const QVector<WrittenEntry>& written) {
+  const quint64 cdOffset = static_cast<quint64>(out->pos());
+  QByteArray cd;
+  for (const WrittenEntry& e : written) {
+    cd.append(centralHeader(e));
+  }
+  if (!writeAll(out, cd)) {
+    return false;
+  }
+  const quint64 cdSize = static_cast<quint64>(cd.size());
+  const quint64 count = static_cast<quint64>(written.size());
+  const bool zip64 = count >= kMax16 || cdOffset >= kMax32 || cdSize >= kMax32;
+
+  QByteArray end;
+  if (zip64) {
+    const quint64 zip64EndOffset = static_cast<quint64>(out->pos());
+    put32(&end, kZip64EndSig);
+    put64(&end, kZip64EndSize - 12);
+    put16(&end, static_cast<quint16>((kHostUnix << 8) | kVersionZip64));
+    put16(&end, kVersionZip64);
+    put32(&end, 0);
+    put32(&end, 0);
+    put64(&end, count);
+    put64(&end, count);
+    put64(&end, cdSize);
+    put64(&end, cdOffset);
+    put32(&end, kZip64LocatorSig);
+    put32(&end, 0);
+    put64(&end, zip64EndOffset);
+    put32(&end, 1);
+  }
+  put32(&end, kEndSig);
+  put16(&end, 0);
+  put16(&end, 0);
+  put16(&end, zip64 ? kMax16 : static_cast<quint16>(count));
+  put16(&end, zip64 ? kMax16 : static_cast<quint16>(count));
+  put32(&end, zip64 ? kMax32 : static_cast<quint32>(cdSize));
+  put32(&end, zip64 ? kMax32 : static_cast<quint32>(cdOffset));
+  put16(&end, 0);
+  return writeAll(out, end);
+}
+
+// --- Reading ---------------------------------------------------------------
+
+struct CentralEntry final {
+  QString name;
+  quint16 madeBy = 0;
+  quint16 flags = 0;
+  quint16 method = 0;
+  quint16 time = 0;
+  quint16 date = 0;
+  quint32 crc = 0;
+  quint64 compressedSize = 0;
+  quint64 size = 0;
+  quint64 offset = 0;
+  quint32 externalAttributes = 0;
+};
+
+bool readCentralDirectory(QFile* file, QVector<CentralEntry>* entries, QString* outError) {
+  const qint64 fileSize = file->size();
+  const QString notZip = QObject::tr("Not a ZIP archive or the archive is damaged.");
+  if (fileSize < kEndSize) {
+    return fail(outError, notZip);
+  }
+  const qint64 tailSize = std::min<qint64>(fileSize, kEndSize + kMaxCommentSize);
+  if (!file->seek(fileSize - tailSize)) {
+    return fail(outError, notZip);
+  }
+  const QByteArray tail = file->read(tailSize);
+  qsizetype endPos = -1;
+  for (qsizetype i = tail.size() - kEndSize; i >= 0; --i) {
+    if (get32(tail.constData() + i) == kEndSig) {
+      endPos = i;
+      break;
+    }
+  }
+  if (endPos < 0) {
+    return fail(outError, notZip);
+  }
+  const char* end = tail.constData() + endPos;
+  quint64 count = get16(end + 10);
+  quint64 cdSize = get32(end + 12);
+  quint64 cdOffset = get32(end + 16);
+
+  const qint64 endOffset = fileSize - tailSize + endPos;
+  if ((count == kMax16 || cdSize == kMax32 || cdOffset == kMax32) &&
+      endOffset >= kZip64LocatorSize) {
+    file->seek(endOffset - kZip64LocatorSize);
+    const QByteArray locator = file->read(kZip64LocatorSize);
+    if (locator.size() == kZip64LocatorSize && get32(locator.constData()) == kZip64LocatorSig) {
+      file->seek(static_cast<qint64>(get64(locator.constData() + 8)));
+      const QByteArray zip64End = file->read(kZip64EndSize);
+      if (zip64End.size() != kZip64EndSize || get32(zip64End.constData()) != kZip64EndSig) {
+        return fail(outError, notZip);
+      }
+      count = get64(zip64End.constData() + 32);
+      cdSize = get64(zip64End.constData() + 40);
+      cdOffset = get64(zip64End.constData() + 48);
+    }
+  }
+  if (cdOffset + cdSize > static_cast<quint64>(fileSize) || !file->seek(static_cast<qint64>(cdOffset))) {
+    return fail(outError, notZip);
+  }
+
+  const QByteArray cd = file->read(static_cast<qint64>(cdSize));
+  if (static_cast<quint64>(cd.size()) != cdSize) {
+    return fail(outError, notZip);
+  }
+  entries->reserve(static_cast<qsizetype>(std::min<quint64>(count, 1 << 20)));
+  qsizetype pos = 0;
+  for (quint64 i = 0; i < count; ++i) {
+    if (pos + kCentralHeaderSize > cd.size() || get32(cd.constData() + pos) != kCentralHeaderSig) {
+      return fail(outError, notZip);
+    }
+    const char* h = cd.constData() + pos;
+    CentralEntry e;
+    e.madeBy = get16(h + 4);
+    e.flags = get16(h + 8);
+    e.method = get16(h + 10);
+    e.time = get16(h + 12);
+    e.date = get16(h + 14);
+    e.crc = get32(h + 16);
+    e.compressedSize = get32(h + 20);
+    e.size = get32(h + 24);
+    const quint16 nameLen = get16(h + 28);
+    const quint16 extraLen = get16(h + 30);
+    const quint16 commentLen = get16(h + 32);
+    e.externalAttributes = get32(h + 38);
+    e.offset = get32(h + 42);
+    if (pos + kCentralHeaderSize + nameLen + extraLen + commentLen > cd.size()) {
+      return fail(outError, notZip);
+    }
+    // Names are UTF-8 when flagged; tools that don't flag it mostly write
+    // ASCII, which decodes the same.
+    e.name = QString::fromUtf8(h + kCentralHeaderSize, nameLen);
+
+    const char* extra = h + kCentralHeaderSize + nameLen;
+    for (int x = 0; x + 4 <= extraLen;) {
+      const quint16 id = get16(extra + x);
+      const quint16 len = get16(extra + x + 2);
+      if (x + 4 + len > extraLen) {
+        break;
+      }
+      if (id == kZip64ExtraId) {
+        const char* p = extra + x + 4;
+        const char* pEnd = p + len;
+        if (e.size == kMax32 && p + 8 <= pEnd) {
+          e.size = get64(p);
+          p += 8;
+        }
+        if (e.compressedSize == kMax32 && p + 8 <= pEnd) {
+          e.compressedSize = get64(p);
+          p += 8;
+        }
+        if (e.offset == kMax32 && p + 8 <= pEnd) {
+          e.offset = get64(p);
+        }
+      }
+      x += 4 + len;
+    }
+    entries->push_back(std::move(e));
+    pos += kCentralHeaderSize + nameLen + extraLen + commentLen;
+  }
+  return true;
+}
+
+// Relative path of an entry with "." parts dropped; false for anything that
+// would escape the destination.
+bool safeRelativePath(QString name, QString* out) {
+  name.replace(QLatin1Char('\\'), QLatin1Char('/'));
+  if (name.startsWith(QLatin1Char('/')) ||
+      (name.size() >= 2 && name.at(1) == QLatin1Char(':'))) {
+    return false;
+  }
+  QStringList parts;
+  for (const QString& part : name.split(QLatin1Char('/'), Qt::SkipEmptyParts)) {
+    if (part == QStringLiteral("..")) {
+      return false;
+    }
+    if (part != QStringLiteral(".")) {
+      parts.append(part);
+    }
+  }
+  *out = parts.join(QLatin1Char('/'));
+  return true;
+}
+
+bool extractEntry(QFile* archive, const CentralEntry& e, const QString& target,
+                  const std::function<void(qint64)>& advanced, QString* outError) {
+  const QString corrupt = QObject::tr("Archive entry %1 is damaged.").arg(e.name);
+  if (e.flags & kFlagEncrypted) {
+    return fail(outError, QObject::tr("Encrypted entry %1 is not supported.").arg(e.name));
+  }
+  if (e.method != kMethodStored && e.method != kMethodDeflated) {
+    return fail(outError, QObject::tr("Entry %1 uses unsupported compression method %2.")
+                              .arg(e.name)
+                              .arg(e.method));
+  }
+  if (!archive->seek(static_cast<qint64>(e.offset))) {
+    return fail(outError, corrupt);
+  }
+  const QByteArray local = archive->read(kLocalHeaderSize);
+  if (local.size() != kLocalHeaderSize || get32(local.constData()) != kLocalHeaderSig) {
+    return fail(outError, corrupt);
+  }
+  const qint64 dataStart = static_cast<qint64>(e.offset) + kLocalHeaderSize +
+                           get16(local.constData() + 26) + get16(local.constData() + 28);
+  if (!archive->seek(dataStart)) {
+    return fail(outError, corrupt);
+  }
+
+  QFile out(target);
+  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return fail(outError, QObject::tr("Could not write %1: %2")
+                              .arg(QDir::toNativeSeparators(target), out.errorString()));
+  }
+
+  QByteArray input(kChunkSize, Qt::Uninitialized);
+  QByteArray output(kChunkSize, Qt::Uninitialized);
+  uLong crc = crc32(0, nullptr, 0);
+  quint64 remaining = e.compressedSize;
+  quint64 produced = 0;
+  auto sink = [&](const char* data, qint64 size) {
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+    produced += static_cast<quint64>(size);
+    if (advanced) {
+      advanced(size);
+    }
+    return writeAll(&out, data, size);
+  };
+
+  if (e.method == kMethodStored) {
+    while (remaining > 0) {
+      const qint64 n =
+          archive->read(input.data(), static_cast<qint64>(std::min<quint64>(remaining, kChunkSize)));
+      if (n <= 0) {
+        return fail(outError, corrupt);
+      }
+      remaining -= static_cast<quint64>(n);
+      if (!sink(input.constData(), n)) {
+        return fail(outError, out.errorString());
+      }
+    }
+  } else {
+    z_stream zs{};
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+      return fail(outError, QObject::tr("Could not initialize decompression."));
+    }
+    int rc = Z_OK;
+    bool ok = true;
+    // A call that filled the output buffer may have more pending even with
+    // all input consumed; drain it before asking for more.
+    bool outputFull = false;
+    while (ok && rc != Z_STREAM_END) {
+      if (zs.avail_in == 0 && !outputFull) {
+        if (remaining == 0) {
+          ok = false;
+          break;
+        }
+        const qint64 n = archive->read(
+            input.data(), static_cast<qint64>(std::min<quint64>(remaining, kChunkSize)));
+        if (n <= 0) {
+          ok = false;
+          break;
+        }
+        remaining -= static_cast<quint64>(n);
+        zs.next_in = reinterpret_cast<Bytef*>(input.data());
+        zs.avail_in = static_cast<uInt>(n);
+      }
+      zs.next_out = reinterpret_cast<Bytef*>(output.data());
+      zs.avail_out = static_cast<uInt>(output.size());
+      rc = inflate(&zs, Z_NO_FLUSH);
+      if (rc == Z_BUF_ERROR && outputFull) {
+        // Nothing was pending after all.
+        rc = Z_OK;
+      } else if (rc != Z_OK && rc != Z_STREAM_END) {
+        ok = false;
+        break;
+      }
+      outputFull = zs.avail_out == 0;
+      if (!sink(output.constData(), output.size() - zs.avail_out)) {
+        inflateEnd(&zs);
+        return fail(outError, out.errorString());
+      }
+    }
+    inflateEnd(&zs);
+    if (!ok) {
+      return fail(outError, corrupt);
+    }
+  }
+
+  if (static_cast<quint32>(crc) != e.crc || produced != e.size) {
+    return fail(outError, corrupt);
+  }
+  const QDateTime modified = fromDosStamp(e.time, e.date);
+  if (modified.isValid()) {
+    (void)out.setFileTime(modified, QFileDevice::FileModificationTime);
+  }
+  out.close();
+
+  const quint32 mode = e.externalAttributes >> 16;
+  if ((e.madeBy >> 8) == kHostUnix && (mode & 0111)) {
+    (void)QFile::setPermissions(target, QFile::permissions(target) | QFileDevice::ExeOwner |
+                                            QFileDevice::ExeUser | QFileDevice::ExeGroup |
+                                            QFileDevice::ExeOther);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ZipArchive::createFromDirectory(const QString& sourceDir,
+                                     const QString& zipPath,
+                                     QString* outError,
+                                     const ProgressCallback& progress,
+                                     int threadCount) {
+  const QFileInfo sourceInfo(sourceDir);
+  if (!sourceInfo.isDir()) {
+    return fail(outError, QObject::tr("Source folder does not exist."));
+  }
+  const QFileInfo targetInfo(zipPath);
+  if (targetInfo.absolutePath().trimmed().isEmpty()) {
+    return fail(outError, QObject::tr("Destination path is invalid."));
+  }
+  if (!QDir().mkpath(targetInfo.absolutePath())) {
+    return fail(outError, QObject::tr("Could not create destination folder."));
+  }
+
+  QVector<SourceEntry> entries;
+  if (!collectEntries(sourceDir, &entries, outError)) {
+    return false;
+  }
+  qint64 totalBytes = 0;
+  for (const SourceEntry& entry : entries) {
+    totalBytes += entry.size;
+  }
+
+  QFile out(zipPath);
+  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return fail(outError, QObject::tr("Could not create %1: %2")
+                              .arg(QDir::toNativeSeparators(zipPath), out.errorString()));
+  }
+
+  qint64 doneBytes = 0;
+  QElapsedTimer sinceProgress;
+  sinceProgress.start();
+  auto advanced = [&](qint64 bytes) {
+    doneBytes += bytes;
+    if (progress && sinceProgress.elapsed() >= kProgressIntervalMs) {
+      sinceProgress.restart();
+      progress(doneBytes, totalBytes);
+    }
+  };
+  if (progress) {
+    progress(0, totalBytes);
+  }
+
+  // Small files are compressed ahead of the writer, a bounded window at a
+  // time so memory stays proportional to the thread count.
+  QMutex mutex;
+  QWaitCondition ready;
+  std::vector<CompressedFile> compressed(static_cast<size_t>(entries.size()));
+  std::atomic<bool> cancelled{false};
+  QThreadPool pool;
+  pool.setMaxThreadCount(threadCount > 0 ? threadCount : std::max(1, QThread::idealThreadCount()));
+  const qsizetype window = static_cast<qsizetype>(pool.maxThreadCount()) * 2;
+  qsizetype queued = 0;
+  auto isPooled = [&](qsizetype i) {
+    return !entries.at(i).isDir && entries.at(i).size <= kParallelMaxBytes;
+  };
+
+  QVector<WrittenEntry> written;
+  written.reserve(entries.size());
+  QString error;
+  bool ok = true;
+  for (qsizetype i = 0; ok && i < entries.size(); ++i) {
+    for (; queued < entries.size() && queued < i + window; ++queued) {
+      if (!isPooled(queued)) {
+        continue;
+      }
+      pool.start([&, index = queued] {
+        CompressedFile result;
+        if (!cancelled.load()) {
+          result = compressFile(entries.at(index));
+        }
+        QMutexLocker locker(&mutex);
+        compressed[static_cast<size_t>(index)] = std::move(result);
+        compressed[static_cast<size_t>(index)].done = true;
+        ready.wakeAll();
+      });
+    }
+
+    const SourceEntry& entry = entries.at(i);
+    WrittenEntry w;
+    w.name = entry.name;
+    w.isDir = entry.isDir;
+    w.mode = entry.mode;
+    w.stamp = entry.stamp;
+    if (entry.isDir) {
+      w.offset = static_cast<quint64>(out.pos());
+      ok = writeAll(&out, localHeader(w));
+      if (!ok) {
+        error = out.errorString();
+      }
+    } else if (isPooled(i)) {
+      CompressedFile file;
+      {
+        QMutexLocker locker(&mutex);
+        CompressedFile& slot = compressed[static_cast<size_t>(i)];
+        while (!slot.done) {
+          ready.wait(&mutex);
+        }
+        file = std::move(slot);
+      }
+      if (!file.error.isEmpty()) {
+        ok = false;
+        error = file.error;
+        break;
+      }
+      w.method = file.method;
+      w.crc = file.crc;
+      w.size = static_cast<quint64>(file.size);
+      w.compressedSize = static_cast<quint64>(file.data.size());
+      w.offset = static_cast<quint64>(out.pos());
+      ok = writeAll(&out, localHeader(w)) && writeAll(&out, file.data);
+      if (!ok) {
+        error = out.errorString();
+      }
+      advanced(file.size);
+    } else {
+      ok = streamLargeFile(entry, &out, &w, advanced, &error);
+    }
+    written.push_back(std::move(w));
+  }
+
+  if (ok && !writeCentralDirectory(&out, written)) {
+    ok = false;
+    error = out.errorString();
+  }
+  cancelled.store(true);
+  pool.waitForDone();
+
+  out.close();
+  if (!ok || out.error() != QFileDevice::NoError) {
+    (void)QFile::remove(zipPath);
+    return fail(outError, error.isEmpty() ? QObject::tr("Could not write the archive.") : error);
+  }
+  if (progress) {
+    progress(totalBytes, totalBytes);
+  }
+  if (outError) {
+    outError->clear();
+  }
+  return true;
+}
+
+bool ZipArchive::extractToDirectory(const QString& zipPath,
+                                    const QString& destinationDir,
+                                    QString* outError,
+                                    const ProgressCallback& progress) {
+  if (!QFileInfo(zipPath).isFile()) {
+    return fail(outError, QObject::tr("Archive file does not exist."));
+  }
+  if (!QDir().mkpath(destinationDir)) {
+    return fail(outError, QObject::tr("Could not create extraction folder."));
+  }
+  QFile archive(zipPath);
+  if (!archive.open(QIODevice::ReadOnly)) {
+    return fail(outError, QObject::tr("Could not open %1: %2")
+                              .arg(QDir::toNativeSeparators(zipPath), archive.errorString()));
+  }
+
+  QVector<CentralEntry> entries;
+  if (!readCentralDirectory(&archive, &entries, outError)) {
+    return false;
+  }
+  qint64 totalBytes = 0;
+  for (const CentralEntry& e : entries) {
+    totalBytes += static_cast<qint64>(e.size);
+  }
+
+  qint64 doneBytes = 0;
+  QElapsedTimer sinceProgress;
+  sinceProgress.start();
+  auto advanced = [&](qint64 bytes) {
+    doneBytes += bytes;
+    if (progress && sinceProgress.elapsed() >= kProgressIntervalMs) {
+      sinceProgress.restart();
+      progress(doneBytes, totalBytes);
+    }
+  };
+  if (progress) {
+    progress(0, totalBytes);
+  }
+
+  const QDir root(QDir(destinationDir).absolutePath());
+  for (const CentralEntry& e : entries) {
+    QString relative;
+    if (!safeRelativePath(e.name, &relative)) {
+      return fail(outError, QObject::tr("Archive entry %1 points outside the destination folder.")
+                                .arg(e.name));
+    }
+    if (relative.isEmpty()) {
+      continue;
+    }
+    const QString target = root.filePath(relative);
+    const bool isDir = e.name.endsWith(QLatin1Char('/')) || e.name.endsWith(QLatin1Char('\\')) ||
+                       ((e.externalAttributes & 0x10) && e.size == 0);
+    if (isDir) {
+      if (!QDir().mkpath(target)) {
+        return fail(outError, QObject::tr("Could not create folder %1.")
+                                  .arg(QDir::toNativeSeparators(target)));
+      }
+      continue;
+    }
+    if (!QDir().mkpath(QFileInfo(target).absolutePath())) {
+      return fail(outError, QObject::tr("Could not create folder for %1.")
+                                .arg(QDir::toNativeSeparators(target)));
+    }
+    if (!extractEntry(&archive, e, target, advanced, outError)) {
+      return false;
+    }
+  }
+
+  if (progress) {
+    progress(totalBytes, totalBytes);
+  }
+  if (outError) {
+    outError->clear();
+  }
+  return true;
+}
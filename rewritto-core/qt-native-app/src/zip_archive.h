@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QString>
+
+#include <functional>
+
+// In-process ZIP (deflate) archives, so exporting and importing projects no
+// longer depends on which of zip/tar/7z/python happens to be installed.
+// Writing reads and compresses files on a thread pool while the calling
+// thread appends finished entries in order; large files are deflated
+// straight into the archive in chunks. Nothing is staged on disk. Reading
+// streams each entry out through inflate and checks its CRC. Zip64 end
+// records and offsets are supported; single files must stay below 4 GiB.
+class ZipArchive final {
+ public:
+  // Uncompressed bytes processed so far and in total. Called on the calling
+  // thread.
+  using ProgressCallback = std::function<void(qint64 doneBytes, qint64 totalBytes)>;
+
+  // Archives `sourceDir` with entries under its folder name, like
+  // `zip -r out.zip <name>` run from the parent folder.
+  static bool createFromDirectory(const QString& sourceDir,
+                                  const QString& zipPath,
+                                  QString* outError = nullptr,
+                                  const ProgressCallback& progress = {},
+                                  int threadCount = 0);
+  // Extracts into `destinationDir`. Entries that would land outside it are
+  // rejected.
+  static bool extractToDirectory(const QString& zipPath,
+                                 const QString& destinationDir,
+                                 QString* outError = nullptr,
+                                 const ProgressCallback& progress = {});
+};
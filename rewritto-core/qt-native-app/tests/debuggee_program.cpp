@@ -0,0 +1,25 @@
+// Program the debug session tests run under gdb. The tests place
+// breakpoints on the lines carrying a `marker:` comment.
+#include <cstdio>
+
+struct Point {
+  int x;
+  int y;
+};
+
+static int accumulate(int count) {
+  int total = 0;
+  Point point{1, 2};
+  for (int i = 0; i < count; ++i) {
+    total += i;  // marker: loop-body
+    point.x += i;
+  }
+  return total + point.x + point.y;  // marker: loop-done
+}
+
+int main() {
+  int result = accumulate(5);  // marker: first-call
+  result += accumulate(3);
+  std::printf("%d\n", result);
+  return 0;
+}
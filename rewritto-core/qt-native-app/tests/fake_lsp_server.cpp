@@ -1,8 +1,10 @@
 #include <QCoreApplication>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <algorithm>
 #include <iostream>
 
 static bool readMessage(QJsonObject& out) {
@@ -40,6 +42,36 @@ static bool readMessage(QJsonObject& out) {
   return true;
 }
 
+static int offsetForPosition(const QString& text, const QJsonObject& pos) {
+  const int line = pos.value("line").toInt();
+  const int character = pos.value("character").toInt();
+  int offset = 0;
+  for (int l = 0; l < line && offset >= 0; ++l) {
+    offset = text.indexOf('\n', offset);
+    if (offset >= 0) {
+      ++offset;
+    }
+  }
+  if (offset < 0) {
+    return text.size();
+  }
+  return std::min(offset + character, static_cast<int>(text.size()));
+}
+
+static void applyContentChanges(QString& text, const QJsonArray& changes) {
+  for (const QJsonValue& v : changes) {
+    const QJsonObject change = v.toObject();
+    if (!change.contains("range")) {
+      text = change.value("text").toString();
+      continue;
+    }
+    const QJsonObject range = change.value("range").toObject();
+    const int start = offsetForPosition(text, range.value("start").toObject());
+    const int end = offsetForPosition(text, range.value("end").toObject());
+    text.replace(start, end - start, change.value("text").toString());
+  }
+}
+
 static void sendObject(const QJsonObject& obj) {
   const QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
   std::cout << "Content-Length: " << json.size() << "\r\n\r\n";
@@ -51,6 +83,10 @@ int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
 
   bool initialized = false;
+  QHash<QString, QString> documents;
+  int didChangeCount = 0;
+  int lastContentChangeCount = 0;
+  bool lastChangeHadRange = false;
 
   while (true) {
     QJsonObject msg;
@@ -67,6 +103,22 @@ int main(int argc, char** argv) {
       if (method == "exit") {
         return 0;
       }
+      const QJsonObject params = msg.value("params").toObject();
+      const QString uri =
+          params.value("textDocument").toObject().value("uri").toString();
+      if (method == "textDocument/didOpen") {
+        documents.insert(uri, params.value("textDocument")
+                                  .toObject()
+                                  .value("text")
+                                  .toString());
+      } else if (method == "textDocument/didChange") {
+        const QJsonArray changes = params.value("contentChanges").toArray();
+        ++didChangeCount;
+        lastContentChangeCount = changes.size();
+        lastChangeHadRange =
+            !changes.isEmpty() && changes.first().toObject().contains("range");
+        applyContentChanges(documents[uri], changes);
+      }
       continue;
     }
 
@@ -76,8 +128,15 @@ int main(int argc, char** argv) {
     }
 
     if (method == "initialize") {
+      QJsonObject capabilities;
+      const QByteArray syncKind = qgetenv("FAKE_LSP_SYNC_KIND");
+      if (!syncKind.isEmpty()) {
+        capabilities.insert("textDocumentSync",
+                            QJsonObject{{"openClose", true},
+                                        {"change", syncKind.toInt()}});
+      }
       QJsonObject result;
-      result.insert("capabilities", QJsonObject{});
+      result.insert("capabilities", capabilities);
       sendObject(QJsonObject{
           {"jsonrpc", "2.0"},
           {"id", id},
@@ -110,6 +169,59 @@ int main(int argc, char** argv) {
       continue;
     }
 
+    if (method == "fake/flood") {
+      // Burst of diagnostics notifications (like clangd after a big header
+      // edit), followed by the response so the client can time the batch.
+      const QJsonObject params = msg.value("params").toObject();
+      const int count = params.value("count").toInt();
+      const int perMessage = params.value("diagnosticsPerMessage").toInt(1);
+      QJsonArray diags;
+      for (int i = 0; i < perMessage; ++i) {
+        diags.push_back(QJsonObject{
+            {"range",
+             QJsonObject{
+                 {"start", QJsonObject{{"line", i}, {"character", 0}}},
+                 {"end", QJsonObject{{"line", i}, {"character", 8}}},
+             }},
+            {"severity", 2},
+            {"message", "unused variable 'value' [-Wunused-variable]"},
+        });
+      }
+      for (int i = 0; i < count; ++i) {
+        sendObject(QJsonObject{
+            {"jsonrpc", "2.0"},
+            {"method", "textDocument/publishDiagnostics"},
+            {"params",
+             QJsonObject{
+                 {"uri", QString("file:///tmp/flood%1.cpp").arg(i)},
+                 {"diagnostics", diags},
+             }},
+        });
+      }
+      sendObject(QJsonObject{
+          {"jsonrpc", "2.0"},
+          {"id", id},
+          {"result", count},
+      });
+      continue;
+    }
+
+    if (method == "fake/documentState") {
+      const QString uri = msg.value("params").toObject().value("uri").toString();
+      sendObject(QJsonObject{
+          {"jsonrpc", "2.0"},
+          {"id", id},
+          {"result",
+           QJsonObject{
+               {"text", documents.value(uri)},
+               {"didChangeCount", didChangeCount},
+               {"lastContentChangeCount", lastContentChangeCount},
+               {"lastChangeHadRange", lastChangeHadRange},
+           }},
+      });
+      continue;
+    }
+
     if (method == "textDocument/hover") {
       QJsonObject result;
       result.insert("contents",
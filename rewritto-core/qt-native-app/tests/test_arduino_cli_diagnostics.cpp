@@ -21,6 +21,7 @@ class TestArduinoCliDiagnostics final : public QObject {
   void parsesUndefinedReferenceWithLine();
   void prefixesIncludeChainContext();
   void parsesUploadToolErrors();
+  void benchmarkVerboseBuildReplay();
 };
 
 static bool makeExecutable(const QString& path) {
@@ -606,6 +607,93 @@ void TestArduinoCliDiagnostics::parsesUploadToolErrors() {
   qunsetenv("ARDUINO_CLI_CONFIG_FILE");
 }
 
+void TestArduinoCliDiagnostics::benchmarkVerboseBuildReplay() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  {
+    QSettings settings;
+    settings.beginGroup("Preferences");
+    settings.remove("additionalUrls");
+    settings.endGroup();
+  }
+
+  const QString cfg = dir.filePath("arduino-cli.yaml");
+  {
+    QFile f(cfg);
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+    f.write("# test\n");
+  }
+  qputenv("ARDUINO_CLI_CONFIG_FILE", cfg.toUtf8());
+
+  // A verbose build: mostly compiler command lines, with the captured
+  // diagnostics from the tests above mixed in (6 diagnostics per round).
+  const QByteArray command =
+      "/home/user/.arduino15/packages/esp32/tools/esp-x32/2405/bin/xtensa-esp32s3-elf-g++ "
+      "-MMD -c @/home/user/.arduino15/packages/esp32/hardware/esp32/3.0.7/flags/cpp_flags "
+      "-w -Os -Werror=return-type -DF_CPU=240000000L -DARDUINO=10607 "
+      "-DARDUINO_ESP32S3_DEV -DARDUINO_ARCH_ESP32 -DARDUINO_BOARD=\"ESP32S3_DEV\" "
+      "-I/home/user/.arduino15/packages/esp32/hardware/esp32/3.0.7/cores/esp32 "
+      "/tmp/arduino/sketches/ABC/sketch/sketch.ino.cpp "
+      "-o /tmp/arduino/sketches/ABC/sketch/sketch.ino.cpp.o\n";
+  const QByteArray diagnostics =
+      "sketch.ino:12:3: error: bad stuff\n"
+      "  foo();\n"
+      "  ^~~~\n"
+      "util.cpp:9: warning: beware\n"
+      "In file included from /tmp/sketch/a.h:1,\n"
+      "                 from /tmp/sketch/sketch.ino:1:\n"
+      "/tmp/sketch/b.h:2:5: error: boom\n"
+      "Multiple libraries were found for \"Servo.h\"\n"
+      "  Used: /home/user/Arduino/libraries/Servo\n"
+      "  Not used: /usr/share/arduino/libraries/Servo\n"
+      "collect2: error: ld returned 1 exit status\n"
+      "exit status 1\n";
+  constexpr int kRounds = 2000;
+  constexpr int kCommandsPerRound = 20;
+  constexpr int kDiagnosticsPerRound = 6;
+  const QString log = dir.filePath("verbose-build.log");
+  {
+    QFile f(log);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    for (int round = 0; round < kRounds; ++round) {
+      for (int i = 0; i < kCommandsPerRound; ++i) {
+        f.write(command);
+      }
+      f.write(diagnostics);
+    }
+  }
+
+  const QString script = dir.filePath("fake-arduino-cli.sh");
+  {
+    QFile f(script);
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+    f.write("#!/usr/bin/env bash\n");
+    f.write(QStringLiteral("cat '%1'\n").arg(log).toUtf8());
+  }
+  QVERIFY(makeExecutable(script));
+
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script);
+
+  QSignalSpy diagSpy(&cli, &ArduinoCli::diagnosticFound);
+  QSignalSpy finishedSpy(&cli, &ArduinoCli::finished);
+
+  QBENCHMARK {
+    diagSpy.clear();
+    finishedSpy.clear();
+    cli.run({QStringLiteral("compile")});
+    QVERIFY(finishedSpy.wait(60000));
+  }
+
+  QCOMPARE(diagSpy.count(), kRounds * kDiagnosticsPerRound);
+  QCOMPARE(diagSpy.at(2).at(0).toString(), QStringLiteral("/tmp/sketch/b.h"));
+  QVERIFY(diagSpy.at(2).at(4).toString().contains(QStringLiteral("In file included from")));
+  QCOMPARE(diagSpy.at(3).at(3).toString(), QStringLiteral("note"));
+
+  qunsetenv("ARDUINO_CLI_CONFIG_FILE");
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   QCoreApplication::setOrganizationName("RewrittoIdeTests");
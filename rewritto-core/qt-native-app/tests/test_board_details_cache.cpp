@@ -0,0 +1,202 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "arduino_cli.h"
+#include "board_details_cache.h"
+
+class TestBoardDetailsCache final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void fetchesOnceAndPersists();
+  void platformVersionChangeAndInvalidateDropEntries();
+  void requestsJumpAheadOfPrefetches();
+  void failedFetchIsNotRetried();
+
+ private:
+  QTemporaryDir dir_;
+  QString script_;
+  QString log_;
+
+  QStringList fetched() const;
+};
+
+static bool makeExecutable(const QString& path) {
+  QFile f(path);
+  QFile::Permissions p = f.permissions();
+  p |= QFile::ExeOwner | QFile::ExeGroup | QFile::ExeOther;
+  return f.setPermissions(p);
+}
+
+void TestBoardDetailsCache::initTestCase() {
+  QVERIFY(dir_.isValid());
+  const QString cfg = dir_.filePath("arduino-cli.yaml");
+  {
+    QFile f(cfg);
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+    f.write("# test\n");
+  }
+  qputenv("ARDUINO_CLI_CONFIG_FILE", cfg.toUtf8());
+
+  // Logs every FQBN it is asked about; boards under "broken:" fail.
+  log_ = dir_.filePath("fetched.log");
+  script_ = dir_.filePath("fake-arduino-cli.sh");
+  QFile f(script_);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+  f.write("#!/usr/bin/env bash\n"
+          "fqbn=\"\"\n"
+          "while [ $# -gt 0 ]; do\n"
+          "  if [ \"$1\" = \"--fqbn\" ]; then fqbn=\"$2\"; shift; fi\n"
+          "  shift\n"
+          "done\n");
+  f.write(QStringLiteral("echo \"$fqbn\" >> '%1'\n").arg(log_).toUtf8());
+  f.write("case \"$fqbn\" in broken:*) echo 'Error: unknown board' >&2; exit 1;; esac\n"
+          "echo '{\"fqbn\":\"'\"$fqbn\"'\",\"config_options\":[{\"option\":\"PSRAM\","
+          "\"option_label\":\"PSRAM\",\"values\":[{\"value\":\"disabled\","
+          "\"value_label\":\"Disabled\",\"selected\":true},{\"value\":\"enabled\","
+          "\"value_label\":\"Enabled\"}]}]}'\n");
+  f.close();
+  QVERIFY(makeExecutable(script_));
+}
+
+void TestBoardDetailsCache::cleanupTestCase() {
+  qunsetenv("ARDUINO_CLI_CONFIG_FILE");
+}
+
+QStringList TestBoardDetailsCache::fetched() const {
+  QFile f(log_);
+  if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return {};
+  }
+  return QString::fromUtf8(f.readAll()).split('\n', Qt::SkipEmptyParts);
+}
+
+void TestBoardDetailsCache::fetchesOnceAndPersists() {
+  QFile::remove(log_);
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script_);
+  const QString cachePath = dir_.filePath("persist/board-details.json");
+
+  {
+    BoardDetailsCache cache(&cli);
+    cache.setCachePath(cachePath);
+    QSignalSpy ready(&cache, &BoardDetailsCache::detailsReady);
+    QVERIFY(!cache.contains("esp32:esp32:esp32s3:PSRAM=enabled"));
+
+    cache.request("esp32:esp32:esp32s3:PSRAM=enabled");
+    QTRY_COMPARE(ready.count(), 1);
+    QCOMPARE(ready.at(0).at(0).toString(), QStringLiteral("esp32:esp32:esp32s3"));
+    QVERIFY(cache.contains("esp32:esp32:esp32s3"));
+    const QJsonArray options = cache.configOptions("esp32:esp32:esp32s3:PSRAM=disabled");
+    QCOMPARE(options.size(), qsizetype(1));
+    QCOMPARE(options.at(0).toObject().value("option").toString(), QStringLiteral("PSRAM"));
+
+    // Toggling options is answered from memory.
+    cache.request("esp32:esp32:esp32s3:PSRAM=disabled");
+    QTest::qWait(50);
+    QCOMPARE(ready.count(), 1);
+  }
+  QCOMPARE(fetched(), QStringList({"esp32:esp32:esp32s3"}));
+
+  // A new session reads the entry back without running the CLI.
+  BoardDetailsCache reopened(&cli);
+  reopened.setCachePath(cachePath);
+  QVERIFY(reopened.contains("esp32:esp32:esp32s3"));
+  QCOMPARE(reopened.configOptions("esp32:esp32:esp32s3").size(), qsizetype(1));
+  QCOMPARE(fetched().size(), qsizetype(1));
+}
+
+void TestBoardDetailsCache::platformVersionChangeAndInvalidateDropEntries() {
+  QFile::remove(log_);
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script_);
+  const QString cachePath = dir_.filePath("versions/board-details.json");
+
+  QString installed = QStringLiteral("3.0.1");
+  BoardDetailsCache cache(&cli);
+  cache.setCachePath(cachePath);
+  cache.setPlatformVersionResolver([&installed](const QString& platformId) {
+    return platformId == QStringLiteral("esp32:esp32") ? installed : QString{};
+  });
+  QSignalSpy ready(&cache, &BoardDetailsCache::detailsReady);
+
+  cache.request("esp32:esp32:esp32");
+  QTRY_COMPARE(ready.count(), 1);
+  QVERIFY(cache.contains("esp32:esp32:esp32"));
+
+  // An upgrade, even one made outside the IDE, makes the entry stale.
+  installed = QStringLiteral("3.0.2");
+  QVERIFY(!cache.contains("esp32:esp32:esp32"));
+  cache.request("esp32:esp32:esp32");
+  QTRY_COMPARE(ready.count(), 2);
+  QVERIFY(cache.contains("esp32:esp32:esp32"));
+
+  // An unknown version (catalog not loaded) accepts what is cached.
+  installed.clear();
+  QVERIFY(cache.contains("esp32:esp32:esp32"));
+
+  cache.invalidate();
+  QVERIFY(!cache.contains("esp32:esp32:esp32"));
+  BoardDetailsCache reopened(&cli);
+  reopened.setCachePath(cachePath);
+  QVERIFY(!reopened.contains("esp32:esp32:esp32"));
+  QCOMPARE(fetched().size(), qsizetype(2));
+}
+
+void TestBoardDetailsCache::requestsJumpAheadOfPrefetches() {
+  QFile::remove(log_);
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script_);
+
+  BoardDetailsCache cache(&cli);
+  cache.setCachePath(dir_.filePath("queue/board-details.json"));
+  QSignalSpy ready(&cache, &BoardDetailsCache::detailsReady);
+
+  cache.prefetch({"arduino:avr:uno", "arduino:avr:mega:cpu=atmega2560", "arduino:avr:nano",
+                  "arduino:avr:uno"});
+  cache.request("esp32:esp32:esp32");
+  QTRY_COMPARE(ready.count(), 4);
+  // The first prefetch was already running; the request went next.
+  QCOMPARE(fetched(), QStringList({"arduino:avr:uno", "esp32:esp32:esp32", "arduino:avr:mega",
+                                   "arduino:avr:nano"}));
+
+  // Everything is cached now, so nothing is queued again.
+  cache.prefetch({"arduino:avr:uno", "arduino:avr:nano", "not-an-fqbn"});
+  QTest::qWait(50);
+  QCOMPARE(fetched().size(), qsizetype(4));
+}
+
+void TestBoardDetailsCache::failedFetchIsNotRetried() {
+  QFile::remove(log_);
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script_);
+
+  BoardDetailsCache cache(&cli);
+  cache.setCachePath(dir_.filePath("failed/board-details.json"));
+  QSignalSpy ready(&cache, &BoardDetailsCache::detailsReady);
+
+  cache.request("broken:arch:board");
+  cache.request("arduino:avr:uno");
+  QTRY_COMPARE(ready.count(), 1);
+  QCOMPARE(ready.at(0).at(0).toString(), QStringLiteral("arduino:avr:uno"));
+  QVERIFY(!cache.contains("broken:arch:board"));
+
+  cache.request("broken:arch:board");
+  QTest::qWait(50);
+  QCOMPARE(fetched(), QStringList({"broken:arch:board", "arduino:avr:uno"}));
+
+  // A core install may have fixed it.
+  cache.invalidate();
+  cache.request("broken:arch:board");
+  QTRY_COMPARE(fetched().size(), qsizetype(3));
+}
+
+QTEST_MAIN(TestBoardDetailsCache)
+
+#include "test_board_details_cache.moc"
@@ -0,0 +1,170 @@
+#include <QtTest/QtTest>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "build_directory_manager.h"
+
+class TestBuildDirectoryManager final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void normalizesBoardOptionOrder();
+  void stablePathPerSketchBoardAndProfile();
+  void cleansSingleBuild();
+  void evictsLeastRecentlyUsed();
+  void skipsAcquiredBuilds();
+};
+
+namespace {
+void writeBytes(const QString& path, qint64 size) {
+  QFile f(path);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  QVERIFY(f.write(QByteArray(static_cast<int>(size), 'x')) == size);
+}
+}  // namespace
+
+void TestBuildDirectoryManager::normalizesBoardOptionOrder() {
+  QCOMPARE(BuildDirectoryManager::normalizedFqbn(
+               QStringLiteral("esp32:esp32:esp32:PSRAM=enabled,CPUFreq=240")),
+           QStringLiteral("esp32:esp32:esp32:CPUFreq=240,PSRAM=enabled"));
+  QCOMPARE(BuildDirectoryManager::normalizedFqbn(QStringLiteral(" arduino:avr:uno ")),
+           QStringLiteral("arduino:avr:uno"));
+}
+
+void TestBuildDirectoryManager::stablePathPerSketchBoardAndProfile() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString root = QDir(dir.path()).filePath("cache");
+  const QString sketch = QDir(dir.path()).filePath("Blink");
+
+  BuildDirectoryManager::Key avr{sketch, QStringLiteral("arduino:avr:uno"), false};
+  BuildDirectoryManager::Key esp{
+      sketch, QStringLiteral("esp32:esp32:esp32:PSRAM=enabled,CPUFreq=240"), false};
+  BuildDirectoryManager::Key espReordered{
+      sketch, QStringLiteral("esp32:esp32:esp32:CPUFreq=240,PSRAM=enabled"), false};
+  BuildDirectoryManager::Key espDebug = esp;
+  espDebug.optimizeForDebug = true;
+
+  QString err;
+  const QString avrPath = BuildDirectoryManager::buildPathFor(avr, root, &err);
+  QVERIFY2(!avrPath.isEmpty(), qPrintable(err));
+  QVERIFY(QDir(avrPath).exists());
+  QCOMPARE(BuildDirectoryManager::buildPathFor(avr, root), avrPath);
+  QCOMPARE(BuildDirectoryManager::lookupBuildPath(avr, root), avrPath);
+
+  const QString espPath = BuildDirectoryManager::buildPathFor(esp, root);
+  QVERIFY(!espPath.isEmpty());
+  QVERIFY(espPath != avrPath);
+  QCOMPARE(BuildDirectoryManager::buildPathFor(espReordered, root), espPath);
+  QVERIFY(BuildDirectoryManager::buildPathFor(espDebug, root) != espPath);
+
+  const auto entries = BuildDirectoryManager::listEntries(root);
+  QCOMPARE(entries.size(), 3);
+
+  BuildDirectoryManager::Key noBoard{sketch, {}, false};
+  QVERIFY(BuildDirectoryManager::buildPathFor(noBoard, root, &err).isEmpty());
+  QVERIFY(!err.isEmpty());
+}
+
+void TestBuildDirectoryManager::cleansSingleBuild() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString root = QDir(dir.path()).filePath("cache");
+  const QString sketch = QDir(dir.path()).filePath("Blink");
+
+  BuildDirectoryManager::Key avr{sketch, QStringLiteral("arduino:avr:uno"), false};
+  BuildDirectoryManager::Key nano{sketch, QStringLiteral("arduino:avr:nano"), false};
+  const QString avrPath = BuildDirectoryManager::buildPathFor(avr, root);
+  const QString nanoPath = BuildDirectoryManager::buildPathFor(nano, root);
+  writeBytes(QDir(avrPath).filePath("core.a"), 16);
+
+  QString err;
+  QVERIFY2(BuildDirectoryManager::cleanBuild(avr, root, &err), qPrintable(err));
+  QVERIFY(!QDir(avrPath).exists());
+  QVERIFY(QDir(nanoPath).exists());
+  QCOMPARE(BuildDirectoryManager::listEntries(root).size(), 1);
+
+  // Cleaning a build that never existed is not an error.
+  QVERIFY(BuildDirectoryManager::cleanBuild(avr, root, &err));
+}
+
+void TestBuildDirectoryManager::evictsLeastRecentlyUsed() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString root = QDir(dir.path()).filePath("cache");
+  const QString sketch = QDir(dir.path()).filePath("Blink");
+
+  BuildDirectoryManager::Key oldest{sketch, QStringLiteral("arduino:avr:uno"), false};
+  BuildDirectoryManager::Key middle{sketch, QStringLiteral("arduino:avr:nano"), false};
+  BuildDirectoryManager::Key newest{sketch, QStringLiteral("arduino:avr:mega"), false};
+
+  QStringList paths;
+  for (const auto& key : {oldest, middle, newest}) {
+    const QString path = BuildDirectoryManager::buildPathFor(key, root);
+    QVERIFY(!path.isEmpty());
+    writeBytes(QDir(path).filePath("sketch.ino.elf"), 1000);
+    BuildDirectoryManager::recordBuildFinished(path);
+    paths << path;
+    QThread::msleep(5);
+  }
+  QCOMPARE(BuildDirectoryManager::totalSizeBytes(root), qint64(3000));
+
+  // Touch the oldest so it becomes most recent; `middle` is now the LRU entry.
+  BuildDirectoryManager::recordBuildFinished(paths.at(0));
+
+  QCOMPARE(BuildDirectoryManager::evictToFit(5000, root), 0);
+  QCOMPARE(BuildDirectoryManager::evictToFit(2000, root), 1);
+  QVERIFY(QDir(paths.at(0)).exists());
+  QVERIFY(!QDir(paths.at(1)).exists());
+  QVERIFY(QDir(paths.at(2)).exists());
+
+  // Kept paths survive even when over budget.
+  QCOMPARE(BuildDirectoryManager::evictToFit(0, root, {paths.at(2)}), 1);
+  QVERIFY(!QDir(paths.at(0)).exists());
+  QVERIFY(QDir(paths.at(2)).exists());
+}
+
+void TestBuildDirectoryManager::skipsAcquiredBuilds() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString root = QDir(dir.path()).filePath("cache");
+  const QString sketch = QDir(dir.path()).filePath("Blink");
+
+  BuildDirectoryManager::Key idle{sketch, QStringLiteral("arduino:avr:uno"), false};
+  BuildDirectoryManager::Key compiling{sketch, QStringLiteral("arduino:avr:nano"), false};
+  const QString idlePath = BuildDirectoryManager::buildPathFor(idle, root);
+  const QString compilingPath = BuildDirectoryManager::acquireBuildPath(compiling, root);
+  QVERIFY(!idlePath.isEmpty());
+  QCOMPARE(compilingPath, BuildDirectoryManager::lookupBuildPath(compiling, root));
+  for (const QString& path : {idlePath, compilingPath}) {
+    writeBytes(QDir(path).filePath("sketch.ino.elf"), 1000);
+    BuildDirectoryManager::recordBuildFinished(path);
+  }
+
+  // A directory a compile is writing to is not evicted, however old.
+  QCOMPARE(BuildDirectoryManager::evictToFit(0, root), 1);
+  QVERIFY(!QDir(idlePath).exists());
+  QVERIFY(QDir(compilingPath).exists());
+  QCOMPARE(BuildDirectoryManager::listEntries(root).size(), 1);
+
+  // Holders are counted; the last release makes it evictable.
+  QCOMPARE(BuildDirectoryManager::acquireBuildPath(compiling, root), compilingPath);
+  BuildDirectoryManager::releaseBuild(compilingPath);
+  QCOMPARE(BuildDirectoryManager::evictToFit(0, root), 0);
+  BuildDirectoryManager::releaseBuild(compilingPath);
+  QCOMPARE(BuildDirectoryManager::evictToFit(0, root), 1);
+  QVERIFY(!QDir(compilingPath).exists());
+  QVERIFY(QDir(root).entryList(QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot).isEmpty());
+}
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+  TestBuildDirectoryManager tc;
+  return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_build_directory_manager.moc"
@@ -2,9 +2,12 @@
 
 #include <QApplication>
 #include <QKeyEvent>
+#include <QScrollBar>
+#include <QTextLayout>
 #include <QTextOption>
 
 #include "code_editor.h"
+#include "cpp_highlighter.h"
 
 class TestCodeEditor final : public QObject {
   Q_OBJECT
@@ -15,10 +18,18 @@ class TestCodeEditor final : public QObject {
   void tabInsertsSpaces();
   void shiftTabUnindentsCurrentLine();
   void togglesWhitespaceRendering();
+  void tracksActiveIndentGuide();
+  void benchmarkScrollingWithIndentGuides_data();
+  void benchmarkScrollingWithIndentGuides();
   void highlightsMatchingBrackets();
   void keepsBracketMatchWithDiagnosticsAndNavHighlight();
   void breakpointEnableDisableKeepsLine();
   void foldsAndUnfoldsBraceRegions();
+  void ignoresBracesInCommentsAndStrings();
+  void updatesFoldRegionsAsTextChanges();
+  void highlightsFromFoldLexing();
+  void benchmarkTypingInLargeFile_data();
+  void benchmarkTypingInLargeFile();
   void insertsAndNavigatesSnippets();
 };
 
@@ -90,6 +101,114 @@ void TestCodeEditor::togglesWhitespaceRendering() {
   QVERIFY(!(flags2 & QTextOption::ShowTabsAndSpaces));
 }
 
+void TestCodeEditor::tracksActiveIndentGuide() {
+  CodeEditor editor;
+  editor.setEditorSettings(2, true);
+  editor.setPlainText(
+      "void f() {\n"    // 1
+      "  int a;\n"      // 2
+      "  if (a) {\n"    // 3
+      "    a++;\n"      // 4
+      "\n"              // 5
+      "\t  a--;\n"      // 6
+      "  }\n"           // 7
+      "  return;\n"     // 8
+      "}\n");           // 9
+
+  const auto moveTo = [&editor](int line) {
+    editor.setTextCursor(QTextCursor(editor.document()->findBlockByNumber(line - 1)));
+  };
+  const auto expectGuide = [&editor](int level, int first, int last) {
+    QCOMPARE(editor.activeIndentGuideLevel(), level);
+    QCOMPARE(editor.activeIndentGuideFirstLine(), first);
+    QCOMPARE(editor.activeIndentGuideLastLine(), last);
+  };
+
+  moveTo(4);
+  expectGuide(2, 4, 6);
+  moveTo(5);
+  expectGuide(2, 4, 6);
+  // A line opening a block highlights the block's guide.
+  moveTo(3);
+  expectGuide(2, 4, 6);
+  moveTo(7);
+  expectGuide(1, 2, 8);
+  moveTo(1);
+  expectGuide(1, 2, 8);
+  moveTo(9);
+  QCOMPARE(editor.activeIndentGuideLevel(), 0);
+
+  // Re-indenting a line updates the scope without moving the cursor.
+  moveTo(8);
+  QTextCursor c(editor.document()->findBlockByNumber(2));
+  c.deleteChar();
+  c.deleteChar();
+  QCOMPARE(c.block().text(), QStringLiteral("if (a) {"));
+  expectGuide(1, 4, 8);
+  moveTo(2);
+  expectGuide(1, 2, 2);
+
+  // A tab is worth one indent unit.
+  editor.setEditorSettings(4, true);
+  moveTo(6);
+  expectGuide(1, 4, 6);
+
+  editor.setShowIndentGuides(false);
+  QCOMPARE(editor.activeIndentGuideLevel(), 0);
+}
+
+void TestCodeEditor::benchmarkScrollingWithIndentGuides_data() {
+  QTest::addColumn<bool>("guides");
+  QTest::newRow("without guides") << false;
+  QTest::newRow("with guides") << true;
+}
+
+void TestCodeEditor::benchmarkScrollingWithIndentGuides() {
+  QFETCH(bool, guides);
+
+  constexpr int kFunctions = 2000;
+  QString text;
+  for (int i = 0; i < kFunctions; ++i) {
+    text += QStringLiteral(
+                "void handler%1(int value) {\n"
+                "  for (int i = 0; i < value; ++i) {\n"
+                "    if ((i % 3) == 0) {\n"
+                "      switch (i) {\n"
+                "        case %1:\n"
+                "          process(i, value, \"a fairly long string literal that wraps\");\n"
+                "          break;\n"
+                "      }\n"
+                "    }\n"
+                "  }\n"
+                "}\n")
+                .arg(i);
+  }
+
+  CodeEditor editor;
+  editor.resize(600, 800);
+  editor.setLineWrapMode(QPlainTextEdit::WidgetWidth);
+  editor.setPlainText(text);
+  editor.show();
+  QVERIFY(QTest::qWaitForWindowExposed(&editor));
+  editor.setTextCursor(QTextCursor(editor.document()->findBlockByNumber(5)));
+
+  editor.setShowIndentGuides(guides);
+
+  // 300 scroll steps, each painted synchronously as one frame.
+  QScrollBar* bar = editor.verticalScrollBar();
+  QVERIFY(bar && bar->maximum() > 0);
+  int frames = 0;
+  QBENCHMARK {
+    bar->setValue(0);
+    frames = 0;
+    for (; frames < 300 && bar->value() < bar->maximum(); ++frames) {
+      bar->setValue(bar->value() + bar->singleStep() * 3);
+      editor.viewport()->repaint();
+    }
+  }
+  QCOMPARE(frames, 300);
+}
+
 void TestCodeEditor::highlightsMatchingBrackets() {
   CodeEditor editor;
   editor.setPlainText("{\n}\n");
@@ -217,6 +336,176 @@ void TestCodeEditor::foldsAndUnfoldsBraceRegions() {
   QCOMPARE(visibleAfterUnfold, visibleBefore);
 }
 
+void TestCodeEditor::ignoresBracesInCommentsAndStrings() {
+  CodeEditor editor;
+  editor.setPlainText(
+      "void foo() {\n"           // 1
+      "  // {\n"                 // 2
+      "  const char* s = \"{\";\n"  // 3
+      "  char c = '}';\n"        // 4
+      "  /* }\n"                 // 5
+      "     { */\n"              // 6
+      "#define OPEN {\n"         // 7
+      "}\n"                      // 8
+      "int after = 1;\n");
+
+  QVERIFY(editor.canFold(1));
+  for (int line = 2; line <= 9; ++line) {
+    QVERIFY(!editor.canFold(line));
+  }
+
+  editor.toggleFold(1);
+  QVERIFY(editor.isFolded(1));
+  QVERIFY(!editor.document()->findBlockByNumber(7).isVisible());
+  QVERIFY(editor.document()->findBlockByNumber(8).isVisible());
+}
+
+void TestCodeEditor::updatesFoldRegionsAsTextChanges() {
+  CodeEditor editor;
+  editor.setPlainText(
+      "void a() {\n"
+      "  x();\n"
+      "}\n"
+      "void b() {\n"
+      "  y();\n"
+      "}\n");
+  QVERIFY(editor.canFold(1));
+  QVERIFY(editor.canFold(4));
+
+  // Opening a block comment hides every brace after it...
+  QTextCursor c(editor.document()->findBlockByNumber(1));
+  c.insertText("/*");
+  QVERIFY(!editor.canFold(1));
+  QVERIFY(!editor.canFold(4));
+
+  // ...until it is closed again.
+  c.movePosition(QTextCursor::EndOfBlock);
+  c.insertText("*/");
+  QVERIFY(editor.canFold(1));
+  QVERIFY(editor.canFold(4));
+
+  // New lines shift the regions below them.
+  c.movePosition(QTextCursor::Start);
+  c.insertText("int first;\nint second;\n");
+  QVERIFY(!editor.canFold(1));
+  QVERIFY(editor.canFold(3));
+  QVERIFY(editor.canFold(6));
+
+  // A fold whose closing brace goes away is undone; joining lines keeps
+  // the rest in place.
+  editor.toggleFold(6);
+  QVERIFY(editor.isFolded(6));
+  QTextCursor last(editor.document()->findBlockByNumber(7));
+  last.select(QTextCursor::BlockUnderCursor);
+  last.removeSelectedText();
+  QVERIFY(!editor.canFold(6));
+  QVERIFY(!editor.isFolded(6));
+  QVERIFY(editor.document()->findBlockByNumber(6).isVisible());
+
+  c.movePosition(QTextCursor::Start);
+  c.movePosition(QTextCursor::EndOfBlock);
+  c.deleteChar();
+  QVERIFY(editor.canFold(2));
+  QCOMPARE(editor.document()->findBlockByNumber(0).text(),
+           QStringLiteral("int first;int second;"));
+}
+
+void TestCodeEditor::highlightsFromFoldLexing() {
+  const QString text = QStringLiteral(
+      "void foo() {\n"
+      "  int x = 1;  // {\n"
+      "  const char* s = \"}\";\n"
+      "}\n"
+      "#define OPEN {\n"
+      "int after = 2;\n");
+
+  // The highlighter formats from the tokens the editor lexed for folding;
+  // a plain document lexes on its own.
+  CodeEditor editor;
+  (void)new CppHighlighter(editor.document());
+  editor.setPlainText(text);
+  QTextDocument reference;
+  (void)new CppHighlighter(&reference);
+  reference.setPlainText(text);
+
+  const auto expectSameFormats = [&] {
+    QCOMPARE(editor.document()->blockCount(), reference.blockCount());
+    for (QTextBlock a = editor.document()->firstBlock(), b = reference.firstBlock();
+         a.isValid() && b.isValid(); a = a.next(), b = b.next()) {
+      QCOMPARE(a.layout()->formats(), b.layout()->formats());
+    }
+  };
+  expectSameFormats();
+
+  // Opening a block comment re-lexes the lines below it in both.
+  for (QTextDocument* doc : {editor.document(), &reference}) {
+    QTextCursor c(doc->findBlockByNumber(1));
+    c.insertText(QStringLiteral("/*"));
+  }
+  expectSameFormats();
+  QVERIFY(!editor.canFold(1));
+
+  for (QTextDocument* doc : {editor.document(), &reference}) {
+    QTextCursor c(doc->findBlockByNumber(2));
+    c.movePosition(QTextCursor::EndOfBlock);
+    c.insertText(QStringLiteral(" */"));
+  }
+  expectSameFormats();
+  QVERIFY(editor.canFold(1));
+}
+
+void TestCodeEditor::benchmarkTypingInLargeFile_data() {
+  QTest::addColumn<QString>("typed");
+  QTest::addColumn<bool>("foldsWhileTyped");
+  QTest::newRow("identifier") << QStringLiteral("x") << true;
+  // Opening a block comment re-lexes everything below it once.
+  QTest::newRow("block comment") << QStringLiteral("/*") << false;
+}
+
+void TestCodeEditor::benchmarkTypingInLargeFile() {
+  QFETCH(QString, typed);
+  QFETCH(bool, foldsWhileTyped);
+
+  constexpr int kFunctions = 2000;
+  QString text;
+  for (int i = 0; i < kFunctions; ++i) {
+    text += QStringLiteral(
+                "// helper %1\n"
+                "int helper%1(int value) {\n"
+                "  if (value > %1) {\n"
+                "    return value - %1;  // { not a brace\n"
+                "  }\n"
+                "  const char* name = \"helper{%1}\";\n"
+                "  /* keep\n"
+                "     going */\n"
+                "  return value;\n"
+                "}\n")
+                .arg(i);
+  }
+
+  CodeEditor editor;
+  editor.resize(800, 600);
+  editor.show();
+  editor.setPlainText(text);
+  const int lines = editor.document()->blockCount();
+  QVERIFY(lines > 20000);
+  QVERIFY(editor.canFold(2));
+
+  // Type in the middle of the file and erase it again, so every iteration
+  // starts from the same document.
+  QTextCursor c(editor.document()->findBlockByNumber(lines / 2));
+  editor.setTextCursor(c);
+  QBENCHMARK {
+    QTest::keyClicks(&editor, typed);
+    QCOMPARE(editor.canFold(lines - 8), foldsWhileTyped);
+    for (qsizetype i = 0; i < typed.size(); ++i) {
+      QTest::keyClick(&editor, Qt::Key_Backspace);
+    }
+  }
+  QVERIFY(editor.canFold(lines - 8));
+  QCOMPARE(editor.toPlainText(), text);
+}
+
 void TestCodeEditor::insertsAndNavigatesSnippets() {
   CodeEditor editor;
   editor.setPlainText("");
@@ -3,8 +3,13 @@
 #include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QDir>
+#include <QDirIterator>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QTemporaryDir>
+#include <QThread>
 
 #include "code_snapshot_store.h"
 
@@ -13,8 +18,49 @@ class TestCodeSnapshotStore final : public QObject {
 
  private slots:
   void createsListsRestoresAndDeletes();
+  void deduplicatesObjectsAcrossSnapshots();
+  void reusesUnchangedFilesByMtime();
+  void readsVersionOneSnapshots();
 };
 
+namespace {
+// Back-dated so files fall outside the store's racy-mtime window.
+QDateTime oldMtime() {
+  static const QDateTime kOld = QDateTime::currentDateTimeUtc().addSecs(-3600);
+  return kOld;
+}
+
+void writeFile(const QString& path,
+               const QByteArray& bytes,
+               const QDateTime& mtime = oldMtime()) {
+  QVERIFY(QDir().mkpath(QFileInfo(path).absolutePath()));
+  QFile f(path);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  QCOMPARE(f.write(bytes), bytes.size());
+  QVERIFY(f.flush());
+  QVERIFY(f.setFileTime(mtime, QFileDevice::FileModificationTime));
+}
+
+QStringList objectFiles(const QString& sketch) {
+  QStringList out;
+  QDirIterator it(CodeSnapshotStore::objectsRootForSketch(sketch), QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    out << it.next();
+  }
+  return out;
+}
+
+QString shaFor(const CodeSnapshotStore::Snapshot& snapshot, const QString& rel) {
+  for (const auto& f : snapshot.files) {
+    if (f.relativePath == rel) {
+      return f.sha1Hex;
+    }
+  }
+  return {};
+}
+}  // namespace
+
 void TestCodeSnapshotStore::createsListsRestoresAndDeletes() {
   QTemporaryDir dir;
   QVERIFY(dir.isValid());
@@ -117,6 +163,141 @@ void TestCodeSnapshotStore::createsListsRestoresAndDeletes() {
   QCOMPARE(list2.size(), 0);
 }
 
+void TestCodeSnapshotStore::deduplicatesObjectsAcrossSnapshots() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = QDir(dir.path()).absoluteFilePath("sketch");
+  QByteArray vendored;
+  for (int i = 0; i < 4096; ++i) {
+    vendored += "static const uint8_t font_row_" + QByteArray::number(i) + "[] = {0x00, 0x3C};\n";
+  }
+  writeFile(QDir(sketch).filePath("sketch.ino"), "void setup() {}\n");
+  writeFile(QDir(sketch).filePath("src/vendor/font.h"), vendored);
+
+  QString err;
+  CodeSnapshotStore::CreateOptions options;
+  options.sketchFolder = sketch;
+  CodeSnapshotStore::SnapshotMeta first;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &first, &err), qPrintable(err));
+  QCOMPARE(objectFiles(sketch).size(), 2);
+
+  // Deflated objects are smaller than the vendored header.
+  qint64 storedBytes = 0;
+  for (const QString& path : objectFiles(sketch)) {
+    storedBytes += QFileInfo(path).size();
+  }
+  QVERIFY(storedBytes < vendored.size() / 2);
+
+  QThread::msleep(5);
+  options.fileOverrides.insert(QStringLiteral("sketch.ino"), "void setup() { init(); }\n");
+  CodeSnapshotStore::SnapshotMeta second;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &second, &err), qPrintable(err));
+  QCOMPARE(objectFiles(sketch).size(), 3);
+
+  const auto secondSnapshot = CodeSnapshotStore::readSnapshot(sketch, second.id, &err);
+  QVERIFY2(secondSnapshot.has_value(), qPrintable(err));
+  const QString fontSha = shaFor(*secondSnapshot, QStringLiteral("src/vendor/font.h"));
+  QCOMPARE(CodeSnapshotStore::objectReferenceCounts(sketch).value(fontSha), 2);
+  for (const auto& f : secondSnapshot->files) {
+    if (f.relativePath == QStringLiteral("src/vendor/font.h")) {
+      QCOMPARE(CodeSnapshotStore::readSnapshotFile(sketch, second.id, f, &err), vendored);
+    }
+  }
+
+  // Deleting the first snapshot only drops its private sketch.ino object.
+  QVERIFY2(CodeSnapshotStore::deleteSnapshot(sketch, first.id, &err), qPrintable(err));
+  QCOMPARE(objectFiles(sketch).size(), 2);
+  QVERIFY2(CodeSnapshotStore::restoreSnapshot(sketch, second.id, nullptr, &err),
+           qPrintable(err));
+  QFile restored(QDir(sketch).filePath("sketch.ino"));
+  QVERIFY(restored.open(QIODevice::ReadOnly));
+  QCOMPARE(restored.readAll(), QByteArray("void setup() { init(); }\n"));
+
+  QVERIFY2(CodeSnapshotStore::deleteSnapshot(sketch, second.id, &err), qPrintable(err));
+  QVERIFY(objectFiles(sketch).isEmpty());
+
+  // Orphans (e.g. from an interrupted snapshot) are swept by collectGarbage.
+  writeFile(QDir(CodeSnapshotStore::objectsRootForSketch(sketch)).filePath("ab/orphan"), "x");
+  QCOMPARE(CodeSnapshotStore::collectGarbage(sketch), 1);
+
+  // An interrupted snapshot leaves its .tmp- folder behind; the next one
+  // sweeps the orphans it wrote.
+  writeFile(QDir(CodeSnapshotStore::objectsRootForSketch(sketch)).filePath("cd/orphan"), "x");
+  const QString leftover =
+      QDir(CodeSnapshotStore::snapshotsRootForSketch(sketch)).filePath(".tmp-interrupted");
+  QVERIFY(QDir().mkpath(leftover));
+  CodeSnapshotStore::SnapshotMeta third;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &third, &err), qPrintable(err));
+  QVERIFY(!QFileInfo::exists(leftover));
+  QCOMPARE(objectFiles(sketch).size(), 2);
+}
+
+void TestCodeSnapshotStore::reusesUnchangedFilesByMtime() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = QDir(dir.path()).absoluteFilePath("sketch");
+  const QString ino = QDir(sketch).filePath("sketch.ino");
+  writeFile(ino, "aaaa\n");
+
+  QString err;
+  CodeSnapshotStore::CreateOptions options;
+  options.sketchFolder = sketch;
+  CodeSnapshotStore::SnapshotMeta first;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &first, &err), qPrintable(err));
+
+  // Same size and mtime: the previous object is linked without reading the
+  // file, so the (deliberately hidden) edit is not picked up.
+  writeFile(ino, "bbbb\n");
+  QThread::msleep(5);
+  CodeSnapshotStore::SnapshotMeta second;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &second, &err), qPrintable(err));
+  const auto a = CodeSnapshotStore::readSnapshot(sketch, first.id);
+  const auto b = CodeSnapshotStore::readSnapshot(sketch, second.id);
+  QVERIFY(a && b);
+  QCOMPARE(shaFor(*b, QStringLiteral("sketch.ino")), shaFor(*a, QStringLiteral("sketch.ino")));
+
+  // A newer mtime forces a re-hash.
+  writeFile(ino, "cccc\n", oldMtime().addSecs(60));
+  QThread::msleep(5);
+  CodeSnapshotStore::SnapshotMeta third;
+  QVERIFY2(CodeSnapshotStore::createSnapshot(options, &third, &err), qPrintable(err));
+  const auto c = CodeSnapshotStore::readSnapshot(sketch, third.id);
+  QVERIFY(c.has_value());
+  QVERIFY(shaFor(*c, QStringLiteral("sketch.ino")) != shaFor(*a, QStringLiteral("sketch.ino")));
+}
+
+void TestCodeSnapshotStore::readsVersionOneSnapshots() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = QDir(dir.path()).absoluteFilePath("sketch");
+  const QString snapshotDir =
+      QDir(CodeSnapshotStore::snapshotsRootForSketch(sketch)).filePath("20240101-000000-000_legacy");
+  const QByteArray bytes("void loop() {}\n");
+  writeFile(QDir(snapshotDir).filePath("files/sketch.ino"), bytes);
+
+  QJsonObject file;
+  file.insert("path", "sketch.ino");
+  file.insert("sizeBytes", static_cast<int>(bytes.size()));
+  file.insert("sha1", QString::fromLatin1(
+                          QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex()));
+  QJsonObject meta;
+  meta.insert("version", 1);
+  meta.insert("id", "20240101-000000-000_legacy");
+  meta.insert("createdAtUtc", "2024-01-01T00:00:00.000Z");
+  meta.insert("files", QJsonArray{file});
+  QFile metaFile(QDir(snapshotDir).filePath("meta.json"));
+  QVERIFY(metaFile.open(QIODevice::WriteOnly));
+  metaFile.write(QJsonDocument(meta).toJson());
+  metaFile.close();
+
+  QString err;
+  QVERIFY2(CodeSnapshotStore::restoreSnapshot(sketch, "20240101-000000-000_legacy", nullptr, &err),
+           qPrintable(err));
+  QFile restored(QDir(sketch).filePath("sketch.ino"));
+  QVERIFY(restored.open(QIODevice::ReadOnly));
+  QCOMPARE(restored.readAll(), bytes);
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   TestCodeSnapshotStore tc;
@@ -0,0 +1,335 @@
+#include <QtTest/QtTest>
+
+#include <QApplication>
+#include <QRegularExpression>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+
+#include "cpp_highlighter.h"
+#include "cpp_lexer.h"
+
+namespace {
+using Kind = CppLexer::TokenKind;
+
+QVector<CppLexer::Token> lex(const QString& line, int previousState = 0,
+                             int* outState = nullptr) {
+  QVector<CppLexer::Token> tokens;
+  const int state = CppLexer::lexLine(line, previousState, &tokens);
+  if (outState) {
+    *outState = state;
+  }
+  return tokens;
+}
+
+bool hasToken(const QVector<CppLexer::Token>& tokens, int start, int length,
+              Kind kind) {
+  for (const auto& t : tokens) {
+    if (t.start == start && t.length == length && t.kind == kind) {
+      return true;
+    }
+  }
+  return false;
+}
+
+QColor foregroundAt(const QTextBlock& block, int pos) {
+  QColor color;
+  for (const QTextLayout::FormatRange& range : block.layout()->formats()) {
+    if (pos >= range.start && pos < range.start + range.length) {
+      color = range.format.foreground().color();
+    }
+  }
+  return color;
+}
+
+// The per-rule regex highlighter CppHighlighter used before the lexer; kept
+// here as the benchmark baseline.
+class RegexCppHighlighter final : public QSyntaxHighlighter {
+ public:
+  explicit RegexCppHighlighter(QTextDocument* parent) : QSyntaxHighlighter(parent) {
+    const QStringList patterns = {
+        R"(\b(auto|break|case|catch|char|class|const|constexpr|continue|default|delete|do|double|else|enum|explicit|extern|false|float|for|friend|goto|if|inline|int|long|mutable|namespace|new|nullptr|operator|private|protected|public|register|reinterpret_cast|return|short|signed|sizeof|static|struct|switch|template|this|throw|true|try|typedef|typename|union|unsigned|using|virtual|void|volatile|while)\b)",
+        R"(\b(setup|loop|HIGH|LOW|INPUT|OUTPUT|INPUT_PULLUP|LED_BUILTIN|pinMode|digitalWrite|digitalRead|analogRead|analogWrite|delay|millis|micros|Serial|Serial1|Serial2|Serial3|Wire|SPI)\b)",
+        R"(^\s*#\s*\w+.*$)",
+        R"(//[^\n]*)",
+        R"("([^"\\]|\\.)*")",
+        R"('([^'\\]|\\.)*')",
+        R"(\b(0x[0-9A-Fa-f]+|\d+(\.\d+)?)\b)",
+    };
+    for (const QString& pattern : patterns) {
+      rules_.push_back(QRegularExpression(pattern));
+    }
+    format_.setForeground(Qt::blue);
+  }
+
+ protected:
+  void highlightBlock(const QString& text) override {
+    for (const QRegularExpression& rule : rules_) {
+      auto it = rule.globalMatch(text);
+      while (it.hasNext()) {
+        const auto m = it.next();
+        setFormat(m.capturedStart(), m.capturedLength(), format_);
+      }
+    }
+    setCurrentBlockState(0);
+    int startIndex = 0;
+    if (previousBlockState() != 1) {
+      const auto match = commentStart_.match(text);
+      startIndex = match.hasMatch() ? match.capturedStart() : -1;
+    }
+    while (startIndex >= 0) {
+      const auto endMatch = commentEnd_.match(text, startIndex);
+      const int endIndex = endMatch.hasMatch() ? endMatch.capturedStart() : -1;
+      int commentLength = 0;
+      if (endIndex == -1) {
+        setCurrentBlockState(1);
+        commentLength = text.length() - startIndex;
+      } else {
+        commentLength = endIndex - startIndex + endMatch.capturedLength();
+      }
+      setFormat(startIndex, commentLength, format_);
+      const auto next = commentStart_.match(text, startIndex + commentLength);
+      startIndex = next.hasMatch() ? next.capturedStart() : -1;
+    }
+  }
+
+ private:
+  QVector<QRegularExpression> rules_;
+  QRegularExpression commentStart_{QStringLiteral(R"(/\*)")};
+  QRegularExpression commentEnd_{QStringLiteral(R"(\*/)")};
+  QTextCharFormat format_;
+};
+
+// Resembles a generated font table / register map header.
+QString generatedHeader(int lines) {
+  QString out;
+  out.reserve(lines * 64);
+  out += QStringLiteral("/*\n * Generated font table. Do not edit.\n */\n");
+  out += QStringLiteral("#pragma once\n#include <stdint.h>\n");
+  for (int i = 0; out.count(QLatin1Char('\n')) < lines; ++i) {
+    switch (i % 4) {
+      case 0:
+        out += QStringLiteral("#define REG_%1_OFFSET 0x%2u  // register %1\n")
+                   .arg(i)
+                   .arg(i * 4, 4, 16, QLatin1Char('0'));
+        break;
+      case 1:
+        out += QStringLiteral("static const uint8_t glyph_%1[] = {0x%2, 0x3C, 0x66, 0x7E, 0x66};\n")
+                   .arg(i)
+                   .arg(i & 0xFF, 2, 16, QLatin1Char('0'));
+        break;
+      case 2:
+        out += QStringLiteral("  if (value > %1) { Serial.println(\"overflow %1\"); return false; }\n")
+                   .arg(i);
+        break;
+      default:
+        out += QStringLiteral("/* block %1 */ const char* name_%1 = \"glyph\";\n").arg(i);
+        break;
+    }
+  }
+  return out;
+}
+}  // namespace
+
+class TestCppHighlighter final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void perfectHashFindsEveryKeyword();
+  void lexesSingleLineTokens();
+  void carriesBlockCommentState();
+  void carriesRawStringState();
+  void carriesPreprocessorContinuation();
+  void highlighterPropagatesCommentEdits();
+  void highlighterKeepsBreakpointBlockState();
+  void benchmarkLinesPerSecond_data();
+  void benchmarkLinesPerSecond();
+};
+
+void TestCppHighlighter::perfectHashFindsEveryKeyword() {
+  Kind kind = Kind::Number;
+  QVERIFY(CppLexer::lookupKeyword(u"reinterpret_cast", &kind));
+  QCOMPARE(kind, Kind::Keyword);
+  QVERIFY(CppLexer::lookupKeyword(u"do", &kind));
+  QVERIFY(CppLexer::lookupKeyword(u"bool", &kind));
+  QVERIFY(CppLexer::lookupKeyword(u"digitalWrite", &kind));
+  QCOMPARE(kind, Kind::SketchIdentifier);
+  QVERIFY(CppLexer::lookupKeyword(u"Serial3", &kind));
+
+  QVERIFY(!CppLexer::lookupKeyword(u"Setup", nullptr));
+  QVERIFY(!CppLexer::lookupKeyword(u"digitalwrite", nullptr));
+  QVERIFY(!CppLexer::lookupKeyword(u"i", nullptr));
+  QVERIFY(!CppLexer::lookupKeyword(u"", nullptr));
+  QVERIFY(!CppLexer::lookupKeyword(u"whileX", nullptr));
+}
+
+void TestCppHighlighter::lexesSingleLineTokens() {
+  const QString line =
+      QStringLiteral("int x = 0x1F + 1'000 + 2.5e-3f; // note \"quoted\"");
+  int state = -1;
+  const auto tokens = lex(line, 0, &state);
+  QCOMPARE(state, CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 0, 3, Kind::Keyword));
+  QVERIFY(hasToken(tokens, 8, 4, Kind::Number));
+  QVERIFY(hasToken(tokens, 15, 5, Kind::Number));
+  QVERIFY(hasToken(tokens, 23, 7, Kind::Number));
+  QVERIFY(hasToken(tokens, 32, static_cast<int>(line.size()) - 32, Kind::Comment));
+  QCOMPARE(tokens.size(), 5);
+
+  // Keywords inside literals and identifiers are not keywords.
+  const auto literal = lex(QStringLiteral("print(u8\"for \\\" if\", 'x', return_value);"));
+  QVERIFY(hasToken(literal, 6, 13, Kind::String));
+  QVERIFY(hasToken(literal, 21, 3, Kind::String));
+  QCOMPARE(literal.size(), 2);
+}
+
+void TestCppHighlighter::carriesBlockCommentState() {
+  int state = 0;
+  auto tokens = lex(QStringLiteral("int a; /* starts"), 0, &state);
+  QVERIFY(CppLexer::isInBlockComment(state));
+  QVERIFY(hasToken(tokens, 7, 9, Kind::Comment));
+
+  tokens = lex(QStringLiteral("  while (true) still comment"), state, &state);
+  QVERIFY(CppLexer::isInBlockComment(state));
+  QCOMPARE(tokens.size(), 1);
+
+  tokens = lex(QStringLiteral("ends */ return 1;"), state, &state);
+  QCOMPARE(state, CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 0, 7, Kind::Comment));
+  QVERIFY(hasToken(tokens, 8, 6, Kind::Keyword));
+  QVERIFY(hasToken(tokens, 15, 1, Kind::Number));
+
+  // Foreign block states (e.g. breakpoint markers) read as a normal state.
+  tokens = lex(QStringLiteral("return 0;"), 101, &state);
+  QVERIFY(hasToken(tokens, 0, 6, Kind::Keyword));
+  QVERIFY(!CppLexer::isLexerState(101));
+}
+
+void TestCppHighlighter::carriesRawStringState() {
+  int state = 0;
+  auto tokens = lex(QStringLiteral("auto s = R\"xy(first )\" line"), 0, &state);
+  QVERIFY(state != CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 9, 18, Kind::String));
+
+  // `)"` does not close a raw string with delimiter `xy`.
+  tokens = lex(QStringLiteral("if (x) /* not a comment */ )\""), state, &state);
+  QVERIFY(state != CppLexer::kStateNormal);
+  QCOMPARE(tokens.size(), 1);
+
+  tokens = lex(QStringLiteral("end)xy\"; int y;"), state, &state);
+  QCOMPARE(state, CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 0, 7, Kind::String));
+  QVERIFY(hasToken(tokens, 9, 3, Kind::Keyword));
+}
+
+void TestCppHighlighter::carriesPreprocessorContinuation() {
+  int state = 0;
+  auto tokens = lex(QStringLiteral("  #define BLINK(pin) \\"), 0, &state);
+  QVERIFY(state != CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 2, 20, Kind::Preprocessor));
+
+  tokens = lex(QStringLiteral("  digitalWrite(pin, HIGH); /* x */ \\"), state, &state);
+  QVERIFY(state != CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 0, 36, Kind::Preprocessor));
+  QVERIFY(hasToken(tokens, 27, 7, Kind::Comment));
+  for (const auto& t : tokens) {
+    QVERIFY(t.kind != Kind::SketchIdentifier);
+  }
+
+  tokens = lex(QStringLiteral("  delay(100)"), state, &state);
+  QCOMPARE(state, CppLexer::kStateNormal);
+  QVERIFY(hasToken(tokens, 0, 12, Kind::Preprocessor));
+  QVERIFY(hasToken(tokens, 8, 3, Kind::Number));
+
+  tokens = lex(QStringLiteral("delay(100);"), state, &state);
+  QVERIFY(hasToken(tokens, 0, 5, Kind::SketchIdentifier));
+}
+
+void TestCppHighlighter::highlighterPropagatesCommentEdits() {
+  QTextDocument doc;
+  doc.setPlainText(QStringLiteral("int a;\nint b;\nint c;\n"));
+  CppHighlighter highlighter(&doc);
+  highlighter.setTheme(true);
+
+  const QColor keyword("#569CD6");
+  const QColor comment("#6A9955");
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(2), 0), keyword);
+
+  QTextCursor cursor(doc.findBlockByNumber(0));
+  cursor.insertText(QStringLiteral("/* "));
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(1), 0), comment);
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(2), 0), comment);
+
+  cursor = QTextCursor(doc.findBlockByNumber(1));
+  cursor.movePosition(QTextCursor::EndOfBlock);
+  cursor.insertText(QStringLiteral(" */"));
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(1), 0), comment);
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(2), 0), keyword);
+}
+
+void TestCppHighlighter::highlighterKeepsBreakpointBlockState() {
+  QTextDocument doc;
+  doc.setPlainText(QStringLiteral("void loop() {\n  delay(1);\n}\n"));
+  CppHighlighter highlighter(&doc);
+  QTextBlock block = doc.findBlockByNumber(1);
+  block.setUserState(101);
+
+  highlighter.setTheme(false);
+  QCOMPARE(doc.findBlockByNumber(1).userState(), 101);
+  QCOMPARE(foregroundAt(doc.findBlockByNumber(1), 2), QColor("#00979C"));
+}
+
+void TestCppHighlighter::benchmarkLinesPerSecond_data() {
+  QTest::addColumn<QString>("engine");
+  QTest::newRow("lexer only") << QStringLiteral("lexer");
+  QTest::newRow("regex highlighter") << QStringLiteral("regex");
+  QTest::newRow("lexer highlighter") << QStringLiteral("highlighter");
+}
+
+// Each iteration covers the same 10,000 lines, so the rows compare as
+// lines/sec.
+void TestCppHighlighter::benchmarkLinesPerSecond() {
+  QFETCH(QString, engine);
+  const QString source = generatedHeader(10000);
+
+  if (engine == QStringLiteral("lexer")) {
+    int lexedLines = 0;
+    QVector<CppLexer::Token> tokens;
+    QBENCHMARK {
+      lexedLines = 0;
+      int state = CppLexer::kStateNormal;
+      for (const QStringView line : QStringView(source).split(u'\n')) {
+        tokens.clear();
+        state = CppLexer::lexLine(line, state, &tokens);
+        ++lexedLines;
+      }
+    }
+    QVERIFY(lexedLines >= 10000);
+    return;
+  }
+
+  QTextDocument doc;
+  doc.setPlainText(source);
+  QVERIFY(doc.blockCount() >= 10000);
+  if (engine == QStringLiteral("regex")) {
+    RegexCppHighlighter highlighter(&doc);
+    QBENCHMARK {
+      highlighter.rehighlight();
+    }
+  } else {
+    CppHighlighter highlighter(&doc);
+    QBENCHMARK {
+      highlighter.rehighlight();
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  QApplication app(argc, argv);
+  TestCppHighlighter tc;
+  return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_cpp_highlighter.moc"
@@ -0,0 +1,307 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+#include "debug_session.h"
+
+namespace {
+
+constexpr int kTimeoutMs = 15000;
+
+int markerLine(const QString& sourcePath, const QString& marker) {
+  QFile file(sourcePath);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return -1;
+  }
+  const QString needle = QStringLiteral("// marker: ") + marker;
+  int line = 0;
+  while (!file.atEnd()) {
+    ++line;
+    if (QString::fromUtf8(file.readLine()).contains(needle)) {
+      return line;
+    }
+  }
+  return -1;
+}
+
+const DebugSession::Variable* findVariable(const QVector<DebugSession::Variable>& vars,
+                                           const QString& expression) {
+  for (const auto& var : vars) {
+    if (var.expression == expression) {
+      return &var;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+class TestDebugSession final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void initTestCase();
+  void breakpointsSteppingAndChangedLocals();
+  void watchesAndChildren();
+  void benchmarkStopToSnapshotLatency();
+
+ private:
+  QString gdb_;
+  QString program_;
+  QString source_;
+
+  // Starts gdb on the debuggee and runs to the breakpoint on `marker`. Sets
+  // `skipReason` when this machine cannot run programs under gdb.
+  void runToMarker(DebugSession& session, const QString& marker, QString* skipReason);
+  // Children of a var-object, looking through C++ access pseudo-children.
+  void listFields(DebugSession& session,
+                  const QString& variableId,
+                  QVector<DebugSession::Variable>* out);
+};
+
+void TestDebugSession::initTestCase() {
+  gdb_ = QStandardPaths::findExecutable(QStringLiteral("gdb"));
+  if (gdb_.isEmpty()) {
+    QSKIP("gdb is not installed.");
+  }
+  program_ = qEnvironmentVariable("DEBUGGEE_PROGRAM");
+  QVERIFY2(!program_.isEmpty(), "DEBUGGEE_PROGRAM env var must be set by CTest.");
+  source_ = QFINDTESTDATA("debuggee_program.cpp");
+  QVERIFY(!source_.isEmpty());
+}
+
+void TestDebugSession::runToMarker(DebugSession& session,
+                                   const QString& marker,
+                                   QString* skipReason) {
+  const int line = markerLine(source_, marker);
+  QVERIFY(line > 0);
+
+  session.start(gdb_, {QStringLiteral("--interpreter=mi2"), QStringLiteral("--nx"),
+                       QStringLiteral("--quiet"), program_});
+  QVERIFY(QTest::qWaitFor(
+      [&] {
+        return session.state() == DebugSession::State::Idle ||
+               session.state() == DebugSession::State::Exited;
+      },
+      kTimeoutMs));
+  QCOMPARE(session.state(), DebugSession::State::Idle);
+
+  QString breakResult;
+  session.insertBreakpoint(source_, line, {}, [&](const MiParser::Record& r) {
+    breakResult = r.klass;
+  });
+  QVERIFY(QTest::qWaitFor([&] { return !breakResult.isEmpty(); }, kTimeoutMs));
+  QCOMPARE(breakResult, QStringLiteral("done"));
+
+  QSignalSpy snapshots(&session, &DebugSession::snapshotReady);
+  QString runError;
+  session.sendCommand(QStringLiteral("-exec-run"), [&](const MiParser::Record& r) {
+    if (r.klass == QStringLiteral("error")) {
+      runError = r.results.value(MiParser::Key::Msg).toString();
+      if (runError.isEmpty()) {
+        runError = r.rawText();
+      }
+    }
+  });
+  QVERIFY(QTest::qWaitFor([&] { return !snapshots.isEmpty() || !runError.isEmpty(); },
+                          kTimeoutMs));
+  if (!runError.isEmpty()) {
+    // Typically ptrace being restricted inside a container.
+    *skipReason = QStringLiteral("gdb cannot run programs here: ") + runError;
+  }
+}
+
+void TestDebugSession::listFields(DebugSession& session,
+                                  const QString& variableId,
+                                  QVector<DebugSession::Variable>* out) {
+  bool done = false;
+  session.listChildren(variableId, [&](QVector<DebugSession::Variable> children) {
+    *out = children;
+    done = true;
+  });
+  QVERIFY(QTest::qWaitFor([&] { return done; }, kTimeoutMs));
+  if (out->size() == 1 && out->at(0).expression == QStringLiteral("public")) {
+    const QString inner = out->at(0).id;
+    listFields(session, inner, out);
+  }
+}
+
+void TestDebugSession::breakpointsSteppingAndChangedLocals() {
+  DebugSession session;
+  QString skipReason;
+  runToMarker(session, QStringLiteral("loop-body"), &skipReason);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  if (!skipReason.isEmpty()) {
+    QSKIP(qPrintable(skipReason));
+  }
+
+  const int bodyLine = markerLine(source_, QStringLiteral("loop-body"));
+  QCOMPARE(session.state(), DebugSession::State::Stopped);
+  QCOMPARE(session.lastStop().reason, QStringLiteral("breakpoint-hit"));
+  QCOMPARE(session.lastStop().frame.line, bodyLine);
+  QVERIFY(session.lastStop().breakpointId > 0);
+  QVERIFY(session.frames().size() >= 2);
+  QCOMPARE(session.frames().at(0).function, QStringLiteral("accumulate"));
+  QCOMPARE(session.frames().at(1).function, QStringLiteral("main"));
+  QVERIFY(!session.threads().isEmpty());
+
+  const DebugSession::Variable* i = findVariable(session.locals(), QStringLiteral("i"));
+  QVERIFY(i);
+  QCOMPARE(i->value, QStringLiteral("0"));
+  QVERIFY(findVariable(session.locals(), QStringLiteral("total")));
+  const DebugSession::Variable* point = findVariable(session.locals(), QStringLiteral("point"));
+  QVERIFY(point);
+  QVERIFY(point->childCount > 0);
+
+  QSignalSpy snapshots(&session, &DebugSession::snapshotReady);
+  session.execContinue();
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  // Second iteration: only the loop counter moved.
+  i = findVariable(session.locals(), QStringLiteral("i"));
+  QVERIFY(i);
+  QCOMPARE(i->value, QStringLiteral("1"));
+  QVERIFY(i->changed);
+  const DebugSession::Variable* total = findVariable(session.locals(), QStringLiteral("total"));
+  QVERIFY(total);
+  QCOMPARE(total->value, QStringLiteral("0"));
+  QVERIFY(!total->changed);
+
+  session.execNext();
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  QCOMPARE(session.lastStop().reason, QStringLiteral("end-stepping-range"));
+  QCOMPARE(session.lastStop().frame.line, bodyLine + 1);
+  total = findVariable(session.locals(), QStringLiteral("total"));
+  QVERIFY(total);
+  QCOMPARE(total->value, QStringLiteral("1"));
+  QVERIFY(total->changed);
+
+  session.selectFrame(1);
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  QCOMPARE(session.selectedFrame(), 1);
+  const DebugSession::Variable* result = findVariable(session.locals(), QStringLiteral("result"));
+  QVERIFY(result);
+  const QString resultId = result->id;
+  QVERIFY(!findVariable(session.locals(), QStringLiteral("total")));
+
+  // Without breakpoints the program runs to the end; gdb stays up.
+  session.sendCommand(QStringLiteral("-break-delete"));
+  session.execContinue();
+  QVERIFY(QTest::qWaitFor([&] { return session.state() == DebugSession::State::Idle; },
+                          kTimeoutMs));
+  QVERIFY(session.locals().isEmpty());
+  // Their var-objects are gone from gdb as well.
+  QString evaluated;
+  session.sendCommand(
+      QStringLiteral("-var-evaluate-expression ") + DebugSession::quoteArgument(resultId),
+      [&](const MiParser::Record& r) { evaluated = r.klass; });
+  QVERIFY(QTest::qWaitFor([&] { return !evaluated.isEmpty(); }, kTimeoutMs));
+  QCOMPARE(evaluated, QStringLiteral("error"));
+
+  session.stop();
+  QVERIFY(QTest::qWaitFor([&] { return session.state() == DebugSession::State::Exited; },
+                          kTimeoutMs));
+}
+
+void TestDebugSession::watchesAndChildren() {
+  DebugSession session;
+  session.setWatches(
+      {QStringLiteral("point"), QStringLiteral("total * 2"), QStringLiteral("no_such_variable")});
+  QString skipReason;
+  runToMarker(session, QStringLiteral("loop-body"), &skipReason);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  if (!skipReason.isEmpty()) {
+    QSKIP(qPrintable(skipReason));
+  }
+
+  QCOMPARE(session.watches().size(), 3);
+  const DebugSession::Variable point = session.watches().at(0);
+  QVERIFY(!point.id.isEmpty());
+  QVERIFY(point.childCount > 0);
+  QCOMPARE(session.watches().at(1).value, QStringLiteral("0"));
+  const DebugSession::Variable missing = session.watches().at(2);
+  QVERIFY(missing.id.isEmpty());
+  QVERIFY(!missing.inScope);
+  QVERIFY(!missing.value.isEmpty());
+
+  QVector<DebugSession::Variable> fields;
+  listFields(session, point.id, &fields);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  QCOMPARE(fields.size(), 2);
+  QCOMPARE(fields.at(0).expression, QStringLiteral("x"));
+  QCOMPARE(fields.at(0).value, QStringLiteral("1"));
+  QCOMPARE(fields.at(1).expression, QStringLiteral("y"));
+  QCOMPARE(fields.at(1).value, QStringLiteral("2"));
+
+  // Third iteration: total is 0 + 1.
+  QSignalSpy snapshots(&session, &DebugSession::snapshotReady);
+  session.execContinue();
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  session.execContinue();
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  QCOMPARE(session.watches().at(1).value, QStringLiteral("2"));
+  QVERIFY(session.watches().at(1).changed);
+
+  // Watches can be edited while stopped.
+  session.setWatches({QStringLiteral("total * 2"), QStringLiteral("i")});
+  QVERIFY(snapshots.wait(kTimeoutMs));
+  QCOMPARE(session.watches().size(), 2);
+  QCOMPARE(session.watches().at(0).value, QStringLiteral("2"));
+  QCOMPARE(session.watches().at(1).expression, QStringLiteral("i"));
+  QCOMPARE(session.watches().at(1).value, QStringLiteral("2"));
+
+  session.stop();
+  QVERIFY(QTest::qWaitFor([&] { return session.state() == DebugSession::State::Exited; },
+                          kTimeoutMs));
+}
+
+void TestDebugSession::benchmarkStopToSnapshotLatency() {
+  DebugSession session;
+  session.setWatches(
+      {QStringLiteral("total"), QStringLiteral("point"), QStringLiteral("total + count")});
+  QString skipReason;
+  runToMarker(session, QStringLiteral("loop-body"), &skipReason);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  if (!skipReason.isEmpty()) {
+    QSKIP(qPrintable(skipReason));
+  }
+
+  // *stopped read by the session thread -> snapshot delivered here.
+  QVector<qint64> stopToSnapshotNs;
+  connect(&session, &DebugSession::snapshotReady, this,
+          [&](const DebugSession::StopInfo& info) {
+            stopToSnapshotNs.push_back(DebugSession::steadyNowNs() - info.stopNs);
+          });
+  QSignalSpy snapshots(&session, &DebugSession::snapshotReady);
+  // accumulate(5) then accumulate(3): eight hits, the first already taken.
+  // The inferior cannot be rewound, so the seven round trips run once.
+  QBENCHMARK_ONCE {
+    for (int hit = 1; hit < 8; ++hit) {
+      session.execContinue();
+      QVERIFY(snapshots.wait(kTimeoutMs));
+      QVERIFY(!session.locals().isEmpty());
+    }
+  }
+  QCOMPARE(stopToSnapshotNs.size(), 7);
+  QVERIFY(std::all_of(stopToSnapshotNs.cbegin(), stopToSnapshotNs.cend(),
+                      [](qint64 ns) { return ns >= 0; }));
+
+  session.stop();
+  QVERIFY(QTest::qWaitFor([&] { return session.state() == DebugSession::State::Exited; },
+                          kTimeoutMs));
+}
+
+QTEST_MAIN(TestDebugSession)
+
+#include "test_debug_session.moc"
@@ -2,6 +2,7 @@
 
 #include <QDir>
 #include <QFile>
+#include <QSignalSpy>
 #include <QTemporaryDir>
 
 #include "examples_scanner.h"
@@ -11,6 +12,9 @@ class TestExamplesScanner final : public QObject {
 
  private slots:
   void findsSketchbookAndCoreExamples();
+  void cachedIndexRescansOnlyChangedRoots();
+  void sortsSelectedCoreFirst();
+  void indexReportsOnlyRealChanges();
 };
 
 static bool writeTextFile(const QString& path, const QByteArray& data = {}) {
@@ -89,6 +93,118 @@ void TestExamplesScanner::findsSketchbookAndCoreExamples() {
   QVERIFY(!coreOld);
 }
 
+void TestExamplesScanner::cachedIndexRescansOnlyChangedRoots() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = "void setup() {}\nvoid loop() {}\n";
+  QVERIFY(writeTextFile(dir.filePath("sb/libraries/Foo/examples/A/A.ino"), sketch.toUtf8()));
+  QVERIFY(writeTextFile(dir.filePath("sb/libraries/Bar/examples/B/B.ino"), sketch.toUtf8()));
+  QVERIFY(writeTextFile(dir.filePath("sb/examples/Mine/Mine.ino"), sketch.toUtf8()));
+
+  ExamplesScanner::Options options;
+  options.sketchbookDir = dir.filePath("sb");
+  options.dataDir = dir.filePath("data");
+  options.cachePath = dir.filePath("cache/examples-index.bin");
+
+  ExamplesScanner::Stats stats;
+  const QVector<ExampleSketch> first = ExamplesScanner::scan(options, &stats);
+  QCOMPARE(first.size(), 3);
+  QCOMPARE(stats.roots, 3);
+  QCOMPARE(stats.rescanned, 3);
+  QVERIFY(QFileInfo::exists(options.cachePath));
+
+  QCOMPARE(ExamplesScanner::scan(options, &stats), first);
+  QCOMPARE(stats.fromCache, 3);
+  QCOMPARE(stats.rescanned, 0);
+
+  // A new example in one library only walks that library again.
+  QVERIFY(writeTextFile(dir.filePath("sb/libraries/Foo/examples/Sub/C/C.ino"),
+                        sketch.toUtf8()));
+  QVector<ExampleSketch> examples = ExamplesScanner::scan(options, &stats);
+  QCOMPARE(examples.size(), 4);
+  QCOMPARE(stats.fromCache, 2);
+  QCOMPARE(stats.rescanned, 1);
+  bool found = false;
+  for (const ExampleSketch& ex : examples) {
+    found = found || ex.menuPath == QStringList{"Libraries", "Foo", "Sub", "C"};
+  }
+  QVERIFY(found);
+
+  // Installed and removed libraries come and go without touching the rest.
+  QVERIFY(writeTextFile(dir.filePath("sb/libraries/Baz/examples/D/D.ino"), sketch.toUtf8()));
+  QVERIFY(QDir(dir.filePath("sb/libraries/Bar")).removeRecursively());
+  examples = ExamplesScanner::scan(options, &stats);
+  QCOMPARE(stats.roots, 3);
+  QCOMPARE(stats.fromCache, 2);
+  QCOMPARE(stats.rescanned, 1);
+  QStringList libraries;
+  for (const ExampleSketch& ex : examples) {
+    if (ex.menuPath.first() == "Libraries") {
+      libraries << ex.menuPath.at(1);
+    }
+  }
+  libraries.removeDuplicates();
+  QCOMPARE(libraries, QStringList({"Baz", "Foo"}));
+
+  // The cache agrees with a scan that does not use one.
+  ExamplesScanner::Options uncached = options;
+  uncached.cachePath.clear();
+  QCOMPARE(ExamplesScanner::scan(options, &stats), ExamplesScanner::scan(uncached));
+  QCOMPARE(stats.rescanned, 0);
+}
+
+void TestExamplesScanner::sortsSelectedCoreFirst() {
+  QVector<ExampleSketch> examples = {
+      {{"Sketchbook", "Mine"}, "/s/Mine", "/s/Mine/Mine.ino"},
+      {{"Core Libraries", "other:arch", "Wire", "Scan"}, "/o/Scan", "/o/Scan/Scan.ino"},
+      {{"Libraries", "Foo", "A"}, "/l/A", "/l/A/A.ino"},
+      {{"Core Libraries", "vendor:arch", "SPI", "Loop"}, "/v/Loop", "/v/Loop/Loop.ino"},
+      {{"Built-in Examples", "01.Basics", "Blink"}, "/b/Blink", "/b/Blink/Blink.ino"},
+  };
+  ExamplesScanner::sortForBoard(&examples, "vendor:arch:uno");
+  QStringList order;
+  for (const ExampleSketch& ex : examples) {
+    order << ex.menuPath.last();
+  }
+  QCOMPARE(order, QStringList({"Blink", "Loop", "A", "Mine", "Scan"}));
+
+  ExamplesScanner::sortForBoard(&examples, QString{});
+  QCOMPARE(examples.at(1).menuPath.last(), QStringLiteral("A"));
+}
+
+void TestExamplesScanner::indexReportsOnlyRealChanges() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QVERIFY(writeTextFile(dir.filePath("sb/examples/Mine/Mine.ino")));
+
+  ExamplesScanner::Options options;
+  options.sketchbookDir = dir.filePath("sb");
+  options.dataDir = dir.filePath("data");
+  options.cachePath = dir.filePath("examples-index.bin");
+
+  ExamplesIndex index;
+  index.setOptions(options);
+  QSignalSpy changed(&index, &ExamplesIndex::examplesChanged);
+  QVERIFY(!index.examples());
+
+  index.refresh();
+  QTRY_COMPARE(changed.count(), 1);
+  QVERIFY(index.examples());
+  QCOMPARE(index.examples()->size(), 1);
+  const quint64 revision = index.revision();
+
+  index.refresh();
+  QTRY_VERIFY(!index.isScanning());
+  QCOMPARE(changed.count(), 1);
+  QCOMPARE(index.revision(), revision);
+
+  QVERIFY(writeTextFile(dir.filePath("sb/examples/Other/Other.ino")));
+  index.refresh();
+  QTRY_COMPARE(changed.count(), 2);
+  QCOMPARE(index.examples()->size(), 2);
+  QVERIFY(index.revision() > revision);
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   TestExamplesScanner tc;
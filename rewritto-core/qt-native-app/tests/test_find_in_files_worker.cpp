@@ -1,6 +1,8 @@
 #include <QtTest/QtTest>
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
 #include <QFile>
 #include <QTemporaryDir>
 
@@ -13,6 +15,11 @@ class TestFindInFilesWorker final : public QObject {
   void findsMatches_caseInsensitive();
   void findsMatches_caseSensitive();
   void respectsExcludePatterns();
+  void reportsColumnsAfterMultibyteText();
+  void reportsFilesInEnumerationOrder();
+  void stopsAtMatchLimit();
+  void benchmarkLibraryTree_data();
+  void benchmarkLibraryTree();
 };
 
 static void writeFile(const QString& path, const QByteArray& data) {
@@ -21,6 +28,14 @@ static void writeFile(const QString& path, const QByteArray& data) {
   QVERIFY(f.write(data) == data.size());
 }
 
+static QVector<FindInFilesMatch> collectMatches(const QSignalSpy& spy) {
+  QVector<FindInFilesMatch> matches;
+  for (const auto& args : spy) {
+    matches += args.at(0).value<QVector<FindInFilesMatch>>();
+  }
+  return matches;
+}
+
 void TestFindInFilesWorker::findsMatches_caseInsensitive() {
   QTemporaryDir dir;
   QVERIFY(dir.isValid());
@@ -29,13 +44,13 @@ void TestFindInFilesWorker::findsMatches_caseInsensitive() {
   writeFile(dir.filePath("b.cpp"), "nope\nheLLo there\n");
 
   FindInFilesWorker worker;
-  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchFound);
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
   QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
 
   worker.run(dir.path(), "hello", {"*.ino", "*.cpp"}, {}, false);
 
   QCOMPARE(finishedSpy.count(), 1);
-  QVERIFY(matchSpy.count() >= 3);
+  QVERIFY(collectMatches(matchSpy).size() >= 3);
 }
 
 void TestFindInFilesWorker::findsMatches_caseSensitive() {
@@ -46,24 +61,19 @@ void TestFindInFilesWorker::findsMatches_caseSensitive() {
   writeFile(dir.filePath("b.cpp"), "hello\n");
 
   FindInFilesWorker worker;
-  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchFound);
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
   QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
 
   worker.run(dir.path(), "Hello", {"*.ino", "*.cpp"}, {}, true);
 
   QCOMPARE(finishedSpy.count(), 1);
-  QCOMPARE(matchSpy.count(), 1);
-
-  const auto args = matchSpy.takeFirst();
-  const QString filePath = args.at(0).toString();
-  const int line = args.at(1).toInt();
-  const int col = args.at(2).toInt();
-  const QString preview = args.at(3).toString();
-
-  QVERIFY(filePath.endsWith("a.ino"));
-  QCOMPARE(line, 2);
-  QCOMPARE(col, 1);
-  QCOMPARE(preview, QStringLiteral("Hello"));
+  const QVector<FindInFilesMatch> matches = collectMatches(matchSpy);
+  QCOMPARE(matches.size(), qsizetype(1));
+
+  QVERIFY(matches.first().filePath.endsWith("a.ino"));
+  QCOMPARE(matches.first().line, 2);
+  QCOMPARE(matches.first().column, 1);
+  QCOMPARE(matches.first().preview, QStringLiteral("Hello"));
 }
 
 void TestFindInFilesWorker::respectsExcludePatterns() {
@@ -74,19 +84,163 @@ void TestFindInFilesWorker::respectsExcludePatterns() {
   writeFile(dir.filePath("b.cpp"), "hello\n");
 
   FindInFilesWorker worker;
-  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchFound);
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
   QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
 
   worker.run(dir.path(), "hello", {"*.ino", "*.cpp"}, {"b.cpp"}, false);
 
   QCOMPARE(finishedSpy.count(), 1);
-  QVERIFY(matchSpy.count() >= 1);
-  for (const auto& args : matchSpy) {
-    const QString filePath = args.at(0).toString();
-    QVERIFY(!filePath.endsWith("b.cpp"));
+  const QVector<FindInFilesMatch> matches = collectMatches(matchSpy);
+  QVERIFY(matches.size() >= 1);
+  for (const FindInFilesMatch& m : matches) {
+    QVERIFY(!m.filePath.endsWith("b.cpp"));
+  }
+}
+
+void TestFindInFilesWorker::reportsColumnsAfterMultibyteText() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  writeFile(dir.filePath("a.ino"),
+            "// Gr\xc3\xbc\xc3\x9fe LED led\r\n"
+            "int led = 13; // \xe2\x82\xac LeD\r\n"
+            "no match here\n"
+            "LED");
+  writeFile(dir.filePath("b.h"), "// \xc3\x9cBERSICHT \xc3\xbcbersicht\n");
+
+  FindInFilesWorker worker;
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
+
+  worker.run(dir.path(), "led", {"*.ino"}, {}, false);
+  QVector<FindInFilesMatch> matches = collectMatches(matchSpy);
+  QCOMPARE(matches.size(), qsizetype(5));
+  QCOMPARE(matches.at(0).line, 1);
+  QCOMPARE(matches.at(0).column, 10);
+  QCOMPARE(matches.at(0).preview, QString::fromUtf8("// Gr\xc3\xbc\xc3\x9fe LED led"));
+  QCOMPARE(matches.at(1).column, 14);
+  QCOMPARE(matches.at(2).line, 2);
+  QCOMPARE(matches.at(2).column, 5);
+  QCOMPARE(matches.at(3).column, 20);
+  QCOMPARE(matches.at(4).line, 4);
+  QCOMPARE(matches.at(4).column, 1);
+  QCOMPARE(matches.at(4).preview, QStringLiteral("LED"));
+
+  // A non-ASCII query is folded as Unicode text.
+  matchSpy.clear();
+  worker.run(dir.path(), QString::fromUtf8("\xc3\xbc" "bersicht"), {"*.h"}, {}, false);
+  matches = collectMatches(matchSpy);
+  QCOMPARE(matches.size(), qsizetype(2));
+  QCOMPARE(matches.at(0).column, 4);
+  QCOMPARE(matches.at(1).column, 14);
+}
+
+void TestFindInFilesWorker::reportsFilesInEnumerationOrder() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  QStringList expected;
+  for (int d = 0; d < 8; ++d) {
+    const QString sub = dir.filePath(QStringLiteral("lib%1").arg(d));
+    QVERIFY(QDir().mkpath(sub));
+    for (int f = 0; f < 25; ++f) {
+      const QString path = sub + QStringLiteral("/f%1.cpp").arg(f);
+      writeFile(path, QByteArray("x\n").repeated(f * 50) + "needle\n");
+    }
+  }
+  QVERIFY(QDir().mkpath(dir.filePath("build")));
+  writeFile(dir.filePath("build/skip.cpp"), "needle\n");
+
+  QDirIterator it(dir.path(), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    if (!path.contains("/build/")) {
+      expected << path;
+    }
+  }
+
+  FindInFilesWorker worker;
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
+  QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
+  worker.run(dir.path(), "needle", {"*.cpp"}, {}, true);
+
+  QCOMPARE(finishedSpy.count(), 1);
+  QCOMPARE(finishedSpy.first().at(0).toInt(), 200);
+  QCOMPARE(finishedSpy.first().at(1).toInt(), 200);
+  const QVector<FindInFilesMatch> matches = collectMatches(matchSpy);
+  QCOMPARE(matches.size(), qsizetype(200));
+  for (int i = 0; i < matches.size(); ++i) {
+    QCOMPARE(matches.at(i).filePath, expected.at(i));
   }
 }
 
+void TestFindInFilesWorker::stopsAtMatchLimit() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  for (int f = 0; f < 4; ++f) {
+    writeFile(dir.filePath(QStringLiteral("f%1.h").arg(f)), QByteArray("hit hit\n").repeated(2000));
+  }
+
+  FindInFilesWorker worker;
+  QSignalSpy matchSpy(&worker, &FindInFilesWorker::matchesFound);
+  QSignalSpy messageSpy(&worker, &FindInFilesWorker::message);
+  QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
+  worker.run(dir.path(), "hit", {"*.h"}, {}, false);
+
+  QCOMPARE(finishedSpy.count(), 1);
+  QCOMPARE(finishedSpy.first().at(0).toInt(), 10000);
+  QCOMPARE(collectMatches(matchSpy).size(), qsizetype(10000));
+  QCOMPARE(messageSpy.count(), 1);
+}
+
+void TestFindInFilesWorker::benchmarkLibraryTree_data() {
+  QTest::addColumn<QString>("pattern");
+  QTest::addColumn<bool>("caseSensitive");
+  QTest::newRow("case-insensitive") << QStringLiteral("handleinterruptvector") << false;
+  QTest::newRow("case-sensitive") << QStringLiteral("handleInterruptVector") << true;
+}
+
+void TestFindInFilesWorker::benchmarkLibraryTree() {
+  QFETCH(QString, pattern);
+  QFETCH(bool, caseSensitive);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  // Roughly a sketchbook with a few hundred libraries: 300 libraries x
+  // 12 sources x ~10 KB, with a rare identifier sprinkled in.
+  constexpr int kLibraries = 300;
+  constexpr int kFilesPerLibrary = 12;
+  QByteArray body;
+  for (int i = 0; i < 200; ++i) {
+    body += "  digitalWrite(LED_BUILTIN, state); // toggle the pin\n";
+  }
+  int expectedMatches = 0;
+  for (int lib = 0; lib < kLibraries; ++lib) {
+    const QString src = dir.filePath(QStringLiteral("libraries/Lib%1/src").arg(lib));
+    QVERIFY(QDir().mkpath(src));
+    for (int f = 0; f < kFilesPerLibrary; ++f) {
+      QByteArray data = body;
+      if ((lib + f) % 7 == 0) {
+        data += "void handleInterruptVector() {}\n";
+        ++expectedMatches;
+      }
+      writeFile(src + QStringLiteral("/file%1.cpp").arg(f), data);
+    }
+  }
+
+  FindInFilesWorker worker;
+  QSignalSpy finishedSpy(&worker, &FindInFilesWorker::finished);
+
+  QBENCHMARK {
+    finishedSpy.clear();
+    worker.run(dir.path(), pattern, {}, {}, caseSensitive);
+  }
+  QCOMPARE(finishedSpy.count(), 1);
+  QCOMPARE(finishedSpy.first().at(0).toInt(), expectedMatches);
+  QCOMPARE(finishedSpy.first().at(1).toInt(), kLibraries * kFilesPerLibrary);
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   TestFindInFilesWorker tc;
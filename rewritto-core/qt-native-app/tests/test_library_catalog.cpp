@@ -0,0 +1,218 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "library_catalog.h"
+
+class TestLibraryCatalog final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void groupsReleasesNewestFirst();
+  void ranksNameMatchesFirst();
+  void matchesEveryWordByPrefix();
+  void reportsParseErrors();
+  void benchmarkLibraryIndexLoad();
+  void benchmarkLibraryIndexSearch_data();
+  void benchmarkLibraryIndexSearch();
+};
+
+static QJsonObject release(const QString& name,
+                           const QString& version,
+                           const QString& author,
+                           const QString& sentence,
+                           const QStringList& architectures = {"*"}) {
+  QJsonObject o;
+  o.insert("name", name);
+  o.insert("version", version);
+  o.insert("author", author);
+  o.insert("maintainer", author);
+  o.insert("sentence", sentence);
+  o.insert("paragraph", sentence);
+  o.insert("category", "Other");
+  o.insert("architectures", QJsonArray::fromStringList(architectures));
+  return o;
+}
+
+static QByteArray indexJson(const QJsonArray& releases) {
+  QJsonObject root;
+  root.insert("libraries", releases);
+  return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+static QStringList names(const LibraryCatalog& catalog, const QVector<int>& ids) {
+  QStringList out;
+  for (int id : ids) {
+    out << catalog.library(id).name;
+  }
+  return out;
+}
+
+static std::shared_ptr<const LibraryCatalog> sampleCatalog() {
+  QJsonArray releases;
+  releases << release("WiFiNINA", "1.8.14", "Arduino",
+                      "Enables network connection with the NINA module.", {"samd", "megaavr"});
+  releases << release("WiFi", "1.2.7", "Arduino",
+                      "Enables network connection with the WiFi shield.", {"avr"});
+  releases << release("Adafruit GFX Library", "1.11.9", "Adafruit",
+                      "Core graphics library for displays.");
+  releases << release("Adafruit SSD1306", "2.5.9", "Adafruit",
+                      "Driver for SSD1306 monochrome OLED displays.");
+  releases << release("ArduinoJson", "7.0.4", "Benoit Blanchon",
+                      "A simple and efficient JSON library.");
+  releases << release("ESP Async Web", "1.0.0", "Someone", "Async web server over WiFi.",
+                      {"esp32"});
+  return LibraryCatalog::fromJson(indexJson(releases));
+}
+
+void TestLibraryCatalog::groupsReleasesNewestFirst() {
+  QJsonArray releases;
+  releases << release("Servo", "1.2.0", "Michael Margolis", "Controls servo motors.");
+  QJsonObject withDeps =
+      release("Servo", "1.10.0", "Arduino", "Allows boards to control servo motors.");
+  withDeps.insert("dependencies",
+                  QJsonArray{QJsonObject{{"name", "Wire"}, {"version", ">=1.0"}}});
+  releases << withDeps;
+  releases << release("Servo", "1.9.1", "Arduino", "Allows boards to control servo motors.");
+
+  const auto catalog = LibraryCatalog::fromJson(indexJson(releases));
+  QVERIFY(catalog);
+  QCOMPARE(catalog->libraryCount(), 1);
+
+  const LibraryCatalog::Library& servo = catalog->library(0);
+  QCOMPARE(servo.releases.size(), qsizetype(3));
+  QCOMPARE(servo.releases.at(0).version, QStringLiteral("1.10.0"));
+  QCOMPARE(servo.releases.at(1).version, QStringLiteral("1.9.1"));
+  QCOMPARE(servo.releases.at(2).version, QStringLiteral("1.2.0"));
+
+  // Same shape as `arduino-cli lib search --json`.
+  const QJsonObject json = catalog->searchJson(0);
+  QCOMPARE(json.value("name").toString(), QStringLiteral("Servo"));
+  QCOMPARE(json.value("latest").toObject().value("version").toString(),
+           QStringLiteral("1.10.0"));
+  QCOMPARE(json.value("available_versions").toArray().size(), qsizetype(3));
+  const QJsonObject latestRelease =
+      json.value("releases").toObject().value("1.10.0").toObject();
+  const QJsonObject latestDep = latestRelease.value("dependencies").toArray().at(0).toObject();
+  QCOMPARE(latestDep.value("name").toString(), QStringLiteral("Wire"));
+  QCOMPARE(latestDep.value("version_constraint").toString(), QStringLiteral(">=1.0"));
+
+  // Only the newest release is indexed.
+  QCOMPARE(catalog->search("margolis").size(), qsizetype(0));
+  QCOMPARE(catalog->search("boards").size(), qsizetype(1));
+}
+
+void TestLibraryCatalog::ranksNameMatchesFirst() {
+  const auto catalog = sampleCatalog();
+  QVERIFY(catalog);
+
+  QCOMPARE(names(*catalog, catalog->search("wifi")),
+           QStringList({"WiFi", "WiFiNINA", "ESP Async Web"}));
+  QCOMPARE(names(*catalog, catalog->search("Adafruit")).first(),
+           QStringLiteral("Adafruit GFX Library"));
+  QCOMPARE(names(*catalog, catalog->search("nina")).first(), QStringLiteral("WiFiNINA"));
+  QCOMPARE(names(*catalog, catalog->search("json")), QStringList({"ArduinoJson"}));
+
+  // No query lists everything by name.
+  QCOMPARE(names(*catalog, catalog->search(QString{})),
+           QStringList({"Adafruit GFX Library", "Adafruit SSD1306", "ArduinoJson", "ESP Async Web",
+                        "WiFi", "WiFiNINA"}));
+}
+
+void TestLibraryCatalog::matchesEveryWordByPrefix() {
+  const auto catalog = sampleCatalog();
+  QVERIFY(catalog);
+
+  QCOMPARE(names(*catalog, catalog->search("adafruit disp")),
+           QStringList({"Adafruit GFX Library", "Adafruit SSD1306"}));
+  QCOMPARE(names(*catalog, catalog->search("adafruit oled")), QStringList({"Adafruit SSD1306"}));
+  QCOMPARE(names(*catalog, catalog->search("megaav")), QStringList({"WiFiNINA"}));
+  QCOMPARE(names(*catalog, catalog->search("ESP32")), QStringList({"ESP Async Web"}));
+  QVERIFY(catalog->search("adafruit wifi").isEmpty());
+  QVERIFY(catalog->search("zigbee").isEmpty());
+}
+
+void TestLibraryCatalog::reportsParseErrors() {
+  QString error;
+  QVERIFY(!LibraryCatalog::fromJson("{\"libraries\": [", &error));
+  QVERIFY(!error.isEmpty());
+
+  error.clear();
+  QVERIFY(!LibraryCatalog::loadFile(QDir::temp().filePath("no-such-library_index.json"), &error));
+  QVERIFY(!error.isEmpty());
+}
+
+static QByteArray benchmarkIndexJson() {
+  // Uses the real index when there is one (LIBRARY_INDEX_JSON or the
+  // default data directory); otherwise a synthetic one of the same size.
+  QString path = qEnvironmentVariable("LIBRARY_INDEX_JSON");
+  if (path.isEmpty()) {
+    path = QDir::home().filePath(".arduino15/library_index.json");
+  }
+
+  QByteArray json;
+  if (QFileInfo(path).isFile()) {
+    QFile f(path);
+    if (f.open(QIODevice::ReadOnly)) {
+      json = f.readAll();
+    }
+  }
+  if (json.isEmpty()) {
+    const QStringList words = {"wifi", "display", "sensor", "motor", "json", "mqtt", "oled",
+                               "servo", "stepper", "ble", "lora", "gps", "rtc", "led",
+                               "temperature", "humidity", "keypad", "audio", "camera", "can"};
+    const QStringList archs = {"avr", "esp32", "esp8266", "samd", "rp2040", "stm32"};
+    QJsonArray releases;
+    for (int lib = 0; lib < 7000; ++lib) {
+      const QString w1 = words.at(lib % words.size());
+      const QString w2 = words.at((lib / words.size()) % words.size());
+      const QString name = QStringLiteral("%1%2Lib%3").arg(w1, w2).arg(lib);
+      for (int v = 0; v < 6; ++v) {
+        releases << release(
+            name, QStringLiteral("1.%1.0").arg(v), QStringLiteral("Author %1").arg(lib % 900),
+            QStringLiteral("Driver for %1 and %2 modules, version %3.").arg(w1, w2).arg(v),
+            {archs.at(lib % archs.size())});
+      }
+    }
+    json = indexJson(releases);
+  }
+  return json;
+}
+
+void TestLibraryCatalog::benchmarkLibraryIndexLoad() {
+  const QByteArray json = benchmarkIndexJson();
+  std::shared_ptr<const LibraryCatalog> catalog;
+  QBENCHMARK {
+    catalog = LibraryCatalog::fromJson(json);
+  }
+  QVERIFY(catalog);
+  QVERIFY(catalog->libraryCount() > 1000);
+}
+
+void TestLibraryCatalog::benchmarkLibraryIndexSearch_data() {
+  QTest::addColumn<QString>("query");
+  for (const char* q : {"wi", "wifi", "dis", "display", "adafruit", "sensor temp", "json",
+                        "servo", "esp32", "lora", "mq", "oled display", "stepper motor"}) {
+    QTest::newRow(q) << QString::fromLatin1(q);
+  }
+}
+
+void TestLibraryCatalog::benchmarkLibraryIndexSearch() {
+  QFETCH(QString, query);
+  static const std::shared_ptr<const LibraryCatalog> catalog =
+      LibraryCatalog::fromJson(benchmarkIndexJson());
+  QVERIFY(catalog);
+
+  QBENCHMARK {
+    catalog->search(query);
+  }
+}
+
+QTEST_MAIN(TestLibraryCatalog)
+
+#include "test_library_catalog.moc"
@@ -18,6 +18,7 @@ class TestLibraryManagerDialog final : public QObject {
  private slots:
   void showSearchForRunsSearchAndPopulatesResults();
   void installedIncludeButtonEmitsProvidesIncludes();
+  void searchUsesLocalIndexAndReloadsWhenItChanges();
 };
 
 static bool makeExecutable(const QString& path) {
@@ -59,6 +60,7 @@ void TestLibraryManagerDialog::showSearchForRunsSearchAndPopulatesResults() {
   cli.setArduinoCliPath(script);
 
   LibraryManagerDialog dlg(&cli, nullptr);
+  dlg.setLibraryIndexPath(dir.filePath("missing-library_index.json"));
   dlg.showSearchFor("WiFi");
 
   auto* edit = dlg.findChild<QLineEdit*>("libraryManagerSearchEdit");
@@ -133,6 +135,70 @@ void TestLibraryManagerDialog::installedIncludeButtonEmitsProvidesIncludes() {
   qunsetenv("ARDUINO_CLI_CONFIG_FILE");
 }
 
+static void writeLibraryIndex(const QString& path, const QByteArray& libraries) {
+  QFile f(path);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  f.write("{\"libraries\":[" + libraries + "]}");
+}
+
+void TestLibraryManagerDialog::searchUsesLocalIndexAndReloadsWhenItChanges() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  // Any CLI call fails, so results can only come from the index file.
+  const QString script = dir.filePath("fake-arduino-cli.sh");
+  {
+    QFile f(script);
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+    f.write("#!/usr/bin/env bash\nexit 1\n");
+  }
+  QVERIFY(makeExecutable(script));
+
+  const QString index = dir.filePath("library_index.json");
+  writeLibraryIndex(index,
+                    "{\"name\":\"WiFiNINA\",\"version\":\"1.8.0\",\"sentence\":\"NINA WiFi\"},"
+                    "{\"name\":\"WiFiNINA\",\"version\":\"1.8.14\",\"sentence\":\"NINA WiFi\"},"
+                    "{\"name\":\"Servo\",\"version\":\"1.2.1\",\"sentence\":\"Servo motors\"}");
+
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script);
+
+  LibraryManagerDialog dlg(&cli, nullptr);
+  dlg.setLibraryIndexPath(index);
+  dlg.showSearchFor("wifi");
+
+  auto* view = dlg.findChild<QTableView*>("libraryManagerSearchView");
+  QVERIFY(view);
+  QTRY_COMPARE(view->model()->rowCount(), 1);
+  QCOMPARE(view->model()->index(0, 0).data().toString(), QStringLiteral("WiFiNINA"));
+  QCOMPARE(view->model()->index(0, 1).data().toString(), QStringLiteral("1.8.14"));
+  QVERIFY(!dlg.isBusy());
+
+  // Typing searches the catalog once it pauses, not on every keystroke.
+  auto* edit = dlg.findChild<QLineEdit*>("libraryManagerSearchEdit");
+  QVERIFY(edit);
+  edit->setText("serv");
+  edit->setText("servo");
+  QCOMPARE(view->model()->index(0, 0).data().toString(), QStringLiteral("WiFiNINA"));
+  QTRY_COMPARE(view->model()->index(0, 0).data().toString(), QStringLiteral("Servo"));
+  QCOMPARE(view->model()->rowCount(), 1);
+
+  // A newer index file is picked up on the next search.
+  writeLibraryIndex(index,
+                    "{\"name\":\"Servo\",\"version\":\"1.2.1\",\"sentence\":\"Servo motors\"},"
+                    "{\"name\":\"ServoEasing\",\"version\":\"3.2.1\",\"sentence\":\"Smooth\"}");
+  {
+    QFile f(index);
+    QVERIFY(f.open(QIODevice::ReadWrite));
+    QVERIFY(f.setFileTime(QDateTime::currentDateTime().addSecs(60),
+                          QFileDevice::FileModificationTime));
+  }
+  edit->setText("servo ");
+  QTRY_COMPARE(view->model()->rowCount(), 2);
+  QCOMPARE(view->model()->index(0, 0).data().toString(), QStringLiteral("Servo"));
+  QCOMPARE(view->model()->index(1, 0).data().toString(), QStringLiteral("ServoEasing"));
+}
+
 int main(int argc, char** argv) {
   qputenv("QT_QPA_PLATFORM", "offscreen");
   QApplication app(argc, argv);
@@ -1,6 +1,7 @@
 #include <QtTest/QtTest>
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -8,6 +9,7 @@
 #include <QTimer>
 
 #include "lsp_client.h"
+#include "lsp_message_framer.h"
 
 class TestLspClient final : public QObject {
   Q_OBJECT
@@ -15,8 +17,24 @@ class TestLspClient final : public QObject {
  private slots:
   void initializeAndReceiveDiagnostics();
   void requestsReturnResults();
+  void incrementalChangesAreBatchedAsRanges();
+  void fullSyncFallbackSendsWholeText();
+  void framerHandlesSplitAndCoalescedMessages();
+  void benchmarkDiagnosticsFlood();
 };
 
+namespace {
+void fetchDocumentState(LspClient& client, const QString& uri, QJsonObject* state) {
+  bool done = false;
+  client.request("fake/documentState", QJsonObject{{"uri", uri}},
+                 [&](const QJsonValue& result, const QJsonObject&) {
+                   *state = result.toObject();
+                   done = true;
+                 });
+  QTRY_VERIFY_WITH_TIMEOUT(done, 2000);
+}
+}  // namespace
+
 void TestLspClient::initializeAndReceiveDiagnostics() {
   const QString server = qEnvironmentVariable("FAKE_LSP_SERVER");
   QVERIFY2(!server.isEmpty(), "FAKE_LSP_SERVER env var must be set by CTest.");
@@ -124,6 +142,203 @@ void TestLspClient::requestsReturnResults() {
   QTRY_VERIFY_WITH_TIMEOUT(gotSymbols, 2000);
 }
 
+void TestLspClient::incrementalChangesAreBatchedAsRanges() {
+  const QString server = qEnvironmentVariable("FAKE_LSP_SERVER");
+  QVERIFY2(!server.isEmpty(), "FAKE_LSP_SERVER env var must be set by CTest.");
+  qputenv("FAKE_LSP_SYNC_KIND", "2");
+
+  LspClient client;
+  struct StopOnReturn {
+    LspClient* c;
+    ~StopOnReturn() {
+      c->stop();
+      qunsetenv("FAKE_LSP_SYNC_KIND");
+    }
+  } stop{&client};
+
+  QSignalSpy readySpy(&client, &LspClient::readyChanged);
+  client.start(server, {}, "file:///tmp");
+  QVERIFY(readySpy.wait(2000));
+  QCOMPARE(client.textDocumentSyncKind(), LspClient::TextDocumentSyncKind::Incremental);
+
+  const QString uri = QStringLiteral("file:///tmp/sketch.ino");
+  client.didOpen(uri, "cpp", "void setup() {}\nvoid loop() {}\n");
+
+  // Type "int x;" on a new line inside loop(), one keystroke at a time.
+  const QString typed = QStringLiteral("\nint x;");
+  int pos = 29;
+  for (const QChar ch : typed) {
+    client.didChangeContents(uri, pos++, 0, QString(ch));
+  }
+  // Backspace the ';' and replace "void" with "bool" on the first line.
+  client.didChangeContents(uri, --pos, 1, QString());
+  client.didChangeContents(uri, 0, 4, QStringLiteral("bool"));
+  // Format-only notifications report unchanged text and must be ignored.
+  client.didChangeContents(uri, 5, 5, QStringLiteral("setup"));
+
+  QJsonObject state;
+  fetchDocumentState(client, uri, &state);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  QCOMPARE(state.value("text").toString(),
+           QStringLiteral("bool setup() {}\nvoid loop() {\nint x}\n"));
+  QCOMPARE(state.value("didChangeCount").toInt(), 1);
+  QCOMPARE(state.value("lastContentChangeCount").toInt(), 2);
+  QVERIFY(state.value("lastChangeHadRange").toBool());
+}
+
+void TestLspClient::fullSyncFallbackSendsWholeText() {
+  const QString server = qEnvironmentVariable("FAKE_LSP_SERVER");
+  QVERIFY2(!server.isEmpty(), "FAKE_LSP_SERVER env var must be set by CTest.");
+  qputenv("FAKE_LSP_SYNC_KIND", "1");
+
+  LspClient client;
+  struct StopOnReturn {
+    LspClient* c;
+    ~StopOnReturn() {
+      c->stop();
+      qunsetenv("FAKE_LSP_SYNC_KIND");
+    }
+  } stop{&client};
+
+  QSignalSpy readySpy(&client, &LspClient::readyChanged);
+  client.start(server, {}, "file:///tmp");
+  QVERIFY(readySpy.wait(2000));
+  QCOMPARE(client.textDocumentSyncKind(), LspClient::TextDocumentSyncKind::Full);
+
+  const QString uri = QStringLiteral("file:///tmp/sketch.ino");
+  client.didOpen(uri, "cpp", "a\nb\n");
+  client.didChangeContents(uri, 2, 1, QStringLiteral("bc\nd"));
+  client.didChangeContents(uri, 0, 0, QStringLiteral("//"));
+
+  QJsonObject state;
+  fetchDocumentState(client, uri, &state);
+  if (QTest::currentTestFailed()) {
+    return;
+  }
+  QCOMPARE(state.value("text").toString(), QStringLiteral("//a\nbc\nd\n"));
+  QCOMPARE(state.value("didChangeCount").toInt(), 1);
+  QCOMPARE(state.value("lastContentChangeCount").toInt(), 1);
+  QVERIFY(!state.value("lastChangeHadRange").toBool());
+
+  QSignalSpy resyncSpy(&client, &LspClient::documentResyncRequested);
+  client.didChangeContents(uri, 100, 1, QString());
+  QCOMPARE(resyncSpy.count(), 1);
+}
+
+void TestLspClient::framerHandlesSplitAndCoalescedMessages() {
+  auto frame = [](const QByteArray& json) {
+    return "Content-Length: " + QByteArray::number(json.size()) +
+           "\r\nContent-Type: application/vscode-jsonrpc\r\n\r\n" + json;
+  };
+  const QByteArray a = frame(R"({"id":1})");
+  const QByteArray b = frame(R"({"id":2,"result":"x"})");
+  const QByteArray stream = a + "garbage\r\n\r\n" + b + frame(R"({"id":3})");
+
+  // Feed byte by byte: every message must come out whole and in order.
+  LspMessageFramer framer;
+  QList<QByteArray> payloads;
+  int invalidHeaders = 0;
+  for (const char ch : stream) {
+    framer.append(QByteArray(1, ch));
+    QByteArray payload;
+    QByteArray discarded;
+    while (true) {
+      const auto status = framer.next(&payload, &discarded);
+      if (status == LspMessageFramer::Status::NeedMoreData) {
+        break;
+      }
+      if (status == LspMessageFramer::Status::InvalidHeader) {
+        QCOMPARE(discarded, QByteArray("garbage"));
+        ++invalidHeaders;
+        continue;
+      }
+      payloads << QByteArray(payload.constData(), payload.size());
+    }
+  }
+  QCOMPARE(invalidHeaders, 1);
+  QCOMPARE(payloads.size(), 3);
+  QCOMPARE(payloads.at(1), QByteArray(R"({"id":2,"result":"x"})"));
+  QCOMPARE(framer.bufferedBytes(), qsizetype(0));
+
+  // Many messages in one chunk, with the buffer compacting along the way.
+  QByteArray bulk;
+  for (int i = 0; i < 5000; ++i) {
+    bulk += frame(QByteArray(R"({"id":)") + QByteArray::number(i) + "}");
+  }
+  LspMessageFramer bulkFramer;
+  int count = 0;
+  for (qsizetype offset = 0; offset < bulk.size(); offset += 4096) {
+    bulkFramer.append(bulk.mid(offset, 4096));
+    QByteArray payload;
+    while (bulkFramer.next(&payload) == LspMessageFramer::Status::Message) {
+      QCOMPARE(payload, QByteArray(R"({"id":)") + QByteArray::number(count) + "}");
+      ++count;
+    }
+  }
+  QCOMPARE(count, 5000);
+}
+
+void TestLspClient::benchmarkDiagnosticsFlood() {
+  const QString server = qEnvironmentVariable("FAKE_LSP_SERVER");
+  QVERIFY2(!server.isEmpty(), "FAKE_LSP_SERVER env var must be set by CTest.");
+
+  LspClient client;
+  struct StopOnReturn {
+    LspClient* c;
+    ~StopOnReturn() { c->stop(); }
+  } stop{&client};
+
+  QSignalSpy readySpy(&client, &LspClient::readyChanged);
+  client.start(server, {}, "file:///tmp");
+  QVERIFY(readySpy.wait(2000));
+
+  constexpr int kMessages = 2000;
+  constexpr int kDiagnosticsPerMessage = 20;
+  int received = 0;
+  connect(&client, &LspClient::publishDiagnostics, this,
+          [&received](const QString& uri, const QJsonArray&) {
+            if (uri.startsWith(QStringLiteral("file:///tmp/flood"))) {
+              ++received;
+            }
+          });
+
+  // A 1 ms ticker measures the longest gap the GUI thread went unserviced.
+  QElapsedTimer tickClock;
+  qint64 lastTick = 0;
+  qint64 maxStallMs = 0;
+  QTimer ticker;
+  ticker.setInterval(1);
+  connect(&ticker, &QTimer::timeout, this, [&] {
+    const qint64 now = tickClock.elapsed();
+    maxStallMs = std::max(maxStallMs, now - lastTick);
+    lastTick = now;
+  });
+
+  tickClock.start();
+  ticker.start();
+  QBENCHMARK {
+    received = 0;
+    bool done = false;
+    client.request("fake/flood",
+                   QJsonObject{{"count", kMessages},
+                               {"diagnosticsPerMessage", kDiagnosticsPerMessage}},
+                   [&](const QJsonValue&, const QJsonObject& error) {
+                     QVERIFY(error.isEmpty());
+                     done = true;
+                   });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 30000);
+    QCOMPARE(received, kMessages);
+  }
+  ticker.stop();
+
+  // Decoding happens off the GUI thread; only delivering batches runs here.
+  constexpr qint64 kMaxStallMs = 500;
+  QVERIFY2(maxStallMs < kMaxStallMs,
+           qPrintable(QStringLiteral("GUI thread stalled for %1 ms").arg(maxStallMs)));
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   TestLspClient tc;
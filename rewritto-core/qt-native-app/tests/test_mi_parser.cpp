@@ -2,6 +2,64 @@
 
 #include "mi_parser.h"
 
+namespace {
+
+using Key = MiParser::Key;
+
+// Feeds `data` the way QProcess hands it over, in fixed-size reads.
+QList<MiParser::Record> feedInChunks(MiParser& parser, const QByteArray& data, int chunkSize) {
+  QList<MiParser::Record> out;
+  for (qsizetype i = 0; i < data.size(); i += chunkSize) {
+    out += parser.feed(data.mid(i, chunkSize));
+  }
+  return out;
+}
+
+QByteArray largeVariablesRecord(int count) {
+  QByteArray out = "42^done,variables=[";
+  for (int i = 0; i < count; ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    out += "{name=\"sensor_reading_";
+    out += QByteArray::number(i);
+    out += "\",type=\"struct Reading\",value=\"{raw = ";
+    out += QByteArray::number(i * 7);
+    out += ", label = \\\"channel\\\\t";
+    out += QByteArray::number(i % 16);
+    out += "\\\", valid = true}\"}";
+  }
+  out += "]\n";
+  return out;
+}
+
+QByteArray largeMemoryRecord(int rows, int bytesPerRow) {
+  QByteArray out = "7^done,addr=\"0x20000000\",nr-bytes=\"";
+  out += QByteArray::number(rows * bytesPerRow);
+  out += "\",memory=[";
+  for (int row = 0; row < rows; ++row) {
+    if (row > 0) {
+      out += ',';
+    }
+    out += "{addr=\"0x";
+    out += QByteArray::number(0x20000000 + row * bytesPerRow, 16);
+    out += "\",data=[";
+    for (int b = 0; b < bytesPerRow; ++b) {
+      if (b > 0) {
+        out += ',';
+      }
+      out += "\"0x";
+      out += QByteArray::number((row + b) & 0xff, 16).rightJustified(2, '0');
+      out += '"';
+    }
+    out += "]}";
+  }
+  out += "]\n";
+  return out;
+}
+
+}  // namespace
+
 class TestMiParser final : public QObject {
   Q_OBJECT
 
@@ -24,14 +82,13 @@ class TestMiParser final : public QObject {
                        "frame={func=\"loop\",file=\"sketch.ino\",fullname=\"/tmp/sketch.ino\",line=\"10\"}"));
     QCOMPARE(r.type, MiParser::Record::Type::ExecAsync);
     QCOMPARE(r.klass, QStringLiteral("stopped"));
-    QCOMPARE(r.results.value(QStringLiteral("reason")).constValue,
-             QStringLiteral("breakpoint-hit"));
-    QVERIFY(r.results.contains(QStringLiteral("frame")));
-    const auto frame = r.results.value(QStringLiteral("frame"));
-    QCOMPARE(frame.kind, MiParser::Value::Kind::Tuple);
-    QCOMPARE(frame.tuple.value(QStringLiteral("func")).constValue, QStringLiteral("loop"));
-    QCOMPARE(frame.tuple.value(QStringLiteral("fullname")).constValue,
-             QStringLiteral("/tmp/sketch.ino"));
+    QCOMPARE(r.results.value(Key::Reason).toString(), QStringLiteral("breakpoint-hit"));
+    QVERIFY(r.results.contains(Key::Frame));
+    const MiParser::Value frame = r.results.value(Key::Frame);
+    QCOMPARE(frame.kind(), MiParser::Value::Kind::Tuple);
+    QCOMPARE(frame.value(Key::Func).toString(), QStringLiteral("loop"));
+    QCOMPARE(frame.value(Key::Fullname).toString(), QStringLiteral("/tmp/sketch.ino"));
+    QCOMPARE(frame.value(Key::Line).toInt(), 10);
   }
 
   void parsesStackFrames() {
@@ -41,16 +98,21 @@ class TestMiParser final : public QObject {
     QCOMPARE(r.type, MiParser::Record::Type::Result);
     QCOMPARE(r.token, 2);
     QCOMPARE(r.klass, QStringLiteral("done"));
-    QVERIFY(r.results.contains(QStringLiteral("stack")));
-    const auto stack = r.results.value(QStringLiteral("stack"));
-    QCOMPARE(stack.kind, MiParser::Value::Kind::List);
-    QCOMPARE(stack.list.size(), 2);
-    QCOMPARE(stack.list.at(0).first, QStringLiteral("frame"));
-    QCOMPARE(stack.list.at(0).second.kind, MiParser::Value::Kind::Tuple);
-    QCOMPARE(stack.list.at(0).second.tuple.value(QStringLiteral("level")).constValue,
-             QStringLiteral("0"));
-    QCOMPARE(stack.list.at(1).second.tuple.value(QStringLiteral("func")).constValue,
-             QStringLiteral("main"));
+    QVERIFY(r.results.contains(Key::Stack));
+    const MiParser::Value stack = r.results.value(Key::Stack);
+    QCOMPARE(stack.kind(), MiParser::Value::Kind::List);
+    QCOMPARE(stack.size(), 2);
+    QCOMPARE(stack.at(0).name().toByteArray(), QByteArray("frame"));
+    QCOMPARE(stack.at(0).key(), Key::Frame);
+    QCOMPARE(stack.at(0).kind(), MiParser::Value::Kind::Tuple);
+    QCOMPARE(stack.at(0).value(Key::Level).toString(), QStringLiteral("0"));
+    QCOMPARE(stack.at(1).value(Key::Func).toString(), QStringLiteral("main"));
+
+    QStringList functions;
+    for (const MiParser::Value frame : stack) {
+      functions << frame.value(Key::Func).toString();
+    }
+    QCOMPARE(functions, QStringList({QStringLiteral("loop"), QStringLiteral("main")}));
   }
 
   void parsesVariablesList() {
@@ -58,18 +120,16 @@ class TestMiParser final : public QObject {
         QStringLiteral("3^done,variables=[{name=\"x\",value=\"42\",type=\"int\"},{name=\"s\",value=\"\\\"hi\\\"\"}]"));
     QCOMPARE(r.type, MiParser::Record::Type::Result);
     QCOMPARE(r.token, 3);
-    QVERIFY(r.results.contains(QStringLiteral("variables")));
-    const auto vars = r.results.value(QStringLiteral("variables"));
-    QCOMPARE(vars.kind, MiParser::Value::Kind::List);
-    QCOMPARE(vars.list.size(), 2);
-    QCOMPARE(vars.list.at(0).first, QString{});
-    QCOMPARE(vars.list.at(0).second.kind, MiParser::Value::Kind::Tuple);
-    QCOMPARE(vars.list.at(0).second.tuple.value(QStringLiteral("name")).constValue,
-             QStringLiteral("x"));
-    QCOMPARE(vars.list.at(0).second.tuple.value(QStringLiteral("value")).constValue,
-             QStringLiteral("42"));
-    QCOMPARE(vars.list.at(1).second.tuple.value(QStringLiteral("value")).constValue,
-             QStringLiteral("\"hi\""));
+    QVERIFY(r.results.contains(Key::Variables));
+    const MiParser::Value vars = r.results.value(Key::Variables);
+    QCOMPARE(vars.kind(), MiParser::Value::Kind::List);
+    QCOMPARE(vars.size(), 2);
+    QVERIFY(vars.at(0).name().isEmpty());
+    QCOMPARE(vars.at(0).kind(), MiParser::Value::Kind::Tuple);
+    QCOMPARE(vars.at(0).value(Key::Name).toString(), QStringLiteral("x"));
+    QCOMPARE(vars.at(0).value(Key::Value).toString(), QStringLiteral("42"));
+    QCOMPARE(vars.at(1).value(Key::Value).toString(), QStringLiteral("\"hi\""));
+    QVERIFY(!vars.at(2).isValid());
   }
 
   void feedSplitsLines() {
@@ -83,6 +143,169 @@ class TestMiParser final : public QObject {
     QCOMPARE(recs.at(1).klass, QStringLiteral("running"));
     QCOMPARE(recs.at(2).type, MiParser::Record::Type::Prompt);
   }
+
+  void internsCommonKeys() {
+    const MiParser::Record r = MiParser::parseLine(
+        QByteArrayView("^done,thread-id=\"3\",custom-key=\"x\",new_num_children=\"2\""));
+    QCOMPARE(r.results.size(), 3);
+    QCOMPARE(r.results.at(0).key(), Key::ThreadId);
+    QCOMPARE(r.results.at(1).key(), Key::Other);
+    QCOMPARE(r.results.value(QByteArrayView("custom-key")).toString(), QStringLiteral("x"));
+    QCOMPARE(r.results.value(Key::NewNumChildren).toInt(), 2);
+    QVERIFY(!r.results.contains(Key::Other));
+
+    QCOMPARE(MiParser::internKey(QByteArrayView("thread-id")), Key::ThreadId);
+    QCOMPARE(MiParser::internKey(QByteArrayView("what")), Key::What);
+    QCOMPARE(MiParser::internKey(QByteArrayView("threads-x")), Key::Other);
+    QCOMPARE(MiParser::keyName(Key::InScope).toByteArray(), QByteArray("in_scope"));
+  }
+
+  void decodesEscapesOnDemand() {
+    const MiParser::Record r = MiParser::parseLine(
+        QByteArrayView("^done,value=\"caf\\303\\251 \\\"x\\\"\\n\",plain=\"abc\""));
+    const MiParser::Value value = r.results.value(Key::Value);
+    // The view is the text as gdb wrote it.
+    QCOMPARE(value.bytes().toByteArray(), QByteArray("caf\\303\\251 \\\"x\\\"\\n"));
+    QCOMPARE(value.toString(), QStringLiteral("caf\u00e9 \"x\"\n"));
+    QCOMPARE(r.results.value(QByteArrayView("plain")).toString(), QStringLiteral("abc"));
+
+    const MiParser::Record stream =
+        MiParser::parseLine(QByteArrayView("@\"\\342\\234\\223 ok\\t\\\\\""));
+    QCOMPARE(stream.type, MiParser::Record::Type::Target);
+    QCOMPARE(stream.streamText, QStringLiteral("\u2713 ok\t\\"));
+  }
+
+  void feedKeepsViewsIntoTheChunk() {
+    MiParser p;
+    QByteArray chunk("5^done,value=\"42\"\n=thread-created,id=\"1\"\n");
+    const char* begin = chunk.constData();
+    const char* end = begin + chunk.size();
+    const QList<MiParser::Record> recs = p.feed(chunk);
+    QCOMPARE(recs.size(), 2);
+
+    // Whole lines in a fresh chunk are not copied.
+    const QByteArrayView value = recs.at(0).results.value(Key::Value).bytes();
+    QVERIFY(value.data() >= begin && value.data() < end);
+    QVERIFY(recs.at(1).raw.data() >= begin && recs.at(1).raw.data() < end);
+    QCOMPARE(recs.at(1).klass, QStringLiteral("thread-created"));
+
+    // Records keep their bytes alive on their own.
+    chunk = QByteArray();
+    p.reset();
+    QCOMPARE(recs.at(0).results.value(Key::Value).toInt(), 42);
+    QCOMPARE(recs.at(1).rawText(), QStringLiteral("=thread-created,id=\"1\""));
+  }
+
+  void feedJoinsRecordsAcrossChunks() {
+    MiParser p;
+    QVERIFY(p.feed(QByteArray("12^done,stack=[frame={lev")).isEmpty());
+    QVERIFY(p.feed(QByteArray("el=\"0\",func=\"lo")).isEmpty());
+    const QList<MiParser::Record> recs = p.feed(QByteArray("op\"}]\r\n~\"tail\\n\"\n*run"));
+    QCOMPARE(recs.size(), 2);
+    QCOMPARE(recs.at(0).token, 12);
+    QCOMPARE(recs.at(0).results.value(Key::Stack).at(0).value(Key::Func).toString(),
+             QStringLiteral("loop"));
+    QCOMPARE(recs.at(0).rawText(),
+             QStringLiteral("12^done,stack=[frame={level=\"0\",func=\"loop\"}]"));
+    QCOMPARE(recs.at(1).streamText, QStringLiteral("tail\n"));
+
+    const QList<MiParser::Record> rest = p.feed(QByteArray("ning,thread-id=\"all\"\n"));
+    QCOMPARE(rest.size(), 1);
+    QCOMPARE(rest.at(0).klass, QStringLiteral("running"));
+    QCOMPARE(rest.at(0).results.value(Key::ThreadId).toString(), QStringLiteral("all"));
+  }
+
+  void reportsMalformedInput() {
+    QString error;
+    const MiParser::Record r =
+        MiParser::parseLine(QByteArrayView("^done,value=\"never closed"), &error);
+    QCOMPARE(error, QStringLiteral("unterminated string"));
+    QCOMPARE(r.results.value(Key::Value).toString(), QStringLiteral("never closed"));
+
+    error.clear();
+    (void)MiParser::parseLine(QByteArrayView("^done,=\"x\""), &error);
+    QCOMPARE(error, QStringLiteral("expected name"));
+
+    const MiParser::Record plain = MiParser::parseLine(QByteArrayView("hello from the target"));
+    QCOMPARE(plain.type, MiParser::Record::Type::Unknown);
+    QVERIFY(!plain.results.isValid());
+    QCOMPARE(plain.rawText(), QStringLiteral("hello from the target"));
+  }
+
+  void benchmarkLargeVariablesRecord() {
+    constexpr int kVariables = 40000;
+    const QByteArray data = largeVariablesRecord(kVariables);
+    QVERIFY(data.size() > 3 * 1024 * 1024);
+
+    QList<MiParser::Record> recs;
+    QBENCHMARK {
+      MiParser p;
+      recs = feedInChunks(p, data, 64 * 1024);
+    }
+    QCOMPARE(recs.size(), 1);
+
+    // What a locals refresh reads: every name, and every value decoded.
+    const MiParser::Value vars = recs.at(0).results.value(Key::Variables);
+    qsizetype count = 0;
+    for (const MiParser::Value var : vars) {
+      QVERIFY(!var.value(Key::Name).toString().isEmpty());
+      ++count;
+    }
+    QCOMPARE(count, kVariables);
+    const MiParser::Value last = vars.at(kVariables - 1);
+    QCOMPARE(last.value(Key::Name).toString(), QStringLiteral("sensor_reading_39999"));
+    QCOMPARE(last.value(Key::Value).toString(),
+             QStringLiteral("{raw = 279993, label = \"channel\\t15\", valid = true}"));
+  }
+
+  void benchmarkLargeMemoryRecord() {
+    constexpr int kRows = 8192;
+    constexpr int kBytesPerRow = 64;
+    const QByteArray data = largeMemoryRecord(kRows, kBytesPerRow);
+    QVERIFY(data.size() > 3 * 1024 * 1024);
+
+    QList<MiParser::Record> recs;
+    QBENCHMARK {
+      MiParser p;
+      recs = feedInChunks(p, data, 64 * 1024);
+    }
+    QCOMPARE(recs.size(), 1);
+    QCOMPARE(recs.at(0).results.value(Key::Memory).size(), kRows);
+
+    // A hex view reads the bytes straight from the views.
+    quint64 checksum = 0;
+    qsizetype cells = 0;
+    for (const MiParser::Value row : recs.at(0).results.value(Key::Memory)) {
+      for (const MiParser::Value cell : row.value(Key::Data)) {
+        checksum += QByteArray::fromRawData(cell.bytes().data(), cell.bytes().size())
+                        .toUInt(nullptr, 16);
+        ++cells;
+      }
+    }
+    QCOMPARE(cells, qsizetype(kRows) * kBytesPerRow);
+    QVERIFY(checksum > 0);
+  }
+
+  void benchmarkLargeStringValue() {
+    // One huge value, e.g. a char buffer printed with `print elements 0`.
+    QByteArray text;
+    for (int i = 0; text.size() < 4 * 1024 * 1024; ++i) {
+      text += "line ";
+      text += QByteArray::number(i);
+      text += i % 8 == 0 ? "\\n\\\"quoted\\\"" : " plain text padding";
+    }
+    const QByteArray data = "9^done,value=\"" + text + "\"\n";
+
+    QList<MiParser::Record> recs;
+    QBENCHMARK {
+      MiParser p;
+      recs = feedInChunks(p, data, 64 * 1024);
+    }
+    QCOMPARE(recs.size(), 1);
+    const MiParser::Value value = recs.at(0).results.value(Key::Value);
+    QCOMPARE(value.bytes().size(), text.size());
+    QVERIFY(value.toString().startsWith(QStringLiteral("line 0\n\"quoted\"line 1 plain")));
+  }
 };
 
 QTEST_MAIN(TestMiParser)
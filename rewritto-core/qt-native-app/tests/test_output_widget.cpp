@@ -2,6 +2,7 @@
 
 #include <QApplication>
 #include <QPlainTextEdit>
+#include <QTextBlock>
 
 #include "output_widget.h"
 
@@ -10,6 +11,7 @@ class TestOutputWidget final : public QObject {
 
  private slots:
   void limitsOutputBlockCount();
+  void batchesStyledLines();
 };
 
 void TestOutputWidget::limitsOutputBlockCount() {
@@ -29,6 +31,49 @@ void TestOutputWidget::limitsOutputBlockCount() {
   QVERIFY(edit->document()->blockCount() <= maxBlocks + 1);
 }
 
+void TestOutputWidget::batchesStyledLines() {
+  OutputWidget w;
+  auto* edit = w.findChild<QPlainTextEdit*>(QStringLiteral("OutputTextEdit"));
+  QVERIFY(edit);
+
+  w.appendStyledLine(QStringLiteral("compiling <sketch>"));
+  w.appendStyledLine(QStringLiteral("sketch.ino:3:1: error: oops"), QColor(0xd3, 0x2f, 0x2f));
+  w.appendStyledLine(QStringLiteral("Sketch uses 924 bytes"), QColor(0x38, 0x8e, 0x3c), true);
+  QVERIFY(edit->document()->isEmpty());
+
+  // Queued lines go first; the timer flushes the rest.
+  w.appendLine(QStringLiteral("done"));
+  w.appendStyledLine(QStringLiteral("later"));
+  QCOMPARE(edit->toPlainText(),
+           QStringLiteral("compiling <sketch>\nsketch.ino:3:1: error: oops\n"
+                          "Sketch uses 924 bytes\ndone"));
+  QTRY_COMPARE(edit->document()->blockCount(), 5);
+  QCOMPARE(edit->document()->lastBlock().text(), QStringLiteral("later"));
+
+  const QTextCharFormat errorFormat =
+      edit->document()->findBlockByNumber(1).begin().fragment().charFormat();
+  QCOMPARE(errorFormat.foreground().color(), QColor(0xd3, 0x2f, 0x2f));
+  const QTextCharFormat sizeFormat =
+      edit->document()->findBlockByNumber(2).begin().fragment().charFormat();
+  QCOMPARE(sizeFormat.fontWeight(), int(QFont::Bold));
+  QVERIFY(!edit->document()->findBlockByNumber(0).begin().fragment().charFormat().hasProperty(
+      QTextFormat::ForegroundBrush));
+
+  // A burst larger than the block limit only inserts what would be kept.
+  const int maxBlocks = edit->document()->maximumBlockCount();
+  for (int i = 0; i < maxBlocks * 3; ++i) {
+    w.appendStyledLine(QString::number(i));
+  }
+  w.flushPending();
+  QVERIFY(edit->document()->blockCount() <= maxBlocks + 1);
+  QCOMPARE(edit->document()->lastBlock().text(), QString::number(maxBlocks * 3 - 1));
+
+  w.appendStyledLine(QStringLiteral("dropped"));
+  w.clear();
+  QTest::qWait(100);
+  QVERIFY(edit->document()->isEmpty());
+}
+
 int main(int argc, char** argv) {
   qputenv("QT_QPA_PLATFORM", "offscreen");
   QApplication app(argc, argv);
@@ -0,0 +1,286 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "platform_catalog.h"
+
+class TestPlatformCatalog final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void readsIndexesAndInstalledCores();
+  void searchMatchesEveryWordByPrefix();
+  void reusesCacheUntilInputsChange();
+  void reportsMissingDataDirAndBadIndex();
+  void serviceReloadsInBackground();
+};
+
+static void writeFile(const QString& path, const QByteArray& contents) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile f(path);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  f.write(contents);
+}
+
+static QJsonObject indexPlatform(const QString& arch,
+                                 const QString& name,
+                                 const QString& version,
+                                 const QStringList& boards,
+                                 const QString& category = QStringLiteral("Arduino")) {
+  QJsonArray boardArray;
+  for (const QString& board : boards) {
+    boardArray.append(QJsonObject{{"name", board}});
+  }
+  return QJsonObject{{"architecture", arch}, {"name", name},         {"version", version},
+                     {"category", category}, {"boards", boardArray}};
+}
+
+static QByteArray packageIndex(const QString& vendor,
+                               const QString& maintainer,
+                               const QJsonArray& platforms) {
+  const QJsonObject package{{"name", vendor},
+                            {"maintainer", maintainer},
+                            {"websiteURL", QStringLiteral("https://example.com/%1").arg(vendor)},
+                            {"email", QStringLiteral("%1@example.com").arg(vendor)},
+                            {"platforms", platforms},
+                            {"tools", QJsonArray{}}};
+  return QJsonDocument(QJsonObject{{"packages", QJsonArray{package}}})
+      .toJson(QJsonDocument::Compact);
+}
+
+static void writeSampleTree(const QString& dataDir, const QString& userDir) {
+  writeFile(dataDir + "/package_index.json",
+            packageIndex("arduino", "Arduino",
+                         {indexPlatform("avr", "Arduino AVR Boards", "1.8.5", {"Arduino Uno"}),
+                          indexPlatform("avr", "Arduino AVR Boards", "1.8.6",
+                                        {"Arduino Uno", "Arduino Mega or Mega 2560"}),
+                          indexPlatform("samd", "Arduino SAMD Boards (32-bits ARM Cortex-M0+)",
+                                        "1.8.14", {"Arduino Zero", "Arduino MKR WiFi 1010"})}));
+  writeFile(dataDir + "/package_index_esp32.json",
+            packageIndex("esp32", "Espressif Systems",
+                         {indexPlatform("esp32", "esp32", "3.0.1",
+                                        {"ESP32 Dev Module", "ESP32-S3 Dev Module"},
+                                        QStringLiteral("ESP32"))}));
+
+  const QString avr = dataDir + "/packages/arduino/hardware/avr";
+  writeFile(avr + "/1.8.6/boards.txt",
+            "menu.cpu=Processor\n"
+            "uno.name=Arduino Uno\n"
+            "uno.upload.tool=avrdude\n"
+            "mega.name=Arduino Mega or Mega 2560\n"
+            "mega.menu.cpu.atmega2560=ATmega2560\n"
+            "# comment\n"
+            "yunmini.name=Arduino Yun Mini\n"
+            "yunmini.hide=\n");
+  writeFile(avr + "/1.8.6/boards.local.txt", "uno.name=Arduino Uno (local)\n");
+  writeFile(avr + "/1.8.6/platform.txt", "name=Arduino AVR Boards\nversion=1.8.6\n");
+  // A leftover older version is ignored.
+  writeFile(avr + "/1.8.5/boards.txt", "old.name=Old Board\n");
+
+  writeFile(userDir + "/hardware/diy/rp2040/boards.txt", "pico.name=DIY Pico\n");
+  writeFile(userDir + "/hardware/diy/rp2040/platform.txt",
+            "name=DIY RP2040 Boards\nversion=0.1.0\n");
+}
+
+static int platformId(const PlatformCatalog& catalog, const QString& id) {
+  for (int i = 0; i < catalog.platformCount(); ++i) {
+    if (catalog.platform(i).id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static QStringList ids(const PlatformCatalog& catalog, const QVector<int>& platforms) {
+  QStringList out;
+  for (int id : platforms) {
+    out << catalog.platform(id).id;
+  }
+  return out;
+}
+
+void TestPlatformCatalog::readsIndexesAndInstalledCores() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  writeSampleTree(dir.filePath("data"), dir.filePath("user"));
+
+  QString error;
+  const auto catalog =
+      PlatformCatalog::load(dir.filePath("data"), dir.filePath("user"), QString{}, &error);
+  QVERIFY2(catalog, qPrintable(error));
+  QCOMPARE(catalog->platformCount(), 4);
+
+  const int avrId = platformId(*catalog, "arduino:avr");
+  QVERIFY(avrId >= 0);
+  const PlatformCatalog::Platform& avr = catalog->platform(avrId);
+  QCOMPARE(avr.installedVersion, QStringLiteral("1.8.6"));
+  QCOMPARE(avr.releases.size(), qsizetype(2));
+  QCOMPARE(avr.releases.first().version, QStringLiteral("1.8.6"));
+  QCOMPARE(avr.boards.size(), qsizetype(2));
+  QCOMPARE(avr.boards.at(0).name, QStringLiteral("Arduino Uno (local)"));
+  QCOMPARE(avr.boards.at(0).fqbn, QStringLiteral("arduino:avr:uno"));
+  QCOMPARE(avr.boards.at(1).fqbn, QStringLiteral("arduino:avr:mega"));
+
+  const int diyId = platformId(*catalog, "diy:rp2040");
+  QVERIFY(diyId >= 0);
+  QCOMPARE(catalog->platform(diyId).installedVersion, QStringLiteral("0.1.0"));
+  QCOMPARE(catalog->platformName(diyId), QStringLiteral("DIY RP2040 Boards"));
+  QCOMPARE(catalog->platform(diyId).boards.at(0).fqbn, QStringLiteral("diy:rp2040:pico"));
+
+  // Same shape as `arduino-cli core search --json`.
+  const QJsonObject json = catalog->searchJson(avrId);
+  QCOMPARE(json.value("id").toString(), QStringLiteral("arduino:avr"));
+  QCOMPARE(json.value("installed_version").toString(), QStringLiteral("1.8.6"));
+  QCOMPARE(json.value("latest_version").toString(), QStringLiteral("1.8.6"));
+  QCOMPARE(json.value("maintainer").toString(), QStringLiteral("Arduino"));
+  QVERIFY(json.value("indexed").toBool());
+  const QJsonObject latest = json.value("releases").toObject().value("1.8.6").toObject();
+  QCOMPARE(latest.value("name").toString(), QStringLiteral("Arduino AVR Boards"));
+  QCOMPARE(latest.value("types").toArray().at(0).toString(), QStringLiteral("Arduino"));
+  QCOMPARE(latest.value("boards").toArray().size(), qsizetype(2));
+
+  const QJsonObject samd = catalog->searchJson(platformId(*catalog, "arduino:samd"));
+  QVERIFY(!samd.contains("installed_version"));
+  QCOMPARE(samd.value("latest_version").toString(), QStringLiteral("1.8.14"));
+
+  const QJsonObject diy = catalog->searchJson(diyId);
+  QVERIFY(!diy.value("indexed").toBool());
+  QVERIFY(diy.value("releases").toObject().contains("0.1.0"));
+}
+
+void TestPlatformCatalog::searchMatchesEveryWordByPrefix() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  writeSampleTree(dir.filePath("data"), dir.filePath("user"));
+  const auto catalog =
+      PlatformCatalog::load(dir.filePath("data"), dir.filePath("user"), QString{});
+  QVERIFY(catalog);
+
+  QCOMPARE(ids(*catalog, catalog->search(QString{})),
+           QStringList({"arduino:avr", "arduino:samd", "diy:rp2040", "esp32:esp32"}));
+  QCOMPARE(ids(*catalog, catalog->search("esp")), QStringList({"esp32:esp32"}));
+  QCOMPARE(ids(*catalog, catalog->search("s3")), QStringList({"esp32:esp32"}));
+  QCOMPARE(ids(*catalog, catalog->search("arduino")).first(), QStringLiteral("arduino:avr"));
+  QCOMPARE(ids(*catalog, catalog->search("arduino mkr")), QStringList({"arduino:samd"}));
+  QCOMPARE(ids(*catalog, catalog->search("mega")), QStringList({"arduino:avr"}));
+  QCOMPARE(ids(*catalog, catalog->search("avr")), QStringList({"arduino:avr"}));
+  QCOMPARE(ids(*catalog, catalog->search("pico")), QStringList({"diy:rp2040"}));
+  QVERIFY(catalog->search("arduino esp").isEmpty());
+  QVERIFY(catalog->search("zigbee").isEmpty());
+}
+
+void TestPlatformCatalog::reusesCacheUntilInputsChange() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString data = dir.filePath("data");
+  const QString user = dir.filePath("user");
+  const QString cache = dir.filePath("cache/platform-catalog.bin");
+  writeSampleTree(data, user);
+
+  const auto parsed = PlatformCatalog::load(data, user, cache);
+  QVERIFY(parsed);
+  QVERIFY(!parsed->loadedFromCache());
+  QVERIFY(QFileInfo::exists(cache));
+
+  const auto cached = PlatformCatalog::load(data, user, cache);
+  QVERIFY(cached);
+  QVERIFY(cached->loadedFromCache());
+  QCOMPARE(cached->platformCount(), parsed->platformCount());
+  for (int id = 0; id < parsed->platformCount(); ++id) {
+    QCOMPARE(cached->searchJson(id), parsed->searchJson(id));
+    QCOMPARE(cached->platform(id).boards.size(), parsed->platform(id).boards.size());
+  }
+  QCOMPARE(ids(*cached, cached->search("mkr")), ids(*parsed, parsed->search("mkr")));
+
+  // Unchanged inputs hand back the current catalog itself.
+  QVERIFY(PlatformCatalog::load(data, user, cache, nullptr, cached) == cached);
+
+  writeFile(data + "/packages/arduino/hardware/avr/1.8.6/boards.txt",
+            "uno.name=Arduino Uno\nnano.name=Arduino Nano\n");
+  const auto changed = PlatformCatalog::load(data, user, cache, nullptr, cached);
+  QVERIFY(changed);
+  QVERIFY(changed != cached);
+  QVERIFY(!changed->loadedFromCache());
+  QCOMPARE(ids(*changed, changed->search("nano")), QStringList({"arduino:avr"}));
+
+  // A corrupt cache is ignored and rewritten.
+  writeFile(cache, "not a cache");
+  const auto reparsed = PlatformCatalog::load(data, user, cache);
+  QVERIFY(reparsed);
+  QVERIFY(!reparsed->loadedFromCache());
+  QVERIFY(PlatformCatalog::load(data, user, cache)->loadedFromCache());
+}
+
+void TestPlatformCatalog::reportsMissingDataDirAndBadIndex() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  QString error;
+  QVERIFY(!PlatformCatalog::load(dir.filePath("missing"), QString{}, QString{}, &error));
+  QVERIFY(!error.isEmpty());
+
+  writeFile(dir.filePath("data/package_index.json"), "{\"packages\": [");
+  error.clear();
+  QVERIFY(!PlatformCatalog::load(dir.filePath("data"), QString{}, QString{}, &error));
+  QVERIFY(error.contains("package_index.json"));
+}
+
+void TestPlatformCatalog::serviceReloadsInBackground() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  writeSampleTree(dir.filePath("data"), dir.filePath("user"));
+
+  PlatformCatalogService service(nullptr);
+  service.setDirectories(dir.filePath("data"), dir.filePath("user"));
+  service.setCachePath(dir.filePath("platform-catalog.bin"));
+  QSignalSpy changed(&service, &PlatformCatalogService::catalogChanged);
+  QSignalSpy failed(&service, &PlatformCatalogService::loadFailed);
+  // Handlers see the failure through errorString() already.
+  QString errorInHandler;
+  connect(&service, &PlatformCatalogService::loadFailed, &service,
+          [&] { errorInHandler = service.errorString(); });
+
+  service.refresh();
+  QVERIFY(service.isLoading());
+  QVERIFY(!service.catalog());
+  QTRY_COMPARE(changed.count(), 1);
+  QVERIFY(service.catalog());
+  const auto first = service.catalog();
+
+  // Nothing changed: no signal, same catalog.
+  service.refresh();
+  QTRY_VERIFY(!service.isLoading());
+  QCOMPARE(changed.count(), 1);
+  QVERIFY(service.catalog() == first);
+
+  writeFile(dir.filePath("data/packages/arduino/hardware/avr/1.8.6/boards.txt"),
+            "leonardo.name=Arduino Leonardo\n");
+  service.refresh();
+  QTRY_COMPARE(changed.count(), 2);
+  QCOMPARE(ids(*service.catalog(), service.catalog()->search("leonardo")),
+           QStringList({"arduino:avr"}));
+
+  writeFile(dir.filePath("data/package_index.json"), "{");
+  service.refresh();
+  QTRY_COMPARE(changed.count(), 3);
+  QVERIFY(!service.catalog());
+  QCOMPARE(failed.count(), 1);
+  QVERIFY(!service.errorString().isEmpty());
+  QCOMPARE(errorInHandler, service.errorString());
+  QCOMPARE(failed.at(0).at(0).toString(), service.errorString());
+
+  // The same failure is reported once.
+  service.refresh();
+  QTRY_VERIFY(!service.isLoading());
+  QCOMPARE(failed.count(), 1);
+}
+
+QTEST_MAIN(TestPlatformCatalog)
+
+#include "test_platform_catalog.moc"
@@ -0,0 +1,267 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "arduino_cli.h"
+#include "port_watcher.h"
+
+namespace {
+
+// As printed by `board list --watch --format json` on 1.x: one indented
+// object per event.
+QByteArray addEvent(const QString& address, const QString& boardName, const QString& fqbn) {
+  QString boards;
+  if (!fqbn.isEmpty()) {
+    boards = QStringLiteral(",\n    \"matching_boards\": [\n      {\n        \"name\": \"%1\",\n"
+                            "        \"fqbn\": \"%2\"\n      }\n    ]")
+                 .arg(boardName, fqbn);
+  }
+  return QStringLiteral("{\n  \"eventType\": \"add\",\n  \"port\": {\n    \"port\": {\n"
+                        "      \"address\": \"%1\",\n      \"label\": \"%1\",\n"
+                        "      \"protocol\": \"serial\",\n"
+                        "      \"protocol_label\": \"Serial Port (USB)\",\n"
+                        "      \"properties\": {\"pid\": \"0x0043\", \"vid\": \"0x2341\"}\n"
+                        "    }%2\n  }\n}\n")
+      .arg(address, boards)
+      .toUtf8();
+}
+
+QByteArray removeEvent(const QString& address) {
+  return QStringLiteral("{\n  \"eventType\": \"remove\",\n  \"port\": {\n    \"port\": {\n"
+                        "      \"address\": \"%1\",\n      \"protocol\": \"serial\"\n"
+                        "    }\n  }\n}\n")
+      .arg(address)
+      .toUtf8();
+}
+
+QStringList addresses(const PortWatcher& watcher) {
+  QStringList out;
+  for (const PortWatcher::Port& port : watcher.ports()) {
+    out << port.address;
+  }
+  return out;
+}
+
+}  // namespace
+
+class TestPortWatcher final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void appliesEventsSplitAnywhere();
+  void parsesBoardListOfEachCliVersion();
+  void replaysWatchStreamFromFakeCli();
+  void quitEventStopsWatch();
+  void enumeratesUsbSerialFromSysfs();
+
+ private:
+  QTemporaryDir dir_;
+
+  QString writeFakeCli(const QString& name, const QByteArray& body);
+};
+
+static bool makeExecutable(const QString& path) {
+  QFile f(path);
+  QFile::Permissions p = f.permissions();
+  p |= QFile::ExeOwner | QFile::ExeGroup | QFile::ExeOther;
+  return f.setPermissions(p);
+}
+
+void TestPortWatcher::initTestCase() {
+  QVERIFY(dir_.isValid());
+  const QString cfg = dir_.filePath("arduino-cli.yaml");
+  QFile f(cfg);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Text));
+  f.write("# test\n");
+  f.close();
+  qputenv("ARDUINO_CLI_CONFIG_FILE", cfg.toUtf8());
+}
+
+void TestPortWatcher::cleanupTestCase() {
+  qunsetenv("ARDUINO_CLI_CONFIG_FILE");
+}
+
+QString TestPortWatcher::writeFakeCli(const QString& name, const QByteArray& body) {
+  const QString path = dir_.filePath(name);
+  QFile f(path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return {};
+  }
+  f.write("#!/usr/bin/env bash\n");
+  f.write(body);
+  f.close();
+  return makeExecutable(path) ? path : QString{};
+}
+
+void TestPortWatcher::appliesEventsSplitAnywhere() {
+  PortWatcher watcher(nullptr);
+  watcher.setNativeSerialEnumeration(false);
+  QSignalSpy changed(&watcher, &PortWatcher::portsChanged);
+
+  // Braces and escaped quotes inside strings must not end an event early.
+  const QByteArray tricky = addEvent("/dev/ttyACM0", "Uno \\\"R3\\\" {clone}", "arduino:avr:uno");
+  for (const char c : tricky) {
+    watcher.consume(QByteArray(1, c));
+  }
+  QCOMPARE(changed.count(), 1);
+  QCOMPARE(watcher.ports().size(), qsizetype(1));
+  const PortWatcher::Port port = watcher.ports().first();
+  QCOMPARE(port.address, QStringLiteral("/dev/ttyACM0"));
+  QCOMPARE(port.protocol, QStringLiteral("serial"));
+  QCOMPARE(port.boardName, QStringLiteral("Uno \"R3\" {clone}"));
+  QCOMPARE(port.boardFqbn, QStringLiteral("arduino:avr:uno"));
+  QCOMPARE(port.vid, QStringLiteral("0x2341"));
+
+  // Several events in one chunk are one change; repeating an add is none.
+  watcher.consume(addEvent("/dev/ttyUSB0", {}, {}) + addEvent("/dev/ttyUSB1", {}, {}) +
+                  removeEvent("/dev/ttyACM0"));
+  QCOMPARE(changed.count(), 2);
+  QCOMPARE(addresses(watcher), QStringList({"/dev/ttyUSB0", "/dev/ttyUSB1"}));
+  watcher.consume(addEvent("/dev/ttyUSB0", {}, {}) + removeEvent("/dev/ttyACM9"));
+  QCOMPARE(changed.count(), 2);
+
+  // An add for a known port updates it in place (the board was matched).
+  const QByteArray update = addEvent("/dev/ttyUSB1", "ESP32 Dev Module", "esp32:esp32:esp32");
+  watcher.consume(update.left(40));
+  QCOMPARE(changed.count(), 2);
+  watcher.consume(update.mid(40));
+  QCOMPARE(changed.count(), 3);
+  QCOMPARE(addresses(watcher), QStringList({"/dev/ttyUSB0", "/dev/ttyUSB1"}));
+  QCOMPARE(watcher.ports().at(1).boardFqbn, QStringLiteral("esp32:esp32:esp32"));
+
+  // Older CLIs: "event_type"/"type", inline port fields and "boards".
+  watcher.consume(R"({"type":"add","port":{"address":"192.168.1.20","protocol":"network",
+                   "protocol_label":"Network Port","boards":[{"name":"Nano 33 IoT",
+                   "fqbn":"arduino:samd:nano_33_iot"}]}})");
+  QCOMPARE(changed.count(), 4);
+  QCOMPARE(watcher.ports().last().protocol, QStringLiteral("network"));
+  QCOMPARE(watcher.ports().last().boardFqbn, QStringLiteral("arduino:samd:nano_33_iot"));
+  watcher.consume(R"({"event_type":"remove","port":{"port":{"address":"192.168.1.20",
+                   "protocol":"network"}}})");
+  QCOMPARE(changed.count(), 5);
+  QCOMPARE(addresses(watcher), QStringList({"/dev/ttyUSB0", "/dev/ttyUSB1"}));
+}
+
+void TestPortWatcher::parsesBoardListOfEachCliVersion() {
+  bool ok = false;
+  QVector<PortWatcher::Port> ports = PortWatcher::parsePortList(
+      R"({"detected_ports":[{"matching_boards":[{"name":"Arduino Uno","fqbn":"arduino:avr:uno"}],
+          "port":{"address":"/dev/ttyACM0","protocol":"serial"}},
+          {"port":{"address":"/dev/ttyS0","protocol":"serial"}}]})",
+      &ok);
+  QVERIFY(ok);
+  QCOMPARE(ports.size(), qsizetype(2));
+  QCOMPARE(ports.at(0).boardName, QStringLiteral("Arduino Uno"));
+  QCOMPARE(ports.at(1).address, QStringLiteral("/dev/ttyS0"));
+  QVERIFY(ports.at(1).boardFqbn.isEmpty());
+
+  ports = PortWatcher::parsePortList(
+      R"([{"port":{"address":"COM3"},"boards":[{"name":"Mega","fqbn":"arduino:avr:mega"}]}])", &ok);
+  QVERIFY(ok);
+  QCOMPARE(ports.size(), qsizetype(1));
+  QCOMPARE(ports.at(0).protocol, QStringLiteral("serial"));
+  QCOMPARE(ports.at(0).boardFqbn, QStringLiteral("arduino:avr:mega"));
+
+  // Valid but empty is not an error; garbage is.
+  QVERIFY(PortWatcher::parsePortList("{}", &ok).isEmpty());
+  QVERIFY(ok);
+  QVERIFY(PortWatcher::parsePortList("Error: no discovery", &ok).isEmpty());
+  QVERIFY(!ok);
+}
+
+void TestPortWatcher::replaysWatchStreamFromFakeCli() {
+  const QString argsLog = dir_.filePath("watch-args.log");
+  QByteArray body = QStringLiteral("echo \"$@\" > '%1'\n").arg(argsLog).toUtf8();
+  // The initial ports, a board plugged in, then unplugged.
+  body += "cat <<'EOF'\n" + addEvent("/dev/ttyS4", {}, {}) + "EOF\n";
+  body += "sleep 0.5\n";
+  body += "cat <<'EOF'\n" + addEvent("/dev/ttyACM0", "Arduino Uno", "arduino:avr:uno") + "EOF\n";
+  body += "sleep 0.5\n";
+  body += "cat <<'EOF'\n" + removeEvent("/dev/ttyACM0") + "EOF\n";
+  body += "sleep 0.5\n";
+  const QString script = writeFakeCli("fake-watch.sh", body);
+  QVERIFY(!script.isEmpty());
+
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script);
+  PortWatcher watcher(&cli);
+  watcher.setNativeSerialEnumeration(false);
+  QSignalSpy changed(&watcher, &PortWatcher::portsChanged);
+  QSignalSpy stopped(&watcher, &PortWatcher::watchStopped);
+
+  watcher.start();
+  QVERIFY(watcher.isRunning());
+  QTRY_COMPARE(addresses(watcher), QStringList({"/dev/ttyS4", "/dev/ttyACM0"}));
+  QCOMPARE(watcher.ports().last().boardFqbn, QStringLiteral("arduino:avr:uno"));
+  QTRY_COMPARE(addresses(watcher), QStringList({"/dev/ttyS4"}));
+  QTRY_COMPARE(stopped.count(), 1);
+  QVERIFY(!watcher.isRunning());
+  QCOMPARE(changed.count(), 3);
+
+  QFile log(argsLog);
+  QVERIFY(log.open(QIODevice::ReadOnly));
+  const QString args = QString::fromUtf8(log.readAll());
+  QVERIFY(args.contains(QStringLiteral("board list --watch --format json")));
+}
+
+void TestPortWatcher::quitEventStopsWatch() {
+  const QString script = writeFakeCli(
+      "fake-watch-quit.sh",
+      "echo '{\"eventType\":\"quit\",\"error\":\"discovery serial-discovery failed\"}'\n"
+      "exit 1\n");
+  QVERIFY(!script.isEmpty());
+
+  ArduinoCli cli;
+  cli.setArduinoCliPath(script);
+  PortWatcher watcher(&cli);
+  watcher.setNativeSerialEnumeration(false);
+  QSignalSpy changed(&watcher, &PortWatcher::portsChanged);
+  QSignalSpy stopped(&watcher, &PortWatcher::watchStopped);
+
+  watcher.start();
+  QTRY_COMPARE(stopped.count(), 1);
+  QCOMPARE(stopped.at(0).at(0).toString(), QStringLiteral("discovery serial-discovery failed"));
+  QCOMPARE(changed.count(), 0);
+  QVERIFY(!watcher.isRunning());
+}
+
+void TestPortWatcher::enumeratesUsbSerialFromSysfs() {
+#ifndef Q_OS_LINUX
+  QSKIP("sysfs enumeration is Linux only");
+#else
+  // A USB CDC port (ids two levels up from the tty) and a legacy UART.
+  const QDir root(dir_.filePath("sys"));
+  const QString usbDevice = root.filePath("devices/pci0000:00/usb1/1-1");
+  const QString usbInterface = usbDevice + "/1-1:1.0";
+  const QString uart = root.filePath("devices/platform/serial8250");
+  QVERIFY(QDir().mkpath(usbInterface + "/tty/ttyACM0"));
+  QVERIFY(QDir().mkpath(uart + "/tty/ttyS0"));
+  QVERIFY(QDir().mkpath(root.filePath("class/tty/console")));
+  for (const auto& [file, value] : {std::pair{QStringLiteral("idVendor"), "2341\n"},
+                                   std::pair{QStringLiteral("idProduct"), "0043\n"}}) {
+    QFile f(usbDevice + "/" + file);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.write(value);
+  }
+  QVERIFY(QFile::link(usbInterface, usbInterface + "/tty/ttyACM0/device"));
+  QVERIFY(QFile::link(uart, uart + "/tty/ttyS0/device"));
+  QVERIFY(QFile::link(usbInterface + "/tty/ttyACM0", root.filePath("class/tty/ttyACM0")));
+  QVERIFY(QFile::link(uart + "/tty/ttyS0", root.filePath("class/tty/ttyS0")));
+
+  const QVector<PortWatcher::Port> ports = PortWatcher::enumerateSerialPorts(root.path());
+  QCOMPARE(ports.size(), qsizetype(1));
+  QCOMPARE(ports.at(0).address, QStringLiteral("/dev/ttyACM0"));
+  QCOMPARE(ports.at(0).protocol, QStringLiteral("serial"));
+  QCOMPARE(ports.at(0).vid, QStringLiteral("0x2341"));
+  QCOMPARE(ports.at(0).pid, QStringLiteral("0x0043"));
+#endif
+}
+
+QTEST_MAIN(TestPortWatcher)
+
+#include "test_port_watcher.moc"
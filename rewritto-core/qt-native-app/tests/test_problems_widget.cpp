@@ -0,0 +1,159 @@
+#include <QtTest/QtTest>
+
+#include <QAbstractItemModelTester>
+#include <QAction>
+#include <QApplication>
+#include <QLabel>
+#include <QListView>
+#include <QSignalSpy>
+
+#include "problems_widget.h"
+
+class TestProblemsWidget final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void coalescesAddsIntoOneInsert();
+  void ordersBySourceAndFile();
+  void replacesAndClearsRanges();
+  void filtersSeveritiesInTheProxy();
+};
+
+static ProblemsModel::Diagnostic diag(const QString& file,
+                                      int line,
+                                      const QString& severity,
+                                      const QString& message = QStringLiteral("message")) {
+  ProblemsModel::Diagnostic d;
+  d.filePath = file;
+  d.line = line;
+  d.column = 1;
+  d.severity = severity;
+  d.message = message;
+  return d;
+}
+
+static QStringList displayed(const QAbstractItemModel* model) {
+  QStringList out;
+  for (int i = 0; i < model->rowCount(); ++i) {
+    out << model->index(i, 0).data().toString();
+  }
+  return out;
+}
+
+void TestProblemsWidget::coalescesAddsIntoOneInsert() {
+  ProblemsModel model;
+  QAbstractItemModelTester tester(&model);
+  QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+  QSignalSpy counts(&model, &ProblemsModel::countsChanged);
+
+  for (int i = 1; i <= 50; ++i) {
+    model.addDiagnostic("Compiler", diag("/s/a.ino", i, i % 5 ? "warning" : "error"));
+  }
+  QCOMPARE(model.rowCount(), 0);
+  QVERIFY(model.hasPending());
+
+  QTRY_COMPARE(model.rowCount(), 50);
+  QCOMPARE(inserted.count(), 1);
+  QCOMPARE(counts.count(), 1);
+  QCOMPARE(model.count(ProblemsModel::Severity::Error), 10);
+  QCOMPARE(model.count(ProblemsModel::Severity::Warning), 40);
+  QCOMPARE(model.index(0, 0).data().toString(),
+           QStringLiteral("[Compiler] /s/a.ino:1:1: warning: message"));
+  QCOMPARE(model.index(4, 0).data(ProblemsModel::LineRole).toInt(), 5);
+}
+
+void TestProblemsWidget::ordersBySourceAndFile() {
+  ProblemsModel model;
+  QAbstractItemModelTester tester(&model);
+  model.addDiagnostic("LSP", diag("/s/b.ino", 1, "error", "b1"));
+  model.addDiagnostic("Compiler", diag("/s/b.ino", 2, "error", "b2"));
+  model.addDiagnostic("Compiler", diag("/s/a.ino", 3, "error", "a3"));
+  model.flush();
+  model.addDiagnostic("Compiler", diag("/s/b.ino", 4, "error", "b4"));
+  model.addDiagnostic("Compiler", diag("/s/a.ino", 5, "error", "a5"));
+  model.flush();
+
+  QStringList messages;
+  for (int i = 0; i < model.rowCount(); ++i) {
+    messages << model.index(i, 0).data(ProblemsModel::MessageRole).toString();
+  }
+  QCOMPARE(messages, QStringList({"a3", "a5", "b2", "b4", "b1"}));
+}
+
+void TestProblemsWidget::replacesAndClearsRanges() {
+  ProblemsModel model;
+  QAbstractItemModelTester tester(&model);
+  model.setDiagnostics("LSP", "/s/a.ino", {diag("/s/a.ino", 1, "error"), diag("/s/a.ino", 2, "warning")});
+  model.setDiagnostics("LSP", "/s/b.ino", {diag("/s/b.ino", 1, "hint")});
+  model.addDiagnostic("Compiler", diag("/s/a.ino", 9, "error"));
+  QCOMPARE(model.rowCount(), 3);
+
+  // Replacing a file's diagnostics applies queued adds first and only
+  // touches that file's rows.
+  QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+  QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+  model.setDiagnostics("LSP", "/s/a.ino", {diag("/s/a.ino", 7, "info")});
+  QCOMPARE(model.rowCount(), 3);
+  QCOMPARE(removed.count(), 1);
+  QCOMPARE(reset.count(), 0);
+  QCOMPARE(model.count(ProblemsModel::Severity::Error), 1);
+  QCOMPARE(model.count(ProblemsModel::Severity::Warning), 0);
+  QCOMPARE(model.count(ProblemsModel::Severity::Info), 1);
+  QCOMPARE(model.count(ProblemsModel::Severity::Hint), 1);
+
+  model.clearSource("LSP");
+  QCOMPARE(model.rowCount(), 1);
+  QCOMPARE(model.index(0, 0).data(ProblemsModel::LineRole).toInt(), 9);
+  QCOMPARE(model.count(ProblemsModel::Severity::Info), 0);
+
+  model.addDiagnostic("Compiler", diag("/s/a.ino", 10, "error"));
+  model.clear();
+  QCOMPARE(model.rowCount(), 0);
+  QVERIFY(!model.hasPending());
+  QCOMPARE(model.count(ProblemsModel::Severity::Error), 0);
+}
+
+void TestProblemsWidget::filtersSeveritiesInTheProxy() {
+  ProblemsWidget w;
+  auto* list = w.findChild<QListView*>(QStringLiteral("ProblemsList"));
+  QVERIFY(list);
+  auto* summary = w.findChild<QLabel*>(QStringLiteral("ProblemsSummaryLabel"));
+  QVERIFY(summary);
+
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 1, "error"));
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 2, "warning"));
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 3, "warning"));
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 4, "note"));
+  QTRY_COMPARE(list->model()->rowCount(), 4);
+  QCOMPARE(summary->text(), QStringLiteral("E 1  W 2  I 1  H 0"));
+
+  QAction* showWarnings = nullptr;
+  for (QAction* action : w.findChildren<QAction*>()) {
+    if (action->text() == QStringLiteral("Show Warnings")) {
+      showWarnings = action;
+    }
+  }
+  QVERIFY(showWarnings);
+  showWarnings->setChecked(false);
+  QCOMPARE(list->model()->rowCount(), 2);
+  QCOMPARE(w.model()->rowCount(), 4);
+  QCOMPARE(summary->text(), QStringLiteral("E 1  W 2  I 1  H 0"));
+  QCOMPARE(summary->toolTip(), QStringLiteral("Showing: E 1  W 0  I 1  H 0"));
+
+  // Rows that arrive while filtered out stay hidden, then show up again.
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 5, "warning"));
+  w.addDiagnostic("Compiler", diag("/s/a.ino", 6, "error"));
+  QTRY_COMPARE(w.model()->rowCount(), 6);
+  QCOMPARE(list->model()->rowCount(), 3);
+  showWarnings->setChecked(true);
+  QCOMPARE(displayed(list->model()), displayed(w.model()));
+}
+
+int main(int argc, char** argv) {
+  qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+  TestProblemsWidget tc;
+  return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_problems_widget.moc"
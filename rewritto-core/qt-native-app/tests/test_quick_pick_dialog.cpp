@@ -5,6 +5,7 @@
 #include <QTableView>
 #include <QTemporaryDir>
 
+#include "fuzzy_matcher.h"
 #include "quick_pick_dialog.h"
 
 class TestQuickPickDialog final : public QObject {
@@ -12,8 +13,25 @@ class TestQuickPickDialog final : public QObject {
 
  private slots:
   void fuzzyFiltersBySubsequence();
+  void ranksBoundaryAndCamelCaseMatchesFirst();
+  void narrowingMatchesFullRescore();
+  void selectsDataOfRankedRow();
+  void benchmarkFuzzyRanking_data();
+  void benchmarkFuzzyRanking();
 };
 
+static QStringList rankedLabels(const QStringList& labels, const QString& query) {
+  FuzzyMatcher matcher;
+  for (const QString& label : labels) {
+    matcher.add(label);
+  }
+  QStringList out;
+  for (int id : matcher.rank(FuzzyMatcher::Pattern(query))) {
+    out << labels.at(id);
+  }
+  return out;
+}
+
 void TestQuickPickDialog::fuzzyFiltersBySubsequence() {
   QuickPickDialog dlg;
   dlg.resize(640, 480);
@@ -44,6 +62,140 @@ void TestQuickPickDialog::fuzzyFiltersBySubsequence() {
   QCOMPARE(table->model()->rowCount(), 2);
 }
 
+void TestQuickPickDialog::ranksBoundaryAndCamelCaseMatchesFirst() {
+  const QStringList labels = {"asmx", "Sort Lines Ascending", "Toggle Serial Monitor",
+                              "agsv_thing", "getSerialValue", "Upload Using Programmer",
+                              "upload"};
+
+  QStringList ranked = rankedLabels(labels, "sm");
+  QCOMPARE(ranked.first(), QStringLiteral("Toggle Serial Monitor"));
+  QVERIFY(ranked.indexOf("asmx") > 0);
+
+  ranked = rankedLabels(labels, "gsv");
+  QCOMPARE(ranked, QStringList({"getSerialValue", "agsv_thing"}));
+
+  // Equal scores keep the candidates' order.
+  ranked = rankedLabels(labels, "upload");
+  QCOMPARE(ranked, QStringList({"Upload Using Programmer", "upload"}));
+
+  // Every term has to match, in any order.
+  ranked = rankedLabels(labels, "monitor tog");
+  QCOMPARE(ranked, QStringList({"Toggle Serial Monitor"}));
+  QVERIFY(rankedLabels(labels, "xyz").isEmpty());
+
+  // Label matches beat matches that start in the detail.
+  FuzzyMatcher matcher;
+  matcher.add(u"Build", u"sketch/main.ino");
+  matcher.add(u"Main Menu");
+  QCOMPARE(matcher.rank(FuzzyMatcher::Pattern(u"main")), QVector<int>({1, 0}));
+  QCOMPARE(matcher.score(0, FuzzyMatcher::Pattern()), 0);
+}
+
+void TestQuickPickDialog::narrowingMatchesFullRescore() {
+  FuzzyMatcher matcher;
+  QStringList labels;
+  for (int i = 0; i < 500; ++i) {
+    const QString verb = i % 3 ? QStringLiteral("get") : QStringLiteral("set");
+    const QString noun = i % 7 ? QStringLiteral("Read") : QStringLiteral("Monitor");
+    labels << QStringLiteral("%1Serial%2_%3").arg(verb).arg(i).arg(noun);
+    matcher.add(labels.last(), QStringLiteral("src/file%1.cpp").arg(i % 11));
+  }
+
+  FuzzyMatcher::Pattern previous;
+  QVector<int> rows = matcher.rank(previous);
+  QCOMPARE(rows.size(), 500);
+  const QString query = QStringLiteral("gser mon f1");
+  for (qsizetype n = 1; n <= query.size(); ++n) {
+    const FuzzyMatcher::Pattern pattern(QStringView(query).left(n));
+    QVERIFY(n == 1 || pattern.narrows(previous));
+    rows = matcher.rank(pattern, pattern.narrows(previous) ? &rows : nullptr);
+    QCOMPARE(rows, matcher.rank(pattern));
+    previous = pattern;
+  }
+  QVERIFY(!rows.isEmpty());
+  QVERIFY(!FuzzyMatcher::Pattern(u"gsr").narrows(FuzzyMatcher::Pattern(u"gse")));
+  QVERIFY(!FuzzyMatcher::Pattern(u"gs").narrows(FuzzyMatcher::Pattern(u"gse")));
+}
+
+void TestQuickPickDialog::selectsDataOfRankedRow() {
+  QuickPickDialog dlg;
+  dlg.show();
+  dlg.setItems({{"&Verify", "Sketch", 1}, {"Serial Monitor", "Tools", 2}, {"Save", "File", 3}});
+
+  auto* edit = dlg.findChild<QLineEdit*>();
+  QVERIFY(edit);
+  auto* table = dlg.findChild<QTableView*>();
+  QVERIFY(table);
+
+  // Without a query, rows follow the name column; the mnemonic is gone.
+  QCOMPARE(table->model()->index(2, 0).data().toString(), QStringLiteral("Verify"));
+  QCOMPARE(dlg.selectedData().toInt(), 3);
+
+  edit->setText("sm");
+  QCoreApplication::processEvents();
+  QCOMPARE(table->model()->rowCount(), 1);
+  QCOMPARE(table->model()->index(0, 0).data().toString(), QStringLiteral("Serial Monitor"));
+  QCOMPARE(dlg.selectedData().toInt(), 2);
+}
+
+// Symbol-like names, as go-to-symbol lists them for a large core.
+static const FuzzyMatcher& benchmarkMatcher() {
+  static const FuzzyMatcher matcher = [] {
+    const QStringList verbs = {"get", "set", "read", "write", "begin", "end", "update",
+                               "handle", "init", "reset", "print", "parse"};
+    const QStringList nouns = {"Serial", "Wire", "Spi", "Buffer", "Timer", "Pin", "Port",
+                               "Clock", "Config", "Event", "Value", "Status", "Packet"};
+    constexpr int kItems = 50000;
+    FuzzyMatcher m;
+    for (int i = 0; i < kItems; ++i) {
+      const QString label = QStringLiteral("%1%2%3_%4")
+                                .arg(verbs.at(i % verbs.size()),
+                                     nouns.at((i / verbs.size()) % nouns.size()),
+                                     nouns.at((i / 7) % nouns.size()))
+                                .arg(i);
+      m.add(label, QStringLiteral("src/module%1/file%2.cpp").arg(i % 60).arg(i % 900));
+    }
+    return m;
+  }();
+  return matcher;
+}
+
+void TestQuickPickDialog::benchmarkFuzzyRanking_data() {
+  QTest::addColumn<QString>("query");
+  QTest::addColumn<bool>("narrowed");
+  // "g" matches about 14k of the 50k items, the worst single keystroke.
+  const QString query = QStringLiteral("getbufclk");
+  for (qsizetype n = 1; n <= query.size(); ++n) {
+    const QString prefix = query.left(n);
+    QTest::addRow("%s", qPrintable(prefix)) << prefix << false;
+    if (n > 1) {
+      QTest::addRow("%s narrowed", qPrintable(prefix)) << prefix << true;
+    }
+  }
+}
+
+void TestQuickPickDialog::benchmarkFuzzyRanking() {
+  QFETCH(QString, query);
+  QFETCH(bool, narrowed);
+
+  const FuzzyMatcher& matcher = benchmarkMatcher();
+  QCOMPARE(matcher.size(), 50000);
+  const FuzzyMatcher::Pattern pattern(query);
+  // Narrowing rescans only what the query matched one keystroke earlier.
+  const FuzzyMatcher::Pattern previous(QStringView(query).chopped(1));
+  const QVector<int> within = narrowed ? matcher.rank(previous) : QVector<int>{};
+  QVERIFY(!narrowed || pattern.narrows(previous));
+
+  QVector<int> rows;
+  QBENCHMARK {
+    rows = matcher.rank(pattern, narrowed ? &within : nullptr);
+  }
+  QVERIFY(!rows.isEmpty());
+  if (narrowed) {
+    QCOMPARE(rows, matcher.rank(pattern));
+  }
+}
+
 int main(int argc, char** argv) {
   qputenv("QT_QPA_PLATFORM", "offscreen");
 
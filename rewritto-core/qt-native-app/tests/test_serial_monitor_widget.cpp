@@ -3,13 +3,15 @@
 #include <QApplication>
 #include <QCheckBox>
 #include <QComboBox>
+#include <QLabel>
 #include <QLineEdit>
-#include <QPlainTextEdit>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QScrollBar>
 #include <QTemporaryDir>
 
+#include "serial_log_buffer.h"
+#include "serial_log_view.h"
 #include "serial_monitor_widget.h"
 
 class TestSerialMonitorWidget final : public QObject {
@@ -23,6 +25,11 @@ class TestSerialMonitorWidget final : public QObject {
   void emptySendEmitsLineEnding();
   void sendHistoryUpDownAndPersists();
   void filterShowsMatchingLinesAndRestoresFullOutput();
+  void droppedCounterShowsOnlyWhenNonZero();
+  void logBufferEvictsWholeChunks();
+  void lineBitmapMapsRowsToLines();
+  void largeLogFiltersInBackground();
+  void selectionStaysOnLinesAcrossEviction();
 };
 
 void TestSerialMonitorWidget::timestampsPrefixesLines() {
@@ -30,7 +37,7 @@ void TestSerialMonitorWidget::timestampsPrefixesLines() {
   w.resize(700, 320);
   w.show();
 
-  auto* output = w.findChild<QPlainTextEdit*>("serialMonitorOutput");
+  auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
   QVERIFY(output);
   auto* timestamps = w.findChild<QCheckBox*>("serialMonitorTimestamps");
   QVERIFY(timestamps);
@@ -55,7 +62,7 @@ void TestSerialMonitorWidget::carriageReturnOverwritesLine() {
     w.resize(700, 320);
     w.show();
 
-    auto* output = w.findChild<QPlainTextEdit*>("serialMonitorOutput");
+    auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
     QVERIFY(output);
     auto* timestamps = w.findChild<QCheckBox*>("serialMonitorTimestamps");
     QVERIFY(timestamps);
@@ -70,7 +77,7 @@ void TestSerialMonitorWidget::carriageReturnOverwritesLine() {
     w.resize(700, 320);
     w.show();
 
-    auto* output = w.findChild<QPlainTextEdit*>("serialMonitorOutput");
+    auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
     QVERIFY(output);
     auto* timestamps = w.findChild<QCheckBox*>("serialMonitorTimestamps");
     QVERIFY(timestamps);
@@ -86,7 +93,7 @@ void TestSerialMonitorWidget::autoscrollToggle() {
   w.resize(700, 200);
   w.show();
 
-  auto* output = w.findChild<QPlainTextEdit*>("serialMonitorOutput");
+  auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
   QVERIFY(output);
   auto* autoscroll = w.findChild<QCheckBox*>("serialMonitorAutoscroll");
   QVERIFY(autoscroll);
@@ -220,7 +227,7 @@ void TestSerialMonitorWidget::filterShowsMatchingLinesAndRestoresFullOutput() {
   w.resize(700, 320);
   w.show();
 
-  auto* output = w.findChild<QPlainTextEdit*>("serialMonitorOutput");
+  auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
   QVERIFY(output);
   auto* filter = w.findChild<QLineEdit*>("serialMonitorFilter");
   QVERIFY(filter);
@@ -238,6 +245,157 @@ void TestSerialMonitorWidget::filterShowsMatchingLinesAndRestoresFullOutput() {
   QCOMPARE(output->toPlainText(), QString("alpha\nbeta\ngamma\nbeacon\nzeta\n"));
 }
 
+void TestSerialMonitorWidget::droppedCounterShowsOnlyWhenNonZero() {
+  SerialMonitorWidget w;
+  w.resize(700, 260);
+  w.show();
+
+  auto* dropped = w.findChild<QLabel*>("serialMonitorDropped");
+  QVERIFY(dropped);
+  QVERIFY(!dropped->isVisible());
+
+  w.setDroppedBytes(4096);
+  QVERIFY(dropped->isVisible());
+  QVERIFY(dropped->text().startsWith(QStringLiteral("Dropped:")));
+
+  w.setDroppedBytes(0);
+  QVERIFY(!dropped->isVisible());
+}
+
+void TestSerialMonitorWidget::logBufferEvictsWholeChunks() {
+  SerialLogBuffer log;
+  log.setMaxChars(3 * SerialLogBuffer::kChunkChars);
+  const QString line(100, QLatin1Char('x'));
+  for (int i = 0; i < 10000; ++i) {
+    log.appendLine(QString::number(i) + line);
+  }
+  QCOMPARE(log.endLine(), qint64(10000));
+  QVERIFY(log.beginLine() > 0);
+  QVERIFY(log.charCount() <= 3 * SerialLogBuffer::kChunkChars);
+  QVERIFY(log.line(log.beginLine()).startsWith(QString::number(log.beginLine())));
+  QVERIFY(log.line(9999).startsWith(QStringLiteral("9999x")));
+
+  // Every sealed chunk starts where the previous one ended.
+  const SerialLogBuffer::ChunkList chunks = log.sealedChunks();
+  QVERIFY(!chunks.isEmpty());
+  QCOMPARE(chunks.first()->firstLine, log.beginLine());
+  for (int i = 1; i < chunks.size(); ++i) {
+    QCOMPARE(chunks.at(i)->firstLine,
+             chunks.at(i - 1)->firstLine + chunks.at(i - 1)->lineCount());
+  }
+
+  log.clear();
+  QCOMPARE(log.lineCount(), qint64(0));
+  QCOMPARE(log.beginLine(), qint64(10000));
+}
+
+void TestSerialMonitorWidget::lineBitmapMapsRowsToLines() {
+  SerialLineBitmap bitmap;
+  bitmap.reset(100);
+  QVector<qint64> expected;
+  for (qint64 line = 100; line < 5100; ++line) {
+    const bool set = (line % 7 == 0) || (line % 11 == 0);
+    bitmap.append(set);
+    if (set) {
+      expected.push_back(line);
+    }
+  }
+  QCOMPARE(bitmap.rank(bitmap.endLine()), qint64(expected.size()));
+  for (qsizetype i = 0; i < expected.size(); ++i) {
+    QCOMPARE(bitmap.select(i), expected.at(i));
+    QCOMPARE(bitmap.rank(expected.at(i)), qint64(i));
+  }
+  QCOMPARE(bitmap.select(expected.size()), qint64(-1));
+
+  bitmap.dropBefore(2000);
+  QVERIFY(bitmap.baseLine() <= 2000);
+  const qint64 firstKept = bitmap.rank(2000);
+  QCOMPARE(bitmap.select(firstKept), qint64(2002));  // 2002 = 7 * 286
+}
+
+void TestSerialMonitorWidget::largeLogFiltersInBackground() {
+  SerialMonitorWidget w;
+  w.resize(700, 320);
+  w.show();
+
+  auto* output = w.findChild<SerialLogView*>("serialMonitorOutput");
+  QVERIFY(output);
+  auto* filter = w.findChild<QLineEdit*>("serialMonitorFilter");
+  QVERIFY(filter);
+
+  constexpr int kLines = 100000;
+  QByteArray data;
+  for (int i = 0; i < kLines; ++i) {
+    data += (i % 1000 == 0) ? "marker " : "reading ";
+    data += QByteArray::number(i);
+    data += '\n';
+  }
+  w.appendData(data);
+  QCOMPARE(output->rowCount(), qint64(kLines + 1));
+
+  QSignalSpy finished(output, &SerialLogView::filterFinished);
+  filter->setText("MARKER");
+  QVERIFY(output->isFilterPending());
+  // Lines that arrive while the worker scans are matched as they come in.
+  w.appendData("marker late\nnoise\n");
+  QTRY_VERIFY(!output->isFilterPending());
+  QCOMPARE(finished.count(), 1);
+  QCOMPARE(output->rowCount(), qint64(kLines / 1000 + 1));
+  QCOMPARE(output->rowText(0), QString("marker 0"));
+  QCOMPARE(output->rowText(1), QString("marker 1000"));
+  QCOMPARE(output->rowText(kLines / 1000), QString("marker late"));
+
+  // A new filter cancels the running scan and only its result counts.
+  filter->setText("reading 9999");
+  filter->setText("reading 99999");
+  QTRY_VERIFY(!output->isFilterPending());
+  QCOMPARE(output->rowCount(), qint64(1));
+  QCOMPARE(output->rowText(0), QString("reading 99999"));
+
+  filter->clear();
+  QCOMPARE(output->rowCount(), qint64(kLines + 3));
+}
+
+void TestSerialMonitorWidget::selectionStaysOnLinesAcrossEviction() {
+  SerialLogView view;
+  view.resize(400, 200);
+  view.show();
+  SerialLogBuffer* log = view.log();
+  const QString line(100, QLatin1Char('x'));
+  for (int i = 0; i < 3000; ++i) {
+    log->appendLine(QString::number(i) + line);
+  }
+  view.linesAppended(QString());
+
+  // Rows shift when old lines are evicted; the selection keeps its lines
+  // and loses only the evicted ones.
+  QTest::keySequence(&view, QKeySequence::SelectAll);
+  log->setMaxChars(3 * SerialLogBuffer::kChunkChars);
+  view.linesAppended(QString());
+  QVERIFY(log->beginLine() > 0);
+  const QStringList selected = view.selectedText().split(QLatin1Char('\n'));
+  QCOMPARE(qint64(selected.size()), 3000 - log->beginLine() + 1);
+  QCOMPARE(selected.first(), log->line(log->beginLine()).toString());
+  QCOMPARE(selected.at(selected.size() - 2), QString::number(2999) + line);
+
+  view.verticalScrollBar()->setValue(0);
+  QTest::mouseClick(view.viewport(), Qt::LeftButton, Qt::NoModifier, QPoint(10, 1));
+  const qint64 firstLine = log->beginLine();
+  const QString first = log->line(firstLine).toString();
+  QCOMPARE(view.selectedText(), first);
+  log->appendLine(QStringLiteral("next"));
+  view.linesAppended(QString());
+  QCOMPARE(view.selectedText(), first);
+
+  // A selection of only evicted lines is dropped.
+  for (int i = 0; i < 1000; ++i) {
+    log->appendLine(line);
+  }
+  view.linesAppended(QString());
+  QVERIFY(log->beginLine() > firstLine);
+  QVERIFY(view.selectedText().isEmpty());
+}
+
 int main(int argc, char** argv) {
   qputenv("QT_QPA_PLATFORM", "offscreen");
 
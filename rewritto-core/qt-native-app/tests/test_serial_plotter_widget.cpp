@@ -2,9 +2,15 @@
 
 #include <QApplication>
 #include <QCheckBox>
+#include <QComboBox>
+#include <QImage>
+#include <QRandomGenerator>
 #include <QTemporaryDir>
 #include <QTreeWidget>
 
+#include <cmath>
+
+#include "serial_plot_buffer.h"
 #include "serial_plotter_widget.h"
 
 class TestSerialPlotterWidget final : public QObject {
@@ -13,6 +19,10 @@ class TestSerialPlotterWidget final : public QObject {
  private slots:
   void autoReconnectPersists();
   void legendPopulatesFromData();
+  void seriesBufferEvictsAndAnswersRanges();
+  void retentionPersists();
+  void benchmarkIngest();
+  void benchmarkFrameTime();
 };
 
 void TestSerialPlotterWidget::autoReconnectPersists() {
@@ -56,6 +66,138 @@ void TestSerialPlotterWidget::legendPopulatesFromData() {
   QCOMPARE(legend->topLevelItem(0)->checkState(0), Qt::Unchecked);
 }
 
+void TestSerialPlotterWidget::seriesBufferEvictsAndAnswersRanges() {
+  SerialPlotSeriesBuffer empty(100, 7);
+  QCOMPARE(empty.beginIndex(), qint64(7));
+  QCOMPARE(empty.endIndex(), qint64(7));
+  QVERIFY(!empty.minMax(0, 100).hasValue);
+  QVERIFY(std::isnan(empty.valueAt(7)));
+
+  constexpr int kCapacity = 1000;
+  constexpr int kPushed = 5000;
+  SerialPlotSeriesBuffer buffer(kCapacity);
+  QVector<double> all;
+  QRandomGenerator rng(7);
+  for (int i = 0; i < kPushed; ++i) {
+    const double v = (i % 97 == 0) ? std::nan("") : rng.bounded(2000.0) - 1000.0;
+    all.push_back(v);
+    buffer.push(v);
+  }
+  QCOMPARE(buffer.size(), kCapacity);
+  QCOMPARE(buffer.beginIndex(), qint64(kPushed - kCapacity));
+  QCOMPARE(buffer.endIndex(), qint64(kPushed));
+  QVERIFY(std::isnan(buffer.valueAt(kPushed - kCapacity - 1)));
+  QCOMPARE(buffer.valueAt(kPushed - 1), all.last());
+
+  for (int q = 0; q < 500; ++q) {
+    const qint64 a = rng.bounded(kPushed + 10) - 5;
+    const qint64 b = a + rng.bounded(kCapacity + 10);
+    bool has = false;
+    double lo = 0.0;
+    double hi = 0.0;
+    for (qint64 i = std::max<qint64>(a, kPushed - kCapacity);
+         i < std::min<qint64>(b, kPushed); ++i) {
+      const double v = all.at(static_cast<int>(i));
+      if (std::isnan(v)) {
+        continue;
+      }
+      lo = has ? std::min(lo, v) : v;
+      hi = has ? std::max(hi, v) : v;
+      has = true;
+    }
+    const SerialPlotSeriesBuffer::MinMax mm = buffer.minMax(a, b);
+    QCOMPARE(mm.hasValue, has);
+    if (has) {
+      QCOMPARE(mm.min, lo);
+      QCOMPARE(mm.max, hi);
+    }
+  }
+
+  const SerialPlotSeriesBuffer shrunk = buffer.withCapacity(100);
+  QCOMPARE(shrunk.beginIndex(), qint64(kPushed - 100));
+  QCOMPARE(shrunk.endIndex(), qint64(kPushed));
+  for (qint64 i = shrunk.beginIndex(); i < shrunk.endIndex(); ++i) {
+    const double v = all.at(static_cast<int>(i));
+    QVERIFY(std::isnan(v) ? std::isnan(shrunk.valueAt(i)) : shrunk.valueAt(i) == v);
+  }
+}
+
+void TestSerialPlotterWidget::retentionPersists() {
+  {
+    SerialPlotterWidget w;
+    QCOMPARE(w.retentionSamples(), SerialPlotterWidget::kDefaultRetentionSamples);
+    auto* combo = w.findChild<QComboBox*>("serialPlotterRetention");
+    QVERIFY(combo);
+    combo->setCurrentIndex(combo->findData(10000));
+    QCOMPARE(w.retentionSamples(), 10000);
+  }
+  {
+    SerialPlotterWidget w;
+    QCOMPARE(w.retentionSamples(), 10000);
+    w.setRetentionSamples(5000);  // snaps to the next preset
+    QCOMPARE(w.retentionSamples(), 10000);
+    w.setRetentionSamples(SerialPlotterWidget::kDefaultRetentionSamples);
+  }
+}
+
+namespace {
+constexpr int kBenchmarkSamples = 1000000;
+
+// Two series, as a sketch printing "sin:<v>,saw:<v>" lines would send them.
+QByteArray plotStream(int samples) {
+  QByteArray stream;
+  stream.reserve(samples * 24);
+  for (int i = 0; i < samples; ++i) {
+    stream += "sin:";
+    stream += QByteArray::number(std::sin(i * 0.001) * 100.0, 'f', 3);
+    stream += ",saw:";
+    stream += QByteArray::number(i % 1000);
+    stream += '\n';
+  }
+  return stream;
+}
+
+void appendInChunks(SerialPlotterWidget* w, const QByteArray& stream) {
+  constexpr qsizetype kChunk = 64 * 1024;
+  for (qsizetype pos = 0; pos < stream.size(); pos += kChunk) {
+    w->appendData(stream.mid(pos, kChunk));
+  }
+}
+}  // namespace
+
+void TestSerialPlotterWidget::benchmarkIngest() {
+  SerialPlotterWidget w;
+  w.resize(1200, 400);
+  w.show();
+  w.setRetentionSamples(kBenchmarkSamples);
+  QCOMPARE(w.retentionSamples(), kBenchmarkSamples);
+
+  // Once the window is full, every iteration also evicts as many samples.
+  const QByteArray stream = plotStream(kBenchmarkSamples);
+  QBENCHMARK {
+    appendInChunks(&w, stream);
+  }
+
+  w.setRetentionSamples(SerialPlotterWidget::kDefaultRetentionSamples);
+}
+
+void TestSerialPlotterWidget::benchmarkFrameTime() {
+  SerialPlotterWidget w;
+  w.resize(1200, 400);
+  w.show();
+  w.setRetentionSamples(kBenchmarkSamples);
+  appendInChunks(&w, plotStream(kBenchmarkSamples));
+
+  auto* plot = w.findChild<QWidget*>("serialPlotterPlot");
+  QVERIFY(plot);
+  QImage frame(plot->size(), QImage::Format_ARGB32_Premultiplied);
+  QBENCHMARK {
+    plot->render(&frame);
+  }
+
+  w.setRetentionSamples(SerialPlotterWidget::kDefaultRetentionSamples);
+}
+
 int main(int argc, char** argv) {
   qputenv("QT_QPA_PLATFORM", "offscreen");
 
@@ -1,7 +1,22 @@
 #include <QtTest/QtTest>
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QScopeGuard>
+#include <QThread>
 
+#include <algorithm>
+#include <atomic>
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "serial_byte_ring.h"
 #include "serial_port.h"
 
 class TestSerialPort final : public QObject {
@@ -9,8 +24,15 @@ class TestSerialPort final : public QObject {
 
  private slots:
   void openInvalidPathEmitsError();
+  void byteRingWrapsAndReportsOverflow();
+  void ptySustainsTwoMegabaud();
 };
 
+namespace {
+// 2 Mbaud with 8N1 framing.
+constexpr qsizetype kTwoMegabaudBytesPerSecond = 200000;
+}  // namespace
+
 void TestSerialPort::openInvalidPathEmitsError() {
   SerialPort port;
   QSignalSpy errorSpy(&port, &SerialPort::errorOccurred);
@@ -27,6 +49,103 @@ void TestSerialPort::openInvalidPathEmitsError() {
   QVERIFY(errorSpy.count() > 0);
 }
 
+void TestSerialPort::byteRingWrapsAndReportsOverflow() {
+  SerialByteRing ring(10);
+  QCOMPARE(ring.capacity(), qsizetype(16));
+  QVERIFY(ring.readAll().isEmpty());
+
+  QCOMPARE(ring.write("abcdefghijkl", 12), qsizetype(12));
+  QCOMPARE(ring.readAll(), QByteArray("abcdefghijkl"));
+
+  // Wraps around the end of the storage, then fills up.
+  QCOMPARE(ring.write("0123456789", 10), qsizetype(10));
+  QCOMPARE(ring.write("ABCDEFGHIJ", 10), qsizetype(6));
+  QCOMPARE(ring.size(), qsizetype(16));
+  QCOMPARE(ring.write("x", 1), qsizetype(0));
+  QCOMPARE(ring.readAll(), QByteArray("0123456789ABCDEF"));
+  QCOMPARE(ring.size(), qsizetype(0));
+}
+
+void TestSerialPort::ptySustainsTwoMegabaud() {
+#if !defined(Q_OS_UNIX)
+  QSKIP("Needs a pseudo-terminal pair.");
+#else
+  const int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0) {
+    QSKIP("No pseudo-terminals available.");
+  }
+  auto closeMaster = qScopeGuard([master] { ::close(master); });
+  QVERIFY(::grantpt(master) == 0);
+  QVERIFY(::unlockpt(master) == 0);
+  ::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK);
+  const QString slavePath = QString::fromLocal8Bit(::ptsname(master));
+
+#if defined(B2000000)
+  constexpr int kBaud = 2000000;
+#else
+  constexpr int kBaud = 230400;  // a pty ignores the rate anyway
+#endif
+  SerialPort port;
+  QByteArray received;
+  int deliveries = 0;
+  QObject::connect(&port, &SerialPort::dataReceived, &port,
+                   [&received, &deliveries](const QByteArray& data) {
+                     received += data;
+                     ++deliveries;
+                   });
+  QVERIFY(port.openPort(slavePath, kBaud));
+
+  // One second of traffic, paced like a device would send it.
+  QByteArray payload;
+  for (int line = 0; payload.size() < kTwoMegabaudBytesPerSecond; ++line) {
+    payload += "sample " + QByteArray::number(line) + ": " + QByteArray(40, 'x') + "\r\n";
+  }
+  std::atomic_bool stopWriter{false};
+  QThread* writer = QThread::create([master, payload, &stopWriter] {
+    constexpr qsizetype kChunk = 2000;  // 10 ms at 2 Mbaud
+    QElapsedTimer clock;
+    clock.start();
+    qsizetype sent = 0;
+    while (sent < payload.size() && !stopWriter.load()) {
+      const qint64 dueMs = sent * 1000 / kTwoMegabaudBytesPerSecond;
+      if (clock.elapsed() < dueMs) {
+        QThread::msleep(static_cast<unsigned long>(dueMs - clock.elapsed()));
+      }
+      const ssize_t n = ::write(master, payload.constData() + sent,
+                                static_cast<size_t>(std::min(kChunk, payload.size() - sent)));
+      if (n > 0) {
+        sent += n;
+      } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        QThread::msleep(1);
+      } else {
+        return;
+      }
+    }
+  });
+  auto stopWriting = qScopeGuard([&stopWriter, writer] {
+    stopWriter.store(true);
+    writer->wait();
+    delete writer;
+  });
+
+  QElapsedTimer timer;
+  timer.start();
+  writer->start();
+  QTRY_COMPARE_WITH_TIMEOUT(received.size(), payload.size(), 15000);
+  const qint64 elapsedMs = timer.elapsed();
+
+  QCOMPARE(received, payload);
+  QCOMPARE(port.droppedBytes(), qint64(0));
+  // Coalesced to at most one chunk per delivery interval, however many reads
+  // the reader thread needed.
+  QVERIFY2(deliveries <= elapsedMs / SerialPort::kDeliveryIntervalMs + 2,
+           qPrintable(QString("%1 deliveries in %2 ms").arg(deliveries).arg(elapsedMs)));
+
+  port.closePort();
+  QVERIFY(!port.isOpen());
+#endif
+}
+
 int main(int argc, char** argv) {
   QCoreApplication app(argc, argv);
   TestSerialPort tc;
@@ -0,0 +1,162 @@
+#include <QtTest/QtTest>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "sketch_signature.h"
+
+namespace {
+
+bool writeFile(const QString& path, const QByteArray& data) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile f(path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+  return f.write(data) == data.size();
+}
+
+bool setModified(const QString& path, const QDateTime& when) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadWrite)) {
+    return false;
+  }
+  return f.setFileTime(when, QFileDevice::FileModificationTime);
+}
+
+}  // namespace
+
+class TestSketchSignature final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void matchesFullScanAndIgnoresHidden();
+  void detectsCopyThatKeepsSizeAndMtime();
+  void watcherPicksUpAddedAndRemovedFiles();
+  void revisionMovesWithChangesDuringScan();
+};
+
+void TestSketchSignature::matchesFullScanAndIgnoresHidden() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = dir.filePath("Blink");
+  QVERIFY(writeFile(sketch + "/Blink.ino", "void setup() {}\nvoid loop() {}\n"));
+  QVERIFY(writeFile(sketch + "/src/util.h", "#pragma once\n"));
+  QVERIFY(writeFile(sketch + "/.vscode/settings.json", "{}\n"));
+
+  SketchSignatureTracker tracker;
+  QSignalSpy changed(&tracker, &SketchSignatureTracker::signatureChanged);
+  tracker.setSketchFolder(sketch);
+  QVERIFY(!tracker.isReady());
+  QVERIFY(tracker.signature().isEmpty());
+  QTRY_VERIFY(tracker.isReady());
+  QCOMPARE(changed.count(), 1);
+
+  const QString full = SketchSignatureTracker::computeSignature(sketch);
+  QVERIFY(!full.isEmpty());
+  QCOMPARE(tracker.signature(), full);
+
+  // Hidden files and folders are not part of the sketch.
+  QVERIFY(writeFile(sketch + "/.vscode/settings.json", "{\"a\": 1}\n"));
+  tracker.markChanged(sketch + "/.vscode/settings.json");
+  QCOMPARE(tracker.signature(), full);
+  QCOMPARE(SketchSignatureTracker::computeSignature(sketch), full);
+
+  QVERIFY(SketchSignatureTracker::computeSignature(dir.filePath("missing")).isEmpty());
+}
+
+void TestSketchSignature::detectsCopyThatKeepsSizeAndMtime() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = dir.filePath("Blink");
+  const QString ino = sketch + "/Blink.ino";
+  QVERIFY(writeFile(ino, "int led = 13;\n"));
+  const QDateTime mtime = QFileInfo(ino).lastModified();
+
+  SketchSignatureTracker tracker;
+  tracker.setSketchFolder(sketch);
+  QTRY_VERIFY(tracker.isReady());
+  const QString before = tracker.signature();
+
+  // Same size, same mtime, different bytes: what `cp -p` of another
+  // revision leaves behind.
+  QVERIFY(writeFile(ino, "int led = 12;\n"));
+  QVERIFY(setModified(ino, mtime));
+  QCOMPARE(QFileInfo(ino).size(), qint64(14));
+  QCOMPARE(QFileInfo(ino).lastModified(), mtime);
+  tracker.markChanged(ino);
+  const QString after = tracker.signature();
+  QVERIFY(after != before);
+  QCOMPARE(after, SketchSignatureTracker::computeSignature(sketch));
+
+  // Content, not history: putting the bytes back restores the signature.
+  QVERIFY(writeFile(ino, "int led = 13;\n"));
+  tracker.markChanged(ino);
+  QCOMPARE(tracker.signature(), before);
+}
+
+void TestSketchSignature::watcherPicksUpAddedAndRemovedFiles() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = dir.filePath("Blink");
+  QVERIFY(writeFile(sketch + "/Blink.ino", "void setup() {}\n"));
+
+  SketchSignatureTracker tracker;
+  tracker.setSketchFolder(sketch);
+  QTRY_VERIFY(tracker.isReady());
+  const QString before = tracker.signature();
+  QSignalSpy changed(&tracker, &SketchSignatureTracker::signatureChanged);
+
+  // No markChanged(): only the watcher knows about these.
+  QVERIFY(writeFile(sketch + "/src/extra/table.h", "const int kTable[] = {1};\n"));
+  QTRY_COMPARE(tracker.signature(), SketchSignatureTracker::computeSignature(sketch));
+  QVERIFY(tracker.signature() != before);
+  QTRY_VERIFY(changed.count() > 0);
+
+  QVERIFY(QDir(sketch + "/src").removeRecursively());
+  QTRY_COMPARE(tracker.signature(), before);
+
+  tracker.setSketchFolder({});
+  QVERIFY(!tracker.isReady());
+  QVERIFY(tracker.signature().isEmpty());
+}
+
+void TestSketchSignature::revisionMovesWithChangesDuringScan() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString sketch = dir.filePath("Blink");
+  const QString ino = sketch + "/Blink.ino";
+  QVERIFY(writeFile(ino, "int led = 13;\n"));
+
+  // A compile starts while the first scan runs and takes the revision.
+  SketchSignatureTracker tracker;
+  tracker.setSketchFolder(sketch);
+  const quint64 atCompile = tracker.revision();
+  QVERIFY(!tracker.isReady());
+
+  // A save before the scan is done moves it, so the signature the scan
+  // ends with cannot be credited to that compile.
+  QVERIFY(writeFile(ino, "int led = 12;\n"));
+  tracker.markChanged(ino);
+  QVERIFY(tracker.revision() != atCompile);
+  QTRY_VERIFY(tracker.isReady());
+
+  // Settled: reading the signature again does not move it.
+  const quint64 settled = tracker.revision();
+  QCOMPARE(tracker.signature(), SketchSignatureTracker::computeSignature(sketch));
+  QCOMPARE(tracker.revision(), settled);
+
+  // A mark moves it once; re-hashing unchanged content adds nothing.
+  tracker.markChanged(ino);
+  const quint64 marked = tracker.revision();
+  QCOMPARE(marked, settled + 1);
+  QCOMPARE(tracker.revision(), marked);
+}
+
+QTEST_MAIN(TestSketchSignature)
+
+#include "test_sketch_signature.moc"
@@ -0,0 +1,185 @@
+#include <QtTest/QtTest>
+
+#include <QCoreApplication>
+#include <QRandomGenerator>
+
+#include "text_diff.h"
+
+class TestTextDiff final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void identicalTextHasNoHunks();
+  void reportsInsertionsAndDeletions();
+  void reportsIntraLineRanges();
+  void foldsLineEndings();
+  void largeFilesGetRealHunks();
+  void capsIntraLineWorkPerHunk();
+  void benchmarkLargeFiles_data();
+  void benchmarkLargeFiles();
+};
+
+namespace {
+QString numberedLines(int count) {
+  QStringList lines;
+  lines.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    lines << QStringLiteral("  value_%1 = compute(%1);").arg(i);
+  }
+  return lines.join(QLatin1Char('\n'));
+}
+}  // namespace
+
+void TestTextDiff::identicalTextHasNoHunks() {
+  const QString text = QStringLiteral("void setup() {}\nvoid loop() {}\n");
+  const TextDiff::Result diff = TextDiff::compute(text, text);
+  QVERIFY(diff.hunks.isEmpty());
+  QVERIFY(diff.leftChanged.isEmpty());
+  QVERIFY(diff.rightChanged.isEmpty());
+
+  QVERIFY(TextDiff::compute({}, {}).hunks.isEmpty());
+}
+
+void TestTextDiff::reportsInsertionsAndDeletions() {
+  const QStringList left = {"a", "b", "c", "d", "e"};
+  const QStringList right = {"a", "c", "d", "x", "y", "e"};
+  const QVector<TextDiff::Hunk> hunks = TextDiff::diffLines(left, right);
+  QCOMPARE(hunks.size(), 2);
+  QCOMPARE(hunks.at(0).leftStart, 1);
+  QCOMPARE(hunks.at(0).leftCount, 1);
+  QCOMPARE(hunks.at(0).rightStart, 1);
+  QCOMPARE(hunks.at(0).rightCount, 0);
+  QCOMPARE(hunks.at(1).leftStart, 4);
+  QCOMPARE(hunks.at(1).leftCount, 0);
+  QCOMPARE(hunks.at(1).rightStart, 3);
+  QCOMPARE(hunks.at(1).rightCount, 2);
+
+  const TextDiff::Result diff =
+      TextDiff::compute(left.join('\n'), right.join('\n'));
+  QCOMPARE(diff.leftChanged, QVector<int>({1}));
+  QCOMPARE(diff.rightChanged, QVector<int>({3, 4}));
+  QVERIFY(diff.leftCharRanges.isEmpty());
+  QVERIFY(diff.rightCharRanges.isEmpty());
+}
+
+void TestTextDiff::reportsIntraLineRanges() {
+  const QString left = QStringLiteral("void loop() {\n  delay(100);\n}\n");
+  const QString right = QStringLiteral("void loop() {\n  delay(250);\n}\n");
+  const TextDiff::Result diff = TextDiff::compute(left, right);
+  QCOMPARE(diff.leftChanged, QVector<int>({1}));
+  QCOMPARE(diff.rightChanged, QVector<int>({1}));
+
+  // "100" -> "250": only the differing digits are marked; the shared "0" is not.
+  QCOMPARE(diff.leftCharRanges.size(), 1);
+  QCOMPARE(diff.leftCharRanges.at(0).line, 1);
+  QCOMPARE(diff.leftCharRanges.at(0).start, 8);
+  QCOMPARE(diff.leftCharRanges.at(0).length, 2);
+  QCOMPARE(diff.rightCharRanges.size(), 1);
+  QCOMPARE(diff.rightCharRanges.at(0).start, 8);
+  QCOMPARE(diff.rightCharRanges.at(0).length, 2);
+
+  // Completely rewritten lines are left to the line highlight.
+  const TextDiff::Result rewritten =
+      TextDiff::compute(QStringLiteral("abc"), QStringLiteral("xyz"));
+  QCOMPARE(rewritten.leftChanged, QVector<int>({0}));
+  QVERIFY(rewritten.leftCharRanges.isEmpty());
+}
+
+void TestTextDiff::foldsLineEndings() {
+  const TextDiff::Result diff = TextDiff::compute(QStringLiteral("a\r\nb\r\nc"),
+                                                  QStringLiteral("a\nb\nc"));
+  QVERIFY(diff.hunks.isEmpty());
+  QCOMPARE(TextDiff::splitLines(QStringLiteral("a\r\n\rb")).size(), 3);
+}
+
+void TestTextDiff::largeFilesGetRealHunks() {
+  // 3k lines used to exceed the LCS table limit and mark everything changed.
+  const QString left = numberedLines(3000);
+  QStringList rightLines = TextDiff::splitLines(left);
+  rightLines[1500] = QStringLiteral("  value_1500 = compute(1501);");
+  rightLines.insert(2000, QStringLiteral("  // inserted"));
+  const TextDiff::Result diff = TextDiff::compute(left, rightLines.join('\n'));
+
+  QCOMPARE(diff.hunks.size(), 2);
+  QCOMPARE(diff.leftChanged, QVector<int>({1500}));
+  QCOMPARE(diff.rightChanged, QVector<int>({1500, 2000}));
+  QCOMPARE(diff.leftCharRanges.size(), 1);
+}
+
+void TestTextDiff::capsIntraLineWorkPerHunk() {
+  // A rewritten block of long lines: every pair shares plenty of letters
+  // but no structure, the worst case for the character diff.
+  QRandomGenerator rng(7);
+  auto randomLine = [&rng] {
+    QString line;
+    for (int i = 0; i < TextDiff::kMaxIntraLineChars; ++i) {
+      line += QChar(u'a' + static_cast<char16_t>(rng.bounded(26)));
+    }
+    return line;
+  };
+  QStringList left;
+  QStringList right;
+  for (int i = 0; i < 100; ++i) {
+    left << randomLine();
+    right << randomLine();
+  }
+  // A separate hunk with a one-character edit has a budget of its own.
+  left << QStringLiteral("}") << QStringLiteral("  delay(100);");
+  right << QStringLiteral("}") << QStringLiteral("  delay(250);");
+
+  const TextDiff::Result diff = TextDiff::compute(left.join('\n'), right.join('\n'));
+  QCOMPARE(diff.hunks.size(), 2);
+  QCOMPARE(diff.leftChanged.size(), 101);
+  // The rewritten lines stay whole-line changes.
+  QCOMPARE(diff.leftCharRanges.size(), 1);
+  QCOMPARE(diff.leftCharRanges.at(0).line, 101);
+  QCOMPARE(diff.rightCharRanges.size(), 1);
+  QCOMPARE(diff.rightCharRanges.at(0).line, 101);
+}
+
+void TestTextDiff::benchmarkLargeFiles_data() {
+  constexpr int kLines = 100000;
+  const QString left = numberedLines(kLines);
+  QStringList rightLines = TextDiff::splitLines(left);
+  QRandomGenerator rng(42);
+  for (int i = 0; i < 200; ++i) {
+    const int line = static_cast<int>(rng.bounded(rightLines.size()));
+    rightLines[line] += QStringLiteral(" // edited");
+  }
+  for (int i = 0; i < 50; ++i) {
+    rightLines.removeAt(static_cast<int>(rng.bounded(rightLines.size())));
+  }
+
+  // Worst case: no line in common.
+  QStringList disjoint = TextDiff::splitLines(left);
+  for (QString& line : disjoint) {
+    line.prepend(QLatin1Char('#'));
+  }
+
+  QTest::addColumn<QString>("left");
+  QTest::addColumn<QString>("right");
+  QTest::addColumn<int>("maxLeftChanged");
+  QTest::newRow("100k lines, 250 edits") << left << rightLines.join('\n') << 250;
+  QTest::newRow("100k lines, nothing shared") << left << disjoint.join('\n') << kLines;
+}
+
+void TestTextDiff::benchmarkLargeFiles() {
+  QFETCH(QString, left);
+  QFETCH(QString, right);
+  QFETCH(int, maxLeftChanged);
+
+  TextDiff::Result diff;
+  QBENCHMARK {
+    diff = TextDiff::compute(left, right);
+  }
+  QVERIFY(!diff.hunks.isEmpty());
+  QVERIFY(diff.leftChanged.size() <= maxLeftChanged);
+}
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+  TestTextDiff tc;
+  return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_text_diff.moc"
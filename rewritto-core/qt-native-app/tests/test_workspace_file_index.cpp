@@ -0,0 +1,232 @@
+#include <QtTest/QtTest>
+
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "workspace_file_index.h"
+
+class TestWorkspaceFileIndex final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void indexesRootsAndRanksPaths();
+  void refreshRelistsOnlyChangedDirectories();
+  void watchedRootsRefreshOnTheirOwn();
+  void cacheServesFilesBeforeTheWalk();
+  void defaultRootsFollowBoardsTxt();
+};
+
+static bool writeTextFile(const QString& path, const QByteArray& data = {}) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile f(path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+    return false;
+  }
+  if (!data.isEmpty()) {
+    f.write(data);
+  }
+  return true;
+}
+
+static QStringList relativePaths(const QVector<WorkspaceFileIndex::Match>& matches) {
+  QStringList out;
+  for (const WorkspaceFileIndex::Match& match : matches) {
+    out << match.relativePath;
+  }
+  return out;
+}
+
+static bool waitForScan(WorkspaceFileIndex* index) {
+  QDeadlineTimer deadline(10000);
+  while (index->isScanning() || !index->isReady()) {
+    if (deadline.hasExpired()) {
+      return false;
+    }
+    QTest::qWait(10);
+  }
+  return true;
+}
+
+void TestWorkspaceFileIndex::indexesRootsAndRanksPaths() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QVERIFY(writeTextFile(dir.filePath("Blink/Blink.ino")));
+  QVERIFY(writeTextFile(dir.filePath("Blink/src/config.h")));
+  QVERIFY(writeTextFile(dir.filePath("Blink/.git/HEAD")));
+  QVERIFY(writeTextFile(dir.filePath("libs/Servo/src/Servo.h")));
+  QVERIFY(writeTextFile(dir.filePath("libs/Servo/src/avr/ServoTimers.h")));
+  QVERIFY(writeTextFile(dir.filePath("libs/Servo/examples/Sweep/Sweep.ino")));
+
+  WorkspaceFileIndex index;
+  index.setCachePath({});
+  QVERIFY(index.find("servo").isEmpty());
+  index.setRoots({{dir.filePath("Blink"), "Blink"}, {dir.filePath("libs"), "Libraries"}});
+  QVERIFY(waitForScan(&index));
+  QCOMPARE(index.fileCount(), 5);
+
+  // An empty query lists files in root order; hidden ones are left out.
+  QCOMPARE(relativePaths(index.find(QString(), 2)), QStringList({"Blink.ino", "src/config.h"}));
+
+  const QVector<WorkspaceFileIndex::Match> servo = index.find("servoh");
+  QCOMPARE(relativePaths(servo),
+           QStringList({"Servo/src/Servo.h", "Servo/src/avr/ServoTimers.h"}));
+  QCOMPARE(servo.first().filePath, dir.filePath("libs/Servo/src/Servo.h"));
+  QCOMPARE(servo.first().rootLabel, QStringLiteral("Libraries"));
+
+  QCOMPARE(relativePaths(index.find("swino")), QStringList({"Servo/examples/Sweep/Sweep.ino"}));
+  QCOMPARE(index.find("s", 1).size(), 1);
+
+  // Typing on narrows the previous matches, with the same result as a
+  // fresh query.
+  QVERIFY(!index.find("se").isEmpty());
+  const QStringList narrowed = relativePaths(index.find("servot"));
+  WorkspaceFileIndex fresh;
+  fresh.setCachePath({});
+  fresh.setRoots(index.roots());
+  QVERIFY(waitForScan(&fresh));
+  QCOMPARE(narrowed, relativePaths(fresh.find("servot")));
+}
+
+void TestWorkspaceFileIndex::refreshRelistsOnlyChangedDirectories() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QVERIFY(writeTextFile(dir.filePath("root/a/one.cpp")));
+  QVERIFY(writeTextFile(dir.filePath("root/b/two.cpp")));
+
+  WorkspaceFileIndex index;
+  index.setCachePath({});
+  index.setRoots({{dir.filePath("root"), "Root", false}});
+  QVERIFY(waitForScan(&index));
+  QCOMPARE(index.fileCount(), 2);
+  const quint64 revision = index.revision();
+
+  // Nothing moved: the same file list stays.
+  index.refresh();
+  QVERIFY(waitForScan(&index));
+  QCOMPARE(index.revision(), revision);
+
+  // Directory times have millisecond resolution at best.
+  QTest::qSleep(20);
+  QVERIFY(writeTextFile(dir.filePath("root/a/three.cpp")));
+  QVERIFY(writeTextFile(dir.filePath("root/c/d/four.cpp")));
+  QVERIFY(QDir(dir.filePath("root/b")).removeRecursively());
+  index.refresh();
+  QVERIFY(waitForScan(&index));
+  QVERIFY(index.revision() > revision);
+  QCOMPARE(relativePaths(index.find(QString())),
+           QStringList({"a/one.cpp", "a/three.cpp", "c/d/four.cpp"}));
+
+  // A root that goes away leaves no files behind.
+  QVERIFY(QDir(dir.filePath("root")).removeRecursively());
+  index.refresh();
+  QVERIFY(waitForScan(&index));
+  QCOMPARE(index.fileCount(), 0);
+}
+
+void TestWorkspaceFileIndex::watchedRootsRefreshOnTheirOwn() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QVERIFY(writeTextFile(dir.filePath("sketch/sketch.ino")));
+
+  WorkspaceFileIndex index;
+  index.setCachePath({});
+  index.setRoots({{dir.filePath("sketch"), "sketch"}});
+  QVERIFY(waitForScan(&index));
+  QCOMPARE(index.fileCount(), 1);
+
+  QTest::qSleep(20);
+  QVERIFY(writeTextFile(dir.filePath("sketch/helpers.h")));
+  QTRY_COMPARE_WITH_TIMEOUT(index.fileCount(), 2, 10000);
+  QCOMPARE(relativePaths(index.find("help")), QStringList({"helpers.h"}));
+}
+
+void TestWorkspaceFileIndex::cacheServesFilesBeforeTheWalk() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  for (int i = 0; i < 20; ++i) {
+    QVERIFY(writeTextFile(dir.filePath(QStringLiteral("lib/L%1/src/L%1.h").arg(i))));
+  }
+  const QString cachePath = dir.filePath("cache/workspace-files.bin");
+  const QVector<WorkspaceFileIndex::Root> roots = {{dir.filePath("lib"), "Libraries"}};
+
+  {
+    WorkspaceFileIndex index;
+    index.setCachePath(cachePath);
+    index.setRoots(roots);
+    QVERIFY(waitForScan(&index));
+    QCOMPARE(index.fileCount(), 20);
+  }
+  QVERIFY(QFileInfo::exists(cachePath));
+
+  // Next session: the cached list shows up once, and the walk that checks
+  // it finds nothing to change.
+  {
+    WorkspaceFileIndex index;
+    index.setCachePath(cachePath);
+    QSignalSpy changed(&index, &WorkspaceFileIndex::filesChanged);
+    index.setRoots(roots);
+    QVERIFY(waitForScan(&index));
+    QCOMPARE(index.fileCount(), 20);
+    QCOMPARE(changed.count(), 1);
+  }
+
+  // A library installed in between replaces the cached list after the walk.
+  QTest::qSleep(20);
+  QVERIFY(writeTextFile(dir.filePath("lib/New/New.h")));
+  {
+    WorkspaceFileIndex index;
+    index.setCachePath(cachePath);
+    QSignalSpy changed(&index, &WorkspaceFileIndex::filesChanged);
+    index.setRoots(roots);
+    QVERIFY(waitForScan(&index));
+    QCOMPARE(index.fileCount(), 21);
+    QCOMPARE(changed.count(), 2);
+  }
+}
+
+void TestWorkspaceFileIndex::defaultRootsFollowBoardsTxt() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString hardware = dir.filePath("data/packages/vendor/hardware/avr");
+  QVERIFY(writeTextFile(hardware + "/1.8.6/boards.txt",
+                        "uno.name=Uno\n"
+                        "uno.build.core=arduino\n"
+                        "uno.build.variant=standard\n"
+                        "mega.build.variant=mega\n"
+                        "other.build.core=other:custom\n"
+                        "other.build.variant=eightanaloginputs\n"));
+  QVERIFY(writeTextFile(hardware + "/1.8.6/cores/arduino/Arduino.h"));
+  QVERIFY(writeTextFile(hardware + "/1.8.6/variants/standard/pins_arduino.h"));
+  QVERIFY(writeTextFile(hardware + "/1.8.6/variants/eightanaloginputs/pins_arduino.h"));
+  QVERIFY(writeTextFile(hardware + "/1.8.10/boards.txt", "uno.build.core=arduino\n"));
+  QVERIFY(writeTextFile(hardware + "/1.8.10/cores/arduino/Arduino.h"));
+  QVERIFY(writeTextFile(dir.filePath("data/packages/other/hardware/avr/2.0.0/cores/custom/c.h")));
+  QVERIFY(writeTextFile(dir.filePath("sb/libraries/Foo/Foo.h")));
+  QVERIFY(writeTextFile(dir.filePath("sb/Blink/Blink.ino")));
+
+  // The newest platform version wins, and missing folders are skipped.
+  QVector<WorkspaceFileIndex::Root> roots = WorkspaceFileIndex::defaultRoots(
+      dir.filePath("sb/Blink"), dir.filePath("sb"), dir.filePath("data"), "vendor:avr:uno");
+  QCOMPARE(roots.size(), 3);
+  QCOMPARE(roots.at(0).path, dir.filePath("sb/Blink"));
+  QCOMPARE(roots.at(0).label, QStringLiteral("Blink"));
+  QCOMPARE(roots.at(1).path, dir.filePath("sb/libraries"));
+  QCOMPARE(roots.at(2).path, hardware + "/1.8.10/cores/arduino");
+  QCOMPARE(roots.at(2).label, QStringLiteral("vendor:avr core"));
+  QVERIFY(!roots.at(2).watched);
+
+  QVERIFY(QDir(hardware + "/1.8.10").removeRecursively());
+  roots = WorkspaceFileIndex::defaultRoots({}, {}, dir.filePath("data"), "vendor:avr:other:opt=1");
+  QCOMPARE(roots.size(), 2);
+  QCOMPARE(roots.at(0).path, dir.filePath("data/packages/other/hardware/avr/2.0.0/cores/custom"));
+  QCOMPARE(roots.at(1).path, hardware + "/1.8.6/variants/eightanaloginputs");
+  QCOMPARE(roots.at(1).label, QStringLiteral("vendor:avr variant"));
+
+  QVERIFY(WorkspaceFileIndex::defaultRoots({}, {}, dir.filePath("data"), {}).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestWorkspaceFileIndex)
+#include "test_workspace_file_index.moc"
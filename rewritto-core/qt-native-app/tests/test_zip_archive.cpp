@@ -0,0 +1,364 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <algorithm>
+
+#include "zip_archive.h"
+
+namespace {
+
+bool writeFile(const QString& path, const QByteArray& data) {
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile f(path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+  return f.write(data) == data.size();
+}
+
+QByteArray readFile(const QString& path) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+  return f.readAll();
+}
+
+QByteArray randomBytes(qsizetype size, quint32 seed) {
+  QByteArray out(size, Qt::Uninitialized);
+  QRandomGenerator rng(seed);
+  for (qsizetype i = 0; i < size; ++i) {
+    out[i] = static_cast<char>(rng.bounded(256));
+  }
+  return out;
+}
+
+QByteArray sourceLikeText(qsizetype size, int seed) {
+  QByteArray out;
+  out.reserve(size + 64);
+  for (int line = 0; out.size() < size; ++line) {
+    out += "  digitalWrite(LED_BUILTIN, " + QByteArray::number((line + seed) % 2) +
+           ");  // line " + QByteArray::number(line) + "\n";
+  }
+  out.truncate(size);
+  return out;
+}
+
+// Relative path -> contents of every file below `root`.
+QMap<QString, QByteArray> snapshot(const QString& root) {
+  QMap<QString, QByteArray> out;
+  QDirIterator it(root, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    out.insert(QDir(root).relativeFilePath(path), readFile(path));
+  }
+  return out;
+}
+
+void put16(QByteArray* out, quint16 v) {
+  char b[2];
+  qToLittleEndian(v, b);
+  out->append(b, 2);
+}
+
+void put32(QByteArray* out, quint32 v) {
+  char b[4];
+  qToLittleEndian(v, b);
+  out->append(b, 4);
+}
+
+// A one-entry stored archive, for names our writer never produces.
+QByteArray storedArchive(const QByteArray& name, const QByteArray& data) {
+  const quint32 crc = 0;  // never checked: the name is rejected first
+  QByteArray zip;
+  put32(&zip, 0x04034b50);
+  put16(&zip, 20);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0x21);
+  put32(&zip, crc);
+  put32(&zip, static_cast<quint32>(data.size()));
+  put32(&zip, static_cast<quint32>(data.size()));
+  put16(&zip, static_cast<quint16>(name.size()));
+  put16(&zip, 0);
+  zip += name + data;
+  const quint32 cdOffset = static_cast<quint32>(zip.size());
+  put32(&zip, 0x02014b50);
+  put16(&zip, 20);
+  put16(&zip, 20);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0x21);
+  put32(&zip, crc);
+  put32(&zip, static_cast<quint32>(data.size()));
+  put32(&zip, static_cast<quint32>(data.size()));
+  put16(&zip, static_cast<quint16>(name.size()));
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put32(&zip, 0);
+  put32(&zip, 0);
+  zip += name;
+  const quint32 cdSize = static_cast<quint32>(zip.size()) - cdOffset;
+  put32(&zip, 0x06054b50);
+  put16(&zip, 0);
+  put16(&zip, 0);
+  put16(&zip, 1);
+  put16(&zip, 1);
+  put32(&zip, cdSize);
+  put32(&zip, cdOffset);
+  put16(&zip, 0);
+  return zip;
+}
+
+// About 50 MiB: 400 source files and one large map file.
+void writeBenchmarkProject(const QString& project) {
+  for (int i = 0; i < 400; ++i) {
+    writeFile(QStringLiteral("%1/lib%2/file%3.cpp").arg(project).arg(i % 16).arg(i),
+              sourceLikeText(64 * 1024 + i, i));
+  }
+  writeFile(project + "/build/firmware.elf.map", sourceLikeText(24 * 1024 * 1024, 11));
+}
+
+}  // namespace
+
+class TestZipArchive final : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void roundTripsProjectTree();
+  void interoperatesWithPythonZipfile();
+  void rejectsEntriesOutsideDestination();
+  void detectsCorruptData();
+  void extractsOutputPendingAtChunkEnd();
+  void benchmarkCreate_data();
+  void benchmarkCreate();
+  void benchmarkExtract();
+};
+
+void TestZipArchive::roundTripsProjectTree() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("MyProject");
+  QVERIFY(writeFile(project + "/MyProject.ino", sourceLikeText(3000, 1)));
+  QVERIFY(writeFile(project + "/src/config.h", "#define VALUE 42\n"));
+  QVERIFY(writeFile(project + "/src/empty.txt", QByteArray()));
+  QVERIFY(writeFile(project + "/.rewritto/settings.json", "{}\n"));
+  QVERIFY(writeFile(project + QString::fromUtf8("/data/caf\u00e9.txt"), "utf-8 name\n"));
+  // Incompressible, and above the size that is compressed on the pool.
+  QVERIFY(writeFile(project + "/build/firmware.bin", randomBytes(5 * 1024 * 1024 + 17, 7)));
+  QVERIFY(writeFile(project + "/build/firmware.map", sourceLikeText(6 * 1024 * 1024, 2)));
+  for (int i = 0; i < 200; ++i) {
+    QVERIFY(writeFile(QStringLiteral("%1/libraries/Lib%2/Lib.cpp").arg(project).arg(i % 10),
+                      sourceLikeText(500 + i * 37, i)));
+    QVERIFY(writeFile(QStringLiteral("%1/libraries/Lib%2/f%3.h").arg(project).arg(i % 10).arg(i),
+                      sourceLikeText(100 + i, i)));
+  }
+  QVERIFY(QDir().mkpath(project + "/empty-dir"));
+  const QString tool = project + "/tools/flash.sh";
+  QVERIFY(writeFile(tool, "#!/bin/sh\necho flash\n"));
+  QVERIFY(QFile::setPermissions(tool, QFile::permissions(tool) | QFileDevice::ExeOwner));
+
+  const QString zipPath = dir.filePath("out/MyProject.zip");
+  QVector<qint64> reported;
+  qint64 reportedTotal = 0;
+  QString error;
+  QVERIFY2(ZipArchive::createFromDirectory(
+               project, zipPath, &error,
+               [&](qint64 done, qint64 total) {
+                 reported.push_back(done);
+                 reportedTotal = total;
+               }),
+           qPrintable(error));
+  QVERIFY(!reported.isEmpty());
+  QVERIFY(std::is_sorted(reported.cbegin(), reported.cend()));
+  QCOMPARE(reported.last(), reportedTotal);
+  QVERIFY(QFileInfo(zipPath).size() < reportedTotal);
+
+  const QString extracted = dir.filePath("extracted");
+  QVERIFY2(ZipArchive::extractToDirectory(zipPath, extracted, &error), qPrintable(error));
+  QCOMPARE(snapshot(extracted + "/MyProject"), snapshot(project));
+  QVERIFY(QFileInfo(extracted + "/MyProject/empty-dir").isDir());
+  QVERIFY(QFileInfo(extracted + "/MyProject/tools/flash.sh").permissions() &
+          QFileDevice::ExeOwner);
+  QVERIFY(!(QFileInfo(extracted + "/MyProject/src/config.h").permissions() &
+            QFileDevice::ExeOwner));
+
+  // Same result on a single thread, byte for byte.
+  const QString serialZip = dir.filePath("out/serial.zip");
+  QVERIFY2(ZipArchive::createFromDirectory(project, serialZip, &error, {}, 1),
+           qPrintable(error));
+  QCOMPARE(readFile(serialZip), readFile(zipPath));
+
+  QVERIFY(!ZipArchive::createFromDirectory(dir.filePath("missing"), serialZip, &error));
+  QVERIFY(!error.isEmpty());
+}
+
+void TestZipArchive::interoperatesWithPythonZipfile() {
+  const QString python = QStandardPaths::findExecutable(QStringLiteral("python3"));
+  if (python.isEmpty()) {
+    QSKIP("python3 is not installed");
+  }
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("Sketch");
+  QVERIFY(writeFile(project + "/Sketch.ino", sourceLikeText(20000, 3)));
+  QVERIFY(writeFile(project + "/blob.bin", randomBytes(300000, 9)));
+
+  // Ours -> zipfile.
+  const QString ours = dir.filePath("ours.zip");
+  QString error;
+  QVERIFY2(ZipArchive::createFromDirectory(project, ours, &error), qPrintable(error));
+  QProcess check;
+  check.start(python, {QStringLiteral("-c"),
+                       QStringLiteral("import sys,zipfile\n"
+                                      "z=zipfile.ZipFile(sys.argv[1])\n"
+                                      "assert z.testzip() is None\n"
+                                      "print(len(z.read('Sketch/Sketch.ino')))\n"),
+                       ours});
+  QVERIFY(check.waitForFinished(30000));
+  QCOMPARE(check.exitCode(), 0);
+  QCOMPARE(check.readAllStandardOutput().trimmed(), QByteArray("20000"));
+
+  // zipfile (stored and deflated entries, zip64 extras forced) -> ours.
+  const QString theirs = dir.filePath("theirs.zip");
+  QProcess make;
+  make.start(python, {QStringLiteral("-c"),
+                      QStringLiteral("import sys,zipfile\n"
+                                     "with zipfile.ZipFile(sys.argv[1],'w') as z:\n"
+                                     "  z.write(sys.argv[2]+'/Sketch.ino','S/Sketch.ino',"
+                                     "compress_type=zipfile.ZIP_DEFLATED)\n"
+                                     "  z.write(sys.argv[2]+'/blob.bin','S/blob.bin',"
+                                     "compress_type=zipfile.ZIP_STORED)\n"
+                                     "  with z.open('S/big.txt','w',force_zip64=True) as f:\n"
+                                     "    f.write(b'zip64 ' * 1000)\n"),
+                      theirs, project});
+  QVERIFY(make.waitForFinished(30000));
+  QCOMPARE(make.exitCode(), 0);
+  const QString extracted = dir.filePath("theirs");
+  QVERIFY2(ZipArchive::extractToDirectory(theirs, extracted, &error), qPrintable(error));
+  QCOMPARE(readFile(extracted + "/S/Sketch.ino"), readFile(project + "/Sketch.ino"));
+  QCOMPARE(readFile(extracted + "/S/blob.bin"), readFile(project + "/blob.bin"));
+  QCOMPARE(readFile(extracted + "/S/big.txt"), QByteArray("zip64 ").repeated(1000));
+}
+
+void TestZipArchive::rejectsEntriesOutsideDestination() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString dest = dir.filePath("dest/inner");
+  for (const QByteArray& name :
+       {QByteArray("../evil.txt"), QByteArray("a/../../evil.txt"), QByteArray("/tmp/evil.txt"),
+        QByteArray("..\\evil.txt"), QByteArray("C:/evil.txt")}) {
+    const QString zipPath = dir.filePath("evil.zip");
+    QVERIFY(writeFile(zipPath, storedArchive(name, "boom\n")));
+    QString error;
+    QVERIFY2(!ZipArchive::extractToDirectory(zipPath, dest, &error), name.constData());
+    QVERIFY(!error.isEmpty());
+  }
+  QVERIFY(!QFileInfo::exists(dir.filePath("dest/evil.txt")));
+  QVERIFY(!QFileInfo::exists(dir.filePath("evil.txt")));
+
+  QVERIFY(writeFile(dir.filePath("not.zip"), "plain text, no archive here\n"));
+  QString error;
+  QVERIFY(!ZipArchive::extractToDirectory(dir.filePath("not.zip"), dest, &error));
+  QVERIFY(!error.isEmpty());
+}
+
+void TestZipArchive::detectsCorruptData() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("P");
+  QVERIFY(writeFile(project + "/P.ino", sourceLikeText(50000, 5)));
+  const QString zipPath = dir.filePath("p.zip");
+  QString error;
+  QVERIFY2(ZipArchive::createFromDirectory(project, zipPath, &error), qPrintable(error));
+
+  QByteArray bytes = readFile(zipPath);
+  // Inside the deflated data of P/P.ino: past the directory entry and the
+  // file's own local header.
+  const qsizetype at = bytes.indexOf("P/P.ino") + 200;
+  QVERIFY(at > 200 && at < bytes.size() / 2);
+  bytes[at] = static_cast<char>(bytes.at(at) ^ 0x5A);
+  QVERIFY(writeFile(zipPath, bytes));
+  QVERIFY(!ZipArchive::extractToDirectory(zipPath, dir.filePath("out"), &error));
+  QVERIFY(error.contains(QStringLiteral("P/P.ino")));
+}
+
+void TestZipArchive::extractsOutputPendingAtChunkEnd() {
+  // Runs of one byte deflate to a few hundred bytes, read in one go. Just
+  // past a multiple of the 256 KiB output chunk, inflate has consumed all
+  // of it while still holding output for the next call.
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("Runs");
+  constexpr qsizetype kChunk = 256 * 1024;
+  for (int chunks = 1; chunks <= 3; ++chunks) {
+    for (qsizetype extra : {qsizetype(0), qsizetype(2), qsizetype(100)}) {
+      QVERIFY(writeFile(QStringLiteral("%1/zero-%2-%3.bin").arg(project).arg(chunks).arg(extra),
+                        QByteArray(chunks * kChunk + extra, '\0')));
+    }
+  }
+  const QString zipPath = dir.filePath("runs.zip");
+  QString error;
+  QVERIFY2(ZipArchive::createFromDirectory(project, zipPath, &error), qPrintable(error));
+  QVERIFY(QFileInfo(zipPath).size() < 64 * 1024);
+  QVERIFY2(ZipArchive::extractToDirectory(zipPath, dir.filePath("out"), &error),
+           qPrintable(error));
+  QCOMPARE(snapshot(dir.filePath("out/Runs")), snapshot(project));
+}
+
+void TestZipArchive::benchmarkCreate_data() {
+  QTest::addColumn<int>("threads");
+  QTest::newRow("1 thread") << 1;
+  QTest::newRow("all threads") << 0;
+}
+
+void TestZipArchive::benchmarkCreate() {
+  QFETCH(int, threads);
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("Bench");
+  writeBenchmarkProject(project);
+  const QString zipPath = dir.filePath("bench.zip");
+
+  QString error;
+  bool ok = false;
+  QBENCHMARK {
+    ok = ZipArchive::createFromDirectory(project, zipPath, &error, {}, threads);
+  }
+  QVERIFY2(ok, qPrintable(error));
+}
+
+void TestZipArchive::benchmarkExtract() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString project = dir.filePath("Bench");
+  writeBenchmarkProject(project);
+  const QString zipPath = dir.filePath("bench.zip");
+  QString error;
+  QVERIFY2(ZipArchive::createFromDirectory(project, zipPath, &error), qPrintable(error));
+
+  bool ok = false;
+  QBENCHMARK {
+    ok = ZipArchive::extractToDirectory(zipPath, dir.filePath("x"), &error);
+  }
+  QVERIFY2(ok, qPrintable(error));
+  QCOMPARE(snapshot(dir.filePath("x/Bench")).size(), qsizetype(401));
+}
+
+QTEST_MAIN(TestZipArchive)
+
+#include "test_zip_archive.moc"